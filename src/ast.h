@@ -37,6 +37,7 @@ enum plx_node_kind {
   PLX_NODE_IF_THEN_ELSE,
   PLX_NODE_LOOP,
   PLX_NODE_WHILE_LOOP,
+  PLX_NODE_FOR_LOOP,
   PLX_NODE_CONTINUE,
   PLX_NODE_BREAK,
   PLX_NODE_RETURN,
@@ -72,7 +73,18 @@ enum plx_node_kind {
   PLX_NODE_DEREF,
   PLX_NODE_CALL,
   PLX_NODE_INDEX,
+  PLX_NODE_BOUNDS_CHECK,
   PLX_NODE_SLICE,
+  PLX_NODE_RANGE,
+  PLX_NODE_SELECT,
+  PLX_NODE_SHUFFLE,
+  PLX_NODE_REDUCE_ADD,
+  PLX_NODE_REDUCE_MUL,
+  PLX_NODE_REDUCE_MIN,
+  PLX_NODE_REDUCE_MAX,
+  PLX_NODE_REDUCE_AND,
+  PLX_NODE_REDUCE_OR,
+  PLX_NODE_REDUCE_XOR,
   PLX_NODE_FIELD,
   PLX_NODE_IDENTIFIER,
   PLX_NODE_STRUCT,
@@ -109,11 +121,19 @@ enum plx_node_kind {
   PLX_NODE_REF_TYPE,
   PLX_NODE_ARRAY_TYPE,
   PLX_NODE_SLICE_TYPE,
+  PLX_NODE_VEC_TYPE,
 
   // Other
   PLX_NODE_OTHER,
 };
 
+// Whether a function should be inlined into its callers.
+enum plx_inline_hint {
+  PLX_INLINE_HINT_NONE,
+  PLX_INLINE_HINT_ALWAYS,
+  PLX_INLINE_HINT_NEVER,
+};
+
 struct plx_symbol_table_entry;
 
 // Node in the abstract syntax tree.
@@ -132,6 +152,11 @@ struct plx_node {
       size_t len;
       char* str;
     };
+    // Inlining hint of a function definition.
+    enum plx_inline_hint inline_hint;
+    // Whether a return statement is marked `tail`, or whether a call is
+    // lowered as a guaranteed tail call.
+    bool tail_call;
   };
   struct plx_node* children;
   struct plx_node* next;
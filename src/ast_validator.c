@@ -17,6 +17,7 @@
 #include "error.h"
 #include "source_code_printer.h"
 #include "symbol_table_entry.h"
+#include "types.h"
 
 static void plx_expected_constant(const struct plx_node* const node) {
   plx_error("expected a constant");
@@ -45,6 +46,16 @@ static bool plx_is_referenceable_expr(const struct plx_node* const expr) {
          expr->kind == PLX_NODE_IDENTIFIER;
 }
 
+// Returns whether an expression can be assigned to. Constants, functions and
+// loop variables cannot.
+static bool plx_is_assignable_expr(const struct plx_node* const expr) {
+  if (expr->kind == PLX_NODE_IDENTIFIER) {
+    return expr->entry == NULL ||
+           expr->entry->mutability == PLX_SYMBOL_MUTABILITY_MUTABLE;
+  }
+  return plx_is_referenceable_expr(expr);
+}
+
 bool plx_validate_ast(const struct plx_node* const node) {
   bool result = true;
   switch (node->kind) {
@@ -70,7 +81,7 @@ bool plx_validate_ast(const struct plx_node* const node) {
       const struct plx_node *assignee, *value;
       plx_extract_children(node, &assignee, &value);
       if (!plx_validate_ast(assignee)) result = false;
-      if (!plx_is_referenceable_expr(assignee)) {
+      if (!plx_is_assignable_expr(assignee)) {
         plx_expr_not_assignable(assignee);
         result = false;
       }
@@ -81,12 +92,30 @@ bool plx_validate_ast(const struct plx_node* const node) {
       const struct plx_node* operand;
       plx_extract_children(node, &operand);
       if (!plx_validate_ast(operand)) result = false;
-      if (!plx_is_referenceable_expr(operand)) {
+      // Vector lanes are assignable but are not addressable.
+      if (!plx_is_referenceable_expr(operand) ||
+          (operand->kind == PLX_NODE_INDEX &&
+           operand->children->type != NULL &&
+           plx_is_vec_type(operand->children->type))) {
         plx_expr_not_referenceable(node);
         result = false;
       }
       break;
     }
+    case PLX_NODE_FOR_LOOP: {
+      const struct plx_node *name, *iterable, *body;
+      plx_extract_children(node, &name, &iterable, &body);
+      if (!plx_validate_ast(iterable)) result = false;
+      // Arrays are iterated in place rather than copied.
+      if (iterable->type != NULL &&
+          iterable->type->kind == PLX_NODE_ARRAY_TYPE &&
+          !plx_is_referenceable_expr(iterable)) {
+        plx_expr_not_referenceable(iterable);
+        result = false;
+      }
+      if (!plx_validate_ast(body)) result = false;
+      break;
+    }
     case PLX_NODE_ARRAY_TYPE: {
       const struct plx_node *len, *element_type;
       plx_extract_children(node, &len, &element_type);
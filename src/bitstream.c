@@ -0,0 +1,162 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bitstream.h"
+
+#include <assert.h>
+
+// Abbreviation IDs that are defined in every block.
+enum {
+  PLX_BITSTREAM_END_BLOCK = 0,
+  PLX_BITSTREAM_ENTER_SUBBLOCK = 1,
+  PLX_BITSTREAM_DEFINE_ABBREV = 2,
+  PLX_BITSTREAM_UNABBREV_RECORD = 3,
+  PLX_BITSTREAM_FIRST_APPLICATION_ABBREV = 4,
+};
+
+// Encodings of abbreviation operands.
+enum {
+  PLX_BITSTREAM_ENCODING_BLOB = 5,
+};
+
+// Width of abbreviation IDs outside of any block.
+#define PLX_BITSTREAM_TOP_LEVEL_ABBREV_WIDTH 2
+
+void plx_bitstream_init(struct plx_bitstream* const stream,
+                        struct plx_buffer* const buffer) {
+  stream->buffer = buffer;
+  stream->bits = 0;
+  stream->bit_count = 0;
+  stream->abbrev_width = PLX_BITSTREAM_TOP_LEVEL_ABBREV_WIDTH;
+  stream->depth = 0;
+}
+
+// Writes a little-endian 32-bit word to the buffer.
+static void plx_bitstream_write_word(struct plx_bitstream* const stream,
+                                     const uint32_t word) {
+  const unsigned char bytes[] = {(unsigned char)word,
+                                 (unsigned char)(word >> 8),
+                                 (unsigned char)(word >> 16),
+                                 (unsigned char)(word >> 24)};
+  plx_buffer_append(stream->buffer, bytes, sizeof(bytes));
+}
+
+void plx_bitstream_emit(struct plx_bitstream* const stream,
+                        const uint32_t value, const unsigned int width) {
+  assert(width <= 32);
+  assert(width == 32 || value >> width == 0);
+  stream->bits |= (uint64_t)value << stream->bit_count;
+  stream->bit_count += width;
+  if (stream->bit_count >= 32) {
+    plx_bitstream_write_word(stream, (uint32_t)stream->bits);
+    stream->bits >>= 32;
+    stream->bit_count -= 32;
+  }
+}
+
+void plx_bitstream_emit_vbr(struct plx_bitstream* const stream, uint64_t value,
+                            const unsigned int width) {
+  assert(width >= 2 && width <= 32);
+  const uint64_t threshold = (uint64_t)1 << (width - 1);
+  while (value >= threshold) {
+    const uint32_t chunk = (uint32_t)(value & (threshold - 1));
+    plx_bitstream_emit(stream, chunk | (uint32_t)threshold, width);
+    value >>= width - 1;
+  }
+  plx_bitstream_emit(stream, (uint32_t)value, width);
+}
+
+void plx_bitstream_align(struct plx_bitstream* const stream) {
+  if (stream->bit_count == 0) return;
+  plx_bitstream_write_word(stream, (uint32_t)stream->bits);
+  stream->bits = 0;
+  stream->bit_count = 0;
+}
+
+void plx_bitstream_enter_block(struct plx_bitstream* const stream,
+                               const unsigned int block_id,
+                               const unsigned int abbrev_width) {
+  assert(stream->depth < PLX_BITSTREAM_MAX_DEPTH);
+  plx_bitstream_emit(stream, PLX_BITSTREAM_ENTER_SUBBLOCK,
+                     stream->abbrev_width);
+  plx_bitstream_emit_vbr(stream, block_id, 8);
+  plx_bitstream_emit_vbr(stream, abbrev_width, 4);
+  plx_bitstream_align(stream);
+
+  // The length is filled in when the block ends.
+  struct plx_bitstream_block* const block = &stream->blocks[stream->depth++];
+  block->len_offset = stream->buffer->len;
+  block->outer_abbrev_width = stream->abbrev_width;
+  block->abbrev_count = 0;
+  plx_bitstream_write_word(stream, 0);
+  stream->abbrev_width = abbrev_width;
+}
+
+void plx_bitstream_exit_block(struct plx_bitstream* const stream) {
+  assert(stream->depth > 0);
+  plx_bitstream_emit(stream, PLX_BITSTREAM_END_BLOCK, stream->abbrev_width);
+  plx_bitstream_align(stream);
+
+  // The length is the number of words after the length word.
+  const struct plx_bitstream_block* const block =
+      &stream->blocks[--stream->depth];
+  const size_t len = (stream->buffer->len - block->len_offset) / 4 - 1;
+  unsigned char* const bytes =
+      (unsigned char*)&stream->buffer->data[block->len_offset];
+  bytes[0] = (unsigned char)len;
+  bytes[1] = (unsigned char)(len >> 8);
+  bytes[2] = (unsigned char)(len >> 16);
+  bytes[3] = (unsigned char)(len >> 24);
+  stream->abbrev_width = block->outer_abbrev_width;
+}
+
+void plx_bitstream_emit_record(struct plx_bitstream* const stream,
+                               const unsigned int code,
+                               const uint64_t* const ops, const size_t len) {
+  plx_bitstream_emit(stream, PLX_BITSTREAM_UNABBREV_RECORD,
+                     stream->abbrev_width);
+  plx_bitstream_emit_vbr(stream, code, 6);
+  plx_bitstream_emit_vbr(stream, len, 6);
+  for (size_t i = 0; i < len; ++i) plx_bitstream_emit_vbr(stream, ops[i], 6);
+}
+
+unsigned int plx_bitstream_define_blob_abbrev(
+    struct plx_bitstream* const stream, const unsigned int code) {
+  assert(stream->depth > 0);
+  plx_bitstream_emit(stream, PLX_BITSTREAM_DEFINE_ABBREV, stream->abbrev_width);
+  plx_bitstream_emit_vbr(stream, 2, 5);
+
+  // The record code is a literal.
+  plx_bitstream_emit(stream, 1, 1);
+  plx_bitstream_emit_vbr(stream, code, 8);
+
+  // The contents are a blob.
+  plx_bitstream_emit(stream, 0, 1);
+  plx_bitstream_emit(stream, PLX_BITSTREAM_ENCODING_BLOB, 3);
+
+  struct plx_bitstream_block* const block = &stream->blocks[stream->depth - 1];
+  return PLX_BITSTREAM_FIRST_APPLICATION_ABBREV + block->abbrev_count++;
+}
+
+void plx_bitstream_emit_blob(struct plx_bitstream* const stream,
+                             const unsigned int abbrev, const void* const data,
+                             const size_t len) {
+  plx_bitstream_emit(stream, abbrev, stream->abbrev_width);
+  plx_bitstream_emit_vbr(stream, len, 6);
+  plx_bitstream_align(stream);
+  plx_buffer_append(stream->buffer, data, len);
+  const size_t padding = (4 - len % 4) % 4;
+  const unsigned char zeros[3] = {0, 0, 0};
+  plx_buffer_append(stream->buffer, zeros, padding);
+}
@@ -0,0 +1,96 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_BITSTREAM_H
+#define PLX_BITSTREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "buffer.h"
+
+// Maximum nesting depth of blocks in a bitstream.
+#define PLX_BITSTREAM_MAX_DEPTH 8
+
+// Block that is being written to a bitstream.
+struct plx_bitstream_block {
+  // Offset in the buffer of the word that holds the length of the block.
+  size_t len_offset;
+
+  // Width of abbreviation IDs in the enclosing block.
+  unsigned int outer_abbrev_width;
+
+  // Number of abbreviations defined in the block.
+  unsigned int abbrev_count;
+};
+
+// Writer for the LLVM bitstream container format, which is a stream of bits
+// packed into little-endian 32-bit words.
+// https://llvm.org/docs/BitCodeFormat.html#bitstream-format
+struct plx_bitstream {
+  // Output buffer.
+  struct plx_buffer* buffer;
+
+  // Bits that have not been written to the buffer yet.
+  uint64_t bits;
+
+  // Number of bits that have not been written to the buffer yet.
+  unsigned int bit_count;
+
+  // Width of abbreviation IDs in the current block.
+  unsigned int abbrev_width;
+
+  // Blocks that are being written.
+  size_t depth;
+  struct plx_bitstream_block blocks[PLX_BITSTREAM_MAX_DEPTH];
+};
+
+// Initializes a bitstream that writes to the buffer.
+void plx_bitstream_init(struct plx_bitstream* stream,
+                        struct plx_buffer* buffer);
+
+// Writes a value as a fixed-width field of at most 32 bits.
+void plx_bitstream_emit(struct plx_bitstream* stream, uint32_t value,
+                        unsigned int width);
+
+// Writes a value as a variable-width field with chunks of the given width.
+void plx_bitstream_emit_vbr(struct plx_bitstream* stream, uint64_t value,
+                            unsigned int width);
+
+// Pads the bitstream with zeros to a multiple of 32 bits.
+void plx_bitstream_align(struct plx_bitstream* stream);
+
+// Begins a block with abbreviation IDs of the given width.
+void plx_bitstream_enter_block(struct plx_bitstream* stream,
+                               unsigned int block_id,
+                               unsigned int abbrev_width);
+
+// Ends the current block and fills in its length.
+void plx_bitstream_exit_block(struct plx_bitstream* stream);
+
+// Writes an unabbreviated record.
+void plx_bitstream_emit_record(struct plx_bitstream* stream, unsigned int code,
+                               const uint64_t* ops, size_t len);
+
+// Defines an abbreviation in the current block for a record that holds a blob,
+// returning its abbreviation ID.
+unsigned int plx_bitstream_define_blob_abbrev(struct plx_bitstream* stream,
+                                              unsigned int code);
+
+// Writes a record that holds a blob using an abbreviation from
+// `plx_bitstream_define_blob_abbrev`.
+void plx_bitstream_emit_blob(struct plx_bitstream* stream, unsigned int abbrev,
+                             const void* data, size_t len);
+
+#endif  // PLX_BITSTREAM_H
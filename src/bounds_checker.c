@@ -0,0 +1,319 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bounds_checker.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "error.h"
+#include "macros.h"
+#include "symbol_table_entry.h"
+#include "types.h"
+
+// Closed interval of the values that an integer expression may take. `u64`
+// values that do not fit in a `long long` are not tracked, so the range of a
+// `u64` expression may be unknown.
+struct plx_value_range {
+  bool known;
+  long long min;
+  long long max;
+};
+
+// Range of the values of a loop variable in the body of its loop.
+struct plx_loop_var_range {
+  const struct plx_symbol_table_entry* entry;
+  struct plx_value_range range;
+};
+
+struct plx_bounds_checker {
+  enum plx_bounds_checks mode;
+  FILE* report;
+
+  // Ranges of the loop variables in scope, innermost last.
+  size_t cap;
+  size_t len;
+  struct plx_loop_var_range* loop_vars;
+
+  // Number of checks in the current function and how many of them were
+  // elided.
+  size_t checks;
+  size_t elided;
+};
+
+static const struct plx_value_range plx_unknown_range = {false, 0, 0};
+
+// Returns the range of the values of an integer type.
+static struct plx_value_range plx_type_range(
+    const struct plx_node* const type) {
+  switch (type->kind) {
+    case PLX_NODE_S8_TYPE:
+      return (struct plx_value_range){true, INT8_MIN, INT8_MAX};
+    case PLX_NODE_S16_TYPE:
+      return (struct plx_value_range){true, INT16_MIN, INT16_MAX};
+    case PLX_NODE_S32_TYPE:
+      return (struct plx_value_range){true, INT32_MIN, INT32_MAX};
+    case PLX_NODE_S64_TYPE:
+      return (struct plx_value_range){true, LLONG_MIN, LLONG_MAX};
+    case PLX_NODE_U8_TYPE:
+      return (struct plx_value_range){true, 0, UINT8_MAX};
+    case PLX_NODE_U16_TYPE:
+      return (struct plx_value_range){true, 0, UINT16_MAX};
+    case PLX_NODE_U32_TYPE:
+      return (struct plx_value_range){true, 0, UINT32_MAX};
+    default:
+      return plx_unknown_range;
+  }
+}
+
+// Returns the range of the result of an operation, or the range of its type if
+// the result may wrap around.
+static struct plx_value_range plx_clamp_range(
+    const struct plx_value_range range, const struct plx_node* const type) {
+  const struct plx_value_range type_range = plx_type_range(type);
+  if (!range.known) return type_range;
+  if (type_range.known
+          ? range.min < type_range.min || range.max > type_range.max
+          : range.min < 0) {
+    return type_range;
+  }
+  return range;
+}
+
+// Stores the sum of two values, returning whether it does not overflow.
+static bool plx_checked_add(const long long a, const long long b,
+                            long long* const result) {
+  if ((b > 0 && a > LLONG_MAX - b) || (b < 0 && a < LLONG_MIN - b)) {
+    return false;
+  }
+  *result = a + b;
+  return true;
+}
+
+// Stores the difference of two values, returning whether it does not
+// overflow.
+static bool plx_checked_sub(const long long a, const long long b,
+                            long long* const result) {
+  if ((b < 0 && a > LLONG_MAX + b) || (b > 0 && a < LLONG_MIN + b)) {
+    return false;
+  }
+  *result = a - b;
+  return true;
+}
+
+// Stores the product of two non-negative values, returning whether it does not
+// overflow.
+static bool plx_checked_mul(const long long a, const long long b,
+                            long long* const result) {
+  if (a != 0 && b > LLONG_MAX / a) return false;
+  *result = a * b;
+  return true;
+}
+
+static struct plx_value_range plx_expr_range(
+    const struct plx_bounds_checker* const checker,
+    const struct plx_node* const node) {
+  struct plx_value_range range = plx_unknown_range;
+  switch (node->kind) {
+    case PLX_NODE_S8:
+    case PLX_NODE_S16:
+    case PLX_NODE_S32:
+    case PLX_NODE_S64:
+      return (struct plx_value_range){true, node->sint, node->sint};
+    case PLX_NODE_U8:
+    case PLX_NODE_U16:
+    case PLX_NODE_U32:
+    case PLX_NODE_U64:
+      if (node->uint > LLONG_MAX) return plx_unknown_range;
+      return (struct plx_value_range){true, (long long)node->uint,
+                                      (long long)node->uint};
+    case PLX_NODE_IDENTIFIER:
+      for (size_t i = checker->len; i > 0; --i) {
+        if (checker->loop_vars[i - 1].entry == node->entry) {
+          return checker->loop_vars[i - 1].range;
+        }
+      }
+      break;
+    case PLX_NODE_ADD:
+    case PLX_NODE_SUB:
+    case PLX_NODE_MUL:
+    case PLX_NODE_DIV:
+    case PLX_NODE_REM:
+    case PLX_NODE_AND:
+    case PLX_NODE_RSHIFT: {
+      const struct plx_node *left, *right;
+      plx_extract_children(node, &left, &right);
+      const struct plx_value_range a = plx_expr_range(checker, left);
+      const struct plx_value_range b = plx_expr_range(checker, right);
+      switch (node->kind) {
+        case PLX_NODE_ADD:
+          range.known = a.known && b.known &&
+                        plx_checked_add(a.min, b.min, &range.min) &&
+                        plx_checked_add(a.max, b.max, &range.max);
+          break;
+        case PLX_NODE_SUB:
+          range.known = a.known && b.known &&
+                        plx_checked_sub(a.min, b.max, &range.min) &&
+                        plx_checked_sub(a.max, b.min, &range.max);
+          break;
+        case PLX_NODE_MUL:
+          range.known = a.known && b.known && a.min >= 0 && b.min >= 0 &&
+                        plx_checked_mul(a.min, b.min, &range.min) &&
+                        plx_checked_mul(a.max, b.max, &range.max);
+          break;
+        case PLX_NODE_DIV:
+          if (a.known && b.known && a.min >= 0 && b.min > 0) {
+            range = (struct plx_value_range){true, a.min / b.max,
+                                             a.max / b.min};
+          }
+          break;
+        case PLX_NODE_REM:
+          // The remainder is smaller than the divisor and has the sign of the
+          // dividend.
+          if (!b.known || b.min <= 0) break;
+          if (a.known && a.min >= 0) {
+            range = (struct plx_value_range){
+                true, 0, a.max < b.max - 1 ? a.max : b.max - 1};
+          } else if (plx_is_uint_type(node->type)) {
+            range = (struct plx_value_range){true, 0, b.max - 1};
+          } else {
+            range = (struct plx_value_range){true, -(b.max - 1), b.max - 1};
+          }
+          break;
+        case PLX_NODE_AND:
+          // The result is no greater than a non-negative operand.
+          if (a.known && a.min >= 0) {
+            range = (struct plx_value_range){true, 0, a.max};
+          }
+          if (b.known && b.min >= 0 && (!range.known || b.max < range.max)) {
+            range = (struct plx_value_range){true, 0, b.max};
+          }
+          break;
+        case PLX_NODE_RSHIFT:
+          if (a.known && b.known && a.min >= 0 && b.min >= 0 && b.max < 64) {
+            range = (struct plx_value_range){true, a.min >> b.max,
+                                             a.max >> b.min};
+          }
+          break;
+        default:
+          break;
+      }
+      break;
+    }
+    default:
+      break;
+  }
+  return plx_clamp_range(range, node->type);
+}
+
+// Adds the range of a loop variable.
+static void plx_push_loop_var(struct plx_bounds_checker* const checker,
+                              const struct plx_symbol_table_entry* const entry,
+                              const struct plx_value_range range) {
+  if (checker->len == checker->cap) {
+    checker->cap = checker->cap == 0 ? 8 : checker->cap * 2;
+    checker->loop_vars = realloc(checker->loop_vars,
+                                 checker->cap * sizeof(*checker->loop_vars));
+    if (plx_unlikely(checker->loop_vars == NULL)) plx_oom();
+  }
+  checker->loop_vars[checker->len++] =
+      (struct plx_loop_var_range){entry, range};
+}
+
+static void plx_check_bounds(struct plx_node* const node,
+                             struct plx_bounds_checker* const checker) {
+  switch (node->kind) {
+    case PLX_NODE_FUNC_DEF: {
+      const struct plx_node* const name = node->children;
+      checker->checks = 0;
+      checker->elided = 0;
+      for (struct plx_node* child = node->children; child != NULL;
+           child = child->next) {
+        plx_check_bounds(child, checker);
+      }
+      if (checker->report != NULL && checker->checks > 0) {
+        fprintf(checker->report, "%s: %zu of %zu bounds checks elided\n",
+                name->name, checker->elided, checker->checks);
+      }
+      break;
+    }
+    case PLX_NODE_FOR_LOOP: {
+      struct plx_node *name, *iterable, *body;
+      plx_extract_children(node, &name, &iterable, &body);
+      plx_check_bounds(iterable, checker);
+
+      // The counter runs from the start of the range to one less than its end.
+      // The loop variable cannot be assigned, but could be written through a
+      // reference.
+      struct plx_value_range range = plx_unknown_range;
+      if (iterable->kind == PLX_NODE_RANGE && !name->entry->referenced) {
+        const struct plx_value_range start =
+            plx_expr_range(checker, iterable->children);
+        const struct plx_value_range end =
+            plx_expr_range(checker, iterable->children->next);
+        if (start.known && end.known && end.max != LLONG_MIN) {
+          range = (struct plx_value_range){
+              true, start.min,
+              end.max - 1 > start.min ? end.max - 1 : start.min};
+        }
+      }
+      plx_push_loop_var(checker, name->entry, range);
+      plx_check_bounds(body, checker);
+      --checker->len;
+      break;
+    }
+    case PLX_NODE_INDEX: {
+      struct plx_node *value, *index;
+      plx_extract_children(node, &value, &index);
+      plx_check_bounds(value, checker);
+      plx_check_bounds(index, checker);
+      if (value->type->kind != PLX_NODE_ARRAY_TYPE) break;
+
+      // Signed indices are compared as unsigned, which makes negative indices
+      // out of bounds too.
+      ++checker->checks;
+      const unsigned long long len = value->type->children->uint;
+      if (checker->mode == PLX_BOUNDS_CHECKS_ELIDED) {
+        const struct plx_value_range range = plx_expr_range(checker, index);
+        if (range.known && range.min >= 0 &&
+            (unsigned long long)range.max < len) {
+          ++checker->elided;
+          break;
+        }
+      }
+      struct plx_node* const check =
+          plx_new_node(PLX_NODE_BOUNDS_CHECK, &index->loc);
+      check->uint = len;
+      check->type = index->type;
+      check->children = index;
+      value->next = check;
+      break;
+    }
+    default:
+      for (struct plx_node* child = node->children; child != NULL;
+           child = child->next) {
+        plx_check_bounds(child, checker);
+      }
+  }
+}
+
+void plx_insert_bounds_checks(struct plx_node* const module,
+                              const enum plx_bounds_checks mode,
+                              FILE* const report) {
+  if (mode == PLX_BOUNDS_CHECKS_OFF) return;
+  struct plx_bounds_checker checker = {mode, report, 0, 0, NULL, 0, 0};
+  plx_check_bounds(module, &checker);
+  free(checker.loop_vars);
+}
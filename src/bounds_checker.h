@@ -0,0 +1,31 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_BOUNDS_CHECKER_H
+#define PLX_BOUNDS_CHECKER_H
+
+#include <stdio.h>
+
+#include "ast.h"
+#include "compiler.h"
+
+// Inserts bounds checks on the indices of arrays in the abstract syntax tree.
+// If the mode is `PLX_BOUNDS_CHECKS_ELIDED`, the checks that a value range
+// analysis proves redundant are left out. The number of checks in each
+// function and how many of them were elided are written to `report` unless it
+// is `NULL`.
+void plx_insert_bounds_checks(struct plx_node* module,
+                              enum plx_bounds_checks mode, FILE* report);
+
+#endif  // PLX_BOUNDS_CHECKER_H
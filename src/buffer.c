@@ -0,0 +1,99 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "buffer.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "macros.h"
+
+void plx_buffer_free(struct plx_buffer* const buffer) {
+  free(buffer->data);
+  *buffer = PLX_BUFFER_INIT;
+}
+
+void plx_buffer_reserve(struct plx_buffer* const buffer, const size_t len) {
+  assert(buffer->len <= buffer->cap);
+  if (plx_likely(buffer->cap - buffer->len >= len)) return;
+  size_t cap = buffer->cap * 2;
+  if (plx_unlikely(cap == 0)) cap = 4096;
+  while (cap - buffer->len < len) cap *= 2;
+  void* const data = realloc(buffer->data, cap);
+  if (plx_unlikely(data == NULL)) plx_oom();
+  buffer->cap = cap;
+  buffer->data = data;
+}
+
+void plx_buffer_append(struct plx_buffer* const buffer, const void* const data,
+                       const size_t len) {
+  plx_buffer_reserve(buffer, len);
+  memcpy(&buffer->data[buffer->len], data, len);
+  buffer->len += len;
+}
+
+void plx_buffer_append_char(struct plx_buffer* const buffer, const char c) {
+  plx_buffer_reserve(buffer, 1);
+  buffer->data[buffer->len++] = c;
+}
+
+void plx_buffer_append_str(struct plx_buffer* const buffer,
+                           const char* const str) {
+  plx_buffer_append(buffer, str, strlen(str));
+}
+
+void plx_buffer_append_ull(struct plx_buffer* const buffer,
+                           unsigned long long value) {
+  // Write the digits backwards into a scratch buffer that fits the largest
+  // 64-bit value.
+  char digits[20];
+  size_t i = sizeof(digits);
+  do {
+    digits[--i] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  plx_buffer_append(buffer, &digits[i], sizeof(digits) - i);
+}
+
+void plx_buffer_append_ll(struct plx_buffer* const buffer,
+                          const long long value) {
+  if (value < 0) {
+    plx_buffer_append_char(buffer, '-');
+    // Negate as unsigned so that the minimum value doesn't overflow.
+    plx_buffer_append_ull(buffer, 0ULL - (unsigned long long)value);
+    return;
+  }
+  plx_buffer_append_ull(buffer, (unsigned long long)value);
+}
+
+void plx_buffer_append_f(struct plx_buffer* const buffer, const double value) {
+  const int len = snprintf(NULL, 0, "%f", value);
+  assert(len >= 0);
+  plx_buffer_reserve(buffer, (size_t)len + 1);
+  snprintf(&buffer->data[buffer->len], (size_t)len + 1, "%f", value);
+  buffer->len += (size_t)len;
+}
+
+bool plx_buffer_write_file(const struct plx_buffer* const buffer,
+                           const char* const filename) {
+  FILE* const stream = fopen(filename, "wb");
+  if (plx_unlikely(stream == NULL)) return false;
+  // Write the buffer in one call, which bypasses the stream's own buffering.
+  const bool result =
+      fwrite(buffer->data, sizeof(char), buffer->len, stream) == buffer->len;
+  return fclose(stream) == 0 && result;
+}
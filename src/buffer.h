@@ -0,0 +1,60 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_BUFFER_H
+#define PLX_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Growable output buffer.
+struct plx_buffer {
+  size_t cap;
+  size_t len;
+  char* data;
+};
+
+#define PLX_BUFFER_INIT ((struct plx_buffer){0, 0, NULL})
+
+// Frees the memory used by a buffer.
+void plx_buffer_free(struct plx_buffer* buffer);
+
+// Ensures that the buffer has room for at least `len` more bytes.
+void plx_buffer_reserve(struct plx_buffer* buffer, size_t len);
+
+// Appends bytes to the buffer.
+void plx_buffer_append(struct plx_buffer* buffer, const void* data, size_t len);
+
+// Appends a character to the buffer.
+void plx_buffer_append_char(struct plx_buffer* buffer, char c);
+
+// Appends a null-terminated string to the buffer.
+void plx_buffer_append_str(struct plx_buffer* buffer, const char* str);
+
+// Appends an unsigned integer to the buffer in decimal.
+void plx_buffer_append_ull(struct plx_buffer* buffer, unsigned long long value);
+
+// Appends a signed integer to the buffer in decimal.
+void plx_buffer_append_ll(struct plx_buffer* buffer, long long value);
+
+// Appends a floating point number to the buffer in decimal, with six digits
+// after the decimal point.
+void plx_buffer_append_f(struct plx_buffer* buffer, double value);
+
+// Writes the contents of the buffer to a file, replacing it. Returns whether
+// the write succeeded.
+bool plx_buffer_write_file(const struct plx_buffer* buffer,
+                           const char* filename);
+
+#endif  // PLX_BUFFER_H
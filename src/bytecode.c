@@ -0,0 +1,139 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bytecode.h"
+
+#include <stdlib.h>
+
+// Names and operand formats of the opcodes.
+#define PLX_BYTECODE_OP_INFO(name, format) \
+  {#name, PLX_BYTECODE_FORMAT_##format},
+
+static const struct {
+  const char* name;
+  enum plx_bytecode_format format;
+} plx_bytecode_op_info[] = {PLX_BYTECODE_OPS(PLX_BYTECODE_OP_INFO)};
+
+#undef PLX_BYTECODE_OP_INFO
+
+void plx_bytecode_program_free(struct plx_bytecode_program* const program) {
+  free(program->insts);
+  free(program->consts);
+  free(program->funcs);
+  plx_buffer_free(&program->globals);
+}
+
+// Appends a register operand.
+static void plx_disassemble_bytecode_reg(struct plx_buffer* const buffer,
+                                         const unsigned int reg) {
+  plx_buffer_append_char(buffer, 'r');
+  plx_buffer_append_ull(buffer, reg);
+}
+
+// Appends an opcode name in lower case.
+static void plx_disassemble_bytecode_op(struct plx_buffer* const buffer,
+                                        const enum plx_bytecode_op op) {
+  for (const char* c = plx_bytecode_op_info[op].name; *c != '\0'; ++c) {
+    plx_buffer_append_char(
+        buffer, *c >= 'A' && *c <= 'Z' ? (char)(*c - 'A' + 'a') : *c);
+  }
+}
+
+void plx_disassemble_bytecode(const struct plx_bytecode_program* const program,
+                              struct plx_buffer* const buffer) {
+  for (size_t i = 0; i < program->const_count; ++i) {
+    plx_buffer_append_char(buffer, 'k');
+    plx_buffer_append_ull(buffer, i);
+    plx_buffer_append_str(buffer, " = ");
+    plx_buffer_append_ll(buffer, program->consts[i].s);
+    plx_buffer_append_char(buffer, '\n');
+  }
+
+  for (size_t func_index = 0; func_index < program->func_count;
+       ++func_index) {
+    const struct plx_bytecode_func* const func = &program->funcs[func_index];
+    const size_t end = func_index + 1 < program->func_count
+                           ? program->funcs[func_index + 1].start
+                           : program->inst_count;
+    if (buffer->len > 0) plx_buffer_append_char(buffer, '\n');
+    plx_buffer_append_str(buffer, "func ");
+    plx_buffer_append_str(buffer, func->name);
+    plx_buffer_append_str(buffer, " (params: ");
+    plx_buffer_append_ull(buffer, func->param_count);
+    plx_buffer_append_str(buffer, ", registers: ");
+    plx_buffer_append_ull(buffer, func->reg_count);
+    plx_buffer_append_str(buffer, ", frame: ");
+    plx_buffer_append_ull(buffer, func->frame_size);
+    plx_buffer_append_str(buffer, ")\n");
+
+    for (size_t i = func->start; i < end; ++i) {
+      const struct plx_bytecode_inst* const inst = &program->insts[i];
+      plx_buffer_append_str(buffer, "  ");
+      plx_buffer_append_ull(buffer, i);
+      plx_buffer_append_str(buffer, "\t");
+      plx_disassemble_bytecode_op(buffer, inst->op);
+      switch (plx_bytecode_op_info[inst->op].format) {
+        case PLX_BYTECODE_FORMAT_NONE:
+          break;
+        case PLX_BYTECODE_FORMAT_A:
+          plx_buffer_append_char(buffer, ' ');
+          plx_disassemble_bytecode_reg(buffer, inst->a);
+          break;
+        case PLX_BYTECODE_FORMAT_AB:
+          plx_buffer_append_char(buffer, ' ');
+          plx_disassemble_bytecode_reg(buffer, inst->a);
+          plx_buffer_append_str(buffer, ", ");
+          plx_disassemble_bytecode_reg(buffer, inst->b);
+          break;
+        case PLX_BYTECODE_FORMAT_ABC:
+          plx_buffer_append_char(buffer, ' ');
+          plx_disassemble_bytecode_reg(buffer, inst->a);
+          plx_buffer_append_str(buffer, ", ");
+          plx_disassemble_bytecode_reg(buffer, inst->b);
+          plx_buffer_append_str(buffer, ", ");
+          plx_disassemble_bytecode_reg(buffer, inst->c);
+          break;
+        case PLX_BYTECODE_FORMAT_AI:
+          plx_buffer_append_char(buffer, ' ');
+          plx_disassemble_bytecode_reg(buffer, inst->a);
+          plx_buffer_append_str(buffer, ", ");
+          plx_buffer_append_ll(buffer, inst->imm);
+          break;
+        case PLX_BYTECODE_FORMAT_AK:
+          plx_buffer_append_char(buffer, ' ');
+          plx_disassemble_bytecode_reg(buffer, inst->a);
+          plx_buffer_append_str(buffer, ", k");
+          plx_buffer_append_ll(buffer, inst->imm);
+          break;
+        case PLX_BYTECODE_FORMAT_AF:
+          plx_buffer_append_char(buffer, ' ');
+          plx_disassemble_bytecode_reg(buffer, inst->a);
+          plx_buffer_append_str(buffer, ", ");
+          plx_buffer_append_str(buffer, program->funcs[inst->imm].name);
+          break;
+        case PLX_BYTECODE_FORMAT_J:
+          plx_buffer_append_char(buffer, ' ');
+          plx_buffer_append_ll(buffer, inst->imm);
+          break;
+        case PLX_BYTECODE_FORMAT_AJ:
+          plx_buffer_append_char(buffer, ' ');
+          plx_disassemble_bytecode_reg(buffer, inst->a);
+          plx_buffer_append_str(buffer, ", ");
+          plx_buffer_append_ll(buffer, inst->imm);
+          break;
+      }
+      plx_buffer_append_char(buffer, '\n');
+    }
+  }
+}
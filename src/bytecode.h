@@ -0,0 +1,234 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_BYTECODE_H
+#define PLX_BYTECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "buffer.h"
+
+// Operand formats of bytecode instructions.
+enum plx_bytecode_format {
+  // No operands.
+  PLX_BYTECODE_FORMAT_NONE,
+  // Register a.
+  PLX_BYTECODE_FORMAT_A,
+  // Registers a and b.
+  PLX_BYTECODE_FORMAT_AB,
+  // Registers a, b and c.
+  PLX_BYTECODE_FORMAT_ABC,
+  // Register a and an immediate.
+  PLX_BYTECODE_FORMAT_AI,
+  // Register a and a constant index.
+  PLX_BYTECODE_FORMAT_AK,
+  // Register a and a function index.
+  PLX_BYTECODE_FORMAT_AF,
+  // Jump target.
+  PLX_BYTECODE_FORMAT_J,
+  // Register a and a jump target.
+  PLX_BYTECODE_FORMAT_AJ,
+};
+
+// Opcodes of operations on each numeric type, in the order of the type
+// indices.
+#define PLX_BYTECODE_NUMERIC_OPS(X, name, format) \
+  X(name##_S8, format)                            \
+  X(name##_S16, format)                           \
+  X(name##_S32, format)                           \
+  X(name##_S64, format)                           \
+  X(name##_U8, format)                            \
+  X(name##_U16, format)                           \
+  X(name##_U32, format)                           \
+  X(name##_U64, format)                           \
+  X(name##_F32, format)                           \
+  X(name##_F64, format)
+
+// Opcodes of operations on each integer type, in the order of the type
+// indices.
+#define PLX_BYTECODE_INT_OPS(X, name, format) \
+  X(name##_S8, format)                        \
+  X(name##_S16, format)                       \
+  X(name##_S32, format)                       \
+  X(name##_S64, format)                       \
+  X(name##_U8, format)                        \
+  X(name##_U16, format)                       \
+  X(name##_U32, format)                       \
+  X(name##_U64, format)
+
+// Opcodes and their operand formats.
+//
+// Registers hold integers sign or zero extended to 64 bits, booleans as zero
+// or one, `f32` values as floats, references as pointers and functions as one
+// more than their indices, so that zero is no function. Typed arithmetic wraps
+// to the width of its type.
+//
+// MOV: a = b
+// CONST: a = immediate
+// CONST_K: a = constant
+// FUNC: a = function
+// LOCAL_ADDR, GLOBAL_ADDR: a = address of the frame or globals at an offset
+// ELEM_ADDR_n: a = b + c * n
+// LOAD_*: a = *b
+// STORE_*: *a = b
+// Binary operations: a = b op c, where comparisons are unsigned for unsigned
+//   integers, booleans, references and functions, and GT and GTE are LT and
+//   LTE with b and c swapped
+// Unary operations: a = op b
+// JUMP_IF_FALSE: jumps if a is false
+// CHECK_INDEX: traps unless a is less than b as unsigned integers
+// CALL, CALL_INDIRECT: calls the function, or the function in b, with the
+//   arguments in a and the registers after it, leaving the result in a
+// TAIL_CALL, TAIL_CALL_INDIRECT: like CALL and CALL_INDIRECT, but the callee
+//   replaces the current call and returns to its caller
+// RET: returns a
+#define PLX_BYTECODE_OPS(X)             \
+  X(NOP, NONE)                          \
+  X(MOV, AB)                            \
+  X(CONST, AI)                          \
+  X(CONST_K, AK)                        \
+  X(FUNC, AF)                           \
+  X(LOCAL_ADDR, AI)                     \
+  X(GLOBAL_ADDR, AI)                    \
+  X(ELEM_ADDR_1, ABC)                   \
+  X(ELEM_ADDR_2, ABC)                   \
+  X(ELEM_ADDR_4, ABC)                   \
+  X(ELEM_ADDR_8, ABC)                   \
+  X(LOAD_S8, AB)                        \
+  X(LOAD_S16, AB)                       \
+  X(LOAD_S32, AB)                       \
+  X(LOAD_U8, AB)                        \
+  X(LOAD_U16, AB)                       \
+  X(LOAD_U32, AB)                       \
+  X(LOAD_64, AB)                        \
+  X(LOAD_F32, AB)                       \
+  X(STORE_8, AB)                        \
+  X(STORE_16, AB)                       \
+  X(STORE_32, AB)                       \
+  X(STORE_64, AB)                       \
+  X(STORE_F32, AB)                      \
+  PLX_BYTECODE_NUMERIC_OPS(X, ADD, ABC) \
+  PLX_BYTECODE_NUMERIC_OPS(X, SUB, ABC) \
+  PLX_BYTECODE_NUMERIC_OPS(X, MUL, ABC) \
+  PLX_BYTECODE_NUMERIC_OPS(X, DIV, ABC) \
+  PLX_BYTECODE_INT_OPS(X, REM, ABC)     \
+  PLX_BYTECODE_INT_OPS(X, SHL, ABC)     \
+  PLX_BYTECODE_INT_OPS(X, SHR, ABC)     \
+  X(AND, ABC)                           \
+  X(OR, ABC)                            \
+  X(XOR, ABC)                           \
+  PLX_BYTECODE_NUMERIC_OPS(X, NEG, AB)  \
+  PLX_BYTECODE_INT_OPS(X, NOT, AB)      \
+  X(NOT_BOOL, AB)                       \
+  X(EQ, ABC)                            \
+  X(EQ_F32, ABC)                        \
+  X(EQ_F64, ABC)                        \
+  X(NEQ, ABC)                           \
+  X(NEQ_F32, ABC)                       \
+  X(NEQ_F64, ABC)                       \
+  X(LT_S, ABC)                          \
+  X(LT_U, ABC)                          \
+  X(LT_F32, ABC)                        \
+  X(LT_F64, ABC)                        \
+  X(LTE_S, ABC)                         \
+  X(LTE_U, ABC)                         \
+  X(LTE_F32, ABC)                       \
+  X(LTE_F64, ABC)                       \
+  X(JUMP, J)                            \
+  X(JUMP_IF_FALSE, AJ)                  \
+  X(CHECK_INDEX, AB)                    \
+  X(CALL, AF)                           \
+  X(CALL_INDIRECT, AB)                  \
+  X(TAIL_CALL, AF)                      \
+  X(TAIL_CALL_INDIRECT, AB)             \
+  X(RET, A)                             \
+  X(RET_VOID, NONE)                     \
+  X(UNREACHABLE, NONE)
+
+#define PLX_BYTECODE_OP_ENUM(name, format) PLX_BYTECODE_OP_##name,
+
+enum plx_bytecode_op { PLX_BYTECODE_OPS(PLX_BYTECODE_OP_ENUM) };
+
+#undef PLX_BYTECODE_OP_ENUM
+
+// Instruction of eight bytes: an opcode and up to three 16-bit register
+// operands, or a register and a 32-bit immediate.
+struct plx_bytecode_inst {
+  uint8_t op;
+  uint16_t a;
+  union {
+    struct {
+      uint16_t b;
+      uint16_t c;
+    };
+    int32_t imm;
+  };
+};
+
+// Value of a register or constant.
+union plx_bytecode_value {
+  int64_t s;
+  uint64_t u;
+  float f32;
+  double f64;
+  void* ptr;
+};
+
+struct plx_bytecode_func {
+  const char* name;
+
+  // Index of the first instruction.
+  size_t start;
+
+  // Number of parameters, which arrive in the first registers.
+  unsigned int param_count;
+
+  // Number of registers, counting the parameters.
+  unsigned int reg_count;
+
+  // Size in bytes of the memory of a call, which holds the variables whose
+  // addresses are taken.
+  size_t frame_size;
+};
+
+// Compiled module.
+struct plx_bytecode_program {
+  size_t inst_count;
+  size_t inst_cap;
+  struct plx_bytecode_inst* insts;
+
+  size_t const_count;
+  size_t const_cap;
+  union plx_bytecode_value* consts;
+
+  size_t func_count;
+  size_t func_cap;
+  struct plx_bytecode_func* funcs;
+
+  // Initial contents of the globals.
+  struct plx_buffer globals;
+};
+
+#define PLX_BYTECODE_PROGRAM_INIT                                    \
+  ((struct plx_bytecode_program){0, 0, NULL, 0, 0, NULL, 0, 0, NULL, \
+                                 PLX_BUFFER_INIT})
+
+void plx_bytecode_program_free(struct plx_bytecode_program* program);
+
+// Appends a listing of the program's functions and instructions to the buffer.
+void plx_disassemble_bytecode(const struct plx_bytecode_program* program,
+                              struct plx_buffer* buffer);
+
+#endif  // PLX_BYTECODE_H
@@ -0,0 +1,1180 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bytecode_generator.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "macros.h"
+#include "source_code_printer.h"
+#include "symbol_table_entry.h"
+#include "types.h"
+
+// Label that jumps are patched to once it is placed.
+#define PLX_BYTECODE_NO_INST SIZE_MAX
+
+struct plx_bytecode_generator {
+  struct plx_bytecode_program* program;
+
+  // Next free register, and the number of registers that the function being
+  // generated uses.
+  unsigned int reg_top;
+  unsigned int reg_count;
+
+  // Size in bytes of the frame of the function being generated.
+  size_t frame_size;
+
+  // Instruction that last wrote a temporary to its register a, which a move
+  // can retarget instead, or `PLX_BYTECODE_NO_INST`.
+  size_t last_def;
+
+  // Instruction indices of the labels.
+  size_t label_count;
+  size_t label_cap;
+  size_t* label_offsets;
+
+  // Jumps whose immediates are labels until the function is finished.
+  size_t jump_count;
+  size_t jump_cap;
+  size_t* jumps;
+
+  // Labels that `continue` and `break` jump to in the innermost loop.
+  size_t continue_label;
+  size_t break_label;
+};
+
+// Grows an array so that it has room for at least `len` elements.
+static void* plx_bytecode_reserve(void* const data, size_t* const cap,
+                                  const size_t len, const size_t size) {
+  if (plx_likely(len <= *cap)) return data;
+  size_t new_cap = *cap == 0 ? 16 : *cap * 2;
+  while (new_cap < len) new_cap *= 2;
+  void* const new_data = realloc(data, new_cap * size);
+  if (plx_unlikely(new_data == NULL)) plx_oom();
+  *cap = new_cap;
+  return new_data;
+}
+
+// Returns the size of a type in bytes.
+static size_t plx_bytecode_type_size(const struct plx_node* const type) {
+  switch (type->kind) {
+    case PLX_NODE_S8_TYPE:
+    case PLX_NODE_U8_TYPE:
+    case PLX_NODE_BOOL_TYPE:
+      return 1;
+    case PLX_NODE_S16_TYPE:
+    case PLX_NODE_U16_TYPE:
+      return 2;
+    case PLX_NODE_S32_TYPE:
+    case PLX_NODE_U32_TYPE:
+    case PLX_NODE_F32_TYPE:
+      return 4;
+    case PLX_NODE_S64_TYPE:
+    case PLX_NODE_U64_TYPE:
+    case PLX_NODE_F64_TYPE:
+    case PLX_NODE_REF_TYPE:
+    case PLX_NODE_FUNC_TYPE:
+      return 8;
+    case PLX_NODE_ARRAY_TYPE: {
+      const struct plx_node *len, *element_type;
+      plx_extract_children(type, &len, &element_type);
+      return len->uint * plx_bytecode_type_size(element_type);
+    }
+    default:
+      assert(false);
+  }
+  return 0;
+}
+
+// Returns the alignment of a type in bytes.
+static size_t plx_bytecode_type_align(const struct plx_node* const type) {
+  if (type->kind == PLX_NODE_ARRAY_TYPE) {
+    const struct plx_node *len, *element_type;
+    plx_extract_children(type, &len, &element_type);
+    return plx_bytecode_type_align(element_type);
+  }
+  return plx_bytecode_type_size(type);
+}
+
+// Returns the index of a type in the groups of typed opcodes. Booleans,
+// references and functions are treated as unsigned 64-bit integers.
+static unsigned int plx_bytecode_type_index(
+    const struct plx_node* const type) {
+  switch (type->kind) {
+    case PLX_NODE_S8_TYPE:
+      return 0;
+    case PLX_NODE_S16_TYPE:
+      return 1;
+    case PLX_NODE_S32_TYPE:
+      return 2;
+    case PLX_NODE_S64_TYPE:
+      return 3;
+    case PLX_NODE_U8_TYPE:
+      return 4;
+    case PLX_NODE_U16_TYPE:
+      return 5;
+    case PLX_NODE_U32_TYPE:
+      return 6;
+    case PLX_NODE_U64_TYPE:
+    case PLX_NODE_BOOL_TYPE:
+    case PLX_NODE_REF_TYPE:
+    case PLX_NODE_FUNC_TYPE:
+      return 7;
+    case PLX_NODE_F32_TYPE:
+      return 8;
+    case PLX_NODE_F64_TYPE:
+      return 9;
+    default:
+      assert(false);
+  }
+  return 0;
+}
+
+// Returns whether the interpreter supports a type.
+static bool plx_is_bytecode_type(const struct plx_node* const type) {
+  switch (type->kind) {
+    case PLX_NODE_VOID_TYPE:
+    case PLX_NODE_S8_TYPE:
+    case PLX_NODE_S16_TYPE:
+    case PLX_NODE_S32_TYPE:
+    case PLX_NODE_S64_TYPE:
+    case PLX_NODE_U8_TYPE:
+    case PLX_NODE_U16_TYPE:
+    case PLX_NODE_U32_TYPE:
+    case PLX_NODE_U64_TYPE:
+    case PLX_NODE_F32_TYPE:
+    case PLX_NODE_F64_TYPE:
+    case PLX_NODE_BOOL_TYPE:
+    case PLX_NODE_REF_TYPE:
+      return true;
+    case PLX_NODE_FUNC_TYPE: {
+      // Parameters and results are passed in registers.
+      const struct plx_node* const param_types = type->children;
+      for (const struct plx_node* param_type = param_types->children;
+           param_type != NULL; param_type = param_type->next) {
+        if (!plx_is_scalar_type(param_type)) return false;
+      }
+      const struct plx_node* const return_type = param_types->next;
+      return return_type->kind == PLX_NODE_VOID_TYPE ||
+             plx_is_scalar_type(return_type);
+    }
+    case PLX_NODE_ARRAY_TYPE: {
+      const struct plx_node *len, *element_type;
+      plx_extract_children(type, &len, &element_type);
+      return plx_is_bytecode_type(element_type);
+    }
+    default:
+      return false;
+  }
+}
+
+// Reports values and variables whose types the interpreter does not support,
+// such as slices, strings and structs, and copies of arrays.
+static bool plx_check_bytecode(const struct plx_node* const node) {
+  if (node->kind == PLX_NODE_STRUCT_DEF) return true;
+  // Loads and stores move a single register, so arrays are only accessed by
+  // element.
+  if ((node->kind == PLX_NODE_VAR_DEF || node->kind == PLX_NODE_ASSIGN) &&
+      node->children->next->type != NULL &&
+      node->children->next->type->kind == PLX_NODE_ARRAY_TYPE) {
+    plx_error("array copy not supported by the bytecode interpreter");
+    plx_print_source_code(
+        &node->loc,
+        /*annotation=*/"compile this statement with the `llvm` back end",
+        PLX_SOURCE_ANNOTATION_ERROR);
+    return false;
+  }
+  const struct plx_node* const type =
+      node->kind == PLX_NODE_IDENTIFIER && node->entry != NULL
+          ? node->entry->type
+          : node->type;
+  if (type != NULL && !plx_is_bytecode_type(type)) {
+    plx_error("type not supported by the bytecode interpreter");
+    plx_print_source_code(
+        &node->loc,
+        /*annotation=*/"compile this expression with the `llvm` back end",
+        PLX_SOURCE_ANNOTATION_ERROR);
+    return false;
+  }
+  bool result = true;
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    if (!plx_check_bytecode(child)) result = false;
+  }
+  return result;
+}
+
+// Returns whether a symbol names a function.
+static bool plx_is_bytecode_func(
+    const struct plx_symbol_table_entry* const entry) {
+  return entry->scope == PLX_SYMBOL_SCOPE_GLOBAL &&
+         entry->mutability == PLX_SYMBOL_MUTABILITY_CONST &&
+         entry->type->kind == PLX_NODE_FUNC_TYPE;
+}
+
+// Returns whether a variable is kept in a register rather than in the frame.
+static bool plx_is_bytecode_reg_var(
+    const struct plx_symbol_table_entry* const entry) {
+  return entry->scope == PLX_SYMBOL_SCOPE_LOCAL && !entry->referenced &&
+         plx_is_scalar_type(entry->type);
+}
+
+// ---------------------------------------------------------------------------
+// Instructions
+// ---------------------------------------------------------------------------
+
+// Allocates consecutive registers, returning the first.
+static unsigned int plx_bytecode_new_regs(
+    struct plx_bytecode_generator* const gen, const unsigned int count) {
+  const unsigned int reg = gen->reg_top;
+  gen->reg_top += count;
+  if (gen->reg_top > gen->reg_count) gen->reg_count = gen->reg_top;
+  return reg;
+}
+
+static unsigned int plx_bytecode_new_reg(
+    struct plx_bytecode_generator* const gen) {
+  return plx_bytecode_new_regs(gen, 1);
+}
+
+// Allocates memory in the frame, returning its offset.
+static size_t plx_bytecode_new_slot(struct plx_bytecode_generator* const gen,
+                                    const size_t size, const size_t align) {
+  const size_t offset = (gen->frame_size + align - 1) / align * align;
+  gen->frame_size = offset + size;
+  return offset;
+}
+
+static struct plx_bytecode_inst* plx_bytecode_emit(
+    struct plx_bytecode_generator* const gen, const enum plx_bytecode_op op,
+    const unsigned int a) {
+  struct plx_bytecode_program* const program = gen->program;
+  program->insts =
+      plx_bytecode_reserve(program->insts, &program->inst_cap,
+                           program->inst_count + 1, sizeof(*program->insts));
+  struct plx_bytecode_inst* const inst =
+      &program->insts[program->inst_count++];
+  memset(inst, 0, sizeof(*inst));
+  inst->op = (uint8_t)op;
+  inst->a = (uint16_t)a;
+  return inst;
+}
+
+// Emits an instruction that writes a new temporary, returning it.
+static unsigned int plx_bytecode_emit_def(
+    struct plx_bytecode_generator* const gen, const enum plx_bytecode_op op,
+    const unsigned int b, const unsigned int c) {
+  const unsigned int dst = plx_bytecode_new_reg(gen);
+  struct plx_bytecode_inst* const inst = plx_bytecode_emit(gen, op, dst);
+  inst->b = (uint16_t)b;
+  inst->c = (uint16_t)c;
+  gen->last_def = gen->program->inst_count - 1;
+  return dst;
+}
+
+// Emits an instruction with an immediate that writes a new temporary,
+// returning it.
+static unsigned int plx_bytecode_emit_def_imm(
+    struct plx_bytecode_generator* const gen, const enum plx_bytecode_op op,
+    const long long imm) {
+  const unsigned int dst = plx_bytecode_new_reg(gen);
+  plx_bytecode_emit(gen, op, dst)->imm = (int32_t)imm;
+  gen->last_def = gen->program->inst_count - 1;
+  return dst;
+}
+
+// Loads a constant into a new temporary. Integers that fit in 32 bits are
+// immediates, and other values go in the constant pool.
+static unsigned int plx_bytecode_const(
+    struct plx_bytecode_generator* const gen, const bool is_int,
+    const union plx_bytecode_value value) {
+  if (is_int && value.s >= INT32_MIN && value.s <= INT32_MAX) {
+    return plx_bytecode_emit_def_imm(gen, PLX_BYTECODE_OP_CONST, value.s);
+  }
+  struct plx_bytecode_program* const program = gen->program;
+  program->consts =
+      plx_bytecode_reserve(program->consts, &program->const_cap,
+                           program->const_count + 1, sizeof(*program->consts));
+  program->consts[program->const_count] = value;
+  return plx_bytecode_emit_def_imm(gen, PLX_BYTECODE_OP_CONST_K,
+                                   (long long)program->const_count++);
+}
+
+static unsigned int plx_bytecode_int(struct plx_bytecode_generator* const gen,
+                                     const long long value) {
+  union plx_bytecode_value constant;
+  constant.s = value;
+  return plx_bytecode_const(gen, /*is_int=*/true, constant);
+}
+
+// Moves a value into a register. If the value is a temporary at or above
+// `temp_base` that was just computed, the instruction that computed it writes
+// the register instead.
+static void plx_bytecode_move(struct plx_bytecode_generator* const gen,
+                              const unsigned int dst, const unsigned int src,
+                              const unsigned int temp_base) {
+  if (src == dst) return;
+  struct plx_bytecode_program* const program = gen->program;
+  if (src >= temp_base && gen->last_def == program->inst_count - 1 &&
+      program->insts[gen->last_def].a == src) {
+    program->insts[gen->last_def].a = (uint16_t)dst;
+    gen->last_def = PLX_BYTECODE_NO_INST;
+    return;
+  }
+  plx_bytecode_emit(gen, PLX_BYTECODE_OP_MOV, dst)->b = (uint16_t)src;
+}
+
+static unsigned int plx_bytecode_load(struct plx_bytecode_generator* const gen,
+                                      const struct plx_node* const type,
+                                      const unsigned int addr) {
+  enum plx_bytecode_op op;
+  switch (type->kind) {
+    case PLX_NODE_S8_TYPE:
+      op = PLX_BYTECODE_OP_LOAD_S8;
+      break;
+    case PLX_NODE_S16_TYPE:
+      op = PLX_BYTECODE_OP_LOAD_S16;
+      break;
+    case PLX_NODE_S32_TYPE:
+      op = PLX_BYTECODE_OP_LOAD_S32;
+      break;
+    case PLX_NODE_U8_TYPE:
+    case PLX_NODE_BOOL_TYPE:
+      op = PLX_BYTECODE_OP_LOAD_U8;
+      break;
+    case PLX_NODE_U16_TYPE:
+      op = PLX_BYTECODE_OP_LOAD_U16;
+      break;
+    case PLX_NODE_U32_TYPE:
+      op = PLX_BYTECODE_OP_LOAD_U32;
+      break;
+    case PLX_NODE_F32_TYPE:
+      op = PLX_BYTECODE_OP_LOAD_F32;
+      break;
+    default:
+      op = PLX_BYTECODE_OP_LOAD_64;
+      break;
+  }
+  return plx_bytecode_emit_def(gen, op, addr, 0);
+}
+
+static void plx_bytecode_store(struct plx_bytecode_generator* const gen,
+                               const struct plx_node* const type,
+                               const unsigned int addr,
+                               const unsigned int value) {
+  enum plx_bytecode_op op;
+  switch (plx_bytecode_type_size(type)) {
+    case 1:
+      op = PLX_BYTECODE_OP_STORE_8;
+      break;
+    case 2:
+      op = PLX_BYTECODE_OP_STORE_16;
+      break;
+    case 4:
+      op = type->kind == PLX_NODE_F32_TYPE ? PLX_BYTECODE_OP_STORE_F32
+                                           : PLX_BYTECODE_OP_STORE_32;
+      break;
+    default:
+      op = PLX_BYTECODE_OP_STORE_64;
+      break;
+  }
+  plx_bytecode_emit(gen, op, addr)->b = (uint16_t)value;
+}
+
+static size_t plx_bytecode_new_label(struct plx_bytecode_generator* const gen) {
+  gen->label_offsets =
+      plx_bytecode_reserve(gen->label_offsets, &gen->label_cap,
+                           gen->label_count + 1, sizeof(*gen->label_offsets));
+  gen->label_offsets[gen->label_count] = PLX_BYTECODE_NO_INST;
+  return gen->label_count++;
+}
+
+static void plx_bytecode_label(struct plx_bytecode_generator* const gen,
+                               const size_t label) {
+  gen->label_offsets[label] = gen->program->inst_count;
+  // Values computed before the label may not be retargeted after it.
+  gen->last_def = PLX_BYTECODE_NO_INST;
+}
+
+// Emits a jump to a label, which is taken if `cond` is false unless the
+// opcode is `JUMP`.
+static void plx_bytecode_jump(struct plx_bytecode_generator* const gen,
+                              const enum plx_bytecode_op op,
+                              const unsigned int cond, const size_t label) {
+  plx_bytecode_emit(gen, op, cond)->imm = (int32_t)label;
+  gen->jumps = plx_bytecode_reserve(gen->jumps, &gen->jump_cap,
+                                    gen->jump_count + 1, sizeof(*gen->jumps));
+  gen->jumps[gen->jump_count++] = gen->program->inst_count - 1;
+}
+
+// ---------------------------------------------------------------------------
+// Lowering
+// ---------------------------------------------------------------------------
+
+static unsigned int plx_bytecode_expr(const struct plx_node* node,
+                                      struct plx_bytecode_generator* gen);
+
+// Computes the address of an element of an array, returning the register that
+// holds it.
+static unsigned int plx_bytecode_elem_addr(
+    struct plx_bytecode_generator* const gen,
+    const struct plx_node* const element_type, const unsigned int array_addr,
+    const unsigned int index) {
+  const size_t size = plx_bytecode_type_size(element_type);
+  switch (size) {
+    case 1:
+      return plx_bytecode_emit_def(gen, PLX_BYTECODE_OP_ELEM_ADDR_1,
+                                   array_addr, index);
+    case 2:
+      return plx_bytecode_emit_def(gen, PLX_BYTECODE_OP_ELEM_ADDR_2,
+                                   array_addr, index);
+    case 4:
+      return plx_bytecode_emit_def(gen, PLX_BYTECODE_OP_ELEM_ADDR_4,
+                                   array_addr, index);
+    case 8:
+      return plx_bytecode_emit_def(gen, PLX_BYTECODE_OP_ELEM_ADDR_8,
+                                   array_addr, index);
+    default: {
+      const unsigned int offset =
+          plx_bytecode_emit_def(gen, PLX_BYTECODE_OP_MUL_U64, index,
+                                plx_bytecode_int(gen, (long long)size));
+      return plx_bytecode_emit_def(gen, PLX_BYTECODE_OP_ELEM_ADDR_1,
+                                   array_addr, offset);
+    }
+  }
+}
+
+// Lowers an lvalue, returning the register that holds its address.
+static unsigned int plx_bytecode_addr(
+    const struct plx_node* const node,
+    struct plx_bytecode_generator* const gen) {
+  switch (node->kind) {
+    case PLX_NODE_INDEX: {
+      const struct plx_node *value, *index;
+      plx_extract_children(node, &value, &index);
+      const unsigned int value_addr = plx_bytecode_addr(value, gen);
+      const unsigned int index_value = plx_bytecode_expr(index, gen);
+      return plx_bytecode_elem_addr(gen, node->type, value_addr, index_value);
+    }
+    case PLX_NODE_DEREF: {
+      const struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      return plx_bytecode_expr(operand, gen);
+    }
+    case PLX_NODE_IDENTIFIER: {
+      const struct plx_symbol_table_entry* const entry = node->entry;
+      assert(!plx_is_bytecode_reg_var(entry));
+      return plx_bytecode_emit_def_imm(
+          gen,
+          entry->scope == PLX_SYMBOL_SCOPE_GLOBAL
+              ? PLX_BYTECODE_OP_GLOBAL_ADDR
+              : PLX_BYTECODE_OP_LOCAL_ADDR,
+          entry->bytecode_var);
+    }
+    default:
+      assert(false);
+  }
+  return 0;
+}
+
+// Returns the opcode of a binary operation on operands of a type. The
+// operands of GT and GTE are swapped by the caller.
+static enum plx_bytecode_op plx_bytecode_binary_op(
+    const enum plx_node_kind kind, const struct plx_node* const type) {
+  const unsigned int type_index = plx_bytecode_type_index(type);
+  const bool is_f32 = type->kind == PLX_NODE_F32_TYPE;
+  const bool is_f64 = type->kind == PLX_NODE_F64_TYPE;
+  switch (kind) {
+    case PLX_NODE_AND:
+      return PLX_BYTECODE_OP_AND;
+    case PLX_NODE_OR:
+      return PLX_BYTECODE_OP_OR;
+    case PLX_NODE_XOR:
+      return PLX_BYTECODE_OP_XOR;
+    case PLX_NODE_EQ:
+      return is_f32   ? PLX_BYTECODE_OP_EQ_F32
+             : is_f64 ? PLX_BYTECODE_OP_EQ_F64
+                      : PLX_BYTECODE_OP_EQ;
+    case PLX_NODE_NEQ:
+      return is_f32   ? PLX_BYTECODE_OP_NEQ_F32
+             : is_f64 ? PLX_BYTECODE_OP_NEQ_F64
+                      : PLX_BYTECODE_OP_NEQ;
+    case PLX_NODE_LT:
+    case PLX_NODE_GT:
+      return is_f32                    ? PLX_BYTECODE_OP_LT_F32
+             : is_f64                  ? PLX_BYTECODE_OP_LT_F64
+             : plx_is_sint_type(type) ? PLX_BYTECODE_OP_LT_S
+                                       : PLX_BYTECODE_OP_LT_U;
+    case PLX_NODE_LTE:
+    case PLX_NODE_GTE:
+      return is_f32                    ? PLX_BYTECODE_OP_LTE_F32
+             : is_f64                  ? PLX_BYTECODE_OP_LTE_F64
+             : plx_is_sint_type(type) ? PLX_BYTECODE_OP_LTE_S
+                                       : PLX_BYTECODE_OP_LTE_U;
+    case PLX_NODE_ADD:
+      return (enum plx_bytecode_op)(PLX_BYTECODE_OP_ADD_S8 + type_index);
+    case PLX_NODE_SUB:
+      return (enum plx_bytecode_op)(PLX_BYTECODE_OP_SUB_S8 + type_index);
+    case PLX_NODE_MUL:
+      return (enum plx_bytecode_op)(PLX_BYTECODE_OP_MUL_S8 + type_index);
+    case PLX_NODE_DIV:
+      return (enum plx_bytecode_op)(PLX_BYTECODE_OP_DIV_S8 + type_index);
+    case PLX_NODE_REM:
+      return (enum plx_bytecode_op)(PLX_BYTECODE_OP_REM_S8 + type_index);
+    case PLX_NODE_LSHIFT:
+      return (enum plx_bytecode_op)(PLX_BYTECODE_OP_SHL_S8 + type_index);
+    case PLX_NODE_RSHIFT:
+      return (enum plx_bytecode_op)(PLX_BYTECODE_OP_SHR_S8 + type_index);
+    default:
+      assert(false);
+  }
+  return PLX_BYTECODE_OP_NOP;
+}
+
+static unsigned int plx_bytecode_expr(
+    const struct plx_node* const node,
+    struct plx_bytecode_generator* const gen) {
+  switch (node->kind) {
+    case PLX_NODE_AND:
+    case PLX_NODE_OR:
+    case PLX_NODE_XOR:
+    case PLX_NODE_EQ:
+    case PLX_NODE_NEQ:
+    case PLX_NODE_LTE:
+    case PLX_NODE_LT:
+    case PLX_NODE_GTE:
+    case PLX_NODE_GT:
+    case PLX_NODE_ADD:
+    case PLX_NODE_SUB:
+    case PLX_NODE_MUL:
+    case PLX_NODE_DIV:
+    case PLX_NODE_REM:
+    case PLX_NODE_LSHIFT:
+    case PLX_NODE_RSHIFT: {
+      const struct plx_node *left, *right;
+      plx_extract_children(node, &left, &right);
+      assert(left->type->kind == right->type->kind);
+      const unsigned int a = plx_bytecode_expr(left, gen);
+      const unsigned int b = plx_bytecode_expr(right, gen);
+      const enum plx_bytecode_op op =
+          plx_bytecode_binary_op(node->kind, left->type);
+      if (node->kind == PLX_NODE_GT || node->kind == PLX_NODE_GTE) {
+        return plx_bytecode_emit_def(gen, op, b, a);
+      }
+      return plx_bytecode_emit_def(gen, op, a, b);
+    }
+    case PLX_NODE_NOT:
+    case PLX_NODE_NEG: {
+      const struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      const unsigned int a = plx_bytecode_expr(operand, gen);
+      if (node->type->kind == PLX_NODE_BOOL_TYPE) {
+        return plx_bytecode_emit_def(gen, PLX_BYTECODE_OP_NOT_BOOL, a, 0);
+      }
+      const unsigned int type_index = plx_bytecode_type_index(node->type);
+      return plx_bytecode_emit_def(
+          gen,
+          (enum plx_bytecode_op)((node->kind == PLX_NODE_NOT
+                                      ? PLX_BYTECODE_OP_NOT_S8
+                                      : PLX_BYTECODE_OP_NEG_S8) +
+                                 type_index),
+          a, 0);
+    }
+    case PLX_NODE_REF: {
+      const struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      return plx_bytecode_addr(operand, gen);
+    }
+    case PLX_NODE_DEREF:
+    case PLX_NODE_INDEX:
+      return plx_bytecode_load(gen, node->type, plx_bytecode_addr(node, gen));
+    case PLX_NODE_BOUNDS_CHECK: {
+      // Registers hold integers extended to 64 bits, so comparing them as
+      // unsigned makes negative indices out of bounds too.
+      const unsigned int index = plx_bytecode_expr(node->children, gen);
+      const unsigned int len = plx_bytecode_int(gen, (long long)node->uint);
+      plx_bytecode_emit(gen, PLX_BYTECODE_OP_CHECK_INDEX, index)->b =
+          (uint16_t)len;
+      return index;
+    }
+    case PLX_NODE_CALL: {
+      const struct plx_node *callee, *args;
+      plx_extract_children(node, &callee, &args);
+      // Functions are called directly rather than through a register.
+      const bool is_direct = callee->kind == PLX_NODE_IDENTIFIER &&
+                             plx_is_bytecode_func(callee->entry);
+      const unsigned int callee_reg =
+          is_direct ? 0 : plx_bytecode_expr(callee, gen);
+
+      // The arguments are moved to consecutive registers above every live
+      // register, which become the parameters of the callee's frame.
+      const unsigned int arg_count = (unsigned int)plx_count_children(args);
+      const unsigned int base =
+          plx_bytecode_new_regs(gen, arg_count > 0 ? arg_count : 1);
+      const unsigned int temp_base = gen->reg_top;
+      unsigned int arg_index = 0;
+      for (const struct plx_node* arg = args->children; arg != NULL;
+           arg = arg->next) {
+        plx_bytecode_move(gen, base + arg_index++,
+                          plx_bytecode_expr(arg, gen), temp_base);
+        gen->reg_top = temp_base;
+      }
+      gen->reg_top = base + 1;
+      if (is_direct) {
+        plx_bytecode_emit(gen,
+                          node->tail_call ? PLX_BYTECODE_OP_TAIL_CALL
+                                          : PLX_BYTECODE_OP_CALL,
+                          base)
+            ->imm = (int32_t)callee->entry->bytecode_var;
+      } else {
+        plx_bytecode_emit(gen,
+                          node->tail_call ? PLX_BYTECODE_OP_TAIL_CALL_INDIRECT
+                                          : PLX_BYTECODE_OP_CALL_INDIRECT,
+                          base)
+            ->b = (uint16_t)callee_reg;
+      }
+      gen->last_def = PLX_BYTECODE_NO_INST;
+      return base;
+    }
+    case PLX_NODE_IDENTIFIER: {
+      const struct plx_symbol_table_entry* const entry = node->entry;
+      if (plx_is_bytecode_func(entry)) {
+        return plx_bytecode_emit_def_imm(gen, PLX_BYTECODE_OP_FUNC,
+                                         entry->bytecode_var);
+      }
+      if (plx_is_bytecode_reg_var(entry)) return entry->bytecode_var;
+      return plx_bytecode_load(gen, node->type, plx_bytecode_addr(node, gen));
+    }
+    case PLX_NODE_S8:
+    case PLX_NODE_S16:
+    case PLX_NODE_S32:
+    case PLX_NODE_S64:
+      return plx_bytecode_int(gen, node->sint);
+    case PLX_NODE_U8:
+    case PLX_NODE_U16:
+    case PLX_NODE_U32:
+    case PLX_NODE_U64:
+      return plx_bytecode_int(gen, (long long)node->uint);
+    case PLX_NODE_F32: {
+      union plx_bytecode_value constant;
+      constant.u = 0;
+      constant.f32 = (float)node->f;
+      return plx_bytecode_const(gen, /*is_int=*/false, constant);
+    }
+    case PLX_NODE_F64: {
+      union plx_bytecode_value constant;
+      constant.f64 = node->f;
+      return plx_bytecode_const(gen, /*is_int=*/false, constant);
+    }
+    case PLX_NODE_BOOL:
+      return plx_bytecode_int(gen, node->b);
+    default:
+      assert(false);
+  }
+  return 0;
+}
+
+// Lowers the definition or declaration of a local variable.
+static void plx_bytecode_local(const struct plx_node* const node,
+                               struct plx_bytecode_generator* const gen) {
+  const struct plx_node* const name = node->children;
+  struct plx_symbol_table_entry* const entry = name->entry;
+  const struct plx_node* const value =
+      node->kind == PLX_NODE_VAR_DECL ? NULL : name->next;
+  if (plx_is_bytecode_reg_var(entry)) {
+    // The register is allocated before the value, so that it outlives the
+    // value's temporaries. Declared variables are zeroed.
+    const unsigned int var = plx_bytecode_new_reg(gen);
+    entry->bytecode_var = var;
+    plx_bytecode_move(gen, var,
+                      value == NULL ? plx_bytecode_int(gen, 0)
+                                    : plx_bytecode_expr(value, gen),
+                      var + 1);
+    gen->reg_top = var + 1;
+    return;
+  }
+  entry->bytecode_var = (unsigned int)plx_bytecode_new_slot(
+      gen, plx_bytecode_type_size(entry->type),
+      plx_bytecode_type_align(entry->type));
+  if (value != NULL) {
+    const unsigned int temp_base = gen->reg_top;
+    const unsigned int value_reg = plx_bytecode_expr(value, gen);
+    plx_bytecode_store(gen, entry->type, plx_bytecode_addr(name, gen),
+                       value_reg);
+    gen->reg_top = temp_base;
+  }
+}
+
+static void plx_bytecode_stmt(const struct plx_node* node,
+                              struct plx_bytecode_generator* gen);
+
+// Lowers a loop over a range or array. A single induction variable counts up
+// from zero or the start of the range to an end that is computed before the
+// loop, and `continue` jumps to the latch that increments it.
+static void plx_bytecode_for_loop(const struct plx_node* const node,
+                                  struct plx_bytecode_generator* const gen) {
+  static const struct plx_node u64_type = {PLX_NODE_U64_TYPE};
+  const struct plx_node *name, *iterable, *body;
+  plx_extract_children(node, &name, &iterable, &body);
+
+  // The registers are allocated before the bounds, so that they outlive the
+  // bounds' temporaries. Arrays are indexed from zero to their length.
+  const struct plx_node* counter_type = &u64_type;
+  const unsigned int counter = plx_bytecode_new_reg(gen);
+  const unsigned int end = plx_bytecode_new_reg(gen);
+  const unsigned int elements = plx_bytecode_new_reg(gen);
+  const unsigned int temp_base = elements + 1;
+  if (iterable->kind == PLX_NODE_RANGE) {
+    const struct plx_node *start_node, *end_node;
+    plx_extract_children(iterable, &start_node, &end_node);
+    counter_type = iterable->type;
+    plx_bytecode_move(gen, counter, plx_bytecode_expr(start_node, gen),
+                      temp_base);
+    gen->reg_top = temp_base;
+    plx_bytecode_move(gen, end, plx_bytecode_expr(end_node, gen), temp_base);
+  } else {
+    assert(iterable->type->kind == PLX_NODE_ARRAY_TYPE);
+    plx_bytecode_move(gen, elements, plx_bytecode_addr(iterable, gen),
+                      temp_base);
+    gen->reg_top = temp_base;
+    plx_bytecode_move(gen, counter, plx_bytecode_int(gen, 0), temp_base);
+    gen->reg_top = temp_base;
+    plx_bytecode_move(
+        gen, end,
+        plx_bytecode_int(gen, (long long)iterable->type->children->uint),
+        temp_base);
+  }
+  gen->reg_top = temp_base;
+
+  // The loop variable is defined anew in each iteration.
+  struct plx_symbol_table_entry* const entry = name->entry;
+  if (plx_is_bytecode_reg_var(entry)) {
+    entry->bytecode_var = plx_bytecode_new_reg(gen);
+  } else {
+    entry->bytecode_var = (unsigned int)plx_bytecode_new_slot(
+        gen, plx_bytecode_type_size(entry->type),
+        plx_bytecode_type_align(entry->type));
+  }
+  const unsigned int vars_top = gen->reg_top;
+
+  const size_t header_label = plx_bytecode_new_label(gen);
+  const size_t latch_label = plx_bytecode_new_label(gen);
+  const size_t exit_label = plx_bytecode_new_label(gen);
+  plx_bytecode_label(gen, header_label);
+  plx_bytecode_jump(
+      gen, PLX_BYTECODE_OP_JUMP_IF_FALSE,
+      plx_bytecode_emit_def(
+          gen, plx_bytecode_binary_op(PLX_NODE_LT, counter_type), counter,
+          end),
+      exit_label);
+  gen->reg_top = vars_top;
+  unsigned int value = counter;
+  if (iterable->kind != PLX_NODE_RANGE) {
+    value = plx_bytecode_load(
+        gen, entry->type,
+        plx_bytecode_elem_addr(gen, entry->type, elements, counter));
+  }
+  if (plx_is_bytecode_reg_var(entry)) {
+    plx_bytecode_move(gen, entry->bytecode_var, value, vars_top);
+  } else {
+    plx_bytecode_store(gen, entry->type, plx_bytecode_addr(name, gen), value);
+  }
+  gen->reg_top = vars_top;
+
+  const size_t outer_continue_label = gen->continue_label;
+  const size_t outer_break_label = gen->break_label;
+  gen->continue_label = latch_label;
+  gen->break_label = exit_label;
+  plx_bytecode_stmt(body, gen);
+  gen->continue_label = outer_continue_label;
+  gen->break_label = outer_break_label;
+
+  plx_bytecode_label(gen, latch_label);
+  plx_bytecode_move(
+      gen, counter,
+      plx_bytecode_emit_def(gen,
+                            plx_bytecode_binary_op(PLX_NODE_ADD, counter_type),
+                            counter, plx_bytecode_int(gen, 1)),
+      vars_top);
+  plx_bytecode_jump(gen, PLX_BYTECODE_OP_JUMP, 0, header_label);
+  plx_bytecode_label(gen, exit_label);
+}
+
+static void plx_bytecode_stmt(const struct plx_node* const node,
+                              struct plx_bytecode_generator* const gen) {
+  // Temporaries, and the variables of blocks, are dead after the statement.
+  const unsigned int temp_base = gen->reg_top;
+  switch (node->kind) {
+    case PLX_NODE_CONST_DEF:
+    case PLX_NODE_VAR_DEF:
+    case PLX_NODE_VAR_DECL:
+      plx_bytecode_local(node, gen);
+      return;
+    case PLX_NODE_NOP:
+      break;
+    case PLX_NODE_BLOCK:
+      for (const struct plx_node* stmt = node->children; stmt != NULL;
+           stmt = stmt->next) {
+        plx_bytecode_stmt(stmt, gen);
+      }
+      break;
+    case PLX_NODE_IF_THEN_ELSE: {
+      const struct plx_node *cond, *then, *els;
+      plx_extract_children(node, &cond, &then, &els);
+      const size_t else_label = plx_bytecode_new_label(gen);
+      const size_t end_label = plx_bytecode_new_label(gen);
+      plx_bytecode_jump(gen, PLX_BYTECODE_OP_JUMP_IF_FALSE,
+                        plx_bytecode_expr(cond, gen), else_label);
+      gen->reg_top = temp_base;
+      plx_bytecode_stmt(then, gen);
+      if (els->kind != PLX_NODE_NOP) {
+        plx_bytecode_jump(gen, PLX_BYTECODE_OP_JUMP, 0, end_label);
+      }
+      plx_bytecode_label(gen, else_label);
+      plx_bytecode_stmt(els, gen);
+      plx_bytecode_label(gen, end_label);
+      break;
+    }
+    case PLX_NODE_LOOP:
+    case PLX_NODE_WHILE_LOOP: {
+      const struct plx_node *cond = NULL, *body;
+      if (node->kind == PLX_NODE_LOOP) {
+        plx_extract_children(node, &body);
+      } else {
+        plx_extract_children(node, &cond, &body);
+      }
+      const size_t header_label = plx_bytecode_new_label(gen);
+      const size_t exit_label = plx_bytecode_new_label(gen);
+      plx_bytecode_label(gen, header_label);
+      if (cond != NULL) {
+        plx_bytecode_jump(gen, PLX_BYTECODE_OP_JUMP_IF_FALSE,
+                          plx_bytecode_expr(cond, gen), exit_label);
+        gen->reg_top = temp_base;
+      }
+      const size_t outer_continue_label = gen->continue_label;
+      const size_t outer_break_label = gen->break_label;
+      gen->continue_label = header_label;
+      gen->break_label = exit_label;
+      plx_bytecode_stmt(body, gen);
+      plx_bytecode_jump(gen, PLX_BYTECODE_OP_JUMP, 0, header_label);
+      gen->continue_label = outer_continue_label;
+      gen->break_label = outer_break_label;
+      plx_bytecode_label(gen, exit_label);
+      break;
+    }
+    case PLX_NODE_FOR_LOOP:
+      plx_bytecode_for_loop(node, gen);
+      break;
+    case PLX_NODE_CONTINUE:
+      plx_bytecode_jump(gen, PLX_BYTECODE_OP_JUMP, 0, gen->continue_label);
+      break;
+    case PLX_NODE_BREAK:
+      plx_bytecode_jump(gen, PLX_BYTECODE_OP_JUMP, 0, gen->break_label);
+      break;
+    case PLX_NODE_RETURN:
+      if (node->children == NULL) {
+        plx_bytecode_emit(gen, PLX_BYTECODE_OP_RET_VOID, 0);
+      } else if (node->children->kind == PLX_NODE_CALL &&
+                 node->children->tail_call) {
+        // Tail calls return by themselves.
+        plx_bytecode_expr(node->children, gen);
+      } else {
+        plx_bytecode_emit(gen, PLX_BYTECODE_OP_RET,
+                          plx_bytecode_expr(node->children, gen));
+      }
+      break;
+    case PLX_NODE_ASSIGN: {
+      const struct plx_node *assignee, *value;
+      plx_extract_children(node, &assignee, &value);
+      if (assignee->kind == PLX_NODE_IDENTIFIER &&
+          plx_is_bytecode_reg_var(assignee->entry)) {
+        plx_bytecode_move(gen, assignee->entry->bytecode_var,
+                          plx_bytecode_expr(value, gen), temp_base);
+        break;
+      }
+      const unsigned int addr = plx_bytecode_addr(assignee, gen);
+      plx_bytecode_store(gen, assignee->type, addr,
+                         plx_bytecode_expr(value, gen));
+      break;
+    }
+    case PLX_NODE_ADD_ASSIGN:
+    case PLX_NODE_SUB_ASSIGN:
+    case PLX_NODE_MUL_ASSIGN:
+    case PLX_NODE_DIV_ASSIGN:
+    case PLX_NODE_REM_ASSIGN:
+    case PLX_NODE_LSHIFT_ASSIGN:
+    case PLX_NODE_RSHIFT_ASSIGN: {
+      const struct plx_node *assignee, *value;
+      plx_extract_children(node, &assignee, &value);
+      assert(assignee->type->kind == value->type->kind);
+      enum plx_node_kind kind = PLX_NODE_NOP;
+      switch (node->kind) {
+        case PLX_NODE_ADD_ASSIGN:
+          kind = PLX_NODE_ADD;
+          break;
+        case PLX_NODE_SUB_ASSIGN:
+          kind = PLX_NODE_SUB;
+          break;
+        case PLX_NODE_MUL_ASSIGN:
+          kind = PLX_NODE_MUL;
+          break;
+        case PLX_NODE_DIV_ASSIGN:
+          kind = PLX_NODE_DIV;
+          break;
+        case PLX_NODE_REM_ASSIGN:
+          kind = PLX_NODE_REM;
+          break;
+        case PLX_NODE_LSHIFT_ASSIGN:
+          kind = PLX_NODE_LSHIFT;
+          break;
+        case PLX_NODE_RSHIFT_ASSIGN:
+          kind = PLX_NODE_RSHIFT;
+          break;
+        default:
+          assert(false);
+      }
+      const enum plx_bytecode_op op =
+          plx_bytecode_binary_op(kind, assignee->type);
+      if (assignee->kind == PLX_NODE_IDENTIFIER &&
+          plx_is_bytecode_reg_var(assignee->entry)) {
+        // The operation writes the variable directly.
+        const unsigned int var = assignee->entry->bytecode_var;
+        const unsigned int right = plx_bytecode_expr(value, gen);
+        struct plx_bytecode_inst* const inst = plx_bytecode_emit(gen, op, var);
+        inst->b = (uint16_t)var;
+        inst->c = (uint16_t)right;
+        break;
+      }
+      const unsigned int addr = plx_bytecode_addr(assignee, gen);
+      const unsigned int left = plx_bytecode_load(gen, assignee->type, addr);
+      const unsigned int right = plx_bytecode_expr(value, gen);
+      plx_bytecode_store(gen, assignee->type, addr,
+                         plx_bytecode_emit_def(gen, op, left, right));
+      break;
+    }
+    case PLX_NODE_CALL:
+      plx_bytecode_expr(node, gen);
+      break;
+    default:
+      assert(false);
+  }
+  gen->reg_top = temp_base;
+}
+
+// Generates the bytecode of a function.
+static bool plx_generate_bytecode_func(
+    const struct plx_node* const node,
+    struct plx_bytecode_generator* const gen) {
+  const struct plx_node *name, *params, *return_type, *body;
+  plx_extract_children(node, &name, &params, &return_type, &body);
+  struct plx_bytecode_program* const program = gen->program;
+  const size_t func_index = name->entry->bytecode_var;
+  program->funcs[func_index].start = program->inst_count;
+  gen->reg_top = 0;
+  gen->reg_count = 0;
+  gen->frame_size = 0;
+  gen->last_def = PLX_BYTECODE_NO_INST;
+  gen->label_count = 0;
+  gen->jump_count = 0;
+
+  // Parameters arrive in the first registers. Those whose address is taken
+  // are then stored to the frame.
+  const unsigned int param_count = (unsigned int)plx_count_children(params);
+  plx_bytecode_new_regs(gen, param_count);
+  unsigned int param_reg = 0;
+  for (const struct plx_node* param = params->children; param != NULL;
+       param = param->next) {
+    const struct plx_node* const param_name = param->children;
+    struct plx_symbol_table_entry* const entry = param_name->entry;
+    if (plx_is_bytecode_reg_var(entry)) {
+      entry->bytecode_var = param_reg++;
+      continue;
+    }
+    entry->bytecode_var = (unsigned int)plx_bytecode_new_slot(
+        gen, plx_bytecode_type_size(entry->type),
+        plx_bytecode_type_align(entry->type));
+    plx_bytecode_store(gen, entry->type, plx_bytecode_addr(param_name, gen),
+                       param_reg++);
+    gen->reg_top = param_count;
+  }
+
+  plx_bytecode_stmt(body, gen);
+  plx_bytecode_emit(gen,
+                    return_type->kind == PLX_NODE_VOID_TYPE
+                        ? PLX_BYTECODE_OP_RET_VOID
+                        : PLX_BYTECODE_OP_UNREACHABLE,
+                    0);
+
+  // Patch the jumps now that every label is placed.
+  for (size_t i = 0; i < gen->jump_count; ++i) {
+    struct plx_bytecode_inst* const inst = &program->insts[gen->jumps[i]];
+    inst->imm = (int32_t)gen->label_offsets[inst->imm];
+  }
+
+  // The result is returned in the first register, so there is always one.
+  if (plx_unlikely(gen->reg_count > UINT16_MAX + 1)) {
+    plx_error("function needs too many registers for the bytecode interpreter");
+    plx_print_source_code(&name->loc, /*annotation=*/NULL,
+                          PLX_SOURCE_ANNOTATION_ERROR);
+    return false;
+  }
+  struct plx_bytecode_func* const func = &program->funcs[func_index];
+  func->param_count = param_count;
+  func->reg_count = gen->reg_count > 0 ? gen->reg_count : 1;
+  func->frame_size = (gen->frame_size + 15) / 16 * 16;
+  return true;
+}
+
+// Appends a value to the globals, aligned to its size, returning its offset.
+static size_t plx_bytecode_append_value(struct plx_buffer* const globals,
+                                        const struct plx_node* const value) {
+  const size_t size = plx_bytecode_type_size(value->type);
+  while (globals->len % size != 0) plx_buffer_append_char(globals, '\0');
+  const size_t offset = globals->len;
+  switch (value->kind) {
+    case PLX_NODE_S8: {
+      const int8_t x = (int8_t)value->sint;
+      plx_buffer_append(globals, &x, sizeof(x));
+      break;
+    }
+    case PLX_NODE_S16: {
+      const int16_t x = (int16_t)value->sint;
+      plx_buffer_append(globals, &x, sizeof(x));
+      break;
+    }
+    case PLX_NODE_S32: {
+      const int32_t x = (int32_t)value->sint;
+      plx_buffer_append(globals, &x, sizeof(x));
+      break;
+    }
+    case PLX_NODE_S64: {
+      const int64_t x = value->sint;
+      plx_buffer_append(globals, &x, sizeof(x));
+      break;
+    }
+    case PLX_NODE_U8:
+    case PLX_NODE_BOOL: {
+      const uint8_t x =
+          (uint8_t)(value->kind == PLX_NODE_BOOL ? value->b : value->uint);
+      plx_buffer_append(globals, &x, sizeof(x));
+      break;
+    }
+    case PLX_NODE_U16: {
+      const uint16_t x = (uint16_t)value->uint;
+      plx_buffer_append(globals, &x, sizeof(x));
+      break;
+    }
+    case PLX_NODE_U32: {
+      const uint32_t x = (uint32_t)value->uint;
+      plx_buffer_append(globals, &x, sizeof(x));
+      break;
+    }
+    case PLX_NODE_U64: {
+      const uint64_t x = value->uint;
+      plx_buffer_append(globals, &x, sizeof(x));
+      break;
+    }
+    case PLX_NODE_F32: {
+      const float x = (float)value->f;
+      plx_buffer_append(globals, &x, sizeof(x));
+      break;
+    }
+    case PLX_NODE_F64: {
+      const double x = value->f;
+      plx_buffer_append(globals, &x, sizeof(x));
+      break;
+    }
+    default:
+      assert(false);
+  }
+  return offset;
+}
+
+// Allocates the globals and numbers the functions of a module, so that they
+// can be used before they are defined.
+static void plx_generate_bytecode_decl(
+    const struct plx_node* const node,
+    struct plx_bytecode_program* const program) {
+  switch (node->kind) {
+    case PLX_NODE_CONST_DEF:
+    case PLX_NODE_VAR_DEF: {
+      const struct plx_node *name, *value;
+      plx_extract_children(node, &name, &value);
+      name->entry->bytecode_var =
+          (unsigned int)plx_bytecode_append_value(&program->globals, value);
+      break;
+    }
+    case PLX_NODE_VAR_DECL: {
+      const struct plx_node *name, *type;
+      plx_extract_children(node, &name, &type);
+      const size_t align = plx_bytecode_type_align(type);
+      while (program->globals.len % align != 0) {
+        plx_buffer_append_char(&program->globals, '\0');
+      }
+      name->entry->bytecode_var = (unsigned int)program->globals.len;
+      for (size_t i = plx_bytecode_type_size(type); i > 0; --i) {
+        plx_buffer_append_char(&program->globals, '\0');
+      }
+      break;
+    }
+    case PLX_NODE_FUNC_DEF: {
+      const struct plx_node* const name = node->children;
+      program->funcs =
+          plx_bytecode_reserve(program->funcs, &program->func_cap,
+                               program->func_count + 1,
+                               sizeof(*program->funcs));
+      struct plx_bytecode_func* const func =
+          &program->funcs[program->func_count];
+      memset(func, 0, sizeof(*func));
+      func->name = name->name;
+      name->entry->bytecode_var = (unsigned int)program->func_count++;
+      break;
+    }
+    case PLX_NODE_STRUCT_DEF:
+    case PLX_NODE_NOP:
+      break;
+    default:
+      assert(false);
+  }
+}
+
+bool plx_generate_bytecode(const struct plx_node* const module,
+                           struct plx_bytecode_program* const program) {
+  assert(module->kind == PLX_NODE_MODULE);
+  if (!plx_check_bytecode(module)) return false;
+
+  for (const struct plx_node* child = module->children; child != NULL;
+       child = child->next) {
+    plx_generate_bytecode_decl(child, program);
+  }
+
+  struct plx_bytecode_generator gen;
+  memset(&gen, 0, sizeof(gen));
+  gen.program = program;
+  bool result = true;
+  for (const struct plx_node* child = module->children; child != NULL;
+       child = child->next) {
+    if (child->kind == PLX_NODE_FUNC_DEF &&
+        !plx_generate_bytecode_func(child, &gen)) {
+      result = false;
+    }
+  }
+  free(gen.label_offsets);
+  free(gen.jumps);
+  return result;
+}
@@ -0,0 +1,28 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_BYTECODE_GENERATOR_H
+#define PLX_BYTECODE_GENERATOR_H
+
+#include <stdbool.h>
+
+#include "ast.h"
+#include "bytecode.h"
+
+// Compiles a checked module to bytecode for the interpreter. Returns whether
+// the module only uses types that the interpreter supports.
+bool plx_generate_bytecode(const struct plx_node* module,
+                           struct plx_bytecode_program* program);
+
+#endif  // PLX_BYTECODE_GENERATOR_H
@@ -0,0 +1,347 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "call_graph.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "error.h"
+#include "macros.h"
+
+struct plx_call_graph_builder {
+  struct plx_call_graph* graph;
+  size_t edges_cap;
+  size_t edges_len;
+
+  // Function whose calls are being added.
+  size_t caller;
+
+  // Whether the caller makes an indirect call.
+  bool indirect_calls;
+
+  // Caller plus one that last called each function, so that each callee is
+  // added once per caller.
+  size_t* last_callers;
+};
+
+// State of Tarjan's algorithm, which finds SCCs in bottom-up order.
+struct plx_scc_finder {
+  struct plx_call_graph* graph;
+  size_t next_index;
+
+  // Order in which each function was visited, or `SIZE_MAX` if it has not
+  // been, and the earliest visited function that it reaches on the stack.
+  size_t* indices;
+  size_t* lowlinks;
+
+  // Visited functions whose SCCs are not complete.
+  size_t stack_len;
+  size_t* stack;
+  bool* on_stack;
+
+  // Number of functions in the complete SCCs.
+  size_t scc_funcs_len;
+};
+
+static int plx_compare_call_graph_symbols(const void* const a,
+                                          const void* const b) {
+  const struct plx_symbol_table_entry* const entry_a =
+      ((const struct plx_call_graph_symbol*)a)->entry;
+  const struct plx_symbol_table_entry* const entry_b =
+      ((const struct plx_call_graph_symbol*)b)->entry;
+  return entry_a < entry_b ? -1 : entry_a > entry_b ? 1 : 0;
+}
+
+size_t plx_call_graph_find(const struct plx_call_graph* const graph,
+                           const struct plx_symbol_table_entry* const entry) {
+  if (entry == NULL) return SIZE_MAX;
+  const struct plx_call_graph_symbol key = {entry, 0};
+  const struct plx_call_graph_symbol* const symbol =
+      bsearch(&key, graph->symbols, graph->func_count, sizeof(key),
+              plx_compare_call_graph_symbols);
+  return symbol != NULL ? symbol->func : SIZE_MAX;
+}
+
+// Returns the function that a callee names, or `SIZE_MAX` if the call is
+// indirect.
+static size_t plx_direct_callee(const struct plx_call_graph* const graph,
+                                const struct plx_node* const callee) {
+  if (callee->kind != PLX_NODE_IDENTIFIER) return SIZE_MAX;
+  return plx_call_graph_find(graph, callee->entry);
+}
+
+// Marks the functions that a node refers to other than by calling them as
+// having their address taken.
+static void plx_mark_address_taken(struct plx_call_graph* const graph,
+                                   const struct plx_node* const node) {
+  const struct plx_node* child = node->children;
+  if (node->kind == PLX_NODE_IDENTIFIER) {
+    const size_t func = plx_call_graph_find(graph, node->entry);
+    if (func != SIZE_MAX) graph->address_taken[func] = true;
+  } else if (node->kind == PLX_NODE_CALL &&
+             plx_direct_callee(graph, child) != SIZE_MAX) {
+    child = child->next;
+  }
+  for (; child != NULL; child = child->next) {
+    plx_mark_address_taken(graph, child);
+  }
+}
+
+static void plx_add_call_edge(struct plx_call_graph_builder* const builder,
+                              const size_t callee, const bool indirect) {
+  if (builder->last_callers[callee] == builder->caller + 1) return;
+  builder->last_callers[callee] = builder->caller + 1;
+  struct plx_call_graph* const graph = builder->graph;
+  if (builder->edges_len == builder->edges_cap) {
+    builder->edges_cap = builder->edges_cap == 0 ? 16 : builder->edges_cap * 2;
+    graph->edges =
+        realloc(graph->edges, builder->edges_cap * sizeof(*graph->edges));
+    if (plx_unlikely(graph->edges == NULL)) plx_oom();
+  }
+  graph->edges[builder->edges_len++] =
+      (struct plx_call_edge){callee, indirect};
+}
+
+// Adds the direct calls in a node, and notes whether there are indirect ones.
+static void plx_add_calls(struct plx_call_graph_builder* const builder,
+                          const struct plx_node* const node) {
+  if (node->kind == PLX_NODE_CALL) {
+    const size_t callee = plx_direct_callee(builder->graph, node->children);
+    if (callee != SIZE_MAX) {
+      plx_add_call_edge(builder, callee, /*indirect=*/false);
+    } else {
+      builder->indirect_calls = true;
+    }
+  }
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    plx_add_calls(builder, child);
+  }
+}
+
+// Visits a function and the functions that it calls, completing the SCCs
+// that they are in.
+static void plx_find_sccs(struct plx_scc_finder* const finder,
+                          const size_t func) {
+  struct plx_call_graph* const graph = finder->graph;
+  finder->indices[func] = finder->lowlinks[func] = finder->next_index++;
+  finder->stack[finder->stack_len++] = func;
+  finder->on_stack[func] = true;
+  for (size_t i = graph->edge_begins[func]; i < graph->edge_begins[func + 1];
+       ++i) {
+    const size_t callee = graph->edges[i].callee;
+    if (finder->indices[callee] == SIZE_MAX) {
+      plx_find_sccs(finder, callee);
+      if (finder->lowlinks[callee] < finder->lowlinks[func]) {
+        finder->lowlinks[func] = finder->lowlinks[callee];
+      }
+    } else if (finder->on_stack[callee] &&
+               finder->indices[callee] < finder->lowlinks[func]) {
+      finder->lowlinks[func] = finder->indices[callee];
+    }
+  }
+  if (finder->lowlinks[func] != finder->indices[func]) return;
+
+  // The function is the root of an SCC, whose functions are above it on the
+  // stack.
+  size_t member;
+  do {
+    member = finder->stack[--finder->stack_len];
+    finder->on_stack[member] = false;
+    graph->func_sccs[member] = graph->scc_count;
+    graph->scc_funcs[finder->scc_funcs_len++] = member;
+  } while (member != func);
+  graph->scc_begins[++graph->scc_count] = finder->scc_funcs_len;
+}
+
+void plx_build_call_graph(const struct plx_node* const module,
+                          struct plx_call_graph* const graph) {
+  // Collect the function definitions.
+  size_t func_count = 0;
+  for (const struct plx_node* def = module->children; def != NULL;
+       def = def->next) {
+    if (def->kind == PLX_NODE_FUNC_DEF) ++func_count;
+  }
+  const size_t n = func_count == 0 ? 1 : func_count;
+  graph->func_count = func_count;
+  graph->funcs = malloc(n * sizeof(*graph->funcs));
+  graph->symbols = malloc(n * sizeof(*graph->symbols));
+  graph->address_taken = calloc(n, sizeof(*graph->address_taken));
+  graph->edge_begins = malloc((n + 1) * sizeof(*graph->edge_begins));
+  graph->edges = NULL;
+  graph->scc_count = 0;
+  graph->scc_begins = malloc((n + 1) * sizeof(*graph->scc_begins));
+  graph->scc_funcs = malloc(n * sizeof(*graph->scc_funcs));
+  graph->func_sccs = malloc(n * sizeof(*graph->func_sccs));
+  size_t* const last_callers = calloc(n, sizeof(size_t));
+  if (plx_unlikely(graph->funcs == NULL || graph->symbols == NULL ||
+                   graph->address_taken == NULL ||
+                   graph->edge_begins == NULL || graph->scc_begins == NULL ||
+                   graph->scc_funcs == NULL || graph->func_sccs == NULL ||
+                   last_callers == NULL)) {
+    plx_oom();
+  }
+  size_t i = 0;
+  for (const struct plx_node* def = module->children; def != NULL;
+       def = def->next) {
+    if (def->kind != PLX_NODE_FUNC_DEF) continue;
+    graph->funcs[i] = (struct plx_node*)def;
+    graph->symbols[i] = (struct plx_call_graph_symbol){def->children->entry, i};
+    ++i;
+  }
+  qsort(graph->symbols, func_count, sizeof(*graph->symbols),
+        plx_compare_call_graph_symbols);
+
+  // Find the functions whose address is taken anywhere in the module,
+  // skipping the names of the definitions. Folded constants have no children.
+  for (const struct plx_node* def = module->children; def != NULL;
+       def = def->next) {
+    if (def->kind == PLX_NODE_NOP) continue;
+    for (const struct plx_node* child = def->children->next; child != NULL;
+         child = child->next) {
+      plx_mark_address_taken(graph, child);
+    }
+  }
+
+  // Add the calls of each function. Indirect calls may reach any function
+  // whose address is taken.
+  struct plx_call_graph_builder builder = {graph, 0, 0, 0, false,
+                                           last_callers};
+  for (i = 0; i < func_count; ++i) {
+    builder.caller = i;
+    builder.indirect_calls = false;
+    graph->edge_begins[i] = builder.edges_len;
+    for (const struct plx_node* child = graph->funcs[i]->children->next;
+         child != NULL; child = child->next) {
+      plx_add_calls(&builder, child);
+    }
+    if (!builder.indirect_calls) continue;
+    for (size_t callee = 0; callee < func_count; ++callee) {
+      if (graph->address_taken[callee]) {
+        plx_add_call_edge(&builder, callee, /*indirect=*/true);
+      }
+    }
+  }
+  graph->edge_begins[func_count] = builder.edges_len;
+  free(last_callers);
+
+  // Find the SCCs.
+  struct plx_scc_finder finder = {graph, 0, NULL, NULL, 0, NULL, NULL, 0};
+  finder.indices = malloc(n * sizeof(size_t));
+  finder.lowlinks = malloc(n * sizeof(size_t));
+  finder.stack = malloc(n * sizeof(size_t));
+  finder.on_stack = calloc(n, sizeof(bool));
+  if (plx_unlikely(finder.indices == NULL || finder.lowlinks == NULL ||
+                   finder.stack == NULL || finder.on_stack == NULL)) {
+    plx_oom();
+  }
+  for (i = 0; i < func_count; ++i) finder.indices[i] = SIZE_MAX;
+  graph->scc_begins[0] = 0;
+  for (i = 0; i < func_count; ++i) {
+    if (finder.indices[i] == SIZE_MAX) plx_find_sccs(&finder, i);
+  }
+  free(finder.indices);
+  free(finder.lowlinks);
+  free(finder.stack);
+  free(finder.on_stack);
+}
+
+void plx_call_graph_free(struct plx_call_graph* const graph) {
+  free(graph->funcs);
+  free(graph->symbols);
+  free(graph->address_taken);
+  free(graph->edge_begins);
+  free(graph->edges);
+  free(graph->scc_begins);
+  free(graph->scc_funcs);
+  free(graph->func_sccs);
+}
+
+bool plx_is_recursive(const struct plx_call_graph* const graph,
+                      const size_t func) {
+  const size_t scc = graph->func_sccs[func];
+  if (graph->scc_begins[scc + 1] - graph->scc_begins[scc] > 1) return true;
+  for (size_t i = graph->edge_begins[func]; i < graph->edge_begins[func + 1];
+       ++i) {
+    if (graph->edges[i].callee == func) return true;
+  }
+  return false;
+}
+
+static const char* plx_func_name(const struct plx_call_graph* const graph,
+                                 const size_t func) {
+  return graph->funcs[func]->children->name;
+}
+
+void plx_print_call_graph_dot(const struct plx_call_graph* const graph,
+                              FILE* const stream) {
+  fputs("digraph \"call graph\" {\n", stream);
+  for (size_t scc = 0; scc < graph->scc_count; ++scc) {
+    const size_t begin = graph->scc_begins[scc];
+    const size_t end = graph->scc_begins[scc + 1];
+    const bool cluster = plx_is_recursive(graph, graph->scc_funcs[begin]);
+    if (cluster) {
+      fprintf(stream, "  subgraph cluster_%zu {\n    label=\"SCC %zu\";\n",
+              scc, scc);
+    }
+    for (size_t i = begin; i < end; ++i) {
+      fprintf(stream, "%s  \"%s\";\n", cluster ? "  " : "",
+              plx_func_name(graph, graph->scc_funcs[i]));
+    }
+    if (cluster) fputs("  }\n", stream);
+  }
+  for (size_t func = 0; func < graph->func_count; ++func) {
+    for (size_t i = graph->edge_begins[func]; i < graph->edge_begins[func + 1];
+         ++i) {
+      fprintf(stream, "  \"%s\" -> \"%s\"%s;\n", plx_func_name(graph, func),
+              plx_func_name(graph, graph->edges[i].callee),
+              graph->edges[i].indirect ? " [style=dashed]" : "");
+    }
+  }
+  fputs("}\n", stream);
+}
+
+void plx_print_call_graph_json(const struct plx_call_graph* const graph,
+                               FILE* const stream) {
+  fputs("{\n  \"functions\": [", stream);
+  for (size_t func = 0; func < graph->func_count; ++func) {
+    fprintf(stream,
+            "%s\n    {\"name\": \"%s\", \"scc\": %zu, \"recursive\": %s, "
+            "\"address_taken\": %s, \"calls\": [",
+            func > 0 ? "," : "", plx_func_name(graph, func),
+            graph->func_sccs[func],
+            plx_is_recursive(graph, func) ? "true" : "false",
+            graph->address_taken[func] ? "true" : "false");
+    for (size_t i = graph->edge_begins[func]; i < graph->edge_begins[func + 1];
+         ++i) {
+      fprintf(stream, "%s{\"callee\": \"%s\", \"indirect\": %s}",
+              i > graph->edge_begins[func] ? ", " : "",
+              plx_func_name(graph, graph->edges[i].callee),
+              graph->edges[i].indirect ? "true" : "false");
+    }
+    fputs("]}", stream);
+  }
+  fputs("\n  ],\n  \"sccs\": [", stream);
+  for (size_t scc = 0; scc < graph->scc_count; ++scc) {
+    fputs(scc > 0 ? ",\n    [" : "\n    [", stream);
+    for (size_t i = graph->scc_begins[scc]; i < graph->scc_begins[scc + 1];
+         ++i) {
+      fprintf(stream, "%s\"%s\"", i > graph->scc_begins[scc] ? ", " : "",
+              plx_func_name(graph, graph->scc_funcs[i]));
+    }
+    fputs("]", stream);
+  }
+  fputs("\n  ]\n}\n", stream);
+}
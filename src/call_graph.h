@@ -0,0 +1,93 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_CALL_GRAPH_H
+#define PLX_CALL_GRAPH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "ast.h"
+
+// Call from one function to another.
+struct plx_call_edge {
+  // Index of the called function.
+  size_t callee;
+
+  // Whether the call is through a function value that may hold the callee,
+  // rather than to the callee by name.
+  bool indirect;
+};
+
+// Function and the symbol that it defines.
+struct plx_call_graph_symbol {
+  const struct plx_symbol_table_entry* entry;
+  size_t func;
+};
+
+// Call graph of the functions of a module, with its strongly connected
+// components (SCCs). Functions are indexed in module order. An indirect call
+// is assumed to reach every function whose address is taken.
+struct plx_call_graph {
+  size_t func_count;
+  struct plx_node** funcs;
+
+  // Functions sorted by their symbols.
+  struct plx_call_graph_symbol* symbols;
+
+  // Whether the address of each function is taken.
+  bool* address_taken;
+
+  // Calls of function `i`, each callee once, are
+  // `edges[edge_begins[i]..edge_begins[i + 1]]`.
+  size_t* edge_begins;
+  struct plx_call_edge* edges;
+
+  // Functions of SCC `i` are `scc_funcs[scc_begins[i]..scc_begins[i + 1]]`.
+  // SCCs are in bottom-up order: an SCC comes after every SCC that it calls.
+  size_t scc_count;
+  size_t* scc_begins;
+  size_t* scc_funcs;
+
+  // SCC of each function.
+  size_t* func_sccs;
+};
+
+// Builds the call graph of a module whose names have been resolved.
+void plx_build_call_graph(const struct plx_node* module,
+                          struct plx_call_graph* graph);
+
+void plx_call_graph_free(struct plx_call_graph* graph);
+
+// Returns the index of a function definition, or `SIZE_MAX` if the symbol is
+// not a function.
+size_t plx_call_graph_find(const struct plx_call_graph* graph,
+                           const struct plx_symbol_table_entry* entry);
+
+// Returns whether a function may call itself, directly or through other
+// functions.
+bool plx_is_recursive(const struct plx_call_graph* graph, size_t func);
+
+// Writes the call graph in the DOT language of Graphviz, with each recursive
+// SCC as a cluster and indirect calls dashed.
+void plx_print_call_graph_dot(const struct plx_call_graph* graph,
+                              FILE* stream);
+
+// Writes the call graph as JSON: the functions with their SCC and callees, and
+// the SCCs in bottom-up order.
+void plx_print_call_graph_json(const struct plx_call_graph* graph,
+                               FILE* stream);
+
+#endif  // PLX_CALL_GRAPH_H
@@ -0,0 +1,472 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "clang.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "error.h"
+#include "macros.h"
+#include "path.h"
+#include "target.h"
+
+#ifdef _WIN32
+#include <io.h>
+
+#define PLX_CLANG_EXE "clang.exe"
+#define PLX_LLVM_PROFDATA_EXE "llvm-profdata.exe"
+#define PLX_PATH_LIST_SEPARATOR ';'
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define PLX_CLANG_EXE "clang"
+#define PLX_LLVM_PROFDATA_EXE "llvm-profdata"
+#define PLX_PATH_LIST_SEPARATOR ':'
+
+extern char** environ;
+#endif  // _WIN32
+
+// Maximum number of arguments to Clang other than input files, including the
+// terminating `NULL`.
+#define PLX_CLANG_MAX_ARGS 24
+
+static bool plx_is_executable(const char* const path) {
+#ifdef _WIN32
+  return _access(path, 0) == 0;
+#else
+  return access(path, X_OK) == 0;
+#endif  // _WIN32
+}
+
+// Searches `PATH` for an executable, writing its path to the buffer. Returns
+// whether it was found.
+static bool plx_find_program(const char* const name, char* const path,
+                             const size_t size) {
+  const char* dirs = getenv("PATH");
+  while (dirs != NULL && *dirs != '\0') {
+    const char* const separator = strchr(dirs, PLX_PATH_LIST_SEPARATOR);
+    const size_t len =
+        separator != NULL ? (size_t)(separator - dirs) : strlen(dirs);
+    if (len > 0) {
+      const int path_len =
+          snprintf(path, size, "%.*s/%s", (int)len, dirs, name);
+      if (path_len > 0 && (size_t)path_len < size && plx_is_executable(path)) {
+        return true;
+      }
+    }
+    dirs = separator != NULL ? separator + 1 : NULL;
+  }
+  return false;
+}
+
+// Returns the path of Clang, or `NULL` if it could not be found. `PATH` is only
+// searched the first time.
+static const char* plx_find_clang(void) {
+  static bool searched = false;
+  static char path[PLX_PATH_MAX];
+  if (searched) return path[0] != '\0' ? path : NULL;
+  searched = true;
+  if (!plx_find_program(PLX_CLANG_EXE, path, sizeof(path))) path[0] = '\0';
+  return path[0] != '\0' ? path : NULL;
+}
+
+// Arguments to Clang.
+struct plx_clang_args {
+  const char** args;
+
+  // Target CPU argument.
+  char cpu[128];
+
+  // Profile data argument.
+  char profile_use[PLX_PATH_MAX + 32];
+};
+
+// Fills in the arguments to Clang, which are freed with `plx_clang_args_free`.
+static void plx_clang_args_init(
+    struct plx_clang_args* const args, const char* const* const input_filenames,
+    const size_t input_count, const char* const output_filename,
+    const enum plx_emit emit, const struct plx_compile_options* const options) {
+  args->args = malloc((PLX_CLANG_MAX_ARGS + input_count) * sizeof(*args->args));
+  if (plx_unlikely(args->args == NULL)) plx_oom();
+  size_t len = 0;
+  args->args[len++] = "clang";
+  switch (emit) {
+    case PLX_EMIT_ASM:
+      args->args[len++] = "-S";
+      break;
+    case PLX_EMIT_OBJ:
+      args->args[len++] = "-c";
+      break;
+    case PLX_EMIT_EXE:
+      break;
+    default:
+      assert(false);
+  }
+  switch (options->opt_level) {
+    case PLX_OPT_LEVEL_O0:
+      args->args[len++] = "-O0";
+      break;
+    case PLX_OPT_LEVEL_O1:
+      args->args[len++] = "-O1";
+      break;
+    case PLX_OPT_LEVEL_O2:
+      args->args[len++] = "-O2";
+      break;
+    case PLX_OPT_LEVEL_O3:
+      args->args[len++] = "-O3";
+      break;
+    case PLX_OPT_LEVEL_OS:
+      args->args[len++] = "-Os";
+      break;
+  }
+  if (options->fast_math) args->args[len++] = "-ffast-math";
+
+  // The IR is generated for the host if no target is given, which Clang may
+  // spell differently.
+  if (options->target != NULL) {
+    args->args[len++] = "-target";
+    args->args[len++] = options->target;
+  }
+  args->args[len++] = "-Wno-override-module";
+
+  // x86 selects the CPU with `-march` and other architectures with `-mcpu`.
+  if (options->cpu != NULL) {
+    const char* const triple =
+        options->target != NULL ? options->target : plx_host_triple();
+    snprintf(args->cpu, sizeof(args->cpu), "%s=%s",
+             plx_is_x86_triple(triple) ? "-march" : "-mcpu", options->cpu);
+    args->args[len++] = args->cpu;
+  }
+  switch (options->lto) {
+    case PLX_LTO_NONE:
+      break;
+    case PLX_LTO_THIN:
+      args->args[len++] = "-flto=thin";
+      break;
+    case PLX_LTO_FULL:
+      args->args[len++] = "-flto=full";
+      break;
+  }
+
+  // The instrumented executable writes `default.profraw` to the working
+  // directory unless `LLVM_PROFILE_FILE` is set.
+  if (options->profile_generate) args->args[len++] = "-fprofile-generate";
+  if (options->profile_use != NULL) {
+    snprintf(args->profile_use, sizeof(args->profile_use),
+             "-fprofile-use=%s", options->profile_use);
+    args->args[len++] = args->profile_use;
+  }
+
+  if (input_count == 0) {
+    // Clang detects whether the input is LLVM IR or bitcode.
+    args->args[len++] = "-x";
+    args->args[len++] = "ir";
+    args->args[len++] = "-";
+  }
+  for (size_t i = 0; i < input_count; ++i) {
+    args->args[len++] = input_filenames[i];
+  }
+  args->args[len++] = "-o";
+  args->args[len++] = output_filename;
+  args->args[len] = NULL;
+  assert(len < PLX_CLANG_MAX_ARGS + input_count);
+}
+
+static void plx_clang_args_free(struct plx_clang_args* const args) {
+  free(args->args);
+}
+
+#ifdef _WIN32
+
+// Starts a program with the arguments. Its standard input is always a pipe.
+static bool plx_spawn(struct plx_clang* const clang, const char* const path,
+                      const char* const* const args, const bool pipe_input) {
+  (void)pipe_input;
+
+  // The command is quoted as a whole for `cmd.exe`, and each argument is
+  // quoted in case it contains spaces.
+  struct plx_buffer command = PLX_BUFFER_INIT;
+  plx_buffer_append_str(&command, "\"\"");
+  plx_buffer_append_str(&command, path);
+  plx_buffer_append_char(&command, '"');
+  for (size_t i = 1; args[i] != NULL; ++i) {
+    plx_buffer_append_str(&command, " \"");
+    plx_buffer_append_str(&command, args[i]);
+    plx_buffer_append_char(&command, '"');
+  }
+  plx_buffer_append_char(&command, '"');
+  plx_buffer_append_char(&command, '\0');
+  clang->input = _popen(command.data, "wb");
+  plx_buffer_free(&command);
+  if (plx_unlikely(clang->input == NULL)) {
+    plx_error("could not run `%s`", path);
+    return false;
+  }
+  return true;
+}
+
+// Writes the input to a program, then waits for it to exit. Returns whether it
+// succeeded.
+static bool plx_wait_for(struct plx_clang* const clang,
+                         const struct plx_buffer* const input,
+                         const char* const name) {
+  if (input != NULL) fwrite(input->data, 1, input->len, clang->input);
+  const int status = _pclose(clang->input);
+  if (plx_unlikely(status != 0)) {
+    plx_error("%s failed with exit status %d", name, status);
+    return false;
+  }
+  return true;
+}
+
+void plx_clang_send(struct plx_clang* const clang,
+                    const struct plx_buffer* const input) {
+  fwrite(input->data, 1, input->len, clang->input);
+  fflush(clang->input);
+}
+
+void plx_clang_cancel(struct plx_clang* const clang) { _pclose(clang->input); }
+
+#else
+
+// Starts a program with the arguments, with standard input connected to a pipe
+// if asked for. Standard error is always read through a pipe.
+static bool plx_spawn(struct plx_clang* const clang, const char* const path,
+                      const char* const* const args, const bool pipe_input) {
+  // Writing to Clang after it has exited fails with `EPIPE` rather than
+  // terminating the compiler.
+  signal(SIGPIPE, SIG_IGN);
+
+  int input_pipe[2] = {-1, -1};
+  int error_pipe[2];
+  if (plx_unlikely(pipe_input && pipe(input_pipe) != 0)) {
+    plx_error("could not create pipe: %s", strerror(errno));
+    return false;
+  }
+  if (plx_unlikely(pipe(error_pipe) != 0)) {
+    plx_error("could not create pipe: %s", strerror(errno));
+    if (pipe_input) {
+      close(input_pipe[0]);
+      close(input_pipe[1]);
+    }
+    return false;
+  }
+
+  // The compiler's ends of the pipes are not inherited by programs that are
+  // started later, which would keep the pipes open while several run at once.
+  if (pipe_input) fcntl(input_pipe[1], F_SETFD, FD_CLOEXEC);
+  fcntl(error_pipe[0], F_SETFD, FD_CLOEXEC);
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  if (pipe_input) {
+    posix_spawn_file_actions_adddup2(&actions, input_pipe[0], STDIN_FILENO);
+    posix_spawn_file_actions_addclose(&actions, input_pipe[0]);
+    posix_spawn_file_actions_addclose(&actions, input_pipe[1]);
+  }
+  posix_spawn_file_actions_adddup2(&actions, error_pipe[1], STDERR_FILENO);
+  posix_spawn_file_actions_addclose(&actions, error_pipe[0]);
+  posix_spawn_file_actions_addclose(&actions, error_pipe[1]);
+  const int spawn_error = posix_spawn(&clang->pid, path, &actions, NULL,
+                                      (char* const*)args, environ);
+  posix_spawn_file_actions_destroy(&actions);
+
+  // Only the program uses its ends of the pipes.
+  if (pipe_input) close(input_pipe[0]);
+  close(error_pipe[1]);
+  clang->input_fd = input_pipe[1];
+  clang->error_fd = error_pipe[0];
+  if (plx_unlikely(spawn_error != 0)) {
+    plx_error("could not run `%s`: %s", path, strerror(spawn_error));
+    if (clang->input_fd != -1) close(clang->input_fd);
+    close(clang->error_fd);
+    return false;
+  }
+  return true;
+}
+
+// Waits for Clang to exit, returning its status.
+static int plx_clang_wait(const struct plx_clang* const clang) {
+  int status;
+  while (waitpid(clang->pid, &status, 0) == -1) {
+    if (errno != EINTR) return -1;
+  }
+  return status;
+}
+
+void plx_clang_send(struct plx_clang* const clang,
+                    const struct plx_buffer* const input) {
+  if (clang->input_fd == -1) return;
+  const char* data = input->data;
+  size_t len = input->len;
+  while (len > 0) {
+    const ssize_t written = write(clang->input_fd, data, len);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    data += written;
+    len -= (size_t)written;
+  }
+  close(clang->input_fd);
+  clang->input_fd = -1;
+}
+
+// Writes the input to a program if it reads from a pipe, then waits for it to
+// exit. Its diagnostics are forwarded to standard error. Returns whether it
+// succeeded.
+static bool plx_wait_for(struct plx_clang* const clang,
+                         const struct plx_buffer* const input,
+                         const char* const name) {
+  // Clang reads all of its input before it writes any diagnostics, so the input
+  // can be written in full before standard error is read.
+  if (input != NULL) plx_clang_send(clang, input);
+  if (clang->input_fd != -1) {
+    close(clang->input_fd);
+    clang->input_fd = -1;
+  }
+
+  struct plx_buffer errors = PLX_BUFFER_INIT;
+  for (;;) {
+    char chunk[4096];
+    const ssize_t len = read(clang->error_fd, chunk, sizeof(chunk));
+    if (len < 0 && errno == EINTR) continue;
+    if (len <= 0) break;
+    plx_buffer_append(&errors, chunk, (size_t)len);
+  }
+  close(clang->error_fd);
+  const int status = plx_clang_wait(clang);
+  if (errors.len > 0) fwrite(errors.data, 1, errors.len, stderr);
+  plx_buffer_free(&errors);
+
+  if (plx_unlikely(status == -1)) {
+    plx_error("could not wait for %s", name);
+    return false;
+  }
+  if (plx_unlikely(WIFSIGNALED(status))) {
+    plx_error("%s was terminated by signal %d", name, WTERMSIG(status));
+    return false;
+  }
+  if (plx_unlikely(WEXITSTATUS(status) != 0)) {
+    plx_error("%s failed with exit status %d", name, WEXITSTATUS(status));
+    return false;
+  }
+  return true;
+}
+
+void plx_clang_cancel(struct plx_clang* const clang) {
+  if (clang->input_fd != -1) close(clang->input_fd);
+  close(clang->error_fd);
+  kill(clang->pid, SIGTERM);
+  plx_clang_wait(clang);
+}
+
+#endif  // _WIN32
+
+bool plx_clang_start(struct plx_clang* const clang,
+                     const char* const* const input_filenames,
+                     const size_t input_count,
+                     const char* const output_filename,
+                     const enum plx_emit emit,
+                     const struct plx_compile_options* const options) {
+  const char* const path = plx_find_clang();
+  if (plx_unlikely(path == NULL)) {
+    plx_error("clang is required to use the LLVM back end");
+    return false;
+  }
+  struct plx_clang_args args;
+  plx_clang_args_init(&args, input_filenames, input_count, output_filename,
+                      emit, options);
+  const bool result =
+      plx_spawn(clang, path, args.args, /*pipe_input=*/input_count == 0);
+  plx_clang_args_free(&args);
+  return result;
+}
+
+bool plx_clang_finish(struct plx_clang* const clang,
+                      const struct plx_buffer* const input) {
+  return plx_wait_for(clang, input, "clang");
+}
+
+bool plx_clang_describe(struct plx_buffer* const description,
+                        const enum plx_emit emit,
+                        const struct plx_compile_options* const options) {
+  const char* const path = plx_find_clang();
+  struct stat st;
+  if (plx_unlikely(path == NULL || stat(path, &st) != 0)) {
+    plx_error("clang is required to use the LLVM back end");
+    return false;
+  }
+  plx_buffer_append_str(description, path);
+  plx_buffer_append_char(description, '\0');
+  plx_buffer_append_ull(description, (unsigned long long)st.st_size);
+  plx_buffer_append_char(description, '\0');
+  plx_buffer_append_ll(description, (long long)st.st_mtime);
+  plx_buffer_append_char(description, '\0');
+
+  // The output filename does not affect the output.
+  struct plx_clang_args args;
+  plx_clang_args_init(&args, /*input_filenames=*/NULL, /*input_count=*/0,
+                      /*output_filename=*/"", emit, options);
+  for (size_t i = 1; args.args[i] != NULL; ++i) {
+    plx_buffer_append_str(description, args.args[i]);
+    plx_buffer_append_char(description, '\0');
+  }
+  plx_clang_args_free(&args);
+
+  // The profile is read by Clang, so its contents affect the output.
+  if (options->profile_use != NULL && stat(options->profile_use, &st) == 0) {
+    plx_buffer_append_ull(description, (unsigned long long)st.st_size);
+    plx_buffer_append_char(description, '\0');
+    plx_buffer_append_ll(description, (long long)st.st_mtime);
+  }
+  return true;
+}
+
+bool plx_merge_profiles(const char* const output_filename,
+                        const char* const* const input_filenames,
+                        const size_t count) {
+  char path[PLX_PATH_MAX];
+  if (plx_unlikely(
+          !plx_find_program(PLX_LLVM_PROFDATA_EXE, path, sizeof(path)))) {
+    plx_error("llvm-profdata is required to merge profiles");
+    return false;
+  }
+  const char** const args = malloc((count + 5) * sizeof(*args));
+  if (plx_unlikely(args == NULL)) plx_oom();
+  size_t len = 0;
+  args[len++] = "llvm-profdata";
+  args[len++] = "merge";
+  args[len++] = "-o";
+  args[len++] = output_filename;
+  for (size_t i = 0; i < count; ++i) args[len++] = input_filenames[i];
+  args[len] = NULL;
+
+  struct plx_clang process;
+  const bool result =
+      plx_spawn(&process, path, args, /*pipe_input=*/false) &&
+      plx_wait_for(&process, /*input=*/NULL, "llvm-profdata");
+  free(args);
+  return result;
+}
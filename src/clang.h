@@ -0,0 +1,81 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_CLANG_H
+#define PLX_CLANG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "buffer.h"
+#include "compiler.h"
+
+#ifdef _WIN32
+#include <stdio.h>
+#else
+#include <sys/types.h>
+#endif  // _WIN32
+
+// Clang process that compiles LLVM IR or bitcode, or links an object file.
+struct plx_clang {
+#ifdef _WIN32
+  // Pipe to Clang's standard input.
+  FILE* input;
+#else
+  pid_t pid;
+
+  // Write end of the pipe to Clang's standard input, or -1 if Clang reads a
+  // file.
+  int input_fd;
+
+  // Read end of the pipe from Clang's standard error.
+  int error_fd;
+#endif  // _WIN32
+};
+
+// Starts Clang, which produces the given kind of output (`PLX_EMIT_ASM`,
+// `PLX_EMIT_OBJ` or `PLX_EMIT_EXE`) with the optimization and target options.
+// If there are no input files, Clang reads LLVM IR or bitcode from a pipe that
+// is written by `plx_clang_send` or `plx_clang_finish`. Clang is searched for
+// in `PATH` once and the result is cached.
+bool plx_clang_start(struct plx_clang* clang,
+                     const char* const* input_filenames, size_t input_count,
+                     const char* output_filename, enum plx_emit emit,
+                     const struct plx_compile_options* options);
+
+// Writes the input to Clang and closes the pipe without waiting for Clang to
+// exit, so that several Clang processes can run at once.
+void plx_clang_send(struct plx_clang* clang, const struct plx_buffer* input);
+
+// Writes the input to Clang if it reads from a pipe, then waits for it to exit.
+// Clang's diagnostics are forwarded to standard error. Returns whether Clang
+// succeeded.
+bool plx_clang_finish(struct plx_clang* clang, const struct plx_buffer* input);
+
+// Appends a description of Clang and the arguments it is run with for the given
+// output and options to the buffer, which identifies its output for caching.
+// Clang is described by its path, size and modification time rather than by
+// running it. Returns whether Clang was found.
+bool plx_clang_describe(struct plx_buffer* description, enum plx_emit emit,
+                        const struct plx_compile_options* options);
+
+// Stops Clang without giving it any input.
+void plx_clang_cancel(struct plx_clang* clang);
+
+// Merges raw profiles written by instrumented executables into a profile for
+// `--profile-use` with `llvm-profdata`. Returns whether it succeeded.
+bool plx_merge_profiles(const char* output_filename,
+                        const char* const* input_filenames, size_t count);
+
+#endif  // PLX_CLANG_H
@@ -0,0 +1,665 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "common_subexpr_eliminator.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "macros.h"
+#include "symbol_table.h"
+#include "symbol_table_entry.h"
+#include "types.h"
+
+// Expression that has been evaluated on every path to the current statement
+// and whose operands have not changed since.
+struct plx_available_expr {
+  // First occurrence of the expression, or `NULL` once it is no longer
+  // available.
+  struct plx_node* node;
+  uint64_t hash;
+
+  // Statement that evaluates the first occurrence, and the block that contains
+  // it, before which a temporary holding the expression is defined.
+  struct plx_node* stmt;
+  struct plx_node* block;
+
+  // Temporary holding the expression, or `NULL` until the expression is
+  // evaluated again.
+  struct plx_symbol_table_entry* temp;
+};
+
+// Store that may change the values of expressions.
+struct plx_store {
+  // Local variable that is assigned, or `NULL`.
+  const struct plx_symbol_table_entry* var;
+
+  // Whether memory that may be aliased is written: global variables, local
+  // variables whose address is taken, and what references and slices point
+  // to.
+  bool memory;
+};
+
+struct plx_common_subexpr_eliminator {
+  FILE* report;
+
+  // Available expressions in the order they were found. Those of a block are
+  // dropped when it ends.
+  size_t len;
+  size_t cap;
+  struct plx_available_expr* exprs;
+
+  // Local variables of the current function that a reference or slice may
+  // point into.
+  size_t escaped_len;
+  size_t escaped_cap;
+  const struct plx_symbol_table_entry** escaped;
+
+  // Number of expressions eliminated in the current function.
+  size_t eliminated;
+};
+
+// Name of the temporaries, which are only referred to through their entries.
+static char plx_temp_name[] = "$cse";
+
+// Returns whether an expression contains a call.
+static bool plx_contains_call(const struct plx_node* const node) {
+  if (node->kind == PLX_NODE_CALL) return true;
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    if (plx_contains_call(child)) return true;
+  }
+  return false;
+}
+
+// Returns whether a node is part of an expression.
+static bool plx_contains_node(const struct plx_node* const expr,
+                              const struct plx_node* const node) {
+  if (expr == node) return true;
+  for (const struct plx_node* child = expr->children; child != NULL;
+       child = child->next) {
+    if (plx_contains_node(child, node)) return true;
+  }
+  return false;
+}
+
+// Records that a reference or slice may point into a local variable.
+static void plx_add_escaped_var(
+    struct plx_common_subexpr_eliminator* const eliminator,
+    const struct plx_symbol_table_entry* const entry) {
+  if (eliminator->escaped_len == eliminator->escaped_cap) {
+    const size_t cap =
+        eliminator->escaped_cap == 0 ? 8 : eliminator->escaped_cap * 2;
+    const struct plx_symbol_table_entry** const escaped =
+        realloc(eliminator->escaped, cap * sizeof(*escaped));
+    if (plx_unlikely(escaped == NULL)) plx_oom();
+    eliminator->escaped_cap = cap;
+    eliminator->escaped = escaped;
+  }
+  eliminator->escaped[eliminator->escaped_len++] = entry;
+}
+
+// Collects the local variables that references and slices may point into.
+// Taking the address of an element or field does not mark the variable as
+// referenced.
+static void plx_collect_escaped_vars(
+    struct plx_common_subexpr_eliminator* const eliminator,
+    const struct plx_node* const node) {
+  if (node->kind == PLX_NODE_REF || node->kind == PLX_NODE_SLICE) {
+    const struct plx_node* root = node->children;
+    while (root->kind == PLX_NODE_INDEX || root->kind == PLX_NODE_FIELD) {
+      root = root->children;
+    }
+    if (root->kind == PLX_NODE_IDENTIFIER && root->entry != NULL &&
+        root->entry->scope == PLX_SYMBOL_SCOPE_LOCAL) {
+      plx_add_escaped_var(eliminator, root->entry);
+    }
+  }
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    plx_collect_escaped_vars(eliminator, child);
+  }
+}
+
+// Returns whether indexing or accessing a field of a value reads or writes
+// memory that it points to rather than the value itself.
+static bool plx_points_to_memory(const struct plx_node* const value) {
+  return value->type == NULL || value->type->kind == PLX_NODE_SLICE_TYPE ||
+         value->type->kind == PLX_NODE_REF_TYPE;
+}
+
+// Returns whether a variable lives in memory that may be aliased.
+static bool plx_is_aliased_var(
+    const struct plx_common_subexpr_eliminator* const eliminator,
+    const struct plx_symbol_table_entry* const entry) {
+  if (entry->mutability == PLX_SYMBOL_MUTABILITY_CONST) return false;
+  if (entry->scope == PLX_SYMBOL_SCOPE_GLOBAL || entry->referenced) {
+    return true;
+  }
+  for (size_t i = 0; i < eliminator->escaped_len; ++i) {
+    if (eliminator->escaped[i] == entry) return true;
+  }
+  return false;
+}
+
+// Returns whether an expression evaluates to the same value each time its
+// operands do, without side effects.
+static bool plx_is_pure_expr(const struct plx_node* const node) {
+  switch (node->kind) {
+    case PLX_NODE_CALL:
+    case PLX_NODE_REF:
+    case PLX_NODE_SLICE:
+    case PLX_NODE_RANGE:
+    case PLX_NODE_STRUCT:
+    case PLX_NODE_STRING:
+      return false;
+    default:
+      for (const struct plx_node* child = node->children; child != NULL;
+           child = child->next) {
+        if (!plx_is_pure_expr(child)) return false;
+      }
+      return true;
+  }
+}
+
+// Returns whether an expression is worth holding in a temporary when it is
+// evaluated again. Variables and constants are as cheap as the temporary, and
+// aggregates would be copied.
+static bool plx_is_candidate(const struct plx_node* const node) {
+  switch (node->kind) {
+    case PLX_NODE_AND:
+    case PLX_NODE_OR:
+    case PLX_NODE_XOR:
+    case PLX_NODE_EQ:
+    case PLX_NODE_NEQ:
+    case PLX_NODE_LTE:
+    case PLX_NODE_LT:
+    case PLX_NODE_GTE:
+    case PLX_NODE_GT:
+    case PLX_NODE_ADD:
+    case PLX_NODE_SUB:
+    case PLX_NODE_MUL:
+    case PLX_NODE_DIV:
+    case PLX_NODE_REM:
+    case PLX_NODE_LSHIFT:
+    case PLX_NODE_RSHIFT:
+    case PLX_NODE_NOT:
+    case PLX_NODE_NEG:
+    case PLX_NODE_DEREF:
+    case PLX_NODE_INDEX:
+    case PLX_NODE_SELECT:
+    case PLX_NODE_SHUFFLE:
+    case PLX_NODE_REDUCE_ADD:
+    case PLX_NODE_REDUCE_MUL:
+    case PLX_NODE_REDUCE_MIN:
+    case PLX_NODE_REDUCE_MAX:
+    case PLX_NODE_REDUCE_AND:
+    case PLX_NODE_REDUCE_OR:
+    case PLX_NODE_REDUCE_XOR:
+    case PLX_NODE_FIELD:
+      break;
+    default:
+      return false;
+  }
+  return node->type != NULL &&
+         (plx_is_scalar_type(node->type) || plx_is_vec_type(node->type)) &&
+         plx_is_pure_expr(node);
+}
+
+// Returns a hash of an expression that is equal for equal expressions.
+static uint64_t plx_hash_expr(const struct plx_node* const node) {
+  uint64_t hash = node->kind;
+  switch (node->kind) {
+    case PLX_NODE_IDENTIFIER:
+      hash = hash * 31 + (uintptr_t)node->entry;
+      break;
+    case PLX_NODE_BOOL:
+      hash = hash * 31 + node->b;
+      break;
+    case PLX_NODE_BOUNDS_CHECK:
+    case PLX_NODE_S8:
+    case PLX_NODE_S16:
+    case PLX_NODE_S32:
+    case PLX_NODE_S64:
+    case PLX_NODE_U8:
+    case PLX_NODE_U16:
+    case PLX_NODE_U32:
+    case PLX_NODE_U64:
+    case PLX_NODE_F16:
+    case PLX_NODE_F32:
+    case PLX_NODE_F64:
+      hash = hash * 31 + node->uint;
+      break;
+    default:
+      break;
+  }
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    hash = (hash ^ plx_hash_expr(child)) * 0x100000001b3;
+  }
+  return hash;
+}
+
+// Returns whether two expressions compute the same value from the same
+// operands. Floating point constants are compared bitwise.
+static bool plx_exprs_equal(const struct plx_node* const a,
+                            const struct plx_node* const b) {
+  if (a->kind != b->kind) return false;
+  if (a->type != b->type &&
+      (a->type == NULL || b->type == NULL || !plx_type_eq(a->type, b->type))) {
+    return false;
+  }
+  switch (a->kind) {
+    case PLX_NODE_IDENTIFIER:
+      if (a->entry != b->entry) return false;
+      if (a->entry == NULL && strcmp(a->name, b->name) != 0) return false;
+      break;
+    case PLX_NODE_BOOL:
+      if (a->b != b->b) return false;
+      break;
+    case PLX_NODE_BOUNDS_CHECK:
+    case PLX_NODE_S8:
+    case PLX_NODE_S16:
+    case PLX_NODE_S32:
+    case PLX_NODE_S64:
+    case PLX_NODE_U8:
+    case PLX_NODE_U16:
+    case PLX_NODE_U32:
+    case PLX_NODE_U64:
+    case PLX_NODE_F16:
+    case PLX_NODE_F32:
+    case PLX_NODE_F64:
+      if (a->uint != b->uint) return false;
+      break;
+    default:
+      break;
+  }
+  const struct plx_node* child_b = b->children;
+  for (const struct plx_node* child_a = a->children; child_a != NULL;
+       child_a = child_a->next, child_b = child_b->next) {
+    if (child_b == NULL || !plx_exprs_equal(child_a, child_b)) return false;
+  }
+  return child_b == NULL;
+}
+
+// Returns whether a store may change the value of an expression.
+static bool plx_is_clobbered(
+    const struct plx_common_subexpr_eliminator* const eliminator,
+    const struct plx_node* const node, const struct plx_store* const store) {
+  switch (node->kind) {
+    case PLX_NODE_IDENTIFIER:
+      return node->entry != NULL &&
+             (node->entry == store->var ||
+              (store->memory && plx_is_aliased_var(eliminator, node->entry)));
+    case PLX_NODE_DEREF:
+      if (store->memory) return true;
+      break;
+    case PLX_NODE_INDEX:
+    case PLX_NODE_FIELD:
+      if (store->memory && plx_points_to_memory(node->children)) return true;
+      break;
+    default:
+      break;
+  }
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    if (plx_is_clobbered(eliminator, child, store)) return true;
+  }
+  return false;
+}
+
+// Makes the expressions that a store may change unavailable.
+static void plx_apply_store(
+    struct plx_common_subexpr_eliminator* const eliminator,
+    const struct plx_store* const store) {
+  for (size_t i = 0; i < eliminator->len; ++i) {
+    struct plx_available_expr* const expr = &eliminator->exprs[i];
+    if (expr->node != NULL &&
+        plx_is_clobbered(eliminator, expr->node, store)) {
+      expr->node = NULL;
+    }
+  }
+}
+
+// Returns the store of an assignment to an assignee.
+static struct plx_store plx_assignee_store(
+    const struct plx_common_subexpr_eliminator* const eliminator,
+    const struct plx_node* const assignee) {
+  const struct plx_store memory = {NULL, true};
+  switch (assignee->kind) {
+    case PLX_NODE_IDENTIFIER: {
+      const struct plx_store store = {
+          assignee->entry, plx_is_aliased_var(eliminator, assignee->entry)};
+      return store;
+    }
+    case PLX_NODE_INDEX:
+    case PLX_NODE_FIELD:
+      if (plx_points_to_memory(assignee->children)) return memory;
+      return plx_assignee_store(eliminator, assignee->children);
+    default:
+      return memory;
+  }
+}
+
+// Makes the expressions that a statement may change unavailable, such as
+// before a loop whose body runs after them.
+static void plx_apply_stores(
+    struct plx_common_subexpr_eliminator* const eliminator,
+    const struct plx_node* const node) {
+  switch (node->kind) {
+    case PLX_NODE_ASSIGN:
+    case PLX_NODE_ADD_ASSIGN:
+    case PLX_NODE_SUB_ASSIGN:
+    case PLX_NODE_MUL_ASSIGN:
+    case PLX_NODE_DIV_ASSIGN:
+    case PLX_NODE_REM_ASSIGN:
+    case PLX_NODE_LSHIFT_ASSIGN:
+    case PLX_NODE_RSHIFT_ASSIGN: {
+      const struct plx_store store =
+          plx_assignee_store(eliminator, node->children);
+      plx_apply_store(eliminator, &store);
+      break;
+    }
+    case PLX_NODE_CALL: {
+      // The callee may write any memory that may be aliased.
+      const struct plx_store store = {NULL, true};
+      plx_apply_store(eliminator, &store);
+      break;
+    }
+    default:
+      break;
+  }
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    plx_apply_stores(eliminator, child);
+  }
+}
+
+// Defines a temporary holding an available expression before the statement
+// that first evaluates it, and replaces the first occurrence with the
+// temporary.
+static void plx_define_temp(
+    struct plx_common_subexpr_eliminator* const eliminator,
+    struct plx_available_expr* const expr) {
+  struct plx_node* const node = expr->node;
+  struct plx_node* const value = plx_new_node(node->kind, /*loc=*/NULL);
+  *value = *node;
+  value->next = NULL;
+
+  struct plx_symbol_table symbol_table = PLX_SYMBOL_TABLE_INIT;
+  struct plx_symbol_table_entry* const temp =
+      plx_declare_symbol(&symbol_table, plx_temp_name);
+  temp->decl = &value->loc;
+  temp->type = value->type;
+
+  struct plx_node* const name = plx_new_node(PLX_NODE_IDENTIFIER, &node->loc);
+  name->name = plx_temp_name;
+  name->entry = temp;
+  name->type = temp->type;
+  name->next = value;
+  struct plx_node* const def = plx_new_node(PLX_NODE_VAR_DEF, &node->loc);
+  def->children = name;
+  struct plx_node** link = &expr->block->children;
+  while (*link != expr->stmt) link = &(*link)->next;
+  def->next = expr->stmt;
+  *link = def;
+
+  // The available expressions within the moved one are now evaluated by the
+  // definition.
+  for (size_t i = 0; i < eliminator->len; ++i) {
+    struct plx_available_expr* const other = &eliminator->exprs[i];
+    if (other->node != NULL && other->stmt == expr->stmt &&
+        plx_contains_node(value, other->node)) {
+      other->stmt = def;
+    }
+  }
+
+  node->kind = PLX_NODE_IDENTIFIER;
+  node->name = plx_temp_name;
+  node->entry = temp;
+  node->children = NULL;
+  expr->node = value;
+  expr->stmt = def;
+  expr->temp = temp;
+}
+
+// Replaces an expression with the temporary holding an equal available one,
+// and returns whether there was one.
+static bool plx_reuse_expr(
+    struct plx_common_subexpr_eliminator* const eliminator,
+    struct plx_node* const node) {
+  const uint64_t hash = plx_hash_expr(node);
+  for (size_t i = eliminator->len; i-- > 0;) {
+    struct plx_available_expr* const expr = &eliminator->exprs[i];
+    if (expr->node == NULL || expr->hash != hash ||
+        !plx_exprs_equal(expr->node, node)) {
+      continue;
+    }
+    if (expr->temp == NULL) plx_define_temp(eliminator, expr);
+    node->kind = PLX_NODE_IDENTIFIER;
+    node->name = plx_temp_name;
+    node->entry = expr->temp;
+    node->children = NULL;
+    ++eliminator->eliminated;
+    return true;
+  }
+  return false;
+}
+
+static void plx_eliminate_in_assignee(
+    struct plx_common_subexpr_eliminator* eliminator,
+    struct plx_node* assignee, struct plx_node* stmt, struct plx_node* block);
+
+// Eliminates the common subexpressions of an expression that a statement
+// evaluates, largest first. Unless `block` is `NULL`, the expressions become
+// available, to be held in temporaries defined before the statement.
+static void plx_eliminate_in_expr(
+    struct plx_common_subexpr_eliminator* const eliminator,
+    struct plx_node* const node, struct plx_node* const stmt,
+    struct plx_node* const block) {
+  const bool candidate = plx_is_candidate(node);
+  if (candidate && plx_reuse_expr(eliminator, node)) return;
+  const size_t len = eliminator->len;
+  if (node->kind == PLX_NODE_REF || node->kind == PLX_NODE_SLICE) {
+    // The operand of a reference and the value of a slice stay places.
+    plx_eliminate_in_assignee(eliminator, node->children, stmt, block);
+    for (struct plx_node* child = node->children->next; child != NULL;
+         child = child->next) {
+      plx_eliminate_in_expr(eliminator, child, stmt, block);
+    }
+  } else {
+    for (struct plx_node* child = node->children; child != NULL;
+         child = child->next) {
+      plx_eliminate_in_expr(eliminator, child, stmt, block);
+    }
+  }
+  if (!candidate) return;
+
+  // Eliminating subexpressions may have made the expression equal to an
+  // available one.
+  if (plx_reuse_expr(eliminator, node)) {
+    eliminator->len = len;
+    return;
+  }
+  if (block == NULL) return;
+  if (eliminator->len == eliminator->cap) {
+    const size_t cap = eliminator->cap == 0 ? 16 : eliminator->cap * 2;
+    struct plx_available_expr* const exprs =
+        realloc(eliminator->exprs, cap * sizeof(*exprs));
+    if (plx_unlikely(exprs == NULL)) plx_oom();
+    eliminator->cap = cap;
+    eliminator->exprs = exprs;
+  }
+  eliminator->exprs[eliminator->len++] = (struct plx_available_expr){
+      node, plx_hash_expr(node), stmt, block, NULL};
+}
+
+// Eliminates the common subexpressions of the expressions that an assignee
+// evaluates to find where to store.
+static void plx_eliminate_in_assignee(
+    struct plx_common_subexpr_eliminator* const eliminator,
+    struct plx_node* const assignee, struct plx_node* const stmt,
+    struct plx_node* const block) {
+  switch (assignee->kind) {
+    case PLX_NODE_IDENTIFIER:
+      break;
+    case PLX_NODE_INDEX:
+    case PLX_NODE_FIELD:
+      if (plx_points_to_memory(assignee->children)) {
+        plx_eliminate_in_expr(eliminator, assignee->children, stmt, block);
+      } else {
+        plx_eliminate_in_assignee(eliminator, assignee->children, stmt, block);
+      }
+      for (struct plx_node* child = assignee->children->next; child != NULL;
+           child = child->next) {
+        plx_eliminate_in_expr(eliminator, child, stmt, block);
+      }
+      break;
+    default:
+      for (struct plx_node* child = assignee->children; child != NULL;
+           child = child->next) {
+        plx_eliminate_in_expr(eliminator, child, stmt, block);
+      }
+  }
+}
+
+// Returns the block that a statement's expressions may be hoisted into. A
+// call may write what the expressions read, so they are not hoisted above it,
+// and it makes the expressions that read such memory unavailable.
+static struct plx_node* plx_hoisting_block(
+    struct plx_common_subexpr_eliminator* const eliminator,
+    const struct plx_node* const exprs, struct plx_node* const block) {
+  if (!plx_contains_call(exprs)) return block;
+  const struct plx_store store = {NULL, true};
+  plx_apply_store(eliminator, &store);
+  return NULL;
+}
+
+// Eliminates the common subexpressions of a statement. Temporaries are defined
+// in `block`, the block that contains the statement, and the statement's
+// expressions do not become available if it is `NULL`.
+static void plx_eliminate_in_stmt(
+    struct plx_common_subexpr_eliminator* const eliminator,
+    struct plx_node* const node, struct plx_node* const block) {
+  switch (node->kind) {
+    case PLX_NODE_VAR_DEF: {
+      struct plx_node *name, *value;
+      plx_extract_children(node, &name, &value);
+      plx_eliminate_in_expr(eliminator, value, node,
+                            plx_hoisting_block(eliminator, value, block));
+      break;
+    }
+    case PLX_NODE_BLOCK: {
+      const size_t len = eliminator->len;
+      for (struct plx_node* stmt = node->children; stmt != NULL;
+           stmt = stmt->next) {
+        plx_eliminate_in_stmt(eliminator, stmt, node);
+      }
+      eliminator->len = len;
+      break;
+    }
+    case PLX_NODE_IF_THEN_ELSE: {
+      struct plx_node *cond, *then, *els;
+      plx_extract_children(node, &cond, &then, &els);
+      plx_eliminate_in_expr(eliminator, cond, node,
+                            plx_hoisting_block(eliminator, cond, block));
+      plx_eliminate_in_stmt(eliminator, then, NULL);
+      if (els != NULL) plx_eliminate_in_stmt(eliminator, els, NULL);
+      break;
+    }
+    case PLX_NODE_LOOP:
+    case PLX_NODE_WHILE_LOOP: {
+      // The condition and the body only reuse the expressions that the loop
+      // leaves unchanged, and the condition is evaluated on every iteration.
+      plx_apply_stores(eliminator, node);
+      if (node->kind == PLX_NODE_WHILE_LOOP) {
+        plx_eliminate_in_expr(eliminator, node->children, node,
+                              /*block=*/NULL);
+      }
+      struct plx_node* body = node->children;
+      if (node->kind == PLX_NODE_WHILE_LOOP) body = body->next;
+      plx_eliminate_in_stmt(eliminator, body, NULL);
+      break;
+    }
+    case PLX_NODE_FOR_LOOP: {
+      struct plx_node *name, *iterable, *body;
+      plx_extract_children(node, &name, &iterable, &body);
+      plx_eliminate_in_expr(eliminator, iterable, node,
+                            plx_hoisting_block(eliminator, iterable, block));
+      plx_apply_stores(eliminator, body);
+      plx_eliminate_in_stmt(eliminator, body, NULL);
+      break;
+    }
+    case PLX_NODE_RETURN:
+      if (node->children != NULL) {
+        plx_eliminate_in_expr(
+            eliminator, node->children, node,
+            plx_hoisting_block(eliminator, node->children, block));
+      }
+      break;
+    case PLX_NODE_ASSIGN:
+    case PLX_NODE_ADD_ASSIGN:
+    case PLX_NODE_SUB_ASSIGN:
+    case PLX_NODE_MUL_ASSIGN:
+    case PLX_NODE_DIV_ASSIGN:
+    case PLX_NODE_REM_ASSIGN:
+    case PLX_NODE_LSHIFT_ASSIGN:
+    case PLX_NODE_RSHIFT_ASSIGN: {
+      struct plx_node *assignee, *value;
+      plx_extract_children(node, &assignee, &value);
+      struct plx_node* const hoisting_block =
+          plx_hoisting_block(eliminator, node, block);
+      plx_eliminate_in_assignee(eliminator, assignee, node, hoisting_block);
+      plx_eliminate_in_expr(eliminator, value, node, hoisting_block);
+
+      // The store happens after the expressions are evaluated.
+      const struct plx_store store = plx_assignee_store(eliminator, assignee);
+      plx_apply_store(eliminator, &store);
+      break;
+    }
+    default:
+      // Other statements are expressions that are evaluated for the side
+      // effects of their calls, such as `f();`.
+      if (plx_contains_call(node)) {
+        plx_eliminate_in_expr(eliminator, node, node,
+                              plx_hoisting_block(eliminator, node, block));
+      }
+      break;
+  }
+}
+
+void plx_eliminate_common_subexprs(struct plx_node* const module,
+                                   FILE* const report) {
+  struct plx_common_subexpr_eliminator eliminator = {
+      report, 0, 0, NULL, 0, 0, NULL, 0};
+  for (struct plx_node* def = module->children; def != NULL; def = def->next) {
+    if (def->kind != PLX_NODE_FUNC_DEF) continue;
+    struct plx_node *name, *params, *return_type, *body;
+    plx_extract_children(def, &name, &params, &return_type, &body);
+    eliminator.len = 0;
+    eliminator.escaped_len = 0;
+    eliminator.eliminated = 0;
+    plx_collect_escaped_vars(&eliminator, body);
+    plx_eliminate_in_stmt(&eliminator, body, NULL);
+    if (report != NULL && eliminator.eliminated > 0) {
+      fprintf(report, "%s: %zu common subexpressions eliminated\n", name->name,
+              eliminator.eliminated);
+    }
+  }
+  free(eliminator.exprs);
+  free(eliminator.escaped);
+}
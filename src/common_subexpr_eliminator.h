@@ -0,0 +1,32 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_COMMON_SUBEXPR_ELIMINATOR_H
+#define PLX_COMMON_SUBEXPR_ELIMINATOR_H
+
+#include <stdio.h>
+
+#include "ast.h"
+
+// Evaluates each expression that is computed again while its operands keep
+// their values only once, holding it in a temporary variable that the later
+// occurrences use. An expression stays available in the statements that its
+// first occurrence dominates, until a store or call may change a variable or
+// memory that it reads. Loads of local variables whose address is never taken
+// survive stores through references, slices and to globals. The number of
+// expressions that were eliminated in each function is written to `report`
+// unless it is `NULL`.
+void plx_eliminate_common_subexprs(struct plx_node* module, FILE* report);
+
+#endif  // PLX_COMMON_SUBEXPR_ELIMINATOR_H
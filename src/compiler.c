@@ -16,50 +16,246 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "ast.h"
 #include "ast_validator.h"
+#include "bounds_checker.h"
+#include "buffer.h"
+#include "bytecode.h"
+#include "bytecode_generator.h"
+#include "call_graph.h"
+#include "clang.h"
+#include "common_subexpr_eliminator.h"
 #include "constant_folder.h"
+#include "dead_code_eliminator.h"
 #include "dir.h"
+#include "elf.h"
 #include "error.h"
+#include "inliner.h"
+#include "interpreter.h"
+#include "jit.h"
+#include "llvm_bitcode_writer.h"
 #include "llvm_ir_generator.h"
+#include "llvm_native_generator.h"
+#include "loop_invariant_code_motion.h"
 #include "macros.h"
 #include "name_resolver.h"
+#include "object_cache.h"
 #include "parser.h"
 #include "path.h"
 #include "print.h"
 #include "return_checker.h"
 #include "symbol_table.h"
+#include "tail_call_checker.h"
+#include "target.h"
+#include "timer.h"
 #include "tokenizer.h"
 #include "type_checker.h"
 #include "wasm_generator.h"
+#include "x86_64_generator.h"
 
 #define PLX_FILE_EXT ".plx"
 
-static bool plx_clang(const char* const input_filename,
-                      const char* const output_filename,
-                      const enum plx_compile_mode mode) {
-  // Check for Clang.
-  if (system("clang --version") == -1) {
-    plx_error("clang is required to use the LLVM back end");
+// Returns the file extension of the output.
+static const char* plx_emit_ext(const enum plx_emit emit) {
+  switch (emit) {
+    case PLX_EMIT_LL:
+      return ".ll";
+    case PLX_EMIT_BC:
+      return ".bc";
+    case PLX_EMIT_ASM:
+      return ".s";
+    case PLX_EMIT_OBJ:
+      return ".o";
+    case PLX_EMIT_EXE:
+      return ".exe";
+  }
+  return "";
+}
+
+// Writes the buffer to a file, reporting an error if it could not be written.
+static bool plx_write_output(const struct plx_buffer* const buffer,
+                             const char* const filename) {
+  if (plx_unlikely(!plx_buffer_write_file(buffer, filename))) {
+    plx_error("could not write file `%s`", filename);
     return false;
   }
+  return true;
+}
+
+// Codegen unit of the LLVM back end.
+struct plx_llvm_unit {
+  struct plx_clang clang;
+
+  // Whether Clang is running for the unit.
+  bool running;
+
+  // Key of the unit's output in the object cache.
+  struct plx_object_cache_key key;
+
+  char output_filename[PLX_PATH_MAX];
+};
+
+// Returns the key of Clang's output for the input. Returns whether Clang was
+// found.
+static bool plx_llvm_cache_key(const void* const input, const size_t len,
+                               const enum plx_emit emit,
+                               const struct plx_compile_options* const options,
+                               struct plx_object_cache_key* const key) {
+  struct plx_buffer description = PLX_BUFFER_INIT;
+  const bool result = plx_clang_describe(&description, emit, options);
+  plx_object_cache_key_init(key);
+  plx_object_cache_key_update(key, description.data, description.len);
+  plx_object_cache_key_update(key, input, len);
+  plx_buffer_free(&description);
+  return result;
+}
+
+// Generates LLVM IR and compiles it with Clang unless only the IR or bitcode is
+// emitted. The output path has no extension. With several codegen units, each
+// unit is compiled by its own Clang process, and the outputs are numbered or,
+// for executables, linked. Without the object cache, every Clang process is
+// started first, so that they start up while the IR is being generated. With
+// it, a unit's Clang process is only started if its output is not cached, and
+// outputs are stored once Clang succeeds. Clang reads the IR from a pipe.
+static bool plx_compile_llvm(const struct plx_node* const module,
+                             const char* const output_path,
+                             const struct plx_compile_options* const options) {
+  const enum plx_emit emit = options->emit;
+  const unsigned int unit_count =
+      options->codegen_units > 1
+          ? plx_partition_llvm_ir(module, options->codegen_units)
+          : 1;
+  const bool link = emit == PLX_EMIT_EXE && unit_count > 1;
+  const enum plx_emit unit_emit = link ? PLX_EMIT_OBJ : emit;
+  const bool use_clang = unit_emit != PLX_EMIT_LL && unit_emit != PLX_EMIT_BC;
+  const bool use_cache = use_clang && options->cache_dir != NULL;
+  const struct plx_object_cache cache = {options->cache_dir,
+                                         options->cache_max_size};
+  bool stored = false;
+  struct plx_llvm_unit* const units = malloc(unit_count * sizeof(*units));
+  if (plx_unlikely(units == NULL)) plx_oom();
+  for (unsigned int i = 0; i < unit_count; ++i) units[i].running = false;
+
+  bool result = true;
+  for (unsigned int i = 0; i < unit_count && result; ++i) {
+    struct plx_llvm_unit* const unit = &units[i];
+    const int len =
+        unit_count > 1
+            ? snprintf(unit->output_filename, sizeof(unit->output_filename),
+                       "%s.%u%s", output_path, i, plx_emit_ext(unit_emit))
+            : snprintf(unit->output_filename, sizeof(unit->output_filename),
+                       "%s%s", output_path, plx_emit_ext(unit_emit));
+    if (plx_unlikely(len < 0 || (size_t)len >= sizeof(unit->output_filename))) {
+      result = false;
+    } else if (use_clang && !use_cache) {
+      unit->running =
+          plx_clang_start(&unit->clang, /*input_filenames=*/NULL,
+                          /*input_count=*/0, unit->output_filename, unit_emit,
+                          options);
+      result = unit->running;
+    }
+  }
 
-  // Run Clang.
-  switch (mode) {
-    case PLX_COMPILE_MODE_RELEASE:
-      return execlp("clang", "-Wall", input_filename, "-o", output_filename,
-                    "-O3", "-ffast-math", (char*)NULL) != -1;
-    case PLX_COMPILE_MODE_DEBUG:
-      return execlp("clang", "-Wall", input_filename, "-o", output_filename,
-                    "-O0", (char*)NULL) != -1;
+  const char* const triple =
+      options->target != NULL ? options->target : plx_host_triple();
+  for (unsigned int i = 0; i < unit_count && result; ++i) {
+    struct plx_llvm_unit* const unit = &units[i];
+    struct plx_buffer ir = PLX_BUFFER_INIT;
+    plx_generate_llvm_ir_target(triple, plx_data_layout(triple), &ir);
+    if (unit_count > 1) {
+      plx_generate_llvm_ir_unit(module, i, options->fast_math, &ir);
+    } else {
+      plx_generate_llvm_ir(module, options->fast_math, &ir);
+    }
+    if (unit_emit == PLX_EMIT_LL) {
+      result = plx_write_output(&ir, unit->output_filename);
+      plx_buffer_free(&ir);
+      continue;
+    }
+    if (unit_emit == PLX_EMIT_BC) {
+      // Assemble the IR into bitcode, which does not need Clang.
+      struct plx_buffer bitcode = PLX_BUFFER_INIT;
+      result = plx_write_llvm_bitcode(&ir, &bitcode);
+      plx_buffer_free(&ir);
+      if (result) result = plx_write_output(&bitcode, unit->output_filename);
+      plx_buffer_free(&bitcode);
+      continue;
+    }
+
+    if (use_cache) {
+      result =
+          plx_llvm_cache_key(ir.data, ir.len, unit_emit, options, &unit->key);
+      if (result &&
+          !plx_object_cache_fetch(&cache, &unit->key, unit->output_filename)) {
+        unit->running =
+            plx_clang_start(&unit->clang, /*input_filenames=*/NULL,
+                            /*input_count=*/0, unit->output_filename,
+                            unit_emit, options);
+        result = unit->running;
+      }
+    }
+    if (result && unit->running) plx_clang_send(&unit->clang, &ir);
+    plx_buffer_free(&ir);
   }
-  return false;
+
+  // Wait for every Clang process, or stop them if an error occurred.
+  for (unsigned int i = 0; i < unit_count; ++i) {
+    struct plx_llvm_unit* const unit = &units[i];
+    if (!unit->running) continue;
+    if (!result) {
+      plx_clang_cancel(&unit->clang);
+      continue;
+    }
+    result = plx_clang_finish(&unit->clang, /*input=*/NULL);
+    if (result && use_cache) {
+      plx_object_cache_store(&cache, &unit->key, unit->output_filename);
+      stored = true;
+    }
+  }
+
+  // The executable is keyed by the keys of the objects that it is linked from.
+  if (result && link) {
+    char output_filename[PLX_PATH_MAX];
+    snprintf(output_filename, sizeof(output_filename), "%s%s", output_path,
+             plx_emit_ext(PLX_EMIT_EXE));
+    struct plx_object_cache_key key;
+    if (use_cache) {
+      struct plx_object_cache_key* const keys =
+          malloc(unit_count * sizeof(*keys));
+      if (plx_unlikely(keys == NULL)) plx_oom();
+      for (unsigned int i = 0; i < unit_count; ++i) keys[i] = units[i].key;
+      result = plx_llvm_cache_key(keys, unit_count * sizeof(*keys),
+                                  PLX_EMIT_EXE, options, &key);
+      free(keys);
+    }
+    if (result && (!use_cache || !plx_object_cache_fetch(&cache, &key,
+                                                         output_filename))) {
+      const char** const objects = malloc(unit_count * sizeof(*objects));
+      if (plx_unlikely(objects == NULL)) plx_oom();
+      for (unsigned int i = 0; i < unit_count; ++i) {
+        objects[i] = units[i].output_filename;
+      }
+      struct plx_clang clang;
+      result = plx_clang_start(&clang, objects, unit_count, output_filename,
+                               PLX_EMIT_EXE, options) &&
+               plx_clang_finish(&clang, /*input=*/NULL);
+      free(objects);
+      if (result && use_cache) {
+        plx_object_cache_store(&cache, &key, output_filename);
+        stored = true;
+      }
+    }
+  }
+  if (stored) plx_object_cache_trim(&cache);
+  free(units);
+  return result;
 }
 
-bool plx_compile(const char* const input_dir, const char* const output_dir,
-                 const enum plx_compile_mode mode,
-                 const enum plx_back_end back_end) {
+// Parses and checks the PLX files in the input directory, returning the
+// module, or `NULL` on error.
+static struct plx_node* plx_compile_front_end(const char* const input_dir) {
   struct plx_node* const module = plx_new_node(PLX_NODE_MODULE, /*loc=*/NULL);
   struct plx_node** next = &module->children;
   bool result = true;
@@ -68,7 +264,7 @@ bool plx_compile(const char* const input_dir, const char* const output_dir,
   struct plx_dir dir;
   if (!plx_dir_open(&dir, input_dir)) {
     plx_error("could not open directory `%s`", input_dir);
-    return false;
+    return NULL;
   }
   const char* input_base_name;
   bool is_dir;
@@ -85,7 +281,7 @@ bool plx_compile(const char* const input_dir, const char* const output_dir,
     if (plx_unlikely(snprintf(input_filename, sizeof(input_filename), "%s/%s",
                               input_dir, input_base_name) < 0)) {
       plx_dir_close(&dir);
-      return false;
+      return NULL;
     }
 
     // Open the file.
@@ -113,7 +309,7 @@ bool plx_compile(const char* const input_dir, const char* const output_dir,
   plx_dir_close(&dir);
 
   // Stop on error.
-  if (!result) return false;
+  if (!result) return NULL;
 
   // Name resolution
   struct plx_symbol_table symbol_table = PLX_SYMBOL_TABLE_INIT;
@@ -125,16 +321,102 @@ bool plx_compile(const char* const input_dir, const char* const output_dir,
   // Return checking
   if (!plx_check_returns(module)) result = false;
 
+  // Tail call checking
+  if (result && !plx_check_tail_calls(module)) result = false;
+
   // Stop on error.
-  if (!result) return false;
+  if (!result) return NULL;
 
   // Constant folding
   while (plx_fold_constants(module)) {
   }
 
   // AST validation
-  if (!plx_validate_ast(module)) return false;
+  if (!plx_validate_ast(module)) return NULL;
+  return module;
+}
+
+// Returns the largest cost of a call that is inlined at an optimization level.
+static int plx_inline_threshold(const enum plx_opt_level opt_level) {
+  switch (opt_level) {
+    case PLX_OPT_LEVEL_O0:
+      return PLX_INLINE_HINTED_ONLY;
+    case PLX_OPT_LEVEL_O1:
+      return 4;
+    case PLX_OPT_LEVEL_O2:
+      return 8;
+    case PLX_OPT_LEVEL_O3:
+      return 16;
+    case PLX_OPT_LEVEL_OS:
+      return 0;
+  }
+  return 0;
+}
+
+// Returns the size in bytes of the code that the back end generates for a
+// module, storing what the code is in `what`. The LLVM back ends are measured
+// by their LLVM IR.
+static size_t plx_generated_size(
+    const struct plx_node* const module,
+    const struct plx_compile_options* const options, const char** const what) {
+  switch (options->back_end) {
+    case PLX_BACK_END_LLVM:
+    case PLX_BACK_END_LLVM_NATIVE: {
+      *what = "LLVM IR";
+      struct plx_buffer ir = PLX_BUFFER_INIT;
+      plx_generate_llvm_ir(module, options->fast_math, &ir);
+      const size_t size = ir.len;
+      plx_buffer_free(&ir);
+      return size;
+    }
+    case PLX_BACK_END_WASM: {
+      *what = "WebAssembly";
+      return plx_generated_wasm_size(module);
+    }
+    case PLX_BACK_END_X86_64: {
+      *what = "machine code";
+      struct plx_x86_64_object object = PLX_X86_64_OBJECT_INIT;
+      plx_generate_x86_64(module, &object);
+      const size_t size = object.text.len;
+      plx_x86_64_object_free(&object);
+      return size;
+    }
+  }
+  return 0;
+}
 
+// Removes the functions and global variables that the program does not use.
+// If `report_dead_code` is set, they are printed with the bytes of generated
+// code that they would have taken.
+static void plx_eliminate_dead_code(
+    struct plx_node* const module,
+    const struct plx_compile_options* const options) {
+  if (!options->report_dead_code) {
+    plx_eliminate_dead_defs(module, /*report=*/NULL);
+    return;
+  }
+  const char* what;
+  const size_t size = plx_generated_size(module, options, &what);
+  const size_t removed = plx_eliminate_dead_defs(module, stderr);
+  const size_t new_size = plx_generated_size(module, options, &what);
+  fprintf(stderr, "removed %zu unused definitions, saving %zu bytes of %s\n",
+          removed, size > new_size ? size - new_size : 0, what);
+}
+
+// Prints the time since `start` that a pass took if `time_passes` is set, and
+// restarts the timer for the next pass.
+static void plx_end_pass(const struct plx_compile_options* const options,
+                         const char* const pass, uint64_t* const start) {
+  if (!options->time_passes) return;
+  const uint64_t end = plx_time_ns();
+  fprintf(stderr, "%-24s %10.3f ms\n", pass, (double)(end - *start) / 1e6);
+  *start = end;
+}
+
+// Generates the output of the back end into the output directory.
+static bool plx_compile_back_end(
+    const struct plx_node* const module, const char* const output_dir,
+    const struct plx_compile_options* const options) {
   // Determine the output name.
   char full_output_dir[PLX_PATH_MAX];
   if (!plx_path_full(output_dir, full_output_dir)) {
@@ -144,28 +426,64 @@ bool plx_compile(const char* const input_dir, const char* const output_dir,
   const char* const output_name = plx_path_base(full_output_dir);
 
   // Code generation
-  switch (back_end) {
+  const enum plx_emit emit = options->emit;
+  if (plx_unlikely(options->back_end != PLX_BACK_END_LLVM &&
+                   (options->profile_generate ||
+                    options->profile_use != NULL))) {
+    plx_error("profile-guided optimization requires the `llvm` back end");
+    return false;
+  }
+  if (plx_unlikely(options->back_end != PLX_BACK_END_LLVM &&
+                   options->codegen_units > 1)) {
+    plx_error("codegen units require the `llvm` back end");
+    return false;
+  }
+  switch (options->back_end) {
     case PLX_BACK_END_LLVM: {
-      char tmp_filename[PLX_PATH_MAX];
-      if (plx_unlikely(snprintf(tmp_filename, sizeof(tmp_filename), "%s/%s.ll",
+      char output_path[PLX_PATH_MAX];
+      if (plx_unlikely(snprintf(output_path, sizeof(output_path), "%s/%s",
                                 output_dir, output_name) < 0)) {
         return false;
       }
-      FILE* const stream = fopen(tmp_filename, "wb");
-      if (plx_unlikely(stream == NULL)) {
-        plx_error("could not open file `%s`", tmp_filename);
-        return false;
-      }
-      plx_generate_llvm_ir(module, stream);
-      fclose(stream);
+      return plx_compile_llvm(module, output_path, options);
+    }
+    case PLX_BACK_END_LLVM_NATIVE: {
+#ifdef PLX_HAVE_LLVM
       char output_filename[PLX_PATH_MAX];
       if (plx_unlikely(snprintf(output_filename, sizeof(output_filename),
-                                "%s/%s.exe", output_dir, output_name) < 0)) {
+                                "%s/%s%s", output_dir, output_name,
+                                plx_emit_ext(emit)) < 0)) {
+        return false;
+      }
+      if (emit != PLX_EMIT_EXE) {
+        return plx_generate_llvm_native(module, output_filename, emit, options);
+      }
+      char object_filename[PLX_PATH_MAX];
+      if (plx_unlikely(snprintf(object_filename, sizeof(object_filename),
+                                "%s/%s.o", output_dir, output_name) < 0)) {
+        return false;
+      }
+      if (!plx_generate_llvm_native(module, object_filename, PLX_EMIT_OBJ,
+                                    options)) {
         return false;
       }
-      return plx_clang(tmp_filename, output_filename, mode);
+
+      // Clang is only used to link the object file.
+      struct plx_clang clang;
+      const char* const input_filenames[] = {object_filename};
+      return plx_clang_start(&clang, input_filenames, /*input_count=*/1,
+                             output_filename, PLX_EMIT_EXE, options) &&
+             plx_clang_finish(&clang, /*input=*/NULL);
+#else
+      plx_error("the compiler was built without LLVM");
+      return false;
+#endif  // PLX_HAVE_LLVM
     }
     case PLX_BACK_END_WASM: {
+      if (plx_unlikely(emit != PLX_EMIT_EXE)) {
+        plx_error("the WebAssembly back end only emits modules");
+        return false;
+      }
       char output_filename[PLX_PATH_MAX];
       if (plx_unlikely(snprintf(output_filename, sizeof(output_filename),
                                 "%s/%s.wasm", output_dir, output_name) < 0)) {
@@ -180,7 +498,129 @@ bool plx_compile(const char* const input_dir, const char* const output_dir,
       fclose(stream);
       return result;
     }
+    case PLX_BACK_END_X86_64: {
+      if (plx_unlikely(emit != PLX_EMIT_OBJ && emit != PLX_EMIT_EXE)) {
+        plx_error(
+            "the x86-64 back end only emits object files and executables");
+        return false;
+      }
+      struct plx_x86_64_object object = PLX_X86_64_OBJECT_INIT;
+      if (!plx_generate_x86_64(module, &object)) {
+        plx_x86_64_object_free(&object);
+        return false;
+      }
+      struct plx_buffer elf = PLX_BUFFER_INIT;
+      plx_write_elf(&object, &elf);
+      plx_x86_64_object_free(&object);
+      char object_filename[PLX_PATH_MAX];
+      if (plx_unlikely(snprintf(object_filename, sizeof(object_filename),
+                                "%s/%s.o", output_dir, output_name) < 0)) {
+        plx_buffer_free(&elf);
+        return false;
+      }
+      const bool written = plx_write_output(&elf, object_filename);
+      plx_buffer_free(&elf);
+      if (!written || emit == PLX_EMIT_OBJ) return written;
+
+      // The object file is linked by the system linker through Clang.
+      char output_filename[PLX_PATH_MAX];
+      if (plx_unlikely(snprintf(output_filename, sizeof(output_filename),
+                                "%s/%s%s", output_dir, output_name,
+                                plx_emit_ext(PLX_EMIT_EXE)) < 0)) {
+        return false;
+      }
+      struct plx_clang clang;
+      const char* const input_filenames[] = {object_filename};
+      return plx_clang_start(&clang, input_filenames, /*input_count=*/1,
+                             output_filename, PLX_EMIT_EXE, options) &&
+             plx_clang_finish(&clang, /*input=*/NULL);
+    }
   }
 
   return false;
 }
+
+bool plx_compile(const char* const input_dir, const char* const output_dir,
+                 const struct plx_compile_options* const options) {
+  uint64_t start = plx_time_ns();
+  struct plx_node* const module = plx_compile_front_end(input_dir);
+  if (module == NULL) return false;
+  plx_end_pass(options, "front end", &start);
+
+  struct plx_call_graph call_graph;
+  plx_build_call_graph(module, &call_graph);
+  plx_end_pass(options, "call graph", &start);
+  if (options->dump_call_graph == PLX_CALL_GRAPH_FORMAT_DOT) {
+    plx_print_call_graph_dot(&call_graph, stdout);
+  } else if (options->dump_call_graph == PLX_CALL_GRAPH_FORMAT_JSON) {
+    plx_print_call_graph_json(&call_graph, stdout);
+  }
+  const bool inlined =
+      plx_inline_calls(&call_graph, plx_inline_threshold(options->opt_level),
+                       options->report_inlining ? stderr : NULL);
+  plx_call_graph_free(&call_graph);
+  if (inlined) {
+    while (plx_fold_constants(module)) {
+    }
+  }
+  plx_end_pass(options, "inlining", &start);
+
+  plx_insert_bounds_checks(module, options->bounds_checks,
+                           options->report_bounds_checks ? stderr : NULL);
+  plx_end_pass(options, "bounds checks", &start);
+  if (options->opt_level != PLX_OPT_LEVEL_O0) {
+    plx_hoist_loop_invariants(
+        module, options->report_loop_invariants ? stderr : NULL);
+    plx_end_pass(options, "loop invariants", &start);
+    plx_eliminate_common_subexprs(
+        module, options->report_common_subexprs ? stderr : NULL);
+    plx_end_pass(options, "common subexpressions", &start);
+  }
+  plx_eliminate_dead_code(module, options);
+  plx_end_pass(options, "dead code elimination", &start);
+
+  const bool result = plx_compile_back_end(module, output_dir, options);
+  plx_end_pass(options, "code generation", &start);
+  return result;
+}
+
+bool plx_run(const char* const input_dir, const int argc,
+             const char* const argv[],
+             const struct plx_run_options* const options,
+             int* const exit_code) {
+  const uint64_t start = plx_time_ns();
+  struct plx_node* const module = plx_compile_front_end(input_dir);
+  if (module == NULL) return false;
+  plx_insert_bounds_checks(module, options->bounds_checks, /*report=*/NULL);
+  plx_eliminate_dead_defs(module, /*report=*/NULL);
+  bool result;
+  uint64_t compiled;
+  if (options->interpret) {
+    struct plx_bytecode_program program = PLX_BYTECODE_PROGRAM_INIT;
+    result = plx_generate_bytecode(module, &program);
+    compiled = plx_time_ns();
+    if (result && options->disassemble) {
+      struct plx_buffer listing = PLX_BUFFER_INIT;
+      plx_disassemble_bytecode(&program, &listing);
+      fwrite(listing.data, 1, listing.len, stdout);
+      plx_buffer_free(&listing);
+      *exit_code = 0;
+    } else if (result) {
+      result = plx_interpret(&program, argc, argv, exit_code);
+    }
+    plx_bytecode_program_free(&program);
+  } else {
+    struct plx_x86_64_object object = PLX_X86_64_OBJECT_INIT;
+    result = plx_generate_x86_64(module, &object);
+    compiled = plx_time_ns();
+    if (result) result = plx_jit_run(&object, argc, argv, exit_code);
+    plx_x86_64_object_free(&object);
+  }
+  if (options->print_latency) {
+    const uint64_t end = plx_time_ns();
+    fprintf(stderr, "compile: %.3f ms, run: %.3f ms, total: %.3f ms\n",
+            (double)(compiled - start) / 1e6, (double)(end - compiled) / 1e6,
+            (double)(end - start) / 1e6);
+  }
+  return result;
+}
@@ -24,10 +24,134 @@ enum plx_compile_mode {
 
 enum plx_back_end {
   PLX_BACK_END_LLVM,
+  PLX_BACK_END_LLVM_NATIVE,
   PLX_BACK_END_WASM,
+  PLX_BACK_END_X86_64,
+};
+
+// Output of the LLVM and x86-64 back ends. Every step after the output is
+// skipped.
+enum plx_emit {
+  PLX_EMIT_LL,
+  PLX_EMIT_BC,
+  PLX_EMIT_ASM,
+  PLX_EMIT_OBJ,
+  PLX_EMIT_EXE,
+};
+
+enum plx_opt_level {
+  PLX_OPT_LEVEL_O0,
+  PLX_OPT_LEVEL_O1,
+  PLX_OPT_LEVEL_O2,
+  PLX_OPT_LEVEL_O3,
+  PLX_OPT_LEVEL_OS,
+};
+
+// Link-time optimization.
+enum plx_lto {
+  PLX_LTO_NONE,
+  PLX_LTO_THIN,
+  PLX_LTO_FULL,
+};
+
+// Checking that array indices are in bounds. An index that is out of bounds
+// traps.
+enum plx_bounds_checks {
+  PLX_BOUNDS_CHECKS_OFF,
+  PLX_BOUNDS_CHECKS_ON,
+  // Indices are checked unless they are proven to be in bounds.
+  PLX_BOUNDS_CHECKS_ELIDED,
+};
+
+// Format of the call graph that is printed to standard output.
+enum plx_call_graph_format {
+  PLX_CALL_GRAPH_FORMAT_NONE,
+  PLX_CALL_GRAPH_FORMAT_DOT,
+  PLX_CALL_GRAPH_FORMAT_JSON,
+};
+
+struct plx_compile_options {
+  enum plx_compile_mode mode;
+  enum plx_back_end back_end;
+  enum plx_emit emit;
+  enum plx_opt_level opt_level;
+
+  // Target triple, or `NULL` for the host.
+  const char* target;
+
+  // Target CPU, `"native"` for the host's CPU, or `NULL` for a generic CPU.
+  const char* cpu;
+
+  enum plx_lto lto;
+
+  // Whether floating point math may be reassociated and approximated, which
+  // allows floating point reductions to be vectorized.
+  bool fast_math;
+
+  enum plx_bounds_checks bounds_checks;
+
+  // Whether the number of bounds checks that were elided in each function is
+  // printed.
+  bool report_bounds_checks;
+
+  // Whether the decision to inline or not at each call site is printed.
+  bool report_inlining;
+
+  // Whether the number of loop-invariant expressions that were hoisted out of
+  // the loops of each function is printed.
+  bool report_loop_invariants;
+
+  // Whether the number of common subexpressions that were eliminated in each
+  // function is printed.
+  bool report_common_subexprs;
+
+  // Whether the unused functions and global variables that are removed, and
+  // the bytes of generated code that they would have taken, are printed.
+  bool report_dead_code;
+
+  enum plx_call_graph_format dump_call_graph;
+
+  // Whether the time taken by each pass is printed.
+  bool time_passes;
+
+  // Whether the executable is instrumented to write a raw profile when it
+  // exits.
+  bool profile_generate;
+
+  // Merged profile to optimize with, or `NULL`.
+  const char* profile_use;
+
+  // Maximum number of LLVM modules that functions are split into and that are
+  // compiled in parallel. Zero is treated as one.
+  unsigned int codegen_units;
+
+  // Directory of the cache of Clang's outputs, or `NULL` to always run Clang.
+  const char* cache_dir;
+
+  // Size in bytes that the cache is trimmed to.
+  unsigned long long cache_max_size;
 };
 
 bool plx_compile(const char* input_dir, const char* output_dir,
-                 enum plx_compile_mode mode, enum plx_back_end back_end);
+                 const struct plx_compile_options* options);
+
+struct plx_run_options {
+  // Whether the program is compiled to bytecode and interpreted rather than
+  // compiled to x86-64 machine code in memory.
+  bool interpret;
+
+  // Whether the bytecode is printed instead of being interpreted.
+  bool disassemble;
+
+  // Whether the time taken to compile and run the program is printed.
+  bool print_latency;
+
+  enum plx_bounds_checks bounds_checks;
+};
+
+// Compiles the program in memory and calls its `main` function with the
+// arguments, storing its result in `exit_code`.
+bool plx_run(const char* input_dir, int argc, const char* const argv[],
+             const struct plx_run_options* options, int* exit_code);
 
 #endif  // PLX_COMPILER_H
@@ -15,9 +15,32 @@
 #include "constant_folder.h"
 
 #include <limits.h>
+#include <stdint.h>
 
 #include "symbol_table_entry.h"
 
+// Returns the minimum value of a signed integer constant.
+static long long plx_sint_min(const enum plx_node_kind kind) {
+  switch (kind) {
+    case PLX_NODE_S8:
+      return INT8_MIN;
+    case PLX_NODE_S16:
+      return INT16_MIN;
+    case PLX_NODE_S32:
+      return INT32_MIN;
+    default:
+      return INT64_MIN;
+  }
+}
+
+// Returns whether dividing signed integer constants is undefined, which traps
+// at run time and must not be evaluated by the compiler.
+static bool plx_is_sint_div_undefined(const struct plx_node* const left,
+                                      const struct plx_node* const right) {
+  return right->sint == 0 ||
+         (right->sint == -1 && left->sint == plx_sint_min(left->kind));
+}
+
 static void plx_nop(struct plx_node* const node) {
   node->kind = PLX_NODE_NOP;
   node->children = NULL;
@@ -27,6 +50,12 @@ bool plx_fold_constants(struct plx_node* const node) {
   bool changed = false;
   for (struct plx_node* child = node->children; child != NULL;
        child = child->next) {
+    // Don't replace the name of a constant or the operand of a reference with
+    // a value.
+    if ((node->kind == PLX_NODE_CONST_DEF || node->kind == PLX_NODE_REF) &&
+        child == node->children && child->kind == PLX_NODE_IDENTIFIER) {
+      continue;
+    }
     if (plx_fold_constants(child)) changed = true;
   }
   switch (node->kind) {
@@ -35,8 +64,10 @@ bool plx_fold_constants(struct plx_node* const node) {
       plx_extract_children(node, &name, &value);
       if (name->entry == NULL) break;
       if (!plx_is_constant(value)) break;
+      if (name->entry->value == value) break;
       name->entry->value = value;
-      plx_nop(node);
+      // Keep constants whose address is taken, since they need storage.
+      if (!name->entry->referenced) plx_nop(node);
       changed = true;
       break;
     }
@@ -64,6 +95,36 @@ bool plx_fold_constants(struct plx_node* const node) {
       changed = true;
       break;
     }
+    case PLX_NODE_FOR_LOOP: {
+      struct plx_node *name, *iterable, *body;
+      plx_extract_children(node, &name, &iterable, &body);
+      if (iterable->kind != PLX_NODE_RANGE) break;
+      const struct plx_node *start, *end;
+      plx_extract_children(iterable, &start, &end);
+      if (start->kind != end->kind) break;
+      // Remove loops over empty ranges.
+      switch (start->kind) {
+        case PLX_NODE_S8:
+        case PLX_NODE_S16:
+        case PLX_NODE_S32:
+        case PLX_NODE_S64:
+          if (start->sint < end->sint) break;
+          plx_nop(node);
+          changed = true;
+          break;
+        case PLX_NODE_U8:
+        case PLX_NODE_U16:
+        case PLX_NODE_U32:
+        case PLX_NODE_U64:
+          if (start->uint < end->uint) break;
+          plx_nop(node);
+          changed = true;
+          break;
+        default: {
+        }
+      }
+      break;
+    }
     case PLX_NODE_AND: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
@@ -447,6 +508,7 @@ bool plx_fold_constants(struct plx_node* const node) {
         case PLX_NODE_S16:
         case PLX_NODE_S32:
         case PLX_NODE_S64:
+          if (plx_is_sint_div_undefined(left, right)) break;
           node->kind = left->kind;
           node->sint = left->sint / right->sint;
           node->children = NULL;
@@ -456,6 +518,7 @@ bool plx_fold_constants(struct plx_node* const node) {
         case PLX_NODE_U16:
         case PLX_NODE_U32:
         case PLX_NODE_U64:
+          if (right->uint == 0) break;
           node->kind = left->kind;
           node->uint = left->uint / right->uint;
           node->children = NULL;
@@ -483,6 +546,7 @@ bool plx_fold_constants(struct plx_node* const node) {
         case PLX_NODE_S16:
         case PLX_NODE_S32:
         case PLX_NODE_S64:
+          if (plx_is_sint_div_undefined(left, right)) break;
           node->kind = left->kind;
           node->sint = left->sint % right->sint;
           node->children = NULL;
@@ -492,6 +556,7 @@ bool plx_fold_constants(struct plx_node* const node) {
         case PLX_NODE_U16:
         case PLX_NODE_U32:
         case PLX_NODE_U64:
+          if (right->uint == 0) break;
           node->kind = left->kind;
           node->uint = left->uint % right->uint;
           node->children = NULL;
@@ -0,0 +1,166 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "dead_code_eliminator.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "macros.h"
+
+// Global definition and whether it is used.
+struct plx_def_use {
+  const struct plx_symbol_table_entry* entry;
+  struct plx_node* def;
+  bool used;
+};
+
+struct plx_dead_code_eliminator {
+  // Definitions in order of their entries.
+  size_t def_count;
+  struct plx_def_use* defs;
+
+  // Definitions that are used but whose uses are not yet marked.
+  size_t worklist_len;
+  struct plx_def_use** worklist;
+};
+
+static int plx_compare_def_uses(const void* const a, const void* const b) {
+  const struct plx_symbol_table_entry* const entry_a =
+      ((const struct plx_def_use*)a)->entry;
+  const struct plx_symbol_table_entry* const entry_b =
+      ((const struct plx_def_use*)b)->entry;
+  return entry_a < entry_b ? -1 : entry_a > entry_b ? 1 : 0;
+}
+
+// Marks a definition as used, adding it to the worklist the first time.
+static void plx_mark_used(struct plx_dead_code_eliminator* const eliminator,
+                          struct plx_def_use* const def_use) {
+  if (def_use->used) return;
+  def_use->used = true;
+  eliminator->worklist[eliminator->worklist_len++] = def_use;
+}
+
+// Marks the definitions that a node refers to as used.
+static void plx_mark_uses(struct plx_dead_code_eliminator* const eliminator,
+                          const struct plx_node* const node) {
+  if (node->kind == PLX_NODE_IDENTIFIER && node->entry != NULL) {
+    const struct plx_def_use key = {node->entry, NULL, false};
+    struct plx_def_use* const def_use =
+        bsearch(&key, eliminator->defs, eliminator->def_count,
+                sizeof(*eliminator->defs), plx_compare_def_uses);
+    if (def_use != NULL) plx_mark_used(eliminator, def_use);
+  }
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    plx_mark_uses(eliminator, child);
+  }
+}
+
+// Returns whether a node of a module defines a symbol. Constant folding turns
+// global constants into NOPs, and structs have no symbol.
+static bool plx_is_def(const struct plx_node* const node) {
+  switch (node->kind) {
+    case PLX_NODE_CONST_DEF:
+    case PLX_NODE_VAR_DEF:
+    case PLX_NODE_VAR_DECL:
+    case PLX_NODE_FUNC_DEF:
+      return node->children->entry != NULL;
+    default:
+      return false;
+  }
+}
+
+// Returns whether a definition may be removed when it is unused.
+static bool plx_is_removable_def(const struct plx_node* const def) {
+  return def->kind == PLX_NODE_FUNC_DEF || def->kind == PLX_NODE_VAR_DEF ||
+         def->kind == PLX_NODE_VAR_DECL;
+}
+
+size_t plx_eliminate_dead_defs(struct plx_node* const module,
+                               FILE* const report) {
+  // Collect the definitions, and find `main`.
+  struct plx_dead_code_eliminator eliminator = {0, NULL, 0, NULL};
+  bool has_main = false;
+  for (const struct plx_node* def = module->children; def != NULL;
+       def = def->next) {
+    if (!plx_is_def(def)) continue;
+    ++eliminator.def_count;
+    has_main |= def->kind == PLX_NODE_FUNC_DEF &&
+                strcmp(def->children->name, "main") == 0;
+  }
+  if (!has_main) return 0;
+  eliminator.defs = malloc(eliminator.def_count * sizeof(*eliminator.defs));
+  eliminator.worklist =
+      malloc(eliminator.def_count * sizeof(*eliminator.worklist));
+  if (plx_unlikely(eliminator.defs == NULL || eliminator.worklist == NULL)) {
+    plx_oom();
+  }
+  size_t i = 0;
+  for (struct plx_node* def = module->children; def != NULL; def = def->next) {
+    if (!plx_is_def(def)) continue;
+    eliminator.defs[i++] = (struct plx_def_use){def->children->entry, def,
+                                                 /*used=*/false};
+  }
+  qsort(eliminator.defs, eliminator.def_count, sizeof(*eliminator.defs),
+        plx_compare_def_uses);
+
+  // Mark what `main` and the kept definitions use, transitively.
+  for (i = 0; i < eliminator.def_count; ++i) {
+    const struct plx_node* const def = eliminator.defs[i].def;
+    if (!plx_is_removable_def(def) ||
+        (def->kind == PLX_NODE_FUNC_DEF &&
+         strcmp(def->children->name, "main") == 0)) {
+      plx_mark_used(&eliminator, &eliminator.defs[i]);
+    }
+  }
+  while (eliminator.worklist_len > 0) {
+    const struct plx_node* const def =
+        eliminator.worklist[--eliminator.worklist_len]->def;
+    for (const struct plx_node* child = def->children->next; child != NULL;
+         child = child->next) {
+      plx_mark_uses(&eliminator, child);
+    }
+  }
+
+  // Unlink the unused definitions, keeping the others in order.
+  size_t removed = 0;
+  struct plx_node** next = &module->children;
+  while (*next != NULL) {
+    struct plx_node* const def = *next;
+    const struct plx_def_use* def_use = NULL;
+    if (plx_is_def(def)) {
+      const struct plx_def_use key = {def->children->entry, NULL, false};
+      def_use = bsearch(&key, eliminator.defs, eliminator.def_count,
+                        sizeof(*eliminator.defs), plx_compare_def_uses);
+    }
+    if (def_use == NULL || def_use->used) {
+      next = &def->next;
+      continue;
+    }
+    if (report != NULL) {
+      fprintf(report, "removed unused %s `%s`\n",
+              def->kind == PLX_NODE_FUNC_DEF ? "function" : "variable",
+              def->children->name);
+    }
+    *next = def->next;
+    ++removed;
+  }
+
+  free(eliminator.defs);
+  free(eliminator.worklist);
+  return removed;
+}
@@ -0,0 +1,30 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_DEAD_CODE_ELIMINATOR_H
+#define PLX_DEAD_CODE_ELIMINATOR_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "ast.h"
+
+// Removes the functions and global variables that `main` does not use,
+// directly or through other definitions. Constants and structs are kept and
+// count as used, and nothing is removed from a module without `main`. Each
+// removed definition is written to `report` unless it is `NULL`. Returns the
+// number of removed definitions.
+size_t plx_eliminate_dead_defs(struct plx_node* module, FILE* report);
+
+#endif  // PLX_DEAD_CODE_ELIMINATOR_H
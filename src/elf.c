@@ -0,0 +1,269 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "elf.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// Sections of the ELF file, in the order of their headers.
+enum plx_elf_section {
+  PLX_ELF_SECTION_NULL,
+  PLX_ELF_SECTION_TEXT,
+  PLX_ELF_SECTION_DATA,
+  PLX_ELF_SECTION_RODATA,
+  PLX_ELF_SECTION_BSS,
+  PLX_ELF_SECTION_SYMTAB,
+  PLX_ELF_SECTION_STRTAB,
+  PLX_ELF_SECTION_RELA_TEXT,
+  PLX_ELF_SECTION_SHSTRTAB,
+  PLX_ELF_SECTION_NOTE_GNU_STACK,
+  PLX_ELF_SECTION_COUNT,
+};
+
+// Names of the sections.
+static const char* const plx_elf_section_names[] = {
+    "",        ".text",      ".data",      ".rodata",   ".bss",
+    ".symtab", ".strtab",    ".rela.text", ".shstrtab", ".note.GNU-stack",
+};
+
+// Section header types
+#define PLX_ELF_SHT_PROGBITS 1
+#define PLX_ELF_SHT_SYMTAB 2
+#define PLX_ELF_SHT_STRTAB 3
+#define PLX_ELF_SHT_RELA 4
+#define PLX_ELF_SHT_NOBITS 8
+
+// Section header flags
+#define PLX_ELF_SHF_WRITE 0x1
+#define PLX_ELF_SHF_ALLOC 0x2
+#define PLX_ELF_SHF_EXECINSTR 0x4
+#define PLX_ELF_SHF_INFO_LINK 0x40
+
+// Symbol bindings and types
+#define PLX_ELF_STB_GLOBAL 1
+#define PLX_ELF_STT_OBJECT 1
+#define PLX_ELF_STT_FUNC 2
+
+#define PLX_ELF_HEADER_SIZE 64
+#define PLX_ELF_SECTION_HEADER_SIZE 64
+#define PLX_ELF_SYMBOL_SIZE 24
+#define PLX_ELF_RELA_SIZE 24
+
+// Header of a section.
+struct plx_elf_section_header {
+  uint32_t name;
+  uint32_t type;
+  uint64_t flags;
+  uint64_t offset;
+  uint64_t size;
+  uint32_t link;
+  uint32_t info;
+  uint64_t align;
+  uint64_t entry_size;
+};
+
+// Appends a little-endian integer to the buffer.
+static void plx_elf_append_int(struct plx_buffer* const buffer,
+                               const uint64_t value, const size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    plx_buffer_append_char(buffer, (char)(value >> (i * 8)));
+  }
+}
+
+// Pads the buffer with zeros to a multiple of the alignment.
+static void plx_elf_align(struct plx_buffer* const buffer, const size_t align) {
+  while (buffer->len % align != 0) plx_buffer_append_char(buffer, '\0');
+}
+
+// Appends the contents of a section, aligned, and records where they are.
+static void plx_elf_append_section(struct plx_buffer* const buffer,
+                                   struct plx_elf_section_header* const header,
+                                   const void* const data, const size_t size) {
+  plx_elf_align(buffer, header->align);
+  header->offset = buffer->len;
+  header->size = size;
+  if (size > 0) plx_buffer_append(buffer, data, size);
+}
+
+// Returns the ELF section that holds a section of an object.
+static enum plx_elf_section plx_elf_object_section(
+    const enum plx_x86_64_section section) {
+  switch (section) {
+    case PLX_X86_64_SECTION_TEXT:
+      return PLX_ELF_SECTION_TEXT;
+    case PLX_X86_64_SECTION_DATA:
+      return PLX_ELF_SECTION_DATA;
+    case PLX_X86_64_SECTION_RODATA:
+      return PLX_ELF_SECTION_RODATA;
+    case PLX_X86_64_SECTION_BSS:
+      return PLX_ELF_SECTION_BSS;
+  }
+  return PLX_ELF_SECTION_NULL;
+}
+
+void plx_write_elf(const struct plx_x86_64_object* const object,
+                   struct plx_buffer* const buffer) {
+  struct plx_elf_section_header headers[PLX_ELF_SECTION_COUNT];
+  memset(headers, 0, sizeof(headers));
+
+  // Section names
+  struct plx_buffer shstrtab = PLX_BUFFER_INIT;
+  for (size_t i = 0; i < PLX_ELF_SECTION_COUNT; ++i) {
+    headers[i].name = (uint32_t)shstrtab.len;
+    plx_buffer_append(&shstrtab, plx_elf_section_names[i],
+                      strlen(plx_elf_section_names[i]) + 1);
+  }
+
+  // Symbols. Every symbol is global, so only the null symbol is local.
+  struct plx_buffer symtab = PLX_BUFFER_INIT;
+  struct plx_buffer strtab = PLX_BUFFER_INIT;
+  plx_buffer_append_char(&strtab, '\0');
+  for (size_t i = 0; i < PLX_ELF_SYMBOL_SIZE; ++i) {
+    plx_buffer_append_char(&symtab, '\0');
+  }
+  for (size_t i = 0; i < object->symbol_count; ++i) {
+    const struct plx_x86_64_symbol* const symbol = &object->symbols[i];
+    const unsigned int type = symbol->section == PLX_X86_64_SECTION_TEXT
+                                  ? PLX_ELF_STT_FUNC
+                                  : PLX_ELF_STT_OBJECT;
+    plx_elf_append_int(&symtab, strtab.len, 4);
+    plx_elf_append_int(&symtab, PLX_ELF_STB_GLOBAL << 4 | type, 1);
+    plx_elf_append_int(&symtab, 0, 1);
+    plx_elf_append_int(&symtab, plx_elf_object_section(symbol->section), 2);
+    plx_elf_append_int(&symtab, symbol->offset, 8);
+    plx_elf_append_int(&symtab, symbol->size, 8);
+    plx_buffer_append(&strtab, symbol->name, strlen(symbol->name) + 1);
+  }
+
+  // Relocations. ELF symbols are offset by the null symbol.
+  struct plx_buffer rela = PLX_BUFFER_INIT;
+  for (size_t i = 0; i < object->reloc_count; ++i) {
+    const struct plx_x86_64_reloc* const reloc = &object->relocs[i];
+    plx_elf_append_int(&rela, reloc->offset, 8);
+    plx_elf_append_int(&rela, (uint64_t)(reloc->symbol + 1) << 32 | reloc->type,
+                       8);
+    plx_elf_append_int(&rela, (uint64_t)reloc->addend, 8);
+  }
+
+  headers[PLX_ELF_SECTION_TEXT].type = PLX_ELF_SHT_PROGBITS;
+  headers[PLX_ELF_SECTION_TEXT].flags =
+      PLX_ELF_SHF_ALLOC | PLX_ELF_SHF_EXECINSTR;
+  headers[PLX_ELF_SECTION_TEXT].align = 16;
+  headers[PLX_ELF_SECTION_DATA].type = PLX_ELF_SHT_PROGBITS;
+  headers[PLX_ELF_SECTION_DATA].flags = PLX_ELF_SHF_ALLOC | PLX_ELF_SHF_WRITE;
+  headers[PLX_ELF_SECTION_DATA].align = 8;
+  headers[PLX_ELF_SECTION_RODATA].type = PLX_ELF_SHT_PROGBITS;
+  headers[PLX_ELF_SECTION_RODATA].flags = PLX_ELF_SHF_ALLOC;
+  headers[PLX_ELF_SECTION_RODATA].align = 8;
+  headers[PLX_ELF_SECTION_BSS].type = PLX_ELF_SHT_NOBITS;
+  headers[PLX_ELF_SECTION_BSS].flags = PLX_ELF_SHF_ALLOC | PLX_ELF_SHF_WRITE;
+  headers[PLX_ELF_SECTION_BSS].align = 8;
+  headers[PLX_ELF_SECTION_SYMTAB].type = PLX_ELF_SHT_SYMTAB;
+  headers[PLX_ELF_SECTION_SYMTAB].link = PLX_ELF_SECTION_STRTAB;
+  headers[PLX_ELF_SECTION_SYMTAB].info = 1;
+  headers[PLX_ELF_SECTION_SYMTAB].align = 8;
+  headers[PLX_ELF_SECTION_SYMTAB].entry_size = PLX_ELF_SYMBOL_SIZE;
+  headers[PLX_ELF_SECTION_STRTAB].type = PLX_ELF_SHT_STRTAB;
+  headers[PLX_ELF_SECTION_STRTAB].align = 1;
+  headers[PLX_ELF_SECTION_RELA_TEXT].type = PLX_ELF_SHT_RELA;
+  headers[PLX_ELF_SECTION_RELA_TEXT].flags = PLX_ELF_SHF_INFO_LINK;
+  headers[PLX_ELF_SECTION_RELA_TEXT].link = PLX_ELF_SECTION_SYMTAB;
+  headers[PLX_ELF_SECTION_RELA_TEXT].info = PLX_ELF_SECTION_TEXT;
+  headers[PLX_ELF_SECTION_RELA_TEXT].align = 8;
+  headers[PLX_ELF_SECTION_RELA_TEXT].entry_size = PLX_ELF_RELA_SIZE;
+  headers[PLX_ELF_SECTION_SHSTRTAB].type = PLX_ELF_SHT_STRTAB;
+  headers[PLX_ELF_SECTION_SHSTRTAB].align = 1;
+  // An empty `.note.GNU-stack` section marks the stack as non-executable.
+  headers[PLX_ELF_SECTION_NOTE_GNU_STACK].type = PLX_ELF_SHT_PROGBITS;
+  headers[PLX_ELF_SECTION_NOTE_GNU_STACK].align = 1;
+
+  // The section contents follow the file header, which is filled in last.
+  struct plx_buffer file = PLX_BUFFER_INIT;
+  plx_buffer_reserve(&file, PLX_ELF_HEADER_SIZE);
+  memset(file.data, 0, PLX_ELF_HEADER_SIZE);
+  file.len = PLX_ELF_HEADER_SIZE;
+  plx_elf_append_section(&file, &headers[PLX_ELF_SECTION_TEXT],
+                         object->text.data, object->text.len);
+  plx_elf_append_section(&file, &headers[PLX_ELF_SECTION_DATA],
+                         object->data.data, object->data.len);
+  plx_elf_append_section(&file, &headers[PLX_ELF_SECTION_RODATA],
+                         object->rodata.data, object->rodata.len);
+  headers[PLX_ELF_SECTION_BSS].offset = file.len;
+  headers[PLX_ELF_SECTION_BSS].size = object->bss_size;
+  plx_elf_append_section(&file, &headers[PLX_ELF_SECTION_SYMTAB], symtab.data,
+                         symtab.len);
+  plx_elf_append_section(&file, &headers[PLX_ELF_SECTION_STRTAB], strtab.data,
+                         strtab.len);
+  plx_elf_append_section(&file, &headers[PLX_ELF_SECTION_RELA_TEXT],
+                         rela.data, rela.len);
+  plx_elf_append_section(&file, &headers[PLX_ELF_SECTION_SHSTRTAB],
+                         shstrtab.data, shstrtab.len);
+  headers[PLX_ELF_SECTION_NOTE_GNU_STACK].offset = file.len;
+  plx_buffer_free(&symtab);
+  plx_buffer_free(&strtab);
+  plx_buffer_free(&rela);
+  plx_buffer_free(&shstrtab);
+
+  // Section headers
+  plx_elf_align(&file, 8);
+  const size_t section_headers_offset = file.len;
+  for (size_t i = 0; i < PLX_ELF_SECTION_COUNT; ++i) {
+    const struct plx_elf_section_header* const header = &headers[i];
+    plx_elf_append_int(&file, header->name, 4);
+    plx_elf_append_int(&file, header->type, 4);
+    plx_elf_append_int(&file, header->flags, 8);
+    plx_elf_append_int(&file, /*addr=*/0, 8);
+    plx_elf_append_int(&file, header->offset, 8);
+    plx_elf_append_int(&file, header->size, 8);
+    plx_elf_append_int(&file, header->link, 4);
+    plx_elf_append_int(&file, header->info, 4);
+    plx_elf_append_int(&file, header->align, 8);
+    plx_elf_append_int(&file, header->entry_size, 8);
+  }
+
+  // File header
+  struct plx_buffer header = PLX_BUFFER_INIT;
+  const char ident[] = {// Magic
+                        0x7F, 'E', 'L', 'F',
+                        // 64-bit
+                        2,
+                        // Little-endian
+                        1,
+                        // Version
+                        1,
+                        // System V ABI
+                        0, 0, 0, 0, 0, 0, 0, 0, 0};
+  plx_buffer_append(&header, ident, sizeof(ident));
+  // Relocatable file
+  plx_elf_append_int(&header, 1, 2);
+  // x86-64
+  plx_elf_append_int(&header, 62, 2);
+  plx_elf_append_int(&header, /*version=*/1, 4);
+  plx_elf_append_int(&header, /*entry=*/0, 8);
+  plx_elf_append_int(&header, /*phoff=*/0, 8);
+  plx_elf_append_int(&header, section_headers_offset, 8);
+  plx_elf_append_int(&header, /*flags=*/0, 4);
+  plx_elf_append_int(&header, PLX_ELF_HEADER_SIZE, 2);
+  plx_elf_append_int(&header, /*phentsize=*/0, 2);
+  plx_elf_append_int(&header, /*phnum=*/0, 2);
+  plx_elf_append_int(&header, PLX_ELF_SECTION_HEADER_SIZE, 2);
+  plx_elf_append_int(&header, PLX_ELF_SECTION_COUNT, 2);
+  plx_elf_append_int(&header, PLX_ELF_SECTION_SHSTRTAB, 2);
+  memcpy(file.data, header.data, PLX_ELF_HEADER_SIZE);
+  plx_buffer_free(&header);
+
+  plx_buffer_append(buffer, file.data, file.len);
+  plx_buffer_free(&file);
+}
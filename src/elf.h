@@ -0,0 +1,25 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_ELF_H
+#define PLX_ELF_H
+
+#include "buffer.h"
+#include "x86_64_generator.h"
+
+// Writes an x86-64 object as a relocatable ELF file.
+void plx_write_elf(const struct plx_x86_64_object* object,
+                   struct plx_buffer* buffer);
+
+#endif  // PLX_ELF_H
@@ -0,0 +1,261 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "inliner.h"
+
+#include <stdint.h>
+
+#include "symbol_table_entry.h"
+
+struct plx_inliner {
+  const struct plx_call_graph* graph;
+  int threshold;
+  FILE* log;
+
+  // Name of the function whose calls are being inlined.
+  const char* caller;
+
+  bool changed;
+};
+
+// Returns the number of nodes in an expression.
+static int plx_expr_size(const struct plx_node* const node) {
+  int size = 1;
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    size += plx_expr_size(child);
+  }
+  return size;
+}
+
+// Returns the number of uses of a symbol in an expression.
+static int plx_count_uses(const struct plx_node* const node,
+                          const struct plx_symbol_table_entry* const entry) {
+  if (node->kind == PLX_NODE_IDENTIFIER) return node->entry == entry;
+  int uses = 0;
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    uses += plx_count_uses(child, entry);
+  }
+  return uses;
+}
+
+// Returns whether an expression contains a call.
+static bool plx_contains_call(const struct plx_node* const node) {
+  if (node->kind == PLX_NODE_CALL) return true;
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    if (plx_contains_call(child)) return true;
+  }
+  return false;
+}
+
+// Returns whether a variable keeps its value while an expression is evaluated,
+// which holds for constants and for local variables whose address is never
+// taken.
+static bool plx_is_stable_var(
+    const struct plx_symbol_table_entry* const entry) {
+  return entry != NULL &&
+         (entry->mutability == PLX_SYMBOL_MUTABILITY_CONST ||
+          (entry->scope == PLX_SYMBOL_SCOPE_LOCAL && !entry->referenced));
+}
+
+// Returns whether an expression has the same value wherever it is evaluated
+// within another expression, so it may be evaluated any number of times and in
+// any order.
+static bool plx_is_stable_expr(const struct plx_node* const node) {
+  switch (node->kind) {
+    case PLX_NODE_IDENTIFIER:
+      return plx_is_stable_var(node->entry);
+    case PLX_NODE_CALL:
+    case PLX_NODE_DEREF:
+    case PLX_NODE_INDEX:
+    case PLX_NODE_SLICE:
+    case PLX_NODE_FIELD:
+      return false;
+    default:
+      for (const struct plx_node* child = node->children; child != NULL;
+           child = child->next) {
+        if (!plx_is_stable_expr(child)) return false;
+      }
+      return true;
+  }
+}
+
+// Returns a copy of an expression with the parameters replaced by copies of
+// the arguments.
+static struct plx_node* plx_substitute(const struct plx_node* const node,
+                                       const struct plx_node* const params,
+                                       const struct plx_node* const args) {
+  if (node->kind == PLX_NODE_IDENTIFIER) {
+    const struct plx_node* arg = args->children;
+    for (const struct plx_node* param = params->children; param != NULL;
+         param = param->next, arg = arg->next) {
+      if (param->children->entry == node->entry) return plx_copy_node(arg);
+    }
+  }
+  struct plx_node* const copy = plx_new_node(node->kind, /*loc=*/NULL);
+  *copy = *node;
+  copy->children = NULL;
+  copy->next = NULL;
+  struct plx_node** next = &copy->children;
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    *next = plx_substitute(child, params, args);
+    next = &(*next)->next;
+  }
+  return copy;
+}
+
+// Returns the expression that a function returns if its body consists of a
+// single return statement, or otherwise `NULL`.
+static const struct plx_node* plx_returned_expr(
+    const struct plx_node* const body) {
+  const struct plx_node* const stmt = body->children;
+  if (stmt == NULL || stmt->next != NULL || stmt->kind != PLX_NODE_RETURN) {
+    return NULL;
+  }
+  return stmt->children;
+}
+
+// Returns why a call to a function may not be inlined, or `NULL` if it may,
+// storing the cost of inlining it in `cost`.
+static const char* plx_check_inlining(const struct plx_inliner* const inliner,
+                                      const size_t func,
+                                      const struct plx_node* const args,
+                                      int* const cost) {
+  const struct plx_node* const func_def = inliner->graph->funcs[func];
+  struct plx_node *name, *params, *return_type, *body;
+  plx_extract_children(func_def, &name, &params, &return_type, &body);
+
+  if (func_def->inline_hint == PLX_INLINE_HINT_NEVER) {
+    return "it is marked `noinline`";
+  }
+  if (plx_is_recursive(inliner->graph, func)) return "it is recursive";
+  const struct plx_node* const expr = plx_returned_expr(body);
+  if (expr == NULL) return "its body is not a single return statement";
+
+  // Weigh the nodes that the inlined expression adds against those of the
+  // call, and count each use of a parameter whose argument is a constant as
+  // removed by constant folding.
+  *cost = plx_expr_size(expr) - 2;
+  size_t unstable_args = 0;
+  size_t args_with_calls = 0;
+  int uses_of_arg_with_calls = 0;
+  const struct plx_node* arg = args->children;
+  for (const struct plx_node* param = params->children; param != NULL;
+       param = param->next, arg = arg->next) {
+    const struct plx_symbol_table_entry* const entry = param->children->entry;
+    if (entry->referenced) return "it takes the address of a parameter";
+    const int uses = plx_count_uses(expr, entry);
+    const int arg_size = plx_expr_size(arg);
+    *cost += uses * (arg_size - 1) - arg_size;
+    if (plx_is_constant(arg)) *cost -= uses;
+    if (!plx_is_stable_expr(arg)) {
+      ++unstable_args;
+      if (plx_contains_call(arg)) {
+        ++args_with_calls;
+        uses_of_arg_with_calls = uses;
+      }
+    }
+  }
+
+  // Arguments that may change or have side effects must be evaluated in the
+  // same order and the same number of times as they would be by the call.
+  if (unstable_args > 0) {
+    if (plx_contains_call(expr)) return "its arguments may not be reordered";
+    if (args_with_calls > 1 ||
+        (args_with_calls == 1 &&
+         (unstable_args > 1 || uses_of_arg_with_calls != 1 ||
+          !plx_is_stable_expr(expr)))) {
+      return "its arguments may not be reordered";
+    }
+  }
+
+  if (func_def->inline_hint == PLX_INLINE_HINT_ALWAYS) return NULL;
+  if (inliner->threshold == PLX_INLINE_HINTED_ONLY) {
+    return "it is not marked `inline`";
+  }
+  if (*cost > inliner->threshold) return "its cost exceeds the threshold";
+  return NULL;
+}
+
+// Inlines a call if it is beneficial, replacing the call node in place.
+static void plx_inline_call(struct plx_inliner* const inliner,
+                            struct plx_node* const call) {
+  struct plx_node *callee, *args;
+  plx_extract_children(call, &callee, &args);
+  if (callee->kind != PLX_NODE_IDENTIFIER) return;
+  const size_t func = plx_call_graph_find(inliner->graph, callee->entry);
+  if (func == SIZE_MAX) return;
+
+  int cost = 0;
+  const char* const reason = plx_check_inlining(inliner, func, args, &cost);
+  if (inliner->log != NULL) {
+    fprintf(inliner->log, "%s:%u:%u: ", call->loc.filename, call->loc.line,
+            call->loc.col);
+    if (reason == NULL) {
+      fprintf(inliner->log, "inlined `%s` into `%s` (cost %d)\n",
+              callee->name, inliner->caller, cost);
+    } else {
+      fprintf(inliner->log, "did not inline `%s` into `%s`: %s\n",
+              callee->name, inliner->caller, reason);
+    }
+  }
+  if (reason != NULL) return;
+
+  // Replace the call with the returned expression.
+  struct plx_node *name, *params, *return_type, *body;
+  plx_extract_children(inliner->graph->funcs[func], &name, &params,
+                       &return_type, &body);
+  const struct plx_node* const expr =
+      plx_substitute(plx_returned_expr(body), params, args);
+  struct plx_node* const next = call->next;
+  const struct plx_source_code_location loc = call->loc;
+  const bool tail_call = call->tail_call;
+  *call = *expr;
+  call->next = next;
+  call->loc = loc;
+
+  // A call that the callee returns stays a tail call if the call it replaces
+  // was one, since both have the caller's signature.
+  if (call->kind == PLX_NODE_CALL) {
+    call->tail_call = call->tail_call && tail_call;
+  }
+  inliner->changed = true;
+}
+
+// Inlines the calls in a node and its children, innermost first.
+static void plx_inline_calls_in(struct plx_inliner* const inliner,
+                                struct plx_node* const node) {
+  for (struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    plx_inline_calls_in(inliner, child);
+  }
+  if (node->kind == PLX_NODE_CALL) plx_inline_call(inliner, node);
+}
+
+bool plx_inline_calls(const struct plx_call_graph* const graph,
+                      const int threshold, FILE* const log) {
+  struct plx_inliner inliner = {graph, threshold, log, NULL, false};
+
+  // Callees are visited before their callers, so that the bodies that are
+  // inlined have had their own calls inlined.
+  for (size_t i = 0; i < graph->func_count; ++i) {
+    struct plx_node* const func = graph->funcs[graph->scc_funcs[i]];
+    inliner.caller = func->children->name;
+    plx_inline_calls_in(&inliner, func);
+  }
+  return inliner.changed;
+}
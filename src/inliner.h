@@ -0,0 +1,39 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_INLINER_H
+#define PLX_INLINER_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "ast.h"
+#include "call_graph.h"
+
+// Threshold at which only calls to functions marked `inline` are inlined.
+#define PLX_INLINE_HINTED_ONLY INT_MIN
+
+// Inlines calls to functions whose bodies return a single expression. The cost
+// of a call is the number of nodes it adds to the caller, less the uses of
+// parameters whose arguments are constants, which constant folding removes.
+// Calls whose cost is at most the threshold are inlined, as are calls to
+// functions marked `inline`, while recursive functions and those marked
+// `noinline` are not. Functions are visited bottom-up in the call graph of the
+// module. The decision at each call site is written to `log` unless it is
+// `NULL`. Returns whether any call was inlined.
+bool plx_inline_calls(const struct plx_call_graph* graph, int threshold,
+                      FILE* log);
+
+#endif  // PLX_INLINER_H
@@ -0,0 +1,466 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "interpreter.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "macros.h"
+
+// Number of registers of all active calls.
+#define PLX_INTERPRETER_REG_STACK_SIZE (1 << 20)
+
+// Size in bytes of the frames of all active calls.
+#define PLX_INTERPRETER_MEM_STACK_SIZE (8 << 20)
+
+// Maximum depth of calls.
+#define PLX_INTERPRETER_MAX_DEPTH (1 << 16)
+
+// Instructions are dispatched by jumping through a table of label addresses
+// at the end of every handler where the compiler supports it, rather than
+// through a central switch, so that each handler has its own indirect branch
+// to predict.
+#ifdef __GNUC__
+#define PLX_INTERPRETER_COMPUTED_GOTO
+#endif  // __GNUC__
+
+#ifdef PLX_INTERPRETER_COMPUTED_GOTO
+#define PLX_INTERPRETER_LABEL(name, format) &&plx_interpreter_op_##name,
+#define PLX_INTERPRETER_OP(name) plx_interpreter_op_##name:
+#define PLX_INTERPRETER_NEXT() \
+  do {                         \
+    inst = pc++;               \
+    goto* labels[inst->op];    \
+  } while (0)
+#else
+#define PLX_INTERPRETER_OP(name) case PLX_BYTECODE_OP_##name:
+#define PLX_INTERPRETER_NEXT() continue
+#endif  // PLX_INTERPRETER_COMPUTED_GOTO
+
+// Register operand of the current instruction.
+#define R(operand) regs[inst->operand]
+
+// Handlers of the operations that treat signed and unsigned integers alike.
+// Results are truncated to the type and extended back to 64 bits.
+#define PLX_INTERPRETER_INT_OPS(T, CT, UCT, FIELD)             \
+  PLX_INTERPRETER_OP(ADD_##T) {                                \
+    R(a).FIELD = (CT)(R(b).u + R(c).u);                        \
+    PLX_INTERPRETER_NEXT();                                    \
+  }                                                            \
+  PLX_INTERPRETER_OP(SUB_##T) {                                \
+    R(a).FIELD = (CT)(R(b).u - R(c).u);                        \
+    PLX_INTERPRETER_NEXT();                                    \
+  }                                                            \
+  PLX_INTERPRETER_OP(MUL_##T) {                                \
+    R(a).FIELD = (CT)(R(b).u * R(c).u);                        \
+    PLX_INTERPRETER_NEXT();                                    \
+  }                                                            \
+  PLX_INTERPRETER_OP(SHL_##T) {                                \
+    R(a).FIELD = (CT)(R(b).u << (R(c).u & 63));                \
+    PLX_INTERPRETER_NEXT();                                    \
+  }                                                            \
+  PLX_INTERPRETER_OP(SHR_##T) {                                \
+    R(a).FIELD = (CT)((uint64_t)(UCT)R(b).u >> (R(c).u & 63)); \
+    PLX_INTERPRETER_NEXT();                                    \
+  }                                                            \
+  PLX_INTERPRETER_OP(NEG_##T) {                                \
+    R(a).FIELD = (CT)(0 - R(b).u);                             \
+    PLX_INTERPRETER_NEXT();                                    \
+  }                                                            \
+  PLX_INTERPRETER_OP(NOT_##T) {                                \
+    R(a).FIELD = (CT)~R(b).u;                                  \
+    PLX_INTERPRETER_NEXT();                                    \
+  }
+
+// Handlers of signed division and remainder. Dividing the minimum value by -1
+// wraps rather than trapping.
+#define PLX_INTERPRETER_SINT_OPS(T, CT)                               \
+  PLX_INTERPRETER_OP(DIV_##T) {                                       \
+    if (plx_unlikely(R(c).u == 0)) goto division_by_zero;             \
+    R(a).s = R(c).s == -1 ? (CT)(0 - R(b).u) : (CT)(R(b).s / R(c).s); \
+    PLX_INTERPRETER_NEXT();                                           \
+  }                                                                   \
+  PLX_INTERPRETER_OP(REM_##T) {                                       \
+    if (plx_unlikely(R(c).u == 0)) goto division_by_zero;             \
+    R(a).s = R(c).s == -1 ? 0 : (CT)(R(b).s % R(c).s);                \
+    PLX_INTERPRETER_NEXT();                                           \
+  }
+
+// Handlers of unsigned division and remainder.
+#define PLX_INTERPRETER_UINT_OPS(T, CT)                   \
+  PLX_INTERPRETER_OP(DIV_##T) {                           \
+    if (plx_unlikely(R(c).u == 0)) goto division_by_zero; \
+    R(a).u = (CT)(R(b).u / R(c).u);                       \
+    PLX_INTERPRETER_NEXT();                               \
+  }                                                       \
+  PLX_INTERPRETER_OP(REM_##T) {                           \
+    if (plx_unlikely(R(c).u == 0)) goto division_by_zero; \
+    R(a).u = (CT)(R(b).u % R(c).u);                       \
+    PLX_INTERPRETER_NEXT();                               \
+  }
+
+// Handlers of the operations on a floating point type.
+#define PLX_INTERPRETER_FLOAT_OPS(T, FIELD) \
+  PLX_INTERPRETER_OP(ADD_##T) {             \
+    R(a).FIELD = R(b).FIELD + R(c).FIELD;   \
+    PLX_INTERPRETER_NEXT();                 \
+  }                                         \
+  PLX_INTERPRETER_OP(SUB_##T) {             \
+    R(a).FIELD = R(b).FIELD - R(c).FIELD;   \
+    PLX_INTERPRETER_NEXT();                 \
+  }                                         \
+  PLX_INTERPRETER_OP(MUL_##T) {             \
+    R(a).FIELD = R(b).FIELD * R(c).FIELD;   \
+    PLX_INTERPRETER_NEXT();                 \
+  }                                         \
+  PLX_INTERPRETER_OP(DIV_##T) {             \
+    R(a).FIELD = R(b).FIELD / R(c).FIELD;   \
+    PLX_INTERPRETER_NEXT();                 \
+  }                                         \
+  PLX_INTERPRETER_OP(NEG_##T) {             \
+    R(a).FIELD = -R(b).FIELD;               \
+    PLX_INTERPRETER_NEXT();                 \
+  }                                         \
+  PLX_INTERPRETER_OP(EQ_##T) {              \
+    R(a).u = R(b).FIELD == R(c).FIELD;      \
+    PLX_INTERPRETER_NEXT();                 \
+  }                                         \
+  PLX_INTERPRETER_OP(NEQ_##T) {             \
+    R(a).u = R(b).FIELD != R(c).FIELD;      \
+    PLX_INTERPRETER_NEXT();                 \
+  }                                         \
+  PLX_INTERPRETER_OP(LT_##T) {              \
+    R(a).u = R(b).FIELD < R(c).FIELD;       \
+    PLX_INTERPRETER_NEXT();                 \
+  }                                         \
+  PLX_INTERPRETER_OP(LTE_##T) {             \
+    R(a).u = R(b).FIELD <= R(c).FIELD;      \
+    PLX_INTERPRETER_NEXT();                 \
+  }
+
+// Handler of a load of a type.
+#define PLX_INTERPRETER_LOAD(T, CT, FIELD)   \
+  PLX_INTERPRETER_OP(LOAD_##T) {             \
+    CT value;                                \
+    memcpy(&value, R(b).ptr, sizeof(value)); \
+    R(a).FIELD = value;                      \
+    PLX_INTERPRETER_NEXT();                  \
+  }
+
+// Handler of a store of a type.
+#define PLX_INTERPRETER_STORE(T, CT, FIELD)  \
+  PLX_INTERPRETER_OP(STORE_##T) {            \
+    const CT value = (CT)R(b).FIELD;         \
+    memcpy(R(a).ptr, &value, sizeof(value)); \
+    PLX_INTERPRETER_NEXT();                  \
+  }
+
+// Handler of the address of an array element of a size.
+#define PLX_INTERPRETER_ELEM_ADDR(size)                    \
+  PLX_INTERPRETER_OP(ELEM_ADDR_##size) {                   \
+    R(a).ptr = (char*)R(b).ptr + R(c).s * (int64_t)(size); \
+    PLX_INTERPRETER_NEXT();                                \
+  }
+
+// State of a caller, saved while it calls a function.
+struct plx_interpreter_frame {
+  const struct plx_bytecode_inst* return_pc;
+  union plx_bytecode_value* regs;
+  unsigned char* mem;
+};
+
+bool plx_interpret(const struct plx_bytecode_program* const program,
+                   const int argc, const char* const argv[],
+                   int* const exit_code) {
+  // Find `main`.
+  const struct plx_bytecode_func* main_func = NULL;
+  for (size_t i = 0; i < program->func_count; ++i) {
+    if (strcmp(program->funcs[i].name, "main") == 0) {
+      main_func = &program->funcs[i];
+      break;
+    }
+  }
+  if (plx_unlikely(main_func == NULL)) {
+    plx_error("no `main` function to run");
+    return false;
+  }
+
+  union plx_bytecode_value* const reg_stack =
+      malloc(PLX_INTERPRETER_REG_STACK_SIZE * sizeof(*reg_stack));
+  unsigned char* const mem_stack = malloc(PLX_INTERPRETER_MEM_STACK_SIZE);
+  struct plx_interpreter_frame* const frames =
+      malloc(PLX_INTERPRETER_MAX_DEPTH * sizeof(*frames));
+  unsigned char* const globals = malloc(program->globals.len + 1);
+  if (plx_unlikely(reg_stack == NULL || mem_stack == NULL || frames == NULL ||
+                   globals == NULL)) {
+    plx_oom();
+  }
+  if (program->globals.len > 0) {
+    memcpy(globals, program->globals.data, program->globals.len);
+  }
+
+  const struct plx_bytecode_inst* const code = program->insts;
+  const union plx_bytecode_value* const consts = program->consts;
+  const union plx_bytecode_value* const reg_end =
+      reg_stack + PLX_INTERPRETER_REG_STACK_SIZE;
+  const unsigned char* const mem_end =
+      mem_stack + PLX_INTERPRETER_MEM_STACK_SIZE;
+  union plx_bytecode_value* regs = reg_stack;
+  unsigned char* mem = mem_stack;
+  unsigned char* mem_top = mem_stack + main_func->frame_size;
+  size_t depth = 0;
+  bool result = true;
+
+  // `main` is called like by the C runtime, with the argument count and the
+  // arguments.
+  regs[0].s = argc;
+  regs[1].ptr = (void*)argv;
+  const struct plx_bytecode_inst* pc = code + main_func->start;
+  const struct plx_bytecode_inst* inst;
+  const struct plx_bytecode_func* func;
+
+#ifdef PLX_INTERPRETER_COMPUTED_GOTO
+  static const void* const labels[] = {
+      PLX_BYTECODE_OPS(PLX_INTERPRETER_LABEL)};
+  PLX_INTERPRETER_NEXT();
+#else
+  for (;;) {
+    inst = pc++;
+    switch ((enum plx_bytecode_op)inst->op) {
+#endif  // PLX_INTERPRETER_COMPUTED_GOTO
+
+  PLX_INTERPRETER_OP(NOP) { PLX_INTERPRETER_NEXT(); }
+  PLX_INTERPRETER_OP(MOV) {
+    R(a) = R(b);
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(CONST) {
+    R(a).s = inst->imm;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(CONST_K) {
+    R(a) = consts[inst->imm];
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(FUNC) {
+    R(a).u = (uint64_t)inst->imm + 1;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(LOCAL_ADDR) {
+    R(a).ptr = mem + inst->imm;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(GLOBAL_ADDR) {
+    R(a).ptr = globals + inst->imm;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_ELEM_ADDR(1)
+  PLX_INTERPRETER_ELEM_ADDR(2)
+  PLX_INTERPRETER_ELEM_ADDR(4)
+  PLX_INTERPRETER_ELEM_ADDR(8)
+  PLX_INTERPRETER_LOAD(S8, int8_t, s)
+  PLX_INTERPRETER_LOAD(S16, int16_t, s)
+  PLX_INTERPRETER_LOAD(S32, int32_t, s)
+  PLX_INTERPRETER_LOAD(U8, uint8_t, u)
+  PLX_INTERPRETER_LOAD(U16, uint16_t, u)
+  PLX_INTERPRETER_LOAD(U32, uint32_t, u)
+  PLX_INTERPRETER_LOAD(64, uint64_t, u)
+  PLX_INTERPRETER_LOAD(F32, float, f32)
+  PLX_INTERPRETER_STORE(8, uint8_t, u)
+  PLX_INTERPRETER_STORE(16, uint16_t, u)
+  PLX_INTERPRETER_STORE(32, uint32_t, u)
+  PLX_INTERPRETER_STORE(64, uint64_t, u)
+  PLX_INTERPRETER_STORE(F32, float, f32)
+  PLX_INTERPRETER_INT_OPS(S8, int8_t, uint8_t, s)
+  PLX_INTERPRETER_INT_OPS(S16, int16_t, uint16_t, s)
+  PLX_INTERPRETER_INT_OPS(S32, int32_t, uint32_t, s)
+  PLX_INTERPRETER_INT_OPS(S64, int64_t, uint64_t, s)
+  PLX_INTERPRETER_INT_OPS(U8, uint8_t, uint8_t, u)
+  PLX_INTERPRETER_INT_OPS(U16, uint16_t, uint16_t, u)
+  PLX_INTERPRETER_INT_OPS(U32, uint32_t, uint32_t, u)
+  PLX_INTERPRETER_INT_OPS(U64, uint64_t, uint64_t, u)
+  PLX_INTERPRETER_SINT_OPS(S8, int8_t)
+  PLX_INTERPRETER_SINT_OPS(S16, int16_t)
+  PLX_INTERPRETER_SINT_OPS(S32, int32_t)
+  PLX_INTERPRETER_SINT_OPS(S64, int64_t)
+  PLX_INTERPRETER_UINT_OPS(U8, uint8_t)
+  PLX_INTERPRETER_UINT_OPS(U16, uint16_t)
+  PLX_INTERPRETER_UINT_OPS(U32, uint32_t)
+  PLX_INTERPRETER_UINT_OPS(U64, uint64_t)
+  PLX_INTERPRETER_FLOAT_OPS(F32, f32)
+  PLX_INTERPRETER_FLOAT_OPS(F64, f64)
+  PLX_INTERPRETER_OP(AND) {
+    R(a).u = R(b).u & R(c).u;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(OR) {
+    R(a).u = R(b).u | R(c).u;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(XOR) {
+    R(a).u = R(b).u ^ R(c).u;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(NOT_BOOL) {
+    R(a).u = R(b).u ^ 1;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(EQ) {
+    R(a).u = R(b).u == R(c).u;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(NEQ) {
+    R(a).u = R(b).u != R(c).u;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(LT_S) {
+    R(a).u = R(b).s < R(c).s;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(LT_U) {
+    R(a).u = R(b).u < R(c).u;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(LTE_S) {
+    R(a).u = R(b).s <= R(c).s;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(LTE_U) {
+    R(a).u = R(b).u <= R(c).u;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(JUMP) {
+    pc = code + inst->imm;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(JUMP_IF_FALSE) {
+    if (R(a).u == 0) pc = code + inst->imm;
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(CHECK_INDEX) {
+    if (plx_unlikely(R(a).u >= R(b).u)) {
+      plx_error("index out of bounds");
+      result = false;
+      goto done;
+    }
+    PLX_INTERPRETER_NEXT();
+  }
+  PLX_INTERPRETER_OP(CALL) {
+    func = &program->funcs[inst->imm];
+    goto call;
+  }
+  PLX_INTERPRETER_OP(CALL_INDIRECT) {
+    if (plx_unlikely(R(b).u - 1 >= program->func_count)) {
+      plx_error("call of an invalid function");
+      result = false;
+      goto done;
+    }
+    func = &program->funcs[R(b).u - 1];
+    goto call;
+  }
+  PLX_INTERPRETER_OP(TAIL_CALL) {
+    func = &program->funcs[inst->imm];
+    goto tail_call;
+  }
+  PLX_INTERPRETER_OP(TAIL_CALL_INDIRECT) {
+    if (plx_unlikely(R(b).u - 1 >= program->func_count)) {
+      plx_error("call of an invalid function");
+      result = false;
+      goto done;
+    }
+    func = &program->funcs[R(b).u - 1];
+    goto tail_call;
+  }
+  PLX_INTERPRETER_OP(RET) {
+    if (depth == 0) {
+      *exit_code = (int)R(a).s;
+      goto done;
+    }
+    regs[0] = R(a);
+    goto ret;
+  }
+  PLX_INTERPRETER_OP(RET_VOID) {
+    if (depth == 0) {
+      *exit_code = 0;
+      goto done;
+    }
+    goto ret;
+  }
+  PLX_INTERPRETER_OP(UNREACHABLE) {
+    plx_error("reached the end of a function without returning a value");
+    result = false;
+    goto done;
+  }
+
+  // The callee's registers start at the arguments, and its frame at the top
+  // of the memory stack.
+call: {
+  union plx_bytecode_value* const callee_regs = regs + inst->a;
+  if (plx_unlikely(depth == PLX_INTERPRETER_MAX_DEPTH ||
+                   func->reg_count > (size_t)(reg_end - callee_regs) ||
+                   func->frame_size > (size_t)(mem_end - mem_top))) {
+    plx_error("stack overflow");
+    result = false;
+    goto done;
+  }
+  frames[depth++] = (struct plx_interpreter_frame){pc, regs, mem};
+  regs = callee_regs;
+  mem = mem_top;
+  mem_top += func->frame_size;
+  pc = code + func->start;
+  PLX_INTERPRETER_NEXT();
+}
+
+  // A tail call moves the arguments to the first registers and reuses the
+  // registers and frame of the current call.
+tail_call:
+  if (plx_unlikely(func->reg_count > (size_t)(reg_end - regs) ||
+                   func->frame_size > (size_t)(mem_end - mem))) {
+    plx_error("stack overflow");
+    result = false;
+    goto done;
+  }
+  memmove(regs, regs + inst->a, func->param_count * sizeof(*regs));
+  mem_top = mem + func->frame_size;
+  pc = code + func->start;
+  PLX_INTERPRETER_NEXT();
+
+ret:
+  --depth;
+  mem_top = mem;
+  pc = frames[depth].return_pc;
+  regs = frames[depth].regs;
+  mem = frames[depth].mem;
+  PLX_INTERPRETER_NEXT();
+
+division_by_zero:
+  plx_error("division by zero");
+  result = false;
+  goto done;
+
+#ifndef PLX_INTERPRETER_COMPUTED_GOTO
+    }
+  }
+#endif  // PLX_INTERPRETER_COMPUTED_GOTO
+
+done:
+  free(reg_stack);
+  free(mem_stack);
+  free(frames);
+  free(globals);
+  return result;
+}
@@ -0,0 +1,28 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_INTERPRETER_H
+#define PLX_INTERPRETER_H
+
+#include <stdbool.h>
+
+#include "bytecode.h"
+
+// Interprets a program, calling its `main` function with the arguments. The
+// result of `main` is stored in `exit_code`. Returns false if the program
+// fails at runtime, for example by dividing by zero.
+bool plx_interpret(const struct plx_bytecode_program* program, int argc,
+                   const char* const argv[], int* exit_code);
+
+#endif  // PLX_INTERPRETER_H
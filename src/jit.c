@@ -0,0 +1,132 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "jit.h"
+
+#include <string.h>
+
+#include "error.h"
+#include "macros.h"
+
+#if defined(__x86_64__) && !defined(_WIN32)
+
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Signature that `main` is called with, as by the C runtime.
+typedef int (*plx_jit_main)(int argc, const char* const argv[]);
+
+// Rounds the size up to a multiple of the page size.
+static size_t plx_jit_page_align(const size_t size, const size_t page_size) {
+  return (size + page_size - 1) / page_size * page_size;
+}
+
+bool plx_jit_run(const struct plx_x86_64_object* const object, const int argc,
+                 const char* const argv[], int* const exit_code) {
+  // Find `main`.
+  const struct plx_x86_64_symbol* main_symbol = NULL;
+  for (size_t i = 0; i < object->symbol_count; ++i) {
+    const struct plx_x86_64_symbol* const symbol = &object->symbols[i];
+    if (symbol->section == PLX_X86_64_SECTION_TEXT &&
+        strcmp(symbol->name, "main") == 0) {
+      main_symbol = symbol;
+      break;
+    }
+  }
+  if (plx_unlikely(main_symbol == NULL)) {
+    plx_error("no `main` function to run");
+    return false;
+  }
+
+  // The sections are mapped next to each other on their own pages, so every
+  // 32-bit PC-relative reference reaches its target and each page has a single
+  // protection.
+  const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t text_size = plx_jit_page_align(object->text.len, page_size);
+  const size_t rodata_size = plx_jit_page_align(object->rodata.len, page_size);
+  // The BSS follows the data, aligned as in an object file.
+  const size_t bss_offset = (object->data.len + 7) / 8 * 8;
+  const size_t data_size =
+      plx_jit_page_align(bss_offset + object->bss_size, page_size);
+  const size_t size = text_size + rodata_size + data_size;
+  unsigned char* const base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (plx_unlikely(base == MAP_FAILED)) {
+    plx_error("could not map memory for the program");
+    return false;
+  }
+  unsigned char* sections[4];
+  sections[PLX_X86_64_SECTION_TEXT] = base;
+  sections[PLX_X86_64_SECTION_RODATA] = base + text_size;
+  sections[PLX_X86_64_SECTION_DATA] = base + text_size + rodata_size;
+  sections[PLX_X86_64_SECTION_BSS] =
+      sections[PLX_X86_64_SECTION_DATA] + bss_offset;
+  if (object->text.len > 0) {
+    memcpy(sections[PLX_X86_64_SECTION_TEXT], object->text.data,
+           object->text.len);
+  }
+  if (object->rodata.len > 0) {
+    memcpy(sections[PLX_X86_64_SECTION_RODATA], object->rodata.data,
+           object->rodata.len);
+  }
+  if (object->data.len > 0) {
+    memcpy(sections[PLX_X86_64_SECTION_DATA], object->data.data,
+           object->data.len);
+  }
+
+  // Apply the relocations. PLT32 is resolved like PC32 since every symbol is
+  // defined in the object.
+  for (size_t i = 0; i < object->reloc_count; ++i) {
+    const struct plx_x86_64_reloc* const reloc = &object->relocs[i];
+    const struct plx_x86_64_symbol* const symbol =
+        &object->symbols[reloc->symbol];
+    unsigned char* const field = base + reloc->offset;
+    const int32_t value =
+        (int32_t)((sections[symbol->section] + symbol->offset) - field +
+                  reloc->addend);
+    memcpy(field, &value, sizeof(value));
+  }
+
+  // The text becomes executable only once it is no longer writable.
+  if (plx_unlikely(
+          (text_size > 0 &&
+           mprotect(base, text_size, PROT_READ | PROT_EXEC) != 0) ||
+          (rodata_size > 0 &&
+           mprotect(sections[PLX_X86_64_SECTION_RODATA], rodata_size,
+                    PROT_READ) != 0))) {
+    plx_error("could not make the program executable");
+    munmap(base, size);
+    return false;
+  }
+
+  // Call `main`.
+  const void* const entry = base + main_symbol->offset;
+  plx_jit_main main_func;
+  memcpy(&main_func, &entry, sizeof(main_func));
+  *exit_code = main_func(argc, argv);
+
+  munmap(base, size);
+  return true;
+}
+
+#else
+
+bool plx_jit_run(const struct plx_x86_64_object* const object, const int argc,
+                 const char* const argv[], int* const exit_code) {
+  plx_error("running programs in memory requires an x86-64 POSIX host");
+  return false;
+}
+
+#endif  // defined(__x86_64__) && !defined(_WIN32)
@@ -0,0 +1,28 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_JIT_H
+#define PLX_JIT_H
+
+#include <stdbool.h>
+
+#include "x86_64_generator.h"
+
+// Loads an x86-64 object into executable memory, relocating it in place, and
+// calls its `main` function with the arguments. The result of `main` is
+// stored in `exit_code`.
+bool plx_jit_run(const struct plx_x86_64_object* object, int argc,
+                 const char* const argv[], int* exit_code);
+
+#endif  // PLX_JIT_H
@@ -18,21 +18,26 @@
 #include <limits.h>
 #include <stdbool.h>
 
-void plx_write_leb128_ull(FILE* const stream, unsigned long long value) {
+size_t plx_encode_leb128_ull(unsigned char bytes[PLX_LEB128_MAX_LEN],
+                             unsigned long long value) {
+  size_t len = 0;
   do {
     unsigned char byte = (unsigned char)(value & 0b01111111);
     value >>= 7;
     if (value != 0) byte |= 0b10000000;
-    fwrite(&byte, sizeof(byte), 1, stream);
+    bytes[len++] = byte;
   } while (value != 0);
+  return len;
 }
 
-void plx_write_leb128_ll(FILE* const stream, long long value) {
+size_t plx_encode_leb128_ll(unsigned char bytes[PLX_LEB128_MAX_LEN],
+                            long long value) {
   // Requires two's complement.
   assert(-1 == ~0);
   const bool IS_ARITHMETIC_RIGHT_SHIFT = -1LL >> 1 == -1LL;
   bool more = true;
   const bool negative = value < 0;
+  size_t len = 0;
   do {
     unsigned char byte = (unsigned char)(value & 0b01111111);
     value >>= 7;
@@ -45,6 +50,104 @@ void plx_write_leb128_ll(FILE* const stream, long long value) {
     } else {
       byte |= 0b10000000;
     }
-    fwrite(&byte, sizeof(byte), 1, stream);
+    bytes[len++] = byte;
   } while (more);
+  return len;
+}
+
+void plx_encode_leb128_u32_padded(unsigned char bytes[PLX_LEB128_PADDED_LEN],
+                                  uint32_t value) {
+  for (size_t i = 0; i < PLX_LEB128_PADDED_LEN - 1; ++i) {
+    bytes[i] = (unsigned char)((value & 0b01111111) | 0b10000000);
+    value >>= 7;
+  }
+  bytes[PLX_LEB128_PADDED_LEN - 1] = (unsigned char)value;
+}
+
+size_t plx_decode_leb128_ull(const unsigned char* const bytes, const size_t len,
+                             unsigned long long* const value) {
+  unsigned long long result = 0;
+  for (size_t i = 0; i < len && i < PLX_LEB128_MAX_LEN; ++i) {
+    const unsigned char byte = bytes[i];
+
+    // The last byte of a 64-bit integer only holds its top bit.
+    if (i == PLX_LEB128_MAX_LEN - 1 && byte > 1) return 0;
+
+    result |= (unsigned long long)(byte & 0b01111111) << (7 * i);
+    if ((byte & 0b10000000) == 0) {
+      *value = result;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+size_t plx_decode_leb128_ll(const unsigned char* const bytes, const size_t len,
+                            long long* const value) {
+  unsigned long long result = 0;
+  for (size_t i = 0; i < len && i < PLX_LEB128_MAX_LEN; ++i) {
+    const unsigned char byte = bytes[i];
+
+    // The last byte of a 64-bit integer only holds its sign bit, so its other
+    // bits must be copies of it.
+    if (i == PLX_LEB128_MAX_LEN - 1 && byte != 0 && byte != 0b01111111) {
+      return 0;
+    }
+
+    result |= (unsigned long long)(byte & 0b01111111) << (7 * i);
+    if ((byte & 0b10000000) == 0) {
+      // Sign extend from the last bit that was read.
+      const unsigned int shift = 7 * (i + 1);
+      if (shift < sizeof(result) * CHAR_BIT && (byte & 0b01000000) != 0) {
+        result |= ~0ULL << shift;
+      }
+
+      // Requires two's complement.
+      *value = (long long)result;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+void plx_write_leb128_ull(FILE* const stream, const unsigned long long value) {
+  unsigned char bytes[PLX_LEB128_MAX_LEN];
+  const size_t len = plx_encode_leb128_ull(bytes, value);
+  fwrite(bytes, sizeof(*bytes), len, stream);
+}
+
+void plx_write_leb128_ll(FILE* const stream, const long long value) {
+  unsigned char bytes[PLX_LEB128_MAX_LEN];
+  const size_t len = plx_encode_leb128_ll(bytes, value);
+  fwrite(bytes, sizeof(*bytes), len, stream);
+}
+
+void plx_append_leb128_ull(struct plx_buffer* const buffer,
+                           const unsigned long long value) {
+  // Encode straight into the buffer's spare capacity.
+  plx_buffer_reserve(buffer, PLX_LEB128_MAX_LEN);
+  buffer->len += plx_encode_leb128_ull(
+      (unsigned char*)&buffer->data[buffer->len], value);
+}
+
+void plx_append_leb128_ll(struct plx_buffer* const buffer,
+                          const long long value) {
+  // Encode straight into the buffer's spare capacity.
+  plx_buffer_reserve(buffer, PLX_LEB128_MAX_LEN);
+  buffer->len += plx_encode_leb128_ll(
+      (unsigned char*)&buffer->data[buffer->len], value);
+}
+
+size_t plx_append_leb128_placeholder(struct plx_buffer* const buffer) {
+  const size_t offset = buffer->len;
+  plx_buffer_reserve(buffer, PLX_LEB128_PADDED_LEN);
+  plx_encode_leb128_u32_padded((unsigned char*)&buffer->data[buffer->len], 0);
+  buffer->len += PLX_LEB128_PADDED_LEN;
+  return offset;
+}
+
+void plx_patch_leb128_u32(struct plx_buffer* const buffer, const size_t offset,
+                          const uint32_t value) {
+  assert(offset + PLX_LEB128_PADDED_LEN <= buffer->len);
+  plx_encode_leb128_u32_padded((unsigned char*)&buffer->data[offset], value);
 }
@@ -15,14 +15,64 @@
 #ifndef PLX_LEB128_H
 #define PLX_LEB128_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
-// Writes an unsigned integer to an output stream in LEB128 format.
+#include "buffer.h"
+
+// Maximum number of bytes in the LEB128 encoding of a 64-bit integer.
+#define PLX_LEB128_MAX_LEN 10
+
+// Number of bytes in the padded LEB128 encoding of a 32-bit unsigned integer.
+#define PLX_LEB128_PADDED_LEN 5
+
+// Encodes an unsigned integer in LEB128 format, returning the number of bytes.
 // https://en.wikipedia.org/wiki/LEB128#Encode_unsigned_integer
+size_t plx_encode_leb128_ull(unsigned char bytes[PLX_LEB128_MAX_LEN],
+                             unsigned long long value);
+
+// Encodes a signed integer in LEB128 format, returning the number of bytes.
+// https://en.wikipedia.org/wiki/LEB128#Encode_signed_integer
+size_t plx_encode_leb128_ll(unsigned char bytes[PLX_LEB128_MAX_LEN],
+                            long long value);
+
+// Encodes a 32-bit unsigned integer in LEB128 format, padded with continuation
+// bytes to exactly `PLX_LEB128_PADDED_LEN` bytes.
+void plx_encode_leb128_u32_padded(unsigned char bytes[PLX_LEB128_PADDED_LEN],
+                                  uint32_t value);
+
+// Decodes an unsigned integer in LEB128 format, returning the number of bytes
+// read, or zero if the encoding is truncated or does not fit in the value.
+// https://en.wikipedia.org/wiki/LEB128#Decode_unsigned_integer
+size_t plx_decode_leb128_ull(const unsigned char* bytes, size_t len,
+                             unsigned long long* value);
+
+// Decodes a signed integer in LEB128 format, returning the number of bytes
+// read, or zero if the encoding is truncated or does not fit in the value.
+// https://en.wikipedia.org/wiki/LEB128#Decode_signed_integer
+size_t plx_decode_leb128_ll(const unsigned char* bytes, size_t len,
+                            long long* value);
+
+// Writes an unsigned integer to an output stream in LEB128 format.
 void plx_write_leb128_ull(FILE* stream, unsigned long long value);
 
 // Writes a signed integer to an output stream in LEB128 format.
-// https://en.wikipedia.org/wiki/LEB128#Encode_signed_integer
 void plx_write_leb128_ll(FILE* stream, long long value);
 
+// Appends an unsigned integer to the buffer in LEB128 format.
+void plx_append_leb128_ull(struct plx_buffer* buffer, unsigned long long value);
+
+// Appends a signed integer to the buffer in LEB128 format.
+void plx_append_leb128_ll(struct plx_buffer* buffer, long long value);
+
+// Appends a padded LEB128 placeholder to the buffer, returning its offset so
+// that it can be patched once the value is known.
+size_t plx_append_leb128_placeholder(struct plx_buffer* buffer);
+
+// Patches a placeholder appended by `plx_append_leb128_placeholder` with a
+// 32-bit unsigned integer.
+void plx_patch_leb128_u32(struct plx_buffer* buffer, size_t offset,
+                          uint32_t value);
+
 #endif  // PLX_LEB128_H
@@ -0,0 +1,1951 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "llvm_bitcode_writer.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitstream.h"
+#include "error.h"
+#include "macros.h"
+
+// Block IDs
+enum {
+  PLX_LLVM_BC_MODULE_BLOCK = 8,
+  PLX_LLVM_BC_PARAMATTR_BLOCK = 9,
+  PLX_LLVM_BC_PARAMATTR_GROUP_BLOCK = 10,
+  PLX_LLVM_BC_CONSTANTS_BLOCK = 11,
+  PLX_LLVM_BC_FUNCTION_BLOCK = 12,
+  PLX_LLVM_BC_IDENTIFICATION_BLOCK = 13,
+  PLX_LLVM_BC_TYPE_BLOCK = 17,
+  PLX_LLVM_BC_STRTAB_BLOCK = 23,
+};
+
+// Record codes in the identification block
+enum {
+  PLX_LLVM_BC_IDENTIFICATION_STRING = 1,
+  PLX_LLVM_BC_IDENTIFICATION_EPOCH = 2,
+};
+
+// Record codes in the attribute blocks
+enum {
+  PLX_LLVM_BC_PARAMATTR_ENTRY = 2,
+  PLX_LLVM_BC_PARAMATTR_GROUP_ENTRY = 3,
+};
+
+// Record codes in the module block
+enum {
+  PLX_LLVM_BC_MODULE_VERSION = 1,
+  PLX_LLVM_BC_MODULE_TRIPLE = 2,
+  PLX_LLVM_BC_MODULE_DATALAYOUT = 3,
+  PLX_LLVM_BC_MODULE_GLOBALVAR = 7,
+  PLX_LLVM_BC_MODULE_FUNCTION = 8,
+};
+
+// Record codes in the type block
+enum {
+  PLX_LLVM_BC_TYPE_NUMENTRY = 1,
+  PLX_LLVM_BC_TYPE_VOID = 2,
+  PLX_LLVM_BC_TYPE_FLOAT = 3,
+  PLX_LLVM_BC_TYPE_DOUBLE = 4,
+  PLX_LLVM_BC_TYPE_INTEGER = 7,
+  PLX_LLVM_BC_TYPE_HALF = 10,
+  PLX_LLVM_BC_TYPE_ARRAY = 11,
+  PLX_LLVM_BC_TYPE_VECTOR = 12,
+  PLX_LLVM_BC_TYPE_STRUCT_ANON = 18,
+  PLX_LLVM_BC_TYPE_STRUCT_NAME = 19,
+  PLX_LLVM_BC_TYPE_STRUCT_NAMED = 20,
+  PLX_LLVM_BC_TYPE_FUNCTION = 21,
+  PLX_LLVM_BC_TYPE_OPAQUE_POINTER = 25,
+};
+
+// Record codes in the constants block
+enum {
+  PLX_LLVM_BC_CONSTANT_SETTYPE = 1,
+  PLX_LLVM_BC_CONSTANT_NULL = 2,
+  PLX_LLVM_BC_CONSTANT_INTEGER = 4,
+  PLX_LLVM_BC_CONSTANT_FLOAT = 6,
+  PLX_LLVM_BC_CONSTANT_AGGREGATE = 7,
+  PLX_LLVM_BC_CONSTANT_POISON = 26,
+};
+
+// Record codes in the function block
+enum {
+  PLX_LLVM_BC_INST_DECLAREBLOCKS = 1,
+  PLX_LLVM_BC_INST_BINOP = 2,
+  PLX_LLVM_BC_INST_CAST = 3,
+  PLX_LLVM_BC_INST_EXTRACTELT = 6,
+  PLX_LLVM_BC_INST_INSERTELT = 7,
+  PLX_LLVM_BC_INST_SHUFFLEVEC = 8,
+  PLX_LLVM_BC_INST_RET = 10,
+  PLX_LLVM_BC_INST_BR = 11,
+  PLX_LLVM_BC_INST_UNREACHABLE = 15,
+  PLX_LLVM_BC_INST_PHI = 16,
+  PLX_LLVM_BC_INST_ALLOCA = 19,
+  PLX_LLVM_BC_INST_LOAD = 20,
+  PLX_LLVM_BC_INST_EXTRACTVAL = 26,
+  PLX_LLVM_BC_INST_CMP2 = 28,
+  PLX_LLVM_BC_INST_VSELECT = 29,
+  PLX_LLVM_BC_INST_CALL = 34,
+  PLX_LLVM_BC_INST_GEP = 43,
+  PLX_LLVM_BC_INST_STORE = 44,
+  PLX_LLVM_BC_INST_UNOP = 56,
+  PLX_LLVM_BC_INST_FREEZE = 58,
+};
+
+// Record codes in the string table block
+enum {
+  PLX_LLVM_BC_STRTAB_BLOB = 1,
+};
+
+// Width of abbreviation IDs in every block.
+#define PLX_LLVM_BC_ABBREV_WIDTH 3
+
+// Fast-math flags of floating point instructions, excluding the legacy
+// `UnsafeAlgebra` flag.
+#define PLX_LLVM_BC_FAST_MATH_FLAGS 0xfe
+
+// Flags of an integer binary operator that its result does not wrap.
+#define PLX_LLVM_BC_NO_UNSIGNED_WRAP (1 << 0)
+#define PLX_LLVM_BC_NO_SIGNED_WRAP (1 << 1)
+
+// Flags of a call record that it is a tail call, that it must be a tail call,
+// and that the function type is explicit.
+#define PLX_LLVM_BC_CALL_TAIL (1 << 0)
+#define PLX_LLVM_BC_CALL_MUSTTAIL (1 << 14)
+#define PLX_LLVM_BC_CALL_EXPLICIT_TYPE (1 << 15)
+
+// Flag of an alloca record that the allocated type is explicit.
+#define PLX_LLVM_BC_ALLOCA_EXPLICIT_TYPE (1 << 6)
+
+// Opcode of a bitcast instruction.
+#define PLX_LLVM_BC_CAST_BITCAST 11
+
+// Index of the function itself in an attribute group, rather than of its
+// return value or a parameter.
+#define PLX_LLVM_BC_FUNCTION_ATTRS UINT32_MAX
+
+// Marks an undefined block or an absent result.
+#define PLX_LLVM_BC_NONE UINT32_MAX
+
+// Kind of value that an operand refers to.
+enum plx_llvm_bc_value_kind {
+  PLX_LLVM_BC_VALUE_GLOBAL,
+  PLX_LLVM_BC_VALUE_CONSTANT,
+  PLX_LLVM_BC_VALUE_LOCAL,
+};
+
+// Reference to a value, packed as its kind in the upper 32 bits and an index in
+// the lower 32 bits. Value numbers are only known once the whole module has
+// been read.
+typedef uint64_t plx_llvm_bc_value;
+
+// Encoding of an operand in a record.
+enum plx_llvm_bc_op_kind {
+  // Operand that is written as is.
+  PLX_LLVM_BC_OP_LITERAL,
+
+  // Value relative to the instruction.
+  PLX_LLVM_BC_OP_VALUE,
+
+  // Value relative to the instruction, followed by its type if it is a forward
+  // reference.
+  PLX_LLVM_BC_OP_TYPED_VALUE,
+
+  // Value relative to the instruction as a signed integer.
+  PLX_LLVM_BC_OP_SIGNED_VALUE,
+
+  // Absolute value number.
+  PLX_LLVM_BC_OP_ABSOLUTE_VALUE,
+
+  // Basic block, given by its label.
+  PLX_LLVM_BC_OP_BLOCK,
+};
+
+struct plx_llvm_bc_op {
+  enum plx_llvm_bc_op_kind kind;
+  uint64_t value;
+};
+
+struct plx_llvm_bc_type {
+  unsigned int code;
+  size_t ops_begin;
+  size_t ops_len;
+
+  // Name of a named struct type, or `NULL`.
+  const char* name;
+  size_t name_len;
+};
+
+struct plx_llvm_bc_constant {
+  uint32_t type;
+  unsigned int code;
+
+  // Value of a scalar, or index of the first element of a vector among the
+  // constants of the same block. The elements are consecutive.
+  uint64_t value;
+};
+
+struct plx_llvm_bc_global {
+  const char* name;
+  size_t name_len;
+
+  // Whether the global has been defined or declared, rather than only
+  // referenced.
+  bool defined;
+
+  // Whether the global is only declared and is defined in another module.
+  bool external;
+
+  bool is_func;
+  bool is_const;
+  bool unnamed_addr;
+
+  // Set of a function's attributes, with a bit for each entry of
+  // `plx_llvm_bc_attrs`.
+  uint32_t attrs;
+
+  // Value type of a variable or type of a function.
+  uint32_t type;
+
+  // Initializer of a variable.
+  struct plx_llvm_bc_constant init;
+
+  // Index of a function's body.
+  size_t func;
+};
+
+// Kind of definition of a local.
+enum plx_llvm_bc_local_kind {
+  PLX_LLVM_BC_LOCAL_UNDEFINED,
+  PLX_LLVM_BC_LOCAL_ARG,
+  PLX_LLVM_BC_LOCAL_INST,
+  PLX_LLVM_BC_LOCAL_ALIAS,
+};
+
+struct plx_llvm_bc_local {
+  enum plx_llvm_bc_local_kind kind;
+
+  // Index of the argument, or of the instruction among those that produce a
+  // value.
+  uint32_t index;
+
+  // Value that the local is another name for.
+  plx_llvm_bc_value alias;
+
+  uint32_t type;
+};
+
+struct plx_llvm_bc_inst {
+  unsigned int code;
+  size_t ops_begin;
+  size_t ops_len;
+
+  // Whether the instruction produces a value.
+  bool has_value;
+};
+
+// Function body. Locals and labels are indexed by their numbers in the IR.
+struct plx_llvm_bc_func {
+  uint32_t arg_count;
+  uint32_t value_count;
+  uint32_t block_count;
+  size_t insts_begin;
+  size_t insts_len;
+  size_t constants_begin;
+  size_t constants_len;
+  size_t locals_begin;
+  size_t locals_len;
+  size_t labels_begin;
+  size_t labels_len;
+
+  // Constant `i32 1` used as the size of allocas, or `PLX_LLVM_BC_NONE`.
+  uint32_t one;
+};
+
+// Module that has been read from LLVM IR. Every array is grown as needed.
+struct plx_llvm_bc_module {
+  size_t types_cap;
+  size_t types_len;
+  struct plx_llvm_bc_type* types;
+
+  size_t type_ops_cap;
+  size_t type_ops_len;
+  uint64_t* type_ops;
+
+  size_t globals_cap;
+  size_t globals_len;
+  struct plx_llvm_bc_global* globals;
+
+  // Open addressing hash table of global indices plus one, keyed by name.
+  size_t global_table_cap;
+  size_t* global_table;
+
+  size_t funcs_cap;
+  size_t funcs_len;
+  struct plx_llvm_bc_func* funcs;
+
+  size_t insts_cap;
+  size_t insts_len;
+  struct plx_llvm_bc_inst* insts;
+
+  size_t ops_cap;
+  size_t ops_len;
+  struct plx_llvm_bc_op* ops;
+
+  size_t constants_cap;
+  size_t constants_len;
+  struct plx_llvm_bc_constant* constants;
+
+  size_t locals_cap;
+  size_t locals_len;
+  struct plx_llvm_bc_local* locals;
+
+  size_t labels_cap;
+  size_t labels_len;
+  uint32_t* labels;
+
+  // Target triple and data layout, or `NULL`.
+  const char* triple;
+  size_t triple_len;
+  const char* datalayout;
+  size_t datalayout_len;
+};
+
+// Reader for a line of LLVM IR. Errors are sticky, so that a line can be read
+// without checking every step.
+struct plx_llvm_bc_reader {
+  const char* pos;
+  const char* end;
+  bool error;
+};
+
+// Grows an array so that it has room for at least `len` elements.
+static void* plx_llvm_bc_reserve(void* const data, size_t* const cap,
+                                 const size_t len, const size_t size) {
+  if (plx_likely(len <= *cap)) return data;
+  size_t new_cap = *cap == 0 ? 16 : *cap * 2;
+  while (new_cap < len) new_cap *= 2;
+  void* const new_data = realloc(data, new_cap * size);
+  if (plx_unlikely(new_data == NULL)) plx_oom();
+  *cap = new_cap;
+  return new_data;
+}
+
+static plx_llvm_bc_value plx_llvm_bc_pack_value(
+    const enum plx_llvm_bc_value_kind kind, const uint32_t index) {
+  return (uint64_t)kind << 32 | index;
+}
+
+static void plx_llvm_bc_module_free(struct plx_llvm_bc_module* const module) {
+  free(module->types);
+  free(module->type_ops);
+  free(module->globals);
+  free(module->global_table);
+  free(module->funcs);
+  free(module->insts);
+  free(module->ops);
+  free(module->constants);
+  free(module->locals);
+  free(module->labels);
+}
+
+// Adds a type to the type table, returning its index. Types other than named
+// structs are only added once. The operands are the last `ops_len` type
+// operands.
+static uint32_t plx_llvm_bc_add_type(struct plx_llvm_bc_module* const module,
+                                     const unsigned int code,
+                                     const size_t ops_len,
+                                     const char* const name,
+                                     const size_t name_len) {
+  const size_t ops_begin = module->type_ops_len - ops_len;
+  const uint64_t* const ops = &module->type_ops[ops_begin];
+  if (name == NULL) {
+    for (size_t i = 0; i < module->types_len; ++i) {
+      const struct plx_llvm_bc_type* const type = &module->types[i];
+      if (type->code == code && type->name == NULL &&
+          type->ops_len == ops_len &&
+          memcmp(&module->type_ops[type->ops_begin], ops,
+                 ops_len * sizeof(uint64_t)) == 0) {
+        module->type_ops_len = ops_begin;
+        return (uint32_t)i;
+      }
+    }
+  }
+  module->types =
+      plx_llvm_bc_reserve(module->types, &module->types_cap,
+                          module->types_len + 1, sizeof(*module->types));
+  module->types[module->types_len] =
+      (struct plx_llvm_bc_type){code, ops_begin, ops_len, name, name_len};
+  return (uint32_t)module->types_len++;
+}
+
+static void plx_llvm_bc_add_type_op(struct plx_llvm_bc_module* const module,
+                                    const uint64_t op) {
+  module->type_ops =
+      plx_llvm_bc_reserve(module->type_ops, &module->type_ops_cap,
+                          module->type_ops_len + 1, sizeof(uint64_t));
+  module->type_ops[module->type_ops_len++] = op;
+}
+
+// Adds a type with at most one operand.
+static uint32_t plx_llvm_bc_add_simple_type(
+    struct plx_llvm_bc_module* const module, const unsigned int code,
+    const size_t ops_len, const uint64_t op) {
+  if (ops_len > 0) plx_llvm_bc_add_type_op(module, op);
+  return plx_llvm_bc_add_type(module, code, ops_len, NULL, 0);
+}
+
+static uint32_t plx_llvm_bc_add_ptr_type(
+    struct plx_llvm_bc_module* const module) {
+  return plx_llvm_bc_add_simple_type(module, PLX_LLVM_BC_TYPE_OPAQUE_POINTER, 1,
+                                     /*addrspace=*/0);
+}
+
+static uint32_t plx_llvm_bc_add_func_type(
+    struct plx_llvm_bc_module* const module, const uint32_t return_type,
+    const uint32_t* const param_types, const size_t param_count) {
+  plx_llvm_bc_add_type_op(module, /*vararg=*/0);
+  plx_llvm_bc_add_type_op(module, return_type);
+  for (size_t i = 0; i < param_count; ++i) {
+    plx_llvm_bc_add_type_op(module, param_types[i]);
+  }
+  return plx_llvm_bc_add_type(module, PLX_LLVM_BC_TYPE_FUNCTION,
+                              param_count + 2, NULL, 0);
+}
+
+static uint64_t plx_llvm_bc_hash(const char* const name, const size_t len) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ (unsigned char)name[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+// Returns the index of the global with the name, adding it if it has not been
+// seen yet.
+static uint32_t plx_llvm_bc_global(struct plx_llvm_bc_module* const module,
+                                   const char* const name,
+                                   const size_t name_len) {
+  // Keep the hash table at most half full.
+  if (module->globals_len * 2 >= module->global_table_cap) {
+    const size_t cap =
+        module->global_table_cap == 0 ? 64 : module->global_table_cap * 2;
+    size_t* const table = calloc(cap, sizeof(size_t));
+    if (plx_unlikely(table == NULL)) plx_oom();
+    for (size_t i = 0; i < module->globals_len; ++i) {
+      const struct plx_llvm_bc_global* const global = &module->globals[i];
+      size_t slot =
+          plx_llvm_bc_hash(global->name, global->name_len) & (cap - 1);
+      while (table[slot] != 0) slot = (slot + 1) & (cap - 1);
+      table[slot] = i + 1;
+    }
+    free(module->global_table);
+    module->global_table = table;
+    module->global_table_cap = cap;
+  }
+
+  const size_t mask = module->global_table_cap - 1;
+  size_t slot = plx_llvm_bc_hash(name, name_len) & mask;
+  while (module->global_table[slot] != 0) {
+    const size_t index = module->global_table[slot] - 1;
+    const struct plx_llvm_bc_global* const global = &module->globals[index];
+    if (global->name_len == name_len &&
+        memcmp(global->name, name, name_len) == 0) {
+      return (uint32_t)index;
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  module->globals =
+      plx_llvm_bc_reserve(module->globals, &module->globals_cap,
+                          module->globals_len + 1, sizeof(*module->globals));
+  struct plx_llvm_bc_global* const global =
+      &module->globals[module->globals_len];
+  memset(global, 0, sizeof(*global));
+  global->name = name;
+  global->name_len = name_len;
+  module->global_table[slot] = ++module->globals_len;
+  return (uint32_t)(module->globals_len - 1);
+}
+
+// Returns the local of the current function with the given number, adding
+// undefined locals as needed.
+static struct plx_llvm_bc_local* plx_llvm_bc_local(
+    struct plx_llvm_bc_module* const module,
+    struct plx_llvm_bc_func* const func, const uint32_t number) {
+  assert(func->locals_begin + func->locals_len == module->locals_len);
+  if (number >= func->locals_len) {
+    const size_t len = func->locals_begin + number + 1;
+    module->locals = plx_llvm_bc_reserve(module->locals, &module->locals_cap,
+                                         len, sizeof(*module->locals));
+    memset(&module->locals[module->locals_len], 0,
+           (len - module->locals_len) * sizeof(*module->locals));
+    module->locals_len = len;
+    func->locals_len = number + 1;
+  }
+  return &module->locals[func->locals_begin + number];
+}
+
+// Adds a constant to the current function, returning a reference to it.
+static plx_llvm_bc_value plx_llvm_bc_add_constant(
+    struct plx_llvm_bc_module* const module,
+    struct plx_llvm_bc_func* const func,
+    const struct plx_llvm_bc_constant constant) {
+  module->constants = plx_llvm_bc_reserve(
+      module->constants, &module->constants_cap, module->constants_len + 1,
+      sizeof(*module->constants));
+  module->constants[module->constants_len++] = constant;
+  return plx_llvm_bc_pack_value(PLX_LLVM_BC_VALUE_CONSTANT,
+                                (uint32_t)func->constants_len++);
+}
+
+static void plx_llvm_bc_add_op(struct plx_llvm_bc_module* const module,
+                               const enum plx_llvm_bc_op_kind kind,
+                               const uint64_t value) {
+  module->ops = plx_llvm_bc_reserve(module->ops, &module->ops_cap,
+                                    module->ops_len + 1, sizeof(*module->ops));
+  module->ops[module->ops_len++] = (struct plx_llvm_bc_op){kind, value};
+}
+
+// Begins an instruction in the current function. Its operands are the operands
+// that are added until it ends.
+static void plx_llvm_bc_begin_inst(struct plx_llvm_bc_module* const module,
+                                   struct plx_llvm_bc_func* const func,
+                                   const unsigned int code) {
+  module->insts =
+      plx_llvm_bc_reserve(module->insts, &module->insts_cap,
+                          module->insts_len + 1, sizeof(*module->insts));
+  module->insts[module->insts_len++] =
+      (struct plx_llvm_bc_inst){code, module->ops_len, 0, false};
+  ++func->insts_len;
+}
+
+// Ends the current instruction, defining the local that holds its result
+// unless it is `PLX_LLVM_BC_NONE`.
+static void plx_llvm_bc_end_inst(struct plx_llvm_bc_module* const module,
+                                 struct plx_llvm_bc_func* const func,
+                                 const uint32_t result, const uint32_t type) {
+  struct plx_llvm_bc_inst* const inst = &module->insts[module->insts_len - 1];
+  inst->ops_len = module->ops_len - inst->ops_begin;
+  if (result == PLX_LLVM_BC_NONE) return;
+  inst->has_value = true;
+  struct plx_llvm_bc_local* const local =
+      plx_llvm_bc_local(module, func, result);
+  local->kind = PLX_LLVM_BC_LOCAL_INST;
+  local->index = func->value_count++;
+  local->type = type;
+}
+
+// Sign-extends an integer of the given width to 64 bits.
+static uint64_t plx_llvm_bc_sext(uint64_t value, const unsigned int width) {
+  if (width >= 64) return value;
+  const uint64_t sign = (uint64_t)1 << (width - 1);
+  value &= (sign << 1) - 1;
+  return (value ^ sign) - sign;
+}
+
+// Encodes a signed integer with the sign in the lowest bit.
+static uint64_t plx_llvm_bc_signed(const uint64_t value) {
+  if ((int64_t)value >= 0) return value << 1;
+  return (0 - value) << 1 | 1;
+}
+
+// Returns the bits of a double as an IEEE 754 half-precision float, rounding to
+// the nearest value with ties to even.
+static uint64_t plx_llvm_bc_half_bits(const double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  const uint64_t sign = (bits >> 48) & 0x8000;
+  const int exp = (int)((bits >> 52) & 0x7ff);
+  uint64_t mantissa = bits & (((uint64_t)1 << 52) - 1);
+
+  // Infinity and NaN
+  if (exp == 0x7ff) return sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0);
+
+  int half_exp = exp - 1023 + 15;
+  if (half_exp >= 31) return sign | 0x7c00;
+  unsigned int shift = 42;
+  if (half_exp <= 0) {
+    // Subnormal
+    if (half_exp < -10) return sign;
+    mantissa |= (uint64_t)1 << 52;
+    shift = (unsigned int)(43 - half_exp);
+    half_exp = 0;
+  }
+  uint64_t half = sign | (uint64_t)half_exp << 10 | mantissa >> shift;
+  const uint64_t rem = mantissa & (((uint64_t)1 << shift) - 1);
+  const uint64_t halfway = (uint64_t)1 << (shift - 1);
+  // Rounding up may carry into the exponent, which is still correct.
+  if (rem > halfway || (rem == halfway && (half & 1) != 0)) ++half;
+  return half;
+}
+
+static void plx_llvm_bc_skip_spaces(struct plx_llvm_bc_reader* const reader) {
+  while (reader->pos < reader->end &&
+         (*reader->pos == ' ' || *reader->pos == '\t')) {
+    ++reader->pos;
+  }
+}
+
+static bool plx_is_llvm_bc_ident_char(const char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+         (c >= '0' && c <= '9') || c == '_' || c == '.' || c == '$';
+}
+
+// Reads the string if it comes next, even if it is only the start of a word.
+static bool plx_llvm_bc_accept_prefix(struct plx_llvm_bc_reader* const reader,
+                                      const char* const str) {
+  if (reader->error) return false;
+  plx_llvm_bc_skip_spaces(reader);
+  const size_t len = strlen(str);
+  if ((size_t)(reader->end - reader->pos) < len ||
+      memcmp(reader->pos, str, len) != 0) {
+    return false;
+  }
+  reader->pos += len;
+  return true;
+}
+
+// Reads the string if it comes next. Words must not be followed by an
+// identifier character.
+static bool plx_llvm_bc_accept(struct plx_llvm_bc_reader* const reader,
+                               const char* const str) {
+  const char* const pos = reader->pos;
+  if (!plx_llvm_bc_accept_prefix(reader, str)) return false;
+  if (plx_is_llvm_bc_ident_char(str[0]) && reader->pos < reader->end &&
+      plx_is_llvm_bc_ident_char(*reader->pos)) {
+    reader->pos = pos;
+    return false;
+  }
+  return true;
+}
+
+static void plx_llvm_bc_expect(struct plx_llvm_bc_reader* const reader,
+                               const char* const str) {
+  if (!plx_llvm_bc_accept(reader, str)) reader->error = true;
+}
+
+// Reads an identifier, returning its length.
+static size_t plx_llvm_bc_ident(struct plx_llvm_bc_reader* const reader,
+                                const char** const ident) {
+  plx_llvm_bc_skip_spaces(reader);
+  *ident = reader->pos;
+  while (reader->pos < reader->end && plx_is_llvm_bc_ident_char(*reader->pos)) {
+    ++reader->pos;
+  }
+  const size_t len = (size_t)(reader->pos - *ident);
+  if (len == 0) reader->error = true;
+  return len;
+}
+
+static uint64_t plx_llvm_bc_uint(struct plx_llvm_bc_reader* const reader) {
+  plx_llvm_bc_skip_spaces(reader);
+  if (reader->pos == reader->end || *reader->pos < '0' || *reader->pos > '9') {
+    reader->error = true;
+    return 0;
+  }
+  uint64_t value = 0;
+  while (reader->pos < reader->end && *reader->pos >= '0' &&
+         *reader->pos <= '9') {
+    value = value * 10 + (uint64_t)(*reader->pos++ - '0');
+  }
+  return value;
+}
+
+// Reads a numbered local (`%v1`).
+static uint32_t plx_llvm_bc_local_number(
+    struct plx_llvm_bc_reader* const reader) {
+  if (!plx_llvm_bc_accept_prefix(reader, "%v")) reader->error = true;
+  return (uint32_t)plx_llvm_bc_uint(reader);
+}
+
+// Reads a numbered label (`%bb1`).
+static uint32_t plx_llvm_bc_label(struct plx_llvm_bc_reader* const reader) {
+  if (!plx_llvm_bc_accept_prefix(reader, "%bb")) reader->error = true;
+  return (uint32_t)plx_llvm_bc_uint(reader);
+}
+
+// Reads a quoted string without escapes, returning its length.
+static size_t plx_llvm_bc_string(struct plx_llvm_bc_reader* const reader,
+                                 const char** const str) {
+  plx_llvm_bc_expect(reader, "\"");
+  *str = reader->pos;
+  while (reader->pos < reader->end && *reader->pos != '"') ++reader->pos;
+  const size_t len = (size_t)(reader->pos - *str);
+  plx_llvm_bc_expect(reader, "\"");
+  return len;
+}
+
+static uint32_t plx_llvm_bc_type(struct plx_llvm_bc_module* const module,
+                                 struct plx_llvm_bc_reader* const reader) {
+  if (reader->error) return 0;
+  if (plx_llvm_bc_accept(reader, "void")) {
+    return plx_llvm_bc_add_simple_type(module, PLX_LLVM_BC_TYPE_VOID, 0, 0);
+  }
+  if (plx_llvm_bc_accept(reader, "half")) {
+    return plx_llvm_bc_add_simple_type(module, PLX_LLVM_BC_TYPE_HALF, 0, 0);
+  }
+  if (plx_llvm_bc_accept(reader, "float")) {
+    return plx_llvm_bc_add_simple_type(module, PLX_LLVM_BC_TYPE_FLOAT, 0, 0);
+  }
+  if (plx_llvm_bc_accept(reader, "double")) {
+    return plx_llvm_bc_add_simple_type(module, PLX_LLVM_BC_TYPE_DOUBLE, 0, 0);
+  }
+  if (plx_llvm_bc_accept(reader, "ptr")) {
+    return plx_llvm_bc_add_ptr_type(module);
+  }
+  if (reader->pos + 1 < reader->end && reader->pos[0] == 'i' &&
+      reader->pos[1] >= '0' && reader->pos[1] <= '9') {
+    ++reader->pos;
+    return plx_llvm_bc_add_simple_type(module, PLX_LLVM_BC_TYPE_INTEGER, 1,
+                                       plx_llvm_bc_uint(reader));
+  }
+  if (plx_llvm_bc_accept(reader, "[")) {
+    const uint64_t len = plx_llvm_bc_uint(reader);
+    plx_llvm_bc_expect(reader, "x");
+    const uint32_t element_type = plx_llvm_bc_type(module, reader);
+    plx_llvm_bc_expect(reader, "]");
+    plx_llvm_bc_add_type_op(module, len);
+    plx_llvm_bc_add_type_op(module, element_type);
+    return plx_llvm_bc_add_type(module, PLX_LLVM_BC_TYPE_ARRAY, 2, NULL, 0);
+  }
+  if (plx_llvm_bc_accept(reader, "<")) {
+    const uint64_t len = plx_llvm_bc_uint(reader);
+    plx_llvm_bc_expect(reader, "x");
+    const uint32_t element_type = plx_llvm_bc_type(module, reader);
+    plx_llvm_bc_expect(reader, ">");
+    plx_llvm_bc_add_type_op(module, len);
+    plx_llvm_bc_add_type_op(module, element_type);
+    return plx_llvm_bc_add_type(module, PLX_LLVM_BC_TYPE_VECTOR, 2, NULL, 0);
+  }
+  if (plx_llvm_bc_accept(reader, "{")) {
+    // The member types are read before any of the struct's operands are added,
+    // since reading them may add types.
+    size_t cap = 0, len = 0;
+    uint32_t* members = NULL;
+    do {
+      members = plx_llvm_bc_reserve(members, &cap, len + 1, sizeof(uint32_t));
+      members[len++] = plx_llvm_bc_type(module, reader);
+    } while (plx_llvm_bc_accept(reader, ","));
+    plx_llvm_bc_expect(reader, "}");
+    plx_llvm_bc_add_type_op(module, /*packed=*/0);
+    for (size_t i = 0; i < len; ++i) {
+      plx_llvm_bc_add_type_op(module, members[i]);
+    }
+    free(members);
+    return plx_llvm_bc_add_type(module, PLX_LLVM_BC_TYPE_STRUCT_ANON, len + 1,
+                                NULL, 0);
+  }
+  if (plx_llvm_bc_accept(reader, "%")) {
+    // Named structs must be defined before they are used.
+    const char* name;
+    const size_t name_len = plx_llvm_bc_ident(reader, &name);
+    for (size_t i = 0; i < module->types_len; ++i) {
+      const struct plx_llvm_bc_type* const type = &module->types[i];
+      if (type->name != NULL && type->name_len == name_len &&
+          memcmp(type->name, name, name_len) == 0) {
+        return (uint32_t)i;
+      }
+    }
+  }
+  reader->error = true;
+  return 0;
+}
+
+// Returns the length (operand 0) or the element type (operand 1) of a vector
+// type.
+static uint64_t plx_llvm_bc_vector_op(
+    const struct plx_llvm_bc_module* const module,
+    struct plx_llvm_bc_reader* const reader, const uint32_t type,
+    const size_t op) {
+  if (reader->error) return 0;
+  const struct plx_llvm_bc_type* const vector_type = &module->types[type];
+  if (vector_type->code != PLX_LLVM_BC_TYPE_VECTOR) {
+    reader->error = true;
+    return 0;
+  }
+  return module->type_ops[vector_type->ops_begin + op];
+}
+
+// Reads a constant of the given type.
+static struct plx_llvm_bc_constant plx_llvm_bc_constant(
+    const struct plx_llvm_bc_module* const module,
+    struct plx_llvm_bc_reader* const reader, const uint32_t type) {
+  struct plx_llvm_bc_constant constant = {type, PLX_LLVM_BC_CONSTANT_INTEGER,
+                                          0};
+  if (plx_llvm_bc_accept(reader, "poison")) {
+    constant.code = PLX_LLVM_BC_CONSTANT_POISON;
+    return constant;
+  }
+  if (plx_llvm_bc_accept(reader, "zeroinitializer")) {
+    constant.code = PLX_LLVM_BC_CONSTANT_NULL;
+    return constant;
+  }
+
+  const struct plx_llvm_bc_type* const llvm_type = &module->types[type];
+  switch (llvm_type->code) {
+    case PLX_LLVM_BC_TYPE_INTEGER: {
+      const unsigned int width =
+          (unsigned int)module->type_ops[llvm_type->ops_begin];
+      if (plx_llvm_bc_accept(reader, "true")) {
+        constant.value = plx_llvm_bc_sext(1, width);
+        break;
+      }
+      if (plx_llvm_bc_accept(reader, "false")) break;
+      const bool negative = plx_llvm_bc_accept(reader, "-");
+      const uint64_t magnitude = plx_llvm_bc_uint(reader);
+      constant.value =
+          plx_llvm_bc_sext(negative ? 0 - magnitude : magnitude, width);
+      break;
+    }
+    case PLX_LLVM_BC_TYPE_HALF:
+    case PLX_LLVM_BC_TYPE_FLOAT:
+    case PLX_LLVM_BC_TYPE_DOUBLE: {
+      // Copy the number so that it is null-terminated.
+      plx_llvm_bc_skip_spaces(reader);
+      char number[64];
+      size_t len = 0;
+      while (reader->pos < reader->end && len < sizeof(number) - 1 &&
+             (plx_is_llvm_bc_ident_char(*reader->pos) ||
+              *reader->pos == '-' || *reader->pos == '+')) {
+        number[len++] = *reader->pos++;
+      }
+      number[len] = '\0';
+      char* number_end;
+      const double value = strtod(number, &number_end);
+      if (len == 0 || *number_end != '\0') reader->error = true;
+      constant.code = PLX_LLVM_BC_CONSTANT_FLOAT;
+      if (llvm_type->code == PLX_LLVM_BC_TYPE_HALF) {
+        constant.value = plx_llvm_bc_half_bits(value);
+      } else if (llvm_type->code == PLX_LLVM_BC_TYPE_FLOAT) {
+        const float f = (float)value;
+        uint32_t bits;
+        memcpy(&bits, &f, sizeof(bits));
+        constant.value = bits;
+      } else {
+        memcpy(&constant.value, &value, sizeof(constant.value));
+      }
+      break;
+    }
+    default:
+      reader->error = true;
+  }
+  return constant;
+}
+
+// Reads a value of the given type in the current function.
+static plx_llvm_bc_value plx_llvm_bc_operand(
+    struct plx_llvm_bc_module* const module,
+    struct plx_llvm_bc_reader* const reader,
+    struct plx_llvm_bc_func* const func, const uint32_t type) {
+  if (reader->error) return 0;
+  plx_llvm_bc_skip_spaces(reader);
+  if (reader->pos < reader->end && *reader->pos == '%') {
+    return plx_llvm_bc_pack_value(PLX_LLVM_BC_VALUE_LOCAL,
+                                  plx_llvm_bc_local_number(reader));
+  }
+  if (plx_llvm_bc_accept(reader, "@")) {
+    const char* name;
+    const size_t name_len = plx_llvm_bc_ident(reader, &name);
+    return plx_llvm_bc_pack_value(PLX_LLVM_BC_VALUE_GLOBAL,
+                                  plx_llvm_bc_global(module, name, name_len));
+  }
+  if (plx_llvm_bc_accept(reader, "<")) {
+    // The elements of a vector constant are added before the vector.
+    const uint64_t len = plx_llvm_bc_vector_op(module, reader, type, 0);
+    const size_t first = func->constants_len;
+    for (uint64_t i = 0; i < len && !reader->error; ++i) {
+      if (i > 0) plx_llvm_bc_expect(reader, ",");
+      const uint32_t element_type = plx_llvm_bc_type(module, reader);
+      plx_llvm_bc_add_constant(
+          module, func, plx_llvm_bc_constant(module, reader, element_type));
+    }
+    plx_llvm_bc_expect(reader, ">");
+    return plx_llvm_bc_add_constant(
+        module, func,
+        (struct plx_llvm_bc_constant){type, PLX_LLVM_BC_CONSTANT_AGGREGATE,
+                                      first});
+  }
+  return plx_llvm_bc_add_constant(
+      module, func, plx_llvm_bc_constant(module, reader, type));
+}
+
+// Reads a type followed by a value of that type, adding the value as an
+// operand.
+static uint32_t plx_llvm_bc_typed_value_op(
+    struct plx_llvm_bc_module* const module,
+    struct plx_llvm_bc_reader* const reader,
+    struct plx_llvm_bc_func* const func) {
+  const uint32_t type = plx_llvm_bc_type(module, reader);
+  plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_TYPED_VALUE,
+                     plx_llvm_bc_operand(module, reader, func, type));
+  return type;
+}
+
+// Binary operators and their opcodes. Floating point operators share opcodes
+// with integer operators.
+static const struct {
+  const char* name;
+  unsigned int opcode;
+} plx_llvm_bc_binops[] = {
+    {"add", 0},   {"sub", 1},   {"mul", 2},   {"udiv", 3},  {"sdiv", 4},
+    {"urem", 5},  {"srem", 6},  {"shl", 7},   {"lshr", 8},  {"ashr", 9},
+    {"and", 10},  {"or", 11},   {"xor", 12},  {"fadd", 0},  {"fsub", 1},
+    {"fmul", 2},  {"fdiv", 4},  {"frem", 6},
+};
+
+// Cast operators other than `bitcast` and their opcodes.
+static const struct {
+  const char* name;
+  unsigned int opcode;
+} plx_llvm_bc_casts[] = {
+    {"trunc", 0},  {"zext", 1},   {"sext", 2},   {"fptoui", 3},
+    {"fptosi", 4}, {"uitofp", 5}, {"sitofp", 6}, {"fptrunc", 7},
+    {"fpext", 8},
+};
+
+// Function attributes and their kinds.
+static const struct {
+  const char* name;
+  unsigned int kind;
+} plx_llvm_bc_attrs[] = {
+    {"alwaysinline", 2},
+    {"noinline", 14},
+    {"nounwind", 18},
+    {"noreturn", 17},
+    {"cold", 36},
+};
+
+// Comparison predicates.
+static const struct {
+  const char* name;
+  unsigned int predicate;
+} plx_llvm_bc_predicates[] = {
+    {"oeq", 1},  {"ogt", 2},  {"oge", 3},  {"olt", 4},  {"ole", 5},
+    {"one", 6},  {"eq", 32},  {"ne", 33},  {"ugt", 34}, {"uge", 35},
+    {"ult", 36}, {"ule", 37}, {"sgt", 38}, {"sge", 39}, {"slt", 40},
+    {"sle", 41},
+};
+
+// Reads the attributes of a function, returning their set.
+static uint32_t plx_llvm_bc_func_attrs(
+    struct plx_llvm_bc_reader* const reader) {
+  uint32_t attrs = 0;
+  const size_t attr_count =
+      sizeof(plx_llvm_bc_attrs) / sizeof(plx_llvm_bc_attrs[0]);
+  for (size_t i = 0; i < attr_count;) {
+    if (plx_llvm_bc_accept(reader, plx_llvm_bc_attrs[i].name)) {
+      attrs |= (uint32_t)1 << i;
+      i = 0;
+    } else {
+      ++i;
+    }
+  }
+  return attrs;
+}
+
+// Reads an instruction in the current function.
+static void plx_llvm_bc_inst(struct plx_llvm_bc_module* const module,
+                             struct plx_llvm_bc_reader* const reader,
+                             struct plx_llvm_bc_func* const func) {
+  uint32_t result = PLX_LLVM_BC_NONE;
+  plx_llvm_bc_skip_spaces(reader);
+  if (reader->pos < reader->end && *reader->pos == '%') {
+    result = plx_llvm_bc_local_number(reader);
+    plx_llvm_bc_expect(reader, "=");
+  }
+  // `musttail` is the only prefix of an instruction.
+  const bool musttail = plx_llvm_bc_accept(reader, "musttail");
+  const char* opcode;
+  const size_t opcode_len = plx_llvm_bc_ident(reader, &opcode);
+  if (reader->error) return;
+#define PLX_LLVM_BC_IS(name) \
+  (opcode_len == strlen(name) && memcmp(opcode, name, opcode_len) == 0)
+
+  if (musttail && !PLX_LLVM_BC_IS("call")) {
+    reader->error = true;
+    return;
+  }
+
+  for (size_t i = 0;
+       i < sizeof(plx_llvm_bc_binops) / sizeof(plx_llvm_bc_binops[0]); ++i) {
+    if (!PLX_LLVM_BC_IS(plx_llvm_bc_binops[i].name)) continue;
+    const bool fast = plx_llvm_bc_accept(reader, "fast");
+    uint64_t wrap_flags = 0;
+    if (plx_llvm_bc_accept(reader, "nuw")) {
+      wrap_flags |= PLX_LLVM_BC_NO_UNSIGNED_WRAP;
+    }
+    if (plx_llvm_bc_accept(reader, "nsw")) {
+      wrap_flags |= PLX_LLVM_BC_NO_SIGNED_WRAP;
+    }
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_BINOP);
+    const uint32_t type = plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_expect(reader, ",");
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_VALUE,
+                       plx_llvm_bc_operand(module, reader, func, type));
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL,
+                       plx_llvm_bc_binops[i].opcode);
+    if (fast) {
+      plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL,
+                         PLX_LLVM_BC_FAST_MATH_FLAGS);
+    } else if (wrap_flags != 0) {
+      plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, wrap_flags);
+    }
+    plx_llvm_bc_end_inst(module, func, result, type);
+    return;
+  }
+
+  for (size_t i = 0;
+       i < sizeof(plx_llvm_bc_casts) / sizeof(plx_llvm_bc_casts[0]); ++i) {
+    if (!PLX_LLVM_BC_IS(plx_llvm_bc_casts[i].name)) continue;
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_CAST);
+    plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_expect(reader, "to");
+    const uint32_t result_type = plx_llvm_bc_type(module, reader);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, result_type);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL,
+                       plx_llvm_bc_casts[i].opcode);
+    plx_llvm_bc_end_inst(module, func, result, result_type);
+    return;
+  }
+
+  if (PLX_LLVM_BC_IS("fneg")) {
+    const bool fast = plx_llvm_bc_accept(reader, "fast");
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_UNOP);
+    const uint32_t type = plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, /*fneg=*/0);
+    if (fast) {
+      plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL,
+                         PLX_LLVM_BC_FAST_MATH_FLAGS);
+    }
+    plx_llvm_bc_end_inst(module, func, result, type);
+  } else if (PLX_LLVM_BC_IS("icmp") || PLX_LLVM_BC_IS("fcmp")) {
+    const char* predicate;
+    const size_t predicate_len = plx_llvm_bc_ident(reader, &predicate);
+    size_t i = 0;
+    const size_t predicate_count =
+        sizeof(plx_llvm_bc_predicates) / sizeof(plx_llvm_bc_predicates[0]);
+    while (i < predicate_count &&
+           (strlen(plx_llvm_bc_predicates[i].name) != predicate_len ||
+            memcmp(plx_llvm_bc_predicates[i].name, predicate, predicate_len) !=
+                0)) {
+      ++i;
+    }
+    if (i == predicate_count) {
+      reader->error = true;
+      return;
+    }
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_CMP2);
+    const uint32_t type = plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_expect(reader, ",");
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_VALUE,
+                       plx_llvm_bc_operand(module, reader, func, type));
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL,
+                       plx_llvm_bc_predicates[i].predicate);
+    // Comparing vectors produces a vector of booleans.
+    uint32_t result_type =
+        plx_llvm_bc_add_simple_type(module, PLX_LLVM_BC_TYPE_INTEGER, 1, 1);
+    if (module->types[type].code == PLX_LLVM_BC_TYPE_VECTOR) {
+      plx_llvm_bc_add_type_op(module,
+                              plx_llvm_bc_vector_op(module, reader, type, 0));
+      plx_llvm_bc_add_type_op(module, result_type);
+      result_type =
+          plx_llvm_bc_add_type(module, PLX_LLVM_BC_TYPE_VECTOR, 2, NULL, 0);
+    }
+    plx_llvm_bc_end_inst(module, func, result, result_type);
+  } else if (PLX_LLVM_BC_IS("alloca")) {
+    const uint32_t type = plx_llvm_bc_type(module, reader);
+    const uint32_t i32 =
+        plx_llvm_bc_add_simple_type(module, PLX_LLVM_BC_TYPE_INTEGER, 1, 32);
+    if (func->one == PLX_LLVM_BC_NONE) {
+      func->one = (uint32_t)plx_llvm_bc_add_constant(
+          module, func,
+          (struct plx_llvm_bc_constant){i32, PLX_LLVM_BC_CONSTANT_INTEGER, 1});
+    }
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_ALLOCA);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, type);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, i32);
+    plx_llvm_bc_add_op(
+        module, PLX_LLVM_BC_OP_ABSOLUTE_VALUE,
+        plx_llvm_bc_pack_value(PLX_LLVM_BC_VALUE_CONSTANT, func->one));
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL,
+                       PLX_LLVM_BC_ALLOCA_EXPLICIT_TYPE);
+    plx_llvm_bc_end_inst(module, func, result,
+                         plx_llvm_bc_add_ptr_type(module));
+  } else if (PLX_LLVM_BC_IS("load")) {
+    const uint32_t type = plx_llvm_bc_type(module, reader);
+    plx_llvm_bc_expect(reader, ",");
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_LOAD);
+    plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, type);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, /*align=*/0);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, /*volatile=*/0);
+    plx_llvm_bc_end_inst(module, func, result, type);
+  } else if (PLX_LLVM_BC_IS("store")) {
+    // The pointer comes first in the record.
+    const uint32_t type = plx_llvm_bc_type(module, reader);
+    const plx_llvm_bc_value value =
+        plx_llvm_bc_operand(module, reader, func, type);
+    plx_llvm_bc_expect(reader, ",");
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_STORE);
+    plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_TYPED_VALUE, value);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, /*align=*/0);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, /*volatile=*/0);
+    plx_llvm_bc_end_inst(module, func, PLX_LLVM_BC_NONE, 0);
+  } else if (PLX_LLVM_BC_IS("getelementptr")) {
+    const bool inbounds = plx_llvm_bc_accept(reader, "inbounds");
+    const uint32_t type = plx_llvm_bc_type(module, reader);
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_GEP);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, inbounds);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, type);
+    while (plx_llvm_bc_accept(reader, ",")) {
+      plx_llvm_bc_typed_value_op(module, reader, func);
+    }
+    plx_llvm_bc_end_inst(module, func, result,
+                         plx_llvm_bc_add_ptr_type(module));
+  } else if (PLX_LLVM_BC_IS("bitcast")) {
+    // Bitcasts to the same type only name a value, so no instruction is needed.
+    const uint32_t type = plx_llvm_bc_type(module, reader);
+    const plx_llvm_bc_value value =
+        plx_llvm_bc_operand(module, reader, func, type);
+    plx_llvm_bc_expect(reader, "to");
+    const uint32_t result_type = plx_llvm_bc_type(module, reader);
+    if (result == PLX_LLVM_BC_NONE) reader->error = true;
+    if (reader->error) return;
+    if (result_type == type) {
+      struct plx_llvm_bc_local* const local =
+          plx_llvm_bc_local(module, func, result);
+      local->kind = PLX_LLVM_BC_LOCAL_ALIAS;
+      local->alias = value;
+      local->type = type;
+      return;
+    }
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_CAST);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_TYPED_VALUE, value);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, result_type);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL,
+                       PLX_LLVM_BC_CAST_BITCAST);
+    plx_llvm_bc_end_inst(module, func, result, result_type);
+  } else if (PLX_LLVM_BC_IS("extractvalue")) {
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_EXTRACTVAL);
+    uint32_t type = plx_llvm_bc_typed_value_op(module, reader, func);
+    while (!reader->error && plx_llvm_bc_accept(reader, ",")) {
+      const uint64_t index = plx_llvm_bc_uint(reader);
+      plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, index);
+      // Arrays have the element type as their second operand, and structs
+      // have their member types after whether they are packed.
+      const struct plx_llvm_bc_type* const aggregate = &module->types[type];
+      if (aggregate->code == PLX_LLVM_BC_TYPE_ARRAY) {
+        type = (uint32_t)module->type_ops[aggregate->ops_begin + 1];
+      } else if ((aggregate->code == PLX_LLVM_BC_TYPE_STRUCT_ANON ||
+                  aggregate->code == PLX_LLVM_BC_TYPE_STRUCT_NAMED) &&
+                 index + 1 < aggregate->ops_len) {
+        type = (uint32_t)module->type_ops[aggregate->ops_begin + 1 + index];
+      } else {
+        reader->error = true;
+      }
+    }
+    plx_llvm_bc_end_inst(module, func, result, type);
+  } else if (PLX_LLVM_BC_IS("extractelement")) {
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_EXTRACTELT);
+    const uint32_t type = plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_expect(reader, ",");
+    plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_end_inst(
+        module, func, result,
+        (uint32_t)plx_llvm_bc_vector_op(module, reader, type, 1));
+  } else if (PLX_LLVM_BC_IS("insertelement")) {
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_INSERTELT);
+    const uint32_t type = plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_expect(reader, ",");
+    const uint32_t element_type = plx_llvm_bc_type(module, reader);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_VALUE,
+                       plx_llvm_bc_operand(module, reader, func, element_type));
+    plx_llvm_bc_expect(reader, ",");
+    plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_end_inst(module, func, result, type);
+  } else if (PLX_LLVM_BC_IS("shufflevector")) {
+    // The result has the element type of the operands and the length of the
+    // mask.
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_SHUFFLEVEC);
+    const uint32_t type = plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_expect(reader, ",");
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_VALUE,
+                       plx_llvm_bc_operand(module, reader, func,
+                                           plx_llvm_bc_type(module, reader)));
+    plx_llvm_bc_expect(reader, ",");
+    const uint32_t mask_type = plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_add_type_op(
+        module, plx_llvm_bc_vector_op(module, reader, mask_type, 0));
+    plx_llvm_bc_add_type_op(module,
+                            plx_llvm_bc_vector_op(module, reader, type, 1));
+    plx_llvm_bc_end_inst(
+        module, func, result,
+        plx_llvm_bc_add_type(module, PLX_LLVM_BC_TYPE_VECTOR, 2, NULL, 0));
+  } else if (PLX_LLVM_BC_IS("select")) {
+    // The condition comes last in the record.
+    const uint32_t cond_type = plx_llvm_bc_type(module, reader);
+    const plx_llvm_bc_value cond =
+        plx_llvm_bc_operand(module, reader, func, cond_type);
+    plx_llvm_bc_expect(reader, ",");
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_VSELECT);
+    const uint32_t type = plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_expect(reader, ",");
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_VALUE,
+                       plx_llvm_bc_operand(module, reader, func,
+                                           plx_llvm_bc_type(module, reader)));
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_TYPED_VALUE, cond);
+    plx_llvm_bc_end_inst(module, func, result, type);
+  } else if (PLX_LLVM_BC_IS("freeze")) {
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_FREEZE);
+    const uint32_t type = plx_llvm_bc_typed_value_op(module, reader, func);
+    plx_llvm_bc_end_inst(module, func, result, type);
+  } else if (PLX_LLVM_BC_IS("phi")) {
+    const uint32_t type = plx_llvm_bc_type(module, reader);
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_PHI);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, type);
+    do {
+      plx_llvm_bc_expect(reader, "[");
+      plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_SIGNED_VALUE,
+                         plx_llvm_bc_operand(module, reader, func, type));
+      plx_llvm_bc_expect(reader, ",");
+      plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_BLOCK,
+                         plx_llvm_bc_label(reader));
+      plx_llvm_bc_expect(reader, "]");
+    } while (plx_llvm_bc_accept(reader, ","));
+    plx_llvm_bc_end_inst(module, func, result, type);
+  } else if (PLX_LLVM_BC_IS("br")) {
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_BR);
+    if (plx_llvm_bc_accept(reader, "label")) {
+      plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_BLOCK,
+                         plx_llvm_bc_label(reader));
+    } else {
+      const uint32_t type = plx_llvm_bc_type(module, reader);
+      const plx_llvm_bc_value cond =
+          plx_llvm_bc_operand(module, reader, func, type);
+      plx_llvm_bc_expect(reader, ",");
+      plx_llvm_bc_expect(reader, "label");
+      plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_BLOCK,
+                         plx_llvm_bc_label(reader));
+      plx_llvm_bc_expect(reader, ",");
+      plx_llvm_bc_expect(reader, "label");
+      plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_BLOCK,
+                         plx_llvm_bc_label(reader));
+      plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_VALUE, cond);
+    }
+    plx_llvm_bc_end_inst(module, func, PLX_LLVM_BC_NONE, 0);
+  } else if (PLX_LLVM_BC_IS("ret")) {
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_RET);
+    if (!plx_llvm_bc_accept(reader, "void")) {
+      plx_llvm_bc_typed_value_op(module, reader, func);
+    }
+    plx_llvm_bc_end_inst(module, func, PLX_LLVM_BC_NONE, 0);
+  } else if (PLX_LLVM_BC_IS("unreachable")) {
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_UNREACHABLE);
+    plx_llvm_bc_end_inst(module, func, PLX_LLVM_BC_NONE, 0);
+  } else if (PLX_LLVM_BC_IS("call")) {
+    const uint32_t return_type = plx_llvm_bc_type(module, reader);
+    const plx_llvm_bc_value callee = plx_llvm_bc_operand(
+        module, reader, func, plx_llvm_bc_add_ptr_type(module));
+
+    // The function type is only known once the arguments have been read.
+    size_t arg_types_cap = 0, args_cap = 0, arg_count = 0;
+    uint32_t* arg_types = NULL;
+    plx_llvm_bc_value* args = NULL;
+    plx_llvm_bc_expect(reader, "(");
+    if (!plx_llvm_bc_accept(reader, ")")) {
+      do {
+        arg_types = plx_llvm_bc_reserve(arg_types, &arg_types_cap,
+                                        arg_count + 1, sizeof(uint32_t));
+        args = plx_llvm_bc_reserve(args, &args_cap, arg_count + 1,
+                                   sizeof(plx_llvm_bc_value));
+        arg_types[arg_count] = plx_llvm_bc_type(module, reader);
+        args[arg_count] =
+            plx_llvm_bc_operand(module, reader, func, arg_types[arg_count]);
+        ++arg_count;
+      } while (plx_llvm_bc_accept(reader, ","));
+      plx_llvm_bc_expect(reader, ")");
+    }
+    const uint32_t func_type =
+        plx_llvm_bc_add_func_type(module, return_type, arg_types, arg_count);
+
+    plx_llvm_bc_begin_inst(module, func, PLX_LLVM_BC_INST_CALL);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, /*paramattrs=*/0);
+    plx_llvm_bc_add_op(
+        module, PLX_LLVM_BC_OP_LITERAL,
+        PLX_LLVM_BC_CALL_EXPLICIT_TYPE |
+            (musttail ? PLX_LLVM_BC_CALL_TAIL | PLX_LLVM_BC_CALL_MUSTTAIL : 0));
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_LITERAL, func_type);
+    plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_TYPED_VALUE, callee);
+    for (size_t i = 0; i < arg_count; ++i) {
+      plx_llvm_bc_add_op(module, PLX_LLVM_BC_OP_VALUE, args[i]);
+    }
+    free(arg_types);
+    free(args);
+    plx_llvm_bc_end_inst(module, func, result, return_type);
+  } else {
+    reader->error = true;
+  }
+#undef PLX_LLVM_BC_IS
+}
+
+// Reads a function declaration (`declare i32 @f(i32, i32) nounwind`).
+static void plx_llvm_bc_declare(struct plx_llvm_bc_module* const module,
+                                struct plx_llvm_bc_reader* const reader) {
+  const uint32_t return_type = plx_llvm_bc_type(module, reader);
+  plx_llvm_bc_expect(reader, "@");
+  const char* name;
+  const size_t name_len = plx_llvm_bc_ident(reader, &name);
+  if (reader->error) return;
+
+  size_t cap = 0, len = 0;
+  uint32_t* param_types = NULL;
+  plx_llvm_bc_expect(reader, "(");
+  if (!plx_llvm_bc_accept(reader, ")")) {
+    do {
+      param_types =
+          plx_llvm_bc_reserve(param_types, &cap, len + 1, sizeof(uint32_t));
+      param_types[len++] = plx_llvm_bc_type(module, reader);
+    } while (!reader->error && plx_llvm_bc_accept(reader, ","));
+    plx_llvm_bc_expect(reader, ")");
+  }
+  const uint32_t attrs = plx_llvm_bc_func_attrs(reader);
+  const uint32_t type =
+      plx_llvm_bc_add_func_type(module, return_type, param_types, len);
+  free(param_types);
+  if (reader->error) return;
+
+  const uint32_t index = plx_llvm_bc_global(module, name, name_len);
+  struct plx_llvm_bc_global* const global = &module->globals[index];
+  if (global->defined) reader->error = true;
+  global->defined = true;
+  global->external = true;
+  global->is_func = true;
+  global->type = type;
+  global->attrs = attrs;
+}
+
+// Reads a function definition (`define i32 @f(i32 %v0) noinline {`),
+// beginning its body.
+static void plx_llvm_bc_define(struct plx_llvm_bc_module* const module,
+                               struct plx_llvm_bc_reader* const reader) {
+  const uint32_t return_type = plx_llvm_bc_type(module, reader);
+  plx_llvm_bc_expect(reader, "@");
+  const char* name;
+  const size_t name_len = plx_llvm_bc_ident(reader, &name);
+  if (reader->error) return;
+
+  module->funcs =
+      plx_llvm_bc_reserve(module->funcs, &module->funcs_cap,
+                          module->funcs_len + 1, sizeof(*module->funcs));
+  struct plx_llvm_bc_func* const func = &module->funcs[module->funcs_len];
+  memset(func, 0, sizeof(*func));
+  func->insts_begin = module->insts_len;
+  func->constants_begin = module->constants_len;
+  func->locals_begin = module->locals_len;
+  func->labels_begin = module->labels_len;
+  func->one = PLX_LLVM_BC_NONE;
+
+  size_t cap = 0;
+  uint32_t* param_types = NULL;
+  plx_llvm_bc_expect(reader, "(");
+  if (!plx_llvm_bc_accept(reader, ")")) {
+    do {
+      param_types = plx_llvm_bc_reserve(param_types, &cap, func->arg_count + 1,
+                                        sizeof(uint32_t));
+      const uint32_t type = plx_llvm_bc_type(module, reader);
+      const uint32_t number = plx_llvm_bc_local_number(reader);
+      if (reader->error) break;
+      struct plx_llvm_bc_local* const local =
+          plx_llvm_bc_local(module, func, number);
+      local->kind = PLX_LLVM_BC_LOCAL_ARG;
+      local->index = func->arg_count;
+      local->type = type;
+      param_types[func->arg_count++] = type;
+    } while (plx_llvm_bc_accept(reader, ","));
+    plx_llvm_bc_expect(reader, ")");
+  }
+  const uint32_t attrs = plx_llvm_bc_func_attrs(reader);
+  plx_llvm_bc_expect(reader, "{");
+
+  const uint32_t type = plx_llvm_bc_add_func_type(module, return_type,
+                                                  param_types, func->arg_count);
+  free(param_types);
+  const uint32_t index = plx_llvm_bc_global(module, name, name_len);
+  struct plx_llvm_bc_global* const global = &module->globals[index];
+  if (global->defined) reader->error = true;
+  global->defined = true;
+  global->is_func = true;
+  global->type = type;
+  global->attrs = attrs;
+  global->func = module->funcs_len++;
+}
+
+// Reads a label (`bb1:`), beginning a basic block in the current function.
+static void plx_llvm_bc_block(struct plx_llvm_bc_module* const module,
+                              struct plx_llvm_bc_reader* const reader,
+                              struct plx_llvm_bc_func* const func) {
+  if (!plx_llvm_bc_accept_prefix(reader, "bb")) reader->error = true;
+  const uint32_t number = (uint32_t)plx_llvm_bc_uint(reader);
+  plx_llvm_bc_expect(reader, ":");
+  if (reader->error) return;
+  if (number >= func->labels_len) {
+    const size_t len = func->labels_begin + number + 1;
+    module->labels = plx_llvm_bc_reserve(module->labels, &module->labels_cap,
+                                         len, sizeof(uint32_t));
+    for (size_t i = module->labels_len; i < len; ++i) {
+      module->labels[i] = PLX_LLVM_BC_NONE;
+    }
+    module->labels_len = len;
+    func->labels_len = number + 1;
+  }
+  uint32_t* const label = &module->labels[func->labels_begin + number];
+  if (*label != PLX_LLVM_BC_NONE) reader->error = true;
+  *label = func->block_count++;
+}
+
+// Reads a global variable (`@x = global i32 0`) or a declaration of one
+// (`@x = external global i32`).
+static void plx_llvm_bc_global_var(struct plx_llvm_bc_module* const module,
+                                   struct plx_llvm_bc_reader* const reader) {
+  plx_llvm_bc_expect(reader, "@");
+  const char* name;
+  const size_t name_len = plx_llvm_bc_ident(reader, &name);
+  plx_llvm_bc_expect(reader, "=");
+  const bool external = plx_llvm_bc_accept(reader, "external");
+  const bool unnamed_addr = plx_llvm_bc_accept(reader, "unnamed_addr");
+  const bool is_const = plx_llvm_bc_accept(reader, "constant");
+  if (!is_const) plx_llvm_bc_expect(reader, "global");
+  const uint32_t type = plx_llvm_bc_type(module, reader);
+  struct plx_llvm_bc_constant init = {0};
+  if (!external) init = plx_llvm_bc_constant(module, reader, type);
+  if (reader->error) return;
+
+  const uint32_t index = plx_llvm_bc_global(module, name, name_len);
+  struct plx_llvm_bc_global* const global = &module->globals[index];
+  if (global->defined) reader->error = true;
+  global->defined = true;
+  global->external = external;
+  global->is_const = is_const;
+  global->unnamed_addr = unnamed_addr;
+  global->type = type;
+  global->init = init;
+}
+
+// Reads a named struct type (`%S = type { i32, i64 }`).
+static void plx_llvm_bc_struct(struct plx_llvm_bc_module* const module,
+                               struct plx_llvm_bc_reader* const reader) {
+  plx_llvm_bc_expect(reader, "%");
+  const char* name;
+  const size_t name_len = plx_llvm_bc_ident(reader, &name);
+  plx_llvm_bc_expect(reader, "=");
+  plx_llvm_bc_expect(reader, "type");
+
+  // The struct is read as an anonymous struct and then renamed, so that its
+  // members come before it in the type table.
+  const uint32_t anon = plx_llvm_bc_type(module, reader);
+  if (reader->error) return;
+  const struct plx_llvm_bc_type* type = &module->types[anon];
+  if (type->code != PLX_LLVM_BC_TYPE_STRUCT_ANON) {
+    reader->error = true;
+    return;
+  }
+  const size_t ops_len = type->ops_len;
+  for (size_t i = 0; i < ops_len; ++i) {
+    plx_llvm_bc_add_type_op(module, module->type_ops[type->ops_begin + i]);
+  }
+  plx_llvm_bc_add_type(module, PLX_LLVM_BC_TYPE_STRUCT_NAMED, ops_len, name,
+                       name_len);
+}
+
+// Reads the IR into the module.
+static bool plx_llvm_bc_read(struct plx_llvm_bc_module* const module,
+                             const struct plx_buffer* const ir) {
+  const char* pos = ir->data;
+  const char* const end = ir->data + ir->len;
+  struct plx_llvm_bc_func* func = NULL;
+  for (size_t line = 1; pos < end; ++line) {
+    const char* line_end = memchr(pos, '\n', (size_t)(end - pos));
+    if (line_end == NULL) line_end = end;
+    struct plx_llvm_bc_reader reader = {pos, line_end, false};
+    pos = line_end < end ? line_end + 1 : end;
+
+    plx_llvm_bc_skip_spaces(&reader);
+    if (reader.pos == reader.end || *reader.pos == ';') continue;
+    if (func != NULL) {
+      if (plx_llvm_bc_accept(&reader, "}")) {
+        func = NULL;
+      } else if (reader.end[-1] == ':') {
+        plx_llvm_bc_block(module, &reader, func);
+      } else {
+        plx_llvm_bc_inst(module, &reader, func);
+      }
+    } else if (plx_llvm_bc_accept(&reader, "define")) {
+      plx_llvm_bc_define(module, &reader);
+      if (!reader.error) func = &module->funcs[module->funcs_len - 1];
+    } else if (plx_llvm_bc_accept(&reader, "declare")) {
+      plx_llvm_bc_declare(module, &reader);
+    } else if (plx_llvm_bc_accept(&reader, "target")) {
+      const bool triple = plx_llvm_bc_accept(&reader, "triple");
+      if (!triple) plx_llvm_bc_expect(&reader, "datalayout");
+      plx_llvm_bc_expect(&reader, "=");
+      const char* str;
+      const size_t len = plx_llvm_bc_string(&reader, &str);
+      if (triple) {
+        module->triple = str;
+        module->triple_len = len;
+      } else {
+        module->datalayout = str;
+        module->datalayout_len = len;
+      }
+    } else if (*reader.pos == '@') {
+      plx_llvm_bc_global_var(module, &reader);
+    } else if (*reader.pos == '%') {
+      plx_llvm_bc_struct(module, &reader);
+    } else {
+      reader.error = true;
+    }
+
+    // The whole line must have been read.
+    plx_llvm_bc_skip_spaces(&reader);
+    if (plx_unlikely(reader.error || reader.pos != reader.end)) {
+      plx_error("unsupported LLVM IR on line %zu", line);
+      return false;
+    }
+  }
+  if (plx_unlikely(func != NULL)) {
+    plx_error("unterminated function in LLVM IR");
+    return false;
+  }
+  for (size_t i = 0; i < module->globals_len; ++i) {
+    const struct plx_llvm_bc_global* const global = &module->globals[i];
+    if (plx_unlikely(!global->defined)) {
+      plx_error("undefined global `@%.*s` in LLVM IR", (int)global->name_len,
+                global->name);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Writes the records of a constants block, whose first constant has the value
+// number `first_id`.
+static void plx_llvm_bc_write_constants(
+    struct plx_bitstream* const stream,
+    const struct plx_llvm_bc_module* const module,
+    const struct plx_llvm_bc_constant* const constants, const size_t len,
+    const uint32_t first_id) {
+  if (len == 0) return;
+  uint64_t* elements = NULL;
+  size_t elements_cap = 0;
+  plx_bitstream_enter_block(stream, PLX_LLVM_BC_CONSTANTS_BLOCK,
+                            PLX_LLVM_BC_ABBREV_WIDTH);
+  uint32_t type = PLX_LLVM_BC_NONE;
+  for (size_t i = 0; i < len; ++i) {
+    const struct plx_llvm_bc_constant* const constant = &constants[i];
+    if (constant->type != type) {
+      type = constant->type;
+      const uint64_t op = type;
+      plx_bitstream_emit_record(stream, PLX_LLVM_BC_CONSTANT_SETTYPE, &op, 1);
+    }
+    switch (constant->code) {
+      case PLX_LLVM_BC_CONSTANT_INTEGER: {
+        const uint64_t op = plx_llvm_bc_signed(constant->value);
+        plx_bitstream_emit_record(stream, constant->code, &op, 1);
+        break;
+      }
+      case PLX_LLVM_BC_CONSTANT_FLOAT:
+        plx_bitstream_emit_record(stream, constant->code, &constant->value, 1);
+        break;
+      case PLX_LLVM_BC_CONSTANT_AGGREGATE: {
+        const size_t element_count =
+            module->type_ops[module->types[type].ops_begin];
+        elements = plx_llvm_bc_reserve(elements, &elements_cap, element_count,
+                                       sizeof(uint64_t));
+        for (size_t j = 0; j < element_count; ++j) {
+          elements[j] = first_id + constant->value + j;
+        }
+        plx_bitstream_emit_record(stream, constant->code, elements,
+                                  element_count);
+        break;
+      }
+      default:
+        plx_bitstream_emit_record(stream, constant->code, NULL, 0);
+    }
+  }
+  free(elements);
+  plx_bitstream_exit_block(stream);
+}
+
+// Writes the attribute groups and attribute lists of the functions. Each
+// distinct set of attributes is one group and one list, whose IDs are its index
+// in `sets` plus one.
+static void plx_llvm_bc_write_attrs(
+    struct plx_bitstream* const stream,
+    const struct plx_llvm_bc_module* const module, uint32_t** const sets,
+    size_t* const sets_len) {
+  size_t sets_cap = 0;
+  *sets = NULL;
+  *sets_len = 0;
+  for (size_t i = 0; i < module->globals_len; ++i) {
+    const uint32_t attrs = module->globals[i].attrs;
+    if (attrs == 0) continue;
+    size_t j = 0;
+    while (j < *sets_len && (*sets)[j] != attrs) ++j;
+    if (j < *sets_len) continue;
+    *sets = plx_llvm_bc_reserve(*sets, &sets_cap, *sets_len + 1,
+                                sizeof(uint32_t));
+    (*sets)[(*sets_len)++] = attrs;
+  }
+  if (*sets_len == 0) return;
+
+  // Enum attributes take a zero followed by their kind. A set has at most 32
+  // attributes.
+  const size_t attr_count =
+      sizeof(plx_llvm_bc_attrs) / sizeof(plx_llvm_bc_attrs[0]);
+  uint64_t ops[2 + 2 * 32];
+  plx_bitstream_enter_block(stream, PLX_LLVM_BC_PARAMATTR_GROUP_BLOCK,
+                            PLX_LLVM_BC_ABBREV_WIDTH);
+  for (size_t i = 0; i < *sets_len; ++i) {
+    size_t ops_len = 0;
+    ops[ops_len++] = i + 1;
+    ops[ops_len++] = PLX_LLVM_BC_FUNCTION_ATTRS;
+    for (size_t j = 0; j < attr_count; ++j) {
+      if (((*sets)[i] >> j & 1) == 0) continue;
+      ops[ops_len++] = 0;
+      ops[ops_len++] = plx_llvm_bc_attrs[j].kind;
+    }
+    plx_bitstream_emit_record(stream, PLX_LLVM_BC_PARAMATTR_GROUP_ENTRY, ops,
+                              ops_len);
+  }
+  plx_bitstream_exit_block(stream);
+
+  plx_bitstream_enter_block(stream, PLX_LLVM_BC_PARAMATTR_BLOCK,
+                            PLX_LLVM_BC_ABBREV_WIDTH);
+  for (size_t i = 0; i < *sets_len; ++i) {
+    const uint64_t group = i + 1;
+    plx_bitstream_emit_record(stream, PLX_LLVM_BC_PARAMATTR_ENTRY, &group, 1);
+  }
+  plx_bitstream_exit_block(stream);
+}
+
+// Writes the type table.
+static void plx_llvm_bc_write_types(
+    struct plx_bitstream* const stream,
+    const struct plx_llvm_bc_module* const module) {
+  plx_bitstream_enter_block(stream, PLX_LLVM_BC_TYPE_BLOCK,
+                            PLX_LLVM_BC_ABBREV_WIDTH);
+  const uint64_t type_count = module->types_len;
+  plx_bitstream_emit_record(stream, PLX_LLVM_BC_TYPE_NUMENTRY, &type_count, 1);
+  uint64_t* name = NULL;
+  size_t name_cap = 0;
+  for (size_t i = 0; i < module->types_len; ++i) {
+    const struct plx_llvm_bc_type* const type = &module->types[i];
+    if (type->name != NULL) {
+      name = plx_llvm_bc_reserve(name, &name_cap, type->name_len,
+                                 sizeof(uint64_t));
+      for (size_t j = 0; j < type->name_len; ++j) {
+        name[j] = (unsigned char)type->name[j];
+      }
+      plx_bitstream_emit_record(stream, PLX_LLVM_BC_TYPE_STRUCT_NAME, name,
+                                type->name_len);
+    }
+    plx_bitstream_emit_record(stream, type->code,
+                              &module->type_ops[type->ops_begin],
+                              type->ops_len);
+  }
+  free(name);
+  plx_bitstream_exit_block(stream);
+}
+
+// Writer for the body of a function, which numbers its values.
+struct plx_llvm_bc_func_writer {
+  const struct plx_llvm_bc_module* module;
+  const struct plx_llvm_bc_func* func;
+
+  // Number of values in the module.
+  uint32_t module_value_count;
+
+  // Type of pointers.
+  uint32_t ptr_type;
+
+  bool error;
+};
+
+// Returns the value number and the type of a value.
+static uint32_t plx_llvm_bc_value_id(
+    struct plx_llvm_bc_func_writer* const writer, plx_llvm_bc_value value,
+    uint32_t* const type) {
+  const struct plx_llvm_bc_module* const module = writer->module;
+  const struct plx_llvm_bc_func* const func = writer->func;
+  for (;;) {
+    const uint32_t index = (uint32_t)value;
+    switch ((enum plx_llvm_bc_value_kind)(value >> 32)) {
+      case PLX_LLVM_BC_VALUE_GLOBAL:
+        *type = writer->ptr_type;
+        return index;
+      case PLX_LLVM_BC_VALUE_CONSTANT:
+        *type = module->constants[func->constants_begin + index].type;
+        return writer->module_value_count + func->arg_count + index;
+      case PLX_LLVM_BC_VALUE_LOCAL: {
+        if (index >= func->locals_len) break;
+        const struct plx_llvm_bc_local* const local =
+            &module->locals[func->locals_begin + index];
+        *type = local->type;
+        switch (local->kind) {
+          case PLX_LLVM_BC_LOCAL_UNDEFINED:
+            break;
+          case PLX_LLVM_BC_LOCAL_ARG:
+            return writer->module_value_count + local->index;
+          case PLX_LLVM_BC_LOCAL_INST:
+            return writer->module_value_count + func->arg_count +
+                   (uint32_t)func->constants_len + local->index;
+          case PLX_LLVM_BC_LOCAL_ALIAS:
+            value = local->alias;
+            continue;
+        }
+        break;
+      }
+    }
+    writer->error = true;
+    *type = 0;
+    return 0;
+  }
+}
+
+// Writes the body of a function.
+static void plx_llvm_bc_write_func(
+    struct plx_bitstream* const stream,
+    struct plx_llvm_bc_func_writer* const writer) {
+  const struct plx_llvm_bc_module* const module = writer->module;
+  const struct plx_llvm_bc_func* const func = writer->func;
+  plx_bitstream_enter_block(stream, PLX_LLVM_BC_FUNCTION_BLOCK,
+                            PLX_LLVM_BC_ABBREV_WIDTH);
+  const uint64_t block_count = func->block_count;
+  plx_bitstream_emit_record(stream, PLX_LLVM_BC_INST_DECLAREBLOCKS,
+                            &block_count, 1);
+  plx_llvm_bc_write_constants(
+      stream, module, &module->constants[func->constants_begin],
+      func->constants_len, writer->module_value_count + func->arg_count);
+
+  uint32_t inst_id = writer->module_value_count + func->arg_count +
+                     (uint32_t)func->constants_len;
+  uint64_t* ops = NULL;
+  size_t ops_cap = 0;
+  for (size_t i = 0; i < func->insts_len; ++i) {
+    const struct plx_llvm_bc_inst* const inst =
+        &module->insts[func->insts_begin + i];
+
+    // Forward references to typed values take an extra operand.
+    ops = plx_llvm_bc_reserve(ops, &ops_cap, inst->ops_len * 2,
+                              sizeof(uint64_t));
+    size_t ops_len = 0;
+    for (size_t j = 0; j < inst->ops_len; ++j) {
+      const struct plx_llvm_bc_op* const op = &module->ops[inst->ops_begin + j];
+      uint32_t type;
+      switch (op->kind) {
+        case PLX_LLVM_BC_OP_LITERAL:
+          ops[ops_len++] = op->value;
+          break;
+        case PLX_LLVM_BC_OP_VALUE: {
+          const uint32_t id = plx_llvm_bc_value_id(writer, op->value, &type);
+          ops[ops_len++] = (uint32_t)(inst_id - id);
+          break;
+        }
+        case PLX_LLVM_BC_OP_TYPED_VALUE: {
+          const uint32_t id = plx_llvm_bc_value_id(writer, op->value, &type);
+          ops[ops_len++] = (uint32_t)(inst_id - id);
+          if (id >= inst_id) ops[ops_len++] = type;
+          break;
+        }
+        case PLX_LLVM_BC_OP_SIGNED_VALUE: {
+          const uint32_t id = plx_llvm_bc_value_id(writer, op->value, &type);
+          ops[ops_len++] =
+              plx_llvm_bc_signed((uint64_t)((int64_t)inst_id - (int64_t)id));
+          break;
+        }
+        case PLX_LLVM_BC_OP_ABSOLUTE_VALUE:
+          ops[ops_len++] = plx_llvm_bc_value_id(writer, op->value, &type);
+          break;
+        case PLX_LLVM_BC_OP_BLOCK:
+          if (op->value >= func->labels_len ||
+              module->labels[func->labels_begin + op->value] ==
+                  PLX_LLVM_BC_NONE) {
+            writer->error = true;
+            break;
+          }
+          ops[ops_len++] = module->labels[func->labels_begin + op->value];
+          break;
+      }
+    }
+    plx_bitstream_emit_record(stream, inst->code, ops, ops_len);
+    if (inst->has_value) ++inst_id;
+  }
+  free(ops);
+  plx_bitstream_exit_block(stream);
+}
+
+// Writes the module. Names are stored in the string table, which is added to
+// the buffer.
+static bool plx_llvm_bc_write_module(struct plx_bitstream* const stream,
+                                     struct plx_llvm_bc_module* const module,
+                                     struct plx_buffer* const strtab) {
+  const uint32_t ptr_type = plx_llvm_bc_add_ptr_type(module);
+
+  plx_bitstream_enter_block(stream, PLX_LLVM_BC_MODULE_BLOCK,
+                            PLX_LLVM_BC_ABBREV_WIDTH);
+  // Version 2 stores names in the string table.
+  const uint64_t version = 2;
+  plx_bitstream_emit_record(stream, PLX_LLVM_BC_MODULE_VERSION, &version, 1);
+  uint32_t* attr_sets;
+  size_t attr_sets_len;
+  plx_llvm_bc_write_attrs(stream, module, &attr_sets, &attr_sets_len);
+  plx_llvm_bc_write_types(stream, module);
+
+  // Strings are stored as one character per operand.
+  size_t str_cap = 0;
+  uint64_t* str = NULL;
+  const struct {
+    unsigned int code;
+    const char* data;
+    size_t len;
+  } strs[] = {
+      {PLX_LLVM_BC_MODULE_TRIPLE, module->triple, module->triple_len},
+      {PLX_LLVM_BC_MODULE_DATALAYOUT, module->datalayout,
+       module->datalayout_len},
+  };
+  for (size_t i = 0; i < sizeof(strs) / sizeof(strs[0]); ++i) {
+    if (strs[i].data == NULL) continue;
+    str = plx_llvm_bc_reserve(str, &str_cap, strs[i].len, sizeof(uint64_t));
+    for (size_t j = 0; j < strs[i].len; ++j) {
+      str[j] = (unsigned char)strs[i].data[j];
+    }
+    plx_bitstream_emit_record(stream, strs[i].code, str, strs[i].len);
+  }
+  free(str);
+
+  // Globals are numbered first, followed by the initializers of variables.
+  uint32_t init_id = (uint32_t)module->globals_len;
+  size_t inits_cap = 0, inits_len = 0;
+  struct plx_llvm_bc_constant* inits = NULL;
+  for (size_t i = 0; i < module->globals_len; ++i) {
+    const struct plx_llvm_bc_global* const global = &module->globals[i];
+    const uint64_t name_offset = strtab->len;
+    plx_buffer_append(strtab, global->name, global->name_len);
+    if (global->is_func) {
+      // Attribute lists are numbered from one, and zero means none.
+      uint64_t paramattr = 0;
+      if (global->attrs != 0) {
+        while (attr_sets[paramattr] != global->attrs) ++paramattr;
+        ++paramattr;
+      }
+      const uint64_t ops[] = {
+          name_offset, global->name_len, global->type,
+          /*callingconv=*/0, /*isproto=*/global->external, /*linkage=*/0,
+          paramattr, /*alignment=*/0, /*section=*/0,
+          /*visibility=*/0, /*gc=*/0, /*unnamed_addr=*/0,
+      };
+      plx_bitstream_emit_record(stream, PLX_LLVM_BC_MODULE_FUNCTION, ops,
+                                sizeof(ops) / sizeof(ops[0]));
+      continue;
+    }
+    // The second bit of the constness field marks the value type as explicit.
+    // Declarations have no initializer.
+    const uint64_t ops[] = {
+        name_offset, global->name_len, global->type,
+        (uint64_t)global->is_const | 2,
+        /*initid=*/global->external ? 0 : init_id++ + 1,
+        /*linkage=*/0, /*alignment=*/0, /*section=*/0,
+        /*visibility=*/0, /*threadlocal=*/0, global->unnamed_addr,
+    };
+    plx_bitstream_emit_record(stream, PLX_LLVM_BC_MODULE_GLOBALVAR, ops,
+                              sizeof(ops) / sizeof(ops[0]));
+    if (global->external) continue;
+    inits = plx_llvm_bc_reserve(inits, &inits_cap, inits_len + 1,
+                                sizeof(*inits));
+    inits[inits_len++] = global->init;
+  }
+  plx_llvm_bc_write_constants(stream, module, inits, inits_len,
+                              (uint32_t)module->globals_len);
+  free(inits);
+  free(attr_sets);
+
+  // Function bodies must be in the same order as the function records.
+  struct plx_llvm_bc_func_writer writer = {module, NULL, init_id, ptr_type,
+                                           false};
+  for (size_t i = 0; i < module->globals_len; ++i) {
+    const struct plx_llvm_bc_global* const global = &module->globals[i];
+    if (!global->is_func || global->external) continue;
+    writer.func = &module->funcs[global->func];
+    plx_llvm_bc_write_func(stream, &writer);
+  }
+  plx_bitstream_exit_block(stream);
+
+  if (plx_unlikely(writer.error)) {
+    plx_error("undefined value in LLVM IR");
+    return false;
+  }
+  return true;
+}
+
+bool plx_write_llvm_bitcode(const struct plx_buffer* const ir,
+                            struct plx_buffer* const bitcode) {
+  struct plx_llvm_bc_module module;
+  memset(&module, 0, sizeof(module));
+  if (!plx_llvm_bc_read(&module, ir)) {
+    plx_llvm_bc_module_free(&module);
+    return false;
+  }
+
+  struct plx_bitstream stream;
+  plx_bitstream_init(&stream, bitcode);
+  plx_bitstream_emit(&stream, 'B', 8);
+  plx_bitstream_emit(&stream, 'C', 8);
+  plx_bitstream_emit(&stream, 0x0, 4);
+  plx_bitstream_emit(&stream, 0xc, 4);
+  plx_bitstream_emit(&stream, 0xe, 4);
+  plx_bitstream_emit(&stream, 0xd, 4);
+
+  plx_bitstream_enter_block(&stream, PLX_LLVM_BC_IDENTIFICATION_BLOCK,
+                            PLX_LLVM_BC_ABBREV_WIDTH);
+  const uint64_t producer[] = {'P', 'L', 'X'};
+  plx_bitstream_emit_record(&stream, PLX_LLVM_BC_IDENTIFICATION_STRING,
+                            producer, sizeof(producer) / sizeof(producer[0]));
+  const uint64_t epoch = 0;
+  plx_bitstream_emit_record(&stream, PLX_LLVM_BC_IDENTIFICATION_EPOCH, &epoch,
+                            1);
+  plx_bitstream_exit_block(&stream);
+
+  struct plx_buffer strtab = PLX_BUFFER_INIT;
+  const bool ok = plx_llvm_bc_write_module(&stream, &module, &strtab);
+  if (ok) {
+    plx_bitstream_enter_block(&stream, PLX_LLVM_BC_STRTAB_BLOCK,
+                              PLX_LLVM_BC_ABBREV_WIDTH);
+    const unsigned int abbrev =
+        plx_bitstream_define_blob_abbrev(&stream, PLX_LLVM_BC_STRTAB_BLOB);
+    plx_bitstream_emit_blob(&stream, abbrev, strtab.data, strtab.len);
+    plx_bitstream_exit_block(&stream);
+  }
+  plx_bitstream_align(&stream);
+  plx_buffer_free(&strtab);
+  plx_llvm_bc_module_free(&module);
+  return ok;
+}
@@ -0,0 +1,29 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_LLVM_BITCODE_WRITER_H
+#define PLX_LLVM_BITCODE_WRITER_H
+
+#include <stdbool.h>
+
+#include "buffer.h"
+
+// Assembles LLVM IR text from `plx_generate_llvm_ir` into LLVM bitcode for
+// `--emit bc`, appending it to the output buffer. Only the subset of LLVM IR
+// that the generator produces is supported. Returns whether it succeeded.
+// https://llvm.org/docs/BitCodeFormat.html
+bool plx_write_llvm_bitcode(const struct plx_buffer* ir,
+                            struct plx_buffer* bitcode);
+
+#endif  // PLX_LLVM_BITCODE_WRITER_H
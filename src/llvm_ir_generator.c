@@ -16,32 +16,118 @@
 
 #include <assert.h>
 #include <stdarg.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "call_graph.h"
+#include "error.h"
+#include "macros.h"
 #include "symbol_table_entry.h"
 #include "types.h"
 
+struct plx_llvm_ir_func {
+  // Number of locals that have been allocated.
+  plx_llvm_local locals;
+
+  // Label of the current basic block.
+  plx_llvm_local block;
+
+  // Whether the current basic block has been terminated.
+  bool terminated;
+
+  // Fast-math flags of floating point instructions with a leading space, or an
+  // empty string if floating point math is strict.
+  const char* fast_math_flags;
+
+  // Constants that are referred to by operands.
+  size_t constants_cap;
+  size_t constants_len;
+  const struct plx_node** constants;
+};
+
+// Flag of an operand that refers to a constant rather than a local. The other
+// bits are the index of the constant.
+#define PLX_LLVM_IR_CONSTANT (1U << 31)
+
+// Set of local variables kept in SSA form.
+struct plx_llvm_ir_vars {
+  size_t cap;
+  size_t len;
+  struct plx_symbol_table_entry** entries;
+};
+
+// Incoming edges to a basic block, along with the values of a set of variables
+// on each edge.
+struct plx_llvm_ir_edges {
+  size_t cap;
+  size_t len;
+  plx_llvm_local* blocks;
+  plx_llvm_local* values;
+};
+
+// Pointer operand. Globals are addressed directly by name rather than through
+// a local.
+struct plx_llvm_ir_ptr {
+  // Name of the global, or `NULL` if the pointer is held in a local.
+  const char* global;
+
+  // Local that holds the pointer.
+  plx_llvm_local local;
+};
+
+// Lane of a vector that is held in memory.
+struct plx_llvm_ir_lane {
+  // Vector type.
+  const struct plx_node* vec_type;
+
+  // Pointer to the vector.
+  struct plx_llvm_ir_ptr vec_ptr;
+
+  // Index of the lane.
+  const struct plx_node* index_type;
+  plx_llvm_local index;
+};
+
+struct plx_llvm_ir_loop {
+  // Label of the loop header.
+  plx_llvm_local header_label;
+
+  // Label of the loop exit.
+  plx_llvm_local exit_label;
+
+  // Variables that are assigned to in the loop.
+  struct plx_llvm_ir_vars vars;
+
+  // Incoming edges to the loop header.
+  struct plx_llvm_ir_edges header_edges;
+
+  // Incoming edges to the loop exit.
+  struct plx_llvm_ir_edges exit_edges;
+};
+
 static void plx_generate_llvm_ir_constant(const struct plx_node* const node,
-                                          FILE* const stream) {
+                                          struct plx_buffer* const buffer) {
   switch (node->kind) {
     case PLX_NODE_S8:
     case PLX_NODE_S16:
     case PLX_NODE_S32:
     case PLX_NODE_S64:
-      fprintf(stream, "%lld", node->sint);
+      plx_buffer_append_ll(buffer, node->sint);
       break;
     case PLX_NODE_U8:
     case PLX_NODE_U16:
     case PLX_NODE_U32:
     case PLX_NODE_U64:
-      fprintf(stream, "%llu", node->uint);
+      plx_buffer_append_ull(buffer, node->uint);
       break;
     case PLX_NODE_F16:
     case PLX_NODE_F32:
     case PLX_NODE_F64:
-      fprintf(stream, "%f", node->f);
+      plx_buffer_append_f(buffer, node->f);
       break;
     case PLX_NODE_BOOL:
-      fputs(node->b ? "true" : "false", stream);
+      plx_buffer_append_str(buffer, node->b ? "true" : "false");
       break;
     default:
       assert(false);
@@ -49,211 +135,977 @@ static void plx_generate_llvm_ir_constant(const struct plx_node* const node,
 }
 
 static void plx_generate_llvm_ir_type(const struct plx_node* const type,
-                                      FILE* const stream) {
+                                      struct plx_buffer* const buffer) {
   switch (type->kind) {
     case PLX_NODE_VOID_TYPE:
-      fputs("void", stream);
+      plx_buffer_append_str(buffer, "void");
       break;
     case PLX_NODE_S8_TYPE:
     case PLX_NODE_U8_TYPE:
-      fputs("i8", stream);
+      plx_buffer_append_str(buffer, "i8");
       break;
     case PLX_NODE_S16_TYPE:
     case PLX_NODE_U16_TYPE:
-      fputs("i16", stream);
+      plx_buffer_append_str(buffer, "i16");
       break;
     case PLX_NODE_S32_TYPE:
     case PLX_NODE_U32_TYPE:
-      fputs("i32", stream);
+      plx_buffer_append_str(buffer, "i32");
       break;
     case PLX_NODE_S64_TYPE:
     case PLX_NODE_U64_TYPE:
-      fputs("i64", stream);
+      plx_buffer_append_str(buffer, "i64");
       break;
     case PLX_NODE_F16_TYPE:
-      fputs("half", stream);
+      plx_buffer_append_str(buffer, "half");
       break;
     case PLX_NODE_F32_TYPE:
-      fputs("float", stream);
+      plx_buffer_append_str(buffer, "float");
       break;
     case PLX_NODE_F64_TYPE:
-      fputs("double", stream);
+      plx_buffer_append_str(buffer, "double");
       break;
     case PLX_NODE_BOOL_TYPE:
-      fputs("i1", stream);
+      plx_buffer_append_str(buffer, "i1");
       break;
     case PLX_NODE_STRING_TYPE:
       assert(false);
       break;
     case PLX_NODE_FUNC_TYPE:
     case PLX_NODE_REF_TYPE:
-      fputs("ptr", stream);
+      plx_buffer_append_str(buffer, "ptr");
       break;
     case PLX_NODE_ARRAY_TYPE: {
       const struct plx_node *len, *element_type;
       plx_extract_children(type, &len, &element_type);
-      fputc('[', stream);
-      plx_generate_llvm_ir_constant(len, stream);
-      fputs(" x ", stream);
-      plx_generate_llvm_ir_type(element_type, stream);
-      fputc(']', stream);
+      plx_buffer_append_char(buffer, '[');
+      plx_generate_llvm_ir_constant(len, buffer);
+      plx_buffer_append_str(buffer, " x ");
+      plx_generate_llvm_ir_type(element_type, buffer);
+      plx_buffer_append_char(buffer, ']');
       break;
     }
     case PLX_NODE_SLICE_TYPE:
-      fputs("{ i64, ptr }", stream);
+      plx_buffer_append_str(buffer, "{ i64, ptr }");
+      break;
+    case PLX_NODE_VEC_TYPE: {
+      const struct plx_node *len, *element_type;
+      plx_extract_children(type, &len, &element_type);
+      plx_buffer_append_char(buffer, '<');
+      plx_generate_llvm_ir_constant(len, buffer);
+      plx_buffer_append_str(buffer, " x ");
+      plx_generate_llvm_ir_type(element_type, buffer);
+      plx_buffer_append_char(buffer, '>');
       break;
+    }
     default:
       assert(false);
   }
 }
 
-// Writes the format string to the output stream with custom format specifiers
-// for LLVM IR.
-static void plx_llvm_ir_fprintf(FILE* const stream, const char* format, ...) {
+// Appends the format string to the output buffer with custom format specifiers
+// for LLVM IR. Runs of literal characters are appended in bulk. Operands are
+// looked up in the function, which may be `NULL` outside of functions.
+static void plx_llvm_ir_printf(struct plx_buffer* const buffer,
+                               const struct plx_llvm_ir_func* const func,
+                               const char* format, ...) {
   va_list arg;
   va_start(arg, format);
-  for (; format[0] != '\0'; ++format) {
-    if (format[0] != '%') {
-      fputc(format[0], stream);
-      continue;
+  for (;;) {
+    const char* const spec = strchr(format, '%');
+    if (spec == NULL) {
+      plx_buffer_append_str(buffer, format);
+      break;
     }
-    switch (format[1]) {
+    plx_buffer_append(buffer, format, (size_t)(spec - format));
+    switch (spec[1]) {
       // Constant
       case 'c':
         plx_generate_llvm_ir_constant(va_arg(arg, const struct plx_node*),
-                                      stream);
+                                      buffer);
         break;
       // String
       case 's':
-        fputs(va_arg(arg, const char*), stream);
+        plx_buffer_append_str(buffer, va_arg(arg, const char*));
         break;
       // Type
       case 't':
-        plx_generate_llvm_ir_type(va_arg(arg, const struct plx_node*), stream);
+        plx_generate_llvm_ir_type(va_arg(arg, const struct plx_node*), buffer);
         break;
-      // Unnamed identifier
+      // Pointer
+      case 'p': {
+        const struct plx_llvm_ir_ptr ptr = va_arg(arg, struct plx_llvm_ir_ptr);
+        if (ptr.global != NULL) {
+          plx_buffer_append_char(buffer, '@');
+          plx_buffer_append_str(buffer, ptr.global);
+        } else {
+          plx_buffer_append_str(buffer, "%v");
+          plx_buffer_append_ull(buffer, ptr.local);
+        }
+        break;
+      }
+      // Operand, which is either a local or a constant
+      case 'v': {
+        const plx_llvm_local operand = va_arg(arg, plx_llvm_local);
+        if (operand & PLX_LLVM_IR_CONSTANT) {
+          plx_generate_llvm_ir_constant(
+              func->constants[operand & ~PLX_LLVM_IR_CONSTANT], buffer);
+        } else {
+          plx_buffer_append_str(buffer, "%v");
+          plx_buffer_append_ull(buffer, operand);
+        }
+        break;
+      }
+      // Local
       case 'u':
-        fprintf(stream, "%u", va_arg(arg, plx_llvm_unnamed_identifier));
+        plx_buffer_append_ull(buffer, va_arg(arg, plx_llvm_local));
         break;
       // Escape
       case '%':
-        fputc('%', stream);
+        plx_buffer_append_char(buffer, '%');
         break;
       default:
         assert(false);
     }
-    ++format;
+    format = &spec[2];
   }
   va_end(arg);
 }
 
-static plx_llvm_unnamed_identifier plx_generate_llvm_ir_ptr(
-    const struct plx_node* const node, FILE* const stream,
-    plx_llvm_unnamed_identifier* const locals) {
+// Returns whether a variable is kept in SSA form rather than in a stack slot.
+static bool plx_is_llvm_ir_ssa_var(
+    const struct plx_symbol_table_entry* const entry) {
+  return entry->scope == PLX_SYMBOL_SCOPE_LOCAL && !entry->referenced &&
+         plx_is_scalar_type(entry->type);
+}
+
+// Returns whether a symbol names a function.
+static bool plx_is_llvm_ir_func(
+    const struct plx_symbol_table_entry* const entry) {
+  return entry->scope == PLX_SYMBOL_SCOPE_GLOBAL &&
+         entry->mutability == PLX_SYMBOL_MUTABILITY_CONST &&
+         entry->type->kind == PLX_NODE_FUNC_TYPE;
+}
+
+static bool plx_llvm_ir_vars_contains(
+    const struct plx_llvm_ir_vars* const vars,
+    const struct plx_symbol_table_entry* const entry) {
+  for (size_t i = 0; i < vars->len; ++i) {
+    if (vars->entries[i] == entry) return true;
+  }
+  return false;
+}
+
+static void plx_llvm_ir_vars_add(struct plx_llvm_ir_vars* const vars,
+                                 struct plx_symbol_table_entry* const entry) {
+  if (plx_llvm_ir_vars_contains(vars, entry)) return;
+  assert(vars->len <= vars->cap);
+  if (plx_unlikely(vars->len == vars->cap)) {
+    size_t cap = vars->cap * 2;
+    if (plx_unlikely(cap == 0)) cap = 8;
+    void* const entries =
+        realloc(vars->entries, cap * sizeof(struct plx_symbol_table_entry*));
+    if (plx_unlikely(entries == NULL)) plx_oom();
+    vars->cap = cap;
+    vars->entries = entries;
+  }
+  vars->entries[vars->len++] = entry;
+}
+
+static void plx_collect_llvm_ir_vars(const struct plx_node* const node,
+                                     struct plx_llvm_ir_vars* const assigned,
+                                     struct plx_llvm_ir_vars* const declared) {
+  switch (node->kind) {
+    case PLX_NODE_CONST_DEF:
+    case PLX_NODE_VAR_DEF:
+    case PLX_NODE_VAR_DECL:
+      plx_llvm_ir_vars_add(declared, node->children->entry);
+      break;
+    case PLX_NODE_ASSIGN:
+    case PLX_NODE_ADD_ASSIGN:
+    case PLX_NODE_SUB_ASSIGN:
+    case PLX_NODE_MUL_ASSIGN:
+    case PLX_NODE_DIV_ASSIGN:
+    case PLX_NODE_REM_ASSIGN:
+    case PLX_NODE_LSHIFT_ASSIGN:
+    case PLX_NODE_RSHIFT_ASSIGN: {
+      const struct plx_node* const assignee = node->children;
+      if (assignee->kind == PLX_NODE_IDENTIFIER &&
+          plx_is_llvm_ir_ssa_var(assignee->entry)) {
+        plx_llvm_ir_vars_add(assigned, assignee->entry);
+      }
+      break;
+    }
+    default:
+      for (const struct plx_node* child = node->children; child != NULL;
+           child = child->next) {
+        plx_collect_llvm_ir_vars(child, assigned, declared);
+      }
+  }
+}
+
+// Initializes the set of variables that are assigned to in a statement and
+// that were declared before it. These are the variables that need phi nodes
+// where control flow joins after the statement.
+static void plx_llvm_ir_vars_init(struct plx_llvm_ir_vars* const vars,
+                                  const struct plx_node* const stmt) {
+  *vars = (struct plx_llvm_ir_vars){0, 0, NULL};
+  struct plx_llvm_ir_vars declared = {0, 0, NULL};
+  plx_collect_llvm_ir_vars(stmt, vars, &declared);
+  size_t len = 0;
+  for (size_t i = 0; i < vars->len; ++i) {
+    if (!plx_llvm_ir_vars_contains(&declared, vars->entries[i])) {
+      vars->entries[len++] = vars->entries[i];
+    }
+  }
+  vars->len = len;
+  free(declared.entries);
+}
+
+static void plx_llvm_ir_vars_free(struct plx_llvm_ir_vars* const vars) {
+  free(vars->entries);
+}
+
+// Adds an edge from the current basic block, recording the current values of
+// the variables.
+static void plx_llvm_ir_edges_add(struct plx_llvm_ir_edges* const edges,
+                                  const struct plx_llvm_ir_vars* const vars,
+                                  const struct plx_llvm_ir_func* const func) {
+  assert(edges->len <= edges->cap);
+  if (plx_unlikely(edges->len == edges->cap)) {
+    size_t cap = edges->cap * 2;
+    if (plx_unlikely(cap == 0)) cap = 4;
+    void* const blocks = realloc(edges->blocks, cap * sizeof(plx_llvm_local));
+    if (plx_unlikely(blocks == NULL)) plx_oom();
+    edges->blocks = blocks;
+    if (vars->len > 0) {
+      void* const values =
+          realloc(edges->values, cap * vars->len * sizeof(plx_llvm_local));
+      if (plx_unlikely(values == NULL)) plx_oom();
+      edges->values = values;
+    }
+    edges->cap = cap;
+  }
+  for (size_t i = 0; i < vars->len; ++i) {
+    edges->values[edges->len * vars->len + i] =
+        vars->entries[i]->llvm_local_var;
+  }
+  edges->blocks[edges->len++] = func->block;
+}
+
+static void plx_llvm_ir_edges_free(struct plx_llvm_ir_edges* const edges) {
+  free(edges->blocks);
+  free(edges->values);
+}
+
+// Returns an operand that refers to a constant, which is written as an
+// immediate rather than being materialized in a local.
+static plx_llvm_local plx_llvm_ir_constant(
+    const struct plx_node* const node, struct plx_llvm_ir_func* const func) {
+  assert(func->constants_len <= func->constants_cap);
+  if (plx_unlikely(func->constants_len == func->constants_cap)) {
+    size_t cap = func->constants_cap * 2;
+    if (plx_unlikely(cap == 0)) cap = 16;
+    void* const constants =
+        realloc(func->constants, cap * sizeof(*func->constants));
+    if (plx_unlikely(constants == NULL)) plx_oom();
+    func->constants = constants;
+    func->constants_cap = cap;
+  }
+  func->constants[func->constants_len] = node;
+  return PLX_LLVM_IR_CONSTANT | (plx_llvm_local)func->constants_len++;
+}
+
+// Starts a new basic block.
+static void plx_generate_llvm_ir_label(const plx_llvm_local label,
+                                       struct plx_buffer* const buffer,
+                                       struct plx_llvm_ir_func* const func) {
+  plx_llvm_ir_printf(buffer, func, "bb%u:\n", label);
+  func->block = label;
+  func->terminated = false;
+}
+
+// Terminates the current basic block with an unconditional branch.
+static void plx_generate_llvm_ir_br(const plx_llvm_local label,
+                                    struct plx_buffer* const buffer,
+                                    struct plx_llvm_ir_func* const func) {
+  plx_llvm_ir_printf(buffer, func, "  br label %%bb%u\n", label);
+  func->terminated = true;
+}
+
+// Generates a phi node that merges the values of a variable on the incoming
+// edges.
+static void plx_generate_llvm_ir_phi(
+    const plx_llvm_local result_var, const struct plx_llvm_ir_vars* const vars,
+    const size_t var, const struct plx_llvm_ir_edges* const edges,
+    struct plx_buffer* const buffer,
+    const struct plx_llvm_ir_func* const func) {
+  plx_llvm_ir_printf(buffer, func, "  %v = phi %t ", result_var,
+                     vars->entries[var]->type);
+  for (size_t i = 0; i < edges->len; ++i) {
+    plx_llvm_ir_printf(buffer, func, "[ %v, %%bb%u ]",
+                       edges->values[i * vars->len + var], edges->blocks[i]);
+    if (i + 1 < edges->len) plx_buffer_append_str(buffer, ", ");
+  }
+  plx_buffer_append_char(buffer, '\n');
+}
+
+// Generates the basic block where the incoming edges join, merging the values
+// of the variables. Phi nodes are only generated for variables whose values
+// differ between the edges.
+static void plx_generate_llvm_ir_join(
+    const plx_llvm_local label, const struct plx_llvm_ir_vars* const vars,
+    const struct plx_llvm_ir_edges* const edges,
+    struct plx_buffer* const buffer, struct plx_llvm_ir_func* const func) {
+  // The block is unreachable.
+  if (edges->len == 0) {
+    func->terminated = true;
+    return;
+  }
+
+  plx_generate_llvm_ir_label(label, buffer, func);
+  for (size_t var = 0; var < vars->len; ++var) {
+    const plx_llvm_local value = edges->values[var];
+    bool same = true;
+    for (size_t i = 1; i < edges->len; ++i) {
+      if (edges->values[i * vars->len + var] != value) same = false;
+    }
+    if (same) {
+      vars->entries[var]->llvm_local_var = value;
+      continue;
+    }
+    const plx_llvm_local result_var = func->locals++;
+    plx_generate_llvm_ir_phi(result_var, vars, var, edges, buffer, func);
+    vars->entries[var]->llvm_local_var = result_var;
+  }
+}
+
+// Generates stack slots in the entry block for the local variables that are not
+// kept in SSA form.
+static void plx_generate_llvm_ir_allocas(const struct plx_node* const node,
+                                         struct plx_buffer* const buffer,
+                                         struct plx_llvm_ir_func* const func) {
+  switch (node->kind) {
+    case PLX_NODE_CONST_DEF:
+    case PLX_NODE_VAR_DEF:
+    case PLX_NODE_VAR_DECL:
+    case PLX_NODE_FOR_LOOP: {
+      struct plx_symbol_table_entry* const entry = node->children->entry;
+      if (!plx_is_llvm_ir_ssa_var(entry)) {
+        entry->llvm_local_var = func->locals++;
+        plx_llvm_ir_printf(buffer, func, "  %v = alloca %t\n",
+                           entry->llvm_local_var, entry->type);
+      }
+      // The body of a loop declares more variables.
+      if (node->kind == PLX_NODE_FOR_LOOP) {
+        plx_generate_llvm_ir_allocas(node->children->next->next, buffer, func);
+      }
+      break;
+    }
+    default:
+      for (const struct plx_node* child = node->children; child != NULL;
+           child = child->next) {
+        plx_generate_llvm_ir_allocas(child, buffer, func);
+      }
+  }
+}
+
+// Returns the instruction for a compound assignment.
+static const char* plx_llvm_ir_assign_instruction(
+    const struct plx_node* const node) {
+  const struct plx_node* const type = plx_lane_type(node->children->type);
+  switch (node->kind) {
+    case PLX_NODE_ADD_ASSIGN:
+      return plx_is_float_type(type) ? "fadd" : "add";
+    case PLX_NODE_SUB_ASSIGN:
+      return plx_is_float_type(type) ? "fsub" : "sub";
+    case PLX_NODE_MUL_ASSIGN:
+      return plx_is_float_type(type) ? "fmul" : "mul";
+    case PLX_NODE_DIV_ASSIGN:
+      if (plx_is_float_type(type)) return "fdiv";
+      return plx_is_sint_type(type) ? "sdiv" : "udiv";
+    case PLX_NODE_REM_ASSIGN:
+      assert(plx_is_int_type(type));
+      return plx_is_sint_type(type) ? "srem" : "urem";
+    case PLX_NODE_LSHIFT_ASSIGN:
+      assert(plx_is_int_type(type));
+      return "shl";
+    case PLX_NODE_RSHIFT_ASSIGN:
+      assert(plx_is_int_type(type));
+      return "lshr";
+    default:
+      assert(false);
+  }
+  return NULL;
+}
+
+static struct plx_llvm_ir_ptr plx_generate_llvm_ir_ptr(
+    const struct plx_node* const node, struct plx_buffer* const buffer,
+    struct plx_llvm_ir_func* const func) {
   switch (node->kind) {
     case PLX_NODE_INDEX: {
       const struct plx_node *value, *index;
       plx_extract_children(node, &value, &index);
-      const plx_llvm_unnamed_identifier value_var =
-          plx_generate_llvm_ir_expr(value, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      plx_llvm_ir_fprintf(
-          stream, "  %%%u = getelementptr inbounds %t, ptr %%%u, %t %c\n",
-          result_var, value->type, value_var, index->type, index);
-      return result_var;
+      const struct plx_llvm_ir_ptr value_ptr =
+          plx_generate_llvm_ir_ptr(value, buffer, func);
+      const plx_llvm_local index_var =
+          plx_generate_llvm_ir_expr(index, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
+      plx_llvm_ir_printf(buffer, func,
+                         "  %v = getelementptr inbounds %t, ptr %p, "
+                         "i64 0, %t %v\n",
+                         result_var, value->type, value_ptr, index->type,
+                         index_var);
+      return (struct plx_llvm_ir_ptr){NULL, result_var};
     }
     case PLX_NODE_FIELD:
       // TODO
       assert(false);
       break;
+    case PLX_NODE_DEREF: {
+      const struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      return (struct plx_llvm_ir_ptr){
+          NULL, plx_generate_llvm_ir_expr(operand, buffer, func)};
+    }
     case PLX_NODE_IDENTIFIER:
       switch (node->entry->scope) {
         case PLX_SYMBOL_SCOPE_LOCAL:
-          return node->entry->llvm_local_var;
-        case PLX_SYMBOL_SCOPE_GLOBAL: {
-          const plx_llvm_unnamed_identifier result_var = (*locals)++;
-          plx_llvm_ir_fprintf(stream,
-                              "  %%%u = alloca ptr\n"
-                              "  store ptr @%s, ptr %%%u\n",
-                              result_var, node->name, result_var);
-          return result_var;
-        }
+          assert(!plx_is_llvm_ir_ssa_var(node->entry));
+          return (struct plx_llvm_ir_ptr){NULL, node->entry->llvm_local_var};
+        case PLX_SYMBOL_SCOPE_GLOBAL:
+          return (struct plx_llvm_ir_ptr){node->name, 0};
       }
       break;
     default:
       assert(false);
   }
-  return 0;
+  return (struct plx_llvm_ir_ptr){NULL, 0};
+}
+
+// Returns whether an expression indexes into a vector.
+static bool plx_is_llvm_ir_lane(const struct plx_node* const node) {
+  return node->kind == PLX_NODE_INDEX &&
+         plx_is_vec_type(node->children->type);
+}
+
+// Generates the pointer to the vector and the index of a lane. Lanes are not
+// addressable, so they are read and written with `extractelement` and
+// `insertelement` on the whole vector.
+static struct plx_llvm_ir_lane plx_generate_llvm_ir_lane(
+    const struct plx_node* const node, struct plx_buffer* const buffer,
+    struct plx_llvm_ir_func* const func) {
+  const struct plx_node *value, *index;
+  plx_extract_children(node, &value, &index);
+  const struct plx_llvm_ir_ptr vec_ptr =
+      plx_generate_llvm_ir_ptr(value, buffer, func);
+  const plx_llvm_local index_var =
+      plx_generate_llvm_ir_expr(index, buffer, func);
+  return (struct plx_llvm_ir_lane){value->type, vec_ptr, index->type,
+                                   index_var};
+}
+
+// Returns whether an expression operates on each lane of a vector.
+static bool plx_is_llvm_ir_vector_op(const struct plx_node* const node) {
+  switch (node->kind) {
+    case PLX_NODE_AND:
+    case PLX_NODE_OR:
+    case PLX_NODE_XOR:
+    case PLX_NODE_EQ:
+    case PLX_NODE_NEQ:
+    case PLX_NODE_LTE:
+    case PLX_NODE_LT:
+    case PLX_NODE_GTE:
+    case PLX_NODE_GT:
+    case PLX_NODE_ADD:
+    case PLX_NODE_SUB:
+    case PLX_NODE_MUL:
+    case PLX_NODE_DIV:
+    case PLX_NODE_REM:
+    case PLX_NODE_LSHIFT:
+    case PLX_NODE_RSHIFT:
+    case PLX_NODE_NOT:
+    case PLX_NODE_NEG:
+      return plx_is_vec_type(node->children->type);
+    default:
+      return false;
+  }
+}
+
+// Returns the instruction for a binary operation on vectors with a lane type.
+static const char* plx_llvm_ir_vector_instruction(
+    const enum plx_node_kind kind, const struct plx_node* const lane_type) {
+  const bool is_float = plx_is_float_type(lane_type);
+  const bool is_sint = plx_is_sint_type(lane_type);
+  switch (kind) {
+    case PLX_NODE_AND:
+      return "and";
+    case PLX_NODE_OR:
+      return "or";
+    case PLX_NODE_XOR:
+      return "xor";
+    case PLX_NODE_EQ:
+      return is_float ? "fcmp oeq" : "icmp eq";
+    case PLX_NODE_NEQ:
+      return is_float ? "fcmp one" : "icmp ne";
+    case PLX_NODE_LTE:
+      if (is_float) return "fcmp ole";
+      return is_sint ? "icmp sle" : "icmp ule";
+    case PLX_NODE_LT:
+      if (is_float) return "fcmp olt";
+      return is_sint ? "icmp slt" : "icmp ult";
+    case PLX_NODE_GTE:
+      if (is_float) return "fcmp oge";
+      return is_sint ? "icmp sge" : "icmp uge";
+    case PLX_NODE_GT:
+      if (is_float) return "fcmp ogt";
+      return is_sint ? "icmp sgt" : "icmp ugt";
+    case PLX_NODE_ADD:
+      return is_float ? "fadd" : "add";
+    case PLX_NODE_SUB:
+      return is_float ? "fsub" : "sub";
+    case PLX_NODE_MUL:
+      return is_float ? "fmul" : "mul";
+    case PLX_NODE_DIV:
+      if (is_float) return "fdiv";
+      return is_sint ? "sdiv" : "udiv";
+    case PLX_NODE_REM:
+      return is_sint ? "srem" : "urem";
+    case PLX_NODE_LSHIFT:
+      return "shl";
+    case PLX_NODE_RSHIFT:
+      return "lshr";
+    default:
+      assert(false);
+  }
+  return NULL;
+}
+
+// Generates a constant vector of `count` lane indices for `shufflevector`. The
+// first `defined` indices count up from `first`, and the rest are poison.
+static void plx_generate_llvm_ir_shuffle_mask(
+    const unsigned long long count, const unsigned long long first,
+    const unsigned long long defined, struct plx_buffer* const buffer) {
+  plx_llvm_ir_printf(buffer, NULL, "<%u x i32> <", (plx_llvm_local)count);
+  for (unsigned long long i = 0; i < count; ++i) {
+    if (i < defined) {
+      plx_llvm_ir_printf(buffer, NULL, "i32 %u", (plx_llvm_local)(first + i));
+    } else {
+      plx_buffer_append_str(buffer, "i32 poison");
+    }
+    if (i + 1 < count) plx_buffer_append_str(buffer, ", ");
+  }
+  plx_buffer_append_char(buffer, '>');
+}
+
+// Generates an element-wise operation on vectors.
+static plx_llvm_local plx_generate_llvm_ir_vector_op(
+    const struct plx_node* const node, struct plx_buffer* const buffer,
+    struct plx_llvm_ir_func* const func) {
+  const struct plx_node* const operand = node->children;
+  const struct plx_node* const lane_type = plx_lane_type(operand->type);
+  const char* const fast_math_flags =
+      plx_is_float_type(lane_type) ? func->fast_math_flags : "";
+  switch (node->kind) {
+    case PLX_NODE_NOT: {
+      const plx_llvm_local operand_var =
+          plx_generate_llvm_ir_expr(operand, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
+      plx_llvm_ir_printf(buffer, func, "  %v = xor %t %v, <", result_var,
+                         operand->type, operand_var);
+      for (unsigned long long i = 0; i < plx_vec_len(operand->type); ++i) {
+        if (i > 0) plx_buffer_append_str(buffer, ", ");
+        plx_llvm_ir_printf(buffer, func, "%t -1", lane_type);
+      }
+      plx_buffer_append_str(buffer, ">\n");
+      return result_var;
+    }
+    case PLX_NODE_NEG: {
+      const plx_llvm_local operand_var =
+          plx_generate_llvm_ir_expr(operand, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
+      if (plx_is_float_type(lane_type)) {
+        plx_llvm_ir_printf(buffer, func, "  %v = fneg%s %t %v\n", result_var,
+                           fast_math_flags, operand->type, operand_var);
+      } else {
+        plx_llvm_ir_printf(buffer, func,
+                           "  %v = sub %t zeroinitializer, %v\n",
+                           result_var, operand->type, operand_var);
+      }
+      return result_var;
+    }
+    default: {
+      const struct plx_node* const right = operand->next;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(operand, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
+      const char* const instruction =
+          plx_llvm_ir_vector_instruction(node->kind, lane_type);
+
+      // Fast-math flags only apply to floating point arithmetic.
+      plx_llvm_ir_printf(buffer, func, "  %v = %s%s %t %v, %v\n",
+                         result_var, instruction,
+                         instruction[0] == 'f' && instruction[1] != 'c'
+                             ? fast_math_flags
+                             : "",
+                         operand->type, left_var, right_var);
+      return result_var;
+    }
+  }
+}
+
+// Generates a horizontal reduction of the lanes of a vector. The upper half of
+// the lanes is repeatedly shuffled down and combined with the lower half, which
+// takes log2(N) steps and which backends match to horizontal instructions.
+static plx_llvm_local plx_generate_llvm_ir_reduce(
+    const struct plx_node* const node, struct plx_buffer* const buffer,
+    struct plx_llvm_ir_func* const func) {
+  const struct plx_node* const operand = node->children;
+  const struct plx_node* const vec_type = operand->type;
+  const struct plx_node* const lane_type = plx_lane_type(vec_type);
+  const unsigned long long len = plx_vec_len(vec_type);
+  const bool is_float = plx_is_float_type(lane_type);
+  const bool is_sint = plx_is_sint_type(lane_type);
+
+  // Select the instruction that combines two lanes.
+  const char* instruction = NULL;
+  const char* compare = NULL;
+  switch (node->kind) {
+    case PLX_NODE_REDUCE_ADD:
+      instruction = is_float ? "fadd" : "add";
+      break;
+    case PLX_NODE_REDUCE_MUL:
+      instruction = is_float ? "fmul" : "mul";
+      break;
+    case PLX_NODE_REDUCE_MIN:
+      if (is_float) {
+        compare = "fcmp olt";
+      } else {
+        compare = is_sint ? "icmp slt" : "icmp ult";
+      }
+      break;
+    case PLX_NODE_REDUCE_MAX:
+      if (is_float) {
+        compare = "fcmp ogt";
+      } else {
+        compare = is_sint ? "icmp sgt" : "icmp ugt";
+      }
+      break;
+    case PLX_NODE_REDUCE_AND:
+      instruction = "and";
+      break;
+    case PLX_NODE_REDUCE_OR:
+      instruction = "or";
+      break;
+    case PLX_NODE_REDUCE_XOR:
+      instruction = "xor";
+      break;
+    default:
+      assert(false);
+  }
+
+  plx_llvm_local vec_var = plx_generate_llvm_ir_expr(operand, buffer, func);
+  for (unsigned long long half = len / 2; half > 0; half /= 2) {
+    const plx_llvm_local shuffle_var = func->locals++;
+    plx_llvm_ir_printf(buffer, func, "  %v = shufflevector %t %v, %t poison, ",
+                       shuffle_var, vec_type, vec_var, vec_type);
+    plx_generate_llvm_ir_shuffle_mask(len, half, half, buffer);
+    plx_buffer_append_char(buffer, '\n');
+    const plx_llvm_local result_var = func->locals++;
+    if (compare == NULL) {
+      plx_llvm_ir_printf(buffer, func, "  %v = %s%s %t %v, %v\n",
+                         result_var, instruction,
+                         is_float ? func->fast_math_flags : "", vec_type,
+                         vec_var, shuffle_var);
+    } else {
+      const plx_llvm_local cmp_var = func->locals++;
+      plx_llvm_ir_printf(buffer, func,
+                         "  %v = %s %t %v, %v\n"
+                         "  %v = select <%u x i1> %v, %t %v, "
+                         "%t %v\n",
+                         cmp_var, compare, vec_type, vec_var, shuffle_var,
+                         result_var, (plx_llvm_local)len, cmp_var, vec_type,
+                         vec_var, vec_type, shuffle_var);
+    }
+    vec_var = result_var;
+  }
+  const plx_llvm_local result_var = func->locals++;
+  plx_llvm_ir_printf(buffer, func, "  %v = extractelement %t %v, i32 0\n",
+                     result_var, vec_type, vec_var);
+  return result_var;
+}
+
+// Generates a loop over a range, array, or slice in canonical form. A single
+// induction variable counts up from zero or the start of the range to an end
+// that is computed before the loop, and `continue` branches to the latch that
+// increments it, so LLVM can compute the trip count.
+static void plx_generate_llvm_ir_for_loop(const struct plx_node* const node,
+                                          struct plx_buffer* const buffer,
+                                          struct plx_llvm_ir_func* const func) {
+  static const struct plx_node u64_type = {PLX_NODE_U64_TYPE};
+  static const struct plx_node zero = {PLX_NODE_U64};
+  const struct plx_node *name, *iterable, *body;
+  plx_extract_children(node, &name, &iterable, &body);
+
+  // Compute the bounds of the induction variable. Arrays and slices are
+  // indexed from zero to their length.
+  const struct plx_node* counter_type = &u64_type;
+  plx_llvm_local start_var, end_var;
+  struct plx_llvm_ir_ptr elements_ptr = {NULL, 0};
+  if (iterable->kind == PLX_NODE_RANGE) {
+    const struct plx_node *start, *end;
+    plx_extract_children(iterable, &start, &end);
+    counter_type = iterable->type;
+    start_var = plx_generate_llvm_ir_expr(start, buffer, func);
+    end_var = plx_generate_llvm_ir_expr(end, buffer, func);
+  } else if (iterable->type->kind == PLX_NODE_ARRAY_TYPE) {
+    elements_ptr = plx_generate_llvm_ir_ptr(iterable, buffer, func);
+    start_var = plx_llvm_ir_constant(&zero, func);
+    end_var = plx_llvm_ir_constant(iterable->type->children, func);
+  } else {
+    const plx_llvm_local slice_var =
+        plx_generate_llvm_ir_expr(iterable, buffer, func);
+    start_var = plx_llvm_ir_constant(&zero, func);
+    end_var = func->locals++;
+    elements_ptr.local = func->locals++;
+    plx_llvm_ir_printf(buffer, func,
+                       "  %v = extractvalue %t %v, 0\n"
+                       "  %v = extractvalue %t %v, 1\n",
+                       end_var, iterable->type, slice_var, elements_ptr.local,
+                       iterable->type, slice_var);
+  }
+
+  const plx_llvm_local header_label = func->locals++;
+  const plx_llvm_local body_label = func->locals++;
+  const plx_llvm_local latch_label = func->locals++;
+  const plx_llvm_local exit_label = func->locals++;
+
+  // `continue` branches to the latch rather than to the header.
+  struct plx_llvm_ir_loop inner_loop = {latch_label, exit_label,
+                                        {0, 0, NULL}, {0, 0, NULL, NULL},
+                                        {0, 0, NULL, NULL}};
+  struct plx_llvm_ir_edges header_edges = {0, 0, NULL, NULL};
+
+  // The loop header is generated after the body, once all of the incoming
+  // edges are known, so the phi nodes are allocated up front.
+  plx_llvm_ir_vars_init(&inner_loop.vars, node);
+  plx_llvm_ir_edges_add(&header_edges, &inner_loop.vars, func);
+  plx_generate_llvm_ir_br(header_label, buffer, func);
+  const plx_llvm_local counter_var = func->locals++;
+  const plx_llvm_local phis_begin = func->locals;
+  for (size_t i = 0; i < inner_loop.vars.len; ++i) {
+    inner_loop.vars.entries[i]->llvm_local_var = func->locals++;
+  }
+
+  // Define the loop variable.
+  plx_generate_llvm_ir_label(body_label, buffer, func);
+  struct plx_symbol_table_entry* const entry = name->entry;
+  plx_llvm_local value_var = counter_var;
+  if (iterable->kind != PLX_NODE_RANGE) {
+    const plx_llvm_local element_ptr_var = func->locals++;
+    value_var = func->locals++;
+    if (iterable->type->kind == PLX_NODE_ARRAY_TYPE) {
+      plx_llvm_ir_printf(buffer, func,
+                         "  %v = getelementptr inbounds %t, ptr %p, "
+                         "i64 0, i64 %v\n",
+                         element_ptr_var, iterable->type, elements_ptr,
+                         counter_var);
+    } else {
+      plx_llvm_ir_printf(buffer, func,
+                         "  %v = getelementptr inbounds %t, ptr %p, "
+                         "i64 %v\n",
+                         element_ptr_var, entry->type, elements_ptr,
+                         counter_var);
+    }
+    plx_llvm_ir_printf(buffer, func, "  %v = load %t, ptr %v\n", value_var,
+                       entry->type, element_ptr_var);
+  }
+  if (plx_is_llvm_ir_ssa_var(entry)) {
+    entry->llvm_local_var = value_var;
+  } else {
+    plx_llvm_ir_printf(buffer, func, "  store %t %v, ptr %v\n", entry->type,
+                       value_var, entry->llvm_local_var);
+  }
+
+  // Generate the body and the latch. The induction variable cannot overflow,
+  // since it is less than the end.
+  plx_generate_llvm_ir_stmt(body, buffer, func, &inner_loop);
+  if (!func->terminated) {
+    plx_llvm_ir_edges_add(&inner_loop.header_edges, &inner_loop.vars, func);
+    plx_generate_llvm_ir_br(latch_label, buffer, func);
+  }
+  plx_generate_llvm_ir_join(latch_label, &inner_loop.vars,
+                            &inner_loop.header_edges, buffer, func);
+  plx_llvm_local next_var = 0;
+  if (!func->terminated) {
+    next_var = func->locals++;
+    plx_llvm_ir_printf(buffer, func, "  %v = add %s %t %v, 1\n", next_var,
+                       plx_is_sint_type(counter_type) ? "nsw" : "nuw",
+                       counter_type, counter_var);
+    plx_llvm_ir_edges_add(&header_edges, &inner_loop.vars, func);
+    plx_generate_llvm_ir_br(header_label, buffer, func);
+  }
+
+  // Generate the header.
+  plx_generate_llvm_ir_label(header_label, buffer, func);
+  plx_llvm_ir_printf(buffer, func, "  %v = phi %t [ %v, %%bb%u ]", counter_var,
+                     counter_type, start_var, header_edges.blocks[0]);
+  if (header_edges.len > 1) {
+    plx_llvm_ir_printf(buffer, func, ", [ %v, %%bb%u ]", next_var,
+                       header_edges.blocks[1]);
+  }
+  plx_buffer_append_char(buffer, '\n');
+  for (size_t i = 0; i < inner_loop.vars.len; ++i) {
+    plx_generate_llvm_ir_phi(phis_begin + i, &inner_loop.vars, i,
+                             &header_edges, buffer, func);
+    inner_loop.vars.entries[i]->llvm_local_var = phis_begin + i;
+  }
+  const plx_llvm_local cond_var = func->locals++;
+  plx_llvm_ir_printf(buffer, func,
+                     "  %v = icmp %s %t %v, %v\n"
+                     "  br i1 %v, label %%bb%u, label %%bb%u\n",
+                     cond_var, plx_is_sint_type(counter_type) ? "slt" : "ult",
+                     counter_type, counter_var, end_var, cond_var, body_label,
+                     exit_label);
+  func->terminated = true;
+  plx_llvm_ir_edges_add(&inner_loop.exit_edges, &inner_loop.vars, func);
+  plx_generate_llvm_ir_join(exit_label, &inner_loop.vars,
+                            &inner_loop.exit_edges, buffer, func);
+
+  plx_llvm_ir_edges_free(&header_edges);
+  plx_llvm_ir_edges_free(&inner_loop.header_edges);
+  plx_llvm_ir_edges_free(&inner_loop.exit_edges);
+  plx_llvm_ir_vars_free(&inner_loop.vars);
+}
+
+void plx_generate_llvm_ir_target(const char* const triple,
+                                 const char* const data_layout,
+                                 struct plx_buffer* const buffer) {
+  if (data_layout != NULL) {
+    plx_llvm_ir_printf(buffer, NULL, "target datalayout = \"%s\"\n",
+                       data_layout);
+  }
+  plx_llvm_ir_printf(buffer, NULL, "target triple = \"%s\"\n\n", triple);
+}
+
+// Returns whether a node contains a bounds check, which calls `llvm.trap`.
+static bool plx_has_llvm_ir_bounds_check(const struct plx_node* const node) {
+  if (node->kind == PLX_NODE_BOUNDS_CHECK) return true;
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    if (plx_has_llvm_ir_bounds_check(child)) return true;
+  }
+  return false;
+}
+
+// Generates the declarations of the intrinsics that a module calls.
+static void plx_generate_llvm_ir_intrinsics(const struct plx_node* const module,
+                                            struct plx_buffer* const buffer) {
+  if (plx_has_llvm_ir_bounds_check(module)) {
+    plx_buffer_append_str(buffer,
+                          "declare void @llvm.trap() cold noreturn nounwind\n");
+  }
 }
 
 void plx_generate_llvm_ir(const struct plx_node* const node,
-                          FILE* const stream) {
+                          const bool fast_math,
+                          struct plx_buffer* const buffer) {
   switch (node->kind) {
     case PLX_NODE_MODULE:
       for (const struct plx_node* def = node->children; def != NULL;
            def = def->next) {
-        plx_generate_llvm_ir(def, stream);
+        plx_generate_llvm_ir(def, fast_math, buffer);
       }
+      plx_generate_llvm_ir_intrinsics(node, buffer);
       break;
+    case PLX_NODE_CONST_DEF: {
+      const struct plx_node *name, *value;
+      plx_extract_children(node, &name, &value);
+      plx_llvm_ir_printf(buffer, NULL, "@%s = unnamed_addr constant %t %c\n",
+                         name->name, value->type, value);
+      break;
+    }
     case PLX_NODE_VAR_DEF: {
       const struct plx_node *name, *value;
       plx_extract_children(node, &name, &value);
-      plx_llvm_ir_fprintf(stream, "@%s = global %t %c\n", name->name,
-                          value->type, value);
+      plx_llvm_ir_printf(buffer, NULL, "@%s = global %t %c\n", name->name,
+                         value->type, value);
       break;
     }
     case PLX_NODE_VAR_DECL: {
       const struct plx_node *name, *type;
       plx_extract_children(node, &name, &type);
-      plx_llvm_ir_fprintf(stream, "@%s = global %t\n", name->name, type);
+      plx_llvm_ir_printf(buffer, NULL, "@%s = global %t zeroinitializer\n",
+                         name->name, type);
       break;
     }
     case PLX_NODE_STRUCT_DEF: {
       const struct plx_node *name, *members;
       plx_extract_children(node, &name, &members);
-      fprintf(stream, "%%%s = type { ", name->name);
+      plx_llvm_ir_printf(buffer, NULL, "%%%s = type { ", name->name);
       for (const struct plx_node* member = members->children; member != NULL;
            member = member->next) {
         const struct plx_node *member_name, *member_type;
         plx_extract_children(member, &member_name, &member_type);
-        plx_generate_llvm_ir_type(member_type, stream);
-        if (member->next != NULL) fputs(", ", stream);
+        plx_generate_llvm_ir_type(member_type, buffer);
+        if (member->next != NULL) plx_buffer_append_str(buffer, ", ");
       }
-      fputs(" }\n\n", stream);
+      plx_buffer_append_str(buffer, " }\n\n");
       break;
     }
     case PLX_NODE_FUNC_DEF: {
       const struct plx_node *name, *params, *return_type, *body;
       plx_extract_children(node, &name, &params, &return_type, &body);
 
-      plx_llvm_ir_fprintf(stream, "define %t @%s(", return_type, name->name);
-      plx_llvm_unnamed_identifier locals = 0;
+      plx_llvm_ir_printf(buffer, NULL, "define %t @%s(", return_type,
+                         name->name);
+      struct plx_llvm_ir_func func = {
+          0, 0, false, fast_math ? " fast" : "", 0, 0, NULL};
       for (const struct plx_node* param = params->children; param != NULL;
            param = param->next) {
         const struct plx_node *param_name, *param_type;
         plx_extract_children(param, &param_name, &param_type);
-        plx_llvm_ir_fprintf(stream, "%t %%%u", param_type, locals++);
-        if (param->next != NULL) fputs(", ", stream);
+        plx_llvm_ir_printf(buffer, &func, "%t %v", param_type, func.locals++);
+        if (param->next != NULL) plx_buffer_append_str(buffer, ", ");
       }
-      fputs(") {\n", stream);
-      ++locals;  // Implicit numbered label.
+      plx_buffer_append_char(buffer, ')');
+      if (node->inline_hint == PLX_INLINE_HINT_ALWAYS) {
+        plx_buffer_append_str(buffer, " alwaysinline");
+      } else if (node->inline_hint == PLX_INLINE_HINT_NEVER) {
+        plx_buffer_append_str(buffer, " noinline");
+      }
+      plx_buffer_append_str(buffer, " {\n");
+      plx_generate_llvm_ir_label(func.locals++, buffer, &func);
 
-      plx_llvm_unnamed_identifier param_var = 0;
+      // Parameters that are not kept in SSA form are spilled to the stack.
+      plx_llvm_local param_var = 0;
       for (const struct plx_node* param = params->children; param != NULL;
-           param = param->next) {
+           param = param->next, ++param_var) {
         const struct plx_node *param_name, *param_type;
         plx_extract_children(param, &param_name, &param_type);
-        plx_llvm_ir_fprintf(stream,
-                            "  %%%u = alloca %t\n"
-                            "  store %t %%%u, ptr %%%u\n",
-                            locals, param_type, param_type, param_var++,
-                            locals);
-        param_name->entry->llvm_local_var = locals++;
-      }
-      plx_generate_llvm_ir_stmt(body, stream, &locals,
-                                /*loop_enter_label=*/0,
-                                /*loop_exit_label=*/0);
-      fputs("}\n\n", stream);
+        if (plx_is_llvm_ir_ssa_var(param_name->entry)) {
+          param_name->entry->llvm_local_var = param_var;
+          continue;
+        }
+        plx_llvm_ir_printf(buffer, &func,
+                           "  %v = alloca %t\n"
+                           "  store %t %v, ptr %v\n",
+                           func.locals, param_type, param_type, param_var,
+                           func.locals);
+        param_name->entry->llvm_local_var = func.locals++;
+      }
+      plx_generate_llvm_ir_allocas(body, buffer, &func);
+
+      plx_generate_llvm_ir_stmt(body, buffer, &func, /*loop=*/NULL);
+      if (!func.terminated) {
+        plx_buffer_append_str(buffer, return_type->kind == PLX_NODE_VOID_TYPE
+                                          ? "  ret void\n"
+                                          : "  unreachable\n");
+      }
+      plx_buffer_append_str(buffer, "}\n\n");
+      free(func.constants);
       break;
     }
     case PLX_NODE_NOP:
@@ -263,31 +1115,166 @@ void plx_generate_llvm_ir(const struct plx_node* const node,
   }
 }
 
+// Returns the number of nodes in a subtree, which estimates how long it takes
+// to compile.
+static size_t plx_llvm_ir_size(const struct plx_node* const node) {
+  size_t size = 1;
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    size += plx_llvm_ir_size(child);
+  }
+  return size;
+}
+
+unsigned int plx_partition_llvm_ir(const struct plx_node* const module,
+                                   const unsigned int unit_count) {
+  // Define globals in the first unit.
+  for (const struct plx_node* def = module->children; def != NULL;
+       def = def->next) {
+    switch (def->kind) {
+      case PLX_NODE_CONST_DEF:
+      case PLX_NODE_VAR_DEF:
+      case PLX_NODE_VAR_DECL:
+        def->children->entry->llvm_unit = 0;
+        break;
+      default:
+        break;
+    }
+  }
+  struct plx_call_graph graph;
+  plx_build_call_graph(module, &graph);
+  if (graph.func_count == 0) {
+    plx_call_graph_free(&graph);
+    return 1;
+  }
+
+  size_t* const sizes = malloc(graph.func_count * sizeof(*sizes));
+  if (plx_unlikely(sizes == NULL)) plx_oom();
+  size_t total_size = 0;
+  for (size_t func = 0; func < graph.func_count; ++func) {
+    sizes[func] = plx_llvm_ir_size(graph.funcs[func]);
+    total_size += sizes[func];
+  }
+
+  // SCCs are assigned in top-down order of the call graph, so that callers and
+  // callees tend to share a unit and can be inlined, and functions that call
+  // each other are never split. A unit is full once it holds its share of the
+  // module.
+  const size_t unit_size = total_size / unit_count + 1;
+  unsigned int unit = 0;
+  size_t size = 0;
+  for (size_t scc = graph.scc_count; scc-- > 0;) {
+    if (size >= unit_size && unit + 1 < unit_count) {
+      ++unit;
+      size = 0;
+    }
+    for (size_t i = graph.scc_begins[scc]; i < graph.scc_begins[scc + 1];
+         ++i) {
+      const size_t func = graph.scc_funcs[i];
+      graph.funcs[func]->children->entry->llvm_unit = unit;
+      size += sizes[func];
+    }
+  }
+  free(sizes);
+  plx_call_graph_free(&graph);
+  return unit + 1;
+}
+
+// Generates a declaration of a global that is defined in another codegen unit.
+static void plx_generate_llvm_ir_extern(const struct plx_node* const node,
+                                        struct plx_buffer* const buffer) {
+  switch (node->kind) {
+    case PLX_NODE_CONST_DEF: {
+      const struct plx_node *name, *value;
+      plx_extract_children(node, &name, &value);
+      plx_llvm_ir_printf(buffer, NULL,
+                         "@%s = external unnamed_addr constant %t\n",
+                         name->name, value->type);
+      break;
+    }
+    case PLX_NODE_VAR_DEF: {
+      const struct plx_node *name, *value;
+      plx_extract_children(node, &name, &value);
+      plx_llvm_ir_printf(buffer, NULL, "@%s = external global %t\n", name->name,
+                         value->type);
+      break;
+    }
+    case PLX_NODE_VAR_DECL: {
+      const struct plx_node *name, *type;
+      plx_extract_children(node, &name, &type);
+      plx_llvm_ir_printf(buffer, NULL, "@%s = external global %t\n", name->name,
+                         type);
+      break;
+    }
+    case PLX_NODE_FUNC_DEF: {
+      const struct plx_node *name, *params, *return_type, *body;
+      plx_extract_children(node, &name, &params, &return_type, &body);
+      plx_llvm_ir_printf(buffer, NULL, "declare %t @%s(", return_type,
+                         name->name);
+      for (const struct plx_node* param = params->children; param != NULL;
+           param = param->next) {
+        const struct plx_node *param_name, *param_type;
+        plx_extract_children(param, &param_name, &param_type);
+        plx_generate_llvm_ir_type(param_type, buffer);
+        if (param->next != NULL) plx_buffer_append_str(buffer, ", ");
+      }
+      plx_buffer_append_str(buffer, ")\n\n");
+      break;
+    }
+    default:
+      assert(false);
+  }
+}
+
+void plx_generate_llvm_ir_unit(const struct plx_node* const module,
+                               const unsigned int unit, const bool fast_math,
+                               struct plx_buffer* const buffer) {
+  for (const struct plx_node* def = module->children; def != NULL;
+       def = def->next) {
+    switch (def->kind) {
+      case PLX_NODE_CONST_DEF:
+      case PLX_NODE_VAR_DEF:
+      case PLX_NODE_VAR_DECL:
+      case PLX_NODE_FUNC_DEF:
+        if (def->children->entry->llvm_unit != unit) {
+          plx_generate_llvm_ir_extern(def, buffer);
+          continue;
+        }
+        break;
+      default:
+        break;
+    }
+    plx_generate_llvm_ir(def, fast_math, buffer);
+  }
+  plx_generate_llvm_ir_intrinsics(module, buffer);
+}
+
 void plx_generate_llvm_ir_stmt(const struct plx_node* const node,
-                               FILE* const stream,
-                               plx_llvm_unnamed_identifier* const locals,
-                               plx_llvm_unnamed_identifier loop_enter_label,
-                               plx_llvm_unnamed_identifier loop_exit_label) {
+                               struct plx_buffer* const buffer,
+                               struct plx_llvm_ir_func* const func,
+                               struct plx_llvm_ir_loop* const loop) {
   switch (node->kind) {
+    case PLX_NODE_CONST_DEF:
     case PLX_NODE_VAR_DEF: {
       const struct plx_node *name, *value;
       plx_extract_children(node, &name, &value);
-      const plx_llvm_unnamed_identifier value_var =
-          plx_generate_llvm_ir_expr(value, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      plx_llvm_ir_fprintf(stream,
-                          "  %%%u = alloca %t\n"
-                          "  store %t %%%u, ptr %%%u\n",
-                          result_var, value->type, value->type, result_var,
-                          value_var);
-      name->entry->llvm_local_var = result_var;
+      const plx_llvm_local value_var =
+          plx_generate_llvm_ir_expr(value, buffer, func);
+      if (plx_is_llvm_ir_ssa_var(name->entry)) {
+        name->entry->llvm_local_var = value_var;
+        break;
+      }
+      plx_llvm_ir_printf(buffer, func, "  store %t %v, ptr %v\n", value->type,
+                         value_var, name->entry->llvm_local_var);
       break;
     }
     case PLX_NODE_VAR_DECL: {
       const struct plx_node *name, *type;
       plx_extract_children(node, &name, &type);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      plx_llvm_ir_fprintf(stream, "  %%%u = alloca %t\n", result_var, type);
+      if (!plx_is_llvm_ir_ssa_var(name->entry)) break;
+      const plx_llvm_local result_var = func->locals++;
+      plx_llvm_ir_printf(buffer, func, "  %v = freeze %t poison\n", result_var,
+                         type);
       name->entry->llvm_local_var = result_var;
       break;
     }
@@ -296,652 +1283,288 @@ void plx_generate_llvm_ir_stmt(const struct plx_node* const node,
     case PLX_NODE_BLOCK:
       for (const struct plx_node* stmt = node->children; stmt != NULL;
            stmt = stmt->next) {
-        plx_generate_llvm_ir_stmt(stmt, stream, locals, loop_enter_label,
-                                  loop_exit_label);
+        // Skip unreachable statements.
+        if (func->terminated) break;
+        plx_generate_llvm_ir_stmt(stmt, buffer, func, loop);
       }
       break;
     case PLX_NODE_IF_THEN_ELSE: {
       const struct plx_node *cond, *then, *els;
       plx_extract_children(node, &cond, &then, &els);
-      const plx_llvm_unnamed_identifier cond_var =
-          plx_generate_llvm_ir_expr(cond, stream, locals);
-      const plx_llvm_unnamed_identifier then_label = (*locals)++;
-      const plx_llvm_unnamed_identifier else_label = (*locals)++;
-      const plx_llvm_unnamed_identifier end_label = (*locals)++;
-      fprintf(stream,
-              "  br i1 %%%u, label %%%u, label %%%u\n"
-              "%u:\n",
-              cond_var, then_label, else_label, then_label);
-      plx_generate_llvm_ir_stmt(then, stream, locals, loop_enter_label,
-                                loop_exit_label);
-      fprintf(stream,
-              "  br label %%%u\n"
-              "%u:\n",
-              end_label, else_label);
-      plx_generate_llvm_ir_stmt(els, stream, locals, loop_enter_label,
-                                loop_exit_label);
-      fprintf(stream,
-              "  br label %%%u\n"
-              "%u:\n",
-              end_label, end_label);
-      break;
-    }
-    case PLX_NODE_LOOP: {
-      const struct plx_node* body;
-      plx_extract_children(node, &body);
-      loop_enter_label = (*locals)++;
-      loop_exit_label = (*locals)++;
-      fprintf(stream, "%u:\n", loop_enter_label);
-      plx_generate_llvm_ir_stmt(body, stream, locals, loop_enter_label,
-                                loop_exit_label);
-      fprintf(stream, "%u:\n", loop_exit_label);
+      const plx_llvm_local cond_var =
+          plx_generate_llvm_ir_expr(cond, buffer, func);
+      const plx_llvm_local then_label = func->locals++;
+      const plx_llvm_local else_label = func->locals++;
+      const plx_llvm_local end_label = func->locals++;
+      plx_llvm_ir_printf(buffer, func,
+                         "  br i1 %v, label %%bb%u, label %%bb%u\n", cond_var,
+                         then_label, else_label);
+
+      // Both branches start with the values from before the if statement.
+      struct plx_llvm_ir_vars vars;
+      plx_llvm_ir_vars_init(&vars, node);
+      plx_llvm_local* const values = malloc(vars.len * sizeof(plx_llvm_local));
+      if (plx_unlikely(values == NULL && vars.len > 0)) plx_oom();
+      for (size_t i = 0; i < vars.len; ++i) {
+        values[i] = vars.entries[i]->llvm_local_var;
+      }
+
+      struct plx_llvm_ir_edges edges = {0, 0, NULL, NULL};
+      plx_generate_llvm_ir_label(then_label, buffer, func);
+      plx_generate_llvm_ir_stmt(then, buffer, func, loop);
+      if (!func->terminated) {
+        plx_llvm_ir_edges_add(&edges, &vars, func);
+        plx_generate_llvm_ir_br(end_label, buffer, func);
+      }
+      for (size_t i = 0; i < vars.len; ++i) {
+        vars.entries[i]->llvm_local_var = values[i];
+      }
+      plx_generate_llvm_ir_label(else_label, buffer, func);
+      plx_generate_llvm_ir_stmt(els, buffer, func, loop);
+      if (!func->terminated) {
+        plx_llvm_ir_edges_add(&edges, &vars, func);
+        plx_generate_llvm_ir_br(end_label, buffer, func);
+      }
+      plx_generate_llvm_ir_join(end_label, &vars, &edges, buffer, func);
+
+      plx_llvm_ir_edges_free(&edges);
+      free(values);
+      plx_llvm_ir_vars_free(&vars);
       break;
     }
+    case PLX_NODE_LOOP:
     case PLX_NODE_WHILE_LOOP: {
-      const struct plx_node *cond, *body;
-      plx_extract_children(node, &cond, &body);
-      loop_enter_label = (*locals)++;
-      const plx_llvm_unnamed_identifier loop_mid_label = (*locals)++;
-      loop_exit_label = (*locals)++;
-      fprintf(stream, "%u:\n", loop_enter_label);
-      const plx_llvm_unnamed_identifier cond_var =
-          plx_generate_llvm_ir_expr(cond, stream, locals);
-      fprintf(stream,
-              "  br i1 %%%u, label %%%u, label %%%u\n"
-              "%u:\n",
-              cond_var, loop_mid_label, loop_exit_label, loop_mid_label);
-      plx_generate_llvm_ir_stmt(body, stream, locals, loop_enter_label,
-                                loop_exit_label);
-      fprintf(stream, "%u:\n", loop_exit_label);
+      const struct plx_node *cond = NULL, *body;
+      if (node->kind == PLX_NODE_LOOP) {
+        plx_extract_children(node, &body);
+      } else {
+        plx_extract_children(node, &cond, &body);
+      }
+      const plx_llvm_local header_label = func->locals++;
+      const plx_llvm_local body_label = func->locals++;
+      const plx_llvm_local exit_label = func->locals++;
+      struct plx_llvm_ir_loop inner_loop = {header_label, exit_label,
+                                            {0, 0, NULL}, {0, 0, NULL, NULL},
+                                            {0, 0, NULL, NULL}};
+
+      // The loop header is generated after the body, once all of the incoming
+      // edges are known, so the phi nodes are allocated up front.
+      plx_llvm_ir_vars_init(&inner_loop.vars, node);
+      plx_llvm_ir_edges_add(&inner_loop.header_edges, &inner_loop.vars, func);
+      plx_generate_llvm_ir_br(header_label, buffer, func);
+      const plx_llvm_local phis_begin = func->locals;
+      for (size_t i = 0; i < inner_loop.vars.len; ++i) {
+        inner_loop.vars.entries[i]->llvm_local_var = func->locals++;
+      }
+
+      plx_generate_llvm_ir_label(body_label, buffer, func);
+      plx_generate_llvm_ir_stmt(body, buffer, func, &inner_loop);
+      if (!func->terminated) {
+        plx_llvm_ir_edges_add(&inner_loop.header_edges, &inner_loop.vars,
+                              func);
+        plx_generate_llvm_ir_br(header_label, buffer, func);
+      }
+
+      plx_generate_llvm_ir_label(header_label, buffer, func);
+      for (size_t i = 0; i < inner_loop.vars.len; ++i) {
+        plx_generate_llvm_ir_phi(phis_begin + i, &inner_loop.vars, i,
+                                 &inner_loop.header_edges, buffer, func);
+        inner_loop.vars.entries[i]->llvm_local_var = phis_begin + i;
+      }
+      if (cond == NULL) {
+        plx_generate_llvm_ir_br(body_label, buffer, func);
+      } else {
+        const plx_llvm_local cond_var =
+            plx_generate_llvm_ir_expr(cond, buffer, func);
+        plx_llvm_ir_edges_add(&inner_loop.exit_edges, &inner_loop.vars, func);
+        plx_llvm_ir_printf(buffer, func,
+                           "  br i1 %v, label %%bb%u, label %%bb%u\n",
+                           cond_var, body_label, exit_label);
+        func->terminated = true;
+      }
+      plx_generate_llvm_ir_join(exit_label, &inner_loop.vars,
+                                &inner_loop.exit_edges, buffer, func);
+
+      plx_llvm_ir_edges_free(&inner_loop.header_edges);
+      plx_llvm_ir_edges_free(&inner_loop.exit_edges);
+      plx_llvm_ir_vars_free(&inner_loop.vars);
       break;
     }
+    case PLX_NODE_FOR_LOOP:
+      plx_generate_llvm_ir_for_loop(node, buffer, func);
+      break;
     case PLX_NODE_CONTINUE:
-      fprintf(stream, "  br label %%%u\n", loop_enter_label);
+      plx_llvm_ir_edges_add(&loop->header_edges, &loop->vars, func);
+      plx_generate_llvm_ir_br(loop->header_label, buffer, func);
       break;
     case PLX_NODE_BREAK:
-      fprintf(stream, "  br label %%%u\n", loop_exit_label);
+      plx_llvm_ir_edges_add(&loop->exit_edges, &loop->vars, func);
+      plx_generate_llvm_ir_br(loop->exit_label, buffer, func);
       break;
     case PLX_NODE_RETURN: {
       const struct plx_node* const return_value = node->children;
       if (return_value == NULL) {
-        fputs("  ret void\n", stream);
+        plx_buffer_append_str(buffer, "  ret void\n");
+        func->terminated = true;
         break;
       }
-      const plx_llvm_unnamed_identifier return_value_var =
-          plx_generate_llvm_ir_expr(return_value, stream, locals);
-      plx_llvm_ir_fprintf(stream, "  ret %t %%%u\n", return_value->type,
-                          return_value_var);
+      const plx_llvm_local return_value_var =
+          plx_generate_llvm_ir_expr(return_value, buffer, func);
+      plx_llvm_ir_printf(buffer, func, "  ret %t %v\n", return_value->type,
+                         return_value_var);
+      func->terminated = true;
       break;
     }
     case PLX_NODE_ASSIGN: {
       const struct plx_node *assignee, *value;
       plx_extract_children(node, &assignee, &value);
-      const plx_llvm_unnamed_identifier assignee_var =
-          plx_generate_llvm_ir_ptr(assignee, stream, locals);
-      const plx_llvm_unnamed_identifier value_var =
-          plx_generate_llvm_ir_expr(value, stream, locals);
-      plx_llvm_ir_fprintf(stream, "  store %t %%%u, ptr %%%u\n", value->type,
-                          value_var, assignee_var);
-      break;
-    }
-    case PLX_NODE_ADD_ASSIGN: {
-      const struct plx_node *assignee, *value;
-      plx_extract_children(node, &assignee, &value);
-      const plx_llvm_unnamed_identifier assignee_var =
-          plx_generate_llvm_ir_ptr(assignee, stream, locals);
-      const plx_llvm_unnamed_identifier left_var = (*locals)++;
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(value, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      assert(assignee->type->kind == value->type->kind);
-      switch (assignee->type->kind) {
-        case PLX_NODE_S8_TYPE:
-        case PLX_NODE_U8_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i8, ptr %%%u\n"
-                  "  %%%u = add i8 %%%u, %%%u\n"
-                  "  store i8 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S16_TYPE:
-        case PLX_NODE_U16_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i16, ptr %%%u\n"
-                  "  %%%u = add i16 %%%u, %%%u\n"
-                  "  store i16 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S32_TYPE:
-        case PLX_NODE_U32_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i32, ptr %%%u\n"
-                  "  %%%u = add i32 %%%u, %%%u\n"
-                  "  store i32 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S64_TYPE:
-        case PLX_NODE_U64_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i64, ptr %%%u\n"
-                  "  %%%u = add i64 %%%u, %%%u\n"
-                  "  store i64 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_F16_TYPE:
-          fprintf(stream,
-                  "  %%%u = load half, ptr %%%u\n"
-                  "  %%%u = fadd fast half %%%u, %%%u\n"
-                  "  store half %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_F32_TYPE:
-          fprintf(stream,
-                  "  %%%u = load float, ptr %%%u\n"
-                  "  %%%u = fadd fast float %%%u, %%%u\n"
-                  "  store float %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_F64_TYPE:
-          fprintf(stream,
-                  "  %%%u = load double, ptr %%%u\n"
-                  "  %%%u = fadd fast double %%%u, %%%u\n"
-                  "  store double %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        default:
-          assert(false);
-      }
-      break;
-    }
-    case PLX_NODE_SUB_ASSIGN: {
-      const struct plx_node *assignee, *value;
-      plx_extract_children(node, &assignee, &value);
-      const plx_llvm_unnamed_identifier assignee_var =
-          plx_generate_llvm_ir_ptr(assignee, stream, locals);
-      const plx_llvm_unnamed_identifier left_var = (*locals)++;
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(value, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      assert(assignee->type->kind == value->type->kind);
-      switch (assignee->type->kind) {
-        case PLX_NODE_S8_TYPE:
-        case PLX_NODE_U8_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i8, ptr %%%u\n"
-                  "  %%%u = sub i8 %%%u, %%%u\n"
-                  "  store i8 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S16_TYPE:
-        case PLX_NODE_U16_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i16, ptr %%%u\n"
-                  "  %%%u = sub i16 %%%u, %%%u\n"
-                  "  store i16 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S32_TYPE:
-        case PLX_NODE_U32_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i32, ptr %%%u\n"
-                  "  %%%u = sub i32 %%%u, %%%u\n"
-                  "  store i32 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S64_TYPE:
-        case PLX_NODE_U64_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i64, ptr %%%u\n"
-                  "  %%%u = sub i64 %%%u, %%%u\n"
-                  "  store i64 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_F16_TYPE:
-          fprintf(stream,
-                  "  %%%u = load half, ptr %%%u\n"
-                  "  %%%u = fsub fast half %%%u, %%%u\n"
-                  "  store half %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_F32_TYPE:
-          fprintf(stream,
-                  "  %%%u = load float, ptr %%%u\n"
-                  "  %%%u = fsub fast float %%%u, %%%u\n"
-                  "  store float %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_F64_TYPE:
-          fprintf(stream,
-                  "  %%%u = load double, ptr %%%u\n"
-                  "  %%%u = fsub fast double %%%u, %%%u\n"
-                  "  store double %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        default:
-          assert(false);
+      if (assignee->kind == PLX_NODE_IDENTIFIER &&
+          plx_is_llvm_ir_ssa_var(assignee->entry)) {
+        assignee->entry->llvm_local_var =
+            plx_generate_llvm_ir_expr(value, buffer, func);
+        break;
       }
-      break;
-    }
-    case PLX_NODE_MUL_ASSIGN: {
-      const struct plx_node *assignee, *value;
-      plx_extract_children(node, &assignee, &value);
-      const plx_llvm_unnamed_identifier assignee_var =
-          plx_generate_llvm_ir_ptr(assignee, stream, locals);
-      const plx_llvm_unnamed_identifier left_var = (*locals)++;
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(value, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      assert(assignee->type->kind == value->type->kind);
-      switch (assignee->type->kind) {
-        case PLX_NODE_S8_TYPE:
-        case PLX_NODE_U8_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i8, ptr %%%u\n"
-                  "  %%%u = mul i8 %%%u, %%%u\n"
-                  "  store i8 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S16_TYPE:
-        case PLX_NODE_U16_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i16, ptr %%%u\n"
-                  "  %%%u = mul i16 %%%u, %%%u\n"
-                  "  store i16 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S32_TYPE:
-        case PLX_NODE_U32_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i32, ptr %%%u\n"
-                  "  %%%u = mul i32 %%%u, %%%u\n"
-                  "  store i32 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S64_TYPE:
-        case PLX_NODE_U64_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i64, ptr %%%u\n"
-                  "  %%%u = mul i64 %%%u, %%%u\n"
-                  "  store i64 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_F16_TYPE:
-          fprintf(stream,
-                  "  %%%u = load half, ptr %%%u\n"
-                  "  %%%u = fmul fast half %%%u, %%%u\n"
-                  "  store half %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_F32_TYPE:
-          fprintf(stream,
-                  "  %%%u = load float, ptr %%%u\n"
-                  "  %%%u = fmul fast float %%%u, %%%u\n"
-                  "  store float %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_F64_TYPE:
-          fprintf(stream,
-                  "  %%%u = load double, ptr %%%u\n"
-                  "  %%%u = fmul fast double %%%u, %%%u\n"
-                  "  store double %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        default:
-          assert(false);
+      if (plx_is_llvm_ir_lane(assignee)) {
+        const struct plx_llvm_ir_lane lane =
+            plx_generate_llvm_ir_lane(assignee, buffer, func);
+        const plx_llvm_local value_var =
+            plx_generate_llvm_ir_expr(value, buffer, func);
+        const plx_llvm_local vec_var = func->locals++;
+        const plx_llvm_local result_var = func->locals++;
+        plx_llvm_ir_printf(buffer, func,
+                           "  %v = load %t, ptr %p\n"
+                           "  %v = insertelement %t %v, %t %v, "
+                           "%t %v\n"
+                           "  store %t %v, ptr %p\n",
+                           vec_var, lane.vec_type, lane.vec_ptr, result_var,
+                           lane.vec_type, vec_var, value->type, value_var,
+                           lane.index_type, lane.index, lane.vec_type,
+                           result_var, lane.vec_ptr);
+        break;
       }
+      const struct plx_llvm_ir_ptr assignee_ptr =
+          plx_generate_llvm_ir_ptr(assignee, buffer, func);
+      const plx_llvm_local value_var =
+          plx_generate_llvm_ir_expr(value, buffer, func);
+      plx_llvm_ir_printf(buffer, func, "  store %t %v, ptr %p\n", value->type,
+                         value_var, assignee_ptr);
       break;
     }
-    case PLX_NODE_DIV_ASSIGN: {
+    case PLX_NODE_ADD_ASSIGN:
+    case PLX_NODE_SUB_ASSIGN:
+    case PLX_NODE_MUL_ASSIGN:
+    case PLX_NODE_DIV_ASSIGN:
+    case PLX_NODE_REM_ASSIGN:
+    case PLX_NODE_LSHIFT_ASSIGN:
+    case PLX_NODE_RSHIFT_ASSIGN: {
       const struct plx_node *assignee, *value;
       plx_extract_children(node, &assignee, &value);
-      const plx_llvm_unnamed_identifier assignee_var =
-          plx_generate_llvm_ir_ptr(assignee, stream, locals);
-      const plx_llvm_unnamed_identifier left_var = (*locals)++;
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(value, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
       assert(assignee->type->kind == value->type->kind);
-      switch (assignee->type->kind) {
-        case PLX_NODE_S8_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i8, ptr %%%u\n"
-                  "  %%%u = sdiv i8 %%%u, %%%u\n"
-                  "  store i8 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S16_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i16, ptr %%%u\n"
-                  "  %%%u = sdiv i16 %%%u, %%%u\n"
-                  "  store i16 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S32_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i32, ptr %%%u\n"
-                  "  %%%u = sdiv i32 %%%u, %%%u\n"
-                  "  store i32 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S64_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i64, ptr %%%u\n"
-                  "  %%%u = sdiv i64 %%%u, %%%u\n"
-                  "  store i64 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_U8_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i8, ptr %%%u\n"
-                  "  %%%u = udiv i8 %%%u, %%%u\n"
-                  "  store i8 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_U16_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i16, ptr %%%u\n"
-                  "  %%%u = udiv i16 %%%u, %%%u\n"
-                  "  store i16 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_U32_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i32, ptr %%%u\n"
-                  "  %%%u = udiv i32 %%%u, %%%u\n"
-                  "  store i32 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_U64_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i64, ptr %%%u\n"
-                  "  %%%u = udiv i64 %%%u, %%%u\n"
-                  "  store i64 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_F16_TYPE:
-          fprintf(stream,
-                  "  %%%u = load half, ptr %%%u\n"
-                  "  %%%u = fdiv fast half %%%u, %%%u\n"
-                  "  store half %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_F32_TYPE:
-          fprintf(stream,
-                  "  %%%u = load float, ptr %%%u\n"
-                  "  %%%u = fdiv fast float %%%u, %%%u\n"
-                  "  store float %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_F64_TYPE:
-          fprintf(stream,
-                  "  %%%u = load double, ptr %%%u\n"
-                  "  %%%u = fdiv fast double %%%u, %%%u\n"
-                  "  store double %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        default:
-          assert(false);
+      const bool ssa = assignee->kind == PLX_NODE_IDENTIFIER &&
+                       plx_is_llvm_ir_ssa_var(assignee->entry);
+      if (plx_is_llvm_ir_lane(assignee)) {
+        const struct plx_llvm_ir_lane lane =
+            plx_generate_llvm_ir_lane(assignee, buffer, func);
+        const plx_llvm_local vec_var = func->locals++;
+        const plx_llvm_local left_var = func->locals++;
+        plx_llvm_ir_printf(buffer, func,
+                           "  %v = load %t, ptr %p\n"
+                           "  %v = extractelement %t %v, %t %v\n",
+                           vec_var, lane.vec_type, lane.vec_ptr, left_var,
+                           lane.vec_type, vec_var, lane.index_type,
+                           lane.index);
+        const plx_llvm_local right_var =
+            plx_generate_llvm_ir_expr(value, buffer, func);
+        const plx_llvm_local lane_var = func->locals++;
+        const plx_llvm_local result_var = func->locals++;
+        plx_llvm_ir_printf(
+            buffer, func,
+            "  %v = %s%s %t %v, %v\n"
+            "  %v = insertelement %t %v, %t %v, %t %v\n"
+            "  store %t %v, ptr %p\n",
+            lane_var, plx_llvm_ir_assign_instruction(node),
+            plx_is_float_type(assignee->type) ? func->fast_math_flags : "",
+            assignee->type, left_var, right_var, result_var, lane.vec_type,
+            vec_var, assignee->type, lane_var, lane.index_type, lane.index,
+            lane.vec_type, result_var, lane.vec_ptr);
+        break;
       }
-      break;
-    }
-    case PLX_NODE_REM_ASSIGN: {
-      const struct plx_node *assignee, *value;
-      plx_extract_children(node, &assignee, &value);
-      const plx_llvm_unnamed_identifier assignee_var =
-          plx_generate_llvm_ir_ptr(assignee, stream, locals);
-      const plx_llvm_unnamed_identifier left_var = (*locals)++;
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(value, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      assert(assignee->type->kind == value->type->kind);
-      switch (assignee->type->kind) {
-        case PLX_NODE_S8_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i8, ptr %%%u\n"
-                  "  %%%u = srem i8 %%%u, %%%u\n"
-                  "  store i8 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S16_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i16, ptr %%%u\n"
-                  "  %%%u = srem i16 %%%u, %%%u\n"
-                  "  store i16 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S32_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i32, ptr %%%u\n"
-                  "  %%%u = srem i32 %%%u, %%%u\n"
-                  "  store i32 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S64_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i64, ptr %%%u\n"
-                  "  %%%u = srem i64 %%%u, %%%u\n"
-                  "  store i64 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_U8_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i8, ptr %%%u\n"
-                  "  %%%u = urem i8 %%%u, %%%u\n"
-                  "  store i8 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_U16_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i16, ptr %%%u\n"
-                  "  %%%u = urem i16 %%%u, %%%u\n"
-                  "  store i16 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_U32_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i32, ptr %%%u\n"
-                  "  %%%u = urem i32 %%%u, %%%u\n"
-                  "  store i32 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_U64_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i64, ptr %%%u\n"
-                  "  %%%u = urem i64 %%%u, %%%u\n"
-                  "  store i64 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        default:
-          assert(false);
+      struct plx_llvm_ir_ptr assignee_ptr = {NULL, 0};
+      plx_llvm_local left_var;
+      if (ssa) {
+        left_var = assignee->entry->llvm_local_var;
+      } else {
+        assignee_ptr = plx_generate_llvm_ir_ptr(assignee, buffer, func);
+        left_var = func->locals++;
+        plx_llvm_ir_printf(buffer, func, "  %v = load %t, ptr %p\n", left_var,
+                           assignee->type, assignee_ptr);
       }
-      break;
-    }
-    case PLX_NODE_LSHIFT_ASSIGN: {
-      const struct plx_node *assignee, *value;
-      plx_extract_children(node, &assignee, &value);
-      const plx_llvm_unnamed_identifier assignee_var =
-          plx_generate_llvm_ir_ptr(assignee, stream, locals);
-      const plx_llvm_unnamed_identifier left_var = (*locals)++;
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(value, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      assert(assignee->type->kind == value->type->kind);
-      switch (assignee->type->kind) {
-        case PLX_NODE_S8_TYPE:
-        case PLX_NODE_U8_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i8, ptr %%%u\n"
-                  "  %%%u = shl i8 %%%u, %%%u\n"
-                  "  store i8 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S16_TYPE:
-        case PLX_NODE_U16_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i16, ptr %%%u\n"
-                  "  %%%u = shl i16 %%%u, %%%u\n"
-                  "  store i16 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S32_TYPE:
-        case PLX_NODE_U32_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i32, ptr %%%u\n"
-                  "  %%%u = shl i32 %%%u, %%%u\n"
-                  "  store i32 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S64_TYPE:
-        case PLX_NODE_U64_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i64, ptr %%%u\n"
-                  "  %%%u = shl i64 %%%u, %%%u\n"
-                  "  store i64 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        default:
-          assert(false);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(value, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
+      plx_llvm_ir_printf(
+          buffer, func, "  %v = %s%s %t %v, %v\n", result_var,
+          plx_llvm_ir_assign_instruction(node),
+          plx_is_float_type(plx_lane_type(assignee->type))
+              ? func->fast_math_flags
+              : "",
+          assignee->type, left_var, right_var);
+      if (ssa) {
+        assignee->entry->llvm_local_var = result_var;
+      } else {
+        plx_llvm_ir_printf(buffer, func, "  store %t %v, ptr %p\n",
+                           assignee->type, result_var, assignee_ptr);
       }
       break;
     }
-    case PLX_NODE_RSHIFT_ASSIGN: {
-      const struct plx_node *assignee, *value;
-      plx_extract_children(node, &assignee, &value);
-      const plx_llvm_unnamed_identifier assignee_var =
-          plx_generate_llvm_ir_ptr(assignee, stream, locals);
-      const plx_llvm_unnamed_identifier left_var = (*locals)++;
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(value, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      assert(assignee->type->kind == value->type->kind);
-      switch (assignee->type->kind) {
-        case PLX_NODE_S8_TYPE:
-        case PLX_NODE_U8_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i8, ptr %%%u\n"
-                  "  %%%u = lshr i8 %%%u, %%%u\n"
-                  "  store i8 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S16_TYPE:
-        case PLX_NODE_U16_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i16, ptr %%%u\n"
-                  "  %%%u = lshr i16 %%%u, %%%u\n"
-                  "  store i16 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S32_TYPE:
-        case PLX_NODE_U32_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i32, ptr %%%u\n"
-                  "  %%%u = lshr i32 %%%u, %%%u\n"
-                  "  store i32 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        case PLX_NODE_S64_TYPE:
-        case PLX_NODE_U64_TYPE:
-          fprintf(stream,
-                  "  %%%u = load i64, ptr %%%u\n"
-                  "  %%%u = lshr i64 %%%u, %%%u\n"
-                  "  store i64 %%%u, ptr %%%u\n",
-                  left_var, assignee_var, result_var, left_var, right_var,
-                  result_var, assignee_var);
-          break;
-        default:
-          assert(false);
-      }
+    case PLX_NODE_CALL:
+      plx_generate_llvm_ir_expr(node, buffer, func);
       break;
-    }
     default: {
       assert(false);
     }
   }
 }
 
-plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
-    const struct plx_node* const node, FILE* const stream,
-    plx_llvm_unnamed_identifier* const locals) {
+plx_llvm_local plx_generate_llvm_ir_expr(const struct plx_node* const node,
+                                         struct plx_buffer* const buffer,
+                                         struct plx_llvm_ir_func* const func) {
+  if (plx_is_llvm_ir_vector_op(node)) {
+    return plx_generate_llvm_ir_vector_op(node, buffer, func);
+  }
   switch (node->kind) {
     case PLX_NODE_AND: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = and i8 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = and i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = and i16 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = and i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = and i32 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = and i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = and i64 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = and i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_BOOL_TYPE:
-          fprintf(stream, "  %%%u = and i1 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = and i1 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         default:
           assert(false);
@@ -951,35 +1574,35 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_OR: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = or i8 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = or i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = or i16 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = or i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = or i32 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = or i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = or i64 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = or i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_BOOL_TYPE:
-          fprintf(stream, "  %%%u = or i1 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = or i1 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         default:
           assert(false);
@@ -989,35 +1612,35 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_XOR: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = xor i8 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = xor i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = xor i16 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = xor i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = xor i32 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = xor i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = xor i64 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = xor i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_BOOL_TYPE:
-          fprintf(stream, "  %%%u = xor i1 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = xor i1 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         default:
           assert(false);
@@ -1027,48 +1650,48 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_EQ: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = icmp eq i8 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp eq i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = icmp eq i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp eq i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = icmp eq i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp eq i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = icmp eq i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp eq i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F16_TYPE:
-          fprintf(stream, "  %%%u = fcmp oeq half %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp oeq half %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F32_TYPE:
-          fprintf(stream, "  %%%u = fcmp oeq float %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp oeq float %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F64_TYPE:
-          fprintf(stream, "  %%%u = fcmp oeq double %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp oeq double %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_BOOL_TYPE:
-          fprintf(stream, "  %%%u = icmp eq i1 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp eq i1 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         default:
           assert(false);
@@ -1078,48 +1701,48 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_NEQ: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = icmp ne i8 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ne i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = icmp ne i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ne i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = icmp ne i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ne i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = icmp ne i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ne i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F16_TYPE:
-          fprintf(stream, "  %%%u = fcmp one half %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp one half %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F32_TYPE:
-          fprintf(stream, "  %%%u = fcmp one float %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp one float %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F64_TYPE:
-          fprintf(stream, "  %%%u = fcmp one double %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp one double %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_BOOL_TYPE:
-          fprintf(stream, "  %%%u = icmp ne i1 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ne i1 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         default:
           assert(false);
@@ -1129,56 +1752,56 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_LTE: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
-          fprintf(stream, "  %%%u = icmp sle i8 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp sle i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
-          fprintf(stream, "  %%%u = icmp sle i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp sle i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
-          fprintf(stream, "  %%%u = icmp sle i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp sle i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
-          fprintf(stream, "  %%%u = icmp sle i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp sle i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = icmp ule i8 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ule i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = icmp ule i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ule i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = icmp ule i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ule i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = icmp ule i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ule i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F16_TYPE:
-          fprintf(stream, "  %%%u = fcmp ole half %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp ole half %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F32_TYPE:
-          fprintf(stream, "  %%%u = fcmp ole float %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp ole float %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F64_TYPE:
-          fprintf(stream, "  %%%u = fcmp ole double %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp ole double %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         default:
           assert(false);
@@ -1188,56 +1811,56 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_LT: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
-          fprintf(stream, "  %%%u = icmp slt i8 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp slt i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
-          fprintf(stream, "  %%%u = icmp slt i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp slt i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
-          fprintf(stream, "  %%%u = icmp slt i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp slt i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
-          fprintf(stream, "  %%%u = icmp slt i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp slt i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = icmp ult i8 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ult i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = icmp ult i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ult i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = icmp ult i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ult i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = icmp ult i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ult i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F16_TYPE:
-          fprintf(stream, "  %%%u = fcmp olt half %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp olt half %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F32_TYPE:
-          fprintf(stream, "  %%%u = fcmp olt float %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp olt float %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F64_TYPE:
-          fprintf(stream, "  %%%u = fcmp olt double %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp olt double %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         default:
           assert(false);
@@ -1247,56 +1870,56 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_GTE: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
-          fprintf(stream, "  %%%u = icmp sge i8 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp sge i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
-          fprintf(stream, "  %%%u = icmp sge i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp sge i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
-          fprintf(stream, "  %%%u = icmp sge i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp sge i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
-          fprintf(stream, "  %%%u = icmp sge i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp sge i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = icmp uge i8 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp uge i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = icmp uge i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp uge i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = icmp uge i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp uge i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = icmp uge i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp uge i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F16_TYPE:
-          fprintf(stream, "  %%%u = fcmp oge half %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp oge half %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F32_TYPE:
-          fprintf(stream, "  %%%u = fcmp oge float %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp oge float %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F64_TYPE:
-          fprintf(stream, "  %%%u = fcmp oge double %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp oge double %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         default:
           assert(false);
@@ -1306,56 +1929,56 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_GT: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
-          fprintf(stream, "  %%%u = icmp sgt i8 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp sgt i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
-          fprintf(stream, "  %%%u = icmp sgt i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp sgt i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
-          fprintf(stream, "  %%%u = icmp sgt i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp sgt i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
-          fprintf(stream, "  %%%u = icmp sgt i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp sgt i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = icmp ugt i8 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ugt i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = icmp ugt i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ugt i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = icmp ugt i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ugt i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = icmp ugt i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = icmp ugt i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F16_TYPE:
-          fprintf(stream, "  %%%u = fcmp ogt half %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp ogt half %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F32_TYPE:
-          fprintf(stream, "  %%%u = fcmp ogt float %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp ogt float %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F64_TYPE:
-          fprintf(stream, "  %%%u = fcmp ogt double %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fcmp ogt double %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         default:
           assert(false);
@@ -1365,43 +1988,46 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_ADD: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = add i8 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = add i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = add i16 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = add i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = add i32 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = add i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = add i64 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = add i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F16_TYPE:
-          fprintf(stream, "  %%%u = fadd fast half %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fadd%s half %v, %v\n",
+                             result_var, func->fast_math_flags, left_var,
+                             right_var);
           break;
         case PLX_NODE_F32_TYPE:
-          fprintf(stream, "  %%%u = fadd fast float %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fadd%s float %v, %v\n",
+                             result_var, func->fast_math_flags, left_var,
+                             right_var);
           break;
         case PLX_NODE_F64_TYPE:
-          fprintf(stream, "  %%%u = fadd fast double %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fadd%s double %v, %v\n",
+                             result_var, func->fast_math_flags, left_var,
+                             right_var);
           break;
         default:
           assert(false);
@@ -1411,43 +2037,46 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_SUB: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = sub i8 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = sub i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = sub i16 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = sub i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = sub i32 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = sub i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = sub i64 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = sub i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F16_TYPE:
-          fprintf(stream, "  %%%u = fsub fast half %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fsub%s half %v, %v\n",
+                             result_var, func->fast_math_flags, left_var,
+                             right_var);
           break;
         case PLX_NODE_F32_TYPE:
-          fprintf(stream, "  %%%u = fsub fast float %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fsub%s float %v, %v\n",
+                             result_var, func->fast_math_flags, left_var,
+                             right_var);
           break;
         case PLX_NODE_F64_TYPE:
-          fprintf(stream, "  %%%u = fsub fast double %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fsub%s double %v, %v\n",
+                             result_var, func->fast_math_flags, left_var,
+                             right_var);
           break;
         default:
           assert(false);
@@ -1457,43 +2086,46 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_MUL: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = mul i8 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = mul i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = mul i16 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = mul i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = mul i32 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = mul i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = mul i64 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = mul i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F16_TYPE:
-          fprintf(stream, "  %%%u = fmul fast half %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fmul%s half %v, %v\n",
+                             result_var, func->fast_math_flags, left_var,
+                             right_var);
           break;
         case PLX_NODE_F32_TYPE:
-          fprintf(stream, "  %%%u = fmul fast float %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fmul%s float %v, %v\n",
+                             result_var, func->fast_math_flags, left_var,
+                             right_var);
           break;
         case PLX_NODE_F64_TYPE:
-          fprintf(stream, "  %%%u = fmul fast double %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fmul%s double %v, %v\n",
+                             result_var, func->fast_math_flags, left_var,
+                             right_var);
           break;
         default:
           assert(false);
@@ -1503,55 +2135,58 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_DIV: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
-          fprintf(stream, "  %%%u = sdiv i8 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = sdiv i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
-          fprintf(stream, "  %%%u = sdiv i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = sdiv i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
-          fprintf(stream, "  %%%u = sdiv i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = sdiv i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
-          fprintf(stream, "  %%%u = sdiv i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = sdiv i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = udiv i8 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = udiv i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = udiv i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = udiv i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = udiv i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = udiv i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = udiv i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = udiv i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_F16_TYPE:
-          fprintf(stream, "  %%%u = fdiv fast half %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fdiv%s half %v, %v\n",
+                             result_var, func->fast_math_flags, left_var,
+                             right_var);
           break;
         case PLX_NODE_F32_TYPE:
-          fprintf(stream, "  %%%u = fdiv fast float %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fdiv%s float %v, %v\n",
+                             result_var, func->fast_math_flags, left_var,
+                             right_var);
           break;
         case PLX_NODE_F64_TYPE:
-          fprintf(stream, "  %%%u = fdiv fast double %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fdiv%s double %v, %v\n",
+                             result_var, func->fast_math_flags, left_var,
+                             right_var);
           break;
         default:
           assert(false);
@@ -1561,43 +2196,43 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_REM: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
-          fprintf(stream, "  %%%u = srem i8 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = srem i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
-          fprintf(stream, "  %%%u = srem i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = srem i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
-          fprintf(stream, "  %%%u = srem i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = srem i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
-          fprintf(stream, "  %%%u = srem i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = srem i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = urem i8 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = urem i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = urem i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = urem i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = urem i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = urem i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = urem i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = urem i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         default:
           assert(false);
@@ -1607,31 +2242,31 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_LSHIFT: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = shl i8 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = shl i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = shl i16 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = shl i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = shl i32 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = shl i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = shl i64 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = shl i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         default:
           assert(false);
@@ -1641,31 +2276,31 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_RSHIFT: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      const plx_llvm_unnamed_identifier left_var =
-          plx_generate_llvm_ir_expr(left, stream, locals);
-      const plx_llvm_unnamed_identifier right_var =
-          plx_generate_llvm_ir_expr(right, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = lshr i8 %%%u, %%%u\n", result_var, left_var,
-                  right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = lshr i8 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = lshr i16 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = lshr i16 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S32_TYPE:
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = lshr i32 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = lshr i32 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = lshr i64 %%%u, %%%u\n", result_var,
-                  left_var, right_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = lshr i64 %v, %v\n",
+                             result_var, left_var, right_var);
           break;
         default:
           assert(false);
@@ -1675,33 +2310,33 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_NOT: {
       const struct plx_node* operand;
       plx_extract_children(node, &operand);
-      const plx_llvm_unnamed_identifier operand_var =
-          plx_generate_llvm_ir_expr(operand, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local operand_var =
+          plx_generate_llvm_ir_expr(operand, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = xor i8 %%%u, -1\n", result_var,
-                  operand_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = xor i8 %v, -1\n", result_var,
+                             operand_var);
           break;
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = xor i16 %%%u, -1\n", result_var,
-                  operand_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = xor i16 %v, -1\n",
+                             result_var, operand_var);
           break;
         case PLX_NODE_S32_TYPE:
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = xor i32 %%%u, -1\n", result_var,
-                  operand_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = xor i32 %v, -1\n",
+                             result_var, operand_var);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = xor i64 %%%u, -1\n", result_var,
-                  operand_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = xor i64 %v, -1\n",
+                             result_var, operand_var);
           break;
         case PLX_NODE_BOOL_TYPE:
-          fprintf(stream, "  %%%u = xor i1 %%%u, -1\n", result_var,
-                  operand_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = xor i1 %v, -1\n", result_var,
+                             operand_var);
           break;
         default:
           assert(false);
@@ -1711,36 +2346,41 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_NEG: {
       const struct plx_node* operand;
       plx_extract_children(node, &operand);
-      const plx_llvm_unnamed_identifier operand_var =
-          plx_generate_llvm_ir_expr(operand, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      const plx_llvm_local operand_var =
+          plx_generate_llvm_ir_expr(operand, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
       switch (node->type->kind) {
+        case PLX_NODE_S8_TYPE:
         case PLX_NODE_U8_TYPE:
-          fprintf(stream, "  %%%u = sub i8 0, %%%u\n", result_var, operand_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = sub i8 0, %v\n", result_var,
+                             operand_var);
           break;
+        case PLX_NODE_S16_TYPE:
         case PLX_NODE_U16_TYPE:
-          fprintf(stream, "  %%%u = sub i16 0, %%%u\n", result_var,
-                  operand_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = sub i16 0, %v\n", result_var,
+                             operand_var);
           break;
+        case PLX_NODE_S32_TYPE:
         case PLX_NODE_U32_TYPE:
-          fprintf(stream, "  %%%u = sub i32 0, %%%u\n", result_var,
-                  operand_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = sub i32 0, %v\n", result_var,
+                             operand_var);
           break;
+        case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fprintf(stream, "  %%%u = sub i64 0, %%%u\n", result_var,
-                  operand_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = sub i64 0, %v\n", result_var,
+                             operand_var);
           break;
         case PLX_NODE_F16_TYPE:
-          fprintf(stream, "  %%%u = fneg fast half %%%u\n", result_var,
-                  operand_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fneg%s half %v\n",
+                             result_var, func->fast_math_flags, operand_var);
           break;
         case PLX_NODE_F32_TYPE:
-          fprintf(stream, "  %%%u = fneg fast float %%%u\n", result_var,
-                  operand_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fneg%s float %v\n",
+                             result_var, func->fast_math_flags, operand_var);
           break;
         case PLX_NODE_F64_TYPE:
-          fprintf(stream, "  %%%u = fneg fast double %%%u\n", result_var,
-                  operand_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = fneg%s double %v\n",
+                             result_var, func->fast_math_flags, operand_var);
           break;
         default:
           assert(false);
@@ -1750,60 +2390,192 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_REF: {
       const struct plx_node* operand;
       plx_extract_children(node, &operand);
-      return plx_generate_llvm_ir_ptr(operand, stream, locals);
+      const struct plx_llvm_ir_ptr operand_ptr =
+          plx_generate_llvm_ir_ptr(operand, buffer, func);
+      if (operand_ptr.global == NULL) return operand_ptr.local;
+      const plx_llvm_local result_var = func->locals++;
+      plx_llvm_ir_printf(buffer, func, "  %v = bitcast ptr @%s to ptr\n",
+                         result_var, operand_ptr.global);
+      return result_var;
     }
     case PLX_NODE_DEREF: {
       const struct plx_node* operand;
       plx_extract_children(node, &operand);
-      const plx_llvm_unnamed_identifier operand_var =
-          plx_generate_llvm_ir_expr(operand, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      plx_llvm_ir_fprintf(stream, "  %%%u = load %t, ptr %%%u\n", result_var,
-                          node->type, operand_var);
+      const plx_llvm_local operand_var =
+          plx_generate_llvm_ir_expr(operand, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
+      plx_llvm_ir_printf(buffer, func, "  %v = load %t, ptr %v\n", result_var,
+                         node->type, operand_var);
       return result_var;
     }
     case PLX_NODE_CALL: {
-      const struct plx_node *func, *args;
-      plx_extract_children(node, &func, &args);
-      const plx_llvm_unnamed_identifier func_var =
-          plx_generate_llvm_ir_expr(func, stream, locals);
-      const plx_llvm_unnamed_identifier arg_vars_begin = *locals;
+      const struct plx_node *callee, *args;
+      plx_extract_children(node, &callee, &args);
+
+      // Functions are called directly rather than through a pointer.
+      const bool direct = callee->kind == PLX_NODE_IDENTIFIER &&
+                          plx_is_llvm_ir_func(callee->entry);
+      const plx_llvm_local callee_var =
+          direct ? 0 : plx_generate_llvm_ir_expr(callee, buffer, func);
+
+      size_t arg_count = 0;
       for (const struct plx_node* arg = args->children; arg != NULL;
            arg = arg->next) {
-        plx_generate_llvm_ir_expr(arg, stream, locals);
+        ++arg_count;
       }
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      plx_llvm_ir_fprintf(stream, "  %%%u = call %t %%%u(", result_var,
-                          func_var);
-      plx_llvm_unnamed_identifier arg_var = arg_vars_begin;
+      plx_llvm_local* const arg_vars =
+          malloc(arg_count * sizeof(plx_llvm_local));
+      if (plx_unlikely(arg_vars == NULL && arg_count > 0)) plx_oom();
+      size_t arg_index = 0;
       for (const struct plx_node* arg = args->children; arg != NULL;
            arg = arg->next) {
-        plx_llvm_ir_fprintf(stream, "%t %%%u", arg->type, arg_var++);
-        if (arg->next != NULL) fputs(", ", stream);
+        arg_vars[arg_index++] = plx_generate_llvm_ir_expr(arg, buffer, func);
       }
-      fputs(")\n", stream);
-      break;
+
+      // Tail calls reuse the caller's frame.
+      const char* const call = node->tail_call ? "musttail call" : "call";
+      plx_llvm_local result_var = 0;
+      if (node->type->kind == PLX_NODE_VOID_TYPE) {
+        plx_llvm_ir_printf(buffer, func, "  %s void ", call);
+      } else {
+        result_var = func->locals++;
+        plx_llvm_ir_printf(buffer, func, "  %v = %s %t ", result_var, call,
+                           node->type);
+      }
+      if (direct) {
+        plx_llvm_ir_printf(buffer, func, "@%s(", callee->name);
+      } else {
+        plx_llvm_ir_printf(buffer, func, "%v(", callee_var);
+      }
+      arg_index = 0;
+      for (const struct plx_node* arg = args->children; arg != NULL;
+           arg = arg->next) {
+        plx_llvm_ir_printf(buffer, func, "%t %v", arg->type,
+                           arg_vars[arg_index++]);
+        if (arg->next != NULL) plx_buffer_append_str(buffer, ", ");
+      }
+      plx_buffer_append_str(buffer, ")\n");
+      free(arg_vars);
+      return result_var;
     }
     case PLX_NODE_INDEX:
     case PLX_NODE_SLICE:
     case PLX_NODE_FIELD: {
-      const plx_llvm_unnamed_identifier ptr_var =
-          plx_generate_llvm_ir_ptr(node, stream, locals);
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      plx_llvm_ir_fprintf(stream, "  %%%u = load %t, ptr %%%u\n", result_var,
-                          node->type, ptr_var);
+      // Lanes are extracted from the vector value.
+      if (plx_is_llvm_ir_lane(node)) {
+        const struct plx_node *value, *index;
+        plx_extract_children(node, &value, &index);
+        const plx_llvm_local value_var =
+            plx_generate_llvm_ir_expr(value, buffer, func);
+        const plx_llvm_local index_var =
+            plx_generate_llvm_ir_expr(index, buffer, func);
+        const plx_llvm_local result_var = func->locals++;
+        plx_llvm_ir_printf(buffer, func,
+                           "  %v = extractelement %t %v, %t %v\n",
+                           result_var, value->type, value_var, index->type,
+                           index_var);
+        return result_var;
+      }
+      const struct plx_llvm_ir_ptr ptr =
+          plx_generate_llvm_ir_ptr(node, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
+      plx_llvm_ir_printf(buffer, func, "  %v = load %t, ptr %p\n", result_var,
+                         node->type, ptr);
+      return result_var;
+    }
+    case PLX_NODE_BOUNDS_CHECK: {
+      // The index is extended to 64 bits like by `getelementptr`, and compared
+      // as unsigned so that negative indices are out of bounds too.
+      const plx_llvm_local index_var =
+          plx_generate_llvm_ir_expr(node->children, buffer, func);
+      plx_llvm_local wide_var = index_var;
+      if (node->type->kind != PLX_NODE_S64_TYPE &&
+          node->type->kind != PLX_NODE_U64_TYPE) {
+        wide_var = func->locals++;
+        plx_llvm_ir_printf(buffer, func, "  %v = %s %t %v to i64\n", wide_var,
+                           plx_is_sint_type(node->type) ? "sext" : "zext",
+                           node->type, index_var);
+      }
+      const plx_llvm_local cond_var = func->locals++;
+      const plx_llvm_local trap_label = func->locals++;
+      const plx_llvm_local in_bounds_label = func->locals++;
+      plx_llvm_ir_printf(buffer, func, "  %v = icmp ult i64 %v, ", cond_var,
+                         wide_var);
+      plx_buffer_append_ull(buffer, node->uint);
+      plx_llvm_ir_printf(buffer, func,
+                         "\n  br i1 %v, label %%bb%u, label %%bb%u\n",
+                         cond_var, in_bounds_label, trap_label);
+      plx_generate_llvm_ir_label(trap_label, buffer, func);
+      plx_buffer_append_str(buffer,
+                            "  call void @llvm.trap()\n"
+                            "  unreachable\n");
+      plx_generate_llvm_ir_label(in_bounds_label, buffer, func);
+      return index_var;
+    }
+    case PLX_NODE_SELECT: {
+      const struct plx_node *mask, *left, *right;
+      plx_extract_children(node, &mask, &left, &right);
+      const plx_llvm_local mask_var =
+          plx_generate_llvm_ir_expr(mask, buffer, func);
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
+      plx_llvm_ir_printf(buffer, func,
+                         "  %v = select %t %v, %t %v, %t %v\n",
+                         result_var, mask->type, mask_var, left->type, left_var,
+                         right->type, right_var);
+      return result_var;
+    }
+    case PLX_NODE_SHUFFLE: {
+      const struct plx_node *left, *right, *indices;
+      plx_extract_children(node, &left, &right, &indices);
+      const plx_llvm_local left_var =
+          plx_generate_llvm_ir_expr(left, buffer, func);
+      const plx_llvm_local right_var =
+          plx_generate_llvm_ir_expr(right, buffer, func);
+      const plx_llvm_local result_var = func->locals++;
+      plx_llvm_ir_printf(buffer, func,
+                         "  %v = shufflevector %t %v, %t %v, <%u x "
+                         "i32> <",
+                         result_var, left->type, left_var, right->type,
+                         right_var, (plx_llvm_local)plx_vec_len(node->type));
+      for (const struct plx_node* index = indices->children; index != NULL;
+           index = index->next) {
+        plx_llvm_ir_printf(buffer, func, "i32 %c", index);
+        if (index->next != NULL) plx_buffer_append_str(buffer, ", ");
+      }
+      plx_buffer_append_str(buffer, ">\n");
       return result_var;
     }
+    case PLX_NODE_REDUCE_ADD:
+    case PLX_NODE_REDUCE_MUL:
+    case PLX_NODE_REDUCE_MIN:
+    case PLX_NODE_REDUCE_MAX:
+    case PLX_NODE_REDUCE_AND:
+    case PLX_NODE_REDUCE_OR:
+    case PLX_NODE_REDUCE_XOR:
+      return plx_generate_llvm_ir_reduce(node, buffer, func);
     case PLX_NODE_IDENTIFIER: {
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
+      if (plx_is_llvm_ir_ssa_var(node->entry)) {
+        return node->entry->llvm_local_var;
+      }
+      const plx_llvm_local result_var = func->locals++;
+      if (plx_is_llvm_ir_func(node->entry)) {
+        plx_llvm_ir_printf(buffer, func, "  %v = bitcast ptr @%s to ptr\n",
+                           result_var, node->name);
+        return result_var;
+      }
       switch (node->entry->scope) {
         case PLX_SYMBOL_SCOPE_LOCAL:
-          plx_llvm_ir_fprintf(stream, "  %%%u = load %t, ptr %%%u\n",
-                              result_var, node->type, node->entry->llvm_local_var);
+          plx_llvm_ir_printf(buffer, func, "  %v = load %t, ptr %v\n",
+                             result_var, node->type,
+                             node->entry->llvm_local_var);
           break;
         case PLX_SYMBOL_SCOPE_GLOBAL:
-          plx_llvm_ir_fprintf(stream, "  %%%u = load %t, ptr @%s\n", result_var,
-                              node->type, node->name);
+          plx_llvm_ir_printf(buffer, func, "  %v = load %t, ptr @%s\n",
+                             result_var, node->type, node->name);
           break;
       }
       return result_var;
@@ -1811,127 +2583,19 @@ plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
     case PLX_NODE_STRUCT:
       assert(false);
       break;
-    case PLX_NODE_S8: {
-      const plx_llvm_unnamed_identifier ptr_var = (*locals)++;
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      fprintf(stream,
-              "  %%%u = alloca i8\n"
-              "  store i8 %lld, ptr %%%u\n"
-              "  %%%u = load i8, ptr %%%u\n",
-              ptr_var, node->sint, ptr_var, result_var, ptr_var);
-      return result_var;
-    }
-    case PLX_NODE_S16: {
-      const plx_llvm_unnamed_identifier ptr_var = (*locals)++;
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      fprintf(stream,
-              "  %%%u = alloca i16\n"
-              "  store i16 %lld, ptr %%%u\n"
-              "  %%%u = load i16, ptr %%%u\n",
-              ptr_var, node->sint, ptr_var, result_var, ptr_var);
-      return result_var;
-    }
-    case PLX_NODE_S32: {
-      const plx_llvm_unnamed_identifier ptr_var = (*locals)++;
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      fprintf(stream,
-              "  %%%u = alloca i32\n"
-              "  store i32 %lld, ptr %%%u\n"
-              "  %%%u = load i32, ptr %%%u\n",
-              ptr_var, node->sint, ptr_var, result_var, ptr_var);
-      return result_var;
-    }
-    case PLX_NODE_S64: {
-      const plx_llvm_unnamed_identifier ptr_var = (*locals)++;
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      fprintf(stream,
-              "  %%%u = alloca i64\n"
-              "  store i64 %lld, ptr %%%u\n"
-              "  %%%u = load i64, ptr %%%u\n",
-              ptr_var, node->sint, ptr_var, result_var, ptr_var);
-      return result_var;
-    }
-    case PLX_NODE_U8: {
-      const plx_llvm_unnamed_identifier ptr_var = (*locals)++;
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      fprintf(stream,
-              "  %%%u = alloca i8\n"
-              "  store i8 %llu, ptr %%%u\n"
-              "  %%%u = load i8, ptr %%%u\n",
-              ptr_var, node->uint, ptr_var, result_var, ptr_var);
-      return result_var;
-    }
-    case PLX_NODE_U16: {
-      const plx_llvm_unnamed_identifier ptr_var = (*locals)++;
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      fprintf(stream,
-              "  %%%u = alloca i16\n"
-              "  store i16 %llu, ptr %%%u\n"
-              "  %%%u = load i16, ptr %%%u\n",
-              ptr_var, node->uint, ptr_var, result_var, ptr_var);
-      return result_var;
-    }
-    case PLX_NODE_U32: {
-      const plx_llvm_unnamed_identifier ptr_var = (*locals)++;
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      fprintf(stream,
-              "  %%%u = alloca i32\n"
-              "  store i32 %llu, ptr %%%u\n"
-              "  %%%u = load i32, ptr %%%u\n",
-              ptr_var, node->uint, ptr_var, result_var, ptr_var);
-      return result_var;
-    }
-    case PLX_NODE_U64: {
-      const plx_llvm_unnamed_identifier ptr_var = (*locals)++;
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      fprintf(stream,
-              "  %%%u = alloca i64\n"
-              "  store i64 %llu, ptr %%%u\n"
-              "  %%%u = load i64, ptr %%%u\n",
-              ptr_var, node->uint, ptr_var, result_var, ptr_var);
-      return result_var;
-    }
-    case PLX_NODE_F16: {
-      const plx_llvm_unnamed_identifier ptr_var = (*locals)++;
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      fprintf(stream,
-              "  %%%u = alloca half\n"
-              "  store half %f, ptr %%%u\n"
-              "  %%%u = load half, ptr %%%u\n",
-              ptr_var, node->f, ptr_var, result_var, ptr_var);
-      return result_var;
-    }
-    case PLX_NODE_F32: {
-      const plx_llvm_unnamed_identifier ptr_var = (*locals)++;
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      fprintf(stream,
-              "  %%%u = alloca float\n"
-              "  store float %f, ptr %%%u\n"
-              "  %%%u = load float, ptr %%%u\n",
-              ptr_var, node->f, ptr_var, result_var, ptr_var);
-      return result_var;
-    }
-    case PLX_NODE_F64: {
-      const plx_llvm_unnamed_identifier ptr_var = (*locals)++;
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      fprintf(stream,
-              "  %%%u = alloca double\n"
-              "  store double %f, ptr %%%u\n"
-              "  %%%u = load double, ptr %%%u\n",
-              ptr_var, node->f, ptr_var, result_var, ptr_var);
-      return result_var;
-    }
-    case PLX_NODE_BOOL: {
-      const plx_llvm_unnamed_identifier ptr_var = (*locals)++;
-      const plx_llvm_unnamed_identifier result_var = (*locals)++;
-      fprintf(stream,
-              "  %%%u = alloca i1\n"
-              "  store i1 %s, ptr %%%u\n"
-              "  %%%u = load i1, ptr %%%u\n",
-              ptr_var, node->b ? "true" : "false", ptr_var, result_var,
-              ptr_var);
-      return result_var;
-    }
+    case PLX_NODE_S8:
+    case PLX_NODE_S16:
+    case PLX_NODE_S32:
+    case PLX_NODE_S64:
+    case PLX_NODE_U8:
+    case PLX_NODE_U16:
+    case PLX_NODE_U32:
+    case PLX_NODE_U64:
+    case PLX_NODE_F16:
+    case PLX_NODE_F32:
+    case PLX_NODE_F64:
+    case PLX_NODE_BOOL:
+      return plx_llvm_ir_constant(node, func);
     default:
       assert(false);
   }
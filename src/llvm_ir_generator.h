@@ -15,27 +15,62 @@
 #ifndef PLX_LLVM_IR_GENERATOR_H
 #define PLX_LLVM_IR_GENERATOR_H
 
-#include <stdio.h>
+#include <stdbool.h>
 
 #include "ast.h"
+#include "buffer.h"
 
-// Represents an LLVM unnamed identifier.
+// Represents an LLVM local identifier. Locals are numbered, but are written as
+// named identifiers (`%v1`, `%bb2`) rather than unnamed identifiers, since
+// unnamed identifiers must be defined in numerical order, which would prevent
+// a loop header and its phi nodes from being generated after the loop body.
+// Operands may also refer to constants, which are written as immediates.
 // https://llvm.org/docs/LangRef.html#identifiers
-typedef unsigned int plx_llvm_unnamed_identifier;
+typedef unsigned int plx_llvm_local;
 
-// Generates an LLVM IR module from the abstract syntax tree to the output stream.
-void plx_generate_llvm_ir(const struct plx_node* node, FILE* stream);
+// Function that LLVM IR is being generated for.
+struct plx_llvm_ir_func;
 
-// Generates LLVM IR for a statement in the abstract syntax tree to the output stream.
-void plx_generate_llvm_ir_stmt(const struct plx_node* node, FILE* stream,
-                               plx_llvm_unnamed_identifier* locals,
-                               plx_llvm_unnamed_identifier loop_enter_label,
-                               plx_llvm_unnamed_identifier loop_exit_label);
+// Loop that LLVM IR is being generated for.
+struct plx_llvm_ir_loop;
+
+// Generates the target triple and data layout of an LLVM IR module to the
+// output buffer. The data layout may be `NULL`.
+void plx_generate_llvm_ir_target(const char* triple, const char* data_layout,
+                                 struct plx_buffer* buffer);
+
+// Generates an LLVM IR module from the abstract syntax tree to the output
+// buffer. Floating point instructions have fast-math flags if `fast_math` is
+// set.
+void plx_generate_llvm_ir(const struct plx_node* node, bool fast_math,
+                          struct plx_buffer* buffer);
+
+// Assigns the functions of a module to at most `unit_count` codegen units that
+// can be compiled in parallel, returning the number of units that are used.
+// Functions that call each other are kept together, and globals are defined in
+// the first unit.
+unsigned int plx_partition_llvm_ir(const struct plx_node* module,
+                                   unsigned int unit_count);
+
+// Generates the LLVM IR module of a codegen unit to the output buffer. Globals
+// that are defined in other units are declared. The module must have been
+// partitioned with `plx_partition_llvm_ir`.
+void plx_generate_llvm_ir_unit(const struct plx_node* module,
+                               unsigned int unit, bool fast_math,
+                               struct plx_buffer* buffer);
+
+// Generates LLVM IR for a statement in the abstract syntax tree to the output
+// buffer. Local variables are kept in SSA form unless they are referenced or
+// are not scalars, in which case they are kept in stack slots.
+void plx_generate_llvm_ir_stmt(const struct plx_node* node,
+                               struct plx_buffer* buffer,
+                               struct plx_llvm_ir_func* func,
+                               struct plx_llvm_ir_loop* loop);
 
 // Generates LLVM IR for an expression in the abstract syntax tree to the output
-// stream, returning a temporary variable that holds the result.
-plx_llvm_unnamed_identifier plx_generate_llvm_ir_expr(
-    const struct plx_node* node, FILE* stream,
-    plx_llvm_unnamed_identifier* locals);
+// buffer, returning an operand that holds the result.
+plx_llvm_local plx_generate_llvm_ir_expr(const struct plx_node* node,
+                                         struct plx_buffer* buffer,
+                                         struct plx_llvm_ir_func* func);
 
 #endif  // PLX_LLVM_IR_GENERATOR_H
@@ -0,0 +1,1213 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "llvm_native_generator.h"
+
+#ifdef PLX_HAVE_LLVM
+
+#include <assert.h>
+#include <llvm-c/Analysis.h>
+#include <llvm-c/BitWriter.h>
+#include <llvm-c/Core.h>
+#include <llvm-c/Error.h>
+#include <llvm-c/Target.h>
+#include <llvm-c/TargetMachine.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "macros.h"
+#include "symbol_table_entry.h"
+#include "types.h"
+
+struct plx_llvm_native_generator {
+  LLVMContextRef context;
+  LLVMModuleRef module;
+  LLVMBuilderRef builder;
+
+  // Function being generated.
+  LLVMValueRef func;
+
+  // Block that `continue` branches to in the innermost loop.
+  LLVMBasicBlockRef continue_block;
+
+  // Block that `break` branches to in the innermost loop.
+  LLVMBasicBlockRef break_block;
+};
+
+static LLVMValueRef plx_generate_llvm_native_expr(
+    const struct plx_node* node, struct plx_llvm_native_generator* gen);
+
+static LLVMTypeRef plx_llvm_native_type(const struct plx_node* type,
+                                        LLVMContextRef context);
+
+// Returns the LLVM function type of a function type.
+static LLVMTypeRef plx_llvm_native_func_type(const struct plx_node* const type,
+                                             const LLVMContextRef context) {
+  // The return type follows the parameter types.
+  const struct plx_node* const param_types = type->children;
+  const struct plx_node* const return_type = param_types->next;
+  unsigned int param_count = 0;
+  for (const struct plx_node* param_type = param_types->children;
+       param_type != NULL; param_type = param_type->next) {
+    ++param_count;
+  }
+  LLVMTypeRef* const llvm_param_types =
+      malloc(param_count * sizeof(LLVMTypeRef));
+  if (plx_unlikely(llvm_param_types == NULL && param_count > 0)) plx_oom();
+  unsigned int param_index = 0;
+  for (const struct plx_node* param_type = param_types->children;
+       param_type != NULL; param_type = param_type->next) {
+    llvm_param_types[param_index++] = plx_llvm_native_type(param_type, context);
+  }
+  const LLVMTypeRef func_type =
+      LLVMFunctionType(plx_llvm_native_type(return_type, context),
+                       llvm_param_types, param_count, /*IsVarArg=*/false);
+  free(llvm_param_types);
+  return func_type;
+}
+
+static LLVMTypeRef plx_llvm_native_type(const struct plx_node* const type,
+                                        const LLVMContextRef context) {
+  switch (type->kind) {
+    case PLX_NODE_VOID_TYPE:
+      return LLVMVoidTypeInContext(context);
+    case PLX_NODE_S8_TYPE:
+    case PLX_NODE_U8_TYPE:
+      return LLVMInt8TypeInContext(context);
+    case PLX_NODE_S16_TYPE:
+    case PLX_NODE_U16_TYPE:
+      return LLVMInt16TypeInContext(context);
+    case PLX_NODE_S32_TYPE:
+    case PLX_NODE_U32_TYPE:
+      return LLVMInt32TypeInContext(context);
+    case PLX_NODE_S64_TYPE:
+    case PLX_NODE_U64_TYPE:
+      return LLVMInt64TypeInContext(context);
+    case PLX_NODE_F16_TYPE:
+      return LLVMHalfTypeInContext(context);
+    case PLX_NODE_F32_TYPE:
+      return LLVMFloatTypeInContext(context);
+    case PLX_NODE_F64_TYPE:
+      return LLVMDoubleTypeInContext(context);
+    case PLX_NODE_BOOL_TYPE:
+      return LLVMInt1TypeInContext(context);
+    case PLX_NODE_STRING_TYPE:
+      assert(false);
+      break;
+    case PLX_NODE_FUNC_TYPE:
+      return LLVMPointerType(plx_llvm_native_func_type(type, context),
+                             /*AddressSpace=*/0);
+    case PLX_NODE_REF_TYPE:
+      return LLVMPointerType(plx_llvm_native_type(type->children, context),
+                             /*AddressSpace=*/0);
+    case PLX_NODE_ARRAY_TYPE: {
+      const struct plx_node *len, *element_type;
+      plx_extract_children(type, &len, &element_type);
+      return LLVMArrayType(plx_llvm_native_type(element_type, context),
+                           (unsigned int)len->uint);
+    }
+    case PLX_NODE_SLICE_TYPE: {
+      LLVMTypeRef member_types[] = {
+          LLVMInt64TypeInContext(context),
+          LLVMPointerType(plx_llvm_native_type(type->children, context),
+                          /*AddressSpace=*/0)};
+      return LLVMStructTypeInContext(context, member_types, 2,
+                                     /*Packed=*/false);
+    }
+    case PLX_NODE_VEC_TYPE: {
+      const struct plx_node *len, *element_type;
+      plx_extract_children(type, &len, &element_type);
+      return LLVMVectorType(plx_llvm_native_type(element_type, context),
+                            (unsigned int)len->uint);
+    }
+    default:
+      assert(false);
+  }
+  return NULL;
+}
+
+// Returns whether a symbol names a function.
+static bool plx_is_llvm_native_func(
+    const struct plx_symbol_table_entry* const entry) {
+  return entry->scope == PLX_SYMBOL_SCOPE_GLOBAL &&
+         entry->mutability == PLX_SYMBOL_MUTABILITY_CONST &&
+         entry->type->kind == PLX_NODE_FUNC_TYPE;
+}
+
+// Returns whether the current basic block has been terminated.
+static bool plx_llvm_native_terminated(
+    const struct plx_llvm_native_generator* const gen) {
+  return LLVMGetBasicBlockTerminator(LLVMGetInsertBlock(gen->builder)) != NULL;
+}
+
+static LLVMValueRef plx_generate_llvm_native_constant(
+    const struct plx_node* const node, const LLVMContextRef context) {
+  const LLVMTypeRef type = plx_llvm_native_type(node->type, context);
+  switch (node->kind) {
+    case PLX_NODE_S8:
+    case PLX_NODE_S16:
+    case PLX_NODE_S32:
+    case PLX_NODE_S64:
+      return LLVMConstInt(type, (unsigned long long)node->sint,
+                          /*SignExtend=*/true);
+    case PLX_NODE_U8:
+    case PLX_NODE_U16:
+    case PLX_NODE_U32:
+    case PLX_NODE_U64:
+      return LLVMConstInt(type, node->uint, /*SignExtend=*/false);
+    case PLX_NODE_F16:
+    case PLX_NODE_F32:
+    case PLX_NODE_F64:
+      return LLVMConstReal(type, node->f);
+    case PLX_NODE_BOOL:
+      return LLVMConstInt(type, node->b, /*SignExtend=*/false);
+    default:
+      assert(false);
+  }
+  return NULL;
+}
+
+// Generates stack slots in the entry block for the local variables. They are
+// promoted to SSA values by the `mem2reg` pass.
+static void plx_generate_llvm_native_allocas(
+    const struct plx_node* const node,
+    struct plx_llvm_native_generator* const gen) {
+  switch (node->kind) {
+    case PLX_NODE_CONST_DEF:
+    case PLX_NODE_VAR_DEF:
+    case PLX_NODE_VAR_DECL:
+    case PLX_NODE_FOR_LOOP: {
+      struct plx_symbol_table_entry* const entry = node->children->entry;
+      entry->llvm_value = LLVMBuildAlloca(
+          gen->builder, plx_llvm_native_type(entry->type, gen->context),
+          entry->name);
+      // The body of a loop declares more variables.
+      if (node->kind == PLX_NODE_FOR_LOOP) {
+        plx_generate_llvm_native_allocas(node->children->next->next, gen);
+      }
+      break;
+    }
+    default:
+      for (const struct plx_node* child = node->children; child != NULL;
+           child = child->next) {
+        plx_generate_llvm_native_allocas(child, gen);
+      }
+  }
+}
+
+// Returns the binary operation performed by a compound assignment.
+static enum plx_node_kind plx_llvm_native_assign_op(
+    const enum plx_node_kind kind) {
+  switch (kind) {
+    case PLX_NODE_ADD_ASSIGN:
+      return PLX_NODE_ADD;
+    case PLX_NODE_SUB_ASSIGN:
+      return PLX_NODE_SUB;
+    case PLX_NODE_MUL_ASSIGN:
+      return PLX_NODE_MUL;
+    case PLX_NODE_DIV_ASSIGN:
+      return PLX_NODE_DIV;
+    case PLX_NODE_REM_ASSIGN:
+      return PLX_NODE_REM;
+    case PLX_NODE_LSHIFT_ASSIGN:
+      return PLX_NODE_LSHIFT;
+    case PLX_NODE_RSHIFT_ASSIGN:
+      return PLX_NODE_RSHIFT;
+    default:
+      assert(false);
+  }
+  return PLX_NODE_NOP;
+}
+
+// Generates a binary operation on operands of the given type.
+static LLVMValueRef plx_generate_llvm_native_binary_op(
+    const enum plx_node_kind kind, const struct plx_node* const type,
+    const LLVMValueRef left, const LLVMValueRef right,
+    struct plx_llvm_native_generator* const gen) {
+  const bool is_float = plx_is_float_type(type);
+  const bool is_sint = plx_is_sint_type(type);
+  switch (kind) {
+    case PLX_NODE_AND:
+      return LLVMBuildAnd(gen->builder, left, right, "");
+    case PLX_NODE_OR:
+      return LLVMBuildOr(gen->builder, left, right, "");
+    case PLX_NODE_XOR:
+      return LLVMBuildXor(gen->builder, left, right, "");
+    case PLX_NODE_EQ:
+      if (is_float) {
+        return LLVMBuildFCmp(gen->builder, LLVMRealOEQ, left, right, "");
+      }
+      return LLVMBuildICmp(gen->builder, LLVMIntEQ, left, right, "");
+    case PLX_NODE_NEQ:
+      if (is_float) {
+        return LLVMBuildFCmp(gen->builder, LLVMRealONE, left, right, "");
+      }
+      return LLVMBuildICmp(gen->builder, LLVMIntNE, left, right, "");
+    case PLX_NODE_LTE:
+      if (is_float) {
+        return LLVMBuildFCmp(gen->builder, LLVMRealOLE, left, right, "");
+      }
+      return LLVMBuildICmp(gen->builder, is_sint ? LLVMIntSLE : LLVMIntULE,
+                           left, right, "");
+    case PLX_NODE_LT:
+      if (is_float) {
+        return LLVMBuildFCmp(gen->builder, LLVMRealOLT, left, right, "");
+      }
+      return LLVMBuildICmp(gen->builder, is_sint ? LLVMIntSLT : LLVMIntULT,
+                           left, right, "");
+    case PLX_NODE_GTE:
+      if (is_float) {
+        return LLVMBuildFCmp(gen->builder, LLVMRealOGE, left, right, "");
+      }
+      return LLVMBuildICmp(gen->builder, is_sint ? LLVMIntSGE : LLVMIntUGE,
+                           left, right, "");
+    case PLX_NODE_GT:
+      if (is_float) {
+        return LLVMBuildFCmp(gen->builder, LLVMRealOGT, left, right, "");
+      }
+      return LLVMBuildICmp(gen->builder, is_sint ? LLVMIntSGT : LLVMIntUGT,
+                           left, right, "");
+    case PLX_NODE_ADD:
+      return is_float ? LLVMBuildFAdd(gen->builder, left, right, "")
+                      : LLVMBuildAdd(gen->builder, left, right, "");
+    case PLX_NODE_SUB:
+      return is_float ? LLVMBuildFSub(gen->builder, left, right, "")
+                      : LLVMBuildSub(gen->builder, left, right, "");
+    case PLX_NODE_MUL:
+      return is_float ? LLVMBuildFMul(gen->builder, left, right, "")
+                      : LLVMBuildMul(gen->builder, left, right, "");
+    case PLX_NODE_DIV:
+      if (is_float) return LLVMBuildFDiv(gen->builder, left, right, "");
+      return is_sint ? LLVMBuildSDiv(gen->builder, left, right, "")
+                     : LLVMBuildUDiv(gen->builder, left, right, "");
+    case PLX_NODE_REM:
+      assert(plx_is_int_type(type));
+      return is_sint ? LLVMBuildSRem(gen->builder, left, right, "")
+                     : LLVMBuildURem(gen->builder, left, right, "");
+    case PLX_NODE_LSHIFT:
+      assert(plx_is_int_type(type));
+      return LLVMBuildShl(gen->builder, left, right, "");
+    case PLX_NODE_RSHIFT:
+      assert(plx_is_int_type(type));
+      return LLVMBuildLShr(gen->builder, left, right, "");
+    default:
+      assert(false);
+  }
+  return NULL;
+}
+
+// Returns whether an expression indexes into a vector.
+static bool plx_is_llvm_native_lane(const struct plx_node* const node) {
+  return node->kind == PLX_NODE_INDEX &&
+         plx_is_vec_type(node->children->type);
+}
+
+// Returns a constant vector of `count` lane indices for a shuffle. The first
+// `defined` indices count up from `first`, and the rest are poison.
+static LLVMValueRef plx_llvm_native_shuffle_mask(
+    const unsigned int count, const unsigned int first,
+    const unsigned int defined, struct plx_llvm_native_generator* const gen) {
+  const LLVMTypeRef i32 = LLVMInt32TypeInContext(gen->context);
+  LLVMValueRef* const indices = malloc(count * sizeof(LLVMValueRef));
+  if (plx_unlikely(indices == NULL)) plx_oom();
+  for (unsigned int i = 0; i < count; ++i) {
+    indices[i] = i < defined
+                     ? LLVMConstInt(i32, first + i, /*SignExtend=*/false)
+                     : LLVMGetPoison(i32);
+  }
+  const LLVMValueRef mask = LLVMConstVector(indices, count);
+  free(indices);
+  return mask;
+}
+
+// Generates a horizontal reduction of the lanes of a vector by repeatedly
+// combining the lower half of the lanes with the upper half.
+static LLVMValueRef plx_generate_llvm_native_reduce(
+    const struct plx_node* const node,
+    struct plx_llvm_native_generator* const gen) {
+  const struct plx_node* const operand = node->children;
+  const struct plx_node* const lane_type = plx_lane_type(operand->type);
+  const unsigned int len = (unsigned int)plx_vec_len(operand->type);
+  enum plx_node_kind kind;
+  switch (node->kind) {
+    case PLX_NODE_REDUCE_ADD:
+      kind = PLX_NODE_ADD;
+      break;
+    case PLX_NODE_REDUCE_MUL:
+      kind = PLX_NODE_MUL;
+      break;
+    case PLX_NODE_REDUCE_MIN:
+      kind = PLX_NODE_LT;
+      break;
+    case PLX_NODE_REDUCE_MAX:
+      kind = PLX_NODE_GT;
+      break;
+    case PLX_NODE_REDUCE_AND:
+      kind = PLX_NODE_AND;
+      break;
+    case PLX_NODE_REDUCE_OR:
+      kind = PLX_NODE_OR;
+      break;
+    case PLX_NODE_REDUCE_XOR:
+      kind = PLX_NODE_XOR;
+      break;
+    default:
+      assert(false);
+      return NULL;
+  }
+
+  LLVMValueRef vec = plx_generate_llvm_native_expr(operand, gen);
+  const LLVMValueRef poison = LLVMGetPoison(LLVMTypeOf(vec));
+  for (unsigned int half = len / 2; half > 0; half /= 2) {
+    const LLVMValueRef shuffle = LLVMBuildShuffleVector(
+        gen->builder, vec, poison,
+        plx_llvm_native_shuffle_mask(len, half, half, gen), "");
+    const LLVMValueRef result = plx_generate_llvm_native_binary_op(
+        kind, lane_type, vec, shuffle, gen);
+    vec = kind == PLX_NODE_LT || kind == PLX_NODE_GT
+              ? LLVMBuildSelect(gen->builder, result, vec, shuffle, "")
+              : result;
+  }
+  return LLVMBuildExtractElement(
+      gen->builder, vec,
+      LLVMConstInt(LLVMInt32TypeInContext(gen->context), 0,
+                   /*SignExtend=*/false),
+      "");
+}
+
+// Generates an index that traps if it is out of bounds. The index is extended
+// to 64 bits like by `getelementptr`, and compared as unsigned so that negative
+// indices are out of bounds too.
+static LLVMValueRef plx_generate_llvm_native_bounds_check(
+    const struct plx_node* const node,
+    struct plx_llvm_native_generator* const gen) {
+  const LLVMTypeRef i64 = LLVMInt64TypeInContext(gen->context);
+  const LLVMValueRef index = plx_generate_llvm_native_expr(node->children, gen);
+  const LLVMValueRef in_bounds = LLVMBuildICmp(
+      gen->builder, LLVMIntULT,
+      LLVMBuildIntCast2(gen->builder, index, i64,
+                        plx_is_sint_type(node->type), ""),
+      LLVMConstInt(i64, node->uint, /*SignExtend=*/false), "");
+  const LLVMBasicBlockRef trap_block =
+      LLVMAppendBasicBlockInContext(gen->context, gen->func, "");
+  const LLVMBasicBlockRef in_bounds_block =
+      LLVMAppendBasicBlockInContext(gen->context, gen->func, "");
+  LLVMBuildCondBr(gen->builder, in_bounds, in_bounds_block, trap_block);
+
+  LLVMPositionBuilderAtEnd(gen->builder, trap_block);
+  static const char trap_name[] = "llvm.trap";
+  const unsigned int trap_id =
+      LLVMLookupIntrinsicID(trap_name, sizeof(trap_name) - 1);
+  LLVMBuildCall2(gen->builder,
+                 LLVMIntrinsicGetType(gen->context, trap_id, NULL, 0),
+                 LLVMGetIntrinsicDeclaration(gen->module, trap_id, NULL, 0),
+                 NULL, 0, "");
+  LLVMBuildUnreachable(gen->builder);
+
+  LLVMPositionBuilderAtEnd(gen->builder, in_bounds_block);
+  return index;
+}
+
+static LLVMValueRef plx_generate_llvm_native_ptr(
+    const struct plx_node* const node,
+    struct plx_llvm_native_generator* const gen) {
+  switch (node->kind) {
+    case PLX_NODE_INDEX: {
+      const struct plx_node *value, *index;
+      plx_extract_children(node, &value, &index);
+      const LLVMValueRef value_ptr = plx_generate_llvm_native_ptr(value, gen);
+      const LLVMTypeRef i64 = LLVMInt64TypeInContext(gen->context);
+      LLVMValueRef indices[] = {
+          LLVMConstInt(i64, 0, /*SignExtend=*/false),
+          LLVMBuildIntCast2(gen->builder,
+                            plx_generate_llvm_native_expr(index, gen), i64,
+                            plx_is_sint_type(index->type), "")};
+      return LLVMBuildInBoundsGEP2(
+          gen->builder, plx_llvm_native_type(value->type, gen->context),
+          value_ptr, indices, 2, "");
+    }
+    case PLX_NODE_FIELD:
+      // TODO
+      assert(false);
+      break;
+    case PLX_NODE_DEREF: {
+      const struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      return plx_generate_llvm_native_expr(operand, gen);
+    }
+    case PLX_NODE_IDENTIFIER:
+      return node->entry->llvm_value;
+    default:
+      assert(false);
+  }
+  return NULL;
+}
+
+static void plx_generate_llvm_native_stmt(
+    const struct plx_node* node, struct plx_llvm_native_generator* gen);
+
+// Generates a loop over a range, array, or slice in canonical form. A single
+// induction variable counts up from zero or the start of the range to an end
+// that is computed before the loop, and `continue` branches to the latch that
+// increments it.
+static void plx_generate_llvm_native_for_loop(
+    const struct plx_node* const node,
+    struct plx_llvm_native_generator* const gen) {
+  const struct plx_node *name, *iterable, *body;
+  plx_extract_children(node, &name, &iterable, &body);
+  const LLVMTypeRef i64 = LLVMInt64TypeInContext(gen->context);
+
+  // Compute the bounds of the induction variable. Arrays and slices are
+  // indexed from zero to their length.
+  LLVMTypeRef counter_type = i64;
+  bool is_sint = false;
+  LLVMValueRef start, end, elements = NULL;
+  if (iterable->kind == PLX_NODE_RANGE) {
+    const struct plx_node *start_node, *end_node;
+    plx_extract_children(iterable, &start_node, &end_node);
+    counter_type = plx_llvm_native_type(iterable->type, gen->context);
+    is_sint = plx_is_sint_type(iterable->type);
+    start = plx_generate_llvm_native_expr(start_node, gen);
+    end = plx_generate_llvm_native_expr(end_node, gen);
+  } else if (iterable->type->kind == PLX_NODE_ARRAY_TYPE) {
+    elements = plx_generate_llvm_native_ptr(iterable, gen);
+    start = LLVMConstInt(i64, 0, /*SignExtend=*/false);
+    end = LLVMConstInt(i64, iterable->type->children->uint,
+                       /*SignExtend=*/false);
+  } else {
+    const LLVMValueRef slice = plx_generate_llvm_native_expr(iterable, gen);
+    start = LLVMConstInt(i64, 0, /*SignExtend=*/false);
+    end = LLVMBuildExtractValue(gen->builder, slice, 0, "");
+    elements = LLVMBuildExtractValue(gen->builder, slice, 1, "");
+  }
+
+  LLVMBasicBlockRef entry_block = LLVMGetInsertBlock(gen->builder);
+  const LLVMBasicBlockRef header_block =
+      LLVMAppendBasicBlockInContext(gen->context, gen->func, "");
+  const LLVMBasicBlockRef body_block =
+      LLVMAppendBasicBlockInContext(gen->context, gen->func, "");
+  LLVMBasicBlockRef latch_block =
+      LLVMAppendBasicBlockInContext(gen->context, gen->func, "");
+  const LLVMBasicBlockRef exit_block =
+      LLVMAppendBasicBlockInContext(gen->context, gen->func, "");
+  LLVMBuildBr(gen->builder, header_block);
+
+  LLVMPositionBuilderAtEnd(gen->builder, header_block);
+  const LLVMValueRef counter = LLVMBuildPhi(gen->builder, counter_type, "");
+  LLVMAddIncoming(counter, &start, &entry_block, 1);
+  LLVMBuildCondBr(gen->builder,
+                  LLVMBuildICmp(gen->builder,
+                                is_sint ? LLVMIntSLT : LLVMIntULT, counter,
+                                end, ""),
+                  body_block, exit_block);
+
+  // Define the loop variable.
+  LLVMPositionBuilderAtEnd(gen->builder, body_block);
+  LLVMValueRef value = counter;
+  if (elements != NULL) {
+    const LLVMTypeRef element_type =
+        plx_llvm_native_type(name->entry->type, gen->context);
+    LLVMValueRef element_ptr;
+    if (iterable->type->kind == PLX_NODE_ARRAY_TYPE) {
+      LLVMValueRef indices[] = {LLVMConstInt(i64, 0, /*SignExtend=*/false),
+                                counter};
+      element_ptr = LLVMBuildInBoundsGEP2(
+          gen->builder, plx_llvm_native_type(iterable->type, gen->context),
+          elements, indices, 2, "");
+    } else {
+      LLVMValueRef indices[] = {counter};
+      element_ptr = LLVMBuildInBoundsGEP2(gen->builder, element_type,
+                                          elements, indices, 1, "");
+    }
+    value = LLVMBuildLoad2(gen->builder, element_type, element_ptr, "");
+  }
+  LLVMBuildStore(gen->builder, value, name->entry->llvm_value);
+
+  const LLVMBasicBlockRef outer_continue_block = gen->continue_block;
+  const LLVMBasicBlockRef outer_break_block = gen->break_block;
+  gen->continue_block = latch_block;
+  gen->break_block = exit_block;
+  plx_generate_llvm_native_stmt(body, gen);
+  if (!plx_llvm_native_terminated(gen)) {
+    LLVMBuildBr(gen->builder, latch_block);
+  }
+  gen->continue_block = outer_continue_block;
+  gen->break_block = outer_break_block;
+
+  // The induction variable cannot overflow, since it is less than the end.
+  LLVMPositionBuilderAtEnd(gen->builder, latch_block);
+  const LLVMValueRef one = LLVMConstInt(counter_type, 1, /*SignExtend=*/false);
+  LLVMValueRef next =
+      is_sint ? LLVMBuildNSWAdd(gen->builder, counter, one, "")
+              : LLVMBuildNUWAdd(gen->builder, counter, one, "");
+  LLVMBuildBr(gen->builder, header_block);
+  LLVMAddIncoming(counter, &next, &latch_block, 1);
+
+  LLVMPositionBuilderAtEnd(gen->builder, exit_block);
+}
+
+static void plx_generate_llvm_native_stmt(
+    const struct plx_node* const node,
+    struct plx_llvm_native_generator* const gen) {
+  switch (node->kind) {
+    case PLX_NODE_CONST_DEF:
+    case PLX_NODE_VAR_DEF: {
+      const struct plx_node *name, *value;
+      plx_extract_children(node, &name, &value);
+      LLVMBuildStore(gen->builder, plx_generate_llvm_native_expr(value, gen),
+                     name->entry->llvm_value);
+      break;
+    }
+    case PLX_NODE_VAR_DECL:
+    case PLX_NODE_NOP:
+      break;
+    case PLX_NODE_BLOCK:
+      for (const struct plx_node* stmt = node->children; stmt != NULL;
+           stmt = stmt->next) {
+        // Skip unreachable statements.
+        if (plx_llvm_native_terminated(gen)) break;
+        plx_generate_llvm_native_stmt(stmt, gen);
+      }
+      break;
+    case PLX_NODE_IF_THEN_ELSE: {
+      const struct plx_node *cond, *then, *els;
+      plx_extract_children(node, &cond, &then, &els);
+      const LLVMBasicBlockRef then_block =
+          LLVMAppendBasicBlockInContext(gen->context, gen->func, "");
+      const LLVMBasicBlockRef else_block =
+          LLVMAppendBasicBlockInContext(gen->context, gen->func, "");
+      const LLVMBasicBlockRef end_block =
+          LLVMAppendBasicBlockInContext(gen->context, gen->func, "");
+      LLVMBuildCondBr(gen->builder, plx_generate_llvm_native_expr(cond, gen),
+                      then_block, else_block);
+      LLVMPositionBuilderAtEnd(gen->builder, then_block);
+      plx_generate_llvm_native_stmt(then, gen);
+      if (!plx_llvm_native_terminated(gen)) {
+        LLVMBuildBr(gen->builder, end_block);
+      }
+      LLVMPositionBuilderAtEnd(gen->builder, else_block);
+      plx_generate_llvm_native_stmt(els, gen);
+      if (!plx_llvm_native_terminated(gen)) {
+        LLVMBuildBr(gen->builder, end_block);
+      }
+      LLVMPositionBuilderAtEnd(gen->builder, end_block);
+      break;
+    }
+    case PLX_NODE_LOOP:
+    case PLX_NODE_WHILE_LOOP: {
+      const struct plx_node *cond = NULL, *body;
+      if (node->kind == PLX_NODE_LOOP) {
+        plx_extract_children(node, &body);
+      } else {
+        plx_extract_children(node, &cond, &body);
+      }
+      const LLVMBasicBlockRef header_block =
+          LLVMAppendBasicBlockInContext(gen->context, gen->func, "");
+      const LLVMBasicBlockRef body_block =
+          LLVMAppendBasicBlockInContext(gen->context, gen->func, "");
+      const LLVMBasicBlockRef exit_block =
+          LLVMAppendBasicBlockInContext(gen->context, gen->func, "");
+      LLVMBuildBr(gen->builder, header_block);
+
+      LLVMPositionBuilderAtEnd(gen->builder, header_block);
+      if (cond == NULL) {
+        LLVMBuildBr(gen->builder, body_block);
+      } else {
+        LLVMBuildCondBr(gen->builder, plx_generate_llvm_native_expr(cond, gen),
+                        body_block, exit_block);
+      }
+
+      const LLVMBasicBlockRef outer_continue_block = gen->continue_block;
+      const LLVMBasicBlockRef outer_break_block = gen->break_block;
+      gen->continue_block = header_block;
+      gen->break_block = exit_block;
+      LLVMPositionBuilderAtEnd(gen->builder, body_block);
+      plx_generate_llvm_native_stmt(body, gen);
+      if (!plx_llvm_native_terminated(gen)) {
+        LLVMBuildBr(gen->builder, header_block);
+      }
+      gen->continue_block = outer_continue_block;
+      gen->break_block = outer_break_block;
+
+      LLVMPositionBuilderAtEnd(gen->builder, exit_block);
+      break;
+    }
+    case PLX_NODE_FOR_LOOP:
+      plx_generate_llvm_native_for_loop(node, gen);
+      break;
+    case PLX_NODE_CONTINUE:
+      LLVMBuildBr(gen->builder, gen->continue_block);
+      break;
+    case PLX_NODE_BREAK:
+      LLVMBuildBr(gen->builder, gen->break_block);
+      break;
+    case PLX_NODE_RETURN: {
+      const struct plx_node* const return_value = node->children;
+      if (return_value == NULL) {
+        LLVMBuildRetVoid(gen->builder);
+      } else {
+        LLVMBuildRet(gen->builder,
+                     plx_generate_llvm_native_expr(return_value, gen));
+      }
+      break;
+    }
+    case PLX_NODE_ASSIGN: {
+      const struct plx_node *assignee, *value;
+      plx_extract_children(node, &assignee, &value);
+
+      // Lanes are not addressable, so the whole vector is written back.
+      if (plx_is_llvm_native_lane(assignee)) {
+        const struct plx_node *vec, *index;
+        plx_extract_children(assignee, &vec, &index);
+        const LLVMValueRef vec_ptr = plx_generate_llvm_native_ptr(vec, gen);
+        const LLVMValueRef index_value =
+            plx_generate_llvm_native_expr(index, gen);
+        const LLVMValueRef lane_value =
+            plx_generate_llvm_native_expr(value, gen);
+        const LLVMValueRef vec_value = LLVMBuildLoad2(
+            gen->builder, plx_llvm_native_type(vec->type, gen->context),
+            vec_ptr, "");
+        LLVMBuildStore(gen->builder,
+                       LLVMBuildInsertElement(gen->builder, vec_value,
+                                              lane_value, index_value, ""),
+                       vec_ptr);
+        break;
+      }
+
+      const LLVMValueRef assignee_ptr =
+          plx_generate_llvm_native_ptr(assignee, gen);
+      LLVMBuildStore(gen->builder, plx_generate_llvm_native_expr(value, gen),
+                     assignee_ptr);
+      break;
+    }
+    case PLX_NODE_ADD_ASSIGN:
+    case PLX_NODE_SUB_ASSIGN:
+    case PLX_NODE_MUL_ASSIGN:
+    case PLX_NODE_DIV_ASSIGN:
+    case PLX_NODE_REM_ASSIGN:
+    case PLX_NODE_LSHIFT_ASSIGN:
+    case PLX_NODE_RSHIFT_ASSIGN: {
+      const struct plx_node *assignee, *value;
+      plx_extract_children(node, &assignee, &value);
+      assert(assignee->type->kind == value->type->kind);
+      const enum plx_node_kind op = plx_llvm_native_assign_op(node->kind);
+
+      // Lanes are not addressable, so the whole vector is written back.
+      if (plx_is_llvm_native_lane(assignee)) {
+        const struct plx_node *vec, *index;
+        plx_extract_children(assignee, &vec, &index);
+        const LLVMValueRef vec_ptr = plx_generate_llvm_native_ptr(vec, gen);
+        const LLVMValueRef index_value =
+            plx_generate_llvm_native_expr(index, gen);
+        const LLVMValueRef vec_value = LLVMBuildLoad2(
+            gen->builder, plx_llvm_native_type(vec->type, gen->context),
+            vec_ptr, "");
+        const LLVMValueRef left =
+            LLVMBuildExtractElement(gen->builder, vec_value, index_value, "");
+        const LLVMValueRef right = plx_generate_llvm_native_expr(value, gen);
+        const LLVMValueRef result = plx_generate_llvm_native_binary_op(
+            op, assignee->type, left, right, gen);
+        LLVMBuildStore(gen->builder,
+                       LLVMBuildInsertElement(gen->builder, vec_value, result,
+                                              index_value, ""),
+                       vec_ptr);
+        break;
+      }
+
+      const LLVMValueRef assignee_ptr =
+          plx_generate_llvm_native_ptr(assignee, gen);
+      const LLVMValueRef left = LLVMBuildLoad2(
+          gen->builder, plx_llvm_native_type(assignee->type, gen->context),
+          assignee_ptr, "");
+      const LLVMValueRef right = plx_generate_llvm_native_expr(value, gen);
+      LLVMBuildStore(gen->builder,
+                     plx_generate_llvm_native_binary_op(
+                         op, plx_lane_type(assignee->type), left, right, gen),
+                     assignee_ptr);
+      break;
+    }
+    case PLX_NODE_CALL:
+      plx_generate_llvm_native_expr(node, gen);
+      break;
+    default:
+      assert(false);
+  }
+}
+
+static LLVMValueRef plx_generate_llvm_native_expr(
+    const struct plx_node* const node,
+    struct plx_llvm_native_generator* const gen) {
+  switch (node->kind) {
+    case PLX_NODE_AND:
+    case PLX_NODE_OR:
+    case PLX_NODE_XOR:
+    case PLX_NODE_EQ:
+    case PLX_NODE_NEQ:
+    case PLX_NODE_LTE:
+    case PLX_NODE_LT:
+    case PLX_NODE_GTE:
+    case PLX_NODE_GT:
+    case PLX_NODE_ADD:
+    case PLX_NODE_SUB:
+    case PLX_NODE_MUL:
+    case PLX_NODE_DIV:
+    case PLX_NODE_REM:
+    case PLX_NODE_LSHIFT:
+    case PLX_NODE_RSHIFT: {
+      const struct plx_node *left, *right;
+      plx_extract_children(node, &left, &right);
+      assert(left->type->kind == right->type->kind);
+      const LLVMValueRef left_value = plx_generate_llvm_native_expr(left, gen);
+      const LLVMValueRef right_value =
+          plx_generate_llvm_native_expr(right, gen);
+      return plx_generate_llvm_native_binary_op(
+          node->kind, plx_lane_type(left->type), left_value, right_value, gen);
+    }
+    case PLX_NODE_NOT: {
+      const struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      return LLVMBuildNot(gen->builder,
+                          plx_generate_llvm_native_expr(operand, gen), "");
+    }
+    case PLX_NODE_NEG: {
+      const struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      const LLVMValueRef operand_value =
+          plx_generate_llvm_native_expr(operand, gen);
+      return plx_is_float_type(plx_lane_type(node->type))
+                 ? LLVMBuildFNeg(gen->builder, operand_value, "")
+                 : LLVMBuildNeg(gen->builder, operand_value, "");
+    }
+    case PLX_NODE_REF: {
+      const struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      return plx_generate_llvm_native_ptr(operand, gen);
+    }
+    case PLX_NODE_DEREF: {
+      const struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      return LLVMBuildLoad2(gen->builder,
+                            plx_llvm_native_type(node->type, gen->context),
+                            plx_generate_llvm_native_expr(operand, gen), "");
+    }
+    case PLX_NODE_CALL: {
+      const struct plx_node *callee, *args;
+      plx_extract_children(node, &callee, &args);
+      const LLVMValueRef callee_value =
+          plx_generate_llvm_native_expr(callee, gen);
+
+      unsigned int arg_count = 0;
+      for (const struct plx_node* arg = args->children; arg != NULL;
+           arg = arg->next) {
+        ++arg_count;
+      }
+      LLVMValueRef* const arg_values = malloc(arg_count * sizeof(LLVMValueRef));
+      if (plx_unlikely(arg_values == NULL && arg_count > 0)) plx_oom();
+      unsigned int arg_index = 0;
+      for (const struct plx_node* arg = args->children; arg != NULL;
+           arg = arg->next) {
+        arg_values[arg_index++] = plx_generate_llvm_native_expr(arg, gen);
+      }
+      const LLVMValueRef result = LLVMBuildCall2(
+          gen->builder, plx_llvm_native_func_type(callee->type, gen->context),
+          callee_value, arg_values, arg_count, "");
+      if (node->tail_call) LLVMSetTailCall(result, true);
+      free(arg_values);
+      return result;
+    }
+    case PLX_NODE_SELECT: {
+      const struct plx_node *mask, *left, *right;
+      plx_extract_children(node, &mask, &left, &right);
+      const LLVMValueRef mask_value = plx_generate_llvm_native_expr(mask, gen);
+      const LLVMValueRef left_value = plx_generate_llvm_native_expr(left, gen);
+      const LLVMValueRef right_value =
+          plx_generate_llvm_native_expr(right, gen);
+      return LLVMBuildSelect(gen->builder, mask_value, left_value, right_value,
+                             "");
+    }
+    case PLX_NODE_SHUFFLE: {
+      const struct plx_node *left, *right, *indices;
+      plx_extract_children(node, &left, &right, &indices);
+      const LLVMValueRef left_value = plx_generate_llvm_native_expr(left, gen);
+      const LLVMValueRef right_value =
+          plx_generate_llvm_native_expr(right, gen);
+      const LLVMTypeRef i32 = LLVMInt32TypeInContext(gen->context);
+      const unsigned int count = (unsigned int)plx_vec_len(node->type);
+      LLVMValueRef* const index_values = malloc(count * sizeof(LLVMValueRef));
+      if (plx_unlikely(index_values == NULL)) plx_oom();
+      unsigned int i = 0;
+      for (const struct plx_node* index = indices->children; index != NULL;
+           index = index->next) {
+        index_values[i++] = LLVMConstInt(i32, index->uint,
+                                         /*SignExtend=*/false);
+      }
+      const LLVMValueRef mask = LLVMConstVector(index_values, count);
+      free(index_values);
+      return LLVMBuildShuffleVector(gen->builder, left_value, right_value, mask,
+                                    "");
+    }
+    case PLX_NODE_REDUCE_ADD:
+    case PLX_NODE_REDUCE_MUL:
+    case PLX_NODE_REDUCE_MIN:
+    case PLX_NODE_REDUCE_MAX:
+    case PLX_NODE_REDUCE_AND:
+    case PLX_NODE_REDUCE_OR:
+    case PLX_NODE_REDUCE_XOR:
+      return plx_generate_llvm_native_reduce(node, gen);
+    case PLX_NODE_INDEX:
+      // Lanes are extracted from the vector value.
+      if (plx_is_llvm_native_lane(node)) {
+        const struct plx_node *vec, *index;
+        plx_extract_children(node, &vec, &index);
+        const LLVMValueRef vec_value = plx_generate_llvm_native_expr(vec, gen);
+        return LLVMBuildExtractElement(
+            gen->builder, vec_value, plx_generate_llvm_native_expr(index, gen),
+            "");
+      }
+      return LLVMBuildLoad2(gen->builder,
+                            plx_llvm_native_type(node->type, gen->context),
+                            plx_generate_llvm_native_ptr(node, gen), "");
+    case PLX_NODE_BOUNDS_CHECK:
+      return plx_generate_llvm_native_bounds_check(node, gen);
+    case PLX_NODE_SLICE:
+    case PLX_NODE_FIELD:
+      return LLVMBuildLoad2(gen->builder,
+                            plx_llvm_native_type(node->type, gen->context),
+                            plx_generate_llvm_native_ptr(node, gen), "");
+    case PLX_NODE_IDENTIFIER:
+      // Functions are called directly rather than through a pointer.
+      if (plx_is_llvm_native_func(node->entry)) return node->entry->llvm_value;
+      return LLVMBuildLoad2(gen->builder,
+                            plx_llvm_native_type(node->type, gen->context),
+                            node->entry->llvm_value, "");
+    case PLX_NODE_STRUCT:
+      assert(false);
+      break;
+    case PLX_NODE_S8:
+    case PLX_NODE_S16:
+    case PLX_NODE_S32:
+    case PLX_NODE_S64:
+    case PLX_NODE_U8:
+    case PLX_NODE_U16:
+    case PLX_NODE_U32:
+    case PLX_NODE_U64:
+    case PLX_NODE_F16:
+    case PLX_NODE_F32:
+    case PLX_NODE_F64:
+    case PLX_NODE_BOOL:
+      return plx_generate_llvm_native_constant(node, gen->context);
+    case PLX_NODE_STRING:
+      // TODO
+      assert(false);
+      break;
+    default:
+      assert(false);
+  }
+  return NULL;
+}
+
+// Declares the globals and functions of a module, so that they can be used
+// before they are defined.
+static void plx_generate_llvm_native_decl(
+    const struct plx_node* const node,
+    struct plx_llvm_native_generator* const gen) {
+  switch (node->kind) {
+    case PLX_NODE_CONST_DEF:
+    case PLX_NODE_VAR_DEF: {
+      const struct plx_node *name, *value;
+      plx_extract_children(node, &name, &value);
+      const LLVMValueRef global = LLVMAddGlobal(
+          gen->module, plx_llvm_native_type(value->type, gen->context),
+          name->name);
+      LLVMSetInitializer(
+          global, plx_generate_llvm_native_constant(value, gen->context));
+      if (node->kind == PLX_NODE_CONST_DEF) {
+        LLVMSetGlobalConstant(global, true);
+        LLVMSetUnnamedAddress(global, LLVMGlobalUnnamedAddr);
+      }
+      name->entry->llvm_value = global;
+      break;
+    }
+    case PLX_NODE_VAR_DECL: {
+      const struct plx_node *name, *type;
+      plx_extract_children(node, &name, &type);
+      const LLVMTypeRef llvm_type = plx_llvm_native_type(type, gen->context);
+      const LLVMValueRef global =
+          LLVMAddGlobal(gen->module, llvm_type, name->name);
+      LLVMSetInitializer(global, LLVMConstNull(llvm_type));
+      name->entry->llvm_value = global;
+      break;
+    }
+    case PLX_NODE_FUNC_DEF: {
+      const struct plx_node* const name = node->children;
+      name->entry->llvm_value = LLVMAddFunction(
+          gen->module, name->name,
+          plx_llvm_native_func_type(name->entry->type, gen->context));
+      if (node->inline_hint != PLX_INLINE_HINT_NONE) {
+        const char* const attr = node->inline_hint == PLX_INLINE_HINT_ALWAYS
+                                     ? "alwaysinline"
+                                     : "noinline";
+        LLVMAddAttributeAtIndex(
+            name->entry->llvm_value, LLVMAttributeFunctionIndex,
+            LLVMCreateEnumAttribute(
+                gen->context,
+                LLVMGetEnumAttributeKindForName(attr, strlen(attr)), 0));
+      }
+      break;
+    }
+    case PLX_NODE_STRUCT_DEF:
+      // TODO
+      break;
+    case PLX_NODE_NOP:
+      break;
+    default:
+      assert(false);
+  }
+}
+
+static void plx_generate_llvm_native_func(
+    const struct plx_node* const node,
+    struct plx_llvm_native_generator* const gen) {
+  const struct plx_node *name, *params, *return_type, *body;
+  plx_extract_children(node, &name, &params, &return_type, &body);
+  gen->func = name->entry->llvm_value;
+  LLVMPositionBuilderAtEnd(
+      gen->builder,
+      LLVMAppendBasicBlockInContext(gen->context, gen->func, "entry"));
+
+  // Parameters are spilled to the stack along with the local variables.
+  unsigned int param_index = 0;
+  for (const struct plx_node* param = params->children; param != NULL;
+       param = param->next) {
+    const struct plx_node *param_name, *param_type;
+    plx_extract_children(param, &param_name, &param_type);
+    const LLVMValueRef param_value = LLVMGetParam(gen->func, param_index++);
+    LLVMSetValueName2(param_value, param_name->name, strlen(param_name->name));
+    param_name->entry->llvm_value = LLVMBuildAlloca(
+        gen->builder, plx_llvm_native_type(param_type, gen->context), "");
+    LLVMBuildStore(gen->builder, param_value, param_name->entry->llvm_value);
+  }
+  plx_generate_llvm_native_allocas(body, gen);
+
+  plx_generate_llvm_native_stmt(body, gen);
+  if (!plx_llvm_native_terminated(gen)) {
+    if (return_type->kind == PLX_NODE_VOID_TYPE) {
+      LLVMBuildRetVoid(gen->builder);
+    } else {
+      LLVMBuildUnreachable(gen->builder);
+    }
+  }
+}
+
+// Returns the pass pipeline for an optimization level. Local variables are
+// always promoted to SSA values, even without optimizations.
+static const char* plx_llvm_native_passes(const enum plx_opt_level opt_level) {
+  switch (opt_level) {
+    case PLX_OPT_LEVEL_O0:
+      return "function(mem2reg)";
+    case PLX_OPT_LEVEL_O1:
+      return "default<O1>";
+    case PLX_OPT_LEVEL_O2:
+      return "default<O2>";
+    case PLX_OPT_LEVEL_O3:
+      return "default<O3>";
+    case PLX_OPT_LEVEL_OS:
+      return "default<Os>";
+  }
+  return "";
+}
+
+static LLVMCodeGenOptLevel plx_llvm_native_codegen_level(
+    const enum plx_opt_level opt_level) {
+  switch (opt_level) {
+    case PLX_OPT_LEVEL_O0:
+      return LLVMCodeGenLevelNone;
+    case PLX_OPT_LEVEL_O1:
+      return LLVMCodeGenLevelLess;
+    case PLX_OPT_LEVEL_O2:
+    case PLX_OPT_LEVEL_OS:
+      return LLVMCodeGenLevelDefault;
+    case PLX_OPT_LEVEL_O3:
+      return LLVMCodeGenLevelAggressive;
+  }
+  return LLVMCodeGenLevelDefault;
+}
+
+// Creates the target machine for the target triple and CPU in the options,
+// setting the module's target triple and data layout.
+static LLVMTargetMachineRef plx_llvm_native_target_machine(
+    const LLVMModuleRef module,
+    const struct plx_compile_options* const options) {
+  char* const triple = options->target != NULL
+                           ? LLVMNormalizeTargetTriple(options->target)
+                           : LLVMGetDefaultTargetTriple();
+  LLVMTargetRef target;
+  char* error = NULL;
+  if (LLVMGetTargetFromTriple(triple, &target, &error)) {
+    plx_error("%s", error);
+    LLVMDisposeMessage(error);
+    LLVMDisposeMessage(triple);
+    return NULL;
+  }
+
+  // The host's CPU is only used if it is asked for, so that the output runs on
+  // other machines by default.
+  const bool native_cpu =
+      options->cpu != NULL && strcmp(options->cpu, "native") == 0;
+  char* const cpu = native_cpu ? LLVMGetHostCPUName() : NULL;
+  char* const features = native_cpu ? LLVMGetHostCPUFeatures() : NULL;
+  const LLVMTargetMachineRef target_machine = LLVMCreateTargetMachine(
+      target, triple,
+      native_cpu ? cpu : options->cpu != NULL ? options->cpu : "generic",
+      native_cpu ? features : "",
+      plx_llvm_native_codegen_level(options->opt_level), LLVMRelocPIC,
+      LLVMCodeModelDefault);
+  LLVMDisposeMessage(cpu);
+  LLVMDisposeMessage(features);
+  LLVMSetTarget(module, triple);
+  LLVMDisposeMessage(triple);
+  const LLVMTargetDataRef data_layout =
+      LLVMCreateTargetDataLayout(target_machine);
+  LLVMSetModuleDataLayout(module, data_layout);
+  LLVMDisposeTargetData(data_layout);
+  return target_machine;
+}
+
+// Runs the pass pipeline on the module and writes it to a file.
+static bool plx_emit_llvm_native(
+    const LLVMModuleRef module, const char* const filename,
+    const enum plx_emit emit,
+    const struct plx_compile_options* const compile_options) {
+  if (compile_options->target != NULL) {
+    LLVMInitializeAllTargetInfos();
+    LLVMInitializeAllTargets();
+    LLVMInitializeAllTargetMCs();
+    LLVMInitializeAllAsmPrinters();
+  } else {
+    LLVMInitializeNativeTarget();
+    LLVMInitializeNativeAsmPrinter();
+  }
+  const LLVMTargetMachineRef target_machine =
+      plx_llvm_native_target_machine(module, compile_options);
+  if (target_machine == NULL) return false;
+
+  // The LLVM-C API cannot set fast-math flags on instructions, so fast-math is
+  // enabled with the function attributes that Clang's `-ffast-math` sets.
+  if (compile_options->fast_math) {
+    static const char* const attrs[] = {
+        "unsafe-fp-math",          "no-nans-fp-math",     "no-infs-fp-math",
+        "no-signed-zeros-fp-math", "approx-func-fp-math",
+    };
+    for (LLVMValueRef func = LLVMGetFirstFunction(module); func != NULL;
+         func = LLVMGetNextFunction(func)) {
+      for (size_t i = 0; i < sizeof(attrs) / sizeof(attrs[0]); ++i) {
+        LLVMAddTargetDependentFunctionAttr(func, attrs[i], "true");
+      }
+    }
+  }
+
+  // Run the pass pipeline.
+  bool result = true;
+  const LLVMPassBuilderOptionsRef options = LLVMCreatePassBuilderOptions();
+  const LLVMErrorRef pass_error = LLVMRunPasses(
+      module, plx_llvm_native_passes(compile_options->opt_level),
+      target_machine, options);
+  LLVMDisposePassBuilderOptions(options);
+  if (pass_error != NULL) {
+    char* const message = LLVMGetErrorMessage(pass_error);
+    plx_error("%s", message);
+    LLVMDisposeErrorMessage(message);
+    result = false;
+  }
+
+  // Write the output. Objects for link-time optimization hold bitcode. The
+  // filename is not modified despite not being declared const.
+  char* error = NULL;
+  if (result) {
+    switch (compile_options->lto != PLX_LTO_NONE && emit == PLX_EMIT_OBJ
+                ? PLX_EMIT_BC
+                : emit) {
+      case PLX_EMIT_LL:
+        if (LLVMPrintModuleToFile(module, filename, &error)) result = false;
+        break;
+      case PLX_EMIT_BC:
+        if (LLVMWriteBitcodeToFile(module, filename) != 0) result = false;
+        break;
+      case PLX_EMIT_ASM:
+      case PLX_EMIT_OBJ:
+      case PLX_EMIT_EXE:
+        if (LLVMTargetMachineEmitToFile(
+                target_machine, module, (char*)filename,
+                emit == PLX_EMIT_ASM ? LLVMAssemblyFile : LLVMObjectFile,
+                &error)) {
+          result = false;
+        }
+        break;
+    }
+    if (!result) {
+      plx_error("could not write file `%s`%s%s", filename,
+                error != NULL ? ": " : "", error != NULL ? error : "");
+      LLVMDisposeMessage(error);
+    }
+  }
+  LLVMDisposeTargetMachine(target_machine);
+  return result;
+}
+
+bool plx_generate_llvm_native(const struct plx_node* const node,
+                              const char* const filename,
+                              const enum plx_emit emit,
+                              const struct plx_compile_options* const options) {
+  assert(node->kind == PLX_NODE_MODULE);
+  struct plx_llvm_native_generator gen;
+  gen.context = LLVMContextCreate();
+  gen.module = LLVMModuleCreateWithNameInContext("plx", gen.context);
+  gen.builder = LLVMCreateBuilderInContext(gen.context);
+  gen.func = NULL;
+  gen.continue_block = NULL;
+  gen.break_block = NULL;
+
+  for (const struct plx_node* def = node->children; def != NULL;
+       def = def->next) {
+    plx_generate_llvm_native_decl(def, &gen);
+  }
+  for (const struct plx_node* def = node->children; def != NULL;
+       def = def->next) {
+    if (def->kind == PLX_NODE_FUNC_DEF) {
+      plx_generate_llvm_native_func(def, &gen);
+    }
+  }
+  LLVMDisposeBuilder(gen.builder);
+
+  bool result = true;
+#ifndef NDEBUG
+  char* error = NULL;
+  if (LLVMVerifyModule(gen.module, LLVMReturnStatusAction, &error)) {
+    plx_error("%s", error);
+    result = false;
+  }
+  LLVMDisposeMessage(error);
+#endif  // NDEBUG
+
+  if (result) {
+    result = plx_emit_llvm_native(gen.module, filename, emit, options);
+  }
+  LLVMDisposeModule(gen.module);
+  LLVMContextDispose(gen.context);
+  return result;
+}
+
+#endif  // PLX_HAVE_LLVM
@@ -0,0 +1,32 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_LLVM_NATIVE_GENERATOR_H
+#define PLX_LLVM_NATIVE_GENERATOR_H
+
+#include <stdbool.h>
+
+#include "ast.h"
+#include "compiler.h"
+
+// Generates a file from the abstract syntax tree in process using the LLVM-C
+// API, returning whether it succeeded. The output is LLVM IR, bitcode, assembly
+// or an object file (`PLX_EMIT_OBJ`), optimized and generated for the target in
+// the options. Only available if the compiler was built with LLVM
+// (`PLX_HAVE_LLVM`).
+bool plx_generate_llvm_native(const struct plx_node* node, const char* filename,
+                              enum plx_emit emit,
+                              const struct plx_compile_options* options);
+
+#endif  // PLX_LLVM_NATIVE_GENERATOR_H
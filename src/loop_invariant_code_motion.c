@@ -0,0 +1,502 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "loop_invariant_code_motion.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "error.h"
+#include "macros.h"
+#include "symbol_table.h"
+#include "symbol_table_entry.h"
+#include "types.h"
+
+struct plx_loop_hoister {
+  FILE* report;
+
+  // Variables that the current loop defines or assigns.
+  size_t var_len;
+  size_t var_cap;
+  const struct plx_symbol_table_entry** vars;
+
+  // Local variables of the current function that a reference or slice may
+  // point into.
+  size_t escaped_len;
+  size_t escaped_cap;
+  const struct plx_symbol_table_entry** escaped;
+
+  // Whether the current loop may write memory that may be aliased, through a
+  // store or a call.
+  bool writes_memory;
+
+  // Number of expressions hoisted out of the loops of the current function.
+  size_t hoisted;
+};
+
+// Name of the temporaries, which are only referred to through their entries.
+static char plx_temp_name[] = "$licm";
+
+// Records that a reference or slice may point into a local variable.
+static void plx_add_escaped_var(
+    struct plx_loop_hoister* const hoister,
+    const struct plx_symbol_table_entry* const entry) {
+  if (hoister->escaped_len == hoister->escaped_cap) {
+    const size_t cap =
+        hoister->escaped_cap == 0 ? 8 : hoister->escaped_cap * 2;
+    const struct plx_symbol_table_entry** const escaped =
+        realloc(hoister->escaped, cap * sizeof(*escaped));
+    if (plx_unlikely(escaped == NULL)) plx_oom();
+    hoister->escaped_cap = cap;
+    hoister->escaped = escaped;
+  }
+  hoister->escaped[hoister->escaped_len++] = entry;
+}
+
+// Collects the local variables that references and slices may point into.
+// Taking the address of an element or field does not mark the variable as
+// referenced.
+static void plx_collect_escaped_vars(struct plx_loop_hoister* const hoister,
+                                     const struct plx_node* const node) {
+  if (node->kind == PLX_NODE_REF || node->kind == PLX_NODE_SLICE) {
+    const struct plx_node* root = node->children;
+    while (root->kind == PLX_NODE_INDEX || root->kind == PLX_NODE_FIELD) {
+      root = root->children;
+    }
+    if (root->kind == PLX_NODE_IDENTIFIER && root->entry != NULL &&
+        root->entry->scope == PLX_SYMBOL_SCOPE_LOCAL) {
+      plx_add_escaped_var(hoister, root->entry);
+    }
+  }
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    plx_collect_escaped_vars(hoister, child);
+  }
+}
+
+// Returns whether a variable lives in memory that may be aliased.
+static bool plx_is_aliased_var(
+    const struct plx_loop_hoister* const hoister,
+    const struct plx_symbol_table_entry* const entry) {
+  if (entry->mutability == PLX_SYMBOL_MUTABILITY_CONST) return false;
+  if (entry->scope == PLX_SYMBOL_SCOPE_GLOBAL || entry->referenced) {
+    return true;
+  }
+  for (size_t i = 0; i < hoister->escaped_len; ++i) {
+    if (hoister->escaped[i] == entry) return true;
+  }
+  return false;
+}
+
+// Returns whether indexing or accessing a field of a value reads or writes
+// memory that it points to rather than the value itself.
+static bool plx_points_to_memory(const struct plx_node* const value) {
+  return value->type == NULL || value->type->kind == PLX_NODE_SLICE_TYPE ||
+         value->type->kind == PLX_NODE_REF_TYPE;
+}
+
+// Records that the current loop defines or assigns a variable.
+static void plx_add_loop_var(struct plx_loop_hoister* const hoister,
+                             const struct plx_symbol_table_entry* const entry) {
+  if (hoister->var_len == hoister->var_cap) {
+    const size_t cap = hoister->var_cap == 0 ? 16 : hoister->var_cap * 2;
+    const struct plx_symbol_table_entry** const vars =
+        realloc(hoister->vars, cap * sizeof(*vars));
+    if (plx_unlikely(vars == NULL)) plx_oom();
+    hoister->var_cap = cap;
+    hoister->vars = vars;
+  }
+  hoister->vars[hoister->var_len++] = entry;
+}
+
+// Records the store of an assignment to an assignee.
+static void plx_add_store(struct plx_loop_hoister* const hoister,
+                          const struct plx_node* const assignee) {
+  switch (assignee->kind) {
+    case PLX_NODE_IDENTIFIER:
+      plx_add_loop_var(hoister, assignee->entry);
+      if (plx_is_aliased_var(hoister, assignee->entry)) {
+        hoister->writes_memory = true;
+      }
+      break;
+    case PLX_NODE_INDEX:
+    case PLX_NODE_FIELD:
+      if (!plx_points_to_memory(assignee->children)) {
+        plx_add_store(hoister, assignee->children);
+        break;
+      }
+      hoister->writes_memory = true;
+      break;
+    default:
+      hoister->writes_memory = true;
+  }
+}
+
+// Collects the variables that a loop defines or assigns and whether it may
+// write memory.
+static void plx_collect_loop_effects(struct plx_loop_hoister* const hoister,
+                                     const struct plx_node* const node) {
+  switch (node->kind) {
+    case PLX_NODE_CONST_DEF:
+    case PLX_NODE_VAR_DEF:
+    case PLX_NODE_VAR_DECL:
+    case PLX_NODE_FOR_LOOP:
+      plx_add_loop_var(hoister, node->children->entry);
+      break;
+    case PLX_NODE_ASSIGN:
+    case PLX_NODE_ADD_ASSIGN:
+    case PLX_NODE_SUB_ASSIGN:
+    case PLX_NODE_MUL_ASSIGN:
+    case PLX_NODE_DIV_ASSIGN:
+    case PLX_NODE_REM_ASSIGN:
+    case PLX_NODE_LSHIFT_ASSIGN:
+    case PLX_NODE_RSHIFT_ASSIGN:
+      plx_add_store(hoister, node->children);
+      break;
+    case PLX_NODE_CALL:
+      hoister->writes_memory = true;
+      break;
+    default:
+      break;
+  }
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    plx_collect_loop_effects(hoister, child);
+  }
+}
+
+// Returns whether an expression has the same value on every iteration of the
+// current loop.
+static bool plx_is_invariant(const struct plx_loop_hoister* const hoister,
+                             const struct plx_node* const node) {
+  switch (node->kind) {
+    case PLX_NODE_IDENTIFIER:
+      if (node->entry == NULL) return true;
+      for (size_t i = 0; i < hoister->var_len; ++i) {
+        if (hoister->vars[i] == node->entry) return false;
+      }
+      return !hoister->writes_memory ||
+             !plx_is_aliased_var(hoister, node->entry);
+    case PLX_NODE_DEREF:
+      if (hoister->writes_memory) return false;
+      break;
+    case PLX_NODE_INDEX:
+    case PLX_NODE_FIELD:
+      if (hoister->writes_memory && plx_points_to_memory(node->children)) {
+        return false;
+      }
+      break;
+    default:
+      break;
+  }
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    if (!plx_is_invariant(hoister, child)) return false;
+  }
+  return true;
+}
+
+// Returns whether an integer constant is zero or minus one, the divisors that
+// trap or overflow.
+static bool plx_is_trapping_divisor(const struct plx_node* const divisor) {
+  switch (divisor->kind) {
+    case PLX_NODE_S8:
+    case PLX_NODE_S16:
+    case PLX_NODE_S32:
+    case PLX_NODE_S64:
+      return divisor->sint == 0 || divisor->sint == -1;
+    case PLX_NODE_U8:
+    case PLX_NODE_U16:
+    case PLX_NODE_U32:
+    case PLX_NODE_U64:
+      return divisor->uint == 0;
+    default:
+      return true;
+  }
+}
+
+// Returns whether an expression may be evaluated where the loop would not have
+// evaluated it: it has no side effects and cannot trap or read out of bounds.
+static bool plx_is_speculatable(const struct plx_node* const node) {
+  switch (node->kind) {
+    case PLX_NODE_IDENTIFIER:
+    case PLX_NODE_S8:
+    case PLX_NODE_S16:
+    case PLX_NODE_S32:
+    case PLX_NODE_S64:
+    case PLX_NODE_U8:
+    case PLX_NODE_U16:
+    case PLX_NODE_U32:
+    case PLX_NODE_U64:
+    case PLX_NODE_F16:
+    case PLX_NODE_F32:
+    case PLX_NODE_F64:
+    case PLX_NODE_BOOL:
+      return true;
+    case PLX_NODE_DIV:
+    case PLX_NODE_REM:
+      if (!plx_is_float_type(plx_lane_type(node->type)) &&
+          plx_is_trapping_divisor(node->children->next)) {
+        return false;
+      }
+      break;
+    case PLX_NODE_INDEX: {
+      // Only constant indices are known to be in bounds.
+      const struct plx_node* const value = node->children;
+      const struct plx_node* const index = value->next;
+      if (value->type == NULL || index->kind == PLX_NODE_BOUNDS_CHECK) {
+        return false;
+      }
+      unsigned long long len;
+      if (value->type->kind == PLX_NODE_ARRAY_TYPE) {
+        len = value->type->children->uint;
+      } else if (plx_is_vec_type(value->type)) {
+        len = plx_vec_len(value->type);
+      } else {
+        return false;
+      }
+      if (!plx_is_constant(index) || index->kind == PLX_NODE_STRING ||
+          index->uint >= len) {
+        return false;
+      }
+      break;
+    }
+    case PLX_NODE_AND:
+    case PLX_NODE_OR:
+    case PLX_NODE_XOR:
+    case PLX_NODE_EQ:
+    case PLX_NODE_NEQ:
+    case PLX_NODE_LTE:
+    case PLX_NODE_LT:
+    case PLX_NODE_GTE:
+    case PLX_NODE_GT:
+    case PLX_NODE_ADD:
+    case PLX_NODE_SUB:
+    case PLX_NODE_MUL:
+    case PLX_NODE_LSHIFT:
+    case PLX_NODE_RSHIFT:
+    case PLX_NODE_NOT:
+    case PLX_NODE_NEG:
+    case PLX_NODE_SELECT:
+    case PLX_NODE_SHUFFLE:
+    case PLX_NODE_REDUCE_ADD:
+    case PLX_NODE_REDUCE_MUL:
+    case PLX_NODE_REDUCE_MIN:
+    case PLX_NODE_REDUCE_MAX:
+    case PLX_NODE_REDUCE_AND:
+    case PLX_NODE_REDUCE_OR:
+    case PLX_NODE_REDUCE_XOR:
+      break;
+    default:
+      return false;
+  }
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    if (!plx_is_speculatable(child)) return false;
+  }
+  return true;
+}
+
+// Returns whether an expression may be hoisted out of the current loop.
+// Constants and variables that are not in memory are as cheap as the
+// temporary, and aggregates would be copied.
+static bool plx_is_hoistable(const struct plx_loop_hoister* const hoister,
+                             const struct plx_node* const node) {
+  if (node->type == NULL ||
+      !(plx_is_scalar_type(node->type) || plx_is_vec_type(node->type))) {
+    return false;
+  }
+  if (node->kind == PLX_NODE_IDENTIFIER) {
+    return node->entry != NULL && plx_is_aliased_var(hoister, node->entry) &&
+           plx_is_invariant(hoister, node);
+  }
+  return !plx_is_constant(node) && plx_is_speculatable(node) &&
+         plx_is_invariant(hoister, node);
+}
+
+// Moves an expression into a temporary defined before a loop in a block, and
+// replaces it with the temporary.
+static void plx_hoist_expr(struct plx_loop_hoister* const hoister,
+                           struct plx_node* const node,
+                           struct plx_node* const loop,
+                           struct plx_node* const block) {
+  struct plx_node* const value = plx_new_node(node->kind, /*loc=*/NULL);
+  *value = *node;
+  value->next = NULL;
+
+  struct plx_symbol_table symbol_table = PLX_SYMBOL_TABLE_INIT;
+  struct plx_symbol_table_entry* const temp =
+      plx_declare_symbol(&symbol_table, plx_temp_name);
+  temp->decl = &value->loc;
+  temp->type = value->type;
+
+  struct plx_node* const name = plx_new_node(PLX_NODE_IDENTIFIER, &node->loc);
+  name->name = plx_temp_name;
+  name->entry = temp;
+  name->type = temp->type;
+  name->next = value;
+  struct plx_node* const def = plx_new_node(PLX_NODE_VAR_DEF, &node->loc);
+  def->children = name;
+  struct plx_node** link = &block->children;
+  while (*link != loop) link = &(*link)->next;
+  def->next = loop;
+  *link = def;
+
+  node->kind = PLX_NODE_IDENTIFIER;
+  node->name = plx_temp_name;
+  node->entry = temp;
+  node->children = NULL;
+  ++hoister->hoisted;
+}
+
+static void plx_hoist_in_assignee(struct plx_loop_hoister* hoister,
+                                  struct plx_node* assignee,
+                                  struct plx_node* loop,
+                                  struct plx_node* block);
+
+// Hoists the largest invariant expressions within a node of a loop.
+static void plx_hoist_in_node(struct plx_loop_hoister* const hoister,
+                              struct plx_node* const node,
+                              struct plx_node* const loop,
+                              struct plx_node* const block) {
+  if (plx_is_hoistable(hoister, node)) {
+    plx_hoist_expr(hoister, node, loop, block);
+    return;
+  }
+  switch (node->kind) {
+    case PLX_NODE_ASSIGN:
+    case PLX_NODE_ADD_ASSIGN:
+    case PLX_NODE_SUB_ASSIGN:
+    case PLX_NODE_MUL_ASSIGN:
+    case PLX_NODE_DIV_ASSIGN:
+    case PLX_NODE_REM_ASSIGN:
+    case PLX_NODE_LSHIFT_ASSIGN:
+    case PLX_NODE_RSHIFT_ASSIGN:
+    case PLX_NODE_REF:
+      // The assignee and the operand of a reference stay places.
+      plx_hoist_in_assignee(hoister, node->children, loop, block);
+      if (node->children->next != NULL) {
+        plx_hoist_in_node(hoister, node->children->next, loop, block);
+      }
+      break;
+    default:
+      for (struct plx_node* child = node->children; child != NULL;
+           child = child->next) {
+        plx_hoist_in_node(hoister, child, loop, block);
+      }
+  }
+}
+
+// Hoists the invariant expressions that an assignee evaluates to find its
+// place.
+static void plx_hoist_in_assignee(struct plx_loop_hoister* const hoister,
+                                  struct plx_node* const assignee,
+                                  struct plx_node* const loop,
+                                  struct plx_node* const block) {
+  switch (assignee->kind) {
+    case PLX_NODE_IDENTIFIER:
+      break;
+    case PLX_NODE_INDEX:
+    case PLX_NODE_FIELD:
+      if (plx_points_to_memory(assignee->children)) {
+        plx_hoist_in_node(hoister, assignee->children, loop, block);
+      } else {
+        plx_hoist_in_assignee(hoister, assignee->children, loop, block);
+      }
+      for (struct plx_node* child = assignee->children->next; child != NULL;
+           child = child->next) {
+        plx_hoist_in_node(hoister, child, loop, block);
+      }
+      break;
+    default:
+      for (struct plx_node* child = assignee->children; child != NULL;
+           child = child->next) {
+        plx_hoist_in_node(hoister, child, loop, block);
+      }
+  }
+}
+
+// Hoists the invariant expressions out of a loop in a block. The range or
+// array of a `for` loop is only evaluated once.
+static void plx_hoist_loop(struct plx_loop_hoister* const hoister,
+                           struct plx_node* const loop,
+                           struct plx_node* const block) {
+  struct plx_node* body = loop->children;
+  if (loop->kind == PLX_NODE_FOR_LOOP) {
+    body = body->next->next;
+  } else if (loop->kind == PLX_NODE_WHILE_LOOP) {
+    body = body->next;
+  }
+  hoister->var_len = 0;
+  hoister->writes_memory = false;
+  plx_collect_loop_effects(hoister, loop);
+  if (loop->kind == PLX_NODE_WHILE_LOOP) {
+    plx_hoist_in_node(hoister, loop->children, loop, block);
+  }
+  plx_hoist_in_node(hoister, body, loop, block);
+}
+
+// Hoists the invariant expressions out of the loops in a statement, inner
+// loops first, so that what they hoist may be hoisted further. A loop is only
+// hoisted out of if it is part of a block, which holds the temporaries.
+static void plx_hoist_in_stmt(struct plx_loop_hoister* const hoister,
+                              struct plx_node* const node,
+                              struct plx_node* const block) {
+  switch (node->kind) {
+    case PLX_NODE_BLOCK:
+      for (struct plx_node* stmt = node->children; stmt != NULL;
+           stmt = stmt->next) {
+        plx_hoist_in_stmt(hoister, stmt, node);
+      }
+      break;
+    case PLX_NODE_IF_THEN_ELSE: {
+      struct plx_node *cond, *then, *els;
+      plx_extract_children(node, &cond, &then, &els);
+      plx_hoist_in_stmt(hoister, then, NULL);
+      if (els != NULL) plx_hoist_in_stmt(hoister, els, NULL);
+      break;
+    }
+    case PLX_NODE_LOOP:
+    case PLX_NODE_WHILE_LOOP:
+    case PLX_NODE_FOR_LOOP: {
+      struct plx_node* body = node->children;
+      while (body->next != NULL) body = body->next;
+      plx_hoist_in_stmt(hoister, body, NULL);
+      if (block != NULL) plx_hoist_loop(hoister, node, block);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+void plx_hoist_loop_invariants(struct plx_node* const module,
+                               FILE* const report) {
+  struct plx_loop_hoister hoister = {report, 0, 0, NULL, 0, 0, NULL, false, 0};
+  for (struct plx_node* def = module->children; def != NULL; def = def->next) {
+    if (def->kind != PLX_NODE_FUNC_DEF) continue;
+    struct plx_node *name, *params, *return_type, *body;
+    plx_extract_children(def, &name, &params, &return_type, &body);
+    hoister.escaped_len = 0;
+    hoister.hoisted = 0;
+    plx_collect_escaped_vars(&hoister, body);
+    plx_hoist_in_stmt(&hoister, body, NULL);
+    if (report != NULL && hoister.hoisted > 0) {
+      fprintf(report, "%s: %zu loop-invariant expressions hoisted\n",
+              name->name, hoister.hoisted);
+    }
+  }
+  free(hoister.vars);
+  free(hoister.escaped);
+}
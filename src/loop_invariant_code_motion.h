@@ -0,0 +1,32 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_LOOP_INVARIANT_CODE_MOTION_H
+#define PLX_LOOP_INVARIANT_CODE_MOTION_H
+
+#include <stdio.h>
+
+#include "ast.h"
+
+// Hoists the expressions in loops that compute the same value on every
+// iteration into temporary variables defined before the loops, inner loops
+// first. An expression is hoisted if its variables are neither defined nor
+// assigned in the loop, it reads no memory that the loop may write through a
+// store or call, and evaluating it cannot trap even if the loop would not have
+// evaluated it. Equal hoisted expressions are left for common subexpression
+// elimination to merge. The number of expressions that were hoisted out of
+// the loops of each function is written to `report` unless it is `NULL`.
+void plx_hoist_loop_invariants(struct plx_node* module, FILE* report);
+
+#endif  // PLX_LOOP_INVARIANT_CODE_MOTION_H
@@ -12,12 +12,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "clang.h"
 #include "compiler.h"
 #include "error.h"
+#include "macros.h"
+#include "object_cache.h"
+#include "path.h"
 
 static void plx_version(void) { fputs("Programming Language X v1\n", stderr); }
 
@@ -25,15 +32,123 @@ static void plx_usage(const char* const prog) {
   fprintf(stderr,
           "Usage: %s [-h | --help] [-v | --version] [path] [-o <path> | "
           "--output <path>] [-d | --debug] [-b <back-end> | --back-end "
-          "<back-end>]\n",
-          prog);
+          "<back-end>] [--emit ll|bc|asm|obj|exe] [-O0 | -O1 | -O2 | -O3 | "
+          "-Os] [--target <triple>] [--cpu <cpu> | --cpu native] [--lto=thin "
+          "| --lto=full] [--fast-math] [--profile-generate | "
+          "--profile-use=<path>] [--codegen-units <n>] [--cache-dir <path> | "
+          "--no-cache] [--cache-size <MiB>] "
+          "[--bounds-checks=off|on|elided] [--report-bounds-checks] "
+          "[--report-inlining] [--report-licm] [--report-cse] "
+          "[--report-dead-code] [--dump-call-graph=dot|json] [--time-passes]\n"
+          "       %s run [--interp | --disassemble] [--time] "
+          "[--bounds-checks=off|on|elided] [path] [arg]...\n"
+          "       %s profile-merge [-o <path> | --output <path>] <path>...\n",
+          prog, prog, prog);
+}
+
+// Merges raw profiles into the profile given to `--profile-use`.
+static int plx_profile_merge(const int argc, const char* argv[]) {
+  const char* output_filename = "default.profdata";
+  const char** const input_filenames =
+      malloc((size_t)(argc + 1) * sizeof(*input_filenames));
+  if (plx_unlikely(input_filenames == NULL)) plx_oom();
+  size_t count = 0;
+  for (int i = 0; i < argc; ++i) {
+    const char* const arg = argv[i];
+    if ((strcmp(arg, "-o") == 0 || strcmp(arg, "--output") == 0) &&
+        i + 1 < argc) {
+      output_filename = argv[++i];
+    } else if (arg[0] == '-') {
+      plx_error("unexpected argument `%s`", arg);
+      free(input_filenames);
+      return EXIT_FAILURE;
+    } else {
+      input_filenames[count++] = arg;
+    }
+  }
+  bool result = count > 0;
+  if (!result) plx_error("no profiles to merge");
+  if (result) {
+    result = plx_merge_profiles(output_filename, input_filenames, count);
+  }
+  free(input_filenames);
+  return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Parses the value of `--bounds-checks=`, returning whether it is valid.
+static bool plx_parse_bounds_checks(const char* const s,
+                                    enum plx_bounds_checks* const mode) {
+  if (strcmp(s, "off") == 0) {
+    *mode = PLX_BOUNDS_CHECKS_OFF;
+  } else if (strcmp(s, "on") == 0) {
+    *mode = PLX_BOUNDS_CHECKS_ON;
+  } else if (strcmp(s, "elided") == 0) {
+    *mode = PLX_BOUNDS_CHECKS_ELIDED;
+  } else {
+    plx_error("unknown bounds checks `%s`", s);
+    return false;
+  }
+  return true;
+}
+
+// Compiles a program in memory and runs it, passing it the remaining
+// arguments. The program's directory is its first argument.
+static int plx_run_command(const int argc, const char* argv[]) {
+  struct plx_run_options options = {0};
+  int i = 0;
+  for (; i < argc && argv[i][0] == '-'; ++i) {
+    if (strcmp(argv[i], "--interp") == 0) {
+      options.interpret = true;
+    } else if (strcmp(argv[i], "--disassemble") == 0) {
+      options.interpret = true;
+      options.disassemble = true;
+    } else if (strcmp(argv[i], "--time") == 0) {
+      options.print_latency = true;
+    } else if (strncmp(argv[i], "--bounds-checks=", 16) == 0) {
+      if (!plx_parse_bounds_checks(argv[i] + 16, &options.bounds_checks)) {
+        return EXIT_FAILURE;
+      }
+    } else {
+      plx_error("unexpected argument `%s`", argv[i]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The directory defaults to the current one.
+  static const char* const default_argv[] = {".", NULL};
+  const char* const* run_argv = argv + i;
+  int run_argc = argc - i;
+  if (run_argc == 0) {
+    run_argv = default_argv;
+    run_argc = 1;
+  }
+  int exit_code;
+  return plx_run(run_argv[0], run_argc, run_argv, &options, &exit_code)
+             ? exit_code
+             : EXIT_FAILURE;
 }
 
 int main(const int argc, const char* argv[]) {
+  if (argc > 1 && strcmp(argv[1], "run") == 0) {
+    return plx_run_command(argc - 2, argv + 2);
+  }
+  if (argc > 1 && strcmp(argv[1], "profile-merge") == 0) {
+    return plx_profile_merge(argc - 2, argv + 2);
+  }
+
   const char* input_dir = NULL;
   const char* output_dir = ".";
-  enum plx_compile_mode mode = PLX_COMPILE_MODE_RELEASE;
-  enum plx_back_end back_end = PLX_BACK_END_LLVM;
+  struct plx_compile_options options = {
+      .mode = PLX_COMPILE_MODE_RELEASE,
+      .back_end = PLX_BACK_END_LLVM,
+      .emit = PLX_EMIT_EXE,
+      .opt_level = PLX_OPT_LEVEL_O3,
+      .cache_max_size = 1024ull * 1024 * 1024,
+  };
+  bool opt_level_set = false;
+  bool bounds_checks_set = false;
+  bool use_cache = true;
+  char cache_dir[PLX_PATH_MAX];
   for (int i = 1; i < argc; ++i) {
     const char* const arg = argv[i];
     if (strcmp(arg, "-v") == 0 || strcmp(arg, "--version") == 0) {
@@ -50,22 +165,160 @@ int main(const int argc, const char* argv[]) {
       continue;
     }
     if (strcmp(arg, "-d") == 0 || strcmp(arg, "--debug") == 0) {
-      mode = PLX_COMPILE_MODE_DEBUG;
+      options.mode = PLX_COMPILE_MODE_DEBUG;
       continue;
     }
     if ((strcmp(arg, "-b") == 0 || strcmp(arg, "--back-end") == 0) &&
         i + 1 < argc) {
       const char* const s = argv[++i];
       if (strcmp(s, "llvm") == 0) {
-        back_end = PLX_BACK_END_LLVM;
+        options.back_end = PLX_BACK_END_LLVM;
+      } else if (strcmp(s, "llvm-native") == 0) {
+#ifdef PLX_HAVE_LLVM
+        options.back_end = PLX_BACK_END_LLVM_NATIVE;
+#else
+        plx_error("back end `%s` requires the compiler to be built with LLVM",
+                  s);
+        return EXIT_FAILURE;
+#endif  // PLX_HAVE_LLVM
       } else if (strcmp(s, "wasm") == 0) {
-        back_end = PLX_BACK_END_WASM;
+        options.back_end = PLX_BACK_END_WASM;
+      } else if (strcmp(s, "x86_64") == 0) {
+        options.back_end = PLX_BACK_END_X86_64;
       } else {
         plx_error("unknown back end `%s`", s);
         return EXIT_FAILURE;
       }
       continue;
     }
+    if (strcmp(arg, "--emit") == 0 && i + 1 < argc) {
+      const char* const s = argv[++i];
+      if (strcmp(s, "ll") == 0) {
+        options.emit = PLX_EMIT_LL;
+      } else if (strcmp(s, "bc") == 0) {
+        options.emit = PLX_EMIT_BC;
+      } else if (strcmp(s, "asm") == 0) {
+        options.emit = PLX_EMIT_ASM;
+      } else if (strcmp(s, "obj") == 0) {
+        options.emit = PLX_EMIT_OBJ;
+      } else if (strcmp(s, "exe") == 0) {
+        options.emit = PLX_EMIT_EXE;
+      } else {
+        plx_error("unknown output `%s`", s);
+        return EXIT_FAILURE;
+      }
+      continue;
+    }
+    if (strcmp(arg, "-O0") == 0 || strcmp(arg, "-O1") == 0 ||
+        strcmp(arg, "-O2") == 0 || strcmp(arg, "-O3") == 0 ||
+        strcmp(arg, "-Os") == 0) {
+      options.opt_level = arg[2] == 's'
+                              ? PLX_OPT_LEVEL_OS
+                              : (enum plx_opt_level)(arg[2] - '0');
+      opt_level_set = true;
+      continue;
+    }
+    if (strcmp(arg, "--target") == 0 && i + 1 < argc) {
+      options.target = argv[++i];
+      continue;
+    }
+    if (strcmp(arg, "--cpu") == 0 && i + 1 < argc) {
+      options.cpu = argv[++i];
+      continue;
+    }
+    if (strcmp(arg, "--lto=thin") == 0) {
+      options.lto = PLX_LTO_THIN;
+      continue;
+    }
+    if (strcmp(arg, "--lto=full") == 0) {
+      options.lto = PLX_LTO_FULL;
+      continue;
+    }
+    if (strcmp(arg, "--fast-math") == 0) {
+      options.fast_math = true;
+      continue;
+    }
+    if (strcmp(arg, "--profile-generate") == 0) {
+      options.profile_generate = true;
+      continue;
+    }
+    if (strcmp(arg, "--codegen-units") == 0 && i + 1 < argc) {
+      char* end;
+      const unsigned long units = strtoul(argv[++i], &end, 10);
+      if (*end != '\0' || units == 0 || units > UINT_MAX) {
+        plx_error("invalid number of codegen units `%s`", argv[i]);
+        return EXIT_FAILURE;
+      }
+      options.codegen_units = (unsigned int)units;
+      continue;
+    }
+    if (strcmp(arg, "--cache-dir") == 0 && i + 1 < argc) {
+      options.cache_dir = argv[++i];
+      continue;
+    }
+    if (strcmp(arg, "--no-cache") == 0) {
+      use_cache = false;
+      continue;
+    }
+    if (strcmp(arg, "--cache-size") == 0 && i + 1 < argc) {
+      // The size in bytes must fit in a `size_t`. `strtoull` would accept
+      // leading spaces and a sign, and saturates on overflow.
+      const char* const s = argv[++i];
+      char* end;
+      const unsigned long long size = strtoull(s, &end, 10);
+      if (s[0] < '0' || s[0] > '9' || *end != '\0' || size == 0 ||
+          size > SIZE_MAX >> 20) {
+        plx_error("invalid cache size `%s`, expected 1 to %zu MiB", s,
+                  (size_t)(SIZE_MAX >> 20));
+        plx_usage(argv[0]);
+        return EXIT_FAILURE;
+      }
+      options.cache_max_size = size << 20;
+      continue;
+    }
+    if (strncmp(arg, "--profile-use=", 14) == 0) {
+      options.profile_use = arg + 14;
+      continue;
+    }
+    if (strncmp(arg, "--bounds-checks=", 16) == 0) {
+      if (!plx_parse_bounds_checks(arg + 16, &options.bounds_checks)) {
+        return EXIT_FAILURE;
+      }
+      bounds_checks_set = true;
+      continue;
+    }
+    if (strcmp(arg, "--report-bounds-checks") == 0) {
+      options.report_bounds_checks = true;
+      continue;
+    }
+    if (strcmp(arg, "--report-inlining") == 0) {
+      options.report_inlining = true;
+      continue;
+    }
+    if (strcmp(arg, "--report-licm") == 0) {
+      options.report_loop_invariants = true;
+      continue;
+    }
+    if (strcmp(arg, "--report-cse") == 0) {
+      options.report_common_subexprs = true;
+      continue;
+    }
+    if (strcmp(arg, "--report-dead-code") == 0) {
+      options.report_dead_code = true;
+      continue;
+    }
+    if (strcmp(arg, "--dump-call-graph=dot") == 0) {
+      options.dump_call_graph = PLX_CALL_GRAPH_FORMAT_DOT;
+      continue;
+    }
+    if (strcmp(arg, "--dump-call-graph=json") == 0) {
+      options.dump_call_graph = PLX_CALL_GRAPH_FORMAT_JSON;
+      continue;
+    }
+    if (strcmp(arg, "--time-passes") == 0) {
+      options.time_passes = true;
+      continue;
+    }
     if (arg[0] == '-' || input_dir != NULL) {
       plx_error("unexpected argument `%s`", arg);
       return EXIT_FAILURE;
@@ -73,6 +326,27 @@ int main(const int argc, const char* argv[]) {
     input_dir = argv[i];
   }
   input_dir = input_dir != NULL ? input_dir : ".";
-  return plx_compile(input_dir, output_dir, mode, back_end) ? EXIT_SUCCESS
-                                                            : EXIT_FAILURE;
+  if (options.profile_generate && options.profile_use != NULL) {
+    plx_error("`--profile-generate` and `--profile-use` cannot be combined");
+    return EXIT_FAILURE;
+  }
+
+  // Clang's outputs are cached unless there is nowhere to cache them.
+  if (!use_cache) {
+    options.cache_dir = NULL;
+  } else if (options.cache_dir == NULL &&
+             plx_object_cache_default_dir(cache_dir, sizeof(cache_dir))) {
+    options.cache_dir = cache_dir;
+  }
+
+  // Debug builds are unoptimized unless an optimization level is given, and
+  // check every index unless told otherwise.
+  if (options.mode == PLX_COMPILE_MODE_DEBUG && !opt_level_set) {
+    options.opt_level = PLX_OPT_LEVEL_O0;
+  }
+  if (options.mode == PLX_COMPILE_MODE_DEBUG && !bounds_checks_set) {
+    options.bounds_checks = PLX_BOUNDS_CHECKS_ON;
+  }
+  return plx_compile(input_dir, output_dir, &options) ? EXIT_SUCCESS
+                                                      : EXIT_FAILURE;
 }
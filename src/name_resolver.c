@@ -83,6 +83,9 @@ bool plx_resolve_names(struct plx_node* const node,
       plx_extract_children(node, &name, &value_or_type);
       if (!plx_resolve_names(value_or_type, symbol_table)) result = false;
       if (!plx_declare_identifier(name, symbol_table)) result = false;
+      if (node->kind == PLX_NODE_CONST_DEF && name->entry != NULL) {
+        name->entry->mutability = PLX_SYMBOL_MUTABILITY_CONST;
+      }
       break;
     }
     case PLX_NODE_STRUCT_DEF:
@@ -91,6 +94,9 @@ bool plx_resolve_names(struct plx_node* const node,
       struct plx_node *name, *params, *return_type, *body;
       plx_extract_children(node, &name, &params, &return_type, &body);
       if (!plx_declare_identifier(name, symbol_table)) result = false;
+      if (name->entry != NULL) {
+        name->entry->mutability = PLX_SYMBOL_MUTABILITY_CONST;
+      }
       plx_enter_scope(symbol_table);
       for (struct plx_node* param = params->children; param != NULL;
            param = param->next) {
@@ -112,6 +118,29 @@ bool plx_resolve_names(struct plx_node* const node,
       }
       plx_exit_scope(symbol_table);
       break;
+    case PLX_NODE_FOR_LOOP: {
+      struct plx_node *name, *iterable, *body;
+      plx_extract_children(node, &name, &iterable, &body);
+      if (!plx_resolve_names(iterable, symbol_table)) result = false;
+      plx_enter_scope(symbol_table);
+      if (!plx_declare_identifier(name, symbol_table)) result = false;
+      // The loop variable is defined anew in each iteration.
+      if (name->entry != NULL) {
+        name->entry->mutability = PLX_SYMBOL_MUTABILITY_CONST;
+      }
+      if (!plx_resolve_names(body, symbol_table)) result = false;
+      plx_exit_scope(symbol_table);
+      break;
+    }
+    case PLX_NODE_REF: {
+      struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      if (!plx_resolve_names(operand, symbol_table)) result = false;
+      if (operand->kind == PLX_NODE_IDENTIFIER && operand->entry != NULL) {
+        operand->entry->referenced = true;
+      }
+      break;
+    }
     case PLX_NODE_IDENTIFIER:
       if (node->entry != NULL) break;
       node->entry = plx_lookup_symbol(symbol_table, node->name);
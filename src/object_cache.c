@@ -0,0 +1,238 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "object_cache.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "dir.h"
+#include "error.h"
+#include "macros.h"
+#include "path.h"
+
+#ifdef _WIN32
+#include <direct.h>
+#include <sys/utime.h>
+
+#define plx_mkdir(path) _mkdir(path)
+#define plx_touch(path) _utime(path, NULL)
+#else
+#include <utime.h>
+
+#define plx_mkdir(path) mkdir(path, 0777)
+#define plx_touch(path) utime(path, NULL)
+#endif  // _WIN32
+
+#define PLX_FNV_OFFSET_BASIS UINT64_C(0xcbf29ce484222325)
+#define PLX_FNV_PRIME UINT64_C(0x100000001b3)
+
+// Multiplier of the second lane, which is odd so that every byte affects the
+// hash.
+#define PLX_OBJECT_CACHE_PRIME2 UINT64_C(0x9e3779b97f4a7c15)
+
+// Cache entry that has been found while trimming the cache.
+struct plx_object_cache_entry {
+  char name[40];
+  unsigned long long size;
+  time_t mtime;
+};
+
+bool plx_object_cache_default_dir(char* const dir, const size_t size) {
+  const char* const env = getenv("PLX_CACHE_DIR");
+  int len;
+  if (env != NULL && *env != '\0') {
+    len = snprintf(dir, size, "%s", env);
+  } else {
+#ifdef _WIN32
+    const char* const local_app_data = getenv("LOCALAPPDATA");
+    if (local_app_data == NULL) return false;
+    len = snprintf(dir, size, "%s\\plx", local_app_data);
+#else
+    const char* const xdg_cache_home = getenv("XDG_CACHE_HOME");
+    const char* const home = getenv("HOME");
+    if (xdg_cache_home != NULL && *xdg_cache_home != '\0') {
+      len = snprintf(dir, size, "%s/plx", xdg_cache_home);
+    } else if (home != NULL) {
+      len = snprintf(dir, size, "%s/.cache/plx", home);
+    } else {
+      return false;
+    }
+#endif  // _WIN32
+  }
+  return len > 0 && (size_t)len < size;
+}
+
+void plx_object_cache_key_init(struct plx_object_cache_key* const key) {
+  key->hash[0] = PLX_FNV_OFFSET_BASIS;
+  key->hash[1] = PLX_FNV_OFFSET_BASIS;
+}
+
+void plx_object_cache_key_update(struct plx_object_cache_key* const key,
+                                 const void* const data, const size_t len) {
+  const unsigned char* const bytes = data;
+  uint64_t hash0 = key->hash[0], hash1 = key->hash[1];
+  for (size_t i = 0; i < len; ++i) {
+    hash0 = (hash0 ^ bytes[i]) * PLX_FNV_PRIME;
+    hash1 = (hash1 ^ bytes[i]) * PLX_OBJECT_CACHE_PRIME2;
+  }
+  key->hash[0] = hash0;
+  key->hash[1] = hash1;
+}
+
+// Writes the filename of the entry for a key to the buffer, returning whether
+// it fit.
+static bool plx_object_cache_filename(
+    const struct plx_object_cache* const cache,
+    const struct plx_object_cache_key* const key, char* const filename,
+    const size_t size) {
+  const int len = snprintf(filename, size, "%s/%016llx%016llx", cache->dir,
+                           (unsigned long long)key->hash[0],
+                           (unsigned long long)key->hash[1]);
+  return len > 0 && (size_t)len < size;
+}
+
+// Copies a file along with its permissions, so that executables stay
+// executable. Returns whether it succeeded.
+static bool plx_copy_file(const char* const from, const char* const to) {
+  FILE* const input = fopen(from, "rb");
+  if (input == NULL) return false;
+  FILE* const output = fopen(to, "wb");
+  if (output == NULL) {
+    fclose(input);
+    return false;
+  }
+  bool result = true;
+  char chunk[65536];
+  size_t len;
+  while ((len = fread(chunk, 1, sizeof(chunk), input)) > 0) {
+    if (fwrite(chunk, 1, len, output) != len) {
+      result = false;
+      break;
+    }
+  }
+  if (ferror(input)) result = false;
+#ifndef _WIN32
+  struct stat st;
+  if (fstat(fileno(input), &st) != 0 ||
+      fchmod(fileno(output), st.st_mode & 0777) != 0) {
+    result = false;
+  }
+#endif  // _WIN32
+  fclose(input);
+  return fclose(output) == 0 && result;
+}
+
+// Creates a directory and any missing parents, returning whether it exists.
+static bool plx_make_dirs(const char* const path) {
+  char dir[PLX_PATH_MAX];
+  const size_t len = strlen(path);
+  if (len >= sizeof(dir)) return false;
+  memcpy(dir, path, len + 1);
+  for (size_t i = 1; i <= len; ++i) {
+    if (dir[i] != '/' && dir[i] != '\\' && dir[i] != '\0') continue;
+    const char c = dir[i];
+    dir[i] = '\0';
+    if (plx_mkdir(dir) != 0 && errno != EEXIST) return false;
+    dir[i] = c;
+  }
+  return true;
+}
+
+bool plx_object_cache_fetch(const struct plx_object_cache* const cache,
+                            const struct plx_object_cache_key* const key,
+                            const char* const output_filename) {
+  char filename[PLX_PATH_MAX];
+  if (!plx_object_cache_filename(cache, key, filename, sizeof(filename))) {
+    return false;
+  }
+  if (!plx_copy_file(filename, output_filename)) return false;
+  plx_touch(filename);
+  return true;
+}
+
+void plx_object_cache_store(const struct plx_object_cache* const cache,
+                            const struct plx_object_cache_key* const key,
+                            const char* const output_filename) {
+  char filename[PLX_PATH_MAX];
+  char temp_filename[PLX_PATH_MAX + 8];
+  if (!plx_object_cache_filename(cache, key, filename, sizeof(filename)) ||
+      !plx_make_dirs(cache->dir)) {
+    return;
+  }
+
+  // The entry is renamed into place, so that a concurrent build never reads a
+  // partial entry.
+  snprintf(temp_filename, sizeof(temp_filename), "%s.tmp", filename);
+  if (!plx_copy_file(output_filename, temp_filename) ||
+      rename(temp_filename, filename) != 0) {
+    remove(temp_filename);
+  }
+}
+
+// Orders entries from least to most recently used.
+static int plx_object_cache_entry_cmp(const void* const a,
+                                      const void* const b) {
+  const struct plx_object_cache_entry* const entry_a = a;
+  const struct plx_object_cache_entry* const entry_b = b;
+  return (entry_a->mtime > entry_b->mtime) - (entry_a->mtime < entry_b->mtime);
+}
+
+void plx_object_cache_trim(const struct plx_object_cache* const cache) {
+  struct plx_dir dir;
+  if (!plx_dir_open(&dir, cache->dir)) return;
+  size_t cap = 0, len = 0;
+  struct plx_object_cache_entry* entries = NULL;
+  unsigned long long total_size = 0;
+  const char* name;
+  bool is_dir;
+  while ((name = plx_dir_read(&dir, &is_dir)) != NULL) {
+    if (is_dir || strlen(name) >= sizeof(entries->name)) continue;
+    char filename[PLX_PATH_MAX];
+    struct stat st;
+    if (snprintf(filename, sizeof(filename), "%s/%s", cache->dir, name) < 0 ||
+        stat(filename, &st) != 0) {
+      continue;
+    }
+    if (plx_unlikely(len == cap)) {
+      cap = cap == 0 ? 64 : cap * 2;
+      entries = realloc(entries, cap * sizeof(*entries));
+      if (plx_unlikely(entries == NULL)) plx_oom();
+    }
+    struct plx_object_cache_entry* const entry = &entries[len++];
+    strcpy(entry->name, name);
+    entry->size = (unsigned long long)st.st_size;
+    entry->mtime = st.st_mtime;
+    total_size += entry->size;
+  }
+  plx_dir_close(&dir);
+
+  if (total_size > cache->max_size) {
+    qsort(entries, len, sizeof(*entries), plx_object_cache_entry_cmp);
+    for (size_t i = 0; i < len && total_size > cache->max_size; ++i) {
+      char filename[PLX_PATH_MAX];
+      if (snprintf(filename, sizeof(filename), "%s/%s", cache->dir,
+                   entries[i].name) < 0) {
+        continue;
+      }
+      if (remove(filename) == 0) total_size -= entries[i].size;
+    }
+  }
+  free(entries);
+}
@@ -0,0 +1,65 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_OBJECT_CACHE_H
+#define PLX_OBJECT_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Content-addressed cache of Clang's outputs. Entries are files in one
+// directory that are named by the hash of everything that determines their
+// contents.
+struct plx_object_cache {
+  // Directory of the entries, which is created when the first entry is stored.
+  const char* dir;
+
+  // Size in bytes that the entries are trimmed to.
+  unsigned long long max_size;
+};
+
+// Hash that names a cache entry. Two 64-bit FNV-1a lanes with different primes
+// make collisions between entries negligible.
+struct plx_object_cache_key {
+  uint64_t hash[2];
+};
+
+// Writes the default cache directory to the buffer: `PLX_CACHE_DIR`, or `plx`
+// in the user's cache directory. Returns whether it could be determined.
+bool plx_object_cache_default_dir(char* dir, size_t size);
+
+void plx_object_cache_key_init(struct plx_object_cache_key* key);
+
+// Adds data to the key.
+void plx_object_cache_key_update(struct plx_object_cache_key* key,
+                                 const void* data, size_t len);
+
+// Copies the entry for the key to the output file if there is one, returning
+// whether it did. The entry is marked as recently used.
+bool plx_object_cache_fetch(const struct plx_object_cache* cache,
+                            const struct plx_object_cache_key* key,
+                            const char* output_filename);
+
+// Copies an output file into the cache. Failures are ignored, since the cache
+// only saves time.
+void plx_object_cache_store(const struct plx_object_cache* cache,
+                            const struct plx_object_cache_key* key,
+                            const char* output_filename);
+
+// Removes the least recently used entries until the cache fits its maximum
+// size.
+void plx_object_cache_trim(const struct plx_object_cache* cache);
+
+#endif  // PLX_OBJECT_CACHE_H
@@ -16,6 +16,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "macros.h"
 #include "source_code_location.h"
@@ -37,6 +38,8 @@ struct plx_node* plx_parse_module(struct plx_tokenizer* const tokenizer) {
         def = plx_parse_struct_def(tokenizer);
         break;
       case PLX_TOKEN_FUNC:
+      case PLX_TOKEN_INLINE:
+      case PLX_TOKEN_NOINLINE:
         def = plx_parse_func_def(tokenizer);
         break;
       default:
@@ -168,9 +171,16 @@ struct plx_node* plx_parse_struct_def(struct plx_tokenizer* const tokenizer) {
 }
 
 struct plx_node* plx_parse_func_def(struct plx_tokenizer* const tokenizer) {
-  assert(tokenizer->token == PLX_TOKEN_FUNC);
   const struct plx_source_code_location loc = tokenizer->loc;
-  plx_next_token(tokenizer);
+
+  // Parse the inlining hint.
+  enum plx_inline_hint inline_hint = PLX_INLINE_HINT_NONE;
+  if (plx_accept_token(tokenizer, PLX_TOKEN_INLINE)) {
+    inline_hint = PLX_INLINE_HINT_ALWAYS;
+  } else if (plx_accept_token(tokenizer, PLX_TOKEN_NOINLINE)) {
+    inline_hint = PLX_INLINE_HINT_NEVER;
+  }
+  if (!plx_accept_token(tokenizer, PLX_TOKEN_FUNC)) return NULL;
 
   // Parse the name.
   struct plx_node* const name = plx_parse_identifier(tokenizer);
@@ -195,6 +205,7 @@ struct plx_node* plx_parse_func_def(struct plx_tokenizer* const tokenizer) {
 
   // Create the node.
   struct plx_node* const func_def = plx_new_node(PLX_NODE_FUNC_DEF, &loc);
+  func_def->inline_hint = inline_hint;
   func_def->children = name;
   name->next = params;
   params->next = return_type;
@@ -253,6 +264,8 @@ struct plx_node* plx_parse_stmt(struct plx_tokenizer* const tokenizer) {
       return plx_parse_loop(tokenizer);
     case PLX_TOKEN_WHILE:
       return plx_parse_while_loop(tokenizer);
+    case PLX_TOKEN_FOR:
+      return plx_parse_for_loop(tokenizer);
     case PLX_TOKEN_CONTINUE:
       plx_next_token(tokenizer);
       if (!plx_accept_token(tokenizer, PLX_TOKEN_SEMICOLON)) return NULL;
@@ -350,14 +363,56 @@ struct plx_node* plx_parse_while_loop(struct plx_tokenizer* const tokenizer) {
   return while_loop;
 }
 
+struct plx_node* plx_parse_for_loop(struct plx_tokenizer* const tokenizer) {
+  assert(tokenizer->token == PLX_TOKEN_FOR);
+  const struct plx_source_code_location loc = tokenizer->loc;
+  plx_next_token(tokenizer);
+
+  // Parse the name.
+  struct plx_node* const name = plx_parse_identifier(tokenizer);
+  if (plx_unlikely(name == NULL)) return NULL;
+
+  // Expect `in`.
+  if (!plx_accept_token(tokenizer, PLX_TOKEN_IN)) return NULL;
+
+  // Parse the array or slice, or the start of the range.
+  const struct plx_source_code_location iterable_loc = tokenizer->loc;
+  struct plx_node* iterable = plx_parse_arithmetic_expr(tokenizer);
+  if (plx_unlikely(iterable == NULL)) return NULL;
+
+  // Parse the end of the range.
+  if (plx_accept_token(tokenizer, PLX_TOKEN_RANGE)) {
+    struct plx_node* const end = plx_parse_arithmetic_expr(tokenizer);
+    if (plx_unlikely(end == NULL)) return NULL;
+    struct plx_node* const range = plx_new_node(PLX_NODE_RANGE, &iterable_loc);
+    range->children = iterable;
+    iterable->next = end;
+    iterable = range;
+  }
+
+  // Parse the body.
+  struct plx_node* const body = plx_parse_block(tokenizer);
+  if (plx_unlikely(body == NULL)) return NULL;
+
+  // Create the node.
+  struct plx_node* const for_loop = plx_new_node(PLX_NODE_FOR_LOOP, &loc);
+  for_loop->children = name;
+  name->next = iterable;
+  iterable->next = body;
+  return for_loop;
+}
+
 struct plx_node* plx_parse_return(struct plx_tokenizer* const tokenizer) {
   assert(tokenizer->token == PLX_TOKEN_RETURN);
   const struct plx_source_code_location loc = tokenizer->loc;
   plx_next_token(tokenizer);
 
+  // Parse the `tail` keyword, which must be followed by a return value.
+  const bool tail_call = plx_accept_token(tokenizer, PLX_TOKEN_TAIL);
+
   // Parse the return value.
   struct plx_node* value = NULL;
-  if (!plx_accept_token(tokenizer, PLX_TOKEN_SEMICOLON)) {
+  if (tail_call || !plx_accept_token(tokenizer, PLX_TOKEN_SEMICOLON)) {
     value = plx_parse_expr(tokenizer);
     if (plx_unlikely(value == NULL)) return NULL;
     if (!plx_accept_token(tokenizer, PLX_TOKEN_SEMICOLON)) return NULL;
@@ -365,6 +420,7 @@ struct plx_node* plx_parse_return(struct plx_tokenizer* const tokenizer) {
 
   // Create the node.
   struct plx_node* const rreturn = plx_new_node(PLX_NODE_RETURN, &loc);
+  rreturn->tail_call = tail_call;
   rreturn->children = value;
   return rreturn;
 }
@@ -641,6 +697,9 @@ struct plx_node* plx_parse_postfix_expr(struct plx_tokenizer* const tokenizer) {
           // Parse the end.
           struct plx_node* const end = plx_parse_expr(tokenizer);
           if (plx_unlikely(end == NULL)) return NULL;
+          if (!plx_accept_token(tokenizer, PLX_TOKEN_CLOSE_SQUARE_BRACKET)) {
+            return NULL;
+          }
 
           // Create the node.
           struct plx_node* const slice = plx_new_node(PLX_NODE_SLICE, &loc);
@@ -650,6 +709,10 @@ struct plx_node* plx_parse_postfix_expr(struct plx_tokenizer* const tokenizer) {
           return slice;
         }
 
+        if (!plx_accept_token(tokenizer, PLX_TOKEN_CLOSE_SQUARE_BRACKET)) {
+          return NULL;
+        }
+
         // Create the node.
         struct plx_node* const index = plx_new_node(PLX_NODE_INDEX, &loc);
         index->children = expr;
@@ -697,8 +760,15 @@ struct plx_node* plx_parse_primary_expr(struct plx_tokenizer* const tokenizer) {
     }
     case PLX_TOKEN_STRING:
       return plx_parse_string_lit(tokenizer);
-    case PLX_TOKEN_OPEN_PAREN:
-      return plx_parse_expr(tokenizer);
+    case PLX_TOKEN_BUILTIN:
+      return plx_parse_builtin(tokenizer);
+    case PLX_TOKEN_OPEN_PAREN: {
+      plx_next_token(tokenizer);
+      struct plx_node* const expr = plx_parse_expr(tokenizer);
+      if (plx_unlikely(expr == NULL)) return NULL;
+      if (!plx_accept_token(tokenizer, PLX_TOKEN_CLOSE_PAREN)) return NULL;
+      return expr;
+    }
     default:
       return NULL;
   }
@@ -751,6 +821,81 @@ struct plx_node* plx_parse_identifier_or_struct(
   return sstruct;
 }
 
+struct plx_node* plx_parse_builtin(struct plx_tokenizer* const tokenizer) {
+  assert(tokenizer->token == PLX_TOKEN_BUILTIN);
+  const struct plx_source_code_location loc = tokenizer->loc;
+
+  // Look up the builtin.
+  enum plx_node_kind kind;
+  size_t param_count;
+  if (strcmp(tokenizer->str, "select") == 0) {
+    kind = PLX_NODE_SELECT;
+    param_count = 3;
+  } else if (strcmp(tokenizer->str, "shuffle") == 0) {
+    kind = PLX_NODE_SHUFFLE;
+    param_count = 2;
+  } else if (strcmp(tokenizer->str, "reduceAdd") == 0) {
+    kind = PLX_NODE_REDUCE_ADD;
+    param_count = 1;
+  } else if (strcmp(tokenizer->str, "reduceMul") == 0) {
+    kind = PLX_NODE_REDUCE_MUL;
+    param_count = 1;
+  } else if (strcmp(tokenizer->str, "reduceMin") == 0) {
+    kind = PLX_NODE_REDUCE_MIN;
+    param_count = 1;
+  } else if (strcmp(tokenizer->str, "reduceMax") == 0) {
+    kind = PLX_NODE_REDUCE_MAX;
+    param_count = 1;
+  } else if (strcmp(tokenizer->str, "reduceAnd") == 0) {
+    kind = PLX_NODE_REDUCE_AND;
+    param_count = 1;
+  } else if (strcmp(tokenizer->str, "reduceOr") == 0) {
+    kind = PLX_NODE_REDUCE_OR;
+    param_count = 1;
+  } else if (strcmp(tokenizer->str, "reduceXor") == 0) {
+    kind = PLX_NODE_REDUCE_XOR;
+    param_count = 1;
+  } else {
+    return NULL;
+  }
+  plx_next_token(tokenizer);
+
+  // Parse the arguments.
+  if (!plx_accept_token(tokenizer, PLX_TOKEN_OPEN_PAREN)) return NULL;
+  struct plx_node* const builtin = plx_new_node(kind, &loc);
+  struct plx_node** next = &builtin->children;
+  for (size_t i = 0; i < param_count; ++i) {
+    if (i > 0 && !plx_accept_token(tokenizer, PLX_TOKEN_COMMA)) return NULL;
+    struct plx_node* const arg = plx_parse_expr(tokenizer);
+    if (plx_unlikely(arg == NULL)) return NULL;
+    *next = arg;
+    next = &arg->next;
+  }
+
+  // Parse the lane indices of a shuffle, e.g. `[0, 4, 1, 5]`.
+  if (kind == PLX_NODE_SHUFFLE) {
+    if (!plx_accept_token(tokenizer, PLX_TOKEN_COMMA)) return NULL;
+    struct plx_node* const indices =
+        plx_new_node(PLX_NODE_OTHER, &tokenizer->loc);
+    if (!plx_accept_token(tokenizer, PLX_TOKEN_OPEN_SQUARE_BRACKET)) {
+      return NULL;
+    }
+    struct plx_node** next_index = &indices->children;
+    while (1) {
+      if (plx_unlikely(tokenizer->token != PLX_TOKEN_INT)) return NULL;
+      struct plx_node* const index = plx_parse_int_lit(tokenizer);
+      *next_index = index;
+      next_index = &index->next;
+      if (plx_accept_token(tokenizer, PLX_TOKEN_CLOSE_SQUARE_BRACKET)) break;
+      if (!plx_accept_token(tokenizer, PLX_TOKEN_COMMA)) return NULL;
+    }
+    *next = indices;
+  }
+
+  if (!plx_accept_token(tokenizer, PLX_TOKEN_CLOSE_PAREN)) return NULL;
+  return builtin;
+}
+
 struct plx_node* plx_parse_identifier(struct plx_tokenizer* const tokenizer) {
   if (plx_unlikely(tokenizer->token != PLX_TOKEN_IDENTIFIER)) return NULL;
   struct plx_node* const identifier =
@@ -781,6 +926,9 @@ struct plx_node* plx_parse_type(struct plx_tokenizer* const tokenizer) {
   switch (tokenizer->token) {
     case PLX_TOKEN_IDENTIFIER:
       return plx_parse_identifier(tokenizer);
+    case PLX_TOKEN_BOOL:
+      plx_next_token(tokenizer);
+      return plx_new_node(PLX_NODE_BOOL_TYPE, &loc);
     case PLX_TOKEN_S8:
       plx_next_token(tokenizer);
       return plx_new_node(PLX_NODE_S8_TYPE, &loc);
@@ -817,6 +965,8 @@ struct plx_node* plx_parse_type(struct plx_tokenizer* const tokenizer) {
       return plx_parse_ref_type(tokenizer);
     case PLX_TOKEN_OPEN_SQUARE_BRACKET:
       return plx_parse_array_or_slice_type(tokenizer);
+    case PLX_TOKEN_VEC:
+      return plx_parse_vec_type(tokenizer);
     default:
       return NULL;
   }
@@ -910,3 +1060,25 @@ struct plx_node* plx_parse_array_or_slice_type(
   len->next = element_type;
   return array_type;
 }
+
+struct plx_node* plx_parse_vec_type(struct plx_tokenizer* const tokenizer) {
+  assert(tokenizer->token == PLX_TOKEN_VEC);
+  const struct plx_source_code_location loc = tokenizer->loc;
+  plx_next_token(tokenizer);
+
+  // Parse the lane count, which must be an integer literal.
+  if (!plx_accept_token(tokenizer, PLX_TOKEN_OPEN_SQUARE_BRACKET)) return NULL;
+  if (plx_unlikely(tokenizer->token != PLX_TOKEN_INT)) return NULL;
+  struct plx_node* const len = plx_parse_int_lit(tokenizer);
+  if (!plx_accept_token(tokenizer, PLX_TOKEN_CLOSE_SQUARE_BRACKET)) return NULL;
+
+  // Parse the lane type.
+  struct plx_node* const element_type = plx_parse_type(tokenizer);
+  if (plx_unlikely(element_type == NULL)) return NULL;
+
+  // Create the node.
+  struct plx_node* const vec_type = plx_new_node(PLX_NODE_VEC_TYPE, &loc);
+  vec_type->children = len;
+  len->next = element_type;
+  return vec_type;
+}
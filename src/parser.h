@@ -33,6 +33,7 @@ struct plx_node* plx_parse_stmt(struct plx_tokenizer* tokenizer);
 struct plx_node* plx_parse_block(struct plx_tokenizer* tokenizer);
 struct plx_node* plx_parse_loop(struct plx_tokenizer* tokenizer);
 struct plx_node* plx_parse_while_loop(struct plx_tokenizer* tokenizer);
+struct plx_node* plx_parse_for_loop(struct plx_tokenizer* tokenizer);
 struct plx_node* plx_parse_return(struct plx_tokenizer* tokenizer);
 struct plx_node* plx_parse_assign(struct plx_tokenizer* tokenizer);
 
@@ -46,6 +47,7 @@ struct plx_node* plx_parse_unary_expr(struct plx_tokenizer* tokenizer);
 struct plx_node* plx_parse_postfix_expr(struct plx_tokenizer* tokenizer);
 struct plx_node* plx_parse_primary_expr(struct plx_tokenizer* tokenizer);
 struct plx_node* plx_parse_func(struct plx_tokenizer* tokenizer);
+struct plx_node* plx_parse_builtin(struct plx_tokenizer* tokenizer);
 struct plx_node* plx_parse_identifier(struct plx_tokenizer* tokenizer);
 struct plx_node* plx_parse_identifier_or_struct(
     struct plx_tokenizer* tokenizer);
@@ -57,5 +59,6 @@ struct plx_node* plx_parse_type(struct plx_tokenizer* tokenizer);
 struct plx_node* plx_parse_func_type(struct plx_tokenizer* tokenizer);
 struct plx_node* plx_parse_ref_type(struct plx_tokenizer* tokenizer);
 struct plx_node* plx_parse_array_or_slice_type(struct plx_tokenizer* tokenizer);
+struct plx_node* plx_parse_vec_type(struct plx_tokenizer* tokenizer);
 
 #endif  // PLX_PARSER_H
@@ -77,6 +77,11 @@ void plx_print(const struct plx_node* const node, FILE* const stream) {
     case PLX_NODE_FUNC_DEF: {
       const struct plx_node *name, *params, *return_type, *body;
       plx_extract_children(node, &name, &params, &return_type, &body);
+      if (node->inline_hint == PLX_INLINE_HINT_ALWAYS) {
+        fputs("inline ", stream);
+      } else if (node->inline_hint == PLX_INLINE_HINT_NEVER) {
+        fputs("noinline ", stream);
+      }
       fputs("func ", stream);
       plx_print(name, stream);
       fputc('(', stream);
@@ -132,6 +137,17 @@ void plx_print(const struct plx_node* const node, FILE* const stream) {
       plx_print(body, stream);
       break;
     }
+    case PLX_NODE_FOR_LOOP: {
+      const struct plx_node *name, *iterable, *body;
+      plx_extract_children(node, &name, &iterable, &body);
+      fputs("for ", stream);
+      plx_print(name, stream);
+      fputs(" in ", stream);
+      plx_print(iterable, stream);
+      fputc(' ', stream);
+      plx_print(body, stream);
+      break;
+    }
     case PLX_NODE_CONTINUE:
       fputs("continue;\n", stream);
       break;
@@ -142,6 +158,7 @@ void plx_print(const struct plx_node* const node, FILE* const stream) {
       const struct plx_node* return_type;
       plx_extract_children(node, &return_type);
       fputs("return", stream);
+      if (node->tail_call) fputs(" tail", stream);
       if (return_type != NULL) {
         fputc(' ', stream);
         plx_print(return_type, stream);
@@ -445,6 +462,68 @@ void plx_print(const struct plx_node* const node, FILE* const stream) {
       fputc(']', stream);
       break;
     }
+    case PLX_NODE_BOUNDS_CHECK:
+      plx_print(node->children, stream);
+      break;
+    case PLX_NODE_RANGE: {
+      const struct plx_node *start, *end;
+      plx_extract_children(node, &start, &end);
+      plx_print(start, stream);
+      fputs("..", stream);
+      plx_print(end, stream);
+      break;
+    }
+    case PLX_NODE_SELECT: {
+      const struct plx_node *mask, *left, *right;
+      plx_extract_children(node, &mask, &left, &right);
+      fputs("@select(", stream);
+      plx_print(mask, stream);
+      fputs(", ", stream);
+      plx_print(left, stream);
+      fputs(", ", stream);
+      plx_print(right, stream);
+      fputc(')', stream);
+      break;
+    }
+    case PLX_NODE_SHUFFLE: {
+      const struct plx_node *left, *right, *indices;
+      plx_extract_children(node, &left, &right, &indices);
+      fputs("@shuffle(", stream);
+      plx_print(left, stream);
+      fputs(", ", stream);
+      plx_print(right, stream);
+      fputs(", [", stream);
+      for (const struct plx_node* index = indices->children; index != NULL;
+           index = index->next) {
+        plx_print(index, stream);
+        if (index->next != NULL) fputs(", ", stream);
+      }
+      fputs("])", stream);
+      break;
+    }
+    case PLX_NODE_REDUCE_ADD:
+    case PLX_NODE_REDUCE_MUL:
+    case PLX_NODE_REDUCE_MIN:
+    case PLX_NODE_REDUCE_MAX:
+    case PLX_NODE_REDUCE_AND:
+    case PLX_NODE_REDUCE_OR:
+    case PLX_NODE_REDUCE_XOR: {
+      static const char* const names[] = {
+          [PLX_NODE_REDUCE_ADD] = "reduceAdd",
+          [PLX_NODE_REDUCE_MUL] = "reduceMul",
+          [PLX_NODE_REDUCE_MIN] = "reduceMin",
+          [PLX_NODE_REDUCE_MAX] = "reduceMax",
+          [PLX_NODE_REDUCE_AND] = "reduceAnd",
+          [PLX_NODE_REDUCE_OR] = "reduceOr",
+          [PLX_NODE_REDUCE_XOR] = "reduceXor",
+      };
+      const struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      fprintf(stream, "@%s(", names[node->kind]);
+      plx_print(operand, stream);
+      fputc(')', stream);
+      break;
+    }
     case PLX_NODE_FIELD:
       break;
     case PLX_NODE_IDENTIFIER:
@@ -582,6 +661,15 @@ void plx_print(const struct plx_node* const node, FILE* const stream) {
       plx_print(element_type, stream);
       break;
     }
+    case PLX_NODE_VEC_TYPE: {
+      const struct plx_node *len, *element_type;
+      plx_extract_children(node, &len, &element_type);
+      fputs("vec[", stream);
+      plx_print(len, stream);
+      fputc(']', stream);
+      plx_print(element_type, stream);
+      break;
+    }
     case PLX_NODE_OTHER:
       break;
   }
@@ -44,6 +44,13 @@ int plx_read_char(struct plx_reader* const reader) {
   return c;
 }
 
+// Pushes back the previous character, which must not be a newline.
+void plx_unread_char(struct plx_reader* const reader, const int c) {
+  ungetc(reader->c, reader->stream);
+  reader->c = c;
+  --reader->loc.col;
+}
+
 bool plx_accept_char(struct plx_reader* const reader, const char c) {
   if (c == reader->c) {
     plx_next_char(reader);
@@ -31,6 +31,7 @@ void plx_reader_init(struct plx_reader* reader, const char* filename,
 void plx_next_char(struct plx_reader* reader);
 int plx_peek_char(const struct plx_reader* reader);
 int plx_read_char(struct plx_reader* reader);
+void plx_unread_char(struct plx_reader* reader, int c);
 bool plx_accept_char(struct plx_reader* reader, const char c);
 void plx_unexpected_character(const struct plx_reader* reader);
 
@@ -15,9 +15,15 @@
 #ifndef PLX_SYMBOL_TABLE_ENTRY_H
 #define PLX_SYMBOL_TABLE_ENTRY_H
 
+#include <stdbool.h>
+
 #include "ast.h"
 #include "source_code_location.h"
 
+// LLVM value (`LLVMValueRef`), declared here to avoid depending on the LLVM
+// headers.
+struct LLVMOpaqueValue;
+
 // Scope of a symbol.
 enum plx_symbol_scope {
   PLX_SYMBOL_SCOPE_LOCAL,
@@ -53,8 +59,30 @@ struct plx_symbol_table_entry {
   // Value of the symbol.
   const struct plx_node* value;
 
-  // LLVM local variable.
+  // Whether the address of the symbol is taken.
+  bool referenced;
+
+  // LLVM local variable. Holds the current value of the variable if it is kept
+  // in SSA form, or otherwise the address of its stack slot.
   unsigned int llvm_local_var;
+
+  // LLVM codegen unit that defines a global symbol.
+  unsigned int llvm_unit;
+
+  // x86-64 virtual register or stack slot of a local variable, or symbol of a
+  // global one.
+  unsigned int x86_64_var;
+
+  // Bytecode register or frame offset of a local variable, offset of a global
+  // one in the globals, or index of a function.
+  unsigned int bytecode_var;
+
+  // WebAssembly index of a function.
+  unsigned int wasm_func;
+
+  // LLVM value when generating code in process with the LLVM-C API. Holds the
+  // address of the variable, or the function itself.
+  struct LLVMOpaqueValue* llvm_value;
 };
 
 #endif  // PLX_SYMBOL_TABLE_ENTRY_H
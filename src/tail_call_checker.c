@@ -0,0 +1,97 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tail_call_checker.h"
+
+#include "error.h"
+#include "source_code_printer.h"
+#include "symbol_table_entry.h"
+#include "types.h"
+
+static void plx_invalid_tail_call(const struct plx_node* const rreturn,
+                                  const char* const annotation) {
+  plx_error("invalid tail call");
+  plx_print_source_code(&rreturn->loc, annotation,
+                        PLX_SOURCE_ANNOTATION_ERROR);
+}
+
+// Returns whether the address of a local variable is taken in a node, in which
+// case the caller's frame may still be used after it is replaced by a tail
+// call.
+static bool plx_takes_local_address(const struct plx_node* const node) {
+  if (node->kind == PLX_NODE_REF || node->kind == PLX_NODE_SLICE) {
+    const struct plx_node* base = node->children;
+    while (base->kind == PLX_NODE_INDEX || base->kind == PLX_NODE_FIELD) {
+      base = base->children;
+    }
+    if (base->kind == PLX_NODE_IDENTIFIER && base->entry != NULL &&
+        base->entry->scope == PLX_SYMBOL_SCOPE_LOCAL) {
+      return true;
+    }
+  }
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    if (plx_takes_local_address(child)) return true;
+  }
+  return false;
+}
+
+// Checks the return statements in a function, where `func_type` is the type
+// of the function.
+static bool plx_check_tail_calls_in(struct plx_node* const node,
+                                    const struct plx_node* const func_type,
+                                    const bool takes_local_address) {
+  if (node->kind == PLX_NODE_RETURN) {
+    struct plx_node* const value = node->children;
+    const char* annotation = NULL;
+    if (value == NULL || value->kind != PLX_NODE_CALL) {
+      annotation = "the returned value is not a call";
+    } else if (!plx_type_eq(value->children->type, func_type)) {
+      annotation = "the called function's signature differs from the caller's";
+    } else if (takes_local_address) {
+      annotation = "the caller takes the address of a local variable";
+    }
+    if (annotation == NULL) {
+      value->tail_call = true;
+    } else if (node->tail_call) {
+      plx_invalid_tail_call(node, annotation);
+      return false;
+    }
+    return true;
+  }
+
+  bool result = true;
+  for (struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    if (!plx_check_tail_calls_in(child, func_type, takes_local_address)) {
+      result = false;
+    }
+  }
+  return result;
+}
+
+bool plx_check_tail_calls(struct plx_node* const module) {
+  bool result = true;
+  for (struct plx_node* def = module->children; def != NULL;
+       def = def->next) {
+    if (def->kind != PLX_NODE_FUNC_DEF) continue;
+    struct plx_node *name, *params, *return_type, *body;
+    plx_extract_children(def, &name, &params, &return_type, &body);
+    if (!plx_check_tail_calls_in(body, name->type,
+                                 plx_takes_local_address(body))) {
+      result = false;
+    }
+  }
+  return result;
+}
@@ -0,0 +1,28 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_TAIL_CALL_CHECKER_H
+#define PLX_TAIL_CALL_CHECKER_H
+
+#include <stdbool.h>
+
+#include "ast.h"
+
+// Marks the calls in return position that are lowered as guaranteed tail calls,
+// which are calls to functions with the same signature as the caller from
+// callers that never take the address of a local variable. Reports an error
+// for each return statement marked `tail` whose call is not a tail call.
+bool plx_check_tail_calls(struct plx_node* module);
+
+#endif  // PLX_TAIL_CALL_CHECKER_H
@@ -0,0 +1,88 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "target.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define PLX_HOST_ARCH "x86_64"
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PLX_HOST_ARCH "aarch64"
+#elif defined(__riscv) && __riscv_xlen == 64
+#define PLX_HOST_ARCH "riscv64"
+#elif defined(__i386__) || defined(_M_IX86)
+#define PLX_HOST_ARCH "i686"
+#else
+#define PLX_HOST_ARCH "unknown"
+#endif
+
+#ifdef _WIN32
+#define PLX_HOST_OS "pc-windows-msvc"
+#elif defined(__APPLE__)
+#define PLX_HOST_OS "apple-macosx"
+#elif defined(__linux__)
+#define PLX_HOST_OS "pc-linux-gnu"
+#elif defined(__FreeBSD__)
+#define PLX_HOST_OS "unknown-freebsd"
+#else
+#define PLX_HOST_OS "unknown-unknown"
+#endif
+
+const char* plx_host_triple(void) { return PLX_HOST_ARCH "-" PLX_HOST_OS; }
+
+// Returns whether the string starts with the prefix.
+static bool plx_starts_with(const char* const str, const char* const prefix) {
+  return strncmp(str, prefix, strlen(prefix)) == 0;
+}
+
+bool plx_is_x86_triple(const char* const triple) {
+  return plx_starts_with(triple, "x86_64") || plx_starts_with(triple, "i386") ||
+         plx_starts_with(triple, "i486") || plx_starts_with(triple, "i586") ||
+         plx_starts_with(triple, "i686");
+}
+
+const char* plx_data_layout(const char* const triple) {
+  // Mach-O and COFF use different symbol mangling from ELF.
+  const bool macho = strstr(triple, "-apple-") != NULL;
+  const bool coff = strstr(triple, "-windows") != NULL;
+  if (plx_starts_with(triple, "x86_64")) {
+    if (macho) {
+      return "e-m:o-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:"
+             "64-S128";
+    }
+    if (coff) {
+      return "e-m:w-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:"
+             "64-S128";
+    }
+    return "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-"
+           "S128";
+  }
+  if (plx_starts_with(triple, "aarch64") || plx_starts_with(triple, "arm64")) {
+    if (macho) return "e-m:o-i64:64-i128:128-n32:64-S128";
+    if (coff) return "e-m:w-p:64:64-i32:32-i64:64-i128:128-n32:64-S128";
+    return "e-m:e-i8:8:32-i16:16:32-i64:64-i128:128-n32:64-S128";
+  }
+  if (plx_starts_with(triple, "riscv64")) {
+    return "e-m:e-p:64:64-i64:64-i128:128-n64-S128";
+  }
+  if (plx_starts_with(triple, "wasm32")) {
+    return "e-m:e-p:32:32-i64:64-n32:64-S128";
+  }
+  if (plx_starts_with(triple, "wasm64")) {
+    return "e-m:e-p:64:64-i64:64-n32:64-S128";
+  }
+  return NULL;
+}
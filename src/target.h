@@ -0,0 +1,31 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_TARGET_H
+#define PLX_TARGET_H
+
+#include <stdbool.h>
+
+// Returns the target triple of the host.
+const char* plx_host_triple(void);
+
+// Returns whether the target triple is for an x86 architecture.
+bool plx_is_x86_triple(const char* triple);
+
+// Returns the LLVM data layout of the target triple, or `NULL` if it is not
+// known.
+// https://llvm.org/docs/LangRef.html#data-layout
+const char* plx_data_layout(const char* triple);
+
+#endif  // PLX_TARGET_H
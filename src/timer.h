@@ -0,0 +1,23 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_TIMER_H
+#define PLX_TIMER_H
+
+#include <stdint.h>
+
+// Returns the time of a monotonic clock in nanoseconds.
+uint64_t plx_time_ns(void);
+
+#endif  // PLX_TIMER_H
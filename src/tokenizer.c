@@ -98,6 +98,10 @@ void plx_next_token(struct plx_tokenizer* const tokenizer) {
           tokenizer->token = PLX_TOKEN_IF;
           return;
         }
+        if (strcmp(tokenizer->str, "in") == 0) {
+          tokenizer->token = PLX_TOKEN_IN;
+          return;
+        }
         if (strcmp(tokenizer->str, "or") == 0) {
           tokenizer->token = PLX_TOKEN_OR;
           return;
@@ -128,6 +132,10 @@ void plx_next_token(struct plx_tokenizer* const tokenizer) {
           tokenizer->token = PLX_TOKEN_XOR;
           return;
         }
+        if (strcmp(tokenizer->str, "vec") == 0) {
+          tokenizer->token = PLX_TOKEN_VEC;
+          return;
+        }
         if (strcmp(tokenizer->str, "s16") == 0) {
           tokenizer->token = PLX_TOKEN_S16;
           return;
@@ -186,6 +194,10 @@ void plx_next_token(struct plx_tokenizer* const tokenizer) {
           tokenizer->token = PLX_TOKEN_TRUE;
           return;
         }
+        if (strcmp(tokenizer->str, "tail") == 0) {
+          tokenizer->token = PLX_TOKEN_TAIL;
+          return;
+        }
         break;
       case 5:
         if (strcmp(tokenizer->str, "const") == 0) {
@@ -218,18 +230,42 @@ void plx_next_token(struct plx_tokenizer* const tokenizer) {
           tokenizer->token = PLX_TOKEN_RETURN;
           return;
         }
+        if (strcmp(tokenizer->str, "inline") == 0) {
+          tokenizer->token = PLX_TOKEN_INLINE;
+          return;
+        }
         break;
       case 8:
         if (strcmp(tokenizer->str, "continue") == 0) {
           tokenizer->token = PLX_TOKEN_CONTINUE;
           return;
         }
+        if (strcmp(tokenizer->str, "noinline") == 0) {
+          tokenizer->token = PLX_TOKEN_NOINLINE;
+          return;
+        }
         break;
     }
     tokenizer->token = PLX_TOKEN_IDENTIFIER;
     return;
   }
 
+  // Builtins
+  if (plx_accept_char(reader, '@')) {
+    if (!isalpha(reader->c)) {
+      tokenizer->token = PLX_TOKEN_ERROR;
+      return;
+    }
+    tokenizer->len = 0;
+    do {
+      plx_append_char(tokenizer, plx_read_char(reader));
+    } while (isalnum(reader->c));
+    plx_append_char(tokenizer, '\0');
+    --tokenizer->len;
+    tokenizer->token = PLX_TOKEN_BUILTIN;
+    return;
+  }
+
   // Integer and float literals
   if (isdigit(reader->c)) {
     unsigned long long uint = 0;
@@ -287,6 +323,14 @@ void plx_next_token(struct plx_tokenizer* const tokenizer) {
 
     // Float literals
     if (plx_accept_char(reader, '.')) {
+      // The integer is the start of a range.
+      if (reader->c == '.') {
+        plx_unread_char(reader, '.');
+        tokenizer->token = PLX_TOKEN_INT;
+        tokenizer->uint = uint;
+        return;
+      }
+
       unsigned long long fractional = 0;
       unsigned long long divisor = 1;
       if (!isalnum(reader->c)) {
@@ -391,7 +435,8 @@ void plx_next_token(struct plx_tokenizer* const tokenizer) {
   switch (reader->c) {
     case '.':
       plx_next_char(reader);
-      tokenizer->token = PLX_TOKEN_PERIOD;
+      tokenizer->token = plx_accept_char(reader, '.') ? PLX_TOKEN_RANGE
+                                                      : PLX_TOKEN_PERIOD;
       return;
     case ',':
       plx_next_char(reader);
@@ -441,7 +486,7 @@ void plx_next_token(struct plx_tokenizer* const tokenizer) {
       return;
     case '<':
       plx_next_char(reader);
-      if (plx_accept_char(reader, '>')) {
+      if (plx_accept_char(reader, '<')) {
         tokenizer->token = plx_accept_char(reader, '=')
                                ? PLX_TOKEN_LSHIFT_ASSIGN
                                : PLX_TOKEN_LSHIFT;
@@ -536,15 +581,19 @@ void plx_unexpected_token(const struct plx_tokenizer* const tokenizer) {
     case PLX_TOKEN_VAR:
     case PLX_TOKEN_STRUCT:
     case PLX_TOKEN_FUNC:
+    case PLX_TOKEN_INLINE:
+    case PLX_TOKEN_NOINLINE:
     case PLX_TOKEN_IF:
     case PLX_TOKEN_ELSE:
     case PLX_TOKEN_DEFER:
     case PLX_TOKEN_LOOP:
     case PLX_TOKEN_WHILE:
     case PLX_TOKEN_FOR:
+    case PLX_TOKEN_IN:
     case PLX_TOKEN_CONTINUE:
     case PLX_TOKEN_BREAK:
     case PLX_TOKEN_RETURN:
+    case PLX_TOKEN_TAIL:
     case PLX_TOKEN_AND:
     case PLX_TOKEN_OR:
     case PLX_TOKEN_XOR:
@@ -560,11 +609,15 @@ void plx_unexpected_token(const struct plx_tokenizer* const tokenizer) {
     case PLX_TOKEN_F32:
     case PLX_TOKEN_F64:
     case PLX_TOKEN_BOOL:
+    case PLX_TOKEN_VEC:
     case PLX_TOKEN_TRUE:
     case PLX_TOKEN_FALSE:
     case PLX_TOKEN_IDENTIFIER:
       plx_error("unexpected token `%s`", tokenizer->str);
       break;
+    case PLX_TOKEN_BUILTIN:
+      plx_error("unexpected token `@%s`", tokenizer->str);
+      break;
     default:
       plx_error("unexpected token");
   }
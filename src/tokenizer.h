@@ -31,15 +31,19 @@ enum plx_token {
   PLX_TOKEN_VAR,
   PLX_TOKEN_STRUCT,
   PLX_TOKEN_FUNC,
+  PLX_TOKEN_INLINE,
+  PLX_TOKEN_NOINLINE,
   PLX_TOKEN_IF,
   PLX_TOKEN_ELSE,
   PLX_TOKEN_DEFER,
   PLX_TOKEN_LOOP,
   PLX_TOKEN_WHILE,
   PLX_TOKEN_FOR,
+  PLX_TOKEN_IN,
   PLX_TOKEN_CONTINUE,
   PLX_TOKEN_BREAK,
   PLX_TOKEN_RETURN,
+  PLX_TOKEN_TAIL,
   PLX_TOKEN_AND,
   PLX_TOKEN_OR,
   PLX_TOKEN_XOR,
@@ -55,11 +59,13 @@ enum plx_token {
   PLX_TOKEN_F32,
   PLX_TOKEN_F64,
   PLX_TOKEN_BOOL,
+  PLX_TOKEN_VEC,
   PLX_TOKEN_TRUE,
   PLX_TOKEN_FALSE,
 
   // Identifiers
   PLX_TOKEN_IDENTIFIER,
+  PLX_TOKEN_BUILTIN,
 
   // Literals
   PLX_TOKEN_INT,
@@ -103,6 +109,7 @@ enum plx_token {
   PLX_TOKEN_REM_ASSIGN,
   PLX_TOKEN_REM,
   PLX_TOKEN_REF,
+  PLX_TOKEN_RANGE,
 };
 
 struct plx_tokenizer {
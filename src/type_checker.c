@@ -83,6 +83,43 @@ static void plx_argument_type_mismatch(
   }
 }
 
+static void plx_invalid_vec_len(const struct plx_node* const len) {
+  plx_error("invalid vector length");
+  plx_print_source_code(
+      &len->loc,
+      /*annotation=*/"this should be a power of two from 2 to 64",
+      PLX_SOURCE_ANNOTATION_ERROR);
+}
+
+static void plx_lane_index_out_of_range(const struct plx_node* const index) {
+  plx_error("lane index out of range");
+  plx_print_source_code(&index->loc,
+                        /*annotation=*/"this lane does not exist",
+                        PLX_SOURCE_ANNOTATION_ERROR);
+}
+
+static bool plx_is_valid_vec_len(const unsigned long long len) {
+  return len >= 2 && len <= 64 && (len & (len - 1)) == 0;
+}
+
+// Returns a new vector type with `len` lanes of a type.
+static struct plx_node* plx_new_vec_type(const unsigned long long len,
+                                         const struct plx_node* const type) {
+  struct plx_node* const vec_type =
+      plx_new_node(PLX_NODE_VEC_TYPE, /*loc=*/NULL);
+  vec_type->children = plx_new_node(PLX_NODE_S32, /*loc=*/NULL);
+  vec_type->children->uint = len;
+  vec_type->children->next = plx_copy_node(type);
+  return vec_type;
+}
+
+// Returns whether either operand of an expression is a vector.
+static bool plx_has_vec_operand(const struct plx_node* const left,
+                                const struct plx_node* const right) {
+  return (left->type != NULL && plx_is_vec_type(left->type)) ||
+         (right->type != NULL && plx_is_vec_type(right->type));
+}
+
 static void plx_set_identifier_type(struct plx_node* const identifier,
                                     const struct plx_node* const type) {
   identifier->type = type;
@@ -141,10 +178,7 @@ bool plx_type_check(struct plx_node* const node,
       // Type check the return type.
       if (!plx_type_check(return_type, return_type)) result = false;
 
-      // Type check the body.
-      if (!plx_type_check(body, return_type)) result = false;
-
-      // Set the identifier type.
+      // Set the identifier type before the body, which may call the function.
       struct plx_node* const param_types =
           plx_new_node(PLX_NODE_OTHER, /*loc=*/NULL);
       struct plx_node** next = &param_types->children;
@@ -158,8 +192,11 @@ bool plx_type_check(struct plx_node* const node,
       struct plx_node* const type =
           plx_new_node(PLX_NODE_FUNC_TYPE, /*loc=*/NULL);
       type->children = param_types;
-      param_types->next = return_type;
+      param_types->next = plx_copy_node(return_type);
       plx_set_identifier_type(name, type);
+
+      // Type check the body.
+      if (!plx_type_check(body, return_type)) result = false;
       break;
     }
     case PLX_NODE_NOP:
@@ -207,6 +244,31 @@ bool plx_type_check(struct plx_node* const node,
       if (!plx_type_check(body, return_type)) result = false;
       break;
     }
+    case PLX_NODE_FOR_LOOP: {
+      struct plx_node *name, *iterable, *body;
+      plx_extract_children(node, &name, &iterable, &body);
+
+      // Type check the range, array, or slice.
+      if (!plx_type_check(iterable, return_type)) result = false;
+      if (iterable->type != NULL) {
+        if (iterable->kind == PLX_NODE_RANGE) {
+          plx_set_identifier_type(name, iterable->type);
+        } else if (iterable->type->kind == PLX_NODE_ARRAY_TYPE) {
+          // The element type follows the length.
+          plx_set_identifier_type(name, iterable->type->children->next);
+        } else if (iterable->type->kind == PLX_NODE_SLICE_TYPE) {
+          plx_set_identifier_type(name, iterable->type->children);
+        } else {
+          plx_unexpected_type(iterable,
+                              /*expected=*/"a range, array, or slice");
+          result = false;
+        }
+      }
+
+      // Type check the body.
+      if (!plx_type_check(body, return_type)) result = false;
+      break;
+    }
     case PLX_NODE_RETURN: {
       struct plx_node* return_value;
       plx_extract_children(node, &return_value);
@@ -254,7 +316,8 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the assignee.
       if (!plx_type_check(assignee, return_type)) result = false;
-      if (assignee->type != NULL && !plx_is_numeric_type(assignee->type)) {
+      if (assignee->type != NULL &&
+          !plx_is_numeric_type(plx_lane_type(assignee->type))) {
         plx_unexpected_type(assignee, /*expected=*/"a number");
         result = false;
         break;
@@ -262,7 +325,8 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the value.
       if (!plx_type_check(value, return_type)) result = false;
-      if (value->type != NULL && !plx_is_numeric_type(value->type)) {
+      if (value->type != NULL &&
+          !plx_is_numeric_type(plx_lane_type(value->type))) {
         plx_unexpected_type(value, /*expected=*/"a number");
         result = false;
         break;
@@ -284,7 +348,8 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the assignee.
       if (!plx_type_check(assignee, return_type)) result = false;
-      if (assignee->type != NULL && !plx_is_int_type(assignee->type)) {
+      if (assignee->type != NULL &&
+          !plx_is_int_type(plx_lane_type(assignee->type))) {
         plx_unexpected_type(assignee, /*expected=*/"an integer");
         result = false;
         break;
@@ -292,9 +357,17 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the value operand.
       if (!plx_type_check(value, return_type)) result = false;
-      if (value->type != NULL && !plx_is_int_type(value->type)) {
+      if (value->type != NULL && !plx_is_int_type(plx_lane_type(value->type))) {
         plx_unexpected_type(value, /*expected=*/"an integer");
         result = false;
+        break;
+      }
+
+      // Vectors are only combined with vectors of the same type.
+      if (plx_has_vec_operand(assignee, value) &&
+          !plx_type_eq(assignee->type, value->type)) {
+        plx_operand_type_mismatch(node);
+        result = false;
       }
       break;
     }
@@ -306,7 +379,8 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the left operand.
       if (!plx_type_check(left, return_type)) result = false;
-      if (left->type != NULL && !plx_is_logical_type(left->type)) {
+      if (left->type != NULL &&
+          !plx_is_logical_type(plx_lane_type(left->type))) {
         plx_unexpected_type(left, /*expected=*/"an integer or bool");
         result = false;
         break;
@@ -314,14 +388,15 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the right operand.
       if (!plx_type_check(right, return_type)) result = false;
-      if (right->type != NULL && !plx_is_logical_type(right->type)) {
+      if (right->type != NULL &&
+          !plx_is_logical_type(plx_lane_type(right->type))) {
         plx_unexpected_type(right, /*expected=*/"an integer or bool");
         result = false;
         break;
       }
 
       // Check for matching types.
-      if (!plx_type_eq(left, right)) {
+      if (!plx_type_eq(left->type, right->type)) {
         plx_operand_type_mismatch(node);
         result = false;
         break;
@@ -343,7 +418,8 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the left operand.
       if (!plx_type_check(left, return_type)) result = false;
-      if (left->type != NULL && !plx_is_equality_type(left->type)) {
+      if (left->type != NULL &&
+          !plx_is_equality_type(plx_lane_type(left->type))) {
         plx_unexpected_type(left, /*expected=*/"an integer, bool, or string");
         result = false;
         break;
@@ -351,16 +427,23 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the right operand.
       if (!plx_type_check(right, return_type)) result = false;
-      if (right->type != NULL && !plx_is_equality_type(right->type)) {
+      if (right->type != NULL &&
+          !plx_is_equality_type(plx_lane_type(right->type))) {
         plx_unexpected_type(right, /*expected=*/"an integer, bool, or string");
         result = false;
         break;
       }
 
       // Check for matching types.
-      if (!plx_type_eq(left, right)) {
+      if (!plx_type_eq(left->type, right->type)) {
         plx_operand_type_mismatch(node);
         result = false;
+        break;
+      }
+
+      // Vectors are compared lane by lane.
+      if (plx_is_vec_type(left->type)) {
+        node->type = plx_new_vec_type(plx_vec_len(left->type), &bool_type);
       }
       break;
     }
@@ -376,7 +459,8 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the left operand.
       if (!plx_type_check(left, return_type)) result = false;
-      if (left->type != NULL && !plx_is_numeric_type(left->type)) {
+      if (left->type != NULL &&
+          !plx_is_numeric_type(plx_lane_type(left->type))) {
         plx_unexpected_type(left, /*expected=*/"a number");
         result = false;
         break;
@@ -384,7 +468,8 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the right operand.
       if (!plx_type_check(right, return_type)) result = false;
-      if (right->type != NULL && !plx_is_numeric_type(right->type)) {
+      if (right->type != NULL &&
+          !plx_is_numeric_type(plx_lane_type(right->type))) {
         plx_unexpected_type(right, /*expected=*/"a number");
         result = false;
         break;
@@ -394,6 +479,12 @@ bool plx_type_check(struct plx_node* const node,
       if (!plx_type_eq(left->type, right->type)) {
         plx_operand_type_mismatch(node);
         result = false;
+        break;
+      }
+
+      // Vectors are compared lane by lane.
+      if (plx_is_vec_type(left->type)) {
+        node->type = plx_new_vec_type(plx_vec_len(left->type), &bool_type);
       }
       break;
     }
@@ -406,7 +497,8 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the left operand.
       if (!plx_type_check(left, return_type)) result = false;
-      if (left->type != NULL && !plx_is_numeric_type(left->type)) {
+      if (left->type != NULL &&
+          !plx_is_numeric_type(plx_lane_type(left->type))) {
         plx_unexpected_type(left, /*expected=*/"a number");
         result = false;
         break;
@@ -414,7 +506,8 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the right operand.
       if (!plx_type_check(right, return_type)) result = false;
-      if (right->type != NULL && !plx_is_numeric_type(right->type)) {
+      if (right->type != NULL &&
+          !plx_is_numeric_type(plx_lane_type(right->type))) {
         plx_unexpected_type(right, /*expected=*/"a number");
         result = false;
         break;
@@ -441,7 +534,7 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the left operand.
       if (!plx_type_check(left, return_type)) result = false;
-      if (left->type != NULL && !plx_is_int_type(left->type)) {
+      if (left->type != NULL && !plx_is_int_type(plx_lane_type(left->type))) {
         plx_unexpected_type(left, /*expected=*/"an integer");
         result = false;
         break;
@@ -449,7 +542,7 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the right operand.
       if (!plx_type_check(right, return_type)) result = false;
-      if (right->type != NULL && !plx_is_int_type(right->type)) {
+      if (right->type != NULL && !plx_is_int_type(plx_lane_type(right->type))) {
         plx_unexpected_type(right, /*expected=*/"an integer");
         result = false;
         break;
@@ -474,7 +567,8 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the operand.
       if (!plx_type_check(operand, return_type)) result = false;
-      if (operand->type != NULL && !plx_is_logical_type(operand->type)) {
+      if (operand->type != NULL &&
+          !plx_is_logical_type(plx_lane_type(operand->type))) {
         plx_unexpected_type(operand, /*expected=*/"an integer or bool");
         result = false;
         break;
@@ -490,7 +584,8 @@ bool plx_type_check(struct plx_node* const node,
 
       // Type check the operand.
       if (!plx_type_check(operand, return_type)) result = false;
-      if (operand->type != NULL && !plx_is_numeric_type(operand->type)) {
+      if (operand->type != NULL &&
+          !plx_is_numeric_type(plx_lane_type(operand->type))) {
         plx_unexpected_type(operand->type, /*expected=*/"a number");
         result = false;
         break;
@@ -580,6 +675,8 @@ bool plx_type_check(struct plx_node* const node,
           plx_argument_type_mismatch(arg, param_type);
           result = false;
         }
+        arg = arg->next;
+        param_type = param_type->next;
       }
       break;
     }
@@ -590,12 +687,17 @@ bool plx_type_check(struct plx_node* const node,
       // Type check the value.
       if (!plx_type_check(value, return_type)) result = false;
       if (value->type != NULL) {
-        if (value->type->kind == PLX_NODE_ARRAY_TYPE ||
-            value->type->kind == PLX_NODE_SLICE_TYPE) {
+        if (value->type->kind == PLX_NODE_ARRAY_TYPE) {
+          // Set the type. The element type follows the length.
+          node->type = value->type->children->next;
+        } else if (value->type->kind == PLX_NODE_SLICE_TYPE) {
           // Set the type.
           node->type = value->type->children;
+        } else if (plx_is_vec_type(value->type)) {
+          // Set the type.
+          node->type = plx_lane_type(value->type);
         } else {
-          plx_unexpected_type(value, /*expected=*/"an array or slice");
+          plx_unexpected_type(value, /*expected=*/"an array, slice, or vector");
           result = false;
         }
       }
@@ -608,6 +710,38 @@ bool plx_type_check(struct plx_node* const node,
       }
       break;
     }
+    case PLX_NODE_RANGE: {
+      struct plx_node *start, *end;
+      plx_extract_children(node, &start, &end);
+
+      // Type check the start.
+      if (!plx_type_check(start, return_type)) result = false;
+      if (start->type != NULL && !plx_is_int_type(start->type)) {
+        plx_unexpected_type(start, /*expected=*/"an integer");
+        result = false;
+        break;
+      }
+
+      // Type check the end.
+      if (!plx_type_check(end, return_type)) result = false;
+      if (end->type != NULL && !plx_is_int_type(end->type)) {
+        plx_unexpected_type(end, /*expected=*/"an integer");
+        result = false;
+        break;
+      }
+
+      // Check for matching types.
+      if (start->type == NULL || end->type == NULL) break;
+      if (!plx_type_eq(start->type, end->type)) {
+        plx_operand_type_mismatch(node);
+        result = false;
+        break;
+      }
+
+      // Set the type.
+      node->type = start->type;
+      break;
+    }
     case PLX_NODE_SLICE: {
       struct plx_node *value, *start, *end;
       plx_extract_children(node, &value, &start, &end);
@@ -615,8 +749,10 @@ bool plx_type_check(struct plx_node* const node,
       // Type check the value.
       if (!plx_type_check(value, return_type)) result = false;
       if (value->type != NULL) {
-        if (value->type->kind == PLX_NODE_ARRAY_TYPE ||
-            value->type->kind == PLX_NODE_SLICE_TYPE) {
+        if (value->type->kind == PLX_NODE_ARRAY_TYPE) {
+          // Set the type. The element type follows the length.
+          node->type = value->type->children->next;
+        } else if (value->type->kind == PLX_NODE_SLICE_TYPE) {
           // Set the type.
           node->type = value->type->children;
         } else {
@@ -640,6 +776,129 @@ bool plx_type_check(struct plx_node* const node,
       }
       break;
     }
+    case PLX_NODE_SELECT: {
+      struct plx_node *mask, *left, *right;
+      plx_extract_children(node, &mask, &left, &right);
+
+      // Type check the mask.
+      if (!plx_type_check(mask, return_type)) result = false;
+      if (mask->type != NULL &&
+          plx_lane_type(mask->type)->kind != PLX_NODE_BOOL_TYPE) {
+        plx_unexpected_type(mask, /*expected=*/"a bool or vector of bools");
+        result = false;
+        break;
+      }
+
+      // Type check the values.
+      if (!plx_type_check(left, return_type)) result = false;
+      if (!plx_type_check(right, return_type)) result = false;
+      if (left->type == NULL || right->type == NULL) break;
+      if (!plx_type_eq(left->type, right->type)) {
+        plx_operand_type_mismatch(node);
+        result = false;
+        break;
+      }
+
+      // A vector mask selects each lane separately.
+      if (mask->type != NULL && plx_is_vec_type(mask->type) &&
+          (!plx_is_vec_type(left->type) ||
+           plx_vec_len(left->type) != plx_vec_len(mask->type))) {
+        plx_operand_type_mismatch(node);
+        result = false;
+        break;
+      }
+
+      // Set the type.
+      node->type = left->type;
+      break;
+    }
+    case PLX_NODE_SHUFFLE: {
+      struct plx_node *left, *right, *indices;
+      plx_extract_children(node, &left, &right, &indices);
+
+      // Type check the vectors.
+      if (!plx_type_check(left, return_type)) result = false;
+      if (left->type != NULL && !plx_is_vec_type(left->type)) {
+        plx_unexpected_type(left, /*expected=*/"a vector");
+        result = false;
+        break;
+      }
+      if (!plx_type_check(right, return_type)) result = false;
+      if (right->type != NULL && !plx_is_vec_type(right->type)) {
+        plx_unexpected_type(right, /*expected=*/"a vector");
+        result = false;
+        break;
+      }
+      if (left->type == NULL || right->type == NULL) break;
+      if (!plx_type_eq(left->type, right->type)) {
+        plx_operand_type_mismatch(node);
+        result = false;
+        break;
+      }
+
+      // Check that the indices select lanes of either vector.
+      const unsigned long long len = plx_vec_len(left->type);
+      unsigned long long index_count = 0;
+      for (const struct plx_node* index = indices->children; index != NULL;
+           index = index->next) {
+        if (index->uint >= 2 * len) {
+          plx_lane_index_out_of_range(index);
+          result = false;
+        }
+        ++index_count;
+      }
+      if (!plx_is_valid_vec_len(index_count)) {
+        plx_invalid_vec_len(indices);
+        result = false;
+        break;
+      }
+
+      // Set the type.
+      node->type = plx_new_vec_type(index_count, plx_lane_type(left->type));
+      break;
+    }
+    case PLX_NODE_REDUCE_ADD:
+    case PLX_NODE_REDUCE_MUL:
+    case PLX_NODE_REDUCE_MIN:
+    case PLX_NODE_REDUCE_MAX: {
+      struct plx_node* operand;
+      plx_extract_children(node, &operand);
+
+      // Type check the operand.
+      if (!plx_type_check(operand, return_type)) result = false;
+      if (operand->type == NULL) break;
+      if (!plx_is_vec_type(operand->type) ||
+          !plx_is_numeric_type(plx_lane_type(operand->type))) {
+        plx_unexpected_type(operand, /*expected=*/"a vector of numbers");
+        result = false;
+        break;
+      }
+
+      // Set the type.
+      node->type = plx_lane_type(operand->type);
+      break;
+    }
+    case PLX_NODE_REDUCE_AND:
+    case PLX_NODE_REDUCE_OR:
+    case PLX_NODE_REDUCE_XOR: {
+      struct plx_node* operand;
+      plx_extract_children(node, &operand);
+
+      // Type check the operand.
+      if (!plx_type_check(operand, return_type)) result = false;
+      if (operand->type == NULL) break;
+      if (!plx_is_vec_type(operand->type) ||
+          !plx_is_logical_type(plx_lane_type(operand->type))) {
+        plx_unexpected_type(operand,
+                            /*expected=*/"a vector of integers or bools");
+        result = false;
+        break;
+      }
+
+      // Set the type.
+      node->type = plx_lane_type(operand->type);
+      break;
+    }
     case PLX_NODE_FIELD: {
       struct plx_node *value, *name;
       plx_extract_children(node, &value, &name);
@@ -690,6 +949,24 @@ bool plx_type_check(struct plx_node* const node,
     case PLX_NODE_STRING:
       node->type = &string_type;
       break;
+    case PLX_NODE_VEC_TYPE: {
+      struct plx_node *len, *element_type;
+      plx_extract_children(node, &len, &element_type);
+
+      // Check the number of lanes.
+      if (!plx_is_valid_vec_len(len->uint)) {
+        plx_invalid_vec_len(len);
+        result = false;
+      }
+
+      // Check the lane type.
+      if (!plx_is_numeric_type(element_type) &&
+          element_type->kind != PLX_NODE_BOOL_TYPE) {
+        plx_unexpected_type(element_type, /*expected=*/"a number or bool");
+        result = false;
+      }
+      break;
+    }
     default:
       for (struct plx_node* child = node->children; child != NULL;
            child = child->next) {
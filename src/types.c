@@ -46,6 +46,24 @@ bool plx_is_equality_type(const struct plx_node* const type) {
          type->kind == PLX_NODE_STRING_TYPE;
 }
 
+bool plx_is_scalar_type(const struct plx_node* const type) {
+  return plx_is_numeric_type(type) || type->kind == PLX_NODE_BOOL_TYPE ||
+         type->kind == PLX_NODE_FUNC_TYPE || type->kind == PLX_NODE_REF_TYPE;
+}
+
+bool plx_is_vec_type(const struct plx_node* const type) {
+  return type->kind == PLX_NODE_VEC_TYPE;
+}
+
+unsigned long long plx_vec_len(const struct plx_node* const type) {
+  return type->children->uint;
+}
+
+const struct plx_node* plx_lane_type(const struct plx_node* const type) {
+  // The lane type follows the length.
+  return plx_is_vec_type(type) ? type->children->next : type;
+}
+
 bool plx_type_eq(const struct plx_node* const type_a,
                  const struct plx_node* const type_b) {
   if (type_a == type_b) return true;
@@ -53,6 +71,10 @@ bool plx_type_eq(const struct plx_node* const type_a,
   if (type_a->kind == PLX_NODE_IDENTIFIER) {
     return type_a->entry == type_b->entry;
   }
+  if (type_a->kind == PLX_NODE_VEC_TYPE &&
+      plx_vec_len(type_a) != plx_vec_len(type_b)) {
+    return false;
+  }
   const struct plx_node* child_a = type_a->children;
   const struct plx_node* child_b = type_b->children;
   while (child_a != NULL && child_b != NULL) {
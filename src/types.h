@@ -40,6 +40,18 @@ bool plx_is_logical_type(const struct plx_node* type);
 // Returns whether a type can be used in equality operations.
 bool plx_is_equality_type(const struct plx_node* type);
 
+// Returns whether a type is a scalar that fits in a single register.
+bool plx_is_scalar_type(const struct plx_node* type);
+
+// Returns whether a type is a SIMD vector type, e.g. `vec[4]f32`.
+bool plx_is_vec_type(const struct plx_node* type);
+
+// Returns the number of lanes of a vector type.
+unsigned long long plx_vec_len(const struct plx_node* type);
+
+// Returns the lane type of a vector type, or the type itself otherwise.
+const struct plx_node* plx_lane_type(const struct plx_node* type);
+
 // Returns whether two types are equal.
 bool plx_type_eq(const struct plx_node* type_a, const struct plx_node* type_b);
 
@@ -14,35 +14,159 @@
 
 #include "wasm.h"
 
+#include <assert.h>
 #include <string.h>
 
+#ifndef _WIN32
+#include <errno.h>
+#include <sys/uio.h>
+#endif  // _WIN32
+
 #include "leb128.h"
+#include "macros.h"
 
-void plx_wasm_write_module_preamble(FILE* const stream) {
+void plx_wasm_write_module_preamble(struct plx_buffer* const buffer) {
   const char preamble[] = {// Magic
                            '\0', 'a', 's', 'm',
                            // Version
                            1, 0, 0, 0};
-  fwrite(preamble, sizeof(*preamble), sizeof(preamble), stream);
+  plx_buffer_append(buffer, preamble, sizeof(preamble));
 }
 
-void plx_wasm_write_section_header(FILE* const stream,
+void plx_wasm_write_section_header(struct plx_buffer* const buffer,
                                    const enum plx_wasm_section_id id,
                                    const size_t size) {
-  fputc(id, stream);
-  plx_wasm_write_ull(stream, size);
+  plx_buffer_append_char(buffer, (char)id);
+  plx_wasm_write_ull(buffer, size);
+}
+
+void plx_wasm_write_ull(struct plx_buffer* const buffer,
+                        const unsigned long long value) {
+  plx_append_leb128_ull(buffer, value);
+}
+
+void plx_wasm_write_ll(struct plx_buffer* const buffer, const long long value) {
+  plx_append_leb128_ll(buffer, value);
 }
 
-void plx_wasm_write_ull(FILE* const stream, const unsigned long long value) {
-  plx_write_leb128_ull(stream, value);
+void plx_wasm_write_vector_instruction(
+    struct plx_buffer* const buffer,
+    const enum plx_wasm_vector_instruction instruction) {
+  plx_buffer_append_char(buffer, (char)PLX_WASM_VECTOR_PREFIX);
+  plx_wasm_write_ull(buffer, instruction);
 }
 
-void plx_wasm_write_ll(FILE* const stream, const long long value) {
-  plx_write_leb128_ll(stream, value);
+void plx_wasm_write_memarg(struct plx_buffer* const buffer,
+                           const unsigned int align,
+                           const unsigned long long offset) {
+  plx_wasm_write_ull(buffer, align);
+  plx_wasm_write_ull(buffer, offset);
 }
 
-void plx_wasm_write_name(FILE* const stream, const char* const name) {
+void plx_wasm_write_name(struct plx_buffer* const buffer,
+                         const char* const name) {
   const size_t len = strlen(name);
-  plx_wasm_write_ull(stream, len);
-  fwrite(name, sizeof(*name), len, stream);
+  plx_wasm_write_ull(buffer, len);
+  plx_buffer_append(buffer, name, len);
+}
+
+#ifdef _WIN32
+// Windows has no `writev`, so the parts of the module are written one at a
+// time.
+struct iovec {
+  void* iov_base;
+  size_t iov_len;
+};
+#endif  // _WIN32
+
+// Writes the parts to the output stream, retrying after partial writes.
+static bool plx_wasm_write_parts(FILE* const stream, struct iovec* parts,
+                                 size_t part_count) {
+#ifdef _WIN32
+  for (size_t i = 0; i < part_count; ++i) {
+    if (plx_unlikely(fwrite(parts[i].iov_base, sizeof(char), parts[i].iov_len,
+                            stream) != parts[i].iov_len)) {
+      return false;
+    }
+  }
+  return true;
+#else
+  // The parts bypass the stream's own buffering, so anything already written
+  // to it must reach the file first.
+  if (plx_unlikely(fflush(stream) != 0)) return false;
+  const int fd = fileno(stream);
+  while (part_count > 0) {
+    const ssize_t written = writev(fd, parts, (int)part_count);
+    if (plx_unlikely(written < 0)) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+
+    // Skip the parts that were written in full and the written prefix of the
+    // first part that was not.
+    size_t remaining = (size_t)written;
+    while (part_count > 0 && remaining >= parts->iov_len) {
+      remaining -= parts->iov_len;
+      ++parts;
+      --part_count;
+    }
+    if (part_count > 0) {
+      parts->iov_base = (char*)parts->iov_base + remaining;
+      parts->iov_len -= remaining;
+    }
+  }
+  return true;
+#endif  // _WIN32
+}
+
+bool plx_wasm_write_module(FILE* const stream,
+                           const struct plx_wasm_section* const sections,
+                           const size_t section_count) {
+  assert(section_count <= PLX_WASM_MAX_SECTIONS);
+
+  // Write the preamble and the section headers into one buffer, recording
+  // where each header ends. The buffer may move as it grows, so the parts are
+  // only collected once it is complete.
+  struct plx_buffer headers = PLX_BUFFER_INIT;
+  plx_wasm_write_module_preamble(&headers);
+  const size_t preamble_len = headers.len;
+  size_t header_ends[PLX_WASM_MAX_SECTIONS];
+  for (size_t i = 0; i < section_count; ++i) {
+    plx_wasm_write_section_header(&headers, sections[i].id,
+                                  sections[i].contents.len);
+    header_ends[i] = headers.len;
+  }
+
+  // Interleave the headers with the sections' contents.
+  struct iovec parts[1 + 2 * PLX_WASM_MAX_SECTIONS];
+  size_t part_count = 0;
+  parts[part_count++] = (struct iovec){headers.data, preamble_len};
+  size_t header_start = preamble_len;
+  for (size_t i = 0; i < section_count; ++i) {
+    parts[part_count++] = (struct iovec){headers.data + header_start,
+                                         header_ends[i] - header_start};
+    header_start = header_ends[i];
+    if (sections[i].contents.len == 0) continue;
+    parts[part_count++] = (struct iovec){sections[i].contents.data,
+                                         sections[i].contents.len};
+  }
+
+  const bool result = plx_wasm_write_parts(stream, parts, part_count);
+  plx_buffer_free(&headers);
+  return result;
+}
+
+size_t plx_wasm_module_size(const struct plx_wasm_section* const sections,
+                            const size_t section_count) {
+  struct plx_buffer headers = PLX_BUFFER_INIT;
+  plx_wasm_write_module_preamble(&headers);
+  size_t size = 0;
+  for (size_t i = 0; i < section_count; ++i) {
+    plx_wasm_write_section_header(&headers, sections[i].id,
+                                  sections[i].contents.len);
+    size += sections[i].contents.len;
+  }
+  size += headers.len;
+  plx_buffer_free(&headers);
+  return size;
 }
@@ -15,9 +15,12 @@
 #ifndef PLX_WASM_H
 #define PLX_WASM_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 
+#include "buffer.h"
+
 // WebAssembly value types
 // https://webassembly.github.io/spec/core/binary/types.html
 enum plx_wasm_value_type {
@@ -57,6 +60,9 @@ enum plx_wasm_instruction {
   PLX_WASM_RETURN = 0x0F,
   PLX_WASM_CALL = 0x10,
   PLX_WASM_CALL_INDIRECT = 0x11,
+  // Tail call proposal
+  PLX_WASM_RETURN_CALL = 0x12,
+  PLX_WASM_RETURN_CALL_INDIRECT = 0x13,
 
   // Reference instructions
   PLX_WASM_REF_NULL = 0xD0,
@@ -223,6 +229,268 @@ enum plx_wasm_instruction {
   PLX_WASM_F64_MIN = 0xA4,
   PLX_WASM_F64_MAX = 0xA5,
   PLX_WASM_F64_COPYSIGN = 0xA6,
+
+  // Vector instructions
+  PLX_WASM_VECTOR_PREFIX = 0xFD,
+};
+
+// WebAssembly vector instructions, which follow the
+// `PLX_WASM_VECTOR_PREFIX` byte as an unsigned LEB128 integer.
+// https://webassembly.github.io/spec/core/binary/instructions.html#vector-instructions
+enum plx_wasm_vector_instruction {
+  // Memory instructions
+  PLX_WASM_V128_LOAD = 0x00,
+  PLX_WASM_V128_LOAD8X8_S = 0x01,
+  PLX_WASM_V128_LOAD8X8_U = 0x02,
+  PLX_WASM_V128_LOAD16X4_S = 0x03,
+  PLX_WASM_V128_LOAD16X4_U = 0x04,
+  PLX_WASM_V128_LOAD32X2_S = 0x05,
+  PLX_WASM_V128_LOAD32X2_U = 0x06,
+  PLX_WASM_V128_LOAD8_SPLAT = 0x07,
+  PLX_WASM_V128_LOAD16_SPLAT = 0x08,
+  PLX_WASM_V128_LOAD32_SPLAT = 0x09,
+  PLX_WASM_V128_LOAD64_SPLAT = 0x0A,
+  PLX_WASM_V128_STORE = 0x0B,
+
+  // Constant
+  PLX_WASM_V128_CONST = 0x0C,
+
+  // Lane instructions
+  PLX_WASM_I8X16_SHUFFLE = 0x0D,
+  PLX_WASM_I8X16_SWIZZLE = 0x0E,
+  PLX_WASM_I8X16_SPLAT = 0x0F,
+  PLX_WASM_I16X8_SPLAT = 0x10,
+  PLX_WASM_I32X4_SPLAT = 0x11,
+  PLX_WASM_I64X2_SPLAT = 0x12,
+  PLX_WASM_F32X4_SPLAT = 0x13,
+  PLX_WASM_F64X2_SPLAT = 0x14,
+  PLX_WASM_I8X16_EXTRACT_LANE_S = 0x15,
+  PLX_WASM_I8X16_EXTRACT_LANE_U = 0x16,
+  PLX_WASM_I8X16_REPLACE_LANE = 0x17,
+  PLX_WASM_I16X8_EXTRACT_LANE_S = 0x18,
+  PLX_WASM_I16X8_EXTRACT_LANE_U = 0x19,
+  PLX_WASM_I16X8_REPLACE_LANE = 0x1A,
+  PLX_WASM_I32X4_EXTRACT_LANE = 0x1B,
+  PLX_WASM_I32X4_REPLACE_LANE = 0x1C,
+  PLX_WASM_I64X2_EXTRACT_LANE = 0x1D,
+  PLX_WASM_I64X2_REPLACE_LANE = 0x1E,
+  PLX_WASM_F32X4_EXTRACT_LANE = 0x1F,
+  PLX_WASM_F32X4_REPLACE_LANE = 0x20,
+  PLX_WASM_F64X2_EXTRACT_LANE = 0x21,
+  PLX_WASM_F64X2_REPLACE_LANE = 0x22,
+
+  // Comparison instructions
+  PLX_WASM_I8X16_EQ = 0x23,
+  PLX_WASM_I8X16_NE = 0x24,
+  PLX_WASM_I8X16_LT_S = 0x25,
+  PLX_WASM_I8X16_LT_U = 0x26,
+  PLX_WASM_I8X16_GT_S = 0x27,
+  PLX_WASM_I8X16_GT_U = 0x28,
+  PLX_WASM_I8X16_LE_S = 0x29,
+  PLX_WASM_I8X16_LE_U = 0x2A,
+  PLX_WASM_I8X16_GE_S = 0x2B,
+  PLX_WASM_I8X16_GE_U = 0x2C,
+  PLX_WASM_I16X8_EQ = 0x2D,
+  PLX_WASM_I16X8_NE = 0x2E,
+  PLX_WASM_I16X8_LT_S = 0x2F,
+  PLX_WASM_I16X8_LT_U = 0x30,
+  PLX_WASM_I16X8_GT_S = 0x31,
+  PLX_WASM_I16X8_GT_U = 0x32,
+  PLX_WASM_I16X8_LE_S = 0x33,
+  PLX_WASM_I16X8_LE_U = 0x34,
+  PLX_WASM_I16X8_GE_S = 0x35,
+  PLX_WASM_I16X8_GE_U = 0x36,
+  PLX_WASM_I32X4_EQ = 0x37,
+  PLX_WASM_I32X4_NE = 0x38,
+  PLX_WASM_I32X4_LT_S = 0x39,
+  PLX_WASM_I32X4_LT_U = 0x3A,
+  PLX_WASM_I32X4_GT_S = 0x3B,
+  PLX_WASM_I32X4_GT_U = 0x3C,
+  PLX_WASM_I32X4_LE_S = 0x3D,
+  PLX_WASM_I32X4_LE_U = 0x3E,
+  PLX_WASM_I32X4_GE_S = 0x3F,
+  PLX_WASM_I32X4_GE_U = 0x40,
+  PLX_WASM_F32X4_EQ = 0x41,
+  PLX_WASM_F32X4_NE = 0x42,
+  PLX_WASM_F32X4_LT = 0x43,
+  PLX_WASM_F32X4_GT = 0x44,
+  PLX_WASM_F32X4_LE = 0x45,
+  PLX_WASM_F32X4_GE = 0x46,
+  PLX_WASM_F64X2_EQ = 0x47,
+  PLX_WASM_F64X2_NE = 0x48,
+  PLX_WASM_F64X2_LT = 0x49,
+  PLX_WASM_F64X2_GT = 0x4A,
+  PLX_WASM_F64X2_LE = 0x4B,
+  PLX_WASM_F64X2_GE = 0x4C,
+
+  // Bitwise instructions
+  PLX_WASM_V128_NOT = 0x4D,
+  PLX_WASM_V128_AND = 0x4E,
+  PLX_WASM_V128_ANDNOT = 0x4F,
+  PLX_WASM_V128_OR = 0x50,
+  PLX_WASM_V128_XOR = 0x51,
+  PLX_WASM_V128_BITSELECT = 0x52,
+  PLX_WASM_V128_ANY_TRUE = 0x53,
+
+  // Memory instructions
+  PLX_WASM_V128_LOAD8_LANE = 0x54,
+  PLX_WASM_V128_LOAD16_LANE = 0x55,
+  PLX_WASM_V128_LOAD32_LANE = 0x56,
+  PLX_WASM_V128_LOAD64_LANE = 0x57,
+  PLX_WASM_V128_STORE8_LANE = 0x58,
+  PLX_WASM_V128_STORE16_LANE = 0x59,
+  PLX_WASM_V128_STORE32_LANE = 0x5A,
+  PLX_WASM_V128_STORE64_LANE = 0x5B,
+  PLX_WASM_V128_LOAD32_ZERO = 0x5C,
+  PLX_WASM_V128_LOAD64_ZERO = 0x5D,
+
+  // Arithmetic and conversion instructions
+  PLX_WASM_F32X4_DEMOTE_F64X2_ZERO = 0x5E,
+  PLX_WASM_F64X2_PROMOTE_LOW_F32X4 = 0x5F,
+  PLX_WASM_I8X16_ABS = 0x60,
+  PLX_WASM_I8X16_NEG = 0x61,
+  PLX_WASM_I8X16_POPCNT = 0x62,
+  PLX_WASM_I8X16_ALL_TRUE = 0x63,
+  PLX_WASM_I8X16_BITMASK = 0x64,
+  PLX_WASM_I8X16_NARROW_I16X8_S = 0x65,
+  PLX_WASM_I8X16_NARROW_I16X8_U = 0x66,
+  PLX_WASM_F32X4_CEIL = 0x67,
+  PLX_WASM_F32X4_FLOOR = 0x68,
+  PLX_WASM_F32X4_TRUNC = 0x69,
+  PLX_WASM_F32X4_NEAREST = 0x6A,
+  PLX_WASM_I8X16_SHL = 0x6B,
+  PLX_WASM_I8X16_SHR_S = 0x6C,
+  PLX_WASM_I8X16_SHR_U = 0x6D,
+  PLX_WASM_I8X16_ADD = 0x6E,
+  PLX_WASM_I8X16_ADD_SAT_S = 0x6F,
+  PLX_WASM_I8X16_ADD_SAT_U = 0x70,
+  PLX_WASM_I8X16_SUB = 0x71,
+  PLX_WASM_I8X16_SUB_SAT_S = 0x72,
+  PLX_WASM_I8X16_SUB_SAT_U = 0x73,
+  PLX_WASM_F64X2_CEIL = 0x74,
+  PLX_WASM_F64X2_FLOOR = 0x75,
+  PLX_WASM_I8X16_MIN_S = 0x76,
+  PLX_WASM_I8X16_MIN_U = 0x77,
+  PLX_WASM_I8X16_MAX_S = 0x78,
+  PLX_WASM_I8X16_MAX_U = 0x79,
+  PLX_WASM_F64X2_TRUNC = 0x7A,
+  PLX_WASM_I8X16_AVGR_U = 0x7B,
+  PLX_WASM_I16X8_EXTADD_PAIRWISE_I8X16_S = 0x7C,
+  PLX_WASM_I16X8_EXTADD_PAIRWISE_I8X16_U = 0x7D,
+  PLX_WASM_I32X4_EXTADD_PAIRWISE_I16X8_S = 0x7E,
+  PLX_WASM_I32X4_EXTADD_PAIRWISE_I16X8_U = 0x7F,
+  PLX_WASM_I16X8_ABS = 0x80,
+  PLX_WASM_I16X8_NEG = 0x81,
+  PLX_WASM_I16X8_Q15MULR_SAT_S = 0x82,
+  PLX_WASM_I16X8_ALL_TRUE = 0x83,
+  PLX_WASM_I16X8_BITMASK = 0x84,
+  PLX_WASM_I16X8_NARROW_I32X4_S = 0x85,
+  PLX_WASM_I16X8_NARROW_I32X4_U = 0x86,
+  PLX_WASM_I16X8_EXTEND_LOW_I8X16_S = 0x87,
+  PLX_WASM_I16X8_EXTEND_HIGH_I8X16_S = 0x88,
+  PLX_WASM_I16X8_EXTEND_LOW_I8X16_U = 0x89,
+  PLX_WASM_I16X8_EXTEND_HIGH_I8X16_U = 0x8A,
+  PLX_WASM_I16X8_SHL = 0x8B,
+  PLX_WASM_I16X8_SHR_S = 0x8C,
+  PLX_WASM_I16X8_SHR_U = 0x8D,
+  PLX_WASM_I16X8_ADD = 0x8E,
+  PLX_WASM_I16X8_ADD_SAT_S = 0x8F,
+  PLX_WASM_I16X8_ADD_SAT_U = 0x90,
+  PLX_WASM_I16X8_SUB = 0x91,
+  PLX_WASM_I16X8_SUB_SAT_S = 0x92,
+  PLX_WASM_I16X8_SUB_SAT_U = 0x93,
+  PLX_WASM_F64X2_NEAREST = 0x94,
+  PLX_WASM_I16X8_MUL = 0x95,
+  PLX_WASM_I16X8_MIN_S = 0x96,
+  PLX_WASM_I16X8_MIN_U = 0x97,
+  PLX_WASM_I16X8_MAX_S = 0x98,
+  PLX_WASM_I16X8_MAX_U = 0x99,
+  PLX_WASM_I16X8_AVGR_U = 0x9B,
+  PLX_WASM_I16X8_EXTMUL_LOW_I8X16_S = 0x9C,
+  PLX_WASM_I16X8_EXTMUL_HIGH_I8X16_S = 0x9D,
+  PLX_WASM_I16X8_EXTMUL_LOW_I8X16_U = 0x9E,
+  PLX_WASM_I16X8_EXTMUL_HIGH_I8X16_U = 0x9F,
+  PLX_WASM_I32X4_ABS = 0xA0,
+  PLX_WASM_I32X4_NEG = 0xA1,
+  PLX_WASM_I32X4_ALL_TRUE = 0xA3,
+  PLX_WASM_I32X4_BITMASK = 0xA4,
+  PLX_WASM_I32X4_EXTEND_LOW_I16X8_S = 0xA7,
+  PLX_WASM_I32X4_EXTEND_HIGH_I16X8_S = 0xA8,
+  PLX_WASM_I32X4_EXTEND_LOW_I16X8_U = 0xA9,
+  PLX_WASM_I32X4_EXTEND_HIGH_I16X8_U = 0xAA,
+  PLX_WASM_I32X4_SHL = 0xAB,
+  PLX_WASM_I32X4_SHR_S = 0xAC,
+  PLX_WASM_I32X4_SHR_U = 0xAD,
+  PLX_WASM_I32X4_ADD = 0xAE,
+  PLX_WASM_I32X4_SUB = 0xB1,
+  PLX_WASM_I32X4_MUL = 0xB5,
+  PLX_WASM_I32X4_MIN_S = 0xB6,
+  PLX_WASM_I32X4_MIN_U = 0xB7,
+  PLX_WASM_I32X4_MAX_S = 0xB8,
+  PLX_WASM_I32X4_MAX_U = 0xB9,
+  PLX_WASM_I32X4_DOT_I16X8_S = 0xBA,
+  PLX_WASM_I32X4_EXTMUL_LOW_I16X8_S = 0xBC,
+  PLX_WASM_I32X4_EXTMUL_HIGH_I16X8_S = 0xBD,
+  PLX_WASM_I32X4_EXTMUL_LOW_I16X8_U = 0xBE,
+  PLX_WASM_I32X4_EXTMUL_HIGH_I16X8_U = 0xBF,
+  PLX_WASM_I64X2_ABS = 0xC0,
+  PLX_WASM_I64X2_NEG = 0xC1,
+  PLX_WASM_I64X2_ALL_TRUE = 0xC3,
+  PLX_WASM_I64X2_BITMASK = 0xC4,
+  PLX_WASM_I64X2_EXTEND_LOW_I32X4_S = 0xC7,
+  PLX_WASM_I64X2_EXTEND_HIGH_I32X4_S = 0xC8,
+  PLX_WASM_I64X2_EXTEND_LOW_I32X4_U = 0xC9,
+  PLX_WASM_I64X2_EXTEND_HIGH_I32X4_U = 0xCA,
+  PLX_WASM_I64X2_SHL = 0xCB,
+  PLX_WASM_I64X2_SHR_S = 0xCC,
+  PLX_WASM_I64X2_SHR_U = 0xCD,
+  PLX_WASM_I64X2_ADD = 0xCE,
+  PLX_WASM_I64X2_SUB = 0xD1,
+  PLX_WASM_I64X2_MUL = 0xD5,
+
+  // Comparison instructions
+  PLX_WASM_I64X2_EQ = 0xD6,
+  PLX_WASM_I64X2_NE = 0xD7,
+  PLX_WASM_I64X2_LT_S = 0xD8,
+  PLX_WASM_I64X2_GT_S = 0xD9,
+  PLX_WASM_I64X2_LE_S = 0xDA,
+  PLX_WASM_I64X2_GE_S = 0xDB,
+
+  // Arithmetic and conversion instructions
+  PLX_WASM_I64X2_EXTMUL_LOW_I32X4_S = 0xDC,
+  PLX_WASM_I64X2_EXTMUL_HIGH_I32X4_S = 0xDD,
+  PLX_WASM_I64X2_EXTMUL_LOW_I32X4_U = 0xDE,
+  PLX_WASM_I64X2_EXTMUL_HIGH_I32X4_U = 0xDF,
+  PLX_WASM_F32X4_ABS = 0xE0,
+  PLX_WASM_F32X4_NEG = 0xE1,
+  PLX_WASM_F32X4_SQRT = 0xE3,
+  PLX_WASM_F32X4_ADD = 0xE4,
+  PLX_WASM_F32X4_SUB = 0xE5,
+  PLX_WASM_F32X4_MUL = 0xE6,
+  PLX_WASM_F32X4_DIV = 0xE7,
+  PLX_WASM_F32X4_MIN = 0xE8,
+  PLX_WASM_F32X4_MAX = 0xE9,
+  PLX_WASM_F32X4_PMIN = 0xEA,
+  PLX_WASM_F32X4_PMAX = 0xEB,
+  PLX_WASM_F64X2_ABS = 0xEC,
+  PLX_WASM_F64X2_NEG = 0xED,
+  PLX_WASM_F64X2_SQRT = 0xEF,
+  PLX_WASM_F64X2_ADD = 0xF0,
+  PLX_WASM_F64X2_SUB = 0xF1,
+  PLX_WASM_F64X2_MUL = 0xF2,
+  PLX_WASM_F64X2_DIV = 0xF3,
+  PLX_WASM_F64X2_MIN = 0xF4,
+  PLX_WASM_F64X2_MAX = 0xF5,
+  PLX_WASM_F64X2_PMIN = 0xF6,
+  PLX_WASM_F64X2_PMAX = 0xF7,
+  PLX_WASM_I32X4_TRUNC_SAT_F32X4_S = 0xF8,
+  PLX_WASM_I32X4_TRUNC_SAT_F32X4_U = 0xF9,
+  PLX_WASM_F32X4_CONVERT_I32X4_S = 0xFA,
+  PLX_WASM_F32X4_CONVERT_I32X4_U = 0xFB,
+  PLX_WASM_I32X4_TRUNC_SAT_F64X2_S_ZERO = 0xFC,
+  PLX_WASM_I32X4_TRUNC_SAT_F64X2_U_ZERO = 0xFD,
+  PLX_WASM_F64X2_CONVERT_LOW_I32X4_S = 0xFE,
+  PLX_WASM_F64X2_CONVERT_LOW_I32X4_U = 0xFF,
 };
 
 // WebAssembly sections
@@ -243,25 +511,58 @@ enum plx_wasm_section_id {
   PLX_WASM_SECTION_DATA_COUNT = 12,
 };
 
-// Writes a WebAssembly module preamble to the output stream.
+// Contents of a section of a WebAssembly module, without its header.
+struct plx_wasm_section {
+  enum plx_wasm_section_id id;
+  struct plx_buffer contents;
+};
+
+// Maximum number of sections in a module written by `plx_wasm_write_module`.
+#define PLX_WASM_MAX_SECTIONS 16
+
+// Writes a WebAssembly module preamble to the buffer.
 // https://webassembly.github.io/spec/core/binary/modules.html#binary-module
-void plx_wasm_write_module_preamble(FILE* stream);
+void plx_wasm_write_module_preamble(struct plx_buffer* buffer);
 
-// Writes a WebAssembly section header to the output stream.
+// Writes a WebAssembly section header to the buffer.
 // https://webassembly.github.io/spec/core/binary/modules.html#sections
-void plx_wasm_write_section_header(FILE* stream, enum plx_wasm_section_id id,
-                                   size_t size);
+void plx_wasm_write_section_header(struct plx_buffer* buffer,
+                                   enum plx_wasm_section_id id, size_t size);
 
-// Writes a WebAssembly unsigned integer to the output stream.
+// Writes a WebAssembly unsigned integer to the buffer.
 // https://webassembly.github.io/spec/core/binary/values.html#integers
-void plx_wasm_write_ull(FILE* stream, unsigned long long value);
+void plx_wasm_write_ull(struct plx_buffer* buffer, unsigned long long value);
 
-// Writes a WebAssembly signed integer to the output stream.
+// Writes a WebAssembly signed integer to the buffer.
 // https://webassembly.github.io/spec/core/binary/values.html#integers
-void plx_wasm_write_ll(FILE* stream, long long value);
+void plx_wasm_write_ll(struct plx_buffer* buffer, long long value);
+
+// Writes a WebAssembly vector instruction, prefixed by
+// `PLX_WASM_VECTOR_PREFIX`, to the buffer.
+// https://webassembly.github.io/spec/core/binary/instructions.html#vector-instructions
+void plx_wasm_write_vector_instruction(
+    struct plx_buffer* buffer, enum plx_wasm_vector_instruction instruction);
+
+// Writes the memory argument of a load or store to the buffer. The alignment
+// is the base 2 logarithm of the access's alignment in bytes.
+// https://webassembly.github.io/spec/core/binary/instructions.html#memory-instructions
+void plx_wasm_write_memarg(struct plx_buffer* buffer, unsigned int align,
+                           unsigned long long offset);
 
-// Writes a WebAssembly name to the output stream.
+// Writes a WebAssembly name to the buffer.
 // https://webassembly.github.io/spec/core/binary/values.html#names
-void plx_wasm_write_name(FILE* stream, const char* name);
+void plx_wasm_write_name(struct plx_buffer* buffer, const char* name);
+
+// Writes a module made of the preamble and the sections to the output stream
+// with a single vectored write, so the sections are never copied. Returns
+// whether the write succeeded.
+bool plx_wasm_write_module(FILE* stream,
+                           const struct plx_wasm_section* sections,
+                           size_t section_count);
+
+// Returns the size in bytes of the module that `plx_wasm_write_module` writes
+// for the sections, without writing it.
+size_t plx_wasm_module_size(const struct plx_wasm_section* sections,
+                            size_t section_count);
 
 #endif  // PLX_WASM_H
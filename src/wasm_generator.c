@@ -16,11 +16,174 @@
 
 #include <assert.h>
 
-#include "macros.h"
+#include "symbol_table_entry.h"
+#include "types.h"
 #include "wasm.h"
 
+// Lane interpretation of a 128-bit vector.
+enum plx_wasm_shape {
+  PLX_WASM_SHAPE_I8X16,
+  PLX_WASM_SHAPE_I16X8,
+  PLX_WASM_SHAPE_I32X4,
+  PLX_WASM_SHAPE_I64X2,
+  PLX_WASM_SHAPE_F32X4,
+  PLX_WASM_SHAPE_F64X2,
+  PLX_WASM_SHAPE_COUNT,
+};
+
+// Marks an operation that has no instruction for a shape.
+#define PLX_WASM_NO_INSTRUCTION (-1)
+
+// Returns the shape of a vector type, or `PLX_WASM_SHAPE_COUNT` if the vector
+// does not fit in a `v128`. Vectors of bools are masks whose lanes are as wide
+// as the lanes of the compared vectors, so their shape depends on the number
+// of lanes alone.
+static enum plx_wasm_shape plx_wasm_vec_shape(
+    const struct plx_node* const type) {
+  assert(plx_is_vec_type(type));
+  const unsigned long long len = plx_vec_len(type);
+  enum plx_wasm_shape shape;
+  unsigned long long lane_bits;
+  switch (plx_lane_type(type)->kind) {
+    case PLX_NODE_S8_TYPE:
+    case PLX_NODE_U8_TYPE:
+      shape = PLX_WASM_SHAPE_I8X16;
+      lane_bits = 8;
+      break;
+    case PLX_NODE_S16_TYPE:
+    case PLX_NODE_U16_TYPE:
+      shape = PLX_WASM_SHAPE_I16X8;
+      lane_bits = 16;
+      break;
+    case PLX_NODE_S32_TYPE:
+    case PLX_NODE_U32_TYPE:
+      shape = PLX_WASM_SHAPE_I32X4;
+      lane_bits = 32;
+      break;
+    case PLX_NODE_S64_TYPE:
+    case PLX_NODE_U64_TYPE:
+      shape = PLX_WASM_SHAPE_I64X2;
+      lane_bits = 64;
+      break;
+    case PLX_NODE_F32_TYPE:
+      shape = PLX_WASM_SHAPE_F32X4;
+      lane_bits = 32;
+      break;
+    case PLX_NODE_F64_TYPE:
+      shape = PLX_WASM_SHAPE_F64X2;
+      lane_bits = 64;
+      break;
+    case PLX_NODE_BOOL_TYPE:
+      switch (len) {
+        case 16:
+          return PLX_WASM_SHAPE_I8X16;
+        case 8:
+          return PLX_WASM_SHAPE_I16X8;
+        case 4:
+          return PLX_WASM_SHAPE_I32X4;
+        case 2:
+          return PLX_WASM_SHAPE_I64X2;
+        default:
+          return PLX_WASM_SHAPE_COUNT;
+      }
+    default:
+      return PLX_WASM_SHAPE_COUNT;
+  }
+  return lane_bits * len == 128 ? shape : PLX_WASM_SHAPE_COUNT;
+}
+
+// Returns the instruction of an element-wise operation on vectors with a type,
+// or `PLX_WASM_NO_INSTRUCTION` if WebAssembly has no such instruction. Shifts
+// are missing since WebAssembly only shifts every lane by the same amount.
+static int plx_wasm_vector_instruction(const enum plx_node_kind kind,
+                                       const struct plx_node* const type) {
+  static const int eq[] = {PLX_WASM_I8X16_EQ, PLX_WASM_I16X8_EQ,
+                           PLX_WASM_I32X4_EQ, PLX_WASM_I64X2_EQ,
+                           PLX_WASM_F32X4_EQ, PLX_WASM_F64X2_EQ};
+  static const int ne[] = {PLX_WASM_I8X16_NE, PLX_WASM_I16X8_NE,
+                           PLX_WASM_I32X4_NE, PLX_WASM_I64X2_NE,
+                           PLX_WASM_F32X4_NE, PLX_WASM_F64X2_NE};
+  static const int lt_s[] = {PLX_WASM_I8X16_LT_S, PLX_WASM_I16X8_LT_S,
+                             PLX_WASM_I32X4_LT_S, PLX_WASM_I64X2_LT_S,
+                             PLX_WASM_F32X4_LT,   PLX_WASM_F64X2_LT};
+  static const int lt_u[] = {PLX_WASM_I8X16_LT_U, PLX_WASM_I16X8_LT_U,
+                             PLX_WASM_I32X4_LT_U, PLX_WASM_NO_INSTRUCTION,
+                             PLX_WASM_F32X4_LT,   PLX_WASM_F64X2_LT};
+  static const int le_s[] = {PLX_WASM_I8X16_LE_S, PLX_WASM_I16X8_LE_S,
+                             PLX_WASM_I32X4_LE_S, PLX_WASM_I64X2_LE_S,
+                             PLX_WASM_F32X4_LE,   PLX_WASM_F64X2_LE};
+  static const int le_u[] = {PLX_WASM_I8X16_LE_U, PLX_WASM_I16X8_LE_U,
+                             PLX_WASM_I32X4_LE_U, PLX_WASM_NO_INSTRUCTION,
+                             PLX_WASM_F32X4_LE,   PLX_WASM_F64X2_LE};
+  static const int gt_s[] = {PLX_WASM_I8X16_GT_S, PLX_WASM_I16X8_GT_S,
+                             PLX_WASM_I32X4_GT_S, PLX_WASM_I64X2_GT_S,
+                             PLX_WASM_F32X4_GT,   PLX_WASM_F64X2_GT};
+  static const int gt_u[] = {PLX_WASM_I8X16_GT_U, PLX_WASM_I16X8_GT_U,
+                             PLX_WASM_I32X4_GT_U, PLX_WASM_NO_INSTRUCTION,
+                             PLX_WASM_F32X4_GT,   PLX_WASM_F64X2_GT};
+  static const int ge_s[] = {PLX_WASM_I8X16_GE_S, PLX_WASM_I16X8_GE_S,
+                             PLX_WASM_I32X4_GE_S, PLX_WASM_I64X2_GE_S,
+                             PLX_WASM_F32X4_GE,   PLX_WASM_F64X2_GE};
+  static const int ge_u[] = {PLX_WASM_I8X16_GE_U, PLX_WASM_I16X8_GE_U,
+                             PLX_WASM_I32X4_GE_U, PLX_WASM_NO_INSTRUCTION,
+                             PLX_WASM_F32X4_GE,   PLX_WASM_F64X2_GE};
+  static const int add[] = {PLX_WASM_I8X16_ADD, PLX_WASM_I16X8_ADD,
+                            PLX_WASM_I32X4_ADD, PLX_WASM_I64X2_ADD,
+                            PLX_WASM_F32X4_ADD, PLX_WASM_F64X2_ADD};
+  static const int sub[] = {PLX_WASM_I8X16_SUB, PLX_WASM_I16X8_SUB,
+                            PLX_WASM_I32X4_SUB, PLX_WASM_I64X2_SUB,
+                            PLX_WASM_F32X4_SUB, PLX_WASM_F64X2_SUB};
+  static const int mul[] = {PLX_WASM_NO_INSTRUCTION, PLX_WASM_I16X8_MUL,
+                            PLX_WASM_I32X4_MUL,      PLX_WASM_I64X2_MUL,
+                            PLX_WASM_F32X4_MUL,      PLX_WASM_F64X2_MUL};
+  static const int div[] = {PLX_WASM_NO_INSTRUCTION, PLX_WASM_NO_INSTRUCTION,
+                            PLX_WASM_NO_INSTRUCTION, PLX_WASM_NO_INSTRUCTION,
+                            PLX_WASM_F32X4_DIV,      PLX_WASM_F64X2_DIV};
+  static const int neg[] = {PLX_WASM_I8X16_NEG, PLX_WASM_I16X8_NEG,
+                            PLX_WASM_I32X4_NEG, PLX_WASM_I64X2_NEG,
+                            PLX_WASM_F32X4_NEG, PLX_WASM_F64X2_NEG};
+
+  const enum plx_wasm_shape shape = plx_wasm_vec_shape(type);
+  if (shape == PLX_WASM_SHAPE_COUNT) return PLX_WASM_NO_INSTRUCTION;
+  const bool is_uint = plx_is_uint_type(plx_lane_type(type));
+  switch (kind) {
+    case PLX_NODE_AND:
+      return PLX_WASM_V128_AND;
+    case PLX_NODE_OR:
+      return PLX_WASM_V128_OR;
+    case PLX_NODE_XOR:
+      return PLX_WASM_V128_XOR;
+    case PLX_NODE_NOT:
+      return PLX_WASM_V128_NOT;
+    case PLX_NODE_EQ:
+      return eq[shape];
+    case PLX_NODE_NEQ:
+      return ne[shape];
+    case PLX_NODE_LT:
+      return is_uint ? lt_u[shape] : lt_s[shape];
+    case PLX_NODE_LTE:
+      return is_uint ? le_u[shape] : le_s[shape];
+    case PLX_NODE_GT:
+      return is_uint ? gt_u[shape] : gt_s[shape];
+    case PLX_NODE_GTE:
+      return is_uint ? ge_u[shape] : ge_s[shape];
+    case PLX_NODE_ADD:
+      return add[shape];
+    case PLX_NODE_SUB:
+      return sub[shape];
+    case PLX_NODE_MUL:
+      return mul[shape];
+    case PLX_NODE_DIV:
+      return div[shape];
+    case PLX_NODE_NEG:
+      return neg[shape];
+    default:
+      return PLX_WASM_NO_INSTRUCTION;
+  }
+}
+
 static void plx_generate_wasm_type(const struct plx_node* const type,
-                                   FILE* const stream) {
+                                   struct plx_buffer* const buffer) {
   switch (type->kind) {
     case PLX_NODE_S8_TYPE:
     case PLX_NODE_S16_TYPE:
@@ -29,18 +192,22 @@ static void plx_generate_wasm_type(const struct plx_node* const type,
     case PLX_NODE_U16_TYPE:
     case PLX_NODE_U32_TYPE:
     case PLX_NODE_BOOL_TYPE:
-      fputc(PLX_WASM_I32, stream);
+      plx_buffer_append_char(buffer, PLX_WASM_I32);
       break;
     case PLX_NODE_S64_TYPE:
     case PLX_NODE_U64_TYPE:
-      fputc(PLX_WASM_I64, stream);
+      plx_buffer_append_char(buffer, PLX_WASM_I64);
       break;
     case PLX_NODE_F16_TYPE:
     case PLX_NODE_F32_TYPE:
-      fputc(PLX_WASM_F32, stream);
+      plx_buffer_append_char(buffer, PLX_WASM_F32);
       break;
     case PLX_NODE_F64_TYPE:
-      fputc(PLX_WASM_F64, stream);
+      plx_buffer_append_char(buffer, PLX_WASM_F64);
+      break;
+    case PLX_NODE_VEC_TYPE:
+      assert(plx_wasm_vec_shape(type) != PLX_WASM_SHAPE_COUNT);
+      plx_buffer_append_char(buffer, PLX_WASM_V128);
       break;
     case PLX_NODE_STRING_TYPE:
     case PLX_NODE_FUNC_TYPE:
@@ -55,7 +222,7 @@ static void plx_generate_wasm_type(const struct plx_node* const type,
 }
 
 static void plx_generate_wasm_type_section(const struct plx_node* const module,
-                                           FILE* const stream) {
+                                           struct plx_buffer* const buffer) {
   assert(module->kind == PLX_NODE_MODULE);
 
   // Write the type count.
@@ -65,7 +232,7 @@ static void plx_generate_wasm_type_section(const struct plx_node* const module,
     if (def->kind != PLX_NODE_FUNC_DEF) continue;
     ++type_count;
   }
-  plx_wasm_write_ull(stream, type_count);
+  plx_wasm_write_ull(buffer, type_count);
 
   // Write the types.
   for (const struct plx_node* def = module->children; def != NULL;
@@ -73,21 +240,21 @@ static void plx_generate_wasm_type_section(const struct plx_node* const module,
     if (def->kind != PLX_NODE_FUNC_DEF) continue;
     const struct plx_node *name, *params, *return_type, *body;
     plx_extract_children(def, &name, &params, &return_type, &body);
-    fputc(0x60, stream);
-    plx_wasm_write_ull(stream, plx_count_children(params));
+    plx_buffer_append_char(buffer, 0x60);
+    plx_wasm_write_ull(buffer, plx_count_children(params));
     for (const struct plx_node* param = params->children; param != NULL;
          param = param->next) {
       const struct plx_node *param_name, *param_type;
       plx_extract_children(param, &param_name, &param_type);
-      plx_generate_wasm_type(param_type, stream);
+      plx_generate_wasm_type(param_type, buffer);
     }
-    plx_wasm_write_ull(stream, 1);
-    plx_generate_wasm_type(return_type, stream);
+    plx_wasm_write_ull(buffer, 1);
+    plx_generate_wasm_type(return_type, buffer);
   }
 }
 
 static void plx_generate_wasm_function_section(
-    const struct plx_node* const module, FILE* const stream) {
+    const struct plx_node* const module, struct plx_buffer* const buffer) {
   assert(module->kind == PLX_NODE_MODULE);
 
   // Write the type count.
@@ -97,19 +264,78 @@ static void plx_generate_wasm_function_section(
     if (def->kind != PLX_NODE_FUNC_DEF) continue;
     ++type_count;
   }
-  plx_wasm_write_ull(stream, type_count);
+  plx_wasm_write_ull(buffer, type_count);
 
-  // Write the type indices.
+  // Write the type indices, which are also the function indices.
   size_t type_index = 0;
   for (const struct plx_node* def = module->children; def != NULL;
        def = def->next) {
     if (def->kind != PLX_NODE_FUNC_DEF) continue;
-    plx_wasm_write_ull(stream, type_index++);
+    def->children->entry->wasm_func = (unsigned int)type_index;
+    plx_wasm_write_ull(buffer, type_index++);
+  }
+}
+
+static void plx_generate_wasm_code(const struct plx_node* node,
+                                   struct plx_buffer* buffer);
+
+// Returns whether a symbol is a function rather than a variable that holds a
+// function.
+static bool plx_is_wasm_func(const struct plx_symbol_table_entry* const entry) {
+  return entry->scope == PLX_SYMBOL_SCOPE_GLOBAL &&
+         entry->mutability == PLX_SYMBOL_MUTABILITY_CONST &&
+         entry->type->kind == PLX_NODE_FUNC_TYPE;
+}
+
+// Returns whether an expression operates on each lane of a vector.
+static bool plx_is_wasm_vector_op(const struct plx_node* const node) {
+  switch (node->kind) {
+    case PLX_NODE_AND:
+    case PLX_NODE_OR:
+    case PLX_NODE_XOR:
+    case PLX_NODE_EQ:
+    case PLX_NODE_NEQ:
+    case PLX_NODE_LTE:
+    case PLX_NODE_LT:
+    case PLX_NODE_GTE:
+    case PLX_NODE_GT:
+    case PLX_NODE_ADD:
+    case PLX_NODE_SUB:
+    case PLX_NODE_MUL:
+    case PLX_NODE_DIV:
+    case PLX_NODE_REM:
+    case PLX_NODE_LSHIFT:
+    case PLX_NODE_RSHIFT:
+    case PLX_NODE_NOT:
+    case PLX_NODE_NEG:
+      return plx_is_vec_type(node->children->type);
+    default:
+      return false;
+  }
+}
+
+// Generates an element-wise operation on 128-bit vectors.
+static void plx_generate_wasm_vector_op(const struct plx_node* const node,
+                                        struct plx_buffer* const buffer) {
+  for (const struct plx_node* operand = node->children; operand != NULL;
+       operand = operand->next) {
+    plx_generate_wasm_code(operand, buffer);
   }
+  const int instruction =
+      plx_wasm_vector_instruction(node->kind, node->children->type);
+  assert(instruction != PLX_WASM_NO_INSTRUCTION);
+  plx_wasm_write_vector_instruction(
+      buffer, (enum plx_wasm_vector_instruction)instruction);
 }
 
 static void plx_generate_wasm_code(const struct plx_node* const node,
-                                   FILE* const stream) {
+                                   struct plx_buffer* const buffer) {
+  // Operations on vectors map to SIMD instructions.
+  if (plx_is_wasm_vector_op(node)) {
+    plx_generate_wasm_vector_op(node, buffer);
+    return;
+  }
+
   switch (node->kind) {
     case PLX_NODE_MODULE:
       break;
@@ -125,59 +351,75 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_BLOCK:
       for (const struct plx_node* stmt = node->children; stmt != NULL;
            stmt = stmt->next) {
-        plx_generate_wasm(stmt, stream);
+        plx_generate_wasm_code(stmt, buffer);
       }
       break;
     case PLX_NODE_IF_THEN_ELSE: {
       const struct plx_node *cond, *then, *els;
       plx_extract_children(node, &cond, &then, &els);
-      plx_generate_wasm(cond, stream);
-      fputc(PLX_WASM_IF, stream);
-      fputc(PLX_WASM_BLOCK_TYPE_EMPTY, stream);
-      plx_generate_wasm(then, stream);
+      plx_generate_wasm_code(cond, buffer);
+      plx_buffer_append_char(buffer, PLX_WASM_IF);
+      plx_buffer_append_char(buffer, PLX_WASM_BLOCK_TYPE_EMPTY);
+      plx_generate_wasm_code(then, buffer);
       if (els->children != NULL) {
-        fputc(PLX_WASM_ELSE, stream);
-        plx_generate_wasm(els, stream);
+        plx_buffer_append_char(buffer, PLX_WASM_ELSE);
+        plx_generate_wasm_code(els, buffer);
       }
-      fputc(PLX_WASM_END, stream);
+      plx_buffer_append_char(buffer, PLX_WASM_END);
       break;
     }
     case PLX_NODE_LOOP: {
       const struct plx_node* body;
       plx_extract_children(node, &body);
-      fputc(PLX_WASM_LOOP, stream);
-      fputc(PLX_WASM_BLOCK_TYPE_EMPTY, stream);
-      plx_generate_wasm(body, stream);
-      fputc(PLX_WASM_END, stream);
+      plx_buffer_append_char(buffer, PLX_WASM_LOOP);
+      plx_buffer_append_char(buffer, PLX_WASM_BLOCK_TYPE_EMPTY);
+      plx_generate_wasm_code(body, buffer);
+      plx_buffer_append_char(buffer, PLX_WASM_END);
       break;
     }
     case PLX_NODE_WHILE_LOOP: {
       const struct plx_node *cond, *body;
       plx_extract_children(node, &cond, &body);
-      fputc(PLX_WASM_LOOP, stream);
-      fputc(PLX_WASM_BLOCK_TYPE_EMPTY, stream);
+      plx_buffer_append_char(buffer, PLX_WASM_LOOP);
+      plx_buffer_append_char(buffer, PLX_WASM_BLOCK_TYPE_EMPTY);
 
       // Write the condition.
-      plx_generate_wasm(cond, stream);
-      fputc(PLX_WASM_BR_IF, stream);
-      plx_wasm_write_ull(stream, 0);
+      plx_generate_wasm_code(cond, buffer);
+      plx_buffer_append_char(buffer, PLX_WASM_BR_IF);
+      plx_wasm_write_ull(buffer, 0);
 
       // Write the body.
-      plx_generate_wasm(body, stream);
+      plx_generate_wasm_code(body, buffer);
 
-      fputc(PLX_WASM_END, stream);
+      plx_buffer_append_char(buffer, PLX_WASM_END);
+      break;
+    }
+    case PLX_NODE_FOR_LOOP: {
+      const struct plx_node *name, *iterable, *body;
+      plx_extract_children(node, &name, &iterable, &body);
+      // TODO: The counter and the end of the range need locals.
+      plx_buffer_append_char(buffer, PLX_WASM_LOOP);
+      plx_buffer_append_char(buffer, PLX_WASM_BLOCK_TYPE_EMPTY);
+      plx_generate_wasm_code(body, buffer);
+      plx_buffer_append_char(buffer, PLX_WASM_END);
       break;
     }
     case PLX_NODE_CONTINUE:
       break;
     case PLX_NODE_BREAK:
-      fputc(PLX_WASM_BR, stream);
-      plx_wasm_write_ull(stream, 0);
+      plx_buffer_append_char(buffer, PLX_WASM_BR);
+      plx_wasm_write_ull(buffer, 0);
       break;
     case PLX_NODE_RETURN: {
       const struct plx_node* const return_value = node->children;
-      if (return_value != NULL) plx_generate_wasm(return_value, stream);
-      fputc(PLX_WASM_RETURN, stream);
+      if (return_value != NULL) plx_generate_wasm_code(return_value, buffer);
+
+      // Tail calls return by themselves.
+      if (return_value != NULL && return_value->kind == PLX_NODE_CALL &&
+          return_value->tail_call) {
+        break;
+      }
+      plx_buffer_append_char(buffer, PLX_WASM_RETURN);
       break;
     }
     case PLX_NODE_ASSIGN:
@@ -199,8 +441,8 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_AND: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      plx_generate_wasm(left, stream);
-      plx_generate_wasm(right, stream);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
@@ -210,11 +452,11 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
         case PLX_NODE_U16_TYPE:
         case PLX_NODE_U32_TYPE:
         case PLX_NODE_BOOL_TYPE:
-          fputc(PLX_WASM_I32_AND, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_AND);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fputc(PLX_WASM_I64_AND, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_AND);
           break;
         default:
           assert(false);
@@ -224,8 +466,8 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_OR: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      plx_generate_wasm(left, stream);
-      plx_generate_wasm(right, stream);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
@@ -235,11 +477,11 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
         case PLX_NODE_U16_TYPE:
         case PLX_NODE_U32_TYPE:
         case PLX_NODE_BOOL_TYPE:
-          fputc(PLX_WASM_I32_OR, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_OR);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fputc(PLX_WASM_I64_OR, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_OR);
           break;
         default:
           assert(false);
@@ -249,8 +491,8 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_XOR: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      plx_generate_wasm(left, stream);
-      plx_generate_wasm(right, stream);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
@@ -260,11 +502,11 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
         case PLX_NODE_U16_TYPE:
         case PLX_NODE_U32_TYPE:
         case PLX_NODE_BOOL_TYPE:
-          fputc(PLX_WASM_I32_XOR, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_XOR);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fputc(PLX_WASM_I64_XOR, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_XOR);
           break;
         default:
           assert(false);
@@ -274,8 +516,8 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_EQ: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      plx_generate_wasm(left, stream);
-      plx_generate_wasm(right, stream);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
@@ -285,18 +527,18 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
         case PLX_NODE_U16_TYPE:
         case PLX_NODE_U32_TYPE:
         case PLX_NODE_BOOL_TYPE:
-          fputc(PLX_WASM_I32_EQ, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_EQ);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fputc(PLX_WASM_I64_EQ, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_EQ);
           break;
         case PLX_NODE_F16_TYPE:
         case PLX_NODE_F32_TYPE:
-          fputc(PLX_WASM_F32_EQ, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_F32_EQ);
           break;
         case PLX_NODE_F64_TYPE:
-          fputc(PLX_WASM_F64_EQ, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_F64_EQ);
           break;
         default:
           assert(false);
@@ -306,8 +548,8 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_NEQ: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      plx_generate_wasm(left, stream);
-      plx_generate_wasm(right, stream);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
@@ -317,18 +559,18 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
         case PLX_NODE_U16_TYPE:
         case PLX_NODE_U32_TYPE:
         case PLX_NODE_BOOL_TYPE:
-          fputc(PLX_WASM_I32_NE, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_NE);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fputc(PLX_WASM_I64_NE, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_NE);
           break;
         case PLX_NODE_F16_TYPE:
         case PLX_NODE_F32_TYPE:
-          fputc(PLX_WASM_F32_NE, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_F32_NE);
           break;
         case PLX_NODE_F64_TYPE:
-          fputc(PLX_WASM_F64_NE, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_F64_NE);
           break;
         default:
           assert(false);
@@ -338,8 +580,8 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_ADD: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      plx_generate_wasm(left, stream);
-      plx_generate_wasm(right, stream);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
@@ -348,18 +590,18 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
         case PLX_NODE_U8_TYPE:
         case PLX_NODE_U16_TYPE:
         case PLX_NODE_U32_TYPE:
-          fputc(PLX_WASM_I32_ADD, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_ADD);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fputc(PLX_WASM_I64_ADD, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_ADD);
           break;
         case PLX_NODE_F16_TYPE:
         case PLX_NODE_F32_TYPE:
-          fputc(PLX_WASM_F32_ADD, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_F32_ADD);
           break;
         case PLX_NODE_F64_TYPE:
-          fputc(PLX_WASM_F64_ADD, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_F64_ADD);
           break;
         default:
           assert(false);
@@ -369,8 +611,8 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_SUB: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      plx_generate_wasm(left, stream);
-      plx_generate_wasm(right, stream);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
@@ -379,18 +621,18 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
         case PLX_NODE_U8_TYPE:
         case PLX_NODE_U16_TYPE:
         case PLX_NODE_U32_TYPE:
-          fputc(PLX_WASM_I32_SUB, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_SUB);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fputc(PLX_WASM_I64_SUB, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_SUB);
           break;
         case PLX_NODE_F16_TYPE:
         case PLX_NODE_F32_TYPE:
-          fputc(PLX_WASM_F32_SUB, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_F32_SUB);
           break;
         case PLX_NODE_F64_TYPE:
-          fputc(PLX_WASM_F64_SUB, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_F64_SUB);
           break;
         default:
           assert(false);
@@ -400,8 +642,8 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_MUL: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      plx_generate_wasm(left, stream);
-      plx_generate_wasm(right, stream);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
       assert(left->type->kind == right->type->kind);
       switch (left->type->kind) {
         case PLX_NODE_S8_TYPE:
@@ -410,18 +652,18 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
         case PLX_NODE_U8_TYPE:
         case PLX_NODE_U16_TYPE:
         case PLX_NODE_U32_TYPE:
-          fputc(PLX_WASM_I32_MUL, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_MUL);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fputc(PLX_WASM_I64_MUL, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_MUL);
           break;
         case PLX_NODE_F16_TYPE:
         case PLX_NODE_F32_TYPE:
-          fputc(PLX_WASM_F32_MUL, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_F32_MUL);
           break;
         case PLX_NODE_F64_TYPE:
-          fputc(PLX_WASM_F64_MUL, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_F64_MUL);
           break;
         default:
           assert(false);
@@ -431,32 +673,32 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_DIV: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      plx_generate_wasm(left, stream);
-      plx_generate_wasm(right, stream);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
       assert(left->type->kind == right->type->kind);
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_S32_TYPE:
-          fputc(PLX_WASM_I32_DIV_S, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_DIV_S);
           break;
         case PLX_NODE_S64_TYPE:
-          fputc(PLX_WASM_I64_DIV_S, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_DIV_S);
           break;
         case PLX_NODE_U8_TYPE:
         case PLX_NODE_U16_TYPE:
         case PLX_NODE_U32_TYPE:
-          fputc(PLX_WASM_I32_DIV_U, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_DIV_U);
           break;
         case PLX_NODE_U64_TYPE:
-          fputc(PLX_WASM_I64_DIV_U, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_DIV_U);
           break;
         case PLX_NODE_F16_TYPE:
         case PLX_NODE_F32_TYPE:
-          fputc(PLX_WASM_F32_DIV, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_F32_DIV);
           break;
         case PLX_NODE_F64_TYPE:
-          fputc(PLX_WASM_F64_DIV, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_F64_DIV);
           break;
         default:
           assert(false);
@@ -466,24 +708,24 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_REM: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      plx_generate_wasm(left, stream);
-      plx_generate_wasm(right, stream);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_S32_TYPE:
-          fputc(PLX_WASM_I32_REM_S, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_REM_S);
           break;
         case PLX_NODE_S64_TYPE:
-          fputc(PLX_WASM_I64_REM_S, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_REM_S);
           break;
         case PLX_NODE_U8_TYPE:
         case PLX_NODE_U16_TYPE:
         case PLX_NODE_U32_TYPE:
-          fputc(PLX_WASM_I32_REM_U, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_REM_U);
           break;
         case PLX_NODE_U64_TYPE:
-          fputc(PLX_WASM_I64_REM_U, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_REM_U);
           break;
         default:
           assert(false);
@@ -493,22 +735,22 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_LSHIFT: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      plx_generate_wasm(left, stream);
-      plx_generate_wasm(right, stream);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_S32_TYPE:
-          fputc(PLX_WASM_I32_SHL, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_SHL);
           break;
         case PLX_NODE_U8_TYPE:
         case PLX_NODE_U16_TYPE:
         case PLX_NODE_U32_TYPE:
-          fputc(PLX_WASM_I32_SHL, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_SHL);
           break;
         case PLX_NODE_S64_TYPE:
         case PLX_NODE_U64_TYPE:
-          fputc(PLX_WASM_I64_SHL, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_SHL);
           break;
         default:
           assert(false);
@@ -518,24 +760,24 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_RSHIFT: {
       const struct plx_node *left, *right;
       plx_extract_children(node, &left, &right);
-      plx_generate_wasm(left, stream);
-      plx_generate_wasm(right, stream);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
       switch (node->type->kind) {
         case PLX_NODE_S8_TYPE:
         case PLX_NODE_S16_TYPE:
         case PLX_NODE_S32_TYPE:
-          fputc(PLX_WASM_I32_SHR_S, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_SHR_S);
           break;
         case PLX_NODE_S64_TYPE:
-          fputc(PLX_WASM_I64_SHR_S, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_SHR_S);
           break;
         case PLX_NODE_U8_TYPE:
         case PLX_NODE_U16_TYPE:
         case PLX_NODE_U32_TYPE:
-          fputc(PLX_WASM_I32_SHR_U, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I32_SHR_U);
           break;
         case PLX_NODE_U64_TYPE:
-          fputc(PLX_WASM_I64_SHR_U, stream);
+          plx_buffer_append_char(buffer, PLX_WASM_I64_SHR_U);
           break;
         default:
           assert(false);
@@ -550,11 +792,104 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
       break;
     case PLX_NODE_DEREF:
       break;
-    case PLX_NODE_CALL:
+    case PLX_NODE_CALL: {
+      const struct plx_node *callee, *args;
+      plx_extract_children(node, &callee, &args);
+      for (const struct plx_node* arg = args->children; arg != NULL;
+           arg = arg->next) {
+        plx_generate_wasm_code(arg, buffer);
+      }
+
+      // Only functions are called, as there is no table of function
+      // references for indirect calls.
+      if (callee->kind != PLX_NODE_IDENTIFIER ||
+          !plx_is_wasm_func(callee->entry)) {
+        break;
+      }
+      plx_buffer_append_char(
+          buffer, node->tail_call ? PLX_WASM_RETURN_CALL : PLX_WASM_CALL);
+      plx_wasm_write_ull(buffer, callee->entry->wasm_func);
+      break;
+    }
+    case PLX_NODE_INDEX: {
+      const struct plx_node *value, *index;
+      plx_extract_children(node, &value, &index);
+      if (!plx_is_vec_type(value->type)) break;
+
+      // Lanes are extracted with an immediate index.
+      static const enum plx_wasm_vector_instruction extract_lane[] = {
+          PLX_WASM_I8X16_EXTRACT_LANE_S, PLX_WASM_I16X8_EXTRACT_LANE_S,
+          PLX_WASM_I32X4_EXTRACT_LANE,   PLX_WASM_I64X2_EXTRACT_LANE,
+          PLX_WASM_F32X4_EXTRACT_LANE,   PLX_WASM_F64X2_EXTRACT_LANE};
+      const enum plx_wasm_shape shape = plx_wasm_vec_shape(value->type);
+      assert(shape != PLX_WASM_SHAPE_COUNT);
+      assert(plx_is_constant(index));
+      plx_generate_wasm_code(value, buffer);
+      enum plx_wasm_vector_instruction instruction = extract_lane[shape];
+      if (shape == PLX_WASM_SHAPE_I8X16 && plx_is_uint_type(node->type)) {
+        instruction = PLX_WASM_I8X16_EXTRACT_LANE_U;
+      } else if (shape == PLX_WASM_SHAPE_I16X8 &&
+                 plx_is_uint_type(node->type)) {
+        instruction = PLX_WASM_I16X8_EXTRACT_LANE_U;
+      }
+      plx_wasm_write_vector_instruction(buffer, instruction);
+      plx_buffer_append_char(buffer, (char)index->uint);
       break;
-    case PLX_NODE_INDEX:
+    }
+    case PLX_NODE_BOUNDS_CHECK:
+      // TODO: Comparing the index with the length needs a local to hold it.
+      plx_generate_wasm_code(node->children, buffer);
       break;
     case PLX_NODE_SLICE:
+    case PLX_NODE_RANGE:
+      break;
+    case PLX_NODE_SELECT: {
+      const struct plx_node *mask, *left, *right;
+      plx_extract_children(node, &mask, &left, &right);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
+      plx_generate_wasm_code(mask, buffer);
+      if (plx_is_vec_type(mask->type)) {
+        assert(plx_wasm_vec_shape(left->type) != PLX_WASM_SHAPE_COUNT);
+        plx_wasm_write_vector_instruction(buffer, PLX_WASM_V128_BITSELECT);
+      } else if (plx_is_vec_type(left->type)) {
+        plx_buffer_append_char(buffer, PLX_WASM_SELECT_TYPE);
+        plx_wasm_write_ull(buffer, 1);
+        plx_buffer_append_char(buffer, PLX_WASM_V128);
+      } else {
+        plx_buffer_append_char(buffer, PLX_WASM_SELECT);
+      }
+      break;
+    }
+    case PLX_NODE_SHUFFLE: {
+      const struct plx_node *left, *right, *indices;
+      plx_extract_children(node, &left, &right, &indices);
+      assert(plx_wasm_vec_shape(left->type) != PLX_WASM_SHAPE_COUNT);
+      assert(plx_wasm_vec_shape(node->type) != PLX_WASM_SHAPE_COUNT);
+      plx_generate_wasm_code(left, buffer);
+      plx_generate_wasm_code(right, buffer);
+
+      // The shuffle selects bytes, so each lane index is widened to the bytes
+      // of the lane.
+      plx_wasm_write_vector_instruction(buffer, PLX_WASM_I8X16_SHUFFLE);
+      const unsigned long long lane_bytes = 16 / plx_vec_len(left->type);
+      for (const struct plx_node* index = indices->children; index != NULL;
+           index = index->next) {
+        for (unsigned long long i = 0; i < lane_bytes; ++i) {
+          plx_buffer_append_char(buffer, (char)(index->uint * lane_bytes + i));
+        }
+      }
+      break;
+    }
+    case PLX_NODE_REDUCE_ADD:
+    case PLX_NODE_REDUCE_MUL:
+    case PLX_NODE_REDUCE_MIN:
+    case PLX_NODE_REDUCE_MAX:
+    case PLX_NODE_REDUCE_AND:
+    case PLX_NODE_REDUCE_OR:
+    case PLX_NODE_REDUCE_XOR:
+      // TODO: Reductions shuffle a vector against itself, which needs a local.
+      assert(false);
       break;
     case PLX_NODE_FIELD:
       break;
@@ -563,22 +898,22 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_S8:
     case PLX_NODE_S16:
     case PLX_NODE_S32:
-      fputc(PLX_WASM_I32_CONST, stream);
-      plx_wasm_write_ll(stream, node->sint);
+      plx_buffer_append_char(buffer, PLX_WASM_I32_CONST);
+      plx_wasm_write_ll(buffer, node->sint);
       break;
     case PLX_NODE_S64:
-      fputc(PLX_WASM_I64_CONST, stream);
-      plx_wasm_write_ll(stream, node->sint);
+      plx_buffer_append_char(buffer, PLX_WASM_I64_CONST);
+      plx_wasm_write_ll(buffer, node->sint);
       break;
     case PLX_NODE_U8:
     case PLX_NODE_U16:
     case PLX_NODE_U32:
-      fputc(PLX_WASM_I32_CONST, stream);
-      plx_wasm_write_ull(stream, node->uint);
+      plx_buffer_append_char(buffer, PLX_WASM_I32_CONST);
+      plx_wasm_write_ull(buffer, node->uint);
       break;
     case PLX_NODE_U64:
-      fputc(PLX_WASM_I64_CONST, stream);
-      plx_wasm_write_ull(stream, node->uint);
+      plx_buffer_append_char(buffer, PLX_WASM_I64_CONST);
+      plx_wasm_write_ull(buffer, node->uint);
       break;
     case PLX_NODE_F16:
     case PLX_NODE_F32:
@@ -586,8 +921,8 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
       assert(false);
       break;
     case PLX_NODE_BOOL:
-      fputc(PLX_WASM_I32_CONST, stream);
-      plx_wasm_write_ll(stream, node->b ? 1 : 0);
+      plx_buffer_append_char(buffer, PLX_WASM_I32_CONST);
+      plx_wasm_write_ll(buffer, node->b ? 1 : 0);
       break;
     case PLX_NODE_STRING:
       break;
@@ -609,77 +944,58 @@ static void plx_generate_wasm_code(const struct plx_node* const node,
     case PLX_NODE_REF_TYPE:
     case PLX_NODE_ARRAY_TYPE:
     case PLX_NODE_SLICE_TYPE:
+    case PLX_NODE_VEC_TYPE:
       assert(false);
       break;
   }
 }
 
-static bool plx_copy_file(FILE* const in, FILE* const out, size_t size) {
-#ifdef _WIN32
-  char buf[1024];
-  while (size > 0) {
-    const size_t bytes_read =
-        fread(buf, 1, size < sizeof(buf) ? size : sizeof(buf), in);
-    if (bytes_read == 0) return ferror(in) == 0;
-    if (plx_unlikely(bytes_read > size)) return false;
-    const size_t bytes_written = fwrite(buf, 1, bytes_read, out);
-    if (plx_unlikely(bytes_written < bytes_read)) return false;
-    size -= bytes_written;
-  }
-#else
-  while (size > 0) {
-    const ssize_t bytes_written = sendfile(fileno(in), fileno(out), NULL, size);
-    if (plx_unlikely(bytes_written < 0)) return false;
-    if (bytes_written == 0) return true;
-    if (plx_unlikely(bytes_written > size)) return false;
-    size -= bytes_written;
-  }
-#endif  // _WIN32
-  return true;
-}
+// Number of sections that `plx_generate_wasm_sections` generates.
+#define PLX_WASM_GENERATED_SECTIONS 3
 
-bool plx_generate_wasm(const struct plx_node* const module,
-                       FILE* const stream) {
+// Generates the sections of a WebAssembly module from the abstract syntax tree.
+static void plx_generate_wasm_sections(
+    const struct plx_node* const module,
+    struct plx_wasm_section sections[PLX_WASM_GENERATED_SECTIONS]) {
   assert(module->kind == PLX_NODE_MODULE);
-
-  // Write the module preamble.
-  plx_wasm_write_module_preamble(stream);
+  sections[0] = (struct plx_wasm_section){PLX_WASM_SECTION_TYPE,
+                                          PLX_BUFFER_INIT};
+  sections[1] = (struct plx_wasm_section){PLX_WASM_SECTION_FUNCTION,
+                                          PLX_BUFFER_INIT};
+  sections[2] = (struct plx_wasm_section){PLX_WASM_SECTION_CODE,
+                                          PLX_BUFFER_INIT};
 
   // Generate the type section.
-  FILE* const tmp = tmpfile();
-  plx_generate_wasm_type_section(module, tmp);
-  long size = ftell(tmp);
-  plx_wasm_write_section_header(stream, PLX_WASM_SECTION_TYPE, size);
-  fseek(tmp, 0, SEEK_SET);
-  if (plx_unlikely(!plx_copy_file(tmp, stream, size))) {
-    fclose(tmp);
-    return false;
-  }
+  plx_generate_wasm_type_section(module, &sections[0].contents);
 
   // Generate the function section.
-  fseek(tmp, 0, SEEK_SET);
-  plx_generate_wasm_function_section(module, tmp);
-  size = ftell(tmp);
-  plx_wasm_write_section_header(stream, PLX_WASM_SECTION_FUNCTION, size);
-  fseek(tmp, 0, SEEK_SET);
-  if (plx_unlikely(!plx_copy_file(tmp, stream, size))) {
-    fclose(tmp);
-    return false;
-  }
+  plx_generate_wasm_function_section(module, &sections[1].contents);
 
   // Generate the export section.
 
   // Generate the code section.
-  fseek(tmp, 0, SEEK_SET);
-  plx_generate_wasm_code(module, tmp);
-  size = ftell(tmp);
-  plx_wasm_write_section_header(stream, PLX_WASM_SECTION_CODE, size);
-  fseek(tmp, 0, SEEK_SET);
-  if (plx_unlikely(!plx_copy_file(tmp, stream, size))) {
-    fclose(tmp);
-    return false;
+  plx_generate_wasm_code(module, &sections[2].contents);
+}
+
+bool plx_generate_wasm(const struct plx_node* const module,
+                       FILE* const stream) {
+  struct plx_wasm_section sections[PLX_WASM_GENERATED_SECTIONS];
+  plx_generate_wasm_sections(module, sections);
+  const bool result =
+      plx_wasm_write_module(stream, sections, PLX_WASM_GENERATED_SECTIONS);
+  for (size_t i = 0; i < PLX_WASM_GENERATED_SECTIONS; ++i) {
+    plx_buffer_free(&sections[i].contents);
   }
+  return result;
+}
 
-  fclose(tmp);
-  return true;
+size_t plx_generated_wasm_size(const struct plx_node* const module) {
+  struct plx_wasm_section sections[PLX_WASM_GENERATED_SECTIONS];
+  plx_generate_wasm_sections(module, sections);
+  const size_t size =
+      plx_wasm_module_size(sections, PLX_WASM_GENERATED_SECTIONS);
+  for (size_t i = 0; i < PLX_WASM_GENERATED_SECTIONS; ++i) {
+    plx_buffer_free(&sections[i].contents);
+  }
+  return size;
 }
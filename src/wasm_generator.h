@@ -24,4 +24,8 @@
 // stream.
 bool plx_generate_wasm(const struct plx_node* module, FILE* stream);
 
+// Returns the size in bytes of the WebAssembly module that `plx_generate_wasm`
+// writes for the abstract syntax tree, without writing it.
+size_t plx_generated_wasm_size(const struct plx_node* module);
+
 #endif  // PLX_WASM_GENERATOR_H
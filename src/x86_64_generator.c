@@ -0,0 +1,1908 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "x86_64_generator.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "error.h"
+#include "macros.h"
+#include "source_code_printer.h"
+#include "symbol_table_entry.h"
+#include "types.h"
+
+// General purpose registers, numbered as in their encodings.
+enum plx_x86_64_reg {
+  PLX_X86_64_RAX,
+  PLX_X86_64_RCX,
+  PLX_X86_64_RDX,
+  PLX_X86_64_RBX,
+  PLX_X86_64_RSP,
+  PLX_X86_64_RBP,
+  PLX_X86_64_RSI,
+  PLX_X86_64_RDI,
+  PLX_X86_64_R8,
+  PLX_X86_64_R9,
+  PLX_X86_64_R10,
+  PLX_X86_64_R11,
+  PLX_X86_64_R12,
+  PLX_X86_64_R13,
+  PLX_X86_64_R14,
+  PLX_X86_64_R15,
+};
+
+// Register of a spilled virtual register.
+#define PLX_X86_64_NO_REG -1
+
+// Registers that pass the first integer arguments.
+static const enum plx_x86_64_reg plx_x86_64_arg_regs[] = {
+    PLX_X86_64_RDI, PLX_X86_64_RSI, PLX_X86_64_RDX,
+    PLX_X86_64_RCX, PLX_X86_64_R8,  PLX_X86_64_R9,
+};
+
+#define PLX_X86_64_ARG_REG_COUNT \
+  (sizeof(plx_x86_64_arg_regs) / sizeof(*plx_x86_64_arg_regs))
+
+// Allocatable registers that calls may clobber, in order of preference. RAX,
+// RCX, RDX and R11 are never allocated, since instructions use them as scratch
+// registers.
+static const enum plx_x86_64_reg plx_x86_64_caller_saved_regs[] = {
+    PLX_X86_64_RSI, PLX_X86_64_RDI, PLX_X86_64_R8,
+    PLX_X86_64_R9,  PLX_X86_64_R10,
+};
+
+// Allocatable registers that calls preserve.
+static const enum plx_x86_64_reg plx_x86_64_callee_saved_regs[] = {
+    PLX_X86_64_RBX, PLX_X86_64_R12, PLX_X86_64_R13,
+    PLX_X86_64_R14, PLX_X86_64_R15,
+};
+
+// Operations of the intermediate representation. Functions are lowered to a
+// linear sequence of instructions on an unbounded number of virtual registers,
+// which are then allocated to machine registers or stack slots.
+enum plx_x86_64_op {
+  // Moves the parameters into their virtual registers.
+  PLX_X86_64_OP_PARAMS,
+  // dst = imm
+  PLX_X86_64_OP_IMM,
+  // dst = a
+  PLX_X86_64_OP_MOV,
+  // dst = kind a
+  PLX_X86_64_OP_UNARY,
+  // dst = a kind b
+  PLX_X86_64_OP_BINARY,
+  // dst = *a
+  PLX_X86_64_OP_LOAD,
+  // *a = b
+  PLX_X86_64_OP_STORE,
+  // dst = address of the stack slot at offset imm below the frame pointer
+  PLX_X86_64_OP_SLOT_ADDR,
+  // dst = address of symbol target
+  PLX_X86_64_OP_SYMBOL_ADDR,
+  // dst = a(args), or symbol target(args) if a is zero
+  PLX_X86_64_OP_CALL,
+  // Returns a(args), or symbol target(args) if a is zero, by jumping to it in
+  // place of the current call.
+  PLX_X86_64_OP_TAIL_CALL,
+  // Defines label target.
+  PLX_X86_64_OP_LABEL,
+  // Jumps to label target.
+  PLX_X86_64_OP_JUMP,
+  // Jumps to label target if a is false.
+  PLX_X86_64_OP_BRANCH_FALSE,
+  // Returns a, or nothing if a is zero.
+  PLX_X86_64_OP_RET,
+  PLX_X86_64_OP_UNREACHABLE,
+};
+
+struct plx_x86_64_inst {
+  enum plx_x86_64_op op;
+
+  // Operation of a unary or binary instruction.
+  enum plx_node_kind kind;
+
+  // Size in bytes and signedness of the operands of an operation, or of the
+  // value that is loaded, stored or returned from a call.
+  unsigned int size;
+  bool is_signed;
+
+  // Virtual registers. Zero is no register.
+  unsigned int dst;
+  unsigned int a;
+  unsigned int b;
+
+  // Immediate or stack slot offset.
+  long long imm;
+
+  // Label or symbol.
+  size_t target;
+
+  // Arguments of a call, or parameters, as a range of the argument list.
+  size_t first_arg;
+  size_t arg_count;
+};
+
+// Live interval and location of a virtual register.
+struct plx_x86_64_interval {
+  // Positions of the first and last instructions that use the register.
+  size_t start;
+  size_t end;
+
+  // Whether a call is made while the register is live.
+  bool crosses_call;
+
+  // Machine register, or `PLX_X86_64_NO_REG` if it is spilled.
+  int reg;
+
+  // Offset of the stack slot below the frame pointer if it is spilled.
+  unsigned int slot;
+};
+
+// Jump whose 32-bit displacement is patched once its label is placed.
+struct plx_x86_64_fixup {
+  size_t offset;
+  size_t label;
+};
+
+struct plx_x86_64_generator {
+  struct plx_x86_64_object* object;
+
+  // Instructions of the function being generated.
+  size_t inst_count;
+  size_t inst_cap;
+  struct plx_x86_64_inst* insts;
+
+  // Virtual registers passed to calls, or received as parameters.
+  size_t arg_count;
+  size_t arg_cap;
+  unsigned int* args;
+
+  unsigned int vreg_count;
+  size_t label_count;
+
+  // Size in bytes of the stack frame below the frame pointer.
+  unsigned int frame_size;
+
+  // Labels that `continue` and `break` jump to in the innermost loop.
+  size_t continue_label;
+  size_t break_label;
+
+  // Label of the trap that failed bounds checks jump to, or `SIZE_MAX` if the
+  // function has no bounds checks.
+  size_t trap_label;
+
+  // Register allocation, indexed by virtual register.
+  struct plx_x86_64_interval* intervals;
+
+  // Stack slots of the callee-saved registers that are used, indexed by
+  // register, or zero if unused.
+  unsigned int saved_reg_slots[16];
+
+  // Text offsets of the labels, and jumps to them.
+  size_t* label_offsets;
+  size_t fixup_count;
+  size_t fixup_cap;
+  struct plx_x86_64_fixup* fixups;
+};
+
+// Grows an array so that it has room for at least `len` elements.
+static void* plx_x86_64_reserve(void* const data, size_t* const cap,
+                                const size_t len, const size_t size) {
+  if (plx_likely(len <= *cap)) return data;
+  size_t new_cap = *cap == 0 ? 16 : *cap * 2;
+  while (new_cap < len) new_cap *= 2;
+  void* const new_data = realloc(data, new_cap * size);
+  if (plx_unlikely(new_data == NULL)) plx_oom();
+  *cap = new_cap;
+  return new_data;
+}
+
+void plx_x86_64_object_free(struct plx_x86_64_object* const object) {
+  plx_buffer_free(&object->text);
+  plx_buffer_free(&object->data);
+  plx_buffer_free(&object->rodata);
+  free(object->symbols);
+  free(object->relocs);
+}
+
+// Returns the size of a type in bytes.
+static size_t plx_x86_64_type_size(const struct plx_node* const type) {
+  switch (type->kind) {
+    case PLX_NODE_S8_TYPE:
+    case PLX_NODE_U8_TYPE:
+    case PLX_NODE_BOOL_TYPE:
+      return 1;
+    case PLX_NODE_S16_TYPE:
+    case PLX_NODE_U16_TYPE:
+      return 2;
+    case PLX_NODE_S32_TYPE:
+    case PLX_NODE_U32_TYPE:
+      return 4;
+    case PLX_NODE_S64_TYPE:
+    case PLX_NODE_U64_TYPE:
+    case PLX_NODE_REF_TYPE:
+    case PLX_NODE_FUNC_TYPE:
+      return 8;
+    case PLX_NODE_ARRAY_TYPE: {
+      const struct plx_node *len, *element_type;
+      plx_extract_children(type, &len, &element_type);
+      return len->uint * plx_x86_64_type_size(element_type);
+    }
+    default:
+      assert(false);
+  }
+  return 0;
+}
+
+// Returns the alignment of a type in bytes.
+static size_t plx_x86_64_type_align(const struct plx_node* const type) {
+  if (type->kind == PLX_NODE_ARRAY_TYPE) {
+    const struct plx_node *len, *element_type;
+    plx_extract_children(type, &len, &element_type);
+    return plx_x86_64_type_align(element_type);
+  }
+  return plx_x86_64_type_size(type);
+}
+
+// Returns whether the back end supports a type.
+static bool plx_is_x86_64_type(const struct plx_node* const type) {
+  switch (type->kind) {
+    case PLX_NODE_VOID_TYPE:
+    case PLX_NODE_S8_TYPE:
+    case PLX_NODE_S16_TYPE:
+    case PLX_NODE_S32_TYPE:
+    case PLX_NODE_S64_TYPE:
+    case PLX_NODE_U8_TYPE:
+    case PLX_NODE_U16_TYPE:
+    case PLX_NODE_U32_TYPE:
+    case PLX_NODE_U64_TYPE:
+    case PLX_NODE_BOOL_TYPE:
+    case PLX_NODE_REF_TYPE:
+      return true;
+    case PLX_NODE_FUNC_TYPE: {
+      // Parameters and results are passed in registers, so arrays are not
+      // passed by value.
+      const struct plx_node* const param_types = type->children;
+      for (const struct plx_node* param_type = param_types->children;
+           param_type != NULL; param_type = param_type->next) {
+        if (param_type->kind == PLX_NODE_ARRAY_TYPE ||
+            !plx_is_x86_64_type(param_type)) {
+          return false;
+        }
+      }
+      const struct plx_node* const return_type = param_types->next;
+      return return_type->kind != PLX_NODE_ARRAY_TYPE &&
+             plx_is_x86_64_type(return_type);
+    }
+    case PLX_NODE_ARRAY_TYPE: {
+      const struct plx_node *len, *element_type;
+      plx_extract_children(type, &len, &element_type);
+      return plx_is_x86_64_type(element_type);
+    }
+    default:
+      return false;
+  }
+}
+
+// Reports values and variables whose types the back end does not support,
+// such as floating point numbers, slices and structs, and copies of arrays.
+static bool plx_check_x86_64(const struct plx_node* const node) {
+  if (node->kind == PLX_NODE_STRUCT_DEF) return true;
+  // Loads and stores move a single register, so arrays are only accessed by
+  // element.
+  if ((node->kind == PLX_NODE_VAR_DEF || node->kind == PLX_NODE_ASSIGN) &&
+      node->children->next->type != NULL &&
+      node->children->next->type->kind == PLX_NODE_ARRAY_TYPE) {
+    plx_error("array copy not supported by the x86-64 back end");
+    plx_print_source_code(
+        &node->loc,
+        /*annotation=*/"use the `llvm` back end to compile this statement",
+        PLX_SOURCE_ANNOTATION_ERROR);
+    return false;
+  }
+  const struct plx_node* const type =
+      node->kind == PLX_NODE_IDENTIFIER && node->entry != NULL
+          ? node->entry->type
+          : node->type;
+  if (type != NULL && !plx_is_x86_64_type(type)) {
+    plx_error("type not supported by the x86-64 back end");
+    plx_print_source_code(
+        &node->loc,
+        /*annotation=*/"use the `llvm` back end to compile this expression",
+        PLX_SOURCE_ANNOTATION_ERROR);
+    return false;
+  }
+  bool result = true;
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    if (!plx_check_x86_64(child)) result = false;
+  }
+  return result;
+}
+
+// Returns whether a symbol names a function.
+static bool plx_is_x86_64_func(
+    const struct plx_symbol_table_entry* const entry) {
+  return entry->scope == PLX_SYMBOL_SCOPE_GLOBAL &&
+         entry->mutability == PLX_SYMBOL_MUTABILITY_CONST &&
+         entry->type->kind == PLX_NODE_FUNC_TYPE;
+}
+
+// Returns whether a variable is kept in a virtual register rather than in a
+// stack slot.
+static bool plx_is_x86_64_reg_var(
+    const struct plx_symbol_table_entry* const entry) {
+  return entry->scope == PLX_SYMBOL_SCOPE_LOCAL && !entry->referenced &&
+         plx_is_scalar_type(entry->type);
+}
+
+// Adds a symbol to the object, returning its index.
+static size_t plx_x86_64_add_symbol(struct plx_x86_64_object* const object,
+                                    const char* const name,
+                                    const enum plx_x86_64_section section,
+                                    const size_t offset, const size_t size) {
+  object->symbols =
+      plx_x86_64_reserve(object->symbols, &object->symbol_cap,
+                         object->symbol_count + 1, sizeof(*object->symbols));
+  object->symbols[object->symbol_count] =
+      (struct plx_x86_64_symbol){name, section, offset, size};
+  return object->symbol_count++;
+}
+
+// ---------------------------------------------------------------------------
+// Lowering
+// ---------------------------------------------------------------------------
+
+static unsigned int plx_x86_64_new_vreg(
+    struct plx_x86_64_generator* const gen) {
+  return ++gen->vreg_count;
+}
+
+static size_t plx_x86_64_new_label(struct plx_x86_64_generator* const gen) {
+  return gen->label_count++;
+}
+
+// Allocates a stack slot, returning its offset below the frame pointer.
+static unsigned int plx_x86_64_new_slot(struct plx_x86_64_generator* const gen,
+                                        const size_t size, const size_t align) {
+  gen->frame_size = (unsigned int)((gen->frame_size + size + align - 1) /
+                                   align * align);
+  return gen->frame_size;
+}
+
+static struct plx_x86_64_inst* plx_x86_64_add_inst(
+    struct plx_x86_64_generator* const gen, const enum plx_x86_64_op op) {
+  gen->insts = plx_x86_64_reserve(gen->insts, &gen->inst_cap,
+                                  gen->inst_count + 1, sizeof(*gen->insts));
+  struct plx_x86_64_inst* const inst = &gen->insts[gen->inst_count++];
+  memset(inst, 0, sizeof(*inst));
+  inst->op = op;
+  return inst;
+}
+
+static void plx_x86_64_add_arg(struct plx_x86_64_generator* const gen,
+                               const unsigned int vreg) {
+  gen->args = plx_x86_64_reserve(gen->args, &gen->arg_cap, gen->arg_count + 1,
+                                 sizeof(*gen->args));
+  gen->args[gen->arg_count++] = vreg;
+}
+
+static unsigned int plx_x86_64_imm(struct plx_x86_64_generator* const gen,
+                                   const long long imm) {
+  struct plx_x86_64_inst* const inst =
+      plx_x86_64_add_inst(gen, PLX_X86_64_OP_IMM);
+  inst->dst = plx_x86_64_new_vreg(gen);
+  inst->imm = imm;
+  return inst->dst;
+}
+
+// Adds a binary operation on operands of the given type, or on addresses if
+// the type is `NULL`.
+static unsigned int plx_x86_64_binary(struct plx_x86_64_generator* const gen,
+                                      const enum plx_node_kind kind,
+                                      const struct plx_node* const type,
+                                      const unsigned int a,
+                                      const unsigned int b) {
+  struct plx_x86_64_inst* const inst =
+      plx_x86_64_add_inst(gen, PLX_X86_64_OP_BINARY);
+  inst->kind = kind;
+  inst->size = type == NULL ? 8 : (unsigned int)plx_x86_64_type_size(type);
+  inst->is_signed = type != NULL && plx_is_sint_type(type);
+  inst->dst = plx_x86_64_new_vreg(gen);
+  inst->a = a;
+  inst->b = b;
+  return inst->dst;
+}
+
+static unsigned int plx_x86_64_load(struct plx_x86_64_generator* const gen,
+                                    const struct plx_node* const type,
+                                    const unsigned int addr) {
+  struct plx_x86_64_inst* const inst =
+      plx_x86_64_add_inst(gen, PLX_X86_64_OP_LOAD);
+  inst->size = (unsigned int)plx_x86_64_type_size(type);
+  inst->is_signed = plx_is_sint_type(type);
+  inst->dst = plx_x86_64_new_vreg(gen);
+  inst->a = addr;
+  return inst->dst;
+}
+
+static void plx_x86_64_store(struct plx_x86_64_generator* const gen,
+                             const struct plx_node* const type,
+                             const unsigned int addr,
+                             const unsigned int value) {
+  struct plx_x86_64_inst* const inst =
+      plx_x86_64_add_inst(gen, PLX_X86_64_OP_STORE);
+  inst->size = (unsigned int)plx_x86_64_type_size(type);
+  inst->a = addr;
+  inst->b = value;
+}
+
+static void plx_x86_64_mov(struct plx_x86_64_generator* const gen,
+                           const unsigned int dst, const unsigned int a) {
+  struct plx_x86_64_inst* const inst =
+      plx_x86_64_add_inst(gen, PLX_X86_64_OP_MOV);
+  inst->dst = dst;
+  inst->a = a;
+}
+
+static void plx_x86_64_label(struct plx_x86_64_generator* const gen,
+                             const size_t label) {
+  plx_x86_64_add_inst(gen, PLX_X86_64_OP_LABEL)->target = label;
+}
+
+static void plx_x86_64_jump(struct plx_x86_64_generator* const gen,
+                            const size_t label) {
+  plx_x86_64_add_inst(gen, PLX_X86_64_OP_JUMP)->target = label;
+}
+
+// Adds a jump that is taken if a condition is false.
+static void plx_x86_64_branch_false(struct plx_x86_64_generator* const gen,
+                                    const unsigned int cond,
+                                    const size_t label) {
+  struct plx_x86_64_inst* const inst =
+      plx_x86_64_add_inst(gen, PLX_X86_64_OP_BRANCH_FALSE);
+  inst->a = cond;
+  inst->target = label;
+}
+
+static unsigned int plx_lower_x86_64_expr(
+    const struct plx_node* node, struct plx_x86_64_generator* gen);
+
+// Lowers an lvalue, returning the virtual register that holds its address.
+static unsigned int plx_lower_x86_64_addr(
+    const struct plx_node* const node,
+    struct plx_x86_64_generator* const gen) {
+  switch (node->kind) {
+    case PLX_NODE_INDEX: {
+      const struct plx_node *value, *index;
+      plx_extract_children(node, &value, &index);
+      const unsigned int value_addr = plx_lower_x86_64_addr(value, gen);
+      // Integers are held extended to 64 bits, so the index is used as is.
+      const unsigned int offset = plx_x86_64_binary(
+          gen, PLX_NODE_MUL, /*type=*/NULL, plx_lower_x86_64_expr(index, gen),
+          plx_x86_64_imm(gen, (long long)plx_x86_64_type_size(node->type)));
+      return plx_x86_64_binary(gen, PLX_NODE_ADD, /*type=*/NULL, value_addr,
+                               offset);
+    }
+    case PLX_NODE_DEREF: {
+      const struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      return plx_lower_x86_64_expr(operand, gen);
+    }
+    case PLX_NODE_IDENTIFIER: {
+      const struct plx_symbol_table_entry* const entry = node->entry;
+      assert(!plx_is_x86_64_reg_var(entry));
+      if (entry->scope == PLX_SYMBOL_SCOPE_GLOBAL) {
+        struct plx_x86_64_inst* const inst =
+            plx_x86_64_add_inst(gen, PLX_X86_64_OP_SYMBOL_ADDR);
+        inst->dst = plx_x86_64_new_vreg(gen);
+        inst->target = entry->x86_64_var;
+        return inst->dst;
+      }
+      struct plx_x86_64_inst* const inst =
+          plx_x86_64_add_inst(gen, PLX_X86_64_OP_SLOT_ADDR);
+      inst->dst = plx_x86_64_new_vreg(gen);
+      inst->imm = entry->x86_64_var;
+      return inst->dst;
+    }
+    default:
+      assert(false);
+  }
+  return 0;
+}
+
+static unsigned int plx_lower_x86_64_expr(
+    const struct plx_node* const node,
+    struct plx_x86_64_generator* const gen) {
+  switch (node->kind) {
+    case PLX_NODE_AND:
+    case PLX_NODE_OR:
+    case PLX_NODE_XOR:
+    case PLX_NODE_EQ:
+    case PLX_NODE_NEQ:
+    case PLX_NODE_LTE:
+    case PLX_NODE_LT:
+    case PLX_NODE_GTE:
+    case PLX_NODE_GT:
+    case PLX_NODE_ADD:
+    case PLX_NODE_SUB:
+    case PLX_NODE_MUL:
+    case PLX_NODE_DIV:
+    case PLX_NODE_REM:
+    case PLX_NODE_LSHIFT:
+    case PLX_NODE_RSHIFT: {
+      const struct plx_node *left, *right;
+      plx_extract_children(node, &left, &right);
+      assert(left->type->kind == right->type->kind);
+      const unsigned int a = plx_lower_x86_64_expr(left, gen);
+      const unsigned int b = plx_lower_x86_64_expr(right, gen);
+      return plx_x86_64_binary(gen, node->kind, left->type, a, b);
+    }
+    case PLX_NODE_NOT:
+    case PLX_NODE_NEG: {
+      const struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      const unsigned int a = plx_lower_x86_64_expr(operand, gen);
+      // Booleans are held as zero or one.
+      if (node->type->kind == PLX_NODE_BOOL_TYPE) {
+        return plx_x86_64_binary(gen, PLX_NODE_XOR, node->type, a,
+                                 plx_x86_64_imm(gen, 1));
+      }
+      struct plx_x86_64_inst* const inst =
+          plx_x86_64_add_inst(gen, PLX_X86_64_OP_UNARY);
+      inst->kind = node->kind;
+      inst->size = (unsigned int)plx_x86_64_type_size(node->type);
+      inst->is_signed = plx_is_sint_type(node->type);
+      inst->dst = plx_x86_64_new_vreg(gen);
+      inst->a = a;
+      return inst->dst;
+    }
+    case PLX_NODE_REF: {
+      const struct plx_node* operand;
+      plx_extract_children(node, &operand);
+      return plx_lower_x86_64_addr(operand, gen);
+    }
+    case PLX_NODE_DEREF:
+    case PLX_NODE_INDEX:
+      return plx_x86_64_load(gen, node->type,
+                             plx_lower_x86_64_addr(node, gen));
+    case PLX_NODE_BOUNDS_CHECK: {
+      // Values are held extended to 64 bits, so comparing them as unsigned
+      // makes negative indices out of bounds too.
+      const unsigned int index = plx_lower_x86_64_expr(node->children, gen);
+      if (gen->trap_label == SIZE_MAX) {
+        gen->trap_label = plx_x86_64_new_label(gen);
+      }
+      plx_x86_64_branch_false(
+          gen,
+          plx_x86_64_binary(gen, PLX_NODE_LT, /*type=*/NULL, index,
+                            plx_x86_64_imm(gen, (long long)node->uint)),
+          gen->trap_label);
+      return index;
+    }
+    case PLX_NODE_CALL: {
+      const struct plx_node *callee, *args;
+      plx_extract_children(node, &callee, &args);
+      // Functions are called directly rather than through a pointer.
+      const bool is_direct = callee->kind == PLX_NODE_IDENTIFIER &&
+                             plx_is_x86_64_func(callee->entry);
+      const unsigned int callee_value =
+          is_direct ? 0 : plx_lower_x86_64_expr(callee, gen);
+
+      // The arguments are lowered before they are added to the argument list,
+      // since they may contain calls themselves.
+      const size_t arg_count = plx_count_children(args);
+      unsigned int* const arg_values = malloc(arg_count * sizeof(unsigned int));
+      if (plx_unlikely(arg_values == NULL && arg_count > 0)) plx_oom();
+      size_t arg_index = 0;
+      for (const struct plx_node* arg = args->children; arg != NULL;
+           arg = arg->next) {
+        arg_values[arg_index++] = plx_lower_x86_64_expr(arg, gen);
+      }
+      const size_t first_arg = gen->arg_count;
+      for (size_t i = 0; i < arg_count; ++i) {
+        plx_x86_64_add_arg(gen, arg_values[i]);
+      }
+      free(arg_values);
+
+      struct plx_x86_64_inst* const inst = plx_x86_64_add_inst(
+          gen, node->tail_call ? PLX_X86_64_OP_TAIL_CALL : PLX_X86_64_OP_CALL);
+      inst->a = callee_value;
+      if (is_direct) inst->target = callee->entry->x86_64_var;
+      inst->first_arg = first_arg;
+      inst->arg_count = arg_count;
+      if (!node->tail_call && node->type->kind != PLX_NODE_VOID_TYPE) {
+        inst->size = (unsigned int)plx_x86_64_type_size(node->type);
+        inst->is_signed = plx_is_sint_type(node->type);
+        inst->dst = plx_x86_64_new_vreg(gen);
+      }
+      return inst->dst;
+    }
+    case PLX_NODE_IDENTIFIER: {
+      const struct plx_symbol_table_entry* const entry = node->entry;
+      if (plx_is_x86_64_func(entry)) {
+        struct plx_x86_64_inst* const inst =
+            plx_x86_64_add_inst(gen, PLX_X86_64_OP_SYMBOL_ADDR);
+        inst->dst = plx_x86_64_new_vreg(gen);
+        inst->target = entry->x86_64_var;
+        return inst->dst;
+      }
+      if (plx_is_x86_64_reg_var(entry)) return entry->x86_64_var;
+      return plx_x86_64_load(gen, node->type,
+                             plx_lower_x86_64_addr(node, gen));
+    }
+    case PLX_NODE_S8:
+    case PLX_NODE_S16:
+    case PLX_NODE_S32:
+    case PLX_NODE_S64:
+      return plx_x86_64_imm(gen, node->sint);
+    case PLX_NODE_U8:
+    case PLX_NODE_U16:
+    case PLX_NODE_U32:
+    case PLX_NODE_U64:
+      return plx_x86_64_imm(gen, (long long)node->uint);
+    case PLX_NODE_BOOL:
+      return plx_x86_64_imm(gen, node->b);
+    default:
+      assert(false);
+  }
+  return 0;
+}
+
+// Lowers the definition or declaration of a local variable.
+static void plx_lower_x86_64_local(const struct plx_node* const node,
+                                   struct plx_x86_64_generator* const gen) {
+  const struct plx_node* const name = node->children;
+  struct plx_symbol_table_entry* const entry = name->entry;
+  const struct plx_node* const value =
+      node->kind == PLX_NODE_VAR_DECL ? NULL : name->next;
+  if (plx_is_x86_64_reg_var(entry)) {
+    // Declared variables are zeroed, so that they are never used before they
+    // are defined.
+    entry->x86_64_var = plx_x86_64_new_vreg(gen);
+    plx_x86_64_mov(gen, entry->x86_64_var,
+                   value == NULL ? plx_x86_64_imm(gen, 0)
+                                 : plx_lower_x86_64_expr(value, gen));
+    return;
+  }
+  entry->x86_64_var =
+      plx_x86_64_new_slot(gen, plx_x86_64_type_size(entry->type),
+                          plx_x86_64_type_align(entry->type));
+  if (value != NULL) {
+    const unsigned int value_vreg = plx_lower_x86_64_expr(value, gen);
+    plx_x86_64_store(gen, entry->type, plx_lower_x86_64_addr(name, gen),
+                     value_vreg);
+  }
+}
+
+static void plx_lower_x86_64_stmt(const struct plx_node* node,
+                                  struct plx_x86_64_generator* gen);
+
+// Lowers a loop over a range or array. A single induction variable counts up
+// from zero or the start of the range to an end that is computed before the
+// loop, and `continue` jumps to the latch that increments it.
+static void plx_lower_x86_64_for_loop(const struct plx_node* const node,
+                                      struct plx_x86_64_generator* const gen) {
+  static const struct plx_node u64_type = {PLX_NODE_U64_TYPE};
+  const struct plx_node *name, *iterable, *body;
+  plx_extract_children(node, &name, &iterable, &body);
+
+  // The bounds are copied, since they may be variables that the body assigns
+  // to. Arrays are indexed from zero to their length.
+  const struct plx_node* counter_type = &u64_type;
+  unsigned int start, end, elements = 0;
+  if (iterable->kind == PLX_NODE_RANGE) {
+    const struct plx_node *start_node, *end_node;
+    plx_extract_children(iterable, &start_node, &end_node);
+    counter_type = iterable->type;
+    start = plx_lower_x86_64_expr(start_node, gen);
+    end = plx_lower_x86_64_expr(end_node, gen);
+  } else {
+    assert(iterable->type->kind == PLX_NODE_ARRAY_TYPE);
+    elements = plx_lower_x86_64_addr(iterable, gen);
+    start = plx_x86_64_imm(gen, 0);
+    end = plx_x86_64_imm(gen, (long long)iterable->type->children->uint);
+  }
+  const unsigned int counter = plx_x86_64_new_vreg(gen);
+  plx_x86_64_mov(gen, counter, start);
+  const unsigned int end_copy = plx_x86_64_new_vreg(gen);
+  plx_x86_64_mov(gen, end_copy, end);
+
+  // The loop variable is defined anew in each iteration.
+  struct plx_symbol_table_entry* const entry = name->entry;
+  if (plx_is_x86_64_reg_var(entry)) {
+    entry->x86_64_var = plx_x86_64_new_vreg(gen);
+  } else {
+    entry->x86_64_var =
+        plx_x86_64_new_slot(gen, plx_x86_64_type_size(entry->type),
+                            plx_x86_64_type_align(entry->type));
+  }
+
+  const size_t header_label = plx_x86_64_new_label(gen);
+  const size_t latch_label = plx_x86_64_new_label(gen);
+  const size_t exit_label = plx_x86_64_new_label(gen);
+  plx_x86_64_label(gen, header_label);
+  plx_x86_64_branch_false(
+      gen,
+      plx_x86_64_binary(gen, PLX_NODE_LT, counter_type, counter, end_copy),
+      exit_label);
+  unsigned int value = counter;
+  if (elements != 0) {
+    const unsigned int offset = plx_x86_64_binary(
+        gen, PLX_NODE_MUL, /*type=*/NULL, counter,
+        plx_x86_64_imm(gen, (long long)plx_x86_64_type_size(entry->type)));
+    value = plx_x86_64_load(
+        gen, entry->type,
+        plx_x86_64_binary(gen, PLX_NODE_ADD, /*type=*/NULL, elements, offset));
+  }
+  if (plx_is_x86_64_reg_var(entry)) {
+    plx_x86_64_mov(gen, entry->x86_64_var, value);
+  } else {
+    plx_x86_64_store(gen, entry->type, plx_lower_x86_64_addr(name, gen),
+                     value);
+  }
+
+  const size_t outer_continue_label = gen->continue_label;
+  const size_t outer_break_label = gen->break_label;
+  gen->continue_label = latch_label;
+  gen->break_label = exit_label;
+  plx_lower_x86_64_stmt(body, gen);
+  gen->continue_label = outer_continue_label;
+  gen->break_label = outer_break_label;
+
+  plx_x86_64_label(gen, latch_label);
+  plx_x86_64_mov(gen, counter,
+                 plx_x86_64_binary(gen, PLX_NODE_ADD, counter_type, counter,
+                                   plx_x86_64_imm(gen, 1)));
+  plx_x86_64_jump(gen, header_label);
+  plx_x86_64_label(gen, exit_label);
+}
+
+static void plx_lower_x86_64_stmt(const struct plx_node* const node,
+                                  struct plx_x86_64_generator* const gen) {
+  switch (node->kind) {
+    case PLX_NODE_CONST_DEF:
+    case PLX_NODE_VAR_DEF:
+    case PLX_NODE_VAR_DECL:
+      plx_lower_x86_64_local(node, gen);
+      break;
+    case PLX_NODE_NOP:
+      break;
+    case PLX_NODE_BLOCK:
+      for (const struct plx_node* stmt = node->children; stmt != NULL;
+           stmt = stmt->next) {
+        plx_lower_x86_64_stmt(stmt, gen);
+      }
+      break;
+    case PLX_NODE_IF_THEN_ELSE: {
+      const struct plx_node *cond, *then, *els;
+      plx_extract_children(node, &cond, &then, &els);
+      const size_t else_label = plx_x86_64_new_label(gen);
+      const size_t end_label = plx_x86_64_new_label(gen);
+      plx_x86_64_branch_false(gen, plx_lower_x86_64_expr(cond, gen),
+                              else_label);
+      plx_lower_x86_64_stmt(then, gen);
+      plx_x86_64_jump(gen, end_label);
+      plx_x86_64_label(gen, else_label);
+      plx_lower_x86_64_stmt(els, gen);
+      plx_x86_64_label(gen, end_label);
+      break;
+    }
+    case PLX_NODE_LOOP:
+    case PLX_NODE_WHILE_LOOP: {
+      const struct plx_node *cond = NULL, *body;
+      if (node->kind == PLX_NODE_LOOP) {
+        plx_extract_children(node, &body);
+      } else {
+        plx_extract_children(node, &cond, &body);
+      }
+      const size_t header_label = plx_x86_64_new_label(gen);
+      const size_t exit_label = plx_x86_64_new_label(gen);
+      plx_x86_64_label(gen, header_label);
+      if (cond != NULL) {
+        plx_x86_64_branch_false(gen, plx_lower_x86_64_expr(cond, gen),
+                                exit_label);
+      }
+      const size_t outer_continue_label = gen->continue_label;
+      const size_t outer_break_label = gen->break_label;
+      gen->continue_label = header_label;
+      gen->break_label = exit_label;
+      plx_lower_x86_64_stmt(body, gen);
+      plx_x86_64_jump(gen, header_label);
+      gen->continue_label = outer_continue_label;
+      gen->break_label = outer_break_label;
+      plx_x86_64_label(gen, exit_label);
+      break;
+    }
+    case PLX_NODE_FOR_LOOP:
+      plx_lower_x86_64_for_loop(node, gen);
+      break;
+    case PLX_NODE_CONTINUE:
+      plx_x86_64_jump(gen, gen->continue_label);
+      break;
+    case PLX_NODE_BREAK:
+      plx_x86_64_jump(gen, gen->break_label);
+      break;
+    case PLX_NODE_RETURN: {
+      // Tail calls return by themselves.
+      if (node->children != NULL && node->children->kind == PLX_NODE_CALL &&
+          node->children->tail_call) {
+        plx_lower_x86_64_expr(node->children, gen);
+        break;
+      }
+      const unsigned int value = node->children == NULL
+                                     ? 0
+                                     : plx_lower_x86_64_expr(node->children,
+                                                             gen);
+      plx_x86_64_add_inst(gen, PLX_X86_64_OP_RET)->a = value;
+      break;
+    }
+    case PLX_NODE_ASSIGN: {
+      const struct plx_node *assignee, *value;
+      plx_extract_children(node, &assignee, &value);
+      if (assignee->kind == PLX_NODE_IDENTIFIER &&
+          plx_is_x86_64_reg_var(assignee->entry)) {
+        plx_x86_64_mov(gen, assignee->entry->x86_64_var,
+                       plx_lower_x86_64_expr(value, gen));
+        break;
+      }
+      const unsigned int addr = plx_lower_x86_64_addr(assignee, gen);
+      plx_x86_64_store(gen, assignee->type, addr,
+                       plx_lower_x86_64_expr(value, gen));
+      break;
+    }
+    case PLX_NODE_ADD_ASSIGN:
+    case PLX_NODE_SUB_ASSIGN:
+    case PLX_NODE_MUL_ASSIGN:
+    case PLX_NODE_DIV_ASSIGN:
+    case PLX_NODE_REM_ASSIGN:
+    case PLX_NODE_LSHIFT_ASSIGN:
+    case PLX_NODE_RSHIFT_ASSIGN: {
+      const struct plx_node *assignee, *value;
+      plx_extract_children(node, &assignee, &value);
+      assert(assignee->type->kind == value->type->kind);
+      enum plx_node_kind kind = PLX_NODE_NOP;
+      switch (node->kind) {
+        case PLX_NODE_ADD_ASSIGN:
+          kind = PLX_NODE_ADD;
+          break;
+        case PLX_NODE_SUB_ASSIGN:
+          kind = PLX_NODE_SUB;
+          break;
+        case PLX_NODE_MUL_ASSIGN:
+          kind = PLX_NODE_MUL;
+          break;
+        case PLX_NODE_DIV_ASSIGN:
+          kind = PLX_NODE_DIV;
+          break;
+        case PLX_NODE_REM_ASSIGN:
+          kind = PLX_NODE_REM;
+          break;
+        case PLX_NODE_LSHIFT_ASSIGN:
+          kind = PLX_NODE_LSHIFT;
+          break;
+        case PLX_NODE_RSHIFT_ASSIGN:
+          kind = PLX_NODE_RSHIFT;
+          break;
+        default:
+          assert(false);
+      }
+      if (assignee->kind == PLX_NODE_IDENTIFIER &&
+          plx_is_x86_64_reg_var(assignee->entry)) {
+        const unsigned int var = assignee->entry->x86_64_var;
+        const unsigned int right = plx_lower_x86_64_expr(value, gen);
+        plx_x86_64_mov(
+            gen, var, plx_x86_64_binary(gen, kind, assignee->type, var, right));
+        break;
+      }
+      const unsigned int addr = plx_lower_x86_64_addr(assignee, gen);
+      const unsigned int left = plx_x86_64_load(gen, assignee->type, addr);
+      const unsigned int right = plx_lower_x86_64_expr(value, gen);
+      plx_x86_64_store(gen, assignee->type, addr,
+                       plx_x86_64_binary(gen, kind, assignee->type, left,
+                                         right));
+      break;
+    }
+    case PLX_NODE_CALL:
+      plx_lower_x86_64_expr(node, gen);
+      break;
+    default:
+      assert(false);
+  }
+}
+
+// Lowers a function to instructions on virtual registers.
+static void plx_lower_x86_64_func(const struct plx_node* const node,
+                                  struct plx_x86_64_generator* const gen) {
+  const struct plx_node *name, *params, *return_type, *body;
+  plx_extract_children(node, &name, &params, &return_type, &body);
+  gen->inst_count = 0;
+  gen->arg_count = 0;
+  gen->vreg_count = 0;
+  gen->label_count = 0;
+  gen->frame_size = 0;
+  gen->trap_label = SIZE_MAX;
+
+  // Parameters arrive in virtual registers. Those whose address is taken are
+  // then stored to stack slots.
+  struct plx_x86_64_inst* const inst =
+      plx_x86_64_add_inst(gen, PLX_X86_64_OP_PARAMS);
+  inst->arg_count = plx_count_children(params);
+  for (const struct plx_node* param = params->children; param != NULL;
+       param = param->next) {
+    plx_x86_64_add_arg(gen, plx_x86_64_new_vreg(gen));
+  }
+  size_t param_index = 0;
+  for (const struct plx_node* param = params->children; param != NULL;
+       param = param->next) {
+    const struct plx_node* const param_name = param->children;
+    struct plx_symbol_table_entry* const entry = param_name->entry;
+    const unsigned int vreg = gen->args[param_index++];
+    if (plx_is_x86_64_reg_var(entry)) {
+      entry->x86_64_var = vreg;
+    } else {
+      entry->x86_64_var =
+          plx_x86_64_new_slot(gen, plx_x86_64_type_size(entry->type),
+                              plx_x86_64_type_align(entry->type));
+      plx_x86_64_store(gen, entry->type,
+                       plx_lower_x86_64_addr(param_name, gen), vreg);
+    }
+  }
+
+  plx_lower_x86_64_stmt(body, gen);
+  if (return_type->kind == PLX_NODE_VOID_TYPE) {
+    plx_x86_64_add_inst(gen, PLX_X86_64_OP_RET);
+  } else {
+    plx_x86_64_add_inst(gen, PLX_X86_64_OP_UNREACHABLE);
+  }
+
+  // The bounds checks share a trap at the end of the function.
+  if (gen->trap_label != SIZE_MAX) {
+    plx_x86_64_label(gen, gen->trap_label);
+    plx_x86_64_add_inst(gen, PLX_X86_64_OP_UNREACHABLE);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Register allocation
+// ---------------------------------------------------------------------------
+
+// Extends the live interval of a virtual register to a position.
+static void plx_x86_64_use(struct plx_x86_64_generator* const gen,
+                           const unsigned int vreg, const size_t pos) {
+  if (vreg == 0) return;
+  struct plx_x86_64_interval* const interval = &gen->intervals[vreg];
+  if (pos < interval->start) interval->start = pos;
+  if (pos > interval->end) interval->end = pos;
+}
+
+// Computes the live intervals of the virtual registers. Intervals span the
+// positions between the first and last uses of the registers, extended to the
+// ends of the loops that they are live into.
+static void plx_x86_64_compute_intervals(
+    struct plx_x86_64_generator* const gen) {
+  for (unsigned int vreg = 0; vreg <= gen->vreg_count; ++vreg) {
+    gen->intervals[vreg] = (struct plx_x86_64_interval){
+        SIZE_MAX, 0, false, PLX_X86_64_NO_REG, 0};
+  }
+  for (size_t pos = 0; pos < gen->inst_count; ++pos) {
+    const struct plx_x86_64_inst* const inst = &gen->insts[pos];
+    plx_x86_64_use(gen, inst->dst, pos);
+    plx_x86_64_use(gen, inst->a, pos);
+    plx_x86_64_use(gen, inst->b, pos);
+    if (inst->op == PLX_X86_64_OP_CALL ||
+        inst->op == PLX_X86_64_OP_TAIL_CALL ||
+        inst->op == PLX_X86_64_OP_PARAMS) {
+      for (size_t i = 0; i < inst->arg_count; ++i) {
+        plx_x86_64_use(gen, gen->args[inst->first_arg + i], pos);
+      }
+    }
+    if (inst->op == PLX_X86_64_OP_LABEL) gen->label_offsets[inst->target] = pos;
+  }
+
+  // A register that is live at the header of a loop is live throughout it,
+  // since the loop may jump back to the header. Nested loops may extend the
+  // interval again.
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t pos = 0; pos < gen->inst_count; ++pos) {
+      const struct plx_x86_64_inst* const inst = &gen->insts[pos];
+      if (inst->op != PLX_X86_64_OP_JUMP) continue;
+      const size_t header = gen->label_offsets[inst->target];
+      if (header > pos) continue;
+      for (unsigned int vreg = 1; vreg <= gen->vreg_count; ++vreg) {
+        struct plx_x86_64_interval* const interval = &gen->intervals[vreg];
+        if (interval->start < header && interval->end >= header &&
+            interval->end < pos) {
+          interval->end = pos;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  // Number the calls before each position, to find the intervals that cross
+  // calls.
+  size_t* const calls = malloc((gen->inst_count + 1) * sizeof(size_t));
+  if (plx_unlikely(calls == NULL)) plx_oom();
+  calls[0] = 0;
+  for (size_t pos = 0; pos < gen->inst_count; ++pos) {
+    calls[pos + 1] =
+        calls[pos] + (gen->insts[pos].op == PLX_X86_64_OP_CALL ? 1 : 0);
+  }
+  for (unsigned int vreg = 1; vreg <= gen->vreg_count; ++vreg) {
+    struct plx_x86_64_interval* const interval = &gen->intervals[vreg];
+    if (interval->start == SIZE_MAX) continue;
+    interval->crosses_call = calls[interval->end] > calls[interval->start + 1];
+  }
+  free(calls);
+}
+
+// Spills a virtual register to a new stack slot.
+static void plx_x86_64_spill(struct plx_x86_64_generator* const gen,
+                             const unsigned int vreg) {
+  gen->intervals[vreg].reg = PLX_X86_64_NO_REG;
+  gen->intervals[vreg].slot = plx_x86_64_new_slot(gen, 8, 8);
+}
+
+// Appends a virtual register to the allocation order if it is first used at a
+// position. Ordered registers are marked with RAX, which is never allocated.
+static void plx_x86_64_order(struct plx_x86_64_generator* const gen,
+                             const unsigned int vreg, const size_t pos,
+                             unsigned int* const order,
+                             size_t* const order_len) {
+  if (vreg == 0) return;
+  struct plx_x86_64_interval* const interval = &gen->intervals[vreg];
+  if (interval->start != pos || interval->reg != PLX_X86_64_NO_REG) return;
+  interval->reg = PLX_X86_64_RAX;
+  order[(*order_len)++] = vreg;
+}
+
+// Returns whether a register may be allocated to an interval.
+static bool plx_x86_64_reg_allowed(
+    const struct plx_x86_64_interval* const interval, const int reg) {
+  if (!interval->crosses_call) return true;
+  for (size_t i = 0; i < sizeof(plx_x86_64_callee_saved_regs) /
+                             sizeof(*plx_x86_64_callee_saved_regs);
+       ++i) {
+    if ((int)plx_x86_64_callee_saved_regs[i] == reg) return true;
+  }
+  return false;
+}
+
+// Allocates registers with linear scan. Intervals are visited in order of
+// their starts, and when no register is free, the interval that ends last is
+// spilled.
+static void plx_x86_64_allocate_regs(struct plx_x86_64_generator* const gen) {
+  plx_x86_64_compute_intervals(gen);
+
+  // Virtual registers are visited in order of the instructions that first use
+  // them.
+  unsigned int* const order = malloc(gen->vreg_count * sizeof(unsigned int));
+  if (plx_unlikely(order == NULL && gen->vreg_count > 0)) plx_oom();
+  size_t order_len = 0;
+  for (size_t pos = 0; pos < gen->inst_count; ++pos) {
+    const struct plx_x86_64_inst* const inst = &gen->insts[pos];
+    plx_x86_64_order(gen, inst->a, pos, order, &order_len);
+    plx_x86_64_order(gen, inst->b, pos, order, &order_len);
+    plx_x86_64_order(gen, inst->dst, pos, order, &order_len);
+    if (inst->op == PLX_X86_64_OP_CALL ||
+        inst->op == PLX_X86_64_OP_TAIL_CALL ||
+        inst->op == PLX_X86_64_OP_PARAMS) {
+      for (size_t i = 0; i < inst->arg_count; ++i) {
+        plx_x86_64_order(gen, gen->args[inst->first_arg + i], pos, order,
+                         &order_len);
+      }
+    }
+  }
+
+  // Active intervals, in order of their ends.
+  unsigned int active[16];
+  size_t active_len = 0;
+  unsigned int free_regs = 0;
+  for (size_t i = 0; i < sizeof(plx_x86_64_caller_saved_regs) /
+                             sizeof(*plx_x86_64_caller_saved_regs);
+       ++i) {
+    free_regs |= 1u << plx_x86_64_caller_saved_regs[i];
+  }
+  for (size_t i = 0; i < sizeof(plx_x86_64_callee_saved_regs) /
+                             sizeof(*plx_x86_64_callee_saved_regs);
+       ++i) {
+    free_regs |= 1u << plx_x86_64_callee_saved_regs[i];
+  }
+
+  for (size_t i = 0; i < order_len; ++i) {
+    const unsigned int vreg = order[i];
+    struct plx_x86_64_interval* const interval = &gen->intervals[vreg];
+
+    // Expire the intervals that have ended.
+    size_t kept = 0;
+    for (size_t j = 0; j < active_len; ++j) {
+      const struct plx_x86_64_interval* const other =
+          &gen->intervals[active[j]];
+      if (other->end < interval->start) {
+        free_regs |= 1u << other->reg;
+      } else {
+        active[kept++] = active[j];
+      }
+    }
+    active_len = kept;
+
+    // Prefer registers that calls may clobber, unless the interval crosses a
+    // call.
+    interval->reg = PLX_X86_64_NO_REG;
+    if (!interval->crosses_call) {
+      for (size_t j = 0; j < sizeof(plx_x86_64_caller_saved_regs) /
+                                 sizeof(*plx_x86_64_caller_saved_regs);
+           ++j) {
+        if (free_regs & 1u << plx_x86_64_caller_saved_regs[j]) {
+          interval->reg = (int)plx_x86_64_caller_saved_regs[j];
+          break;
+        }
+      }
+    }
+    if (interval->reg == PLX_X86_64_NO_REG) {
+      for (size_t j = 0; j < sizeof(plx_x86_64_callee_saved_regs) /
+                                 sizeof(*plx_x86_64_callee_saved_regs);
+           ++j) {
+        if (free_regs & 1u << plx_x86_64_callee_saved_regs[j]) {
+          interval->reg = (int)plx_x86_64_callee_saved_regs[j];
+          break;
+        }
+      }
+    }
+
+    if (interval->reg == PLX_X86_64_NO_REG) {
+      // Take the register of the active interval that ends last, if it ends
+      // after this one.
+      size_t victim = active_len;
+      for (size_t j = active_len; j-- > 0;) {
+        if (plx_x86_64_reg_allowed(interval,
+                                   gen->intervals[active[j]].reg)) {
+          victim = j;
+          break;
+        }
+      }
+      if (victim == active_len ||
+          gen->intervals[active[victim]].end <= interval->end) {
+        plx_x86_64_spill(gen, vreg);
+        continue;
+      }
+      interval->reg = gen->intervals[active[victim]].reg;
+      plx_x86_64_spill(gen, active[victim]);
+      memmove(&active[victim], &active[victim + 1],
+              (active_len - victim - 1) * sizeof(*active));
+      --active_len;
+    } else {
+      free_regs &= ~(1u << interval->reg);
+    }
+
+    // Insert the interval in order of its end.
+    size_t j = active_len++;
+    while (j > 0 && gen->intervals[active[j - 1]].end > interval->end) {
+      active[j] = active[j - 1];
+      --j;
+    }
+    active[j] = vreg;
+  }
+  free(order);
+
+  // Callee-saved registers that are used are saved in stack slots.
+  memset(gen->saved_reg_slots, 0, sizeof(gen->saved_reg_slots));
+  for (unsigned int vreg = 1; vreg <= gen->vreg_count; ++vreg) {
+    const int reg = gen->intervals[vreg].reg;
+    if (reg == PLX_X86_64_NO_REG || gen->saved_reg_slots[reg] != 0) continue;
+    for (size_t i = 0; i < sizeof(plx_x86_64_callee_saved_regs) /
+                               sizeof(*plx_x86_64_callee_saved_regs);
+         ++i) {
+      if ((int)plx_x86_64_callee_saved_regs[i] == reg) {
+        gen->saved_reg_slots[reg] = plx_x86_64_new_slot(gen, 8, 8);
+      }
+    }
+  }
+
+  // The stack pointer stays aligned to 16 bytes at calls.
+  gen->frame_size = (gen->frame_size + 15) / 16 * 16;
+}
+
+// ---------------------------------------------------------------------------
+// Encoding
+// ---------------------------------------------------------------------------
+
+static void plx_x86_64_byte(struct plx_x86_64_generator* const gen,
+                            const unsigned int byte) {
+  plx_buffer_append_char(&gen->object->text, (char)byte);
+}
+
+static void plx_x86_64_u32(struct plx_x86_64_generator* const gen,
+                           const uint32_t value) {
+  for (unsigned int i = 0; i < 4; ++i) plx_x86_64_byte(gen, value >> (i * 8));
+}
+
+// Emits a REX prefix if one is needed to use 64-bit operands or the upper
+// eight registers.
+static void plx_x86_64_rex(struct plx_x86_64_generator* const gen,
+                           const bool w, const unsigned int reg,
+                           const unsigned int rm) {
+  const unsigned int rex =
+      0x40 | (w ? 0x08 : 0) | (reg >> 3 & 1) << 2 | (rm >> 3 & 1);
+  if (rex != 0x40) plx_x86_64_byte(gen, rex);
+}
+
+// Emits an opcode. Opcodes above 0xFF are two bytes long.
+static void plx_x86_64_opcode(struct plx_x86_64_generator* const gen,
+                              const unsigned int opcode) {
+  if (opcode > 0xFF) plx_x86_64_byte(gen, opcode >> 8);
+  plx_x86_64_byte(gen, opcode & 0xFF);
+}
+
+// Emits an instruction whose operands are both registers. `reg` may be an
+// opcode extension instead.
+static void plx_x86_64_rr(struct plx_x86_64_generator* const gen,
+                          const bool w, const unsigned int opcode,
+                          const unsigned int reg, const unsigned int rm) {
+  plx_x86_64_rex(gen, w, reg, rm);
+  plx_x86_64_opcode(gen, opcode);
+  plx_x86_64_byte(gen, 0xC0 | (reg & 7) << 3 | (rm & 7));
+}
+
+// Emits an instruction with a memory operand at `[base + disp]`.
+static void plx_x86_64_rm(struct plx_x86_64_generator* const gen,
+                          const bool w, const unsigned int opcode,
+                          const unsigned int reg, const unsigned int base,
+                          const int32_t disp) {
+  plx_x86_64_rex(gen, w, reg, base);
+  plx_x86_64_opcode(gen, opcode);
+  // RBP and R13 always take a displacement, and RSP and R12 take an SIB byte.
+  const unsigned int mod = disp == 0 && (base & 7) != PLX_X86_64_RBP ? 0x00
+                           : disp >= INT8_MIN && disp <= INT8_MAX    ? 0x40
+                                                                     : 0x80;
+  plx_x86_64_byte(gen, mod | (reg & 7) << 3 | (base & 7));
+  if ((base & 7) == PLX_X86_64_RSP) plx_x86_64_byte(gen, 0x24);
+  if (mod == 0x40) {
+    plx_x86_64_byte(gen, (uint8_t)disp);
+  } else if (mod == 0x80) {
+    plx_x86_64_u32(gen, (uint32_t)disp);
+  }
+}
+
+// Emits a push or pop of a register.
+static void plx_x86_64_push_pop(struct plx_x86_64_generator* const gen,
+                                const unsigned int opcode,
+                                const unsigned int reg) {
+  plx_x86_64_rex(gen, /*w=*/false, 0, reg);
+  plx_x86_64_byte(gen, opcode + (reg & 7));
+}
+
+// Emits `mov reg, imm`, choosing the shortest encoding.
+static void plx_x86_64_mov_imm(struct plx_x86_64_generator* const gen,
+                               const unsigned int reg, const long long imm) {
+  if (imm >= 0 && imm <= UINT32_MAX) {
+    // Writing a 32-bit register zeroes the upper half.
+    plx_x86_64_rex(gen, /*w=*/false, 0, reg);
+    plx_x86_64_byte(gen, 0xB8 + (reg & 7));
+    plx_x86_64_u32(gen, (uint32_t)imm);
+  } else if (imm >= INT32_MIN && imm <= INT32_MAX) {
+    plx_x86_64_rr(gen, /*w=*/true, 0xC7, 0, reg);
+    plx_x86_64_u32(gen, (uint32_t)imm);
+  } else {
+    plx_x86_64_rex(gen, /*w=*/true, 0, reg);
+    plx_x86_64_byte(gen, 0xB8 + (reg & 7));
+    plx_x86_64_u32(gen, (uint32_t)imm);
+    plx_x86_64_u32(gen, (uint32_t)((unsigned long long)imm >> 32));
+  }
+}
+
+// Emits a 32-bit displacement to a label, to be patched once the label is
+// placed.
+static void plx_x86_64_label_disp(struct plx_x86_64_generator* const gen,
+                                  const size_t label) {
+  gen->fixups = plx_x86_64_reserve(gen->fixups, &gen->fixup_cap,
+                                   gen->fixup_count + 1, sizeof(*gen->fixups));
+  gen->fixups[gen->fixup_count++] =
+      (struct plx_x86_64_fixup){gen->object->text.len, label};
+  plx_x86_64_u32(gen, 0);
+}
+
+// Emits a 32-bit displacement to a symbol, to be relocated by the linker.
+static void plx_x86_64_symbol_disp(struct plx_x86_64_generator* const gen,
+                                   const size_t symbol,
+                                   const enum plx_x86_64_reloc_type type) {
+  struct plx_x86_64_object* const object = gen->object;
+  object->relocs =
+      plx_x86_64_reserve(object->relocs, &object->reloc_cap,
+                         object->reloc_count + 1, sizeof(*object->relocs));
+  // The displacement is relative to the end of the field.
+  object->relocs[object->reloc_count++] =
+      (struct plx_x86_64_reloc){object->text.len, symbol, type, -4};
+  plx_x86_64_u32(gen, 0);
+}
+
+// Returns the register that holds a virtual register, or the scratch register
+// if it is spilled.
+static unsigned int plx_x86_64_reg_or(
+    const struct plx_x86_64_generator* const gen, const unsigned int vreg,
+    const unsigned int scratch) {
+  const int reg = gen->intervals[vreg].reg;
+  return reg == PLX_X86_64_NO_REG ? scratch : (unsigned int)reg;
+}
+
+// Copies a virtual register into a machine register.
+static void plx_x86_64_read(struct plx_x86_64_generator* const gen,
+                            const unsigned int reg, const unsigned int vreg) {
+  const struct plx_x86_64_interval* const interval = &gen->intervals[vreg];
+  if (interval->reg == PLX_X86_64_NO_REG) {
+    plx_x86_64_rm(gen, /*w=*/true, 0x8B, reg, PLX_X86_64_RBP,
+                  -(int32_t)interval->slot);
+  } else if ((unsigned int)interval->reg != reg) {
+    plx_x86_64_rr(gen, /*w=*/true, 0x89, (unsigned int)interval->reg, reg);
+  }
+}
+
+// Copies a machine register into a virtual register.
+static void plx_x86_64_write(struct plx_x86_64_generator* const gen,
+                             const unsigned int vreg, const unsigned int reg) {
+  const struct plx_x86_64_interval* const interval = &gen->intervals[vreg];
+  if (interval->reg == PLX_X86_64_NO_REG) {
+    plx_x86_64_rm(gen, /*w=*/true, 0x89, reg, PLX_X86_64_RBP,
+                  -(int32_t)interval->slot);
+  } else if ((unsigned int)interval->reg != reg) {
+    plx_x86_64_rr(gen, /*w=*/true, 0x89, reg, (unsigned int)interval->reg);
+  }
+}
+
+// Extends the low bytes of RAX to 64 bits. Integers are always held extended,
+// so that they can be compared, divided and used as indices as 64-bit values.
+static void plx_x86_64_extend(struct plx_x86_64_generator* const gen,
+                              const unsigned int size, const bool is_signed) {
+  switch (size) {
+    case 1:
+      // movsx rax, al / movzx eax, al
+      plx_x86_64_rr(gen, is_signed, is_signed ? 0x0FBE : 0x0FB6,
+                    PLX_X86_64_RAX, PLX_X86_64_RAX);
+      break;
+    case 2:
+      // movsx rax, ax / movzx eax, ax
+      plx_x86_64_rr(gen, is_signed, is_signed ? 0x0FBF : 0x0FB7,
+                    PLX_X86_64_RAX, PLX_X86_64_RAX);
+      break;
+    case 4:
+      // movsxd rax, eax / mov eax, eax
+      plx_x86_64_rr(gen, is_signed, is_signed ? 0x63 : 0x89, PLX_X86_64_RAX,
+                    PLX_X86_64_RAX);
+      break;
+    default:
+      break;
+  }
+}
+
+// Returns the condition code of a comparison.
+static unsigned int plx_x86_64_cond(const enum plx_node_kind kind,
+                                    const bool is_signed) {
+  switch (kind) {
+    case PLX_NODE_EQ:
+      return 0x4;
+    case PLX_NODE_NEQ:
+      return 0x5;
+    case PLX_NODE_LT:
+      return is_signed ? 0xC : 0x2;
+    case PLX_NODE_GTE:
+      return is_signed ? 0xD : 0x3;
+    case PLX_NODE_LTE:
+      return is_signed ? 0xE : 0x6;
+    case PLX_NODE_GT:
+      return is_signed ? 0xF : 0x7;
+    default:
+      assert(false);
+  }
+  return 0;
+}
+
+// Emits a binary operation. The operands are read into RAX and RCX, which
+// division and shifts require anyway.
+static void plx_x86_64_emit_binary(struct plx_x86_64_generator* const gen,
+                                   const struct plx_x86_64_inst* const inst) {
+  plx_x86_64_read(gen, PLX_X86_64_RAX, inst->a);
+  plx_x86_64_read(gen, PLX_X86_64_RCX, inst->b);
+  switch (inst->kind) {
+    case PLX_NODE_AND:
+      plx_x86_64_rr(gen, /*w=*/true, 0x21, PLX_X86_64_RCX, PLX_X86_64_RAX);
+      break;
+    case PLX_NODE_OR:
+      plx_x86_64_rr(gen, /*w=*/true, 0x09, PLX_X86_64_RCX, PLX_X86_64_RAX);
+      break;
+    case PLX_NODE_XOR:
+      plx_x86_64_rr(gen, /*w=*/true, 0x31, PLX_X86_64_RCX, PLX_X86_64_RAX);
+      break;
+    case PLX_NODE_EQ:
+    case PLX_NODE_NEQ:
+    case PLX_NODE_LTE:
+    case PLX_NODE_LT:
+    case PLX_NODE_GTE:
+    case PLX_NODE_GT:
+      // cmp rax, rcx; setcc al; movzx eax, al
+      plx_x86_64_rr(gen, /*w=*/true, 0x39, PLX_X86_64_RCX, PLX_X86_64_RAX);
+      plx_x86_64_rr(gen, /*w=*/false,
+                    0x0F90 | plx_x86_64_cond(inst->kind, inst->is_signed), 0,
+                    PLX_X86_64_RAX);
+      plx_x86_64_extend(gen, 1, /*is_signed=*/false);
+      plx_x86_64_write(gen, inst->dst, PLX_X86_64_RAX);
+      return;
+    case PLX_NODE_ADD:
+      plx_x86_64_rr(gen, /*w=*/true, 0x01, PLX_X86_64_RCX, PLX_X86_64_RAX);
+      break;
+    case PLX_NODE_SUB:
+      plx_x86_64_rr(gen, /*w=*/true, 0x29, PLX_X86_64_RCX, PLX_X86_64_RAX);
+      break;
+    case PLX_NODE_MUL:
+      plx_x86_64_rr(gen, /*w=*/true, 0x0FAF, PLX_X86_64_RAX, PLX_X86_64_RCX);
+      break;
+    case PLX_NODE_DIV:
+    case PLX_NODE_REM:
+      if (inst->is_signed) {
+        // cqo; idiv rcx
+        plx_x86_64_byte(gen, 0x48);
+        plx_x86_64_byte(gen, 0x99);
+        plx_x86_64_rr(gen, /*w=*/true, 0xF7, 7, PLX_X86_64_RCX);
+      } else {
+        // xor edx, edx; div rcx
+        plx_x86_64_rr(gen, /*w=*/false, 0x31, PLX_X86_64_RDX, PLX_X86_64_RDX);
+        plx_x86_64_rr(gen, /*w=*/true, 0xF7, 6, PLX_X86_64_RCX);
+      }
+      if (inst->kind == PLX_NODE_REM) {
+        plx_x86_64_rr(gen, /*w=*/true, 0x89, PLX_X86_64_RDX, PLX_X86_64_RAX);
+      }
+      break;
+    case PLX_NODE_LSHIFT:
+      // shl rax, cl
+      plx_x86_64_rr(gen, /*w=*/true, 0xD3, 4, PLX_X86_64_RAX);
+      break;
+    case PLX_NODE_RSHIFT:
+      // Right shifts are logical, so signed operands are zero-extended first.
+      if (inst->is_signed) plx_x86_64_extend(gen, inst->size, false);
+      // shr rax, cl
+      plx_x86_64_rr(gen, /*w=*/true, 0xD3, 5, PLX_X86_64_RAX);
+      break;
+    default:
+      assert(false);
+  }
+  plx_x86_64_extend(gen, inst->size, inst->is_signed);
+  plx_x86_64_write(gen, inst->dst, PLX_X86_64_RAX);
+}
+
+// Emits a load of a value extended to 64 bits from the address in RAX.
+static void plx_x86_64_emit_load(struct plx_x86_64_generator* const gen,
+                                 const unsigned int size,
+                                 const bool is_signed) {
+  unsigned int opcode;
+  bool w = is_signed;
+  switch (size) {
+    case 1:
+      opcode = is_signed ? 0x0FBE : 0x0FB6;
+      break;
+    case 2:
+      opcode = is_signed ? 0x0FBF : 0x0FB7;
+      break;
+    case 4:
+      opcode = is_signed ? 0x63 : 0x8B;
+      break;
+    default:
+      opcode = 0x8B;
+      w = true;
+  }
+  plx_x86_64_rm(gen, w, opcode, PLX_X86_64_RAX, PLX_X86_64_RAX, 0);
+}
+
+// Restores the callee-saved registers and the caller's frame.
+static void plx_x86_64_emit_leave(struct plx_x86_64_generator* const gen) {
+  for (unsigned int reg = 0; reg < 16; ++reg) {
+    if (gen->saved_reg_slots[reg] == 0) continue;
+    plx_x86_64_rm(gen, /*w=*/true, 0x8B, reg, PLX_X86_64_RBP,
+                  -(int32_t)gen->saved_reg_slots[reg]);
+  }
+  // leave
+  plx_x86_64_byte(gen, 0xC9);
+}
+
+// Emits the epilogue.
+static void plx_x86_64_emit_ret(struct plx_x86_64_generator* const gen) {
+  plx_x86_64_emit_leave(gen);
+  // ret
+  plx_x86_64_byte(gen, 0xC3);
+}
+
+// Pushes the arguments of a call, the last one first.
+static void plx_x86_64_push_args(struct plx_x86_64_generator* const gen,
+                                 const struct plx_x86_64_inst* const inst) {
+  const unsigned int* const args = &gen->args[inst->first_arg];
+  for (size_t i = inst->arg_count; i-- > 0;) {
+    const struct plx_x86_64_interval* const interval = &gen->intervals[args[i]];
+    if (interval->reg == PLX_X86_64_NO_REG) {
+      // push qword [rbp - slot]
+      plx_x86_64_rm(gen, /*w=*/false, 0xFF, 6, PLX_X86_64_RBP,
+                    -(int32_t)interval->slot);
+    } else {
+      plx_x86_64_push_pop(gen, 0x50, (unsigned int)interval->reg);
+    }
+  }
+}
+
+// Emits a call. Arguments are moved into place by pushing them all and then
+// popping them into the argument registers, so that no argument is overwritten
+// before it is read.
+static void plx_x86_64_emit_call(struct plx_x86_64_generator* const gen,
+                                 const struct plx_x86_64_inst* const inst) {
+  const size_t reg_arg_count = inst->arg_count < PLX_X86_64_ARG_REG_COUNT
+                                   ? inst->arg_count
+                                   : PLX_X86_64_ARG_REG_COUNT;
+  const size_t stack_arg_count = inst->arg_count - reg_arg_count;
+
+  // The stack stays aligned to 16 bytes with the stack arguments.
+  const size_t stack_size = (stack_arg_count + 1) / 2 * 16;
+  if (stack_arg_count % 2 == 1) {
+    // sub rsp, 8
+    plx_x86_64_rr(gen, /*w=*/true, 0x83, 5, PLX_X86_64_RSP);
+    plx_x86_64_byte(gen, 8);
+  }
+  plx_x86_64_push_args(gen, inst);
+  if (inst->a != 0) plx_x86_64_read(gen, PLX_X86_64_R11, inst->a);
+  for (size_t i = 0; i < reg_arg_count; ++i) {
+    plx_x86_64_push_pop(gen, 0x58, plx_x86_64_arg_regs[i]);
+  }
+
+  if (inst->a == 0) {
+    plx_x86_64_byte(gen, 0xE8);
+    plx_x86_64_symbol_disp(gen, inst->target, PLX_X86_64_RELOC_PLT32);
+  } else {
+    // call r11
+    plx_x86_64_rr(gen, /*w=*/false, 0xFF, 2, PLX_X86_64_R11);
+  }
+
+  if (stack_size > 0) {
+    // add rsp, stack_size
+    plx_x86_64_rr(gen, /*w=*/true, 0x81, 0, PLX_X86_64_RSP);
+    plx_x86_64_u32(gen, (uint32_t)stack_size);
+  }
+  if (inst->dst != 0) {
+    plx_x86_64_extend(gen, inst->size, inst->is_signed);
+    plx_x86_64_write(gen, inst->dst, PLX_X86_64_RAX);
+  }
+}
+
+// Emits a tail call. The stack arguments overwrite the caller's own, of which
+// there are as many since the caller has the same signature, and the callee is
+// jumped to after the caller's frame is restored.
+static void plx_x86_64_emit_tail_call(
+    struct plx_x86_64_generator* const gen,
+    const struct plx_x86_64_inst* const inst) {
+  const size_t reg_arg_count = inst->arg_count < PLX_X86_64_ARG_REG_COUNT
+                                   ? inst->arg_count
+                                   : PLX_X86_64_ARG_REG_COUNT;
+  plx_x86_64_push_args(gen, inst);
+  if (inst->a != 0) plx_x86_64_read(gen, PLX_X86_64_R11, inst->a);
+  for (size_t i = 0; i < reg_arg_count; ++i) {
+    plx_x86_64_push_pop(gen, 0x58, plx_x86_64_arg_regs[i]);
+  }
+  for (size_t i = reg_arg_count; i < inst->arg_count; ++i) {
+    // pop qword [rbp + 16 + 8 * i]
+    plx_x86_64_rm(gen, /*w=*/false, 0x8F, 0, PLX_X86_64_RBP,
+                  (int32_t)(16 + 8 * (i - reg_arg_count)));
+  }
+  plx_x86_64_emit_leave(gen);
+
+  if (inst->a == 0) {
+    plx_x86_64_byte(gen, 0xE9);
+    plx_x86_64_symbol_disp(gen, inst->target, PLX_X86_64_RELOC_PLT32);
+  } else {
+    // jmp r11
+    plx_x86_64_rr(gen, /*w=*/false, 0xFF, 4, PLX_X86_64_R11);
+  }
+}
+
+// Emits the parameters into their virtual registers, by pushing the argument
+// registers and popping them into place.
+static void plx_x86_64_emit_params(struct plx_x86_64_generator* const gen,
+                                   const struct plx_x86_64_inst* const inst) {
+  const unsigned int* const params = &gen->args[inst->first_arg];
+  const size_t reg_param_count = inst->arg_count < PLX_X86_64_ARG_REG_COUNT
+                                     ? inst->arg_count
+                                     : PLX_X86_64_ARG_REG_COUNT;
+  for (size_t i = 0; i < reg_param_count; ++i) {
+    plx_x86_64_push_pop(gen, 0x50, plx_x86_64_arg_regs[i]);
+  }
+  for (size_t i = reg_param_count; i-- > 0;) {
+    const struct plx_x86_64_interval* const interval =
+        &gen->intervals[params[i]];
+    if (interval->reg == PLX_X86_64_NO_REG) {
+      // pop qword [rbp - slot]
+      plx_x86_64_rm(gen, /*w=*/false, 0x8F, 0, PLX_X86_64_RBP,
+                    -(int32_t)interval->slot);
+    } else {
+      plx_x86_64_push_pop(gen, 0x58, (unsigned int)interval->reg);
+    }
+  }
+
+  // The remaining parameters are above the return address.
+  for (size_t i = reg_param_count; i < inst->arg_count; ++i) {
+    plx_x86_64_rm(gen, /*w=*/true, 0x8B, PLX_X86_64_RAX, PLX_X86_64_RBP,
+                  (int32_t)(16 + 8 * (i - reg_param_count)));
+    plx_x86_64_write(gen, params[i], PLX_X86_64_RAX);
+  }
+}
+
+static void plx_x86_64_emit_inst(struct plx_x86_64_generator* const gen,
+                                 const size_t pos) {
+  const struct plx_x86_64_inst* const inst = &gen->insts[pos];
+  switch (inst->op) {
+    case PLX_X86_64_OP_PARAMS:
+      plx_x86_64_emit_params(gen, inst);
+      break;
+    case PLX_X86_64_OP_IMM: {
+      const unsigned int reg =
+          plx_x86_64_reg_or(gen, inst->dst, PLX_X86_64_RAX);
+      plx_x86_64_mov_imm(gen, reg, inst->imm);
+      plx_x86_64_write(gen, inst->dst, reg);
+      break;
+    }
+    case PLX_X86_64_OP_MOV: {
+      const unsigned int reg =
+          plx_x86_64_reg_or(gen, inst->dst, PLX_X86_64_RAX);
+      plx_x86_64_read(gen, reg, inst->a);
+      plx_x86_64_write(gen, inst->dst, reg);
+      break;
+    }
+    case PLX_X86_64_OP_UNARY:
+      plx_x86_64_read(gen, PLX_X86_64_RAX, inst->a);
+      // not rax / neg rax
+      plx_x86_64_rr(gen, /*w=*/true, 0xF7, inst->kind == PLX_NODE_NOT ? 2 : 3,
+                    PLX_X86_64_RAX);
+      plx_x86_64_extend(gen, inst->size, inst->is_signed);
+      plx_x86_64_write(gen, inst->dst, PLX_X86_64_RAX);
+      break;
+    case PLX_X86_64_OP_BINARY:
+      plx_x86_64_emit_binary(gen, inst);
+      break;
+    case PLX_X86_64_OP_LOAD:
+      plx_x86_64_read(gen, PLX_X86_64_RAX, inst->a);
+      plx_x86_64_emit_load(gen, inst->size, inst->is_signed);
+      plx_x86_64_write(gen, inst->dst, PLX_X86_64_RAX);
+      break;
+    case PLX_X86_64_OP_STORE: {
+      const unsigned int addr_reg =
+          plx_x86_64_reg_or(gen, inst->a, PLX_X86_64_R11);
+      plx_x86_64_read(gen, addr_reg, inst->a);
+      plx_x86_64_read(gen, PLX_X86_64_RAX, inst->b);
+      if (inst->size == 2) plx_x86_64_byte(gen, 0x66);
+      plx_x86_64_rm(gen, inst->size == 8, inst->size == 1 ? 0x88 : 0x89,
+                    PLX_X86_64_RAX, addr_reg, 0);
+      break;
+    }
+    case PLX_X86_64_OP_SLOT_ADDR: {
+      const unsigned int reg =
+          plx_x86_64_reg_or(gen, inst->dst, PLX_X86_64_RAX);
+      // lea reg, [rbp - slot]
+      plx_x86_64_rm(gen, /*w=*/true, 0x8D, reg, PLX_X86_64_RBP,
+                    -(int32_t)inst->imm);
+      plx_x86_64_write(gen, inst->dst, reg);
+      break;
+    }
+    case PLX_X86_64_OP_SYMBOL_ADDR: {
+      const unsigned int reg =
+          plx_x86_64_reg_or(gen, inst->dst, PLX_X86_64_RAX);
+      // lea reg, [rip + symbol]
+      plx_x86_64_rex(gen, /*w=*/true, reg, 0);
+      plx_x86_64_byte(gen, 0x8D);
+      plx_x86_64_byte(gen, 0x05 | (reg & 7) << 3);
+      plx_x86_64_symbol_disp(gen, inst->target, PLX_X86_64_RELOC_PC32);
+      plx_x86_64_write(gen, inst->dst, reg);
+      break;
+    }
+    case PLX_X86_64_OP_CALL:
+      plx_x86_64_emit_call(gen, inst);
+      break;
+    case PLX_X86_64_OP_TAIL_CALL:
+      plx_x86_64_emit_tail_call(gen, inst);
+      break;
+    case PLX_X86_64_OP_LABEL:
+      gen->label_offsets[inst->target] = gen->object->text.len;
+      break;
+    case PLX_X86_64_OP_JUMP:
+      // Jumps to the next instruction are omitted.
+      if (pos + 1 < gen->inst_count &&
+          gen->insts[pos + 1].op == PLX_X86_64_OP_LABEL &&
+          gen->insts[pos + 1].target == inst->target) {
+        break;
+      }
+      plx_x86_64_byte(gen, 0xE9);
+      plx_x86_64_label_disp(gen, inst->target);
+      break;
+    case PLX_X86_64_OP_BRANCH_FALSE: {
+      const unsigned int reg = plx_x86_64_reg_or(gen, inst->a, PLX_X86_64_RAX);
+      plx_x86_64_read(gen, reg, inst->a);
+      // test reg, reg; jz label
+      plx_x86_64_rr(gen, /*w=*/false, 0x85, reg, reg);
+      plx_x86_64_opcode(gen, 0x0F84);
+      plx_x86_64_label_disp(gen, inst->target);
+      break;
+    }
+    case PLX_X86_64_OP_RET:
+      if (inst->a != 0) plx_x86_64_read(gen, PLX_X86_64_RAX, inst->a);
+      plx_x86_64_emit_ret(gen);
+      break;
+    case PLX_X86_64_OP_UNREACHABLE:
+      // ud2
+      plx_x86_64_opcode(gen, 0x0F0B);
+      break;
+  }
+}
+
+static void plx_generate_x86_64_func(const struct plx_node* const node,
+                                     struct plx_x86_64_generator* const gen) {
+  plx_lower_x86_64_func(node, gen);
+
+  gen->intervals =
+      malloc((gen->vreg_count + 1) * sizeof(struct plx_x86_64_interval));
+  gen->label_offsets = malloc(gen->label_count * sizeof(size_t));
+  if (plx_unlikely(gen->intervals == NULL ||
+                   (gen->label_offsets == NULL && gen->label_count > 0))) {
+    plx_oom();
+  }
+  plx_x86_64_allocate_regs(gen);
+
+  // Functions are aligned to 16 bytes.
+  struct plx_buffer* const text = &gen->object->text;
+  while (text->len % 16 != 0) plx_x86_64_byte(gen, 0xCC);
+  const size_t start = text->len;
+
+  // push rbp; mov rbp, rsp; sub rsp, frame_size
+  plx_x86_64_push_pop(gen, 0x50, PLX_X86_64_RBP);
+  plx_x86_64_rr(gen, /*w=*/true, 0x89, PLX_X86_64_RSP, PLX_X86_64_RBP);
+  if (gen->frame_size > 0) {
+    plx_x86_64_rr(gen, /*w=*/true, 0x81, 5, PLX_X86_64_RSP);
+    plx_x86_64_u32(gen, gen->frame_size);
+  }
+  for (unsigned int reg = 0; reg < 16; ++reg) {
+    if (gen->saved_reg_slots[reg] == 0) continue;
+    plx_x86_64_rm(gen, /*w=*/true, 0x89, reg, PLX_X86_64_RBP,
+                  -(int32_t)gen->saved_reg_slots[reg]);
+  }
+
+  gen->fixup_count = 0;
+  for (size_t pos = 0; pos < gen->inst_count; ++pos) {
+    plx_x86_64_emit_inst(gen, pos);
+  }
+  for (size_t i = 0; i < gen->fixup_count; ++i) {
+    const struct plx_x86_64_fixup* const fixup = &gen->fixups[i];
+    const uint32_t disp =
+        (uint32_t)(gen->label_offsets[fixup->label] - (fixup->offset + 4));
+    for (unsigned int j = 0; j < 4; ++j) {
+      text->data[fixup->offset + j] = (char)(disp >> (j * 8));
+    }
+  }
+  free(gen->intervals);
+  free(gen->label_offsets);
+
+  const struct plx_node* const name = node->children;
+  struct plx_x86_64_symbol* const symbol =
+      &gen->object->symbols[name->entry->x86_64_var];
+  symbol->offset = start;
+  symbol->size = text->len - start;
+}
+
+// Appends a value to a data section, aligned to its size.
+static size_t plx_x86_64_append_value(struct plx_buffer* const section,
+                                      const struct plx_node* const value) {
+  const size_t size = plx_x86_64_type_size(value->type);
+  while (section->len % size != 0) plx_buffer_append_char(section, '\0');
+  const size_t offset = section->len;
+  unsigned long long bits;
+  switch (value->kind) {
+    case PLX_NODE_S8:
+    case PLX_NODE_S16:
+    case PLX_NODE_S32:
+    case PLX_NODE_S64:
+      bits = (unsigned long long)value->sint;
+      break;
+    case PLX_NODE_U8:
+    case PLX_NODE_U16:
+    case PLX_NODE_U32:
+    case PLX_NODE_U64:
+      bits = value->uint;
+      break;
+    case PLX_NODE_BOOL:
+      bits = value->b;
+      break;
+    default:
+      assert(false);
+      bits = 0;
+  }
+  for (size_t i = 0; i < size; ++i) {
+    plx_buffer_append_char(section, (char)(bits >> (i * 8)));
+  }
+  return offset;
+}
+
+// Defines the globals and declares the functions of a module, so that they can
+// be used before they are defined.
+static void plx_generate_x86_64_decl(const struct plx_node* const node,
+                                     struct plx_x86_64_object* const object) {
+  switch (node->kind) {
+    case PLX_NODE_CONST_DEF:
+    case PLX_NODE_VAR_DEF: {
+      const struct plx_node *name, *value;
+      plx_extract_children(node, &name, &value);
+      const enum plx_x86_64_section section =
+          node->kind == PLX_NODE_CONST_DEF ? PLX_X86_64_SECTION_RODATA
+                                           : PLX_X86_64_SECTION_DATA;
+      const size_t offset = plx_x86_64_append_value(
+          section == PLX_X86_64_SECTION_RODATA ? &object->rodata
+                                               : &object->data,
+          value);
+      name->entry->x86_64_var = (unsigned int)plx_x86_64_add_symbol(
+          object, name->name, section, offset,
+          plx_x86_64_type_size(value->type));
+      break;
+    }
+    case PLX_NODE_VAR_DECL: {
+      const struct plx_node *name, *type;
+      plx_extract_children(node, &name, &type);
+      const size_t align = plx_x86_64_type_align(type);
+      object->bss_size = (object->bss_size + align - 1) / align * align;
+      name->entry->x86_64_var = (unsigned int)plx_x86_64_add_symbol(
+          object, name->name, PLX_X86_64_SECTION_BSS, object->bss_size,
+          plx_x86_64_type_size(type));
+      object->bss_size += plx_x86_64_type_size(type);
+      break;
+    }
+    case PLX_NODE_FUNC_DEF: {
+      const struct plx_node* const name = node->children;
+      name->entry->x86_64_var = (unsigned int)plx_x86_64_add_symbol(
+          object, name->name, PLX_X86_64_SECTION_TEXT, 0, 0);
+      break;
+    }
+    case PLX_NODE_STRUCT_DEF:
+    case PLX_NODE_NOP:
+      break;
+    default:
+      assert(false);
+  }
+}
+
+bool plx_generate_x86_64(const struct plx_node* const module,
+                         struct plx_x86_64_object* const object) {
+  assert(module->kind == PLX_NODE_MODULE);
+  if (!plx_check_x86_64(module)) return false;
+
+  for (const struct plx_node* child = module->children; child != NULL;
+       child = child->next) {
+    plx_generate_x86_64_decl(child, object);
+  }
+
+  struct plx_x86_64_generator gen;
+  memset(&gen, 0, sizeof(gen));
+  gen.object = object;
+  for (const struct plx_node* child = module->children; child != NULL;
+       child = child->next) {
+    if (child->kind == PLX_NODE_FUNC_DEF) plx_generate_x86_64_func(child, &gen);
+  }
+  free(gen.insts);
+  free(gen.args);
+  free(gen.fixups);
+  return true;
+}
@@ -0,0 +1,91 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_X86_64_GENERATOR_H
+#define PLX_X86_64_GENERATOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ast.h"
+#include "buffer.h"
+
+// Sections of an x86-64 object.
+enum plx_x86_64_section {
+  PLX_X86_64_SECTION_TEXT,
+  PLX_X86_64_SECTION_DATA,
+  PLX_X86_64_SECTION_RODATA,
+  PLX_X86_64_SECTION_BSS,
+};
+
+// Symbol defined by an x86-64 object.
+struct plx_x86_64_symbol {
+  const char* name;
+  enum plx_x86_64_section section;
+
+  // Offset of the symbol in its section.
+  size_t offset;
+
+  // Size of the symbol in bytes.
+  size_t size;
+};
+
+// Relocation types, numbered as in the System V x86-64 ABI.
+enum plx_x86_64_reloc_type {
+  PLX_X86_64_RELOC_PC32 = 2,
+  PLX_X86_64_RELOC_PLT32 = 4,
+};
+
+// 32-bit field in the text that refers to a symbol.
+struct plx_x86_64_reloc {
+  // Offset of the field in the text.
+  size_t offset;
+
+  // Index of the symbol.
+  size_t symbol;
+
+  enum plx_x86_64_reloc_type type;
+  long long addend;
+};
+
+// Machine code and data of a module, before it is linked.
+struct plx_x86_64_object {
+  struct plx_buffer text;
+  struct plx_buffer data;
+  struct plx_buffer rodata;
+  size_t bss_size;
+
+  size_t symbol_count;
+  size_t symbol_cap;
+  struct plx_x86_64_symbol* symbols;
+
+  size_t reloc_count;
+  size_t reloc_cap;
+  struct plx_x86_64_reloc* relocs;
+};
+
+#define PLX_X86_64_OBJECT_INIT                                       \
+  ((struct plx_x86_64_object){PLX_BUFFER_INIT, PLX_BUFFER_INIT,     \
+                              PLX_BUFFER_INIT, 0, 0, 0, NULL, 0, 0, \
+                              NULL})
+
+// Frees the memory used by an object.
+void plx_x86_64_object_free(struct plx_x86_64_object* object);
+
+// Generates x86-64 machine code for a module. Returns whether the module only
+// uses features that the back end supports.
+bool plx_generate_x86_64(const struct plx_node* module,
+                         struct plx_x86_64_object* object);
+
+#endif  // PLX_X86_64_GENERATOR_H
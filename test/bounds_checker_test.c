@@ -0,0 +1,82 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bounds_checker.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+// Inserts bounds checks into a program, writing the report to the buffer.
+static void plx_insert_bounds_checks_for_test(const char* const source,
+                                              const enum plx_bounds_checks mode,
+                                              char* const buf,
+                                              const size_t size) {
+  struct plx_node* const module = plx_compile_front_end_for_test(source);
+  FILE* const report = tmpfile();
+  assert(report != NULL);
+  plx_insert_bounds_checks(module, mode, report);
+  plx_read_file_for_test(report, buf, size);
+}
+
+static const char plx_bounds_checks_test_source[] =
+    "func f(n: s32) -> s32 {\n"
+    "  var a: [8]s32;\n"
+    "  a[7] = 0;\n"
+    "  for i in 0..8 {\n"
+    "    a[i] = i;\n"
+    "  }\n"
+    "  var t = 0;\n"
+    "  for i in 0..4 {\n"
+    "    t += a[(i * 2) + 1];\n"
+    "    t += a[i + 5];\n"
+    "  }\n"
+    "  return t + a[n and 7];\n"
+    "}\n"
+    "\n"
+    "func g(n: s32) -> s32 {\n"
+    "  var a: [8]s32;\n"
+    "  a[0] = 0;\n"
+    "  return a[n];\n"
+    "}\n";
+
+// Tests that every index is checked when checks are not elided.
+static void plx_test_bounds_checker_on(void) {
+  char report[256];
+  plx_insert_bounds_checks_for_test(plx_bounds_checks_test_source,
+                                    PLX_BOUNDS_CHECKS_ON, report,
+                                    sizeof(report));
+  assert(strcmp(report,
+                "f: 0 of 5 bounds checks elided\n"
+                "g: 0 of 2 bounds checks elided\n") == 0);
+}
+
+// Tests that constant indices, loop counters and masked indices are proven to
+// be in bounds, and that indices that may be out of bounds are not.
+static void plx_test_bounds_checker_elided(void) {
+  char report[256];
+  plx_insert_bounds_checks_for_test(plx_bounds_checks_test_source,
+                                    PLX_BOUNDS_CHECKS_ELIDED, report,
+                                    sizeof(report));
+  assert(strcmp(report,
+                "f: 4 of 5 bounds checks elided\n"
+                "g: 1 of 2 bounds checks elided\n") == 0);
+}
+
+void plx_test_bounds_checker(void) {
+  plx_test_bounds_checker_on();
+  plx_test_bounds_checker_elided();
+}
@@ -0,0 +1,56 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "buffer.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <string.h>
+
+// Returns whether the contents of the buffer are equal to the string.
+static bool plx_buffer_eq(const struct plx_buffer* const buffer,
+                          const char* const str) {
+  return buffer->len == strlen(str) &&
+         memcmp(buffer->data, str, buffer->len) == 0;
+}
+
+// Tests appending integers at the limits of their types.
+static void plx_test_buffer_append_integers(void) {
+  struct plx_buffer buffer = PLX_BUFFER_INIT;
+  plx_buffer_append_ull(&buffer, 0);
+  plx_buffer_append_char(&buffer, ' ');
+  plx_buffer_append_ull(&buffer, ULLONG_MAX);
+  plx_buffer_append_char(&buffer, ' ');
+  plx_buffer_append_ll(&buffer, LLONG_MIN);
+  plx_buffer_append_char(&buffer, ' ');
+  plx_buffer_append_ll(&buffer, -42);
+  assert(plx_buffer_eq(
+      &buffer, "0 18446744073709551615 -9223372036854775808 -42"));
+  plx_buffer_free(&buffer);
+}
+
+// Tests appending more than the initial capacity of the buffer.
+static void plx_test_buffer_grow(void) {
+  struct plx_buffer buffer = PLX_BUFFER_INIT;
+  for (int i = 0; i < 10000; ++i) plx_buffer_append_str(&buffer, "abc");
+  assert(buffer.len == 30000);
+  assert(buffer.cap >= buffer.len);
+  assert(memcmp(&buffer.data[29997], "abc", 3) == 0);
+  plx_buffer_free(&buffer);
+}
+
+void plx_test_buffer(void) {
+  plx_test_buffer_append_integers();
+  plx_test_buffer_grow();
+}
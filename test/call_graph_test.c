@@ -0,0 +1,172 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "call_graph.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+// Builds the call graph of a program whose names have been resolved. The
+// program is not type checked, since the type checker does not support calls to
+// functions that are defined later, which mutual recursion needs.
+static void plx_build_call_graph_for_test(const char* const source,
+                                          struct plx_call_graph* const graph) {
+  plx_build_call_graph(plx_parse_for_test(source), graph);
+}
+
+// Returns the index of the function with the name.
+static size_t plx_find_func_for_test(const struct plx_call_graph* const graph,
+                                     const char* const name) {
+  for (size_t i = 0; i < graph->func_count; ++i) {
+    if (strcmp(graph->funcs[i]->children->name, name) == 0) return i;
+  }
+  assert(false);
+  return 0;
+}
+
+static const char plx_call_graph_test_source[] =
+    "func leaf() -> s32 {\n"
+    "  return 1;\n"
+    "}\n"
+    "\n"
+    "func twice(x: s32) -> s32 {\n"
+    "  return x + x;\n"
+    "}\n"
+    "\n"
+    "func apply(f: func (s32) -> s32, x: s32) -> s32 {\n"
+    "  return f(x);\n"
+    "}\n"
+    "\n"
+    "func even(n: s32) -> bool {\n"
+    "  return (n == 0) or odd(n - 1);\n"
+    "}\n"
+    "\n"
+    "func odd(n: s32) -> bool {\n"
+    "  return (n != 0) and even(n - 1);\n"
+    "}\n"
+    "\n"
+    "func fact(n: s32) -> s32 {\n"
+    "  return n * fact(n - 1);\n"
+    "}\n"
+    "\n"
+    "func main() -> s32 {\n"
+    "  var e = even(3);\n"
+    "  return apply(twice, fact(4)) + leaf();\n"
+    "}\n";
+
+// Tests that SCCs group mutually recursive functions and come in bottom-up
+// order.
+static void plx_test_call_graph_sccs(void) {
+  struct plx_call_graph graph;
+  plx_build_call_graph_for_test(plx_call_graph_test_source, &graph);
+  assert(graph.func_count == 7);
+  assert(graph.scc_count == 6);
+  const size_t even = plx_find_func_for_test(&graph, "even");
+  const size_t odd = plx_find_func_for_test(&graph, "odd");
+  assert(graph.func_sccs[even] == graph.func_sccs[odd]);
+  assert(plx_is_recursive(&graph, even));
+  assert(plx_is_recursive(&graph, odd));
+  assert(plx_is_recursive(&graph, plx_find_func_for_test(&graph, "fact")));
+  assert(!plx_is_recursive(&graph, plx_find_func_for_test(&graph, "main")));
+  assert(!plx_is_recursive(&graph, plx_find_func_for_test(&graph, "leaf")));
+
+  // Every callee is in the caller's SCC or an earlier one.
+  for (size_t func = 0; func < graph.func_count; ++func) {
+    for (size_t i = graph.edge_begins[func]; i < graph.edge_begins[func + 1];
+         ++i) {
+      assert(graph.func_sccs[graph.edges[i].callee] <= graph.func_sccs[func]);
+    }
+  }
+  assert(graph.func_sccs[plx_find_func_for_test(&graph, "main")] ==
+         graph.scc_count - 1);
+  plx_call_graph_free(&graph);
+}
+
+// Tests that an indirect call reaches the functions whose address is taken.
+static void plx_test_call_graph_indirect_calls(void) {
+  struct plx_call_graph graph;
+  plx_build_call_graph_for_test(plx_call_graph_test_source, &graph);
+  const size_t twice = plx_find_func_for_test(&graph, "twice");
+  const size_t apply = plx_find_func_for_test(&graph, "apply");
+  assert(graph.address_taken[twice]);
+  assert(!graph.address_taken[apply]);
+  assert(graph.edge_begins[apply + 1] - graph.edge_begins[apply] == 1);
+  assert(graph.edges[graph.edge_begins[apply]].callee == twice);
+  assert(graph.edges[graph.edge_begins[apply]].indirect);
+
+  // `main` calls `apply` but only passes `twice`.
+  const size_t main = plx_find_func_for_test(&graph, "main");
+  for (size_t i = graph.edge_begins[main]; i < graph.edge_begins[main + 1];
+       ++i) {
+    assert(graph.edges[i].callee != twice);
+  }
+  plx_call_graph_free(&graph);
+}
+
+// Tests the DOT output of a small call graph.
+static void plx_test_call_graph_dot(void) {
+  struct plx_call_graph graph;
+  plx_build_call_graph_for_test(
+      "func f(n: s32) -> s32 {\n"
+      "  return f(n);\n"
+      "}\n"
+      "\n"
+      "func main() -> s32 {\n"
+      "  return f(1) + f(2);\n"
+      "}\n",
+      &graph);
+  FILE* const stream = tmpfile();
+  assert(stream != NULL);
+  plx_print_call_graph_dot(&graph, stream);
+  plx_call_graph_free(&graph);
+  char buf[256];
+  fseek(stream, 0, SEEK_SET);
+  const size_t len = fread(buf, 1, sizeof(buf) - 1, stream);
+  buf[len] = '\0';
+  fclose(stream);
+  assert(strcmp(buf,
+                "digraph \"call graph\" {\n"
+                "  subgraph cluster_0 {\n"
+                "    label=\"SCC 0\";\n"
+                "    \"f\";\n"
+                "  }\n"
+                "  \"main\";\n"
+                "  \"f\" -> \"f\";\n"
+                "  \"main\" -> \"f\";\n"
+                "}\n") == 0);
+}
+
+// Tests that global constants that constant folding has removed are skipped.
+static void plx_test_call_graph_folded_consts(void) {
+  struct plx_call_graph graph;
+  plx_build_call_graph(plx_compile_front_end_for_test(
+                           "const k = 7;\n"
+                           "\n"
+                           "func main() -> s32 {\n"
+                           "  return k;\n"
+                           "}\n"),
+                       &graph);
+  assert(graph.func_count == 1);
+  assert(graph.edge_begins[1] == 0);
+  plx_call_graph_free(&graph);
+}
+
+void plx_test_call_graph(void) {
+  plx_test_call_graph_sccs();
+  plx_test_call_graph_indirect_calls();
+  plx_test_call_graph_dot();
+  plx_test_call_graph_folded_consts();
+}
@@ -0,0 +1,249 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "common_subexpr_eliminator.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bounds_checker.h"
+#include "buffer.h"
+#include "llvm_ir_generator.h"
+#include "test_helpers.h"
+
+// Eliminates the common subexpressions of a program, writing the report to the
+// buffer, and returns the program.
+static struct plx_node* plx_eliminate_common_subexprs_for_test(
+    const char* const source, const enum plx_bounds_checks bounds_checks,
+    char* const buf, const size_t size) {
+  struct plx_node* const module = plx_compile_front_end_for_test(source);
+  plx_insert_bounds_checks(module, bounds_checks, /*report=*/NULL);
+
+  FILE* const report = tmpfile();
+  assert(report != NULL);
+  plx_eliminate_common_subexprs(module, report);
+  plx_read_file_for_test(report, buf, size);
+  return module;
+}
+
+// Returns the number of variable definitions in a node.
+static int plx_count_var_defs(const struct plx_node* const node) {
+  int count = node->kind == PLX_NODE_VAR_DEF;
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    count += plx_count_var_defs(child);
+  }
+  return count;
+}
+
+// Returns the first node of a kind in a node, or `NULL` if there is none.
+static const struct plx_node* plx_find_node(const struct plx_node* const node,
+                                            const enum plx_node_kind kind) {
+  if (node->kind == kind) return node;
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    const struct plx_node* const found = plx_find_node(child, kind);
+    if (found != NULL) return found;
+  }
+  return NULL;
+}
+
+// Tests that repeated arithmetic, indexing and bounds checks are evaluated
+// once, including across statements and in nested blocks.
+static void plx_test_common_subexpr_eliminator_kernels(void) {
+  static const char source[] =
+      "func sq(a: [8]s32, i: s32) -> s32 {\n"
+      "  return a[i] * a[i];\n"
+      "}\n"
+      "\n"
+      "func poly(x: s32, y: s32) -> s32 {\n"
+      "  var p = 0;\n"
+      "  p = (x * y) + (x * y);\n"
+      "  var q = 0;\n"
+      "  q = ((x * y) + 1) * ((x * y) + 1);\n"
+      "  if (x * y) > 0 {\n"
+      "    return (p + q) - (x * y);\n"
+      "  }\n"
+      "  return p + q;\n"
+      "}\n";
+  char report[256];
+  const struct plx_node* const module = plx_eliminate_common_subexprs_for_test(
+      source, PLX_BOUNDS_CHECKS_ON, report, sizeof(report));
+  assert(strcmp(report,
+                "sq: 1 common subexpressions eliminated\n"
+                "poly: 6 common subexpressions eliminated\n") == 0);
+
+  // `x * y` and `(x * y) + 1` are each held in a temporary.
+  const struct plx_node* const poly = module->children->next;
+  assert(plx_count_var_defs(poly) == 4);
+}
+
+// Tests that loads are not reused across stores that may change them, that
+// stores to other local variables and calls leave them available, and that
+// loops only reuse the expressions that they leave unchanged.
+static void plx_test_common_subexpr_eliminator_memory(void) {
+  static const char source[] =
+      "var g: [4]s32;\n"
+      "\n"
+      "noinline func h() -> s32 {\n"
+      "  return 0;\n"
+      "}\n"
+      "\n"
+      "func local(i: s32) -> s32 {\n"
+      "  var a: [4]s32;\n"
+      "  var b: [4]s32;\n"
+      "  a[0] = 1;\n"
+      "  var s = 0;\n"
+      "  s = a[i] + 1;\n"
+      "  b[i] = 2;\n"
+      "  var c = 0;\n"
+      "  c = h();\n"
+      "  var t = 0;\n"
+      "  t = a[i] + 1;\n"
+      "  a[i] = 3;\n"
+      "  return (s + t) + (a[i] + 1);\n"
+      "}\n"
+      "\n"
+      "func global(i: s32, r: &s32) -> s32 {\n"
+      "  var s = 0;\n"
+      "  s = g[i] + *r;\n"
+      "  *r = 1;\n"
+      "  var t = 0;\n"
+      "  t = g[i] + *r;\n"
+      "  var u = 0;\n"
+      "  u = g[i] * 2;\n"
+      "  var c = 0;\n"
+      "  c = h();\n"
+      "  return ((s + t) + u) + (g[i] * 2);\n"
+      "}\n"
+      "\n"
+      "func varying(n: s32) -> s32 {\n"
+      "  var x = 0;\n"
+      "  x = n * 3;\n"
+      "  var y = 0;\n"
+      "  y = n * 5;\n"
+      "  var t = 0;\n"
+      "  while t < (n * 3) {\n"
+      "    t += n * 5;\n"
+      "    n += 1;\n"
+      "  }\n"
+      "  return t;\n"
+      "}\n"
+      "\n"
+      "func invariant(m: s32) -> s32 {\n"
+      "  var x = 0;\n"
+      "  x = m * 3;\n"
+      "  var t = 0;\n"
+      "  while t < (m * 3) {\n"
+      "    t += m * 3;\n"
+      "  }\n"
+      "  return t + x;\n"
+      "}\n";
+  char report[256];
+  plx_eliminate_common_subexprs_for_test(source, PLX_BOUNDS_CHECKS_OFF, report,
+                                         sizeof(report));
+  assert(strcmp(report,
+                "local: 1 common subexpressions eliminated\n"
+                "global: 1 common subexpressions eliminated\n"
+                "invariant: 2 common subexpressions eliminated\n") == 0);
+}
+
+// Tests that calls made as statements make the loads of memory that they may
+// write unavailable, including globals and local variables whose address is
+// taken, but not other local variables.
+static void plx_test_common_subexpr_eliminator_call_stmts(void) {
+  static const char source[] =
+      "var g: s32;\n"
+      "\n"
+      "noinline func bump() {\n"
+      "  g += 5;\n"
+      "}\n"
+      "\n"
+      "noinline func set(p: &s32, v: s32) {\n"
+      "  *p = v;\n"
+      "}\n"
+      "\n"
+      "func global() -> s32 {\n"
+      "  g = 3;\n"
+      "  var x = 0;\n"
+      "  x = g * 7;\n"
+      "  bump();\n"
+      "  var y = 0;\n"
+      "  y = g * 7;\n"
+      "  return y - x;\n"
+      "}\n"
+      "\n"
+      "func referenced(b: s32) -> s32 {\n"
+      "  var a = 0;\n"
+      "  a = 2;\n"
+      "  var x = 0;\n"
+      "  x = a * b;\n"
+      "  set(&a, 7);\n"
+      "  var y = 0;\n"
+      "  y = a * b;\n"
+      "  return y - x;\n"
+      "}\n"
+      "\n"
+      "func local(n: s32) -> s32 {\n"
+      "  var x = 0;\n"
+      "  x = n * 3;\n"
+      "  bump();\n"
+      "  var y = 0;\n"
+      "  y = n * 3;\n"
+      "  return y - x;\n"
+      "}\n";
+  char report[256];
+  plx_eliminate_common_subexprs_for_test(source, PLX_BOUNDS_CHECKS_OFF, report,
+                                         sizeof(report));
+  assert(strcmp(report, "local: 1 common subexpressions eliminated\n") == 0);
+}
+
+// Tests that the operand of a reference stays a place when the value that it
+// refers to is available.
+static void plx_test_common_subexpr_eliminator_refs(void) {
+  static const char source[] =
+      "var g: [4]s32;\n"
+      "\n"
+      "func f(i: s32) -> s32 {\n"
+      "  var x = 0;\n"
+      "  x = g[i] + 1;\n"
+      "  var p: &s32;\n"
+      "  p = &g[i];\n"
+      "  return (x + *p) + g[i];\n"
+      "}\n";
+  char report[256];
+  struct plx_node* const module = plx_eliminate_common_subexprs_for_test(
+      source, PLX_BOUNDS_CHECKS_OFF, report, sizeof(report));
+  assert(strcmp(report, "f: 1 common subexpressions eliminated\n") == 0);
+
+  // `&g[i]` still indexes `g` rather than the temporary that holds `g[i]`.
+  const struct plx_node* const ref = plx_find_node(module, PLX_NODE_REF);
+  assert(ref != NULL);
+  assert(ref->children->kind == PLX_NODE_INDEX);
+  assert(ref->children->children->kind == PLX_NODE_IDENTIFIER);
+  assert(strcmp(ref->children->children->name, "g") == 0);
+
+  struct plx_buffer buffer = PLX_BUFFER_INIT;
+  plx_generate_llvm_ir(module, /*fast_math=*/false, &buffer);
+  assert(buffer.len > 0);
+  plx_buffer_free(&buffer);
+}
+
+void plx_test_common_subexpr_eliminator(void) {
+  plx_test_common_subexpr_eliminator_kernels();
+  plx_test_common_subexpr_eliminator_memory();
+  plx_test_common_subexpr_eliminator_call_stmts();
+  plx_test_common_subexpr_eliminator_refs();
+}
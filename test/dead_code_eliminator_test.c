@@ -0,0 +1,113 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include "dead_code_eliminator.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+// Removes the unused definitions of a program, writing the report to `report`,
+// which has `size` bytes, and the names of the remaining definitions to
+// `names`.
+static size_t plx_eliminate_dead_defs_for_test(const char* const source,
+                                               char* const report,
+                                               char* const names,
+                                               const size_t size) {
+  struct plx_node* const module = plx_compile_front_end_for_test(source);
+  FILE* const log = tmpfile();
+  assert(log != NULL);
+  const size_t removed = plx_eliminate_dead_defs(module, log);
+  plx_read_file_for_test(log, report, size);
+
+  names[0] = '\0';
+  for (const struct plx_node* def = module->children; def != NULL;
+       def = def->next) {
+    if (def->kind == PLX_NODE_NOP) continue;
+    strcat(names, def->children->name);
+    strcat(names, " ");
+  }
+  return removed;
+}
+
+static void plx_test_dead_code_eliminator_unused_defs(void) {
+  static const char source[] =
+      "const size = 4;\n"
+      "var used: s32;\n"
+      "var unused: [64]s32;\n"
+      "\n"
+      "func helper(x: s32) -> s32 {\n"
+      "  used = x;\n"
+      "  return used + size;\n"
+      "}\n"
+      "\n"
+      "func dead2(x: s32) -> s32 {\n"
+      "  unused[0] = x;\n"
+      "  return x;\n"
+      "}\n"
+      "\n"
+      "func dead(x: s32) -> s32 {\n"
+      "  return dead2(x) + dead(x);\n"
+      "}\n"
+      "\n"
+      "func main(argc: s32) -> s32 {\n"
+      "  return helper(argc);\n"
+      "}\n";
+  char report[512], names[128];
+  assert(plx_eliminate_dead_defs_for_test(source, report, names,
+                                          sizeof(report)) == 3);
+  assert(strcmp(names, "used helper main ") == 0);
+  assert(strcmp(report,
+                "removed unused variable `unused`\n"
+                "removed unused function `dead2`\n"
+                "removed unused function `dead`\n") == 0);
+}
+
+static void plx_test_dead_code_eliminator_without_main(void) {
+  // A module without `main` has no roots, so everything is kept.
+  static const char source[] =
+      "func f() -> s32 {\n"
+      "  return 1;\n"
+      "}\n";
+  char report[64], names[64];
+  assert(plx_eliminate_dead_defs_for_test(source, report, names,
+                                          sizeof(report)) == 0);
+  assert(strcmp(names, "f ") == 0);
+  assert(report[0] == '\0');
+}
+
+static void plx_test_dead_code_eliminator_global_consts(void) {
+  // Constant folding turns global constants into NOPs unless their address is
+  // taken.
+  static const char source[] =
+      "const unused = 3;\n"
+      "const k = 7;\n"
+      "const t = 5;\n"
+      "\n"
+      "func main() -> s32 {\n"
+      "  return k + *&t;\n"
+      "}\n";
+  char report[64], names[64];
+  assert(plx_eliminate_dead_defs_for_test(source, report, names,
+                                          sizeof(report)) == 0);
+  assert(strcmp(names, "t main ") == 0);
+  assert(report[0] == '\0');
+}
+
+void plx_test_dead_code_eliminator(void) {
+  plx_test_dead_code_eliminator_unused_defs();
+  plx_test_dead_code_eliminator_without_main();
+  plx_test_dead_code_eliminator_global_consts();
+}
@@ -0,0 +1,148 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "inliner.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "ast_validator.h"
+#include "constant_folder.h"
+#include "test_helpers.h"
+
+// Inlines the calls in a program, writing the log to the buffer, and returns
+// the program.
+static struct plx_node* plx_inline_calls_for_test(const char* const source,
+                                                  const int threshold,
+                                                  char* const buf,
+                                                  const size_t size) {
+  struct plx_node* const module = plx_compile_front_end_for_test(source);
+  FILE* const log = tmpfile();
+  assert(log != NULL);
+  struct plx_call_graph graph;
+  plx_build_call_graph(module, &graph);
+  plx_inline_calls(&graph, threshold, log);
+  plx_call_graph_free(&graph);
+  while (plx_fold_constants(module)) {
+  }
+  assert(plx_validate_ast(module));
+  plx_read_file_for_test(log, buf, size);
+  return module;
+}
+
+// Returns the number of nodes of a kind in a node.
+static int plx_count_nodes(const struct plx_node* const node,
+                           const enum plx_node_kind kind) {
+  int count = node->kind == kind;
+  for (const struct plx_node* child = node->children; child != NULL;
+       child = child->next) {
+    count += plx_count_nodes(child, kind);
+  }
+  return count;
+}
+
+static const char plx_inliner_test_source[] =
+    "func sq(x: s32) -> s32 {\n"
+    "  return x * x;\n"
+    "}\n"
+    "\n"
+    "inline func mix(x: s32, y: s32) -> s32 {\n"
+    "  return ((x * y) + (x - y)) * ((x + y) - (x * y));\n"
+    "}\n"
+    "\n"
+    "noinline func one() -> s32 {\n"
+    "  return 1;\n"
+    "}\n"
+    "\n"
+    "func r(n: s32) -> s32 {\n"
+    "  return r(n - 1);\n"
+    "}\n"
+    "\n"
+    "func f(a: s32, b: s32) -> s32 {\n"
+    "  var t = 0;\n"
+    "  t += sq(a);\n"
+    "  t += sq(5);\n"
+    "  t += sq(b + 1);\n"
+    "  t += sq(one());\n"
+    "  t += mix(a, b);\n"
+    "  t += r(b);\n"
+    "  return t;\n"
+    "}\n";
+
+// Tests that only calls whose cost is within the threshold and calls to
+// functions marked `inline` are inlined.
+static void plx_test_inliner_cost_model(void) {
+  char log[1024];
+  plx_inline_calls_for_test(plx_inliner_test_source, /*threshold=*/0, log,
+                            sizeof(log));
+  assert(strcmp(log,
+                "<test>:14:10: did not inline `r` into `r`: it is recursive\n"
+                "<test>:19:8: inlined `sq` into `f` (cost 0)\n"
+                "<test>:20:8: inlined `sq` into `f` (cost -2)\n"
+                "<test>:21:8: did not inline `sq` into `f`: its cost exceeds "
+                "the threshold\n"
+                "<test>:22:11: did not inline `one` into `f`: it is marked "
+                "`noinline`\n"
+                "<test>:22:8: did not inline `sq` into `f`: its arguments may "
+                "not be reordered\n"
+                "<test>:23:8: inlined `mix` into `f` (cost 11)\n"
+                "<test>:24:8: did not inline `r` into `f`: it is "
+                "recursive\n") == 0);
+}
+
+// Tests that only calls to functions marked `inline` are inlined when the
+// cost model is disabled.
+static void plx_test_inliner_hinted_only(void) {
+  char log[1024];
+  plx_inline_calls_for_test(plx_inliner_test_source, PLX_INLINE_HINTED_ONLY,
+                            log, sizeof(log));
+  assert(strstr(log,
+                "<test>:19:8: did not inline `sq` into `f`: it is not marked "
+                "`inline`\n") != NULL);
+  assert(strstr(log, "<test>:23:8: inlined `mix` into `f` (cost 11)\n") !=
+         NULL);
+}
+
+// Tests that divisions that trap are not folded once constant arguments are
+// inlined.
+static void plx_test_inliner_trapping_divisions(void) {
+  static const char source[] =
+      "inline func div(a: s32, b: s32) -> s32 {\n"
+      "  return a / b;\n"
+      "}\n"
+      "\n"
+      "inline func rem(a: s32, b: s32) -> s32 {\n"
+      "  return a % b;\n"
+      "}\n"
+      "\n"
+      "func main() -> s32 {\n"
+      "  var r = 0;\n"
+      "  r = rem(5, 0) + rem((-2147483647) - 1, -1);\n"
+      "  return (div(7, 0) + div((-2147483647) - 1, -1)) + div(7, 2);\n"
+      "}\n";
+  char log[512];
+  const struct plx_node* const module = plx_inline_calls_for_test(
+      source, PLX_INLINE_HINTED_ONLY, log, sizeof(log));
+  const struct plx_node* const main = module->children->next->next;
+  assert(plx_count_nodes(main, PLX_NODE_CALL) == 0);
+  assert(plx_count_nodes(main, PLX_NODE_DIV) == 2);
+  assert(plx_count_nodes(main, PLX_NODE_REM) == 2);
+}
+
+void plx_test_inliner(void) {
+  plx_test_inliner_cost_model();
+  plx_test_inliner_hinted_only();
+  plx_test_inliner_trapping_divisions();
+}
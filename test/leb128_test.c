@@ -15,7 +15,12 @@
 #include "leb128.h"
 
 #include <assert.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+
+#include "buffer.h"
 
 // Tests writing an unsigned integer in LEB128 format using an example sourced
 // from Wikipedia.
@@ -47,7 +52,125 @@ static void plx_test_write_leb128_ll(void) {
   fclose(stream);
 }
 
+// Tests appending integers to a buffer in LEB128 format using the examples
+// sourced from Wikipedia.
+static void plx_test_append_leb128(void) {
+  struct plx_buffer buffer = PLX_BUFFER_INIT;
+  plx_append_leb128_ull(&buffer, 624485U);
+  plx_append_leb128_ll(&buffer, -123456);
+  const unsigned char expected[] = {0xE5, 0x8E, 0x26, 0xC0, 0xBB, 0x78};
+  assert(buffer.len == sizeof(expected));
+  assert(memcmp(buffer.data, expected, sizeof(expected)) == 0);
+  plx_buffer_free(&buffer);
+}
+
+// Tests decoding integers in LEB128 format, including truncated and
+// overlong encodings.
+static void plx_test_decode_leb128(void) {
+  unsigned long long u;
+  const unsigned char u_bytes[] = {0xE5, 0x8E, 0x26};
+  assert(plx_decode_leb128_ull(u_bytes, sizeof(u_bytes), &u) == 3);
+  assert(u == 624485U);
+  assert(plx_decode_leb128_ull(u_bytes, 2, &u) == 0);
+
+  long long s;
+  const unsigned char s_bytes[] = {0xC0, 0xBB, 0x78};
+  assert(plx_decode_leb128_ll(s_bytes, sizeof(s_bytes), &s) == 3);
+  assert(s == -123456);
+  assert(plx_decode_leb128_ll(s_bytes, 2, &s) == 0);
+
+  // Padding with continuation bytes is allowed.
+  const unsigned char padded[] = {0x82, 0x80, 0x80, 0x00};
+  assert(plx_decode_leb128_ull(padded, sizeof(padded), &u) == 4);
+  assert(u == 2);
+
+  // Bits past 64 are rejected.
+  const unsigned char too_big[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                   0xFF, 0xFF, 0xFF, 0xFF, 0x02};
+  assert(plx_decode_leb128_ull(too_big, sizeof(too_big), &u) == 0);
+  assert(plx_decode_leb128_ll(too_big, sizeof(too_big), &s) == 0);
+  const unsigned char too_long[] = {0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+                                    0x80, 0x80, 0x80, 0x80, 0x00};
+  assert(plx_decode_leb128_ull(too_long, sizeof(too_long), &u) == 0);
+}
+
+// Tests that padded placeholders are five bytes long and decode to the value
+// they are patched with.
+static void plx_test_patch_leb128(void) {
+  struct plx_buffer buffer = PLX_BUFFER_INIT;
+  plx_buffer_append_char(&buffer, 1);
+  const size_t offset = plx_append_leb128_placeholder(&buffer);
+  plx_buffer_append_char(&buffer, 2);
+  assert(buffer.len == 2 + PLX_LEB128_PADDED_LEN);
+
+  const uint32_t values[] = {0, 1, 127, 128, 624485U, UINT32_MAX};
+  for (size_t i = 0; i < sizeof(values) / sizeof(*values); ++i) {
+    plx_patch_leb128_u32(&buffer, offset, values[i]);
+    unsigned long long value;
+    assert(plx_decode_leb128_ull((const unsigned char*)&buffer.data[offset],
+                                 buffer.len - offset,
+                                 &value) == PLX_LEB128_PADDED_LEN);
+    assert(value == values[i]);
+  }
+  assert(buffer.data[0] == 1);
+  assert(buffer.data[buffer.len - 1] == 2);
+  plx_buffer_free(&buffer);
+}
+
+// Returns the next number from a xorshift generator, which makes the fuzzed
+// values the same on every run.
+static uint64_t plx_next_random(uint64_t* const state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *state = x;
+  return x;
+}
+
+// Tests that random integers of every magnitude decode to themselves.
+static void plx_test_leb128_round_trip(void) {
+  uint64_t state = 0x9E3779B97F4A7C15U;
+  for (int i = 0; i < 100000; ++i) {
+    // Shift the value so that every encoded length is covered.
+    const uint64_t bits = plx_next_random(&state) >> (i % 64);
+    unsigned char bytes[PLX_LEB128_MAX_LEN];
+
+    const unsigned long long u = bits;
+    size_t len = plx_encode_leb128_ull(bytes, u);
+    unsigned long long u_decoded;
+    assert(plx_decode_leb128_ull(bytes, len, &u_decoded) == len);
+    assert(u_decoded == u);
+
+    const long long s = (i % 2 == 0) ? (long long)bits : -(long long)(bits / 2);
+    len = plx_encode_leb128_ll(bytes, s);
+    long long s_decoded;
+    assert(plx_decode_leb128_ll(bytes, len, &s_decoded) == len);
+    assert(s_decoded == s);
+  }
+
+  const long long extremes[] = {LLONG_MIN, LLONG_MIN + 1, -65, -64, -1, 0,
+                                63,        64,            LLONG_MAX};
+  for (size_t i = 0; i < sizeof(extremes) / sizeof(*extremes); ++i) {
+    unsigned char bytes[PLX_LEB128_MAX_LEN];
+    const size_t len = plx_encode_leb128_ll(bytes, extremes[i]);
+    long long decoded;
+    assert(plx_decode_leb128_ll(bytes, len, &decoded) == len);
+    assert(decoded == extremes[i]);
+  }
+  unsigned char bytes[PLX_LEB128_MAX_LEN];
+  assert(plx_encode_leb128_ull(bytes, ULLONG_MAX) == PLX_LEB128_MAX_LEN);
+  unsigned long long decoded;
+  assert(plx_decode_leb128_ull(bytes, PLX_LEB128_MAX_LEN, &decoded) ==
+         PLX_LEB128_MAX_LEN);
+  assert(decoded == ULLONG_MAX);
+}
+
 void plx_test_leb128(void) {
   plx_test_write_leb128_ull();
   plx_test_write_leb128_ll();
+  plx_test_append_leb128();
+  plx_test_decode_leb128();
+  plx_test_patch_leb128();
+  plx_test_leb128_round_trip();
 }
@@ -0,0 +1,228 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "llvm_ir_generator.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "symbol_table_entry.h"
+#include "test_helpers.h"
+
+// Generates LLVM IR for a program, writing it to the buffer.
+static void plx_generate_llvm_ir_for_test(const char* const source,
+                                          char* const buf, const size_t size) {
+  struct plx_node* const module = plx_compile_front_end_for_test(source);
+  struct plx_buffer buffer = PLX_BUFFER_INIT;
+  plx_generate_llvm_ir(module, /*fast_math=*/false, &buffer);
+  assert(buffer.len < size);
+  memcpy(buf, buffer.data, buffer.len);
+  buf[buffer.len] = '\0';
+  plx_buffer_free(&buffer);
+}
+
+// Returns the number of times the substring occurs in the string.
+static size_t plx_count_substr(const char* str, const char* const substr) {
+  size_t count = 0;
+  while ((str = strstr(str, substr)) != NULL) {
+    ++count;
+    str += strlen(substr);
+  }
+  return count;
+}
+
+// Tests that globals are addressed directly rather than through stack slots.
+static void plx_test_llvm_ir_generator_globals(void) {
+  char ir[4096];
+  plx_generate_llvm_ir_for_test(
+      "var a = 1;\n"
+      "var b = 2;\n"
+      "var c = 3;\n"
+      "const k = 4;\n"
+      "func f() -> s32 {\n"
+      "  a += b;\n"
+      "  b = c + k;\n"
+      "  c *= a;\n"
+      "  *&a = *&k;\n"
+      "  while a < 100 {\n"
+      "    a += c;\n"
+      "    b -= 1;\n"
+      "  }\n"
+      "  return a + b + c;\n"
+      "}\n",
+      ir, sizeof(ir));
+  assert(plx_count_substr(ir, "alloca") == 0);
+  assert(strstr(ir, "@k = unnamed_addr constant i32 4") != NULL);
+}
+
+// Tests that only locals whose address is taken are given stack slots.
+static void plx_test_llvm_ir_generator_locals(void) {
+  char ir[4096];
+  plx_generate_llvm_ir_for_test(
+      "func f(x: s32) -> s32 {\n"
+      "  var a = 1;\n"
+      "  var b = 2;\n"
+      "  a += x;\n"
+      "  *&b = a;\n"
+      "  if a > b {\n"
+      "    a = b;\n"
+      "  }\n"
+      "  return a + b;\n"
+      "}\n",
+      ir, sizeof(ir));
+  assert(plx_count_substr(ir, "alloca") == 1);
+}
+
+// Tests that vector operations are lowered to LLVM vector instructions.
+static void plx_test_llvm_ir_generator_vectors(void) {
+  char ir[8192];
+  plx_generate_llvm_ir_for_test(
+      "func f(a: vec[4]f32, b: vec[4]f32) -> f32 {\n"
+      "  var c: vec[4]f32;\n"
+      "  c = @select(a < b, a * b, @shuffle(a, b, [4, 5, 2, 3]));\n"
+      "  c[0] += a[1];\n"
+      "  return @reduceAdd(c);\n"
+      "}\n",
+      ir, sizeof(ir));
+  assert(strstr(ir, "<4 x float>") != NULL);
+  assert(strstr(ir, "fmul <4 x float>") != NULL);
+  assert(strstr(ir, "select <4 x i1>") != NULL);
+  assert(strstr(ir, "shufflevector") != NULL);
+  assert(strstr(ir, "insertelement") != NULL);
+  assert(strstr(ir, "extractelement") != NULL);
+}
+
+// Tests that counted loops keep their counters in registers.
+static void plx_test_llvm_ir_generator_for_loops(void) {
+  char ir[8192];
+  plx_generate_llvm_ir_for_test(
+      "func f(n: s32) -> s32 {\n"
+      "  var total = 0;\n"
+      "  for i in 0..n {\n"
+      "    total += i;\n"
+      "  }\n"
+      "  return total;\n"
+      "}\n",
+      ir, sizeof(ir));
+  assert(strstr(ir, "icmp slt i32") != NULL);
+  assert(strstr(ir, "add nsw i32") != NULL);
+  assert(strstr(ir, "alloca") == NULL);
+}
+
+// Tests that constants are immediate operands rather than locals.
+static void plx_test_llvm_ir_generator_constants(void) {
+  char ir[4096];
+  plx_generate_llvm_ir_for_test(
+      "func f(x: s32) -> s32 {\n"
+      "  var a = 7;\n"
+      "  if x > 3 {\n"
+      "    a = x * 5;\n"
+      "  }\n"
+      "  return a;\n"
+      "}\n",
+      ir, sizeof(ir));
+  assert(strstr(ir, "bitcast") == NULL);
+  assert(strstr(ir, "icmp sgt i32 %v0, 3") != NULL);
+  assert(strstr(ir, "mul i32 %v0, 5") != NULL);
+  assert(strstr(ir, "[ 7, %bb") != NULL);
+}
+
+// Tests that calls in return position to functions with the caller's
+// signature are guaranteed tail calls.
+static void plx_test_llvm_ir_generator_tail_calls(void) {
+  char ir[8192];
+  plx_generate_llvm_ir_for_test(
+      "func sum(n: s32, acc: s32) -> s32 {\n"
+      "  if n == 0 {\n"
+      "    return acc;\n"
+      "  }\n"
+      "  return tail sum(n - 1, acc + n);\n"
+      "}\n"
+      "\n"
+      "func f(n: s32) -> s32 {\n"
+      "  return sum(n, 0);\n"
+      "}\n",
+      ir, sizeof(ir));
+  assert(plx_count_substr(ir, "musttail call") == 1);
+  assert(strstr(ir, "musttail call i32 @sum(") != NULL);
+  assert(plx_count_substr(ir, "call i32 @sum(") == 2);
+}
+
+// Returns the codegen unit of the definition with the name.
+static unsigned int plx_llvm_unit_for_test(const struct plx_node* const module,
+                                           const char* const name) {
+  for (const struct plx_node* def = module->children; def != NULL;
+       def = def->next) {
+    if (strcmp(def->children->name, name) == 0) {
+      return def->children->entry->llvm_unit;
+    }
+  }
+  assert(false);
+  return 0;
+}
+
+// Tests that functions are partitioned into codegen units by the SCCs of the
+// call graph, callers before callees.
+static void plx_test_llvm_ir_generator_partition(void) {
+  const struct plx_node* const module = plx_compile_front_end_for_test(
+      "var g = 1;\n"
+      "\n"
+      "func leaf(x: s32) -> s32 {\n"
+      "  return (x * x) + ((x * 3) + ((x * 5) + ((x * 7) + (x * 9))));\n"
+      "}\n"
+      "\n"
+      "func fact(n: s32) -> s32 {\n"
+      "  if n == 0 {\n"
+      "    return 1;\n"
+      "  }\n"
+      "  return n * fact(n - 1);\n"
+      "}\n"
+      "\n"
+      "func mid(x: s32) -> s32 {\n"
+      "  return leaf(x) + fact(x);\n"
+      "}\n"
+      "\n"
+      "func main() -> s32 {\n"
+      "  return mid(g);\n"
+      "}\n");
+  assert(plx_partition_llvm_ir(module, 1) == 1);
+  assert(plx_partition_llvm_ir(module, 2) == 2);
+  assert(plx_llvm_unit_for_test(module, "g") == 0);
+  assert(plx_llvm_unit_for_test(module, "main") == 0);
+  assert(plx_llvm_unit_for_test(module, "mid") == 0);
+  assert(plx_llvm_unit_for_test(module, "leaf") == 1);
+
+  // Globals and functions in other units are declared.
+  char ir[4096];
+  struct plx_buffer buffer = PLX_BUFFER_INIT;
+  plx_generate_llvm_ir_unit(module, 1, /*fast_math=*/false, &buffer);
+  assert(buffer.len < sizeof(ir));
+  memcpy(ir, buffer.data, buffer.len);
+  ir[buffer.len] = '\0';
+  plx_buffer_free(&buffer);
+  assert(strstr(ir, "@g = external global i32") != NULL);
+  assert(strstr(ir, "declare i32 @mid(") != NULL);
+  assert(strstr(ir, "define i32 @leaf(") != NULL);
+}
+
+void plx_test_llvm_ir_generator(void) {
+  plx_test_llvm_ir_generator_globals();
+  plx_test_llvm_ir_generator_locals();
+  plx_test_llvm_ir_generator_vectors();
+  plx_test_llvm_ir_generator_for_loops();
+  plx_test_llvm_ir_generator_constants();
+  plx_test_llvm_ir_generator_partition();
+  plx_test_llvm_ir_generator_tail_calls();
+}
@@ -0,0 +1,132 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "loop_invariant_code_motion.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+// Hoists the loop invariants of a program, writing the report to the buffer,
+// and returns the program.
+static struct plx_node* plx_hoist_loop_invariants_for_test(
+    const char* const source, char* const buf, const size_t size) {
+  struct plx_node* const module = plx_compile_front_end_for_test(source);
+  FILE* const report = tmpfile();
+  assert(report != NULL);
+  plx_hoist_loop_invariants(module, report);
+  plx_read_file_for_test(report, buf, size);
+  return module;
+}
+
+// Tests that invariant arithmetic in the condition and body of a loop and
+// loads of global variables that the loop does not write are hoisted into
+// temporaries before the loop.
+static void plx_test_loop_invariant_code_motion_hoisting(void) {
+  static const char source[] =
+      "var g: s32;\n"
+      "\n"
+      "func f(n: s32, m: s32) -> s32 {\n"
+      "  var t = 0;\n"
+      "  var i = 0;\n"
+      "  while i < (n * m) {\n"
+      "    t += (m * 3) + i;\n"
+      "    t += g;\n"
+      "    i += 1;\n"
+      "  }\n"
+      "  return t;\n"
+      "}\n"
+      "\n"
+      "func nested(n: s32, m: s32) -> s32 {\n"
+      "  var t = 0;\n"
+      "  for i in 0..n {\n"
+      "    for j in 0..m {\n"
+      "      t += (n * m) + (i * 2);\n"
+      "    }\n"
+      "  }\n"
+      "  return t;\n"
+      "}\n";
+  char report[256];
+  const struct plx_node* const module =
+      plx_hoist_loop_invariants_for_test(source, report, sizeof(report));
+  assert(strcmp(report,
+                "f: 3 loop-invariant expressions hoisted\n"
+                "nested: 2 loop-invariant expressions hoisted\n") == 0);
+
+  // The temporaries are defined between the variables and the loop.
+  const struct plx_node* stmt =
+      module->children->next->children->next->next->next->children;
+  for (int i = 0; i < 5; ++i, stmt = stmt->next) {
+    assert(stmt->kind == PLX_NODE_VAR_DEF);
+  }
+  assert(stmt->kind == PLX_NODE_WHILE_LOOP);
+}
+
+// Tests that loads of memory that a loop may write through a store or a call
+// stay in the loop, as do divisions that could trap if the loop would not
+// have evaluated them.
+static void plx_test_loop_invariant_code_motion_effects(void) {
+  static const char source[] =
+      "var g: s32;\n"
+      "\n"
+      "noinline func h() -> s32 {\n"
+      "  return 0;\n"
+      "}\n"
+      "\n"
+      "func stores(n: s32, r: &s32) -> s32 {\n"
+      "  var t = 0;\n"
+      "  var i = 0;\n"
+      "  while i < n {\n"
+      "    t += g + (n * 2);\n"
+      "    *r = t;\n"
+      "    i += 1;\n"
+      "  }\n"
+      "  return t;\n"
+      "}\n"
+      "\n"
+      "func calls(n: s32) -> s32 {\n"
+      "  var t = 0;\n"
+      "  loop {\n"
+      "    t += g;\n"
+      "    var c = 0;\n"
+      "    c = h();\n"
+      "    if t > (n * 4) {\n"
+      "      break;\n"
+      "    }\n"
+      "  }\n"
+      "  return t;\n"
+      "}\n"
+      "\n"
+      "func divisions(n: s32) -> s32 {\n"
+      "  var t = 0;\n"
+      "  for k in 0..n {\n"
+      "    t += (k * n) + (n / 2);\n"
+      "    t += 10 / n;\n"
+      "  }\n"
+      "  return t;\n"
+      "}\n";
+  char report[256];
+  plx_hoist_loop_invariants_for_test(source, report, sizeof(report));
+  assert(strcmp(report,
+                "stores: 1 loop-invariant expressions hoisted\n"
+                "calls: 1 loop-invariant expressions hoisted\n"
+                "divisions: 1 loop-invariant expressions hoisted\n") == 0);
+}
+
+void plx_test_loop_invariant_code_motion(void) {
+  plx_test_loop_invariant_code_motion_hoisting();
+  plx_test_loop_invariant_code_motion_effects();
+}
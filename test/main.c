@@ -14,13 +14,35 @@
 
 #include <stdlib.h>
 
+void plx_test_bounds_checker(void);
+void plx_test_buffer(void);
+void plx_test_call_graph(void);
+void plx_test_common_subexpr_eliminator(void);
+void plx_test_dead_code_eliminator(void);
+void plx_test_inliner(void);
 void plx_test_leb128(void);
+void plx_test_llvm_ir_generator(void);
+void plx_test_loop_invariant_code_motion(void);
 void plx_test_symbol_table(void);
 void plx_test_tokenizer(void);
+void plx_test_wasm(void);
+void plx_test_wasm_generator(void);
+void plx_test_x86_64_generator(void);
 
 int main() {
+  plx_test_bounds_checker();
+  plx_test_buffer();
+  plx_test_call_graph();
+  plx_test_common_subexpr_eliminator();
+  plx_test_dead_code_eliminator();
+  plx_test_inliner();
   plx_test_leb128();
+  plx_test_llvm_ir_generator();
+  plx_test_loop_invariant_code_motion();
   plx_test_symbol_table();
   plx_test_tokenizer();
+  plx_test_wasm();
+  plx_test_wasm_generator();
+  plx_test_x86_64_generator();
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,63 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "test_helpers.h"
+
+#include <assert.h>
+
+#include "ast_validator.h"
+#include "constant_folder.h"
+#include "name_resolver.h"
+#include "parser.h"
+#include "return_checker.h"
+#include "symbol_table.h"
+#include "tail_call_checker.h"
+#include "tokenizer.h"
+#include "type_checker.h"
+
+struct plx_node* plx_parse_for_test(const char* const source) {
+  FILE* const stream = tmpfile();
+  assert(stream != NULL);
+  fputs(source, stream);
+  fseek(stream, 0, SEEK_SET);
+
+  struct plx_tokenizer tokenizer;
+  plx_tokenizer_init(&tokenizer, /*filename=*/"<test>", stream);
+  struct plx_node* const module = plx_parse_module(&tokenizer);
+  assert(module != NULL);
+  fclose(stream);
+
+  struct plx_symbol_table symbol_table = PLX_SYMBOL_TABLE_INIT;
+  assert(plx_resolve_names(module, &symbol_table));
+  return module;
+}
+
+struct plx_node* plx_compile_front_end_for_test(const char* const source) {
+  struct plx_node* const module = plx_parse_for_test(source);
+  assert(plx_type_check(module, /*return_type=*/NULL));
+  assert(plx_check_returns(module));
+  assert(plx_check_tail_calls(module));
+  while (plx_fold_constants(module)) {
+  }
+  assert(plx_validate_ast(module));
+  return module;
+}
+
+void plx_read_file_for_test(FILE* const stream, char* const buf,
+                            const size_t size) {
+  fseek(stream, 0, SEEK_SET);
+  const size_t len = fread(buf, 1, size - 1, stream);
+  buf[len] = '\0';
+  fclose(stream);
+}
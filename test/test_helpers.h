@@ -0,0 +1,34 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PLX_TEST_HELPERS_H
+#define PLX_TEST_HELPERS_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "ast.h"
+
+// Parses a program and resolves its names, without checking it.
+struct plx_node* plx_parse_for_test(const char* source);
+
+// Parses a program and runs the same front end as `plx_compile` on it, which
+// checks it and folds its constants.
+struct plx_node* plx_compile_front_end_for_test(const char* source);
+
+// Reads what has been written to a temporary file into the buffer as a
+// null-terminated string, and closes the file.
+void plx_read_file_for_test(FILE* stream, char* buf, size_t size);
+
+#endif  // PLX_TEST_HELPERS_H
@@ -22,9 +22,9 @@ static void plx_test_tokenizer_keywords(void) {
   FILE* const stream = tmpfile();
   assert(stream != NULL);
   fputs(
-      "const var struct func if else defer loop while for continue break "
-      "return and or xor s8 s16 s32 s64 u8 u16 u32 u64 f16 f32 f64 bool true "
-      "false",
+      "const var struct func inline noinline if else defer loop while for in "
+      "continue break return tail and or xor s8 s16 s32 s64 u8 u16 u32 u64 f16 "
+      "f32 f64 bool true false",
       stream);
   fseek(stream, 0, SEEK_SET);
 
@@ -34,15 +34,19 @@ static void plx_test_tokenizer_keywords(void) {
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_VAR);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_STRUCT);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_FUNC);
+  assert(plx_read_token(&tokenizer) == PLX_TOKEN_INLINE);
+  assert(plx_read_token(&tokenizer) == PLX_TOKEN_NOINLINE);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_IF);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_ELSE);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_DEFER);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_LOOP);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_WHILE);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_FOR);
+  assert(plx_read_token(&tokenizer) == PLX_TOKEN_IN);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_CONTINUE);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_BREAK);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_RETURN);
+  assert(plx_read_token(&tokenizer) == PLX_TOKEN_TAIL);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_AND);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_OR);
   assert(plx_read_token(&tokenizer) == PLX_TOKEN_XOR);
@@ -149,6 +153,25 @@ static void plx_test_tokenizer_decimal_literals(void) {
   assert(tokenizer.token == PLX_TOKEN_EOF);
 }
 
+static void plx_test_tokenizer_ranges(void) {
+  FILE* const stream = tmpfile();
+  assert(stream != NULL);
+  fputs("0..n", stream);
+  fseek(stream, 0, SEEK_SET);
+
+  struct plx_tokenizer tokenizer;
+  plx_tokenizer_init(&tokenizer, /*filename=*/"<test>", stream);
+  assert(tokenizer.token == PLX_TOKEN_INT);
+  assert(tokenizer.uint == 0);
+  plx_next_token(&tokenizer);
+  assert(tokenizer.token == PLX_TOKEN_RANGE);
+  plx_next_token(&tokenizer);
+  assert(tokenizer.token == PLX_TOKEN_IDENTIFIER);
+  assert(strncmp(tokenizer.str, "n", tokenizer.len) == 0);
+  plx_next_token(&tokenizer);
+  assert(tokenizer.token == PLX_TOKEN_EOF);
+}
+
 static void plx_test_tokenizer_strings(void) {
   FILE* const stream = tmpfile();
   assert(stream != NULL);
@@ -268,6 +291,7 @@ void plx_test_tokenizer(void) {
   plx_test_tokenizer_binary_literals();
   plx_test_tokenizer_float_literals();
   plx_test_tokenizer_decimal_literals();
+  plx_test_tokenizer_ranges();
   plx_test_tokenizer_strings();
   plx_test_tokenizer_string_double_quote_escapes();
   plx_test_tokenizer_backslash_escapes();
@@ -0,0 +1,67 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wasm_generator.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+// Generates a WebAssembly module for a program, reading it back into the
+// buffer, and checks that its size is measured without writing it. Returns the
+// size of the module.
+static size_t plx_generate_wasm_for_test(const char* const source,
+                                         unsigned char* const buf,
+                                         const size_t size) {
+  struct plx_node* const module = plx_compile_front_end_for_test(source);
+  FILE* const stream = tmpfile();
+  assert(stream != NULL);
+  assert(plx_generate_wasm(module, stream));
+  fseek(stream, 0, SEEK_SET);
+  const size_t len = fread(buf, sizeof(*buf), size, stream);
+  assert(len < size);
+  fclose(stream);
+  assert(plx_generated_wasm_size(module) == len);
+  return len;
+}
+
+// Tests that the sections are written after the preamble with their sizes,
+// matching the output of the generator before it built them in memory.
+static void plx_test_wasm_generator_sections(void) {
+  unsigned char wasm[256];
+  const size_t len = plx_generate_wasm_for_test(
+      "func add(a: s32, b: s64) -> s64 {\n"
+      "  return b;\n"
+      "}\n"
+      "func main() -> s32 {\n"
+      "  return 0;\n"
+      "}\n",
+      wasm, sizeof(wasm));
+  const unsigned char expected[] = {
+      // Preamble
+      0x00, 0x61, 0x73, 0x6D, 0x01, 0x00, 0x00, 0x00,
+      // Type section
+      0x01, 0x0B, 0x02, 0x60, 0x02, 0x7F, 0x7E, 0x01, 0x7E, 0x60, 0x00, 0x01,
+      0x7F,
+      // Function section
+      0x03, 0x03, 0x02, 0x00, 0x01,
+      // Code section
+      0x0A, 0x00};
+  assert(len == sizeof(expected));
+  assert(memcmp(wasm, expected, sizeof(expected)) == 0);
+}
+
+void plx_test_wasm_generator(void) { plx_test_wasm_generator_sections(); }
@@ -0,0 +1,38 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "wasm.h"
+
+#include <assert.h>
+#include <string.h>
+
+#include "buffer.h"
+
+// Tests that vector instructions are prefixed and that opcodes past 127 take
+// two bytes.
+static void plx_test_wasm_write_vector_instruction(void) {
+  struct plx_buffer buffer = PLX_BUFFER_INIT;
+  plx_wasm_write_vector_instruction(&buffer, PLX_WASM_V128_LOAD);
+  plx_wasm_write_memarg(&buffer, /*align=*/4, /*offset=*/0);
+  plx_wasm_write_vector_instruction(&buffer, PLX_WASM_I32X4_ADD);
+  plx_wasm_write_vector_instruction(&buffer, PLX_WASM_F32X4_EXTRACT_LANE);
+  plx_buffer_append_char(&buffer, 3);
+  const unsigned char expected[] = {0xFD, 0x00, 0x04, 0x00, 0xFD,
+                                    0xAE, 0x01, 0xFD, 0x1F, 0x03};
+  assert(buffer.len == sizeof(expected));
+  assert(memcmp(buffer.data, expected, sizeof(expected)) == 0);
+  plx_buffer_free(&buffer);
+}
+
+void plx_test_wasm(void) { plx_test_wasm_write_vector_instruction(); }
@@ -0,0 +1,107 @@
+// Copyright 2024 Miles Barr
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "x86_64_generator.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "test_helpers.h"
+
+// Generates an x86-64 object for a program, returning whether the back end
+// supports it.
+static bool plx_generate_x86_64_for_test(const char* const source) {
+  struct plx_node* const module = plx_compile_front_end_for_test(source);
+  struct plx_x86_64_object object = PLX_X86_64_OBJECT_INIT;
+  const bool result = plx_generate_x86_64(module, &object);
+  if (result) {
+    bool has_main = false;
+    for (size_t i = 0; i < object.symbol_count; ++i) {
+      if (strcmp(object.symbols[i].name, "main") == 0) has_main = true;
+    }
+    assert(has_main);
+  }
+  plx_x86_64_object_free(&object);
+  return result;
+}
+
+// Tests that arrays are indexed and iterated over in place, including through
+// references, but are not passed by value or copied, since loads and stores
+// only move a single register.
+static void plx_test_x86_64_generator_arrays(void) {
+  assert(plx_generate_x86_64_for_test(
+      "var g: [4]s32;\n"
+      "\n"
+      "func sum(a: &[8]s32) -> s32 {\n"
+      "  var s = 0;\n"
+      "  for x in *a {\n"
+      "    s += x;\n"
+      "  }\n"
+      "  return s;\n"
+      "}\n"
+      "\n"
+      "func main() -> s32 {\n"
+      "  var a: [8]s32;\n"
+      "  for i in 0..8 {\n"
+      "    a[i] = i;\n"
+      "  }\n"
+      "  g[1] = a[7];\n"
+      "  return sum(&a) + g[1];\n"
+      "}\n"));
+
+  // Arrays passed by value.
+  assert(!plx_generate_x86_64_for_test(
+      "func sum(a: [8]s32) -> s32 {\n"
+      "  var s = 0;\n"
+      "  for x in a {\n"
+      "    s += x;\n"
+      "  }\n"
+      "  return s;\n"
+      "}\n"
+      "\n"
+      "func main() -> s32 {\n"
+      "  var a: [8]s32;\n"
+      "  for i in 0..8 {\n"
+      "    a[i] = i;\n"
+      "  }\n"
+      "  return sum(a);\n"
+      "}\n"));
+
+  // Arrays returned by value.
+  assert(!plx_generate_x86_64_for_test(
+      "var g: [4]s32;\n"
+      "\n"
+      "func get() -> [4]s32 {\n"
+      "  return g;\n"
+      "}\n"
+      "\n"
+      "func main() -> s32 {\n"
+      "  return 0;\n"
+      "}\n"));
+
+  // Arrays copied by assignment.
+  assert(!plx_generate_x86_64_for_test(
+      "func main() -> s32 {\n"
+      "  var a: [4]s32;\n"
+      "  a[3] = 9;\n"
+      "  var b: [4]s32;\n"
+      "  b = a;\n"
+      "  return b[3];\n"
+      "}\n"));
+}
+
+void plx_test_x86_64_generator(void) {
+  plx_test_x86_64_generator_arrays();
+}